@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+# Builds the osu_slider_rasterizer_test goldens (slider_<name>.rgba) from slider_<name>.points,
+# by doing what OsuSliderRenderer::draw() makes the gpu do, without using any of OsuSliderRasterizer:
+#
+#  - every curve point gets the 42-gon cone of OsuSliderRenderer::checkUpdateVars() (a triangle fan,
+#    tip at texcoord 1 and depth 0.5, rim vertices at (sin, cos) of j*2pi/42 with texcoord 0 and depth 0)
+#  - rasterized at the pixel centers, texcoord interpolated linearly across each triangle (orthographic,
+#    so the same as perspective correct), the depth test keeps the highest cone (depth is 0.5*texcoord)
+#  - slider.fsh evaluated for every covered pixel (not through a lookup table), then stored as RGBA8
+#    (round to nearest), into a buffer cleared to transparent black, blending disabled
+#
+# Usage: python3 make_slider_goldens.py [directory], the .points files are written by osu_slider_rasterizer_test
+# when osu_slider_rasterizer_write_points is enabled.
+
+import glob
+import math
+import os
+import sys
+
+UNIT_CIRCLE_SUBDIVIDES = 42
+
+def read_points(path):
+	with open(path) as f:
+		lines = [line.split() for line in f if line.strip()]
+	header = {}
+	i = 0
+	while lines[i][0] != 'points':
+		header[lines[i][0]] = lines[i][1:]
+		i += 1
+	num_points = int(lines[i][1])
+	points = [(float(x), float(y)) for x, y in lines[i+1:i+1+num_points]]
+	return header, points
+
+def rasterize(width, height, points, diameter):
+	# highest texcoord at every pixel, -1 where no cone covers it
+	depth = [-1.0]*(width*height)
+	radius = diameter/2.0
+	step = 2.0*math.pi/UNIT_CIRCLE_SUBDIVIDES
+	apothem = radius*math.cos(step/2.0) # distance from the tip to the middle of every rim edge
+	normals = [(math.sin((j + 0.5)*step), math.cos((j + 0.5)*step)) for j in range(UNIT_CIRCLE_SUBDIVIDES)]
+	for cx, cy in points:
+		min_x = max(0, int(math.floor(cx - radius)))
+		max_x = min(width-1, int(math.ceil(cx + radius)))
+		min_y = max(0, int(math.floor(cy - radius)))
+		max_y = min(height-1, int(math.ceil(cy + radius)))
+		for y in range(min_y, max_y+1):
+			dy = y + 0.5 - cy
+			row = y*width
+			for x in range(min_x, max_x+1):
+				dx = x + 0.5 - cx
+				# the triangle of the fan this pixel is in, the rim vertices are at (sin, cos) of the phase
+				phase = math.atan2(dx, dy)
+				if phase < 0.0:
+					phase += 2.0*math.pi
+				nx, ny = normals[min(int(phase/step), UNIT_CIRCLE_SUBDIVIDES-1)]
+				# barycentric weight of the tip
+				texcoord = 1.0 - (nx*dx + ny*dy)/apothem
+				if texcoord >= 0.0 and texcoord > depth[row + x]:
+					depth[row + x] = texcoord
+	return depth
+
+def mix(a, b, t):
+	return [a[c] + (b[c] - a[c])*t for c in range(4)]
+
+def shade(texcoord, style, border_rgb, body_rgb):
+	# slider.fsh
+	osu_next_style, body_alpha_multiplier, body_color_saturation, border_size_multiplier = style
+	default_transition_size = 0.011
+	default_border_size = 0.11
+	outer_shadow_size = 0.08
+
+	border_size = default_border_size*border_size_multiplier
+	transition_size = default_transition_size
+
+	border_color = [border_rgb[0], border_rgb[1], border_rgb[2], 1.0]
+	body_color = [body_rgb[0], body_rgb[1], body_rgb[2], 0.7*body_alpha_multiplier]
+	outer_shadow_color = [0.0, 0.0, 0.0, 0.25]
+	brightness_multiplier = 0.25
+	darkness_multiplier = 0.1
+	inner_body_color = [min(1.0, body_color[c]*(1.0 + 0.5*brightness_multiplier) + brightness_multiplier)*body_color_saturation for c in range(3)] + [body_color[3]]
+	outer_body_color = [min(1.0, body_color[c]/(1.0 + darkness_multiplier))*body_color_saturation for c in range(3)] + [body_color[3]]
+
+	if osu_next_style:
+		outer_body_color = [body_color[c]*body_color_saturation for c in range(3)] + [1.0*body_alpha_multiplier]
+		inner_body_color = [body_color[c]*0.5*body_color_saturation for c in range(3)] + [0.0]
+
+	if border_size_multiplier < 0.01:
+		border_color = outer_shadow_color
+
+	out_color = [0.0, 0.0, 0.0, 0.0]
+	if texcoord < outer_shadow_size - transition_size:
+		out_color = mix([0.0, 0.0, 0.0, 0.0], outer_shadow_color, texcoord/(outer_shadow_size - transition_size))
+	if texcoord > outer_shadow_size - transition_size and texcoord < outer_shadow_size + transition_size:
+		out_color = mix(outer_shadow_color, border_color, (texcoord - outer_shadow_size + transition_size)/(2.0*transition_size))
+	if texcoord > outer_shadow_size + transition_size and texcoord < outer_shadow_size + border_size - transition_size:
+		out_color = border_color
+	if texcoord > outer_shadow_size + border_size - transition_size and texcoord < outer_shadow_size + border_size + transition_size:
+		out_color = mix(border_color, outer_body_color, (texcoord - outer_shadow_size - border_size + transition_size)/(2.0*transition_size))
+	if texcoord > outer_shadow_size + border_size + transition_size:
+		size = outer_shadow_size + border_size + transition_size
+		out_color = mix(outer_body_color, inner_body_color, (texcoord - size)/(1.0 - size))
+	return out_color
+
+def to_unorm8(value):
+	return int(min(max(value, 0.0), 1.0)*255.0 + 0.5)
+
+def make_golden(points_path, golden_path):
+	header, points = read_points(points_path)
+	width, height = int(header['size'][0]), int(header['size'][1])
+	diameter = float(header['diameter'][0])
+	style = (int(header['style'][0]) != 0, float(header['style'][1]), float(header['style'][2]), float(header['style'][3]))
+	alpha = float(header['style'][4]) # the framebuffer is drawn with this alpha
+	border_rgb = [int(c)/255.0 for c in header['border']]
+	body_rgb = [int(c)/255.0 for c in header['body']]
+
+	# the same snaking limits as OsuSliderRenderer::draw() (std::round, half away from zero)
+	snake_from, snake_to = float(header['snake'][0]), float(header['snake'][1])
+	draw_from_index = min(max(int(math.floor(len(points)*snake_from + 0.5)), 0), len(points))
+	draw_up_to_index = min(max(int(math.floor(len(points)*snake_to + 0.5)), 0), len(points))
+
+	depth = rasterize(width, height, points[draw_from_index:draw_up_to_index], diameter)
+
+	rgba = bytearray(width*height*4)
+	colors = {}
+	for i, texcoord in enumerate(depth):
+		if texcoord < 0.0:
+			continue
+		if texcoord not in colors:
+			color = shade(texcoord, style, border_rgb, body_rgb)
+			color[3] *= alpha
+			colors[texcoord] = bytes(to_unorm8(c) for c in color)
+		rgba[i*4:i*4 + 4] = colors[texcoord]
+
+	with open(golden_path, 'wb') as f:
+		f.write(rgba)
+
+def main():
+	directory = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+	for points_path in sorted(glob.glob(os.path.join(directory, 'slider_*.points'))):
+		golden_path = points_path[:-len('.points')] + '.rgba'
+		make_golden(points_path, golden_path)
+		print('%s -> %s' % (os.path.basename(points_path), os.path.basename(golden_path)))
+
+if __name__ == '__main__':
+	main()
@@ -43,6 +43,31 @@
 #include "OsuHitObject.h"
 
 #include "OsuBeatmapDatabase.h"
+#include "OsuScoreDatabase.h"
+#include "OsuCollectionDatabase.h"
+#include "OsuHitObjectFactory.h"
+#include "OsuGameplayCheckpoints.h"
+#include "OsuFollowPoints.h"
+#include "OsuRecordingGraphics.h"
+#include "OsuSliderRasterizer.h"
+#include "OsuSpriteBatch.h"
+#include "OsuAutoCursorPath.h"
+#include "OsuSongFolderWatcher.h"
+#include "OsuRandomBeatmapSelector.h"
+#include "OsuProfiler.h"
+#include "OsuSkinIni.h"
+#include "OsuTextureAtlas.h"
+#include "OsuLoadScheduler.h"
+#include "OsuBeatmapEvents.h"
+#include "OsuHitSoundScheduler.h"
+#include "OsuTimingAnalytics.h"
+#include "OsuMD5.h"
+#include "OsuMods.h"
+#include "OsuSlider.h"
+#include "OsuDifficultyCalculator.h"
+
+#include <ctime>
+#include <string.h>
 
 void DUMMY_OSU_LETTERBOXING(UString oldValue, UString newValue) {;}
 void DUMMY_OSU_VOLUME_MUSIC_ARGS(UString oldValue, UString newValue) {;}
@@ -59,6 +84,33 @@ ConVar osu_confine_cursor_fullscreen("osu_confine_cursor_fullscreen", true, DUMM
 ConVar osu_skin("osu_skin", "default", DUMMY_OSU_VOLUME_MUSIC_ARGS);
 ConVar osu_skin_reload("osu_skin_reload", DUMMY_OSU_MODS);
 
+// tests and benchmarks: there is no unit test runner, so every one of them is a console command which logs its results via debugLog()
+// they are all registered here (with a callback below), most of them need the selected beatmap or the skin
+ConVar osu_hitobject_benchmark("osu_hitobject_benchmark", DUMMY_OSU_MODS);
+ConVar osu_difficulty_snapshot_test("osu_difficulty_snapshot_test", DUMMY_OSU_MODS);
+ConVar osu_checkpoint_test("osu_checkpoint_test", DUMMY_OSU_MODS);
+ConVar osu_followpoints_test("osu_followpoints_test", DUMMY_OSU_MODS);
+ConVar osu_drawstats_benchmark("osu_drawstats_benchmark", DUMMY_OSU_MODS);
+ConVar osu_slider_rasterizer_test("osu_slider_rasterizer_test", DUMMY_OSU_MODS);
+ConVar osu_spritebatch_test("osu_spritebatch_test", DUMMY_OSU_MODS);
+ConVar osu_autocursor_test("osu_autocursor_test", DUMMY_OSU_MODS);
+ConVar osu_songfolder_test("osu_songfolder_test", DUMMY_OSU_MODS);
+ConVar osu_random_test("osu_random_test", DUMMY_OSU_MODS);
+ConVar osu_profiler_test("osu_profiler_test", DUMMY_OSU_MODS);
+ConVar osu_skin_ini_test("osu_skin_ini_test", DUMMY_OSU_MODS);
+ConVar osu_texture_atlas_test("osu_texture_atlas_test", DUMMY_OSU_MODS);
+ConVar osu_load_scheduler_test("osu_load_scheduler_test", DUMMY_OSU_MODS);
+ConVar osu_beatmap_events_test("osu_beatmap_events_test", DUMMY_OSU_MODS);
+ConVar osu_hitsound_scheduler_test("osu_hitsound_scheduler_test", DUMMY_OSU_MODS);
+ConVar osu_timing_analytics_test("osu_timing_analytics_test", DUMMY_OSU_MODS);
+ConVar osu_collection_db_test("osu_collection_db_test", DUMMY_OSU_MODS);
+ConVar osu_scores_db_test("osu_scores_db_test", DUMMY_OSU_MODS);
+ConVar osu_difficulty_benchmark("osu_difficulty_benchmark", DUMMY_OSU_MODS);
+ConVar osu_slider_events_test("osu_slider_events_test", DUMMY_OSU_MODS);
+ConVar osu_slider_curve_test("osu_slider_curve_test", DUMMY_OSU_MODS);
+ConVar osu_mods_test("osu_mods_test", DUMMY_OSU_MODS);
+ConVar osu_md5_test("osu_md5_test", DUMMY_OSU_MODS);
+
 ConVar osu_volume_master("osu_volume_master", 0.5f, DUMMY_OSU_VOLUME_MUSIC_ARGS);
 ConVar osu_volume_music("osu_volume_music", 0.3f, DUMMY_OSU_VOLUME_MUSIC_ARGS);
 ConVar osu_volume_change_interval("osu_volume_change_interval", 0.05f);
@@ -73,10 +125,14 @@ ConVar osu_mods("osu_mods", "", DUMMY_OSU_VOLUME_MUSIC_ARGS);
 ConVar osu_mod_fadingcursor("osu_mod_fadingcursor", false);
 ConVar osu_mod_fadingcursor_combo("osu_mod_fadingcursor_combo", 50.0f);
 ConVar osu_mod_endless("osu_mod_endless", false);
+ConVar osu_scores_enabled("osu_scores_enabled", true, "Save finished plays to the local scores.db");
 
 ConVar osu_letterboxing("osu_letterboxing", true, DUMMY_OSU_LETTERBOXING);
 ConVar osu_resolution("osu_resolution", "1280x720", DUMMY_OSU_VOLUME_MUSIC_ARGS);
 ConVar osu_resolution_enabled("osu_resolution_enabled", false);
+ConVar osu_collection_add("osu_collection_add", "", DUMMY_OSU_VOLUME_MUSIC_ARGS);
+ConVar osu_collection_remove("osu_collection_remove", "", DUMMY_OSU_VOLUME_MUSIC_ARGS);
+ConVar osu_profiler_export("osu_profiler_export", "", DUMMY_OSU_VOLUME_MUSIC_ARGS);
 
 ConVar osu_draw_fps("osu_draw_fps", true);
 ConVar osu_hide_cursor_during_gameplay("osu_hide_cursor_during_gameplay", false);
@@ -94,6 +150,7 @@ Osu::Osu()
 	m_osu_folder_ref = convar->getConVarByName("osu_folder");
 	m_osu_draw_hud_ref = convar->getConVarByName("osu_draw_hud");
 	m_osu_mod_fps_ref = convar->getConVarByName("osu_mod_fps");
+	m_osu_profiler_overlay_ref = convar->getConVarByName("osu_profiler_overlay");
 
 	// engine settings
 	env->setWindowTitle("McOsu!");
@@ -117,6 +174,30 @@ Osu::Osu()
 	// convar callbacks
 	osu_skin.setCallback( fastdelegate::MakeDelegate(this, &Osu::onSkinChange) );
 	osu_skin_reload.setCallback( fastdelegate::MakeDelegate(this, &Osu::onSkinReload) );
+	osu_hitobject_benchmark.setCallback( fastdelegate::MakeDelegate(this, &Osu::onHitObjectBenchmark) );
+	osu_difficulty_snapshot_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onDifficultySnapshotTest) );
+	osu_checkpoint_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onCheckpointTest) );
+	osu_followpoints_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onFollowPointsTest) );
+	osu_drawstats_benchmark.setCallback( fastdelegate::MakeDelegate(this, &Osu::onDrawStatsBenchmark) );
+	osu_slider_rasterizer_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onSliderRasterizerTest) );
+	osu_spritebatch_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onSpriteBatchTest) );
+	osu_autocursor_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onAutoCursorTest) );
+	osu_songfolder_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onSongFolderTest) );
+	osu_random_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onRandomTest) );
+	osu_profiler_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onProfilerTest) );
+	osu_skin_ini_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onSkinIniTest) );
+	osu_texture_atlas_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onTextureAtlasTest) );
+	osu_load_scheduler_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onLoadSchedulerTest) );
+	osu_beatmap_events_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onBeatmapEventsTest) );
+	osu_hitsound_scheduler_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onHitSoundSchedulerTest) );
+	osu_timing_analytics_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onTimingAnalyticsTest) );
+	osu_collection_db_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onCollectionDatabaseTest) );
+	osu_scores_db_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onScoreDatabaseTest) );
+	osu_difficulty_benchmark.setCallback( fastdelegate::MakeDelegate(this, &Osu::onDifficultyBenchmark) );
+	osu_slider_events_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onSliderEventsTest) );
+	osu_slider_curve_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onSliderCurveTest) );
+	osu_mods_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onModsTest) );
+	osu_md5_test.setCallback( fastdelegate::MakeDelegate(this, &Osu::onMD5Test) );
 
 	osu_volume_master.setCallback( fastdelegate::MakeDelegate(this, &Osu::onMasterVolumeChange) );
 	osu_volume_music.setCallback( fastdelegate::MakeDelegate(this, &Osu::onMusicVolumeChange) );
@@ -126,6 +207,9 @@ Osu::Osu()
 	osu_mods.setCallback( fastdelegate::MakeDelegate(this, &Osu::updateModsForConVarTemplate) );
 
 	osu_resolution.setCallback( fastdelegate::MakeDelegate(this, &Osu::onInternalResolutionChanged) );
+	osu_collection_add.setCallback( fastdelegate::MakeDelegate(this, &Osu::onCollectionAdd) );
+	osu_collection_remove.setCallback( fastdelegate::MakeDelegate(this, &Osu::onCollectionRemove) );
+	osu_profiler_export.setCallback( fastdelegate::MakeDelegate(this, &Osu::onProfilerExport) );
 	osu_letterboxing.setCallback( fastdelegate::MakeDelegate(this, &Osu::onLetterboxingChange) );
 
 	osu_confine_cursor_windowed.setCallback( fastdelegate::MakeDelegate(this, &Osu::onConfineCursorWindowedChange) );
@@ -156,20 +240,7 @@ Osu::Osu()
 	m_bToggleOptionsMenuScheduled = false;
 	m_bToggleRankingScreenScheduled = false;
 
-	m_bModAuto = false;
-	m_bModAutopilot = false;
-	m_bModRelax = false;
-	m_bModSpunout = false;
-	m_bModTarget = false;
-	m_bModDT = false;
-	m_bModNC = false;
-	m_bModHT = false;
-	m_bModHD = false;
-	m_bModHR = false;
-	m_bModEZ = false;
-	m_bModSD = false;
-	m_bModSS = false;
-	m_bModNM = false;
+	m_iMods = OsuMods::NONE;
 
 	m_bShouldCursorBeVisible = false;
 
@@ -189,10 +260,13 @@ Osu::Osu()
 	// load a few select subsystems very early
 	m_notificationOverlay = new OsuNotificationOverlay(this);
 	m_score = new OsuScore(this);
+	m_loadScheduler = new OsuLoadScheduler();
 
 	// exec the config file (this must be right here!)
 	Console::execConfigFile("osu");
 
+	m_hitSoundScheduler = new OsuHitSoundScheduler(new OsuHitSoundScheduler::EngineBackend(), true); // after the config, for osu_hitsound_voices/osu_hitsound_max_polyphony
+
 	// update mod settings
 	updateMods();
 
@@ -273,12 +347,16 @@ Osu::~Osu()
 		SAFE_DELETE(m_screens[i]);
 	}
 
+	SAFE_DELETE(m_hitSoundScheduler); // before the skin, whose sounds it plays
 	SAFE_DELETE(m_skin);
 	SAFE_DELETE(m_score);
+	SAFE_DELETE(m_loadScheduler); // last, the beatmaps in the screens above cancel their loads on destruction
 }
 
 void Osu::draw(Graphics *g)
 {
+	OSU_PROFILER_ZONE("Osu::draw");
+
 	if (m_skin == NULL) // sanity check
 	{
 		g->setColor(0xffff0000);
@@ -288,7 +366,9 @@ void Osu::draw(Graphics *g)
 
 	// if we are not using the native window resolution, draw into the buffer
 	if (osu_resolution_enabled.getBool())
-		m_backBuffer->enable();
+	{
+		OsuRecordingGraphics::enableRenderTarget(m_backBuffer);
+	}
 
 	// draw everything in the correct order
 	if (isInPlayMode()) // if we are playing a beatmap
@@ -313,7 +393,7 @@ void Osu::draw(Graphics *g)
 		if (m_pauseMenu->isVisible() || getSelectedBeatmap()->isContinueScheduled())
 			fadingCursorAlpha = 1.0f;
 
-		if ((m_bModAuto || m_bModAutopilot) && allowDrawCursor)
+		if ((getModAuto() || getModAutopilot()) && allowDrawCursor)
 			m_hud->drawCursor(g, m_osu_mod_fps_ref->getBool() ? OsuGameRules::getPlayfieldCenter(this) : getSelectedBeatmap()->getCursorPos(), osu_mod_fadingcursor.getBool() ? fadingCursorAlpha : 1.0f);
 
 		m_pauseMenu->draw(g);
@@ -321,12 +401,14 @@ void Osu::draw(Graphics *g)
 
 		if (osu_draw_fps.getBool())
 			m_hud->drawFps(g);
+		if (m_osu_profiler_overlay_ref->getBool())
+			m_hud->drawProfiler(g);
 
 		m_hud->drawVolumeChange(g);
 
 		m_windowManager->draw(g);
 
-		if (!(m_bModAuto || m_bModAutopilot) && allowDrawCursor)
+		if (!(getModAuto() || getModAutopilot()) && allowDrawCursor)
 			m_hud->drawCursor(g, getSelectedBeatmap()->getCursorPos(), osu_mod_fadingcursor.getBool() ? fadingCursorAlpha : 1.0f);
 	}
 	else // if we are not playing
@@ -340,6 +422,8 @@ void Osu::draw(Graphics *g)
 
 		if (osu_draw_fps.getBool())
 			m_hud->drawFps(g);
+		if (m_osu_profiler_overlay_ref->getBool())
+			m_hud->drawProfiler(g);
 
 		m_hud->drawVolumeChange(g);
 
@@ -355,7 +439,7 @@ void Osu::draw(Graphics *g)
 	if (osu_resolution_enabled.getBool())
 	{
 		// draw a scaled version from the buffer to the screen
-		m_backBuffer->disable();
+		OsuRecordingGraphics::disableRenderTarget(m_backBuffer);
 
 		g->setBlending(false);
 		if (osu_letterboxing.getBool())
@@ -368,6 +452,11 @@ void Osu::draw(Graphics *g)
 
 void Osu::update()
 {
+	OsuProfiler::beginFrame();
+	OSU_PROFILER_ZONE("Osu::update");
+
+	m_loadScheduler->update();
+
 	m_windowManager->update();
 
 	for (int i=0; i<m_screens.size(); i++)
@@ -380,6 +469,9 @@ void Osu::update()
 	if (isInPlayMode())
 	{
 		getSelectedBeatmap()->update();
+		if (!m_hitSoundScheduler->isThreaded())
+			m_hitSoundScheduler->process(m_hitSoundScheduler->getMusicTime()); // starts everything which the beatmap update has just judged, before the clock is set back to the (coarser) music position
+		m_hitSoundScheduler->setMusicTime(getSelectedBeatmap()->getCurMusicPos(), getSelectedBeatmap()->isPlaying() && !getSelectedBeatmap()->isPaused() ? getSpeedMultiplier() : 0.0f);
 
 		// scrubbing/seeking
 		if ((engine->getKeyboard()->isControlDown() && engine->getKeyboard()->isAltDown()) || m_bSeekKey)
@@ -499,31 +591,20 @@ void Osu::update()
 
 void Osu::updateMods()
 {
-	m_bModAuto = osu_mods.getString().find("auto") != -1;
-	m_bModAutopilot = osu_mods.getString().find("autopilot") != -1;
-	m_bModRelax = osu_mods.getString().find("relax") != -1;
-	m_bModSpunout = osu_mods.getString().find("spunout") != -1;
-	m_bModTarget = osu_mods.getString().find("practicetarget") != -1;
-	m_bModDT = osu_mods.getString().find("dt") != -1;
-	m_bModNC = osu_mods.getString().find("nc") != -1;
-	m_bModHT = osu_mods.getString().find("ht") != -1;
-	m_bModHD = osu_mods.getString().find("hd") != -1;
-	m_bModHR = osu_mods.getString().find("hr") != -1;
-	m_bModEZ = osu_mods.getString().find("ez") != -1;
-	m_bModSD = osu_mods.getString().find("sd") != -1;
-	m_bModSS = osu_mods.getString().find("ss") != -1;
-	m_bModNM = osu_mods.getString().find("nm") != -1;
+	UString error;
+	if (!OsuMods::parse(osu_mods.getString(), &m_iMods, &error))
+		debugLog("Osu::updateMods() Warning: %s, ignoring the rest\n", error.toUtf8());
 
 	// static overrides
 	onSpeedChange("", osu_speed_override.getString());
 	onPitchChange("", osu_pitch_override.getString());
 
 	// autopilot overrides auto
-	if (m_bModAutopilot)
-		m_bModAuto = false;
+	if (m_iMods & OsuMods::AUTOPILOT)
+		m_iMods &= ~OsuMods::AUTO;
 
 	// handle auto/pilot cursor visibility
-	if (!m_bModAuto && !m_bModAutopilot)
+	if (!getModAuto() && !getModAutopilot())
 	{
 		env->setCursorVisible(false);
 		m_bShouldCursorBeVisible = false;
@@ -656,7 +737,10 @@ void Osu::onKeyDown(KeyboardEvent &key)
 
 			// quick save/load
 			if (key == (KEYCODE)OsuKeyBindings::QUICK_SAVE.getInt())
+			{
 				m_fQuickSaveTime = getSelectedBeatmap()->getPercentFinished();
+				getSelectedBeatmap()->addCheckpoint(); // so that quick load restores the score from exactly this point
+			}
 			if (key == (KEYCODE)OsuKeyBindings::QUICK_LOAD.getInt())
 				getSelectedBeatmap()->seekPercent(m_fQuickSaveTime);
 		}
@@ -875,7 +959,7 @@ void Osu::onPlayStart()
 {
 	debugLog("Osu::onPlayStart()\n");
 
-	if (m_bModAuto || m_bModAutopilot)
+	if (getModAuto() || getModAutopilot())
 	{
 		env->setCursorVisible(true);
 		m_bShouldCursorBeVisible = true;
@@ -895,6 +979,27 @@ void Osu::onPlayEnd(bool quit)
 
 	if (!quit)
 	{
+		// local scores, neither autoplay/relax/autopilot nor practice plays (seeking, quick load) count
+		OsuBeatmap *beatmap = getSelectedBeatmap();
+		if (osu_scores_enabled.getBool() && !getModAuto() && !getModRelax() && !getModAutopilot() && beatmap != NULL && !beatmap->isPracticePlay() && beatmap->getSelectedDifficulty() != NULL && beatmap->getSelectedDifficulty()->hasMD5())
+		{
+			OsuScoreDatabase::SCORE score;
+			memcpy(score.md5, beatmap->getSelectedDifficulty()->getMD5(), 16);
+			score.mods = m_iMods;
+			score.num300s = m_score->getNum300s();
+			score.num100s = m_score->getNum100s();
+			score.num50s = m_score->getNum50s();
+			score.numMisses = m_score->getNumMisses();
+			score.comboMax = m_score->getComboMax();
+			score.score = (unsigned long long)m_score->getScore();
+			score.accuracy = m_score->getAccuracy();
+			score.unstableRate = m_score->getUnstableRate();
+			score.timestamp = (unsigned long long)std::time(NULL);
+			score.replayOffset = -1;
+
+			m_songBrowser2->getDatabase()->getScoreDatabase()->addScore(score);
+		}
+
 		if (!osu_mod_endless.getBool())
 		{
 			m_rankingScreen->setScore(m_score);
@@ -936,61 +1041,22 @@ OsuBeatmap *Osu::getSelectedBeatmap()
 
 float Osu::getDifficultyMultiplier()
 {
-	float difficultyMultiplier = 1.0f;
-
-	if (m_bModHR)
-		difficultyMultiplier = 1.4f;
-	if (m_bModEZ)
-		difficultyMultiplier = 0.5f;
-
-	return difficultyMultiplier;
+	return OsuMods::getDifficultyMultiplier(m_iMods);
 }
 
 float Osu::getCSDifficultyMultiplier()
 {
-	float difficultyMultiplier = 1.0f;
-
-	if (m_bModHR)
-		difficultyMultiplier = 1.3f; // different!
-	if (m_bModEZ)
-		difficultyMultiplier = 0.5f;
-
-	return difficultyMultiplier;
+	return OsuMods::getCSDifficultyMultiplier(m_iMods);
 }
 
 float Osu::getScoreMultiplier()
 {
-	float multiplier = 1.0f;
-
-	if (m_bModEZ)
-		multiplier *= 0.5f;
-	if (m_bModHT)
-		multiplier *= 0.3f;
-	if (m_bModHR)
-		multiplier *= 1.06f;
-	if (m_bModDT || m_bModNC)
-		multiplier *= 1.12f;
-	if (m_bModHD)
-		multiplier *= 1.06f;
-	if (m_bModSpunout)
-		multiplier *= 0.9f;
-
-	return multiplier;
+	return OsuMods::getScoreMultiplier(m_iMods);
 }
 
 float Osu::getRawSpeedMultiplier()
 {
-	float speedMultiplier = 1.0f;
-
-	if (m_bModDT || m_bModNC || m_bModHT)
-	{
-		if (m_bModDT || m_bModNC)
-			speedMultiplier = 1.5f;
-		else
-			speedMultiplier = 0.75f;
-	}
-
-	return speedMultiplier;
+	return OsuMods::getSpeedMultiplier(m_iMods);
 }
 
 float Osu::getSpeedMultiplier()
@@ -1005,10 +1071,7 @@ float Osu::getSpeedMultiplier()
 
 float Osu::getPitchMultiplier()
 {
-	float pitchMultiplier = 1.0f;
-
-	if (m_bModNC)
-		pitchMultiplier = 1.1166f;
+	float pitchMultiplier = OsuMods::getPitchMultiplier(m_iMods);
 
 	if (osu_pitch_override.getFloat() > 0.0f)
 		return osu_pitch_override.getFloat();
@@ -1143,10 +1206,256 @@ void Osu::onSkinReload()
 	onSkinChange("", osu_skin.getString());
 }
 
+void Osu::onHitObjectBenchmark()
+{
+	// drawable hitobjects need a beatmap (and its skin), but it doesn't have to be playing
+	if (getSelectedBeatmap() == NULL)
+	{
+		debugLog("osu_hitobject_benchmark: Select a beatmap first!\n");
+		return;
+	}
+
+	OsuHitObjectFactory::benchmark(getSelectedBeatmap(), 10000);
+}
+
+void Osu::onDifficultySnapshotTest()
+{
+	if (getSelectedBeatmap() == NULL)
+	{
+		debugLog("osu_difficulty_snapshot_test: Select a beatmap first!\n");
+		return;
+	}
+
+	OsuGameRules::testDifficultySnapshot(getSelectedBeatmap());
+}
+
+void Osu::onCheckpointTest()
+{
+	// the plays are simulated on the selected beatmap (with a synthetic diff)
+	if (getSelectedBeatmap() == NULL)
+	{
+		debugLog("osu_checkpoint_test: Select a beatmap first!\n");
+		return;
+	}
+
+	OsuGameplayCheckpoints::test(getSelectedBeatmap());
+}
+
+void Osu::onFollowPointsTest()
+{
+	// the synthetic map needs a beatmap (and its skin), but it doesn't have to be playing
+	if (getSelectedBeatmap() == NULL)
+	{
+		debugLog("osu_followpoints_test: Select a beatmap first!\n");
+		return;
+	}
+
+	OsuFollowPoints::test(getSelectedBeatmap(), 5000);
+}
+
+void Osu::onDrawStatsBenchmark()
+{
+	// same as osu_followpoints_test, the synthetic map is drawn with the skin and settings of the selected beatmap
+	if (getSelectedBeatmap() == NULL)
+	{
+		debugLog("osu_drawstats_benchmark: Select a beatmap first!\n");
+		return;
+	}
+
+	OsuRecordingGraphics::benchmark(getSelectedBeatmap());
+}
+
+void Osu::onSliderRasterizerTest()
+{
+	// the slider curves need a beatmap
+	if (getSelectedBeatmap() == NULL)
+	{
+		debugLog("osu_slider_rasterizer_test: Select a beatmap first!\n");
+		return;
+	}
+
+	OsuSliderRasterizer::test(getSelectedBeatmap());
+}
+
+void Osu::onSpriteBatchTest()
+{
+	// only needs the skin images, no beatmap
+	if (m_skin == NULL)
+	{
+		debugLog("osu_spritebatch_test: No skin loaded!\n");
+		return;
+	}
+
+	OsuSpriteBatch::test(this);
+}
+
+void Osu::onAutoCursorTest()
+{
+	// the synthetic map needs a beatmap, but it doesn't have to be playing
+	if (getSelectedBeatmap() == NULL)
+	{
+		debugLog("osu_autocursor_test: Select a beatmap first!\n");
+		return;
+	}
+
+	OsuAutoCursorPath::test(getSelectedBeatmap(), 10000);
+}
+
+void Osu::onSongFolderTest()
+{
+	// works on its own temporary songs folder, the real library isn't touched
+	OsuSongFolderWatcher::test(this, 20000);
+}
+
+void Osu::onRandomTest()
+{
+	OsuRandomBeatmapSelector::test();
+}
+
+void Osu::onProfilerTest()
+{
+	OsuProfiler::test();
+}
+
+void Osu::onProfilerExport(UString oldValue, UString args)
+{
+	UString filePath = args.trim();
+	if (filePath.length() < 1)
+		filePath = "profiler_trace.json";
+
+	if (!OsuProfiler::isEnabled())
+		debugLog("Warning: osu_profiler is off, only zones from before it was turned off can be exported\n");
+
+	if (OsuProfiler::exportChromeTrace(filePath))
+		m_notificationOverlay->addNotification(UString::format("Exported profiler trace to %s", filePath.toUtf8()));
+}
+
+void Osu::onSkinIniTest()
+{
+	OsuSkinIni::test();
+}
+
+void Osu::onTextureAtlasTest()
+{
+	OsuTextureAtlas::test();
+}
+
+void Osu::onLoadSchedulerTest()
+{
+	OsuLoadScheduler::test();
+}
+
+void Osu::onBeatmapEventsTest()
+{
+	OsuBeatmapEvents::test();
+}
+
+void Osu::onHitSoundSchedulerTest()
+{
+	OsuHitSoundScheduler::test();
+}
+
+void Osu::onTimingAnalyticsTest()
+{
+	OsuTimingAnalytics::test();
+}
+
+void Osu::onCollectionDatabaseTest()
+{
+	OsuCollectionDatabase::test();
+}
+
+void Osu::onScoreDatabaseTest()
+{
+	OsuScoreDatabase::test();
+}
+
+void Osu::onDifficultyBenchmark()
+{
+	OsuDifficultyCalculator::test();
+}
+
+void Osu::onSliderEventsTest()
+{
+	OsuBeatmapDifficulty::test();
+}
+
+void Osu::onSliderCurveTest()
+{
+	OsuSliderCurve::test();
+}
+
+void Osu::onModsTest()
+{
+	OsuMods::test();
+}
+
+void Osu::onMD5Test()
+{
+	OsuMD5::test();
+}
+
+void Osu::onCollectionAdd(UString oldValue, UString args)
+{
+	onCollectionEdit(args.trim(), true);
+}
+
+void Osu::onCollectionRemove(UString oldValue, UString args)
+{
+	onCollectionEdit(args.trim(), false);
+}
+
+void Osu::onCollectionEdit(UString collectionName, bool add)
+{
+	if (collectionName.length() < 1)
+	{
+		debugLog("Error: Missing collection name! (Usage: e.g. \"%s favourites\")\n", add ? "osu_collection_add" : "osu_collection_remove");
+		return;
+	}
+
+	OsuBeatmap *beatmap = getSelectedBeatmap();
+	if (beatmap == NULL || beatmap->getSelectedDifficulty() == NULL || !beatmap->getSelectedDifficulty()->hasMD5())
+	{
+		debugLog("Error: Select a beatmap first!\n");
+		return;
+	}
+
+	OsuBeatmapDatabase *db = m_songBrowser2->getDatabase();
+	if (!db->canEditCollections())
+	{
+		m_notificationOverlay->addNotification("Error: collection.db couldn't be loaded, not touching it.", 0xffff0000);
+		return;
+	}
+
+	OsuCollectionDatabase *collectionDatabase = db->getCollectionDatabase();
+	const UString md5hash = beatmap->getSelectedDifficulty()->getMD5Hash();
+
+	bool changed = false;
+	if (add)
+		changed = collectionDatabase->add(collectionDatabase->addCollection(collectionName), md5hash);
+	else
+		changed = collectionDatabase->remove(collectionDatabase->findCollection(collectionName), md5hash);
+
+	if (!changed)
+	{
+		m_notificationOverlay->addNotification(add ? "Already in this collection." : "Not in this collection.");
+		return;
+	}
+
+	if (db->saveCollections())
+		m_notificationOverlay->addNotification(UString::format(add ? "Added to %s." : "Removed from %s.", collectionName.toUtf8()), 0xff00ff00);
+	else
+		m_notificationOverlay->addNotification("Error: Couldn't save collection.db", 0xffff0000);
+
+	db->rebuildCollections();
+	m_songBrowser2->rebuildCollectionButtons();
+}
+
 void Osu::onSkinChange(UString oldValue, UString newValue)
 {
 	if (newValue.length() > 1)
 	{
+		m_hitSoundScheduler->clear(); // nothing may play the old skin's sounds anymore
 		SAFE_DELETE(m_skin);
 
 		UString skinFolder = m_osu_folder_ref->getString();
@@ -11,6 +11,8 @@
 #include "App.h"
 #include "MouseListener.h"
 
+#include "OsuMods.h"
+
 class CWindowManager;
 
 class OsuMainMenu;
@@ -26,6 +28,8 @@ class OsuScreen;
 class OsuScore;
 class OsuSkin;
 class OsuHUD;
+class OsuLoadScheduler;
+class OsuHitSoundScheduler;
 
 class ConVar;
 class Image;
@@ -101,6 +105,8 @@ public:
 	inline OsuModSelector *getModSelector() {return m_modSelector;}
 	inline OsuRankingScreen *getRankingScreen() {return m_rankingScreen;}
 	inline OsuScore *getScore() {return m_score;}
+	inline OsuLoadScheduler *getLoadScheduler() {return m_loadScheduler;}
+	inline OsuHitSoundScheduler *getHitSoundScheduler() {return m_hitSoundScheduler;}
 
 	inline RenderTarget *getFrameBuffer() {return m_frameBuffer;}
 	inline McFont *getTitleFont() {return m_titleFont;}
@@ -115,20 +121,21 @@ public:
 	float getSpeedMultiplier();		// with override
 	float getPitchMultiplier();
 
-	inline bool getModAuto() {return m_bModAuto;}
-	inline bool getModAutopilot() {return m_bModAutopilot;}
-	inline bool getModRelax() {return m_bModRelax;}
-	inline bool getModSpunout() {return m_bModSpunout;}
-	inline bool getModTarget() {return m_bModTarget;}
-	inline bool getModDT() {return m_bModDT;}
-	inline bool getModNC() {return m_bModNC;}
-	inline bool getModHT() {return m_bModHT;}
-	inline bool getModHD() {return m_bModHD;}
-	inline bool getModHR() {return m_bModHR;}
-	inline bool getModEZ() {return m_bModEZ;}
-	inline bool getModSD() {return m_bModSD;}
-	inline bool getModSS() {return m_bModSS;}
-	inline bool getModNM() {return m_bModNM;}
+	inline unsigned int getMods() const {return m_iMods;} // bitmask of OsuMods::MOD (compatible with OsuReplay::Mods)
+	inline bool getModAuto() const {return m_iMods & OsuMods::AUTO;}
+	inline bool getModAutopilot() const {return m_iMods & OsuMods::AUTOPILOT;}
+	inline bool getModRelax() const {return m_iMods & OsuMods::RELAX;}
+	inline bool getModSpunout() const {return m_iMods & OsuMods::SPUNOUT;}
+	inline bool getModTarget() const {return m_iMods & OsuMods::TARGET;}
+	inline bool getModDT() const {return m_iMods & OsuMods::DT;}
+	inline bool getModNC() const {return m_iMods & OsuMods::NC;}
+	inline bool getModHT() const {return m_iMods & OsuMods::HT;}
+	inline bool getModHD() const {return m_iMods & OsuMods::HD;}
+	inline bool getModHR() const {return m_iMods & OsuMods::HR;}
+	inline bool getModEZ() const {return m_iMods & OsuMods::EZ;}
+	inline bool getModSD() const {return m_iMods & OsuMods::SD;}
+	inline bool getModSS() const {return m_iMods & OsuMods::SS;}
+	inline bool getModNM() const {return m_iMods & OsuMods::NM;}
 
 	bool isInPlayMode();
 	inline bool isSeeking() {return m_bSeeking;}
@@ -144,8 +151,36 @@ private:
 
 	// callbacks
 	void onInternalResolutionChanged(UString oldValue, UString args);
+	void onCollectionAdd(UString oldValue, UString args);
+	void onCollectionRemove(UString oldValue, UString args);
+	void onCollectionEdit(UString collectionName, bool add);
 
 	void onSkinReload();
+	void onHitObjectBenchmark();
+	void onDifficultySnapshotTest();
+	void onCheckpointTest();
+	void onFollowPointsTest();
+	void onDrawStatsBenchmark();
+	void onSliderRasterizerTest();
+	void onSpriteBatchTest();
+	void onAutoCursorTest();
+	void onSongFolderTest();
+	void onRandomTest();
+	void onProfilerTest();
+	void onProfilerExport(UString oldValue, UString args);
+	void onSkinIniTest();
+	void onTextureAtlasTest();
+	void onLoadSchedulerTest();
+	void onBeatmapEventsTest();
+	void onHitSoundSchedulerTest();
+	void onTimingAnalyticsTest();
+	void onCollectionDatabaseTest();
+	void onScoreDatabaseTest();
+	void onDifficultyBenchmark();
+	void onSliderEventsTest();
+	void onSliderCurveTest();
+	void onModsTest();
+	void onMD5Test();
 	void onSkinChange(UString oldValue, UString newValue);
 
 	void onMasterVolumeChange(UString oldValue, UString newValue);
@@ -165,6 +200,7 @@ private:
 	ConVar *m_osu_folder_ref;
 	ConVar *m_osu_draw_hud_ref;
 	ConVar *m_osu_mod_fps_ref;
+	ConVar *m_osu_profiler_overlay_ref;
 
 	// interfaces
 	OsuMainMenu *m_mainMenu;
@@ -178,6 +214,8 @@ private:
 	OsuTooltipOverlay *m_tooltipOverlay;
 	OsuNotificationOverlay *m_notificationOverlay;
 	OsuScore *m_score;
+	OsuLoadScheduler *m_loadScheduler;
+	OsuHitSoundScheduler *m_hitSoundScheduler;
 
 	std::vector<OsuScreen*> m_screens;
 
@@ -187,20 +225,7 @@ private:
 	Vector2 m_vInternalResolution;
 
 	// mods
-	bool m_bModAuto;
-	bool m_bModAutopilot;
-	bool m_bModRelax;
-	bool m_bModSpunout;
-	bool m_bModTarget;
-	bool m_bModDT;
-	bool m_bModNC;
-	bool m_bModHT;
-	bool m_bModHD;
-	bool m_bModHR;
-	bool m_bModEZ;
-	bool m_bModSD;
-	bool m_bModSS;
-	bool m_bModNM;
+	unsigned int m_iMods;
 
 	// keys
 	bool m_bF1;
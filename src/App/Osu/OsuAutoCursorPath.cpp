@@ -0,0 +1,598 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		cursor path of the auto and autopilot mods
+//
+// $NoKeywords: $osuautocursor
+//===============================================================================//
+
+#include "OsuAutoCursorPath.h"
+
+#include "Engine.h"
+#include "ConVar.h"
+#include "Timer.h"
+
+#include "Osu.h"
+#include "OsuBeatmap.h"
+#include "OsuBeatmapDifficulty.h"
+#include "OsuHitObjectFactory.h"
+#include "OsuGameRules.h"
+
+#include "OsuHitObject.h"
+#include "OsuSlider.h"
+
+#include <algorithm>
+#include <limits>
+
+ConVar osu_auto_snapping_strength("osu_auto_snapping_strength", 1.0f, "How many iterations of quadratic interpolation to use, more = snappier, 0 = linear");
+ConVar osu_auto_cursordance("osu_auto_cursordance", false);
+ConVar osu_autopilot_snapping_strength("osu_autopilot_snapping_strength", 2.0f, "How many iterations of quadratic interpolation to use, more = snappier, 0 = linear");
+ConVar osu_autopilot_lenience("osu_autopilot_lenience", 0.75f);
+
+OsuAutoCursorPath::OsuAutoCursorPath(OsuBeatmap *beatmap)
+{
+	m_beatmap = beatmap;
+	m_osu_early_note_time_ref = convar->getConVarByName("osu_early_note_time");
+
+	m_iCursor = 0;
+	m_iAutopilotCursor = 0;
+	m_iLastMusicPos = 0;
+	m_iDanceIndex = 0;
+}
+
+void OsuAutoCursorPath::build(const OsuHitObjectFactory *factory)
+{
+	m_segments.clear();
+	reset();
+
+	const int numObjects = factory->getNumObjects();
+
+	// which objects are relevant only changes when an object starts (time <= curMusicPos), or when one with a duration ends (curMusicPos > time + duration)
+	std::vector<long> startTimes;
+	std::vector<long> changeTimes;
+	std::vector<long> maxEndTimes; // of all objects with a duration up to and including this index
+	long maxEndTime = std::numeric_limits<long>::min();
+	for (int i=0; i<numObjects; i++)
+	{
+		const long time = factory->getTime(i);
+		const long duration = factory->getDuration(i);
+
+		startTimes.push_back(time);
+		changeTimes.push_back(time);
+		if (duration > 0)
+		{
+			changeTimes.push_back(time + duration + 1);
+			maxEndTime = std::max(maxEndTime, time + duration);
+		}
+		maxEndTimes.push_back(maxEndTime);
+	}
+	std::sort(changeTimes.begin(), changeTimes.end());
+	changeTimes.erase(std::unique(changeTimes.begin(), changeTimes.end()), changeTimes.end());
+
+	// before the first object
+	SEGMENT segment;
+	segment.startTime = std::numeric_limits<long>::min();
+	segment.prevIndex = -1;
+	segment.holdIndex = -1;
+	segment.nextIndex = (numObjects > 0 ? 0 : -1);
+	m_segments.push_back(segment);
+
+	for (int i=0; i<changeTimes.size(); i++)
+	{
+		const long time = changeTimes[i];
+
+		// all objects before numStarted have started (the objects are sorted by time)
+		const int numStarted = std::upper_bound(startTimes.begin(), startTimes.end(), time) - startTimes.begin();
+
+		// the old per-frame scan stopped at the first started object which was still active, which is the first index where the running maximum of the end times reaches the current time
+		const int firstActive = std::lower_bound(maxEndTimes.begin(), maxEndTimes.end(), time) - maxEndTimes.begin();
+
+		segment.startTime = time;
+		segment.prevIndex = numStarted - 1;
+		segment.holdIndex = (firstActive < numStarted ? firstActive : -1);
+		segment.nextIndex = (numStarted < numObjects ? numStarted : -1);
+
+		const SEGMENT &last = m_segments.back();
+		if (last.prevIndex != segment.prevIndex || last.holdIndex != segment.holdIndex || last.nextIndex != segment.nextIndex)
+			m_segments.push_back(segment);
+	}
+}
+
+void OsuAutoCursorPath::reset()
+{
+	m_iCursor = 0;
+	m_iAutopilotCursor = 0;
+	m_iLastMusicPos = 0;
+}
+
+Vector2 OsuAutoCursorPath::getCursorPos(const std::vector<OsuHitObject*> &hitobjects, long curMusicPos, const OsuMods::SNAPSHOT &mods)
+{
+	const Vector2 playfieldCenter = m_beatmap->getPlayfieldCenter();
+	if (hitobjects.size() == 0)
+		return playfieldCenter;
+
+	TARGETS targets;
+	targets.prevTime = 0;
+	targets.nextTime = hitobjects[0]->getTime();
+	targets.prevPos = playfieldCenter;
+	targets.curPos = playfieldCenter;
+	targets.nextPos = playfieldCenter;
+	targets.nextPosIndex = 0;
+	targets.haveCurPos = false;
+
+	if (m_beatmap->isWaiting())
+		targets.prevTime = -(long)m_osu_early_note_time_ref->getInt();
+
+	if (curMusicPos >= 0)
+	{
+		targets.prevPos = hitobjects[0]->getAutoCursorPos(0);
+		targets.curPos = targets.prevPos;
+		targets.nextPos = targets.prevPos;
+	}
+
+	if (mods.has(OsuMods::AUTO))
+		getAutoTargets(hitobjects, curMusicPos, &targets);
+	else if (mods.has(OsuMods::AUTOPILOT))
+		getAutopilotTargets(hitobjects, curMusicPos, &targets);
+
+	m_iLastMusicPos = curMusicPos;
+
+	return interpolate(targets, curMusicPos, mods);
+}
+
+int OsuAutoCursorPath::findSegment(long curMusicPos)
+{
+	if (m_iCursor >= m_segments.size() || m_segments[m_iCursor].startTime > curMusicPos) // seeked back
+		m_iCursor = 0;
+
+	// usually the same or the next segment
+	int numSteps = 0;
+	while (m_iCursor+1 < m_segments.size() && m_segments[m_iCursor+1].startTime <= curMusicPos && numSteps < MAX_LINEAR_STEPS)
+	{
+		m_iCursor++;
+		numSteps++;
+	}
+
+	// seeked (far) forwards, or back
+	if (m_iCursor+1 < m_segments.size() && m_segments[m_iCursor+1].startTime <= curMusicPos)
+	{
+		int low = m_iCursor+1;
+		int high = m_segments.size()-1;
+		while (low < high)
+		{
+			const int mid = low + (high - low + 1)/2;
+			if (m_segments[mid].startTime <= curMusicPos)
+				low = mid;
+			else
+				high = mid - 1;
+		}
+		m_iCursor = low;
+	}
+
+	return m_iCursor;
+}
+
+void OsuAutoCursorPath::getAutoTargets(const std::vector<OsuHitObject*> &hitobjects, long curMusicPos, TARGETS *targets)
+{
+	if (m_segments.size() == 0)
+		return;
+
+	const SEGMENT &segment = m_segments[findSegment(curMusicPos)];
+
+	// objects are created shortly before they are needed, the ones which have not been created yet don't exist for auto (same as before)
+	// (all objects which have already started always exist, since the factory is updated before)
+	const int numObjects = hitobjects.size();
+	const int prevIndex = std::min(segment.prevIndex, numObjects-1);
+	const int holdIndex = (segment.holdIndex < numObjects ? segment.holdIndex : -1);
+	const int nextIndex = (segment.nextIndex < numObjects ? segment.nextIndex : -1);
+
+	if (holdIndex >= 0)
+	{
+		OsuHitObject *o = hitobjects[holdIndex];
+		targets->prevTime = o->getTime() + o->getDuration();
+		targets->prevPos = o->getAutoCursorPos(curMusicPos);
+		targets->haveCurPos = true;
+		targets->curPos = targets->prevPos;
+		return;
+	}
+
+	if (prevIndex >= 0)
+	{
+		OsuHitObject *o = hitobjects[prevIndex];
+		targets->prevTime = o->getTime() + o->getDuration();
+		targets->prevPos = o->getAutoCursorPos(curMusicPos);
+	}
+
+	if (nextIndex >= 0)
+	{
+		OsuHitObject *o = hitobjects[nextIndex];
+		targets->nextPosIndex = nextIndex;
+		targets->nextPos = o->getAutoCursorPos(curMusicPos);
+		targets->nextTime = o->getTime();
+	}
+}
+
+void OsuAutoCursorPath::getAutopilotTargets(const std::vector<OsuHitObject*> &hitobjects, long curMusicPos, TARGETS *targets)
+{
+	const long lenience = (long)(OsuGameRules::getHitWindow50(m_beatmap)*osu_autopilot_lenience.getFloat());
+
+	// every object up until the first one which is neither finished nor past the lenience counts as previous, objects only ever become finished while playing forwards
+	if (curMusicPos < m_iLastMusicPos || m_iAutopilotCursor > hitobjects.size())
+		m_iAutopilotCursor = 0;
+	if (m_iAutopilotCursor > 0)
+	{
+		OsuHitObject *o = hitobjects[m_iAutopilotCursor-1];
+		if (!o->isFinished() && !(curMusicPos > o->getTime() + o->getDuration() + lenience))
+			m_iAutopilotCursor = 0;
+	}
+	while (m_iAutopilotCursor < hitobjects.size())
+	{
+		OsuHitObject *o = hitobjects[m_iAutopilotCursor];
+		if (!o->isFinished() && !(curMusicPos > o->getTime() + o->getDuration() + lenience))
+			break;
+
+		m_iAutopilotCursor++;
+	}
+
+	// get previous object
+	if (m_iAutopilotCursor > 0)
+	{
+		OsuHitObject *o = hitobjects[m_iAutopilotCursor-1];
+		targets->prevTime = o->getTime() + o->getDuration() + o->getAutopilotDelta();
+		targets->prevPos = o->getAutoCursorPos(curMusicPos);
+	}
+
+	// get next object
+	if (m_iAutopilotCursor < hitobjects.size())
+	{
+		OsuHitObject *o = hitobjects[m_iAutopilotCursor];
+		targets->nextPosIndex = m_iAutopilotCursor;
+		targets->nextPos = o->getAutoCursorPos(curMusicPos);
+		targets->nextTime = o->getTime();
+
+		// wait for the user to click
+		if (curMusicPos >= targets->nextTime + o->getDuration())
+		{
+			targets->haveCurPos = true;
+			targets->curPos = targets->nextPos;
+
+			o->setAutopilotDelta(curMusicPos - (targets->nextTime + o->getDuration()));
+		}
+		else if (o->getDuration() > 0 && curMusicPos >= targets->nextTime) // handle objects with duration
+		{
+			targets->haveCurPos = true;
+			targets->curPos = targets->nextPos;
+			o->setAutopilotDelta(0);
+		}
+	}
+}
+
+Vector2 OsuAutoCursorPath::interpolate(const TARGETS &targets, long curMusicPos, const OsuMods::SNAPSHOT &mods)
+{
+	if (targets.haveCurPos) // in active hitObject
+		return targets.curPos;
+
+	const Vector2 prevPos = targets.prevPos;
+	const Vector2 nextPos = targets.nextPos;
+
+	// interpolation
+	float percent = 1.0f;
+	if ((targets.nextTime == 0 && targets.prevTime == 0) || (targets.nextTime - targets.prevTime) == 0)
+		percent = 1.0f;
+	else
+		percent = (float)((long)curMusicPos - targets.prevTime) / (float)(targets.nextTime - targets.prevTime);
+
+	percent = clamp<float>(percent, 0.0f, 1.0f);
+
+	// scaled distance (not osucoords)
+	float distance = (nextPos-prevPos).length();
+	if (distance > m_beatmap->getHitcircleDiameter()*1.05f) // snap only if not in a stream (heuristic)
+	{
+		int numIterations = clamp<int>(mods.has(OsuMods::AUTOPILOT) ? osu_autopilot_snapping_strength.getInt() : osu_auto_snapping_strength.getInt(), 0, 42);
+		for (int i=0; i<numIterations; i++)
+		{
+			percent = (-percent)*(percent-2.0f);
+		}
+	}
+	else // in a stream
+	{
+		m_iDanceIndex = targets.nextPosIndex;
+	}
+
+	Vector2 cursorPos = prevPos + (nextPos - prevPos)*percent;
+
+	if (osu_auto_cursordance.getBool())
+	{
+		Vector3 dir = Vector3(nextPos.x, nextPos.y, 0) - Vector3(prevPos.x, prevPos.y, 0);
+		Vector3 center = dir*0.5f;
+		Matrix4 worldMatrix;
+		worldMatrix.translate(center);
+		worldMatrix.rotate((1.0f-percent) * 180.0f * (m_iDanceIndex % 2 == 0 ? 1 : -1), 0, 0, 1);
+		Vector3 fancyAutoCursorPos = worldMatrix*center;
+		cursorPos = prevPos + (nextPos-prevPos)*0.5f + Vector2(fancyAutoCursorPos.x, fancyAutoCursorPos.y);
+	}
+
+	return cursorPos;
+}
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+// the previous implementation (OsuBeatmap::updateAutoCursorPos() walking all objects from the beginning every frame), only used as a reference by the test below
+static Vector2 getAutoCursorPosReference(OsuBeatmap *beatmap, std::vector<OsuHitObject*> &hitobjects, long curMusicPos, const OsuMods::SNAPSHOT &mods, int *autoCursorDanceIndex)
+{
+	Vector2 autoCursorPos = beatmap->getPlayfieldCenter();
+
+	if (hitobjects.size() == 0)
+		return autoCursorPos;
+
+	long prevTime = 0;
+	long nextTime = hitobjects[0]->getTime();
+	Vector2 prevPos = beatmap->getPlayfieldCenter();
+	Vector2 curPos = beatmap->getPlayfieldCenter();
+	Vector2 nextPos = beatmap->getPlayfieldCenter();
+	int nextPosIndex = 0;
+	bool haveCurPos = false;
+
+	if (beatmap->isWaiting())
+		prevTime = -(long)convar->getConVarByName("osu_early_note_time")->getInt();
+
+	if (curMusicPos >= 0)
+	{
+		prevPos = hitobjects[0]->getAutoCursorPos(0);
+		curPos = prevPos;
+		nextPos = prevPos;
+	}
+
+	if (mods.has(OsuMods::AUTO))
+	{
+		for (int i=0; i<hitobjects.size(); i++)
+		{
+			OsuHitObject *o = hitobjects[i];
+
+			// get previous object
+			if (o->getTime() <= curMusicPos)
+			{
+				prevTime = o->getTime() + o->getDuration();
+				prevPos = o->getAutoCursorPos(curMusicPos);
+				if (o->getDuration() > 0 && curMusicPos - o->getTime() <= o->getDuration())
+				{
+					haveCurPos = true;
+					curPos = prevPos;
+					break;
+				}
+			}
+
+			// get next object
+			if (o->getTime() > curMusicPos)
+			{
+				nextPosIndex = i;
+				nextPos = o->getAutoCursorPos(curMusicPos);
+				nextTime = o->getTime();
+				break;
+			}
+		}
+	}
+	else if (mods.has(OsuMods::AUTOPILOT))
+	{
+		for (int i=0; i<hitobjects.size(); i++)
+		{
+			OsuHitObject *o = hitobjects[i];
+
+			// get previous object
+			if (o->isFinished() || (curMusicPos > o->getTime() + o->getDuration() + (long)(OsuGameRules::getHitWindow50(beatmap)*osu_autopilot_lenience.getFloat())))
+			{
+				prevTime = o->getTime() + o->getDuration() + o->getAutopilotDelta();
+				prevPos = o->getAutoCursorPos(curMusicPos);
+			}
+			else if (!o->isFinished()) // get next object
+			{
+				nextPosIndex = i;
+				nextPos = o->getAutoCursorPos(curMusicPos);
+				nextTime = o->getTime();
+
+				// wait for the user to click
+				if (curMusicPos >= nextTime + o->getDuration())
+				{
+					haveCurPos = true;
+					curPos = nextPos;
+
+					o->setAutopilotDelta(curMusicPos - (nextTime + o->getDuration()));
+				}
+				else if (o->getDuration() > 0 && curMusicPos >= nextTime) // handle objects with duration
+				{
+					haveCurPos = true;
+					curPos = nextPos;
+					o->setAutopilotDelta(0);
+				}
+
+				break;
+			}
+		}
+	}
+
+	if (haveCurPos) // in active hitObject
+		autoCursorPos = curPos;
+	else
+	{
+		// interpolation
+		float percent = 1.0f;
+		if ((nextTime == 0 && prevTime == 0) || (nextTime - prevTime) == 0)
+			percent = 1.0f;
+		else
+			percent = (float)((long)curMusicPos - prevTime) / (float)(nextTime - prevTime);
+
+		percent = clamp<float>(percent, 0.0f, 1.0f);
+
+		// scaled distance (not osucoords)
+		float distance = (nextPos-prevPos).length();
+		if (distance > beatmap->getHitcircleDiameter()*1.05f) // snap only if not in a stream (heuristic)
+		{
+			int numIterations = clamp<int>(mods.has(OsuMods::AUTOPILOT) ? osu_autopilot_snapping_strength.getInt() : osu_auto_snapping_strength.getInt(), 0, 42);
+			for (int i=0; i<numIterations; i++)
+			{
+				percent = (-percent)*(percent-2.0f);
+			}
+		}
+		else // in a stream
+		{
+			*autoCursorDanceIndex = nextPosIndex;
+		}
+
+		autoCursorPos = prevPos + (nextPos - prevPos)*percent;
+
+		if (osu_auto_cursordance.getBool())
+		{
+			Vector3 dir = Vector3(nextPos.x, nextPos.y, 0) - Vector3(prevPos.x, prevPos.y, 0);
+			Vector3 center = dir*0.5f;
+			Matrix4 worldMatrix;
+			worldMatrix.translate(center);
+			worldMatrix.rotate((1.0f-percent) * 180.0f * (*autoCursorDanceIndex % 2 == 0 ? 1 : -1), 0, 0, 1);
+			Vector3 fancyAutoCursorPos = worldMatrix*center;
+			autoCursorPos = prevPos + (nextPos-prevPos)*0.5f + Vector2(fancyAutoCursorPos.x, fancyAutoCursorPos.y);
+		}
+	}
+
+	return autoCursorPos;
+}
+
+void OsuAutoCursorPath::test(OsuBeatmap *beatmap, int numObjects)
+{
+	beatmap->updateDifficulty();
+
+	// synthetic map: jumps, streams, (overlapping) sliders and spinners, so that every kind of segment is hit
+	OsuBeatmapDifficulty diff(NULL, "", "");
+	diff.stackLeniency = 0.7f;
+	long time = 1000;
+	for (int i=0; i<numObjects; i++)
+	{
+		if (i % 500 == 499)
+		{
+			OsuBeatmapDifficulty::SPINNER s;
+			s.x = 256;
+			s.y = 192;
+			s.time = time;
+			s.sampleType = 0;
+			s.endTime = time + 2000;
+			diff.spinners.push_back(s);
+
+			time += 3000;
+		}
+		else if (i % 10 == 9)
+		{
+			OsuBeatmapDifficulty::SLIDER s;
+			s.type = OsuSlider::SLIDER_LINEAR;
+			s.repeat = 1 + (i % 2);
+			s.pixelLength = 150.0f;
+			s.time = time;
+			s.sampleType = 0;
+			s.number = (i % 8) + 1;
+			s.colorCounter = i / 8;
+			s.points.push_back(Vector2(64 + (i % 3)*150, 64 + (i % 4)*80));
+			s.points.push_back(Vector2(214 + (i % 3)*150, 64 + (i % 4)*80));
+			OsuBeatmapDifficulty::calculateSliderEvents(&s, 500.0f, 500.0f, 2.5f, 1.0f);
+			for (int r=0; r<s.repeat+1; r++)
+			{
+				s.hitSounds.push_back(0);
+			}
+			diff.sliders.push_back(s);
+
+			// every other slider is overlapped by the next objects
+			time += (i % 20 == 9 ? (long)s.sliderTime/2 : (long)s.sliderTime + 200);
+		}
+		else
+		{
+			// streams (same spot, 75ms) and jumps (across the playfield, 150ms)
+			const bool stream = (i % 40 < 16);
+			OsuBeatmapDifficulty::HITCIRCLE c;
+			c.x = (stream ? 256 + (i % 3)*4 : (i % 2 == 0 ? 32 + (i % 7)*8 : 480 - (i % 5)*8));
+			c.y = (stream ? 192 : 32 + (i % 11)*30);
+			c.time = time;
+			c.sampleType = 0;
+			c.number = (i % 8) + 1;
+			c.colorCounter = i / 8;
+			c.clicked = false;
+			diff.hitcircles.push_back(c);
+
+			time += (stream ? 75 : 150);
+		}
+	}
+
+	std::vector<OsuHitObject*> objects;
+	std::vector<OsuHitObject*> objectsSortedByEndTime;
+	OsuHitObjectFactory *factory = new OsuHitObjectFactory(beatmap, &diff, &objects, &objectsSortedByEndTime);
+	factory->createAll();
+
+	OsuAutoCursorPath path(beatmap);
+	path.build(factory);
+
+	// sample both mods at 60 fps with a few seeks back (no objects are ever finished here, so autopilot just follows the lenience)
+	const long lastTime = factory->getLastEndTime() + 1000;
+	int numSamples = 0;
+	int numMismatches = 0;
+	float maxDistance = 0.0f;
+	for (int m=0; m<2; m++)
+	{
+		const OsuMods::SNAPSHOT mods(m == 0 ? OsuMods::AUTO : OsuMods::AUTOPILOT);
+		int referenceDanceIndex = 0;
+		path.reset();
+		path.m_iDanceIndex = 0;
+		for (long curMusicPos=-2000; curMusicPos<lastTime; curMusicPos+=16)
+		{
+			long samplePos = curMusicPos;
+			if (curMusicPos % 10000 < 16 && curMusicPos > 20000)
+			{
+				samplePos = curMusicPos - 15000; // seek back, and forwards again in the next frame
+				for (int i=0; i<objects.size(); i++)
+				{
+					objects[i]->onReset(samplePos);
+				}
+				path.reset();
+			}
+
+			const Vector2 pos = path.getCursorPos(objects, samplePos, mods);
+			const Vector2 referencePos = getAutoCursorPosReference(beatmap, objects, samplePos, mods, &referenceDanceIndex);
+
+			numSamples++;
+			const float distance = (pos - referencePos).length();
+			maxDistance = std::max(maxDistance, distance);
+			if (distance > 0.001f || path.m_iDanceIndex != referenceDanceIndex)
+				numMismatches++;
+		}
+	}
+
+	// per-frame cost of a full playthrough with auto
+	const OsuMods::SNAPSHOT autoMods(OsuMods::AUTO);
+	int numFrames = 0;
+	int danceIndex = 0;
+	Timer t;
+	t.start();
+	for (long curMusicPos=0; curMusicPos<lastTime; curMusicPos+=16)
+	{
+		getAutoCursorPosReference(beatmap, objects, curMusicPos, autoMods, &danceIndex);
+		numFrames++;
+	}
+	t.update();
+	const double referenceTime = t.getElapsedTime();
+
+	path.reset();
+	t.start();
+	for (long curMusicPos=0; curMusicPos<lastTime; curMusicPos+=16)
+	{
+		path.getCursorPos(objects, curMusicPos, autoMods);
+	}
+	t.update();
+	const double pathTime = t.getElapsedTime();
+
+	debugLog("osu_autocursor_test: %i objects, %i segments, %i samples\n", numObjects, path.getNumSegments(), numSamples);
+	debugLog("osu_autocursor_test: %f ms per frame (scan), %f ms per frame (path)\n", (referenceTime*1000.0) / numFrames, (pathTime*1000.0) / numFrames);
+	debugLog("osu_autocursor_test: %s (%i mismatching samples, max distance %f)\n", numMismatches == 0 ? "PASSED" : "FAILED", numMismatches, maxDistance);
+
+	for (int i=0; i<objects.size(); i++)
+	{
+		delete objects[i];
+	}
+	delete factory;
+}
@@ -0,0 +1,76 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		cursor path of the auto and autopilot mods
+//
+// $NoKeywords: $osuautocursor
+//===============================================================================//
+
+#ifndef OSUAUTOCURSORPATH_H
+#define OSUAUTOCURSORPATH_H
+
+#include "cbase.h"
+
+#include "OsuMods.h"
+
+class OsuBeatmap;
+class OsuHitObjectFactory;
+class OsuHitObject;
+
+// for auto, the object(s) the cursor is on or moving between only depend on the object times, so the whole map is precomputed into segments
+// each frame then only evaluates the (one or two) objects of the current segment, instead of walking all objects from the beginning
+// autopilot depends on which objects are finished, so that only keeps an index which moves forwards with the objects
+class OsuAutoCursorPath
+{
+public:
+	OsuAutoCursorPath(OsuBeatmap *beatmap);
+
+	void build(const OsuHitObjectFactory *factory); // when loading
+	void reset(); // whenever the hitobjects have been reset (seeking, restoring a checkpoint)
+
+	// hitobjects are the (already created) objects of the factory which was used to build the path, curMusicPos includes the offsets
+	Vector2 getCursorPos(const std::vector<OsuHitObject*> &hitobjects, long curMusicPos, const OsuMods::SNAPSHOT &mods);
+
+	inline int getNumSegments() const {return m_segments.size();}
+
+	static void test(OsuBeatmap *beatmap, int numObjects); // against the previous per-frame scan at sampled times, + per-frame cost (osu_autocursor_test)
+
+private:
+	struct SEGMENT
+	{
+		long startTime; // valid until the startTime of the next segment
+		int prevIndex; // last object which has started (-1 if none)
+		int holdIndex; // object with a duration which the cursor stays on (-1 if moving between prevIndex and nextIndex)
+		int nextIndex; // first object which has not started yet (-1 if none)
+	};
+
+	struct TARGETS
+	{
+		long prevTime;
+		long nextTime;
+		Vector2 prevPos;
+		Vector2 curPos;
+		Vector2 nextPos;
+		int nextPosIndex;
+		bool haveCurPos;
+	};
+
+	static const int MAX_LINEAR_STEPS = 8; // forward jumps over more segments than this use a binary search
+
+	int findSegment(long curMusicPos);
+	void getAutoTargets(const std::vector<OsuHitObject*> &hitobjects, long curMusicPos, TARGETS *targets);
+	void getAutopilotTargets(const std::vector<OsuHitObject*> &hitobjects, long curMusicPos, TARGETS *targets);
+	Vector2 interpolate(const TARGETS &targets, long curMusicPos, const OsuMods::SNAPSHOT &mods);
+
+	OsuBeatmap *m_beatmap;
+	ConVar *m_osu_early_note_time_ref;
+
+	std::vector<SEGMENT> m_segments; // sorted by startTime, the first one starts at the beginning of time
+	int m_iCursor; // segment of the last frame
+
+	int m_iAutopilotCursor; // first object which is neither finished nor past the autopilot lenience
+	long m_iLastMusicPos;
+
+	int m_iDanceIndex; // osu_auto_cursordance direction, only changes in streams
+};
+
+#endif
@@ -26,6 +26,12 @@
 #include "OsuGameRules.h"
 #include "OsuNotificationOverlay.h"
 #include "OsuBeatmapDifficulty.h"
+#include "OsuHitObjectFactory.h"
+#include "OsuGameplayCheckpoints.h"
+#include "OsuFollowPoints.h"
+#include "OsuAutoCursorPath.h"
+#include "OsuSpriteBatch.h"
+#include "OsuProfiler.h"
 
 #include "OsuHitObject.h"
 #include "OsuCircle.h"
@@ -44,6 +50,8 @@ ConVar osu_draw_hitobjects("osu_draw_hitobjects", true);
 
 ConVar osu_global_offset("osu_global_offset", 0.0f);
 ConVar osu_interpolate_music_pos("osu_interpolate_music_pos", true, "Interpolate song position with engine time if the BASS audio library reports the same position more than once");
+ConVar osu_checkpoint_interval("osu_checkpoint_interval", 5.0f, "Seconds of music time between two gameplay checkpoints (seeking backwards restores the score from the newest one before the target), 0 = disabled");
+ConVar osu_checkpoint_count("osu_checkpoint_count", 128, "Maximum number of gameplay checkpoints kept while playing, the oldest ones are dropped first");
 ConVar osu_combobreak_sound_combo("osu_combobreak_sound_combo", 20, "Only play the combobreak sound if the combo is higher than this");
 
 ConVar osu_ar_override("osu_ar_override", -1.0f);
@@ -51,14 +59,6 @@ ConVar osu_cs_override("osu_cs_override", -1.0f);
 ConVar osu_hp_override("osu_hp_override", -1.0f);
 ConVar osu_od_override("osu_od_override", -1.0f);
 
-ConVar osu_auto_snapping_strength("osu_auto_snapping_strength", 1.0f, "How many iterations of quadratic interpolation to use, more = snappier, 0 = linear");
-ConVar osu_auto_cursordance("osu_auto_cursordance", false);
-ConVar osu_autopilot_snapping_strength("osu_autopilot_snapping_strength", 2.0f, "How many iterations of quadratic interpolation to use, more = snappier, 0 = linear");
-ConVar osu_autopilot_lenience("osu_autopilot_lenience", 0.75f);
-
-ConVar osu_followpoints_approachtime("osu_followpoints_approachtime", 800.0f);
-ConVar osu_followpoints_prevfadetime("osu_followpoints_prevfadetime", 200.0f);
-ConVar osu_followpoints_scale_multiplier("osu_followpoints_scale_multiplier", 1.0f);
 
 ConVar osu_number_scale_multiplier("osu_number_scale_multiplier", 1.0f);
 
@@ -101,6 +101,8 @@ ConVar osu_mod_timeshock("osu_mod_timeshock", false);
 ConVar osu_mod_timeshock_duration("osu_mod_timeshock_duration", 1.25f);
 ConVar osu_mod_timeshock_amount("osu_mod_timeshock_amount", 2.0f);
 
+ConVar osu_music_stream("osu_music_stream", true, "Stream the music from disk during gameplay instead of loading the whole file into memory before starting");
+
 ConVar osu_early_note_time("osu_early_note_time", 1000.0f, "Timeframe in ms at the beginning of a beatmap which triggers a starting delay for easier reading");
 ConVar osu_skip_time("osu_skip_time", 5000.0f, "Timeframe in ms within a beatmap which allows skipping if it doesn't contain any hitobjects");
 ConVar osu_stacking("osu_stacking", true, "Whether to use stacking calculations or not");
@@ -147,6 +149,12 @@ OsuBeatmap::OsuBeatmap(Osu *osu, UString filepath)
 	m_fSliderFollowCircleScale = 0.0f;
 	m_fSliderFollowCircleDiameter = 0.0f;
 	m_music = NULL;
+	m_hitobjectFactory = NULL;
+	m_followPoints = NULL;
+	m_autoCursorPath = NULL;
+	m_checkpoints = new OsuGameplayCheckpoints();
+	m_iCheckpointSeekTarget = -1;
+	m_bIsPracticePlay = false;
 
 	m_iCurMusicPos = 0;
 	m_iPrevCurMusicPos = 0;
@@ -158,9 +166,7 @@ OsuBeatmap::OsuBeatmap(Osu *osu, UString filepath)
 	m_bInBreak = false;
 	m_iNextHitObjectTime = 0;
 	m_iPreviousHitObjectTime = 0;
-	m_iPreviousFollowPointObjectIndex = -1;
 	m_fPlayfieldRotation = 0.0f;
-	m_iAutoCursorDanceIndex = 0;
 	m_fTimeshockTimer = 0.0f;
 	m_fTimeshockTime = 0.0f;
 	m_fTimeshockTimeLimit = 0.0f;
@@ -173,6 +179,16 @@ OsuBeatmap::OsuBeatmap(Osu *osu, UString filepath)
 	m_iND = 0;
 
 	m_bWasHREnabled = false;
+	m_mods = OsuMods::SNAPSHOT(m_osu->getMods());
+
+	memset(&m_difficultyInputs, 0, sizeof(DIFFICULTY_INPUTS));
+	m_constantDifficulty = OsuGameRules::getDifficultySnapshot(5.0f, 5.0f, 5.0f, 5.0f, 1.0f);
+	m_difficulty = m_constantDifficulty;
+	m_bDifficultyValid = false;
+
+	m_simulationScore = NULL;
+	m_simulationPrevDifficulty = NULL;
+	m_fSimulationFrameTime = 0.0f;
 }
 
 OsuBeatmap::~OsuBeatmap()
@@ -185,6 +201,8 @@ OsuBeatmap::~OsuBeatmap()
 		delete m_difficulties[i];
 	}
 	m_difficulties.clear();
+
+	SAFE_DELETE(m_checkpoints);
 }
 
 void OsuBeatmap::setDifficulties(std::vector<OsuBeatmapDifficulty*> diffs)
@@ -194,6 +212,8 @@ void OsuBeatmap::setDifficulties(std::vector<OsuBeatmapDifficulty*> diffs)
 
 void OsuBeatmap::draw(Graphics *g)
 {
+	OSU_PROFILER_ZONE("OsuBeatmap::draw");
+
 	if (!m_bIsPlaying && !m_bIsPaused && !m_bContinueScheduled && !m_bIsWaiting)
 		return;
 	if (m_selectedDifficulty == NULL || m_music == NULL) // sanity check
@@ -263,10 +283,14 @@ void OsuBeatmap::draw(Graphics *g)
 				m_hitobjectsSortedByEndTime[i]->draw(g);
 			}
 		}
+
+		// approach circles, followcircles and sliderbs are only quads, so consecutive ones with the same texture share one draw call
+		OsuSpriteBatch::getShared()->begin(g);
 		for (int i=m_hitobjectsSortedByEndTime.size()-1; i>=0; i--)
 		{
 			m_hitobjectsSortedByEndTime[i]->draw2(g);
 		}
+		OsuSpriteBatch::getShared()->end();
 	}
 
 	if (osu_mod_timeshock.getBool() && m_fTimeshockTimer > 0.0f)
@@ -316,112 +340,17 @@ void OsuBeatmap::draw(Graphics *g)
 
 void OsuBeatmap::drawFollowPoints(Graphics *g)
 {
-	OsuSkin *skin = m_osu->getSkin();
+	if (m_followPoints == NULL)
+		return;
 
 	const long curPos = m_iCurMusicPos + (long)osu_global_offset.getInt() - m_selectedDifficulty->localoffset;
-	const long approachTime = std::min((long)OsuGameRules::getApproachTime(this), (long)osu_followpoints_approachtime.getFloat());
-
-	// the followpoints are scaled by one eighth of the hitcirclediameter (not the raw diameter, but the scaled diameter)
-	const float followPointImageScale = ((m_fHitcircleDiameter/8.0f) / (16.0f * (skin->isFollowPoint2x() ? 2.0f : 1.0f))) * osu_followpoints_scale_multiplier.getFloat();
-
-	// include previous object in followpoints
-	int lastObjectIndex = -1;
-
-	for (int index=m_iPreviousFollowPointObjectIndex; index<m_hitobjects.size(); index++)
-	{
-		lastObjectIndex = index-1;
-
-		// ignore future spinners
-		OsuSpinner *spinnerPointer = dynamic_cast<OsuSpinner*>(m_hitobjects[index]);
-		if (spinnerPointer != NULL) // if this is a spinner
-		{
-			lastObjectIndex = -1;
-			continue;
-		}
-
-		// NOTE: "m_hitobjects[index]->getComboNumber() != 1" breaks (not literally) on new combos
-		if (lastObjectIndex >= 0 && m_hitobjects[index]->getComboNumber() != 1)
-		{
-			// ignore previous spinners
-			spinnerPointer = dynamic_cast<OsuSpinner*>(m_hitobjects[lastObjectIndex]);
-			if (spinnerPointer != NULL) // if this is a spinner
-			{
-				lastObjectIndex = -1;
-				continue;
-			}
-
-			// get time & pos of the last and current object
-			const long lastObjectEndTime = m_hitobjects[lastObjectIndex]->getTime() + m_hitobjects[lastObjectIndex]->getDuration() + 1;
-			const long objectStartTime = m_hitobjects[index]->getTime();
-			const long timeDiff = objectStartTime - lastObjectEndTime;
-
-			const Vector2 startPoint = osuCoords2Pixels(m_hitobjects[lastObjectIndex]->getRawPosAt(lastObjectEndTime));
-			const Vector2 endPoint = osuCoords2Pixels(m_hitobjects[index]->getRawPosAt(objectStartTime));
-
-			const float xDiff = endPoint.x - startPoint.x;
-			const float yDiff = endPoint.y - startPoint.y;
-			const Vector2 diff = endPoint - startPoint;
-			const float dist = std::round(diff.length() * 100.0f) / 100.0f; // rounded to avoid flicker with playfield rotations
-
-			// draw all points between the two objects
-			const int followPointSeparation = Osu::getUIScale(m_osu, 32);
-			for (int j=(int)(followPointSeparation * 1.5f); j<dist-followPointSeparation; j+=followPointSeparation)
-			{
-				const float animRatio = ((float)j / dist);
-
-				const Vector2 animPosStart = startPoint + (animRatio - 0.1f) * diff;
-				const Vector2 finalPos = startPoint + animRatio * diff;
-
-				const long fadeInTime = (long)(lastObjectEndTime + animRatio * timeDiff) - approachTime;
-				const long fadeOutTime = (long)(lastObjectEndTime + animRatio * timeDiff);
-
-				// draw
-				float alpha = 1.0f;
-				float followAnimPercent = clamp<float>((float)(curPos - fadeInTime)/(float)osu_followpoints_prevfadetime.getFloat(), 0.0f, 1.0f);
-				followAnimPercent = -followAnimPercent*(followAnimPercent-2); // quad out
-
-				const float scale = 1.5f - 0.5f*followAnimPercent;
-				const Vector2 followPos = animPosStart + (finalPos - animPosStart)*followAnimPercent;
-
-				// calculate trail alpha
-				if (curPos >= fadeInTime && curPos < fadeOutTime)
-				{
-					// future trail
-					const float delta = curPos - fadeInTime;
-					alpha = (float)delta / (float)approachTime;
-				}
-				else if (curPos >= fadeOutTime && curPos < fadeOutTime+(long)osu_followpoints_prevfadetime.getFloat())
-				{
-					// previous trail
-					const long delta = curPos - fadeOutTime;
-					alpha = 1.0f - (float)delta / (float)(osu_followpoints_prevfadetime.getFloat());
-				}
-				else
-					alpha = 0.0f;
-
-				// draw it
-				g->setColor(0xffffffff);
-				g->setAlpha(alpha);
-				g->pushTransform();
-					g->rotate(rad2deg(atan2(yDiff, xDiff)));
-					g->scale(followPointImageScale*scale, followPointImageScale*scale);
-					g->translate(followPos.x, followPos.y);
-					g->drawImage(skin->getFollowPoint());
-				g->popTransform();
-			}
-		}
-
-		// store current index as previous index
-		lastObjectIndex = index;
-
-		// iterate up until the "nextest" element
-		if (m_hitobjects[index]->getTime() >= curPos + approachTime)
-			break;
-	}
+	m_followPoints->draw(g, curPos);
 }
 
 void OsuBeatmap::update()
 {
+	OSU_PROFILER_ZONE("OsuBeatmap::update");
+
 	if (!m_bIsPlaying && !m_bIsPaused && !m_bContinueScheduled)
 		return;
 
@@ -484,7 +413,7 @@ void OsuBeatmap::update()
 	{
 		if (m_hitobjects.size() > 0 && m_iCurMusicPos > m_hitobjects[0]->getTime())
 		{
-			const float percentFinished = ((double)(m_iCurMusicPos - m_hitobjects[0]->getTime()) / (double)(m_hitobjects[m_hitobjects.size()-1]->getTime() + m_hitobjects[m_hitobjects.size()-1]->getDuration() - m_hitobjects[0]->getTime()));
+			const float percentFinished = ((double)(m_iCurMusicPos - m_hitobjects[0]->getTime()) / (double)(getLastHitObjectEndTime() - m_hitobjects[0]->getTime()));
 			const float speed = m_osu->getSpeedMultiplier() + percentFinished*m_osu->getSpeedMultiplier()*(osu_mod_timewarp_multiplier.getFloat()-1.0f);
 			m_music->setSpeed(speed);
 		}
@@ -528,7 +457,7 @@ void OsuBeatmap::update()
 	}
 
 	// handle music end
-	if ((m_music->isFinished() || (m_hitobjects.size() > 0 && m_hitobjects[m_hitobjects.size()-1]->getTime() + m_hitobjects[m_hitobjects.size()-1]->getDuration() + 1000 < m_iCurMusicPos)) && !m_bIsWaiting)
+	if ((m_music->isFinished() || (m_hitobjects.size() > 0 && getLastHitObjectEndTime() + 1000 < m_iCurMusicPos)) && !m_bIsWaiting)
 	{
 		stop(false);
 		return;
@@ -559,138 +488,15 @@ void OsuBeatmap::update()
 	else
 		m_fPlayfieldRotation = 0.0f;
 
-	// for performance reasons, a lot of operations are crammed into 1 loop over all hitobjects:
-	// update all hitobjects,
-	// handle click events,
-	// also get the time of the next/previous hitobject and their indices for later,
-	// and get the current hitobject,
-	// also handle miss hiterrorbar slots,
-	// also calculate nps and nd,
-	// also handle note blocking
 	OsuHitObject *currentHitObject = NULL;
-	m_iNextHitObjectTime = 0;
-	m_iPreviousHitObjectTime = 0;
-	m_iPreviousFollowPointObjectIndex = 0;
-	m_iNPS = 0;
-	m_iND = 0;
 	{
 		std::lock_guard<std::mutex> lk(m_clicksMutex); // we need to lock this up here, else it would be possible to insert a click just before calling m_clicks.clear(), thus missing it
 
-		long curPos = m_iCurMusicPos + (long)osu_global_offset.getInt() - m_selectedDifficulty->localoffset;
-		Vector2 cursorPos = getCursorPos();
-		bool blockNextNotes = false;
-		for (int i=0; i<m_hitobjects.size(); i++)
-		{
-			// the order must be like this:
-			// 1) main hitobject update
-			// 2) note blocking
-			// 3) click events
-			//
-			// (because the hitobjects need to know about note blocking before handling the click events)
-
-			// main hitobject update
-			m_hitobjects[i]->update(curPos);
-
-			// note blocking
-			if (osu_note_blocking.getBool())
-			{
-				m_hitobjects[i]->setBlocked(false);
-				if (blockNextNotes)
-					m_hitobjects[i]->setBlocked(true);
-				if (!m_hitobjects[i]->isFinished())
-				{
-					blockNextNotes = true;
-					if (dynamic_cast<OsuSlider*>(m_hitobjects[i]) != NULL) // sliders break the blocking chain (until the next circle)
-						blockNextNotes = false;
-				}
-			}
-
-			// click events
-			if (m_clicks.size() > 0)
-				m_hitobjects[i]->onClickEvent(cursorPos, m_clicks);
-
-
-
-			// used for auto later
-			if (m_iNextHitObjectTime == 0)
-			{
-				if (m_hitobjects[i]->getTime() > m_iCurMusicPos)
-					m_iNextHitObjectTime = (long)m_hitobjects[i]->getTime();
-				else
-				{
-					currentHitObject = m_hitobjects[i];
-					long actualPrevHitObjectTime = m_hitobjects[i]->getTime() + m_hitobjects[i]->getDuration();
-					m_iPreviousHitObjectTime = actualPrevHitObjectTime + 1000; // why is there +1000 here again? wtf
-
-					if (m_iCurMusicPos > actualPrevHitObjectTime+(long)osu_followpoints_prevfadetime.getFloat())
-						m_iPreviousFollowPointObjectIndex = i;
-				}
-			}
-
-			// notes per second
-			const long npsHalfGateSizeMS = (long)(500.0f * getSpeedMultiplier());
-			if (m_hitobjects[i]->getTime() > m_iCurMusicPos-npsHalfGateSizeMS && m_hitobjects[i]->getTime() < m_iCurMusicPos+npsHalfGateSizeMS)
-				m_iNPS++;
-
-			// note density
-			if (m_hitobjects[i]->isVisible())
-				m_iND++;
-		}
-
-		// miss hiterrorbar slots
-		// this gets the closest previous unfinished hitobject, as well as all following hitobjects which are in 50 range and could be clicked
-		if (osu_hiterrorbar_misaims.getBool())
-		{
-			m_misaimObjects.clear();
-			OsuHitObject *lastUnfinishedHitObject = NULL;
-			for (int i=0; i<m_hitobjects.size(); i++)
-			{
-				if (!m_hitobjects[i]->isFinished())
-				{
-					if (m_iCurMusicPos >= m_hitobjects[i]->getTime())
-						lastUnfinishedHitObject = m_hitobjects[i];
-					else if (std::abs(m_hitobjects[i]->getTime()-m_iCurMusicPos)  < (long)OsuGameRules::getHitWindow50(this))
-					{
-						m_misaimObjects.push_back(m_hitobjects[i]);
-					}
-					else
-						break;
-				}
-			}
-			if (lastUnfinishedHitObject != NULL && std::abs(lastUnfinishedHitObject->getTime()-m_iCurMusicPos)  < (long)OsuGameRules::getHitWindow50(this))
-				m_misaimObjects.insert(m_misaimObjects.begin(), lastUnfinishedHitObject);
-
-			// now, go through the remaining clicks, and go through the unfinished hitobjects.
-			// handle misaim clicks sequentially (setting the misaim flag on the hitobjects to only allow 1 entry in the hiterrorbar for misses per object)
-			// clicks don't have to be consumed here, as they are deleted below anyway
-			for (int c=0; c<m_clicks.size(); c++)
-			{
-				for (int i=0; i<m_misaimObjects.size(); i++)
-				{
-					if (m_misaimObjects[i]->hasMisAimed()) // only 1 slot per object!
-						continue;
-
-					m_misaimObjects[i]->misAimed();
-					long delta = (long)m_clicks[c].musicPos - (long)m_misaimObjects[i]->getTime();
-					m_osu->getHUD()->addHitError(delta, false, true);
-
-					break; // the current click has been dealt with (and the hitobject has been misaimed)
-				}
-			}
-		}
-
-		// all remaining clicks which have not been consumed by any hitobjects can safely be deleted
-		if (m_clicks.size() > 0)
-		{
-			// nightmare mod: extra klicks = sliderbreak
-			if ((m_osu->getModNM() || osu_mod_jigsaw1.getBool()) && !m_bIsInSkippableSection)
-				addSliderBreak();
-			m_clicks.clear();
-		}
+		currentHitObject = updateHitObjects(m_iCurMusicPos + (long)osu_global_offset.getInt() - m_selectedDifficulty->localoffset);
 	}
 
 	// update auto (after having updated the hitobjects)
-	if (m_osu->getModAuto() || m_osu->getModAutopilot())
+	if (m_mods.has(OsuMods::AUTO) || m_mods.has(OsuMods::AUTOPILOT))
 		updateAutoCursorPos();
 
 	// empty section detection & skipping
@@ -756,6 +562,145 @@ void OsuBeatmap::update()
 	m_iPrevCurMusicPos = m_iCurMusicPos;
 }
 
+OsuHitObject *OsuBeatmap::updateHitObjects(long curPos)
+{
+	// for performance reasons, a lot of operations are crammed into 1 loop over all hitobjects:
+	// update all hitobjects,
+	// handle click events,
+	// also get the time of the next/previous hitobject and their indices for later,
+	// and get the current hitobject,
+	// also handle miss hiterrorbar slots,
+	// also calculate nps and nd,
+	// also handle note blocking
+	OsuHitObject *currentHitObject = NULL;
+	m_iNextHitObjectTime = 0;
+	m_iPreviousHitObjectTime = 0;
+	m_iNPS = 0;
+	m_iND = 0;
+
+	Vector2 cursorPos = getCursorPos();
+	bool blockNextNotes = false;
+
+	if (m_hitobjectFactory != NULL)
+		m_hitobjectFactory->update(curPos);
+
+	for (int i=0; i<m_hitobjects.size(); i++)
+	{
+		// the order must be like this:
+		// 1) main hitobject update
+		// 2) note blocking
+		// 3) click events
+		//
+		// (because the hitobjects need to know about note blocking before handling the click events)
+
+		// main hitobject update
+		m_hitobjects[i]->update(curPos);
+
+		// note blocking
+		if (osu_note_blocking.getBool())
+		{
+			m_hitobjects[i]->setBlocked(false);
+			if (blockNextNotes)
+				m_hitobjects[i]->setBlocked(true);
+			if (!m_hitobjects[i]->isFinished())
+			{
+				blockNextNotes = true;
+				if (dynamic_cast<OsuSlider*>(m_hitobjects[i]) != NULL) // sliders break the blocking chain (until the next circle)
+					blockNextNotes = false;
+			}
+		}
+
+		// click events
+		if (m_clicks.size() > 0)
+			m_hitobjects[i]->onClickEvent(cursorPos, m_clicks);
+
+
+
+		// used for auto later
+		if (m_iNextHitObjectTime == 0)
+		{
+			if (m_hitobjects[i]->getTime() > m_iCurMusicPos)
+				m_iNextHitObjectTime = (long)m_hitobjects[i]->getTime();
+			else
+			{
+				currentHitObject = m_hitobjects[i];
+				long actualPrevHitObjectTime = m_hitobjects[i]->getTime() + m_hitobjects[i]->getDuration();
+				m_iPreviousHitObjectTime = actualPrevHitObjectTime + 1000; // why is there +1000 here again? wtf
+			}
+		}
+
+		// notes per second
+		const long npsHalfGateSizeMS = (long)(500.0f * getSpeedMultiplier());
+		if (m_hitobjects[i]->getTime() > m_iCurMusicPos-npsHalfGateSizeMS && m_hitobjects[i]->getTime() < m_iCurMusicPos+npsHalfGateSizeMS)
+			m_iNPS++;
+
+		// note density
+		if (m_hitobjects[i]->isVisible())
+			m_iND++;
+	}
+
+	// miss hiterrorbar slots
+	// this gets the closest previous unfinished hitobject, as well as all following hitobjects which are in 50 range and could be clicked
+	if (osu_hiterrorbar_misaims.getBool() && !isSimulating())
+	{
+		m_misaimObjects.clear();
+		OsuHitObject *lastUnfinishedHitObject = NULL;
+		for (int i=0; i<m_hitobjects.size(); i++)
+		{
+			if (!m_hitobjects[i]->isFinished())
+			{
+				if (m_iCurMusicPos >= m_hitobjects[i]->getTime())
+					lastUnfinishedHitObject = m_hitobjects[i];
+				else if (std::abs(m_hitobjects[i]->getTime()-m_iCurMusicPos)  < (long)OsuGameRules::getHitWindow50(this))
+				{
+					m_misaimObjects.push_back(m_hitobjects[i]);
+				}
+				else
+					break;
+			}
+		}
+		if (lastUnfinishedHitObject != NULL && std::abs(lastUnfinishedHitObject->getTime()-m_iCurMusicPos)  < (long)OsuGameRules::getHitWindow50(this))
+			m_misaimObjects.insert(m_misaimObjects.begin(), lastUnfinishedHitObject);
+
+		// now, go through the remaining clicks, and go through the unfinished hitobjects.
+		// handle misaim clicks sequentially (setting the misaim flag on the hitobjects to only allow 1 entry in the hiterrorbar for misses per object)
+		// clicks don't have to be consumed here, as they are deleted below anyway
+		for (int c=0; c<m_clicks.size(); c++)
+		{
+			for (int i=0; i<m_misaimObjects.size(); i++)
+			{
+				if (m_misaimObjects[i]->hasMisAimed()) // only 1 slot per object!
+					continue;
+
+				m_misaimObjects[i]->misAimed();
+				long delta = (long)m_clicks[c].musicPos - (long)m_misaimObjects[i]->getTime();
+				m_osu->getHUD()->addHitError(delta, false, true);
+
+				break; // the current click has been dealt with (and the hitobject has been misaimed)
+			}
+		}
+	}
+
+	// all remaining clicks which have not been consumed by any hitobjects can safely be deleted
+	if (m_clicks.size() > 0)
+	{
+		// nightmare mod: extra klicks = sliderbreak
+		if ((m_mods.has(OsuMods::NM) || osu_mod_jigsaw1.getBool()) && !m_bIsInSkippableSection)
+			addSliderBreak();
+		m_clicks.clear();
+	}
+
+	// periodic gameplay checkpoints, after everything in this frame has been judged
+	if (osu_checkpoint_interval.getFloat() > 0.0f && !m_bIsWaiting && m_iCurMusicPos >= 0)
+	{
+		const OsuGameplayCheckpoints::CHECKPOINT *newest = m_checkpoints->getNewest();
+		if (newest == NULL || m_iCurMusicPos >= newest->musicPos + (long)(osu_checkpoint_interval.getFloat()*1000.0f))
+			captureCheckpoint(curPos);
+	}
+
+	return currentHitObject;
+}
+
 void OsuBeatmap::skipEmptySection()
 {
 	if (!m_bIsInSkippableSection)
@@ -769,15 +714,17 @@ void OsuBeatmap::skipEmptySection()
 
 void OsuBeatmap::onUpdateMods()
 {
+	m_mods = OsuMods::SNAPSHOT(m_osu->getMods());
+
 	if (m_music != NULL)
 	{
 		m_music->setSpeed(m_osu->getSpeedMultiplier());
 		m_music->setPitch(m_osu->getPitchMultiplier());
 	}
 
-	if (m_osu->getModHR() != m_bWasHREnabled)
+	if (m_mods.has(OsuMods::HR) != m_bWasHREnabled)
 	{
-		m_bWasHREnabled = m_osu->getModHR();
+		m_bWasHREnabled = m_mods.has(OsuMods::HR);
 		calculateStacks();
 	}
 }
@@ -848,8 +795,8 @@ void OsuBeatmap::selectDifficulty(int index, bool deleteImage)
 		m_iSelectedDifficulty = index;
 		m_selectedDifficulty = m_difficulties[index];
 
-		// quick direct load, but may cause lag if quickly select()-ing
-		m_selectedDifficulty->loadBackgroundImage();
+		// ahead of any queued thumbnails
+		m_selectedDifficulty->loadBackgroundImage(true);
 
 		// need to recheck/reload the music here since this difficulty might be using a different sound file
 		loadMusic();
@@ -887,42 +834,33 @@ void OsuBeatmap::deselect(bool deleteImages)
 
 bool OsuBeatmap::play()
 {
+	OSU_PROFILER_ZONE("OsuBeatmap::play");
+
 	if (m_selectedDifficulty == NULL)
 		return false;
 
+	m_mods = OsuMods::SNAPSHOT(m_osu->getMods());
+
 	// reset everything, including deleting any previously loaded hitobjects from another diff which we might just have played
 	unloadHitObjects();
 	resetScore();
+	m_bIsPracticePlay = false;
 
-	// actually load the difficulty (and the hitobjects)
+	// actually load the difficulty (and the hitobject data)
 	if (!m_selectedDifficulty->loaded)
 	{
-		if (!m_selectedDifficulty->loadRaw(this, &m_hitobjects))
+		if (!m_selectedDifficulty->loadRaw(this))
 			return false;
-		else
-		{
-			// the drawing order is different from the playing/input order.
-			// for drawing, if multiple hitobjects occupy the same time (duration) then they get drawn on top of the active hitobject
-			m_hitobjectsSortedByEndTime = m_hitobjects;
-
-			// sort hitobjects by endtime
-			struct HitObjectSortComparator
-			{
-			    bool operator() (OsuHitObject const *a, OsuHitObject const *b) const
-			    {
-			        return (a->getTime() + a->getDuration()) < (b->getTime() + b->getDuration());
-			    }
-			};
-			std::sort(m_hitobjectsSortedByEndTime.begin(), m_hitobjectsSortedByEndTime.end(), HitObjectSortComparator());
-		}
 	}
 
-	calculateStacks();
-	updatePlayfieldMetrics();
+	m_bDifficultyValid = false;
+	updateDifficulty();
+
+	loadHitObjects();
 
 	// try to start the music so we can check if everything works (it is actually properly started again in the next update() by m_bIsWaiting)
 	unloadMusic(); // need to reload in case of speed/pitch changes (just to be sure)
-	loadMusic(false);
+	loadMusic(osu_music_stream.getBool());
 
 	m_music->setEnablePitchAndSpeedShiftingHack(true);
 	m_bIsPlaying = engine->getSound()->play(m_music);
@@ -960,6 +898,7 @@ void OsuBeatmap::actualRestart()
 	// reset everything
 	resetScore();
 	resetHitObjects(-1000);
+	m_bIsPracticePlay = false;
 
 	updatePlayfieldMetrics();
 
@@ -1027,7 +966,7 @@ void OsuBeatmap::pause(bool quitIfWaiting)
 	}
 	else if (m_bIsPaused && !m_bContinueScheduled)
 	{
-		if (m_osu->getModAuto() || m_osu->getModAutopilot() || m_bIsInSkippableSection)
+		if (m_mods.has(OsuMods::AUTO) || m_mods.has(OsuMods::AUTOPILOT) || m_bIsInSkippableSection)
 		{
 			engine->getSound()->play(m_music);
 			m_bIsPlaying = true;
@@ -1076,6 +1015,79 @@ void OsuBeatmap::fail()
 	stop();
 }
 
+bool OsuBeatmap::beginSimulation(OsuBeatmapDifficulty *diff, OsuScore *score)
+{
+	if (diff == NULL || score == NULL || isSimulating() || m_bIsPlaying || m_bIsPaused)
+		return false;
+
+	m_simulationScore = score;
+	m_simulationPrevDifficulty = m_selectedDifficulty;
+	m_selectedDifficulty = diff;
+	m_mods = OsuMods::SNAPSHOT(m_osu->getMods());
+
+	unloadHitObjects();
+	resetScore();
+	m_fHealth = 1.0f;
+	m_iCurMusicPos = 0;
+	m_bClick1Held = false;
+	m_bClick2Held = false;
+	m_clicks.clear();
+
+	m_bDifficultyValid = false;
+	updateDifficulty();
+	loadHitObjects();
+	updateHitobjectMetrics();
+
+	return true;
+}
+
+void OsuBeatmap::simulate(long curPos, float frameTime, Vector2 cursorPos, bool click1Held, bool click2Held)
+{
+	if (!isSimulating())
+		return;
+
+	m_iCurMusicPos = curPos;
+	m_fSimulationFrameTime = frameTime;
+	m_vSimulationCursorPos = cursorPos;
+
+	std::lock_guard<std::mutex> lk(m_clicksMutex);
+
+	// same as keyPressed1()/keyPressed2(), but without any offsets (curPos is already the hitobject time)
+	CLICK click;
+	click.musicPos = curPos;
+	click.realTime = 0.0;
+	if (click1Held && !m_bClick1Held)
+		m_clicks.push_back(click);
+	if (click2Held && !m_bClick2Held)
+		m_clicks.push_back(click);
+	m_bClick1Held = click1Held;
+	m_bClick2Held = click2Held;
+
+	updateHitObjects(curPos);
+}
+
+void OsuBeatmap::endSimulation()
+{
+	if (!isSimulating())
+		return;
+
+	unloadHitObjects();
+	m_checkpoints->clear(osu_checkpoint_count.getInt());
+	m_iCheckpointSeekTarget = -1;
+	m_iCurMusicPos = 0;
+	m_bClick1Held = false;
+	m_bClick2Held = false;
+	m_clicks.clear();
+
+	m_selectedDifficulty = m_simulationPrevDifficulty;
+	m_simulationPrevDifficulty = NULL;
+	m_simulationScore = NULL;
+	m_fHealth = 1.0f;
+
+	m_bDifficultyValid = false;
+	m_mods = OsuMods::SNAPSHOT(m_osu->getMods());
+}
+
 void OsuBeatmap::setVolume(float volume)
 {
 	if (m_music != NULL)
@@ -1099,6 +1111,11 @@ void OsuBeatmap::seekPercent(double percent)
 	if (m_selectedDifficulty == NULL || (!m_bIsPlaying && !m_bIsPaused) || m_music == NULL)
 		return;
 
+	m_bIsPracticePlay = true;
+
+	if (restoreCheckpoint((long)std::round(percent*(double)m_music->getLengthMS())))
+		return;
+
 	m_music->setPosition(percent);
 	resetHitObjects(m_music->getPositionMS());
 
@@ -1113,7 +1130,7 @@ void OsuBeatmap::seekPercentPlayable(double percent)
 
 	double actualPlayPercent = percent;
 	if (m_hitobjects.size() > 0)
-		actualPlayPercent = (((double)m_hitobjects[m_hitobjects.size()-1]->getTime() + (double)m_hitobjects[m_hitobjects.size()-1]->getDuration()) * percent) / (double)m_music->getLengthMS();
+		actualPlayPercent = ((double)getLastHitObjectEndTime() * percent) / (double)m_music->getLengthMS();
 
 	seekPercent(actualPlayPercent);
 }
@@ -1123,6 +1140,11 @@ void OsuBeatmap::seekMS(unsigned long ms)
 	if (m_selectedDifficulty == NULL || (!m_bIsPlaying && !m_bIsPaused) || m_music == NULL)
 		return;
 
+	m_bIsPracticePlay = true;
+
+	if (restoreCheckpoint((long)ms))
+		return;
+
 	m_music->setPositionMS(ms);
 	resetHitObjects(m_music->getPositionMS());
 
@@ -1159,7 +1181,7 @@ unsigned long OsuBeatmap::getLength()
 unsigned long OsuBeatmap::getLengthPlayable()
 {
 	if (m_hitobjects.size() > 0)
-		return (unsigned long)((m_hitobjects[m_hitobjects.size()-1]->getTime() + m_hitobjects[m_hitobjects.size()-1]->getDuration()) - m_hitobjects[0]->getTime());
+		return (unsigned long)(getLastHitObjectEndTime() - m_hitobjects[0]->getTime());
 	else
 		return getLength();
 }
@@ -1178,7 +1200,7 @@ float OsuBeatmap::getPercentFinishedPlayable()
 		return 1.0f - (m_fWaitTime - engine->getTimeReal())/(osu_early_note_time.getFloat()/1000.0f);
 
 	if (m_hitobjects.size() > 0)
-		return (float)m_iCurMusicPos / ((float)m_hitobjects[m_hitobjects.size()-1]->getTime() + (float)m_hitobjects[m_hitobjects.size()-1]->getDuration());
+		return (float)m_iCurMusicPos / (float)getLastHitObjectEndTime();
 	else
 		return (float)m_iCurMusicPos / (float)m_music->getLengthMS();
 }
@@ -1212,7 +1234,7 @@ float OsuBeatmap::getRawAR()
 	return clamp<float>(m_selectedDifficulty->AR * m_osu->getDifficultyMultiplier(), 0.0f, 10.0f);
 }
 
-float OsuBeatmap::getAR()
+float OsuBeatmap::getConstantAR()
 {
 	if (m_selectedDifficulty == NULL)
 		return 5.0f;
@@ -1221,9 +1243,19 @@ float OsuBeatmap::getAR()
 	if (osu_ar_override.getFloat() >= 0.0f)
 		AR = osu_ar_override.getFloat();
 
+	return AR;
+}
+
+float OsuBeatmap::getAR()
+{
+	if (m_selectedDifficulty == NULL)
+		return 5.0f;
+
+	float AR = getConstantAR();
+
 	if (osu_mod_artimewarp.getBool() && m_hitobjects.size() > 0)
 	{
-		float percent = 1.0f - ((double)(m_iCurMusicPos - m_hitobjects[0]->getTime()) / (double)(m_hitobjects[m_hitobjects.size()-1]->getTime() + m_hitobjects[m_hitobjects.size()-1]->getDuration() - m_hitobjects[0]->getTime()))*(1.0f - osu_mod_artimewarp_multiplier.getFloat());
+		float percent = 1.0f - ((double)(m_iCurMusicPos - m_hitobjects[0]->getTime()) / (double)(getLastHitObjectEndTime() - m_hitobjects[0]->getTime()))*(1.0f - osu_mod_artimewarp_multiplier.getFloat());
 		AR *= percent;
 	}
 
@@ -1233,25 +1265,31 @@ float OsuBeatmap::getAR()
 	return AR;
 }
 
+float OsuBeatmap::getConstantCS()
+{
+	if (m_selectedDifficulty == NULL)
+		return 5.0f;
+
+	if (osu_cs_override.getFloat() >= 0.0f)
+		return osu_cs_override.getFloat();
+
+	return clamp<float>(m_selectedDifficulty->CS * m_osu->getCSDifficultyMultiplier(), 0.0f, 10.0f);
+}
+
 float OsuBeatmap::getCS()
 {
 	if (m_selectedDifficulty == NULL)
 		return 5.0f;
 
-	float CS = clamp<float>(m_selectedDifficulty->CS * m_osu->getCSDifficultyMultiplier(), 0.0f, 10.0f);
+	float CS = getConstantCS();
 
-	if (osu_mod_minimize.getBool() && m_hitobjects.size() > 0)
+	// the override always wins
+	if (osu_mod_minimize.getBool() && osu_cs_override.getFloat() < 0.0f && m_hitobjects.size() > 0)
 	{
-		if (m_hitobjects.size() > 0)
-		{
-			float percent = 1.0f + ((double)(m_iCurMusicPos - m_hitobjects[0]->getTime()) / (double)(m_hitobjects[m_hitobjects.size()-1]->getTime() + m_hitobjects[m_hitobjects.size()-1]->getDuration() - m_hitobjects[0]->getTime()))*osu_mod_minimize_multiplier.getFloat();
-			CS *= percent;
-		}
+		float percent = 1.0f + ((double)(m_iCurMusicPos - m_hitobjects[0]->getTime()) / (double)(getLastHitObjectEndTime() - m_hitobjects[0]->getTime()))*osu_mod_minimize_multiplier.getFloat();
+		CS *= percent;
 	}
 
-	if (osu_cs_override.getFloat() >= 0.0f)
-		CS = osu_cs_override.getFloat();
-
 	return CS;
 }
 
@@ -1308,11 +1346,18 @@ void OsuBeatmap::consumeClickEvent()
 
 void OsuBeatmap::addHitResult(OsuScore::HIT hit, long delta, bool ignoreOnHitErrorBar, bool hitErrorBarOnly, bool ignoreCombo, bool ignoreScore)
 {
+	// simulations only judge (no restarts, fails, sounds or timeshock)
+	if (isSimulating())
+	{
+		m_simulationScore->addHitResult(this, hit, delta, ignoreOnHitErrorBar, hitErrorBarOnly, ignoreCombo, ignoreScore);
+		return;
+	}
+
 	if (m_fTimeshockTimer > 0.0f)
 		return;
 
 	// handle perfect & sudden death
-	if (m_osu->getModSS())
+	if (m_mods.has(OsuMods::SS))
 	{
 		if (hit != OsuScore::HIT::HIT_300 && hit != OsuScore::HIT::HIT_SLIDER10 && hit != OsuScore::HIT::HIT_SLIDER30 && !hitErrorBarOnly)
 		{
@@ -1320,7 +1365,7 @@ void OsuBeatmap::addHitResult(OsuScore::HIT hit, long delta, bool ignoreOnHitErr
 			return;
 		}
 	}
-	else if (m_osu->getModSD())
+	else if (m_mods.has(OsuMods::SD))
 	{
 		if (hit == OsuScore::HIT::HIT_MISS)
 		{
@@ -1351,13 +1396,19 @@ void OsuBeatmap::addHitResult(OsuScore::HIT hit, long delta, bool ignoreOnHitErr
 
 void OsuBeatmap::addSliderBreak()
 {
+	if (isSimulating())
+	{
+		m_simulationScore->addSliderBreak();
+		return;
+	}
+
 	// handle perfect & sudden death
-	if (m_osu->getModSS())
+	if (m_mods.has(OsuMods::SS))
 	{
 		restart();
 		return;
 	}
-	else if (m_osu->getModSD())
+	else if (m_mods.has(OsuMods::SD))
 	{
 		fail();
 		return;
@@ -1370,18 +1421,21 @@ void OsuBeatmap::addSliderBreak()
 
 void OsuBeatmap::addScorePoints(int points)
 {
-	m_osu->getScore()->addPoints(points);
+	getScore()->addPoints(points);
 }
 
 void OsuBeatmap::playMissSound()
 {
+	if (isSimulating())
+		return;
+
 	if (m_osu->getScore()->getCombo() > osu_combobreak_sound_combo.getInt())
 		engine->getSound()->play(getSkin()->getCombobreak());
 }
 
 Vector2 OsuBeatmap::osuCoords2Pixels(Vector2 coords)
 {
-	if (m_osu->getModHR() || osu_playfield_mirror_horizontal.getBool())
+	if (m_mods.has(OsuMods::HR) || osu_playfield_mirror_horizontal.getBool())
 		coords.y = OsuGameRules::OSU_COORD_HEIGHT - coords.y;
 	if (osu_playfield_mirror_vertical.getBool())
 		coords.x = OsuGameRules::OSU_COORD_WIDTH - coords.x;
@@ -1448,23 +1502,30 @@ Vector2 OsuBeatmap::osuCoords2Pixels(Vector2 coords)
 	{
 		// this is the worst hack possible (engine->isDrawing()), but it works
 		// the problem is that this same function is called while draw()ing and update()ing
-		if ((engine->isDrawing() && (m_osu->getModAuto() || m_osu->getModAutopilot())) || !(m_osu->getModAuto() || m_osu->getModAutopilot()))
-			coords += m_vPlayfieldCenter - (m_osu->getModAuto() || m_osu->getModAutopilot() ? m_vAutoCursorPos : engine->getMouse()->getPos());
+		if ((engine->isDrawing() && (m_mods.has(OsuMods::AUTO) || m_mods.has(OsuMods::AUTOPILOT))) || !(m_mods.has(OsuMods::AUTO) || m_mods.has(OsuMods::AUTOPILOT)))
+			coords += m_vPlayfieldCenter - (m_mods.has(OsuMods::AUTO) || m_mods.has(OsuMods::AUTOPILOT) ? m_vAutoCursorPos : engine->getMouse()->getPos());
 	}
 
 	return coords;
 }
 
+float OsuBeatmap::getFrameTime()
+{
+	return (isSimulating() ? m_fSimulationFrameTime : engine->getFrameTime());
+}
+
 Vector2 OsuBeatmap::getCursorPos()
 {
-	if (osu_mod_fps.getBool() && !m_bIsPaused)
+	if (isSimulating())
+		return m_vSimulationCursorPos;
+	else if (osu_mod_fps.getBool() && !m_bIsPaused)
 	{
-		if (m_osu->getModAuto() || m_osu->getModAutopilot())
+		if (m_mods.has(OsuMods::AUTO) || m_mods.has(OsuMods::AUTOPILOT))
 			return m_vAutoCursorPos;
 		else
 			return m_vPlayfieldCenter;
 	}
-	else if (m_osu->getModAuto() || m_osu->getModAutopilot())
+	else if (m_mods.has(OsuMods::AUTO) || m_mods.has(OsuMods::AUTOPILOT))
 		return m_vAutoCursorPos;
 	else
 	{
@@ -1498,6 +1559,8 @@ void OsuBeatmap::handlePreviewPlay()
 
 void OsuBeatmap::loadMusic(bool stream)
 {
+	OSU_PROFILER_ZONE("OsuBeatmap::loadMusic");
+
 	// load the song (again)
 	if (m_selectedDifficulty != NULL && (m_music == NULL || m_selectedDifficulty->fullSoundFilePath != m_music->getFilePath() || !m_music->isReady()))
 	{
@@ -1521,12 +1584,27 @@ void OsuBeatmap::unloadMusic()
 
 void OsuBeatmap::unloadDiffs()
 {
+	SAFE_DELETE(m_hitobjectFactory); // references the hitobject data of the diff, already created hitobjects stay valid
+
 	for (int i=0; i<m_difficulties.size(); i++)
 	{
 		m_difficulties[i]->unload();
 	}
 }
 
+void OsuBeatmap::loadHitObjects()
+{
+	// the hitobjects themselves are created by the factory, either all at once or shortly before they are needed (see update())
+	m_hitobjectFactory = new OsuHitObjectFactory(this, m_selectedDifficulty, &m_hitobjects, &m_hitobjectsSortedByEndTime);
+	m_hitobjectFactory->update(0);
+	m_followPoints = new OsuFollowPoints(this); // built by calculateStacks() below
+	m_autoCursorPath = new OsuAutoCursorPath(this);
+	m_autoCursorPath->build(m_hitobjectFactory); // only depends on the object times
+
+	calculateStacks();
+	updatePlayfieldMetrics();
+}
+
 void OsuBeatmap::unloadHitObjects()
 {
 	for (int i=0; i<m_hitobjects.size(); i++)
@@ -1535,160 +1613,140 @@ void OsuBeatmap::unloadHitObjects()
 	}
 	m_hitobjects = std::vector<OsuHitObject*>();
 	m_hitobjectsSortedByEndTime = std::vector<OsuHitObject*>();
+	SAFE_DELETE(m_hitobjectFactory);
+	SAFE_DELETE(m_followPoints);
+	SAFE_DELETE(m_autoCursorPath);
 }
 
 void OsuBeatmap::resetHitObjects(long curPos)
 {
+	if (m_hitobjectFactory != NULL)
+		m_hitobjectFactory->update(curPos); // e.g. when seeking, everything up until the new position must exist before being reset
+
 	for (int i=0; i<m_hitobjects.size(); i++)
 	{
 		m_hitobjects[i]->onReset(curPos);
 	}
-	m_osu->getHUD()->resetHitErrorBar();
+	if (m_autoCursorPath != NULL)
+		m_autoCursorPath->reset();
+	if (!isSimulating())
+		m_osu->getHUD()->resetHitErrorBar();
 }
 
-void OsuBeatmap::resetScore()
+long OsuBeatmap::getLastHitObjectEndTime()
 {
-	m_osu->getScore()->reset();
+	if (m_hitobjectFactory != NULL)
+		return m_hitobjectFactory->getLastEndTime();
+	else if (m_hitobjects.size() > 0)
+		return m_hitobjects[m_hitobjects.size()-1]->getTime() + m_hitobjects[m_hitobjects.size()-1]->getDuration();
+	else
+		return 0;
 }
 
-void OsuBeatmap::updateAutoCursorPos()
+void OsuBeatmap::resetScore()
 {
-	m_vAutoCursorPos = m_vPlayfieldCenter;
+	getScore()->reset();
 
-	if (!m_bIsPlaying && !m_bIsPaused)
-		return;
-	if (m_hitobjects.size() == 0)
-		return;
+	// the checkpoints only store the sizes of the hit result/delta vectors of the score, they can't be restored anymore after a reset
+	m_checkpoints->clear(osu_checkpoint_count.getInt());
+	m_iCheckpointSeekTarget = -1;
+}
 
-	long prevTime = 0;
-	long nextTime = m_hitobjects[0]->getTime();
-	Vector2 prevPos = m_vPlayfieldCenter;
-	Vector2 curPos = m_vPlayfieldCenter;
-	Vector2 nextPos = m_vPlayfieldCenter;
-	int nextPosIndex = 0;
-	bool haveCurPos = false;
+void OsuBeatmap::addCheckpoint()
+{
+	if (m_selectedDifficulty == NULL || (!m_bIsPlaying && !m_bIsPaused) || m_bIsWaiting || m_iCurMusicPos < 0)
+		return;
 
-	long curMusicPos = m_iCurMusicPos + (long)osu_global_offset.getInt() - m_selectedDifficulty->localoffset;
+	captureCheckpoint(m_iCurMusicPos + (long)osu_global_offset.getInt() - m_selectedDifficulty->localoffset);
+}
 
-	if (m_bIsWaiting)
-		prevTime = -(long)osu_early_note_time.getInt();
+void OsuBeatmap::captureCheckpoint(long curPos)
+{
+	fillCheckpoint(m_checkpoints->push(m_iCurMusicPos), curPos);
+}
 
-	if (curMusicPos >= 0)
-	{
-		prevPos = m_hitobjects[0]->getAutoCursorPos(0);
-		curPos = prevPos;
-		nextPos = prevPos;
-	}
+void OsuBeatmap::fillCheckpoint(OsuGameplayCheckpoints::CHECKPOINT *checkpoint, long curPos)
+{
+	checkpoint->musicPos = m_iCurMusicPos;
+	checkpoint->curPos = curPos;
+	checkpoint->score = getScore()->getSnapshot();
+	checkpoint->health = m_fHealth;
 
-	if (m_osu->getModAuto())
+	// objects which haven't been created yet can't have been judged either
+	checkpoint->setNumObjects(m_hitobjects.size());
+	checkpoint->progress.clear();
+	for (int i=0; i<m_hitobjects.size(); i++)
 	{
-		for (int i=0; i<m_hitobjects.size(); i++)
+		if (m_hitobjects[i]->isFinished())
+			checkpoint->setFinished(i);
+		else
 		{
-			OsuHitObject *o = m_hitobjects[i];
-
-			// get previous object
-			if (o->getTime() <= curMusicPos)
+			OsuHitObject::PROGRESS progress;
+			memset(&progress, 0, sizeof(OsuHitObject::PROGRESS)); // checkpoints can be compared with memcmp()
+			if (m_hitobjects[i]->getProgress(curPos, &progress))
 			{
-				prevTime = o->getTime() + o->getDuration();
-				prevPos = o->getAutoCursorPos(curMusicPos);
-				if (o->getDuration() > 0 && curMusicPos - o->getTime() <= o->getDuration())
-				{
-					haveCurPos = true;
-					curPos = prevPos;
-					break;
-				}
-			}
-
-			// get next object
-			if (o->getTime() > curMusicPos)
-			{
-				nextPosIndex = i;
-				nextPos = o->getAutoCursorPos(curMusicPos);
-				nextTime = o->getTime();
-				break;
+				progress.index = i;
+				checkpoint->progress.push_back(progress);
 			}
 		}
 	}
-	else if (m_osu->getModAutopilot())
-	{
-		for (int i=0; i<m_hitobjects.size(); i++)
-		{
-			OsuHitObject *o = m_hitobjects[i];
+}
 
-			// get previous object
-			if (o->isFinished() || (curMusicPos > o->getTime() + o->getDuration() + (long)(OsuGameRules::getHitWindow50(this)*osu_autopilot_lenience.getFloat())))
-			{
-				prevTime = o->getTime() + o->getDuration() + o->getAutopilotDelta();
-				prevPos = o->getAutoCursorPos(curMusicPos);
-			}
-			else if (!o->isFinished()) // get next object
-			{
-				nextPosIndex = i;
-				nextPos = o->getAutoCursorPos(curMusicPos);
-				nextTime = o->getTime();
+bool OsuBeatmap::restoreCheckpoint(long targetMS)
+{
+	// only backwards, the state after the current position is unknown (also covers repeated seeks to the same target while scrubbing, since the music then restarts before it)
+	if (targetMS > std::max(m_iCurMusicPos, m_iCheckpointSeekTarget))
+		return false;
 
-				// wait for the user to click
-				if (curMusicPos >= nextTime + o->getDuration())
-				{
-					haveCurPos = true;
-					curPos = nextPos;
+	const OsuGameplayCheckpoints::CHECKPOINT *checkpoint = m_checkpoints->findBefore(targetMS);
+	if (checkpoint == NULL)
+		return false;
 
-					//long delta = curMusicPos - (nextTime + o->getDuration());
-					o->setAutopilotDelta(curMusicPos - (nextTime + o->getDuration()));
-				}
-				else if (o->getDuration() > 0 && curMusicPos >= nextTime) // handle objects with duration
-				{
-					haveCurPos = true;
-					curPos = nextPos;
-					o->setAutopilotDelta(0);
-				}
+	// everything newer lies in the future now, and will be captured again while playing
+	m_checkpoints->truncate(checkpoint);
+	m_iCheckpointSeekTarget = targetMS;
 
-				break;
-			}
-		}
+	// there is no recorded input between the checkpoint and the target, so the only deterministic way forward is to play from the checkpoint itself
+	if (isSimulating())
+		m_iCurMusicPos = checkpoint->musicPos; // the caller continues simulating from there
+	else
+	{
+		m_music->setPositionMS(checkpoint->musicPos);
+		m_iLastMusicPosition = 0;
 	}
 
-	if (haveCurPos) // in active hitObject
-		m_vAutoCursorPos = curPos;
-	else
+	if (m_hitobjectFactory != NULL)
+		m_hitobjectFactory->update(checkpoint->curPos);
+
+	int nextProgress = 0;
+	for (int i=0; i<m_hitobjects.size(); i++)
 	{
-		// interpolation
-		float percent = 1.0f;
-		if ((nextTime == 0 && prevTime == 0) || (nextTime - prevTime) == 0)
-			percent = 1.0f;
-		else
-			percent = (float)((long)curMusicPos - prevTime) / (float)(nextTime - prevTime);
+		const OsuHitObject::PROGRESS *progress = NULL;
+		if (nextProgress < checkpoint->progress.size() && checkpoint->progress[nextProgress].index == i)
+			progress = &checkpoint->progress[nextProgress++];
 
-		percent = clamp<float>(percent, 0.0f, 1.0f);
+		m_hitobjects[i]->onRestore(checkpoint->curPos, checkpoint->isFinished(i), progress);
+	}
+	if (!isSimulating())
+		m_osu->getHUD()->resetHitErrorBar();
 
-		// scaled distance (not osucoords)
-		float distance = (nextPos-prevPos).length();
-		if (distance > m_fHitcircleDiameter*1.05f) // snap only if not in a stream (heuristic)
-		{
-			int numIterations = clamp<int>(m_osu->getModAutopilot() ? osu_autopilot_snapping_strength.getInt() : osu_auto_snapping_strength.getInt(), 0, 42);
-			for (int i=0; i<numIterations; i++)
-			{
-				percent = (-percent)*(percent-2.0f);
-			}
-		}
-		else // in a stream
-		{
-			m_iAutoCursorDanceIndex = nextPosIndex;
-		}
+	getScore()->restore(checkpoint->score);
+	m_fHealth = checkpoint->health;
 
-		m_vAutoCursorPos = prevPos + (nextPos - prevPos)*percent;
+	return true;
+}
 
-		if (osu_auto_cursordance.getBool())
-		{
-			Vector3 dir = Vector3(nextPos.x, nextPos.y, 0) - Vector3(prevPos.x, prevPos.y, 0);
-			Vector3 center = dir*0.5f;
-			Matrix4 worldMatrix;
-			worldMatrix.translate(center);
-			worldMatrix.rotate((1.0f-percent) * 180.0f * (m_iAutoCursorDanceIndex % 2 == 0 ? 1 : -1), 0, 0, 1);
-			Vector3 fancyAutoCursorPos = worldMatrix*center;
-			m_vAutoCursorPos = prevPos + (nextPos-prevPos)*0.5f + Vector2(fancyAutoCursorPos.x, fancyAutoCursorPos.y);
-		}
-	}
+void OsuBeatmap::updateAutoCursorPos()
+{
+	m_vAutoCursorPos = m_vPlayfieldCenter;
+
+	if (!m_bIsPlaying && !m_bIsPaused)
+		return;
+	if (m_hitobjects.size() == 0 || m_autoCursorPath == NULL)
+		return;
+
+	const long curMusicPos = m_iCurMusicPos + (long)osu_global_offset.getInt() - m_selectedDifficulty->localoffset;
+	m_vAutoCursorPos = m_autoCursorPath->getCursorPos(m_hitobjects, curMusicPos, m_mods);
 }
 
 void OsuBeatmap::updatePlayfieldMetrics()
@@ -1703,118 +1761,70 @@ void OsuBeatmap::updateHitobjectMetrics()
 {
 	OsuSkin *skin = m_osu->getSkin();
 
-	m_fRawHitcircleDiameter = OsuGameRules::getRawHitCircleDiameter(getCS());
+	updateDifficulty();
+
+	m_fRawHitcircleDiameter = m_difficulty.rawHitcircleDiameter;
 	m_fXMultiplier = OsuGameRules::getHitCircleXMultiplier(m_osu);
-	m_fHitcircleDiameter = OsuGameRules::getHitCircleDiameter(this);
+	m_fHitcircleDiameter = m_fRawHitcircleDiameter * m_fXMultiplier;
 
 	const float osuCoordScaleMultiplier = (m_fHitcircleDiameter/m_fRawHitcircleDiameter);
 
 	m_fNumberScale = (m_fRawHitcircleDiameter / (160.0f * (skin->isDefault12x() ? 2.0f : 1.0f))) * osuCoordScaleMultiplier * osu_number_scale_multiplier.getFloat();
 	m_fHitcircleOverlapScale = (m_fRawHitcircleDiameter / (160.0f)) * osuCoordScaleMultiplier * osu_number_scale_multiplier.getFloat();
 
-	m_fSliderFollowCircleDiameter = m_fHitcircleDiameter * (m_osu->getModNM() || osu_mod_jigsaw2.getBool() ? (1.0f*(1.0f - osu_mod_jigsaw_followcircle_radius_factor.getFloat()) + osu_mod_jigsaw_followcircle_radius_factor.getFloat()*2.4f) : 2.4f);
+	m_fSliderFollowCircleDiameter = m_fHitcircleDiameter * (m_mods.has(OsuMods::NM) || osu_mod_jigsaw2.getBool() ? (1.0f*(1.0f - osu_mod_jigsaw_followcircle_radius_factor.getFloat()) + osu_mod_jigsaw_followcircle_radius_factor.getFloat()*2.4f) : 2.4f);
 	m_fSliderFollowCircleScale = (m_fSliderFollowCircleDiameter / (259.0f * (skin->isSliderFollowCircle2x() ? 2.0f : 1.0f)))*0.85f; // this is a bit strange, but seems to work perfectly with 0.85
 }
 
-void OsuBeatmap::calculateStacks()
+void OsuBeatmap::updateDifficulty()
 {
-	if (!osu_stacking.getBool())
-		return;
-
-	updateHitobjectMetrics(); // needed for the calculations (for m_fRawHitcircleDiameter)
+	// the constant part is only rebuilt if anything it depends on has changed (mods, overrides, speed, experimental mods)
+	DIFFICULTY_INPUTS inputs;
+	memset(&inputs, 0, sizeof(DIFFICULTY_INPUTS)); // for memcmp()
+	inputs.AR = getConstantAR();
+	inputs.CS = getConstantCS();
+	inputs.OD = getOD();
+	inputs.HP = getHP();
+	inputs.speedMultiplier = getSpeedMultiplier();
+	inputs.millhiorefMultiplier = OsuGameRules::osu_mod_millhioref_multiplier.getFloat();
+	inputs.fadeOutTime = OsuGameRules::osu_hitobject_fade_out_time.getFloat();
+	inputs.fadeOutTimeSpeedMultiplierMin = OsuGameRules::osu_hitobject_fade_out_time_speed_multiplier_min.getFloat();
+	inputs.millhioref = OsuGameRules::osu_mod_millhioref.getBool();
+	inputs.ming3012 = OsuGameRules::osu_mod_ming3012.getBool();
 
-	debugLog("OsuBeatmap: Calculating stacks ...\n");
-
-	const float STACK_LENIENCE = 3.0f;
-	const float STACK_OFFSET = 0.05f;
-
-	// reset
-	for (int i=0; i<m_hitobjects.size(); i++)
+	if (!m_bDifficultyValid || memcmp(&inputs, &m_difficultyInputs, sizeof(DIFFICULTY_INPUTS)) != 0)
 	{
-		m_hitobjects[i]->setStack(0);
+		m_difficultyInputs = inputs;
+		m_constantDifficulty = OsuGameRules::getDifficultySnapshot(inputs.AR, inputs.CS, inputs.OD, inputs.HP, inputs.speedMultiplier);
+		m_bDifficultyValid = true;
 	}
 
-	// peppy's algorithm
-	// https://gist.github.com/peppy/1167470
-
-	for (int i=m_hitobjects.size()-1; i>=0; i--)
-	{
-		int n = i;
-
-		OsuHitObject *objectI = m_hitobjects[i];
-
-		bool isSpinner = dynamic_cast<OsuSpinner*>(objectI) != NULL;
-
-		if (objectI->getStack() != 0 || isSpinner)
-			continue;
-
-		bool isHitCircle = dynamic_cast<OsuCircle*>(objectI) != NULL;
-		bool isSlider = dynamic_cast<OsuSlider*>(objectI) != NULL;
-
-		if (isHitCircle)
-		{
-			while (--n >= 0)
-			{
-				OsuHitObject *objectN = m_hitobjects[n];
-
-				bool isSpinnerN = dynamic_cast<OsuSpinner*>(objectN);
-
-				if (isSpinnerN)
-					continue;
-
-				if (objectI->getTime() - (OsuGameRules::getApproachTime(this) * m_selectedDifficulty->stackLeniency) > (objectN->getTime() + objectN->getDuration()))
-					break;
-
-				Vector2 objectNEndPosition = objectN->getOriginalRawPosAt(objectN->getTime() + objectN->getDuration());
-				if (objectN->getDuration() != 0 && (objectNEndPosition - objectI->getOriginalRawPosAt(objectI->getTime())).length() < STACK_LENIENCE)
-				{
-					int offset = objectI->getStack() - objectN->getStack() + 1;
-					for (int j=n+1; j<=i; j++)
-					{
-						if ((objectNEndPosition - m_hitobjects[j]->getOriginalRawPosAt(m_hitobjects[j]->getTime())).length() < STACK_LENIENCE)
-							m_hitobjects[j]->setStack(m_hitobjects[j]->getStack() - offset);
-					}
-
-					break;
-				}
-
-				if ((objectN->getOriginalRawPosAt(objectN->getTime()) - objectI->getOriginalRawPosAt(objectI->getTime())).length() < STACK_LENIENCE)
-				{
-					objectN->setStack(objectI->getStack() + 1);
-					objectI = objectN;
-				}
-			}
-		}
-		else if (isSlider)
-		{
-			while (--n >= 0)
-			{
-				OsuHitObject *objectN = m_hitobjects[n];
+	// time-varying mods only patch the values which depend on them
+	m_difficulty = m_constantDifficulty;
+	if (osu_mod_artimewarp.getBool() || osu_mod_arwobble.getBool())
+		OsuGameRules::updateDifficultySnapshotAR(&m_difficulty, getAR());
+	if (osu_mod_minimize.getBool())
+		OsuGameRules::updateDifficultySnapshotCS(&m_difficulty, getCS());
+}
 
-				bool isSpinner = dynamic_cast<OsuSpinner*>(objectN) != NULL;
+void OsuBeatmap::calculateStacks()
+{
+	if (m_hitobjectFactory == NULL)
+		return;
 
-				if (isSpinner)
-					continue;
+	if (osu_stacking.getBool())
+	{
+		updateHitobjectMetrics(); // needed for the calculations (for m_fRawHitcircleDiameter)
 
-				if (objectI->getTime() - (OsuGameRules::getApproachTime(this) * m_selectedDifficulty->stackLeniency) > objectN->getTime())
-					break;
+		debugLog("OsuBeatmap: Calculating stacks ...\n");
 
-				if (((objectN->getDuration() != 0 ? objectN->getOriginalRawPosAt(objectN->getTime() + objectN->getDuration()) : objectN->getOriginalRawPosAt(objectN->getTime())) - objectI->getOriginalRawPosAt(objectI->getTime())).length() < STACK_LENIENCE)
-				{
-					objectN->setStack(objectI->getStack() + 1);
-					objectI = objectN;
-				}
-			}
-		}
+		// the stacks are calculated on the raw hitobject data, since not all hitobjects exist yet
+		m_hitobjectFactory->calculateStacks(m_difficulty.approachTime, m_difficulty.stackOffset);
 	}
 
-	// update hitobject positions
-	float stackOffset = m_fRawHitcircleDiameter * STACK_OFFSET;
-	for (int i=0; i<m_hitobjects.size(); i++)
-	{
-		if (m_hitobjects[i]->getStack() != 0)
-			m_hitobjects[i]->updateStackPosition(stackOffset);
-	}
+	// the followpoints connect the (stacked) positions
+	if (m_followPoints != NULL)
+		m_followPoints->build(m_hitobjectFactory);
 }
 
 unsigned long OsuBeatmap::getMusicPositionMSInterpolated()
@@ -10,6 +10,8 @@
 
 #include "cbase.h"
 #include "OsuScore.h"
+#include "OsuMods.h"
+#include "OsuDifficultySnapshot.h"
 
 #include <mutex>
 #include "WinMinGW.Mutex.h" // necessary due to incomplete implementation in mingw-w64
@@ -21,6 +23,10 @@ class Osu;
 class OsuSkin;
 class OsuHitObject;
 class OsuBeatmapDifficulty;
+class OsuHitObjectFactory;
+class OsuGameplayCheckpoints;
+class OsuFollowPoints;
+class OsuAutoCursorPath;
 
 class OsuBeatmap
 {
@@ -69,6 +75,15 @@ public:
 	void seekPercent(double percent);
 	void seekPercentPlayable(double percent);
 	void seekMS(unsigned long ms);
+	void addCheckpoint(); // e.g. on quick save, in addition to the periodic ones
+	inline bool isPracticePlay() const {return m_bIsPracticePlay;} // seeked or quick loaded since the play (or the last restart) began, such plays don't count for local scores
+
+	// headless simulation (tests/benchmarks): plays an already loaded diff without music, sounds or HUD, judgements go into the given score
+	bool beginSimulation(OsuBeatmapDifficulty *diff, OsuScore *score); // only while not playing, false otherwise
+	void simulate(long curPos, float frameTime, Vector2 cursorPos, bool click1Held, bool click2Held); // one frame, key presses are derived from the held states
+	void endSimulation(); // unloads the simulated hitobjects and restores the selected diff
+	inline bool isSimulating() const {return m_simulationScore != NULL;}
+	inline const std::vector<OsuHitObject*> &getHitObjects() const {return m_hitobjects;}
 
 	inline Sound *getMusic() const {return m_music;}
 	unsigned long getTime();
@@ -87,11 +102,18 @@ public:
 
 	// used by OsuHitObject children and OsuModSelector
 	inline Osu *getOsu() const {return m_osu;}
+	inline const OsuMods::SNAPSHOT &getMods() const {return m_mods;} // use this instead of m_osu->getModXX() during gameplay
+	inline const OsuDifficultySnapshot &getDifficulty() const {return m_difficulty;} // use this instead of OsuGameRules::getXXX(beatmap) during gameplay, updated once per frame
+	void updateDifficulty(); // called every frame, cheap if nothing changed
+	inline void updateMetrics() {updateHitobjectMetrics(); updatePlayfieldMetrics();} // also called every frame, but only while playing (e.g. for drawing hitobjects outside of gameplay)
 	OsuSkin *getSkin();
 	inline long getCurMusicPos() const {return m_iCurMusicPos;}
+	float getFrameTime(); // use this instead of engine->getFrameTime() in hitobject logic
 
 	float getRawAR();
+	float getConstantAR(); // without time-varying mods
 	float getAR();
+	float getConstantCS(); // without time-varying mods
 	float getCS();
 	float getHP();
 	float getRawOD();
@@ -150,10 +172,19 @@ private:
 	void loadMusic(bool stream = true);
 	void unloadMusic();
 	void unloadDiffs();
+	void loadHitObjects(); // factory, followpoints and auto cursor path for m_selectedDifficulty
 	void unloadHitObjects();
 	void resetHitObjects(long curPos = 0);
+	long getLastHitObjectEndTime(); // of all hitobjects, including the ones which have not been created yet
 	void resetScore();
 
+	void captureCheckpoint(long curPos);
+	void fillCheckpoint(OsuGameplayCheckpoints::CHECKPOINT *checkpoint, long curPos); // the current state, without pushing it
+	bool restoreCheckpoint(long targetMS); // for seeking backwards, false if there is no checkpoint before targetMS (the caller then resets everything as before)
+
+	OsuHitObject *updateHitObjects(long curPos); // judges/updates all hitobjects for one frame, returns the current one (if any), called with m_clicksMutex held
+	inline OsuScore *getScore() {return m_simulationScore != NULL ? m_simulationScore : m_osu->getScore();}
+
 	void updateAutoCursorPos();
 	void updatePlayfieldMetrics();
 	void updateHitobjectMetrics();
@@ -214,12 +245,10 @@ private:
 	float m_fHealth;
 	float m_fBreakBackgroundFade;
 	bool m_bInBreak;
-	int m_iPreviousFollowPointObjectIndex;
 	long m_iNextHitObjectTime;
 	long m_iPreviousHitObjectTime;
 	Vector2 m_vAutoCursorPos;
 	float m_fPlayfieldRotation;
-	int m_iAutoCursorDanceIndex;
 	float m_fTimeshockTimeLimit;
 	float m_fTimeshockTime;
 	float m_fTimeshockTimer;
@@ -229,9 +258,15 @@ private:
 	std::vector<CLICK> m_clicks;
 	std::mutex m_clicksMutex;
 
+	OsuHitObjectFactory *m_hitobjectFactory;
+	OsuFollowPoints *m_followPoints;
+	OsuAutoCursorPath *m_autoCursorPath;
 	std::vector<OsuHitObject*> m_hitobjects;
 	std::vector<OsuHitObject*> m_hitobjectsSortedByEndTime;
 	std::vector<OsuHitObject*> m_misaimObjects;
+	OsuGameplayCheckpoints *m_checkpoints;
+	long m_iCheckpointSeekTarget; // the last target which was seeked to by restoring a checkpoint (the music then plays from slightly before it)
+	bool m_bIsPracticePlay;
 
 	// statistics
 	int m_iNumMisses;
@@ -240,6 +275,34 @@ private:
 
 	// custom
 	bool m_bWasHREnabled; // dynamic stack recalculation
+	OsuMods::SNAPSHOT m_mods; // taken in play(), and whenever the mods change
+
+	// difficulty
+	struct DIFFICULTY_INPUTS // everything the constant part of the snapshot depends on
+	{
+		float AR;
+		float CS;
+		float OD;
+		float HP;
+		float speedMultiplier;
+		float millhiorefMultiplier;
+		float fadeOutTime;
+		float fadeOutTimeSpeedMultiplierMin;
+		bool millhioref;
+		bool ming3012;
+	};
+	DIFFICULTY_INPUTS m_difficultyInputs;
+	OsuDifficultySnapshot m_constantDifficulty; // only rebuilt if m_difficultyInputs change
+	OsuDifficultySnapshot m_difficulty; // m_constantDifficulty + time-varying mods
+	bool m_bDifficultyValid;
+
+	// simulation
+	OsuScore *m_simulationScore;
+	OsuBeatmapDifficulty *m_simulationPrevDifficulty;
+	Vector2 m_vSimulationCursorPos;
+	float m_fSimulationFrameTime;
+
+	friend class OsuGameplayCheckpoints;
 };
 
 #endif
@@ -17,6 +17,15 @@
 #include "OsuFile.h"
 #include "OsuBeatmap.h"
 #include "OsuBeatmapDifficulty.h"
+#include "OsuBeatmapEvents.h"
+#include "OsuDifficultyCache.h"
+#include "OsuScoreDatabase.h"
+#include "OsuCollectionDatabase.h"
+#include "OsuSongFolderWatcher.h"
+#include "OsuProfiler.h"
+
+#include <unordered_map>
+#include <unordered_set>
 
 #if defined(_WIN32) || defined(_WIN64) || defined(__WIN32__) || defined(__CYGWIN__) || defined(__CYGWIN32__) || defined(__TOS_WIN__) || defined(__WINDOWS__)
 
@@ -89,6 +98,13 @@ OsuBeatmapDatabase::OsuBeatmapDatabase(Osu *osu)
 	m_importTimer = new Timer();
 	m_bIsFirstLoad = true;
 	m_bFoundChanges = true;
+	m_difficultyCache = new OsuDifficultyCache();
+	m_scoreDatabase = new OsuScoreDatabase("scores.db");
+	if (!m_scoreDatabase->load())
+		debugLog("OsuBeatmapDatabase: Couldn't load scores.db, new scores won't be saved to not overwrite it\n");
+	m_collectionDatabase = new OsuCollectionDatabase();
+	m_bCollectionsEditable = false; // until collection.db has been looked at
+	OsuBeatmapEvents::load();
 
 	m_iNumBeatmapsToLoad = 0;
 	m_fLoadingProgress = 0.0f;
@@ -100,24 +116,24 @@ OsuBeatmapDatabase::OsuBeatmapDatabase(Osu *osu)
 
 	m_iCurRawBeatmapLoadIndex = 0;
 	m_bRawBeatmapLoadScheduled = false;
+	m_bIsRawLoaded = false;
+	m_songFolderWatcher = new OsuSongFolderWatcher();
 }
 
 OsuBeatmapDatabase::~OsuBeatmapDatabase()
 {
-	for (int i=0; i<m_beatmaps.size(); i++)
-	{
-		delete m_beatmaps[i];
-	}
+	deleteBeatmaps();
+
+	SAFE_DELETE(m_songFolderWatcher);
+	SAFE_DELETE(m_difficultyCache);
+	SAFE_DELETE(m_scoreDatabase);
+	SAFE_DELETE(m_collectionDatabase);
+	OsuBeatmapEvents::save();
 }
 
 void OsuBeatmapDatabase::reset()
 {
-	m_collections.clear();
-	for (int i=0; i<m_beatmaps.size(); i++)
-	{
-		delete m_beatmaps[i];
-	}
-	m_beatmaps.clear();
+	deleteBeatmaps();
 
 	m_bIsFirstLoad = true;
 	m_bFoundChanges = true;
@@ -127,6 +143,8 @@ void OsuBeatmapDatabase::reset()
 
 void OsuBeatmapDatabase::update()
 {
+	OSU_PROFILER_ZONE("OsuBeatmapDatabase::update");
+
 	// loadRaw() logic
 	if (m_bRawBeatmapLoadScheduled)
 	{
@@ -138,7 +156,6 @@ void OsuBeatmapDatabase::update()
 			if (m_rawLoadBeatmapFolders.size() > 0)
 			{
 				UString curBeatmap = m_rawLoadBeatmapFolders[m_iCurRawBeatmapLoadIndex++];
-				m_rawBeatmapFolders.push_back(curBeatmap); // for future incremental loads, so that we know what's been loaded already
 
 				UString fullBeatmapPath = m_sRawBeatmapLoadOsuSongFolder;
 				fullBeatmapPath.append(curBeatmap);
@@ -149,7 +166,11 @@ void OsuBeatmapDatabase::update()
 
 				// if successful, add it
 				if (bm != NULL)
+				{
 					m_beatmaps.push_back(bm);
+					m_addedBeatmaps.push_back(bm);
+					m_rawBeatmapsByFolder[std::string(curBeatmap.toUtf8())] = bm; // for future refresh()es, so that we know which beatmap a folder has been loaded into
+				}
 			}
 
 			// update progress
@@ -161,7 +182,13 @@ void OsuBeatmapDatabase::update()
 				m_rawLoadBeatmapFolders.clear();
 				m_bRawBeatmapLoadScheduled = false;
 				m_importTimer->update();
-				debugLog("Refresh finished, added %i beatmaps in %f seconds.\n", m_beatmaps.size(), m_importTimer->getElapsedTime());
+				debugLog("Refresh finished, added %i beatmaps in %f seconds.\n", m_addedBeatmaps.size(), m_importTimer->getElapsedTime());
+
+				// raw loaded diffs have md5 hashes too, so collections work without osu!.db
+				// (always rebuilt, the previous collections may still point to beatmaps which a refresh() has removed)
+				loadCollections();
+				rebuildCollections();
+
 				break;
 			}
 
@@ -178,8 +205,114 @@ void OsuBeatmapDatabase::load()
 	engine->getResourceManager()->loadResource(loader);
 }
 
+bool OsuBeatmapDatabase::refresh()
+{
+	OSU_PROFILER_ZONE("OsuBeatmapDatabase::refresh");
+
+	UString songFolder = osu_folder.getString();
+	songFolder.append("Songs/");
+
+	// osu!.db libraries are owned by osu!, which groups diffs by set id and not by folder, so those are always loaded completely
+	if (!m_bIsRawLoaded || m_bRawBeatmapLoadScheduled || !m_songFolderWatcher->hasSnapshot() || !(songFolder == m_sRawBeatmapLoadOsuSongFolder))
+		return false;
+
+	// the song browser has dropped the previous ones already
+	deleteRemovedBeatmaps();
+	m_addedBeatmaps.clear();
+
+	m_importTimer->start();
+	const OsuSongFolderWatcher::CHANGES changes = m_songFolderWatcher->getChanges();
+
+	// removed and modified folders lose their beatmaps, modified ones are then loaded again like new ones
+	std::vector<UString> detachedFolders = changes.removed;
+	detachedFolders.insert(detachedFolders.end(), changes.modified.begin(), changes.modified.end());
+	std::unordered_set<OsuBeatmap*> removedBeatmaps;
+	for (int i=0; i<detachedFolders.size(); i++)
+	{
+		std::unordered_map<std::string, OsuBeatmap*>::iterator it = m_rawBeatmapsByFolder.find(std::string(detachedFolders[i].toUtf8()));
+		if (it == m_rawBeatmapsByFolder.end())
+			continue; // e.g. a folder without any valid diffs
+
+		removedBeatmaps.insert(it->second);
+		m_removedBeatmaps.push_back(it->second);
+		m_rawBeatmapsByFolder.erase(it);
+	}
+	if (removedBeatmaps.size() > 0)
+	{
+		std::vector<OsuBeatmap*> remainingBeatmaps;
+		for (int i=0; i<m_beatmaps.size(); i++)
+		{
+			if (removedBeatmaps.find(m_beatmaps[i]) == removedBeatmaps.end())
+				remainingBeatmaps.push_back(m_beatmaps[i]);
+		}
+		m_beatmaps.swap(remainingBeatmaps);
+	}
+
+	m_rawLoadBeatmapFolders = changes.added;
+	m_rawLoadBeatmapFolders.insert(m_rawLoadBeatmapFolders.end(), changes.modified.begin(), changes.modified.end());
+	m_iNumBeatmapsToLoad = m_rawLoadBeatmapFolders.size();
+
+	debugLog("Database: Found %i new, %i changed and %i removed beatmap folders.\n", (int)changes.added.size(), (int)changes.modified.size(), (int)changes.removed.size());
+
+	m_bFoundChanges = (changes.added.size() > 0 || changes.modified.size() > 0 || changes.removed.size() > 0);
+	if (m_bFoundChanges)
+		m_osu->getNotificationOverlay()->addNotification(UString::format("Refreshing: %i new, %i changed, %i removed.", (int)changes.added.size(), (int)changes.modified.size(), (int)changes.removed.size()), 0xff00ff00);
+
+	// only start loading if we have something to load
+	if (m_rawLoadBeatmapFolders.size() > 0)
+	{
+		m_fLoadingProgress = 0.0f;
+		m_iCurRawBeatmapLoadIndex = 0;
+
+		m_bRawBeatmapLoadScheduled = true;
+	}
+	else
+	{
+		if (m_removedBeatmaps.size() > 0)
+			rebuildCollections();
+
+		m_fLoadingProgress = 1.0f;
+	}
+
+	return true;
+}
+
+void OsuBeatmapDatabase::deleteRemovedBeatmaps()
+{
+	if (m_removedBeatmaps.size() < 1)
+		return;
+
+	// pending background star calculations may belong to the removed diffs, so forget all of them and request the remaining ones again
+	m_difficultyCache->cancel();
+	for (int i=0; i<m_removedBeatmaps.size(); i++)
+	{
+		delete m_removedBeatmaps[i];
+	}
+	m_removedBeatmaps.clear();
+
+	for (int b=0; b<m_beatmaps.size(); b++)
+	{
+		std::vector<OsuBeatmapDifficulty*> *diffs = m_beatmaps[b]->getDifficultiesPointer();
+		for (int d=0; d<diffs->size(); d++)
+		{
+			if ((*diffs)[d]->starsNoMod <= 0.0f)
+				m_difficultyCache->request((*diffs)[d]);
+		}
+	}
+}
+
 void OsuBeatmapDatabase::cancel()
 {
+	// the folders which haven't been loaded yet will be picked up by the next refresh()
+	if (m_bRawBeatmapLoadScheduled)
+	{
+		for (int i=m_iCurRawBeatmapLoadIndex; i<m_rawLoadBeatmapFolders.size(); i++)
+		{
+			m_songFolderWatcher->forget(m_rawLoadBeatmapFolders[i]);
+		}
+		m_rawLoadBeatmapFolders.clear();
+	}
+
 	m_bRawBeatmapLoadScheduled = false;
 	m_fLoadingProgress = 1.0f; // force finished
 	m_bFoundChanges = true;
@@ -187,41 +320,20 @@ void OsuBeatmapDatabase::cancel()
 
 void OsuBeatmapDatabase::loadRaw()
 {
+	OSU_PROFILER_ZONE("OsuBeatmapDatabase::loadRaw");
+
+	// everything, incremental loads go through refresh() (the song browser has already dropped all of its buttons)
+	deleteBeatmaps();
+
 	m_sRawBeatmapLoadOsuSongFolder = osu_folder.getString();
 	m_sRawBeatmapLoadOsuSongFolder.append("Songs/");
 
-	m_rawLoadBeatmapFolders = env->getFoldersInFolder(m_sRawBeatmapLoadOsuSongFolder);
+	// the snapshot is the baseline for future refresh()es
+	m_songFolderWatcher->setFolder(m_sRawBeatmapLoadOsuSongFolder);
+	m_rawLoadBeatmapFolders = m_songFolderWatcher->snapshot();
 	m_iNumBeatmapsToLoad = m_rawLoadBeatmapFolders.size();
-
-	// if this isn't the first load, only load the differences
-	if (!m_bIsFirstLoad)
-	{
-		std::vector<UString> toLoad;
-		for (int i=0; i<m_iNumBeatmapsToLoad; i++)
-		{
-			if (i < m_rawBeatmapFolders.size())
-			{
-				if (m_rawLoadBeatmapFolders[i] == m_rawBeatmapFolders[i])
-					continue;
-				else
-					toLoad.push_back(m_rawLoadBeatmapFolders[i]);
-			}
-			else
-				toLoad.push_back(m_rawLoadBeatmapFolders[i]);
-		}
-
-		// only load differences
-		m_rawLoadBeatmapFolders = toLoad;
-		m_iNumBeatmapsToLoad = m_rawLoadBeatmapFolders.size();
-
-		debugLog("Database: Found %i new/changed beatmaps.\n", m_iNumBeatmapsToLoad);
-
-		m_bFoundChanges = m_iNumBeatmapsToLoad > 0;
-		if (m_bFoundChanges)
-			m_osu->getNotificationOverlay()->addNotification(UString::format(m_iNumBeatmapsToLoad == 1 ? "Adding %i new beatmap." : "Adding %i new beatmaps.", m_iNumBeatmapsToLoad), 0xff00ff00);
-		//else
-		//	m_osu->getNotificationOverlay()->addNotification(UString::format("No new beatmaps detected.", m_iNumBeatmapsToLoad), 0xff00ff00);
-	}
+	m_bIsRawLoaded = true;
+	m_bFoundChanges = true;
 
 	debugLog("Database: Building beatmap database ...\n");
 	debugLog("Database: Found %i folders to load.\n", m_rawLoadBeatmapFolders.size());
@@ -243,7 +355,12 @@ void OsuBeatmapDatabase::loadRaw()
 
 void OsuBeatmapDatabase::loadDB(OsuFile *db)
 {
+	OSU_PROFILER_ZONE("OsuBeatmapDatabase::loadDB");
+
 	// reset
+	m_bIsRawLoaded = false;
+	m_rawBeatmapsByFolder.clear();
+	m_addedBeatmaps.clear();
 	m_collections.clear();
 	for (int i=0; i<m_beatmaps.size(); i++)
 	{
@@ -437,7 +554,7 @@ void OsuBeatmapDatabase::loadDB(OsuFile *db)
 			diff->name = difficultyName;
 			diff->source = songSource;
 			diff->tags = songTags;
-			diff->md5hash = md5hash;
+			diff->setMD5Hash(md5hash);
 			diff->beatmapId = beatmapID;
 
 			diff->AR = AR;
@@ -446,7 +563,9 @@ void OsuBeatmapDatabase::loadDB(OsuFile *db)
 			diff->OD = OD;
 			diff->sliderMultiplier = sliderMultiplier;
 
+			// osu!.db doesn't have the background image, but it may have been scanned in a previous session
 			diff->backgroundImageName = "";
+			diff->setRememberedEvents();
 
 			diff->previewTime = previewTime;
 			diff->lastModificationTime = lastModificationTime;
@@ -569,6 +688,8 @@ void OsuBeatmapDatabase::loadDB(OsuFile *db)
 		}
 	}
 
+	m_addedBeatmaps = m_beatmaps;
+
 	m_importTimer->update();
 	debugLog("Refresh finished, added %i beatmaps in %f seconds.\n", m_beatmaps.size(), m_importTimer->getElapsedTime());
 
@@ -576,143 +697,99 @@ void OsuBeatmapDatabase::loadDB(OsuFile *db)
 	m_fLoadingProgress = 0.75f;
 
 	// load collection.db
-	UString collectionFilePath = osu_folder.getString();
-	collectionFilePath.append("collection.db");
-	OsuFile collectionFile(collectionFilePath);
-	if (collectionFile.isReady())
+	if (loadCollections())
 	{
-		struct RawCollection
-		{
-			UString name;
-			std::vector<UString> hashes;
-		};
+		debugLog("Collection: version = %i, numCollections = %i\n", m_collectionDatabase->getVersion(), m_collectionDatabase->getNumCollections());
+		rebuildCollections();
+	}
+	else
+		debugLog("OsuBeatmapDatabase::loadDB() : Couldn't load collection.db\n");
+
+	// signal that we are done
+	m_fLoadingProgress = 1.0f;
+}
 
-		int version = collectionFile.readInt();
-		int numCollections = collectionFile.readInt();
+void OsuBeatmapDatabase::rebuildCollections()
+{
+	m_collections.clear();
 
-		debugLog("Collection: version = %i, numCollections = %i\n", version, numCollections);
-		for (int i=0; i<numCollections; i++)
+	// index all diffs by md5 once, instead of searching through every beatmap for every single hash
+	std::unordered_map<std::string, std::pair<OsuBeatmap*, OsuBeatmapDifficulty*>> diffsByHash;
+	for (int b=0; b<m_beatmaps.size(); b++)
+	{
+		std::vector<OsuBeatmapDifficulty*> *diffs = m_beatmaps[b]->getDifficultiesPointer();
+		for (int d=0; d<diffs->size(); d++)
 		{
-			m_fLoadingProgress = 0.75f + 0.24f*((float)(i+1)/(float)numCollections);
+			if ((*diffs)[d]->hasMD5())
+				diffsByHash[std::string((*diffs)[d]->getMD5Hash().toUtf8())] = std::pair<OsuBeatmap*, OsuBeatmapDifficulty*>(m_beatmaps[b], (*diffs)[d]);
+		}
+	}
 
-			UString name = collectionFile.readString();
-			int numBeatmaps = collectionFile.readInt();
+	for (int i=0; i<m_collectionDatabase->getNumCollections(); i++)
+	{
+		const OsuCollectionDatabase::COLLECTION &rc = m_collectionDatabase->getCollection(i);
 
-			RawCollection rc;
-			rc.name = name;
+		Collection c;
+		c.name = m_collectionDatabase->getName(i);
+		c.index = i;
 
-			if (Osu::debug->getBool())
-				debugLog("Raw Collection #%i: name = %s, numBeatmaps = %i\n", i, name.toUtf8(), numBeatmaps);
+		// beatmaps keep the order in which their first diff appears in the collection
+		std::unordered_map<OsuBeatmap*, int> beatmapIndices;
+		std::unordered_set<OsuBeatmapDifficulty*> addedDiffs;
+		for (int h=0; h<rc.hashes.size(); h++)
+		{
+			std::unordered_map<std::string, std::pair<OsuBeatmap*, OsuBeatmapDifficulty*>>::iterator it = diffsByHash.find(rc.hashes[h]);
+			if (it == diffsByHash.end() || !addedDiffs.insert(it->second.second).second)
+				continue;
 
-			for (int b=0; b<numBeatmaps; b++)
+			OsuBeatmap *beatmap = it->second.first;
+			std::unordered_map<OsuBeatmap*, int>::iterator beatmapIt = beatmapIndices.find(beatmap);
+			if (beatmapIt == beatmapIndices.end())
 			{
-				UString md5hash = collectionFile.readString();
-				rc.hashes.push_back(md5hash);
+				beatmapIndices[beatmap] = c.beatmaps.size();
+				c.beatmaps.push_back(std::pair<OsuBeatmap*, std::vector<OsuBeatmapDifficulty*>>(beatmap, std::vector<OsuBeatmapDifficulty*>()));
+				c.beatmaps.back().second.push_back(it->second.second);
 			}
+			else
+				c.beatmaps[beatmapIt->second].second.push_back(it->second.second);
+		}
 
-			if (rc.hashes.size() > 0)
-			{
-				// collect OsuBeatmaps corresponding to this collection
-				Collection c;
-				c.name = rc.name;
-
-				// go through every hash of the collection
-				std::vector<OsuBeatmapDifficulty*> matchingDiffs;
-				for (int h=0; h<rc.hashes.size(); h++)
-				{
-					// for every hash, go through every beatmap
-					for (int b=0; b<m_beatmaps.size(); b++)
-					{
-						// for every beatmap, go through every diff and check if a diff hash matches, store those matching diffs
-						std::vector<OsuBeatmapDifficulty*> diffs = m_beatmaps[b]->getDifficulties();
-						for (int d=0; d<diffs.size(); d++)
-						{
-							if (diffs[d]->md5hash == rc.hashes[h])
-								matchingDiffs.push_back(diffs[d]);
-						}
-					}
-				}
-
-				// we now have an array of all OsuBeatmapDifficulty objects within this collection
+		// add the collection
+		if (c.beatmaps.size() > 0) // sanity check
+			m_collections.push_back(c);
 
-				// go through every found OsuBeatmapDifficulty
-				if (matchingDiffs.size() > 0)
-				{
-					for (int md=0; md<matchingDiffs.size(); md++)
-					{
-						OsuBeatmapDifficulty *diff = matchingDiffs[md];
+		if (Osu::debug->getBool())
+			debugLog("Collection #%i: name = %s, numHashes = %i, numBeatmaps = %i\n", i, c.name.toUtf8(), (int)rc.hashes.size(), (int)c.beatmaps.size());
+	}
+}
 
-						// find the OsuBeatmap object corresponding to this diff
-						OsuBeatmap *beatmap = NULL;
-						for (int b=0; b<m_beatmaps.size(); b++)
-						{
-							std::vector<OsuBeatmapDifficulty*> diffs = m_beatmaps[b]->getDifficulties();
-							for (int d=0; d<diffs.size(); d++)
-							{
-								if (diffs[d] == diff)
-								{
-									beatmap = m_beatmaps[b];
-									break;
-								}
-							}
-						}
+bool OsuBeatmapDatabase::loadCollections()
+{
+	UString collectionFilePath = osu_folder.getString();
+	collectionFilePath.append("collection.db");
 
-						// we now have one matching OsuBeatmap and OsuBeatmapDifficulty, add either of them if they don't exist yet
-						bool beatmapIsAlreadyInCollection = false;
-						for (int m=0; m<c.beatmaps.size(); m++)
-						{
-							if (c.beatmaps[m].first == beatmap)
-							{
-								beatmapIsAlreadyInCollection = true;
-
-								// the beatmap already exists, check if we have to add the current diff
-								bool diffIsAlreadyInCollection = false;
-								for (int d=0; d<c.beatmaps[m].second.size(); d++)
-								{
-									if (c.beatmaps[m].second[d] == diff)
-									{
-										diffIsAlreadyInCollection = true;
-										break;
-									}
-								}
-
-								// add diff
-								if (!diffIsAlreadyInCollection && diff != NULL)
-									c.beatmaps[m].second.push_back(diff);
-
-								break;
-							}
-						}
+	if (m_collectionDatabase->load(collectionFilePath))
+	{
+		m_bCollectionsEditable = true;
+		return true;
+	}
 
-						// add beatmap
-						if (!beatmapIsAlreadyInCollection && beatmap != NULL && diff != NULL)
-						{
-							std::vector<OsuBeatmapDifficulty*> diffs;
-							diffs.push_back(diff);
-							c.beatmaps.push_back(std::pair<OsuBeatmap*, std::vector<OsuBeatmapDifficulty*>>(beatmap, diffs));
-						}
-					}
-				}
+	// a missing collection.db is fine (the first edit creates it), but one which exists and didn't load still holds the user's real collections
+	m_bCollectionsEditable = !env->fileExists(collectionFilePath);
+	if (!m_bCollectionsEditable)
+		debugLog("OsuBeatmapDatabase: Couldn't load %s, collection editing is disabled to not overwrite it\n", collectionFilePath.toUtf8());
 
-				// add the collection
-				if (c.beatmaps.size() > 0) // sanity check
-					m_collections.push_back(c);
-			}
-		}
+	return false;
+}
 
-		if (Osu::debug->getBool())
-		{
-			for (int i=0; i<m_collections.size(); i++)
-			{
-				debugLog("Collection #%i: name = %s, numBeatmaps = %i\n", i, m_collections[i].name.toUtf8(), m_collections[i].beatmaps.size());
-			}
-		}
-	}
-	else
-		debugLog("OsuBeatmapDatabase::loadDB() : Couldn't load collection.db");
+bool OsuBeatmapDatabase::saveCollections()
+{
+	if (!m_bCollectionsEditable)
+		return false;
 
-	// signal that we are done
-	m_fLoadingProgress = 1.0f;
+	UString collectionFilePath = osu_folder.getString();
+	collectionFilePath.append("collection.db");
+	return m_collectionDatabase->save(collectionFilePath);
 }
 
 OsuBeatmap *OsuBeatmapDatabase::loadRawBeatmap(UString beatmapPath)
@@ -750,6 +827,10 @@ OsuBeatmap *OsuBeatmapDatabase::loadRawBeatmap(UString beatmapPath)
 				continue;
 			}
 
+			// raw loaded diffs don't have any star rating, calculate it in the background
+			if (diff->starsNoMod <= 0.0f)
+				m_difficultyCache->request(diff);
+
 			diffs.push_back(diff);
 		}
 	}
@@ -763,3 +844,21 @@ OsuBeatmap *OsuBeatmapDatabase::loadRawBeatmap(UString beatmapPath)
 
 	return result;
 }
+
+void OsuBeatmapDatabase::deleteBeatmaps()
+{
+	m_difficultyCache->cancel();
+	m_collections.clear();
+	for (int i=0; i<m_beatmaps.size(); i++)
+	{
+		delete m_beatmaps[i];
+	}
+	m_beatmaps.clear();
+	for (int i=0; i<m_removedBeatmaps.size(); i++)
+	{
+		delete m_removedBeatmaps[i];
+	}
+	m_removedBeatmaps.clear();
+	m_addedBeatmaps.clear();
+	m_rawBeatmapsByFolder.clear();
+}
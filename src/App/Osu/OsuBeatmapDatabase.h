@@ -10,12 +10,18 @@
 
 #include "cbase.h"
 
+#include <unordered_map>
+
 class Timer;
 
 class Osu;
 class OsuBeatmap;
 class OsuBeatmapDifficulty;
 class OsuFile;
+class OsuDifficultyCache;
+class OsuScoreDatabase;
+class OsuCollectionDatabase;
+class OsuSongFolderWatcher;
 
 class OsuBeatmapDatabaseLoader;
 
@@ -25,6 +31,7 @@ public:
 	struct Collection
 	{
 		UString name;
+		int index; // into the OsuCollectionDatabase
 		std::vector<std::pair<OsuBeatmap*, std::vector<OsuBeatmapDifficulty*>>> beatmaps;
 	};
 
@@ -36,6 +43,7 @@ public:
 	void update();
 
 	void load();
+	bool refresh(); // only (re)loads the changed folders of a raw loaded library, false if a full load() is necessary
 	void cancel();
 
 	inline float getProgress() {return m_fLoadingProgress;}
@@ -44,26 +52,46 @@ public:
 	inline int getNumCollections() {return m_collections.size();}
 	inline std::vector<Collection> getCollections() {return m_collections;}
 
+	// what the last load()/refresh() has changed, the removed beatmaps stay valid until deleteRemovedBeatmaps()
+	inline const std::vector<OsuBeatmap*> &getAddedBeatmaps() const {return m_addedBeatmaps;}
+	inline const std::vector<OsuBeatmap*> &getRemovedBeatmaps() const {return m_removedBeatmaps;}
+	void deleteRemovedBeatmaps(); // once nothing references them anymore
+
 	bool isFinished() {return getProgress() >= 1.0f;}
 	inline bool foundChanges() {return m_bFoundChanges;}
 
+	inline OsuDifficultyCache *getDifficultyCache() {return m_difficultyCache;}
+	inline OsuScoreDatabase *getScoreDatabase() {return m_scoreDatabase;}
+	inline OsuCollectionDatabase *getCollectionDatabase() {return m_collectionDatabase;}
+
+	void rebuildCollections(); // from the OsuCollectionDatabase, after it has been modified
+	bool saveCollections(); // to collection.db in the osu folder, refuses to if canEditCollections() is false
+	inline bool canEditCollections() const {return m_bCollectionsEditable;} // false if there is a collection.db which we couldn't load, so that it never gets overwritten
+
 private:
 	friend class OsuBeatmapDatabaseLoader;
 
 	void loadRaw();
 	void loadDB(OsuFile *db);
+	bool loadCollections();
 
 	OsuBeatmap *loadRawBeatmap(UString beatmapPath);
+	void deleteBeatmaps();
 
 	Osu *m_osu;
 	Timer *m_importTimer;
 	bool m_bIsFirstLoad;
 	bool m_bFoundChanges; // for total refresh detection of raw loading
+	OsuDifficultyCache *m_difficultyCache;
+	OsuScoreDatabase *m_scoreDatabase;
+	OsuCollectionDatabase *m_collectionDatabase;
 
 	// global
 	int m_iNumBeatmapsToLoad;
 	float m_fLoadingProgress;
 	std::vector<OsuBeatmap*> m_beatmaps;
+	std::vector<OsuBeatmap*> m_addedBeatmaps;
+	std::vector<OsuBeatmap*> m_removedBeatmaps;
 
 	// osu!.db
 	int m_iVersion;
@@ -72,13 +100,16 @@ private:
 
 	// collection.db
 	std::vector<Collection> m_collections;
+	bool m_bCollectionsEditable;
 
 	// raw load
 	bool m_bRawBeatmapLoadScheduled;
 	int m_iCurRawBeatmapLoadIndex;
 	UString m_sRawBeatmapLoadOsuSongFolder;
-	std::vector<UString> m_rawBeatmapFolders;
 	std::vector<UString> m_rawLoadBeatmapFolders;
+	bool m_bIsRawLoaded; // the current beatmaps came from loadRaw(), so refresh() can work on folders
+	OsuSongFolderWatcher *m_songFolderWatcher;
+	std::unordered_map<std::string, OsuBeatmap*> m_rawBeatmapsByFolder;
 };
 
 #endif
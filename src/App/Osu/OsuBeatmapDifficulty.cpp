@@ -11,19 +11,19 @@
 #include "ResourceManager.h"
 #include "ConVar.h"
 #include "File.h"
+#include "Timer.h"
 
 #include "Osu.h"
 #include "OsuNotificationOverlay.h"
 #include "OsuGameRules.h"
 #include "OsuSkin.h"
-
-#include "OsuHitObject.h"
-#include "OsuCircle.h"
-#include "OsuSlider.h"
-#include "OsuSpinner.h"
+#include "OsuBeatmap.h"
+#include "OsuMD5.h"
+#include "OsuProfiler.h"
+#include "OsuLoadScheduler.h"
+#include "OsuBeatmapEvents.h"
 
 ConVar osu_mod_random("osu_mod_random", false);
-ConVar osu_show_approach_circle_on_first_hidden_object("osu_show_approach_circle_on_first_hidden_object", true);
 
 class BackgroundImagePathLoader : public Resource
 {
@@ -69,6 +69,49 @@ private:
 	bool m_bDead;
 };
 
+class BackgroundImageLoadJob : public OsuLoadScheduler::JOB
+{
+public:
+	BackgroundImageLoadJob(OsuBeatmapDifficulty *diff, UString filePath, UString resourceName) : OsuLoadScheduler::JOB()
+	{
+		m_diff = diff;
+		m_sFilePath = filePath;
+		m_sResourceName = resourceName;
+		m_image = NULL;
+	}
+
+	virtual void start()
+	{
+		engine->getResourceManager()->requestNextLoadAsync();
+		m_image = engine->getResourceManager()->loadImageAbs(m_sFilePath, m_sResourceName);
+		m_diff->backgroundImage = m_image;
+	}
+
+	virtual bool isFinished()
+	{
+		if (m_image == NULL)
+			return true;
+
+		// the ResourceManager can't stop a decode which already started, so a cancelled load keeps its slot until then
+		// unloadBackgroundImage() leaves the image of a cancelled load to this job, it is destroyed as soon as the ResourceManager is done with it
+		if (!m_image->isAsyncReady() && !m_image->isReady())
+			return false;
+
+		if (isCancelled())
+		{
+			engine->getResourceManager()->destroyResource(m_image);
+			m_image = NULL;
+		}
+		return true;
+	}
+
+private:
+	OsuBeatmapDifficulty *m_diff;
+	UString m_sFilePath;
+	UString m_sResourceName;
+	Image *m_image;
+};
+
 OsuBeatmapDifficulty::OsuBeatmapDifficulty(Osu *osu, UString filepath, UString folder)
 {
 	m_osu = osu;
@@ -77,6 +120,10 @@ OsuBeatmapDifficulty::OsuBeatmapDifficulty(Osu *osu, UString filepath, UString f
 	m_sFilePath = filepath;
 	m_sFolder = folder;
 	m_bShouldBackgroundImageBeLoaded = false;
+	m_bBackgroundImageSelected = false;
+	m_iBackgroundImageLoadID = 0;
+	m_bEventsKnown = false;
+	m_bEventsScanned = false;
 
 	// default values
 	stackLeniency = 0.7f;
@@ -95,6 +142,9 @@ OsuBeatmapDifficulty::OsuBeatmapDifficulty(Osu *osu, UString filepath, UString f
 	mode = 0;
 	lengthMS = 0;
 
+	hasVideo = false;
+	hasStoryboard = false;
+
 	backgroundImage = NULL;
 	localoffset = 0;
 	minBPM = 0;
@@ -105,6 +155,9 @@ OsuBeatmapDifficulty::OsuBeatmapDifficulty(Osu *osu, UString filepath, UString f
 	setID = 0;
 
 	m_backgroundImagePathLoader = NULL;
+
+	memset(m_md5, 0, sizeof(m_md5));
+	m_bMD5Valid = false;
 }
 
 OsuBeatmapDifficulty::~OsuBeatmapDifficulty()
@@ -128,8 +181,33 @@ void OsuBeatmapDifficulty::unload()
 	///timingpoints = std::vector<TIMINGPOINT>(); // currently commented for main menu button animation
 }
 
+bool OsuBeatmapDifficulty::setMD5Hash(UString md5hash)
+{
+	m_bMD5Valid = OsuMD5::fromHexString(md5hash.toUtf8(), m_md5);
+	if (!m_bMD5Valid)
+		memset(m_md5, 0, sizeof(m_md5));
+	updateMD5Hash(); // always reformatted, so that it's lowercase
+
+	return m_bMD5Valid;
+}
+
+void OsuBeatmapDifficulty::updateMD5Hash()
+{
+	if (!m_bMD5Valid)
+	{
+		m_sMD5Hash = "";
+		return;
+	}
+
+	char hex[33];
+	OsuMD5::toHexString(m_md5, hex);
+	m_sMD5Hash = UString(hex);
+}
+
 bool OsuBeatmapDifficulty::loadMetadataRaw()
 {
+	OSU_PROFILER_ZONE("OsuBeatmapDifficulty::loadMetadataRaw");
+
 	if (Osu::debug->getBool())
 		debugLog("OsuBeatmapDifficulty::loadMetadata() : %s\n", m_sFilePath.toUtf8());
 
@@ -145,14 +223,40 @@ bool OsuBeatmapDifficulty::loadMetadataRaw()
 		return false;
 	}
 
+	// read everything at once, the md5 is calculated in the same pass as the metadata is parsed
+	// a file which can't be read must not get the md5 of an empty file (scores and collections would attach to the wrong key)
+	const size_t fileSize = file.getFileSize();
+	const char *fileBuffer = file.readFile();
+	if (fileBuffer == NULL)
+	{
+		debugLog("Osu Error: Couldn't read file %s\n", m_sFilePath.toUtf8());
+		return false;
+	}
+
+	OsuMD5 md5;
+	size_t lineStart = 0;
+
 	// load metadata only
 	int curBlock = -1;
 	bool foundAR = false;
-	while (file.canRead())
+	OsuBeatmapEvents::INFO events;
+	while (lineStart < fileSize)
 	{
-		UString uCurLine = file.readLine();
-		const char *curLineChar = uCurLine.toUtf8();
-		std::string curLine(curLineChar);
+		size_t lineEnd = lineStart;
+		while (lineEnd < fileSize && fileBuffer[lineEnd] != '\n')
+		{
+			lineEnd++;
+		}
+		const size_t nextLineStart = std::min(lineEnd + 1, fileSize);
+		md5.update(fileBuffer + lineStart, nextLineStart - lineStart);
+
+		// without the line break, like File::readLine()
+		size_t lineLength = lineEnd - lineStart;
+		if (lineLength > 0 && fileBuffer[lineStart + lineLength - 1] == '\r')
+			lineLength--;
+		const std::string curLine(fileBuffer + lineStart, lineLength);
+		const char *curLineChar = curLine.c_str();
+		lineStart = nextLineStart;
 
 		if (curLine.find("//") == std::string::npos) // ignore comments
 		{
@@ -254,16 +358,7 @@ bool OsuBeatmapDifficulty::loadMetadataRaw()
 				sscanf(curLineChar, " SliderTickRate : %f \n", &sliderTickRate);
 				break;
 			case 3: // Events
-				{
-					char stringBuffer[1024];
-					memset(stringBuffer, '\0', 1024);
-					int type, startTime;
-					if (sscanf(curLineChar, " %i , %i , \"%1023[^\"]\"", &type, &startTime, stringBuffer) == 3)
-					{
-						if (type == 0)
-							backgroundImageName = UString(stringBuffer);
-					}
-				}
+				OsuBeatmapEvents::parseLine(curLineChar, curLine.length(), &events);
 				break;
 			case 4: // Colours
 				{
@@ -311,6 +406,14 @@ bool OsuBeatmapDifficulty::loadMetadataRaw()
 		}
 	}
 
+	// the parser stops early, but the md5 is of the whole file
+	md5.update(fileBuffer + lineStart, fileSize - lineStart);
+	md5.finalize(m_md5);
+	m_bMD5Valid = true;
+	updateMD5Hash();
+
+	setEvents(events);
+
 	// only allow osu!standard diffs for now
 	if (mode != 0)
 		return false;
@@ -371,11 +474,58 @@ bool OsuBeatmapDifficulty::loadMetadataRaw()
 	return true;
 }
 
-bool OsuBeatmapDifficulty::loadRaw(OsuBeatmap *beatmap, std::vector<OsuHitObject*> *hitobjects)
+bool OsuBeatmapDifficulty::loadRaw(OsuBeatmap *beatmap)
 {
 	unload();
 	combocolors = std::vector<Color>();
 	loadMetadataRaw();
+
+	// load beatmap skin
+	beatmap->getOsu()->getSkin()->setBeatmapComboColors(combocolors);
+	beatmap->getOsu()->getSkin()->loadBeatmapOverride(m_sFolder);
+
+	// load the actual beatmap
+	if (!loadHitObjectsRaw())
+		return false;
+
+	// the drawable OsuHitObjects are built by the OsuHitObjectFactory, only the raw data is modified here
+	if (osu_mod_random.getBool())
+	{
+		for (int i=0; i<hitcircles.size(); i++)
+		{
+			OsuBeatmapDifficulty::HITCIRCLE *c = &hitcircles[i];
+
+			c->x = clamp<int>(c->x - (rand() % OsuGameRules::OSU_COORD_WIDTH) / 8, 0, OsuGameRules::OSU_COORD_WIDTH);
+			c->y = clamp<int>(c->y - (rand() & OsuGameRules::OSU_COORD_HEIGHT) / 8, 0, OsuGameRules::OSU_COORD_HEIGHT);
+		}
+		for (int i=0; i<sliders.size(); i++)
+		{
+			OsuBeatmapDifficulty::SLIDER *s = &sliders[i];
+
+			for (int p=0; p<s->points.size(); p++)
+			{
+				s->points[p].x = clamp<int>(s->points[p].x - (rand() % OsuGameRules::OSU_COORD_WIDTH) / 3, 0, OsuGameRules::OSU_COORD_WIDTH);
+				s->points[p].y = clamp<int>(s->points[p].y - (rand() % OsuGameRules::OSU_COORD_HEIGHT) / 3, 0, OsuGameRules::OSU_COORD_HEIGHT);
+			}
+		}
+		for (int i=0; i<spinners.size(); i++)
+		{
+			OsuBeatmapDifficulty::SPINNER *s = &spinners[i];
+
+			s->x = clamp<int>(s->x - ((rand() % OsuGameRules::OSU_COORD_WIDTH) / 1.25f) * (rand() % 2 == 0 ? 1.0f : -1.0f), 0, OsuGameRules::OSU_COORD_WIDTH);
+			s->y = clamp<int>(s->y - ((rand() & OsuGameRules::OSU_COORD_HEIGHT) / 1.25f) * (rand() % 2 == 0 ? 1.0f : -1.0f), 0, OsuGameRules::OSU_COORD_HEIGHT);
+		}
+	}
+
+	loaded = true;
+	return true;
+}
+
+bool OsuBeatmapDifficulty::loadHitObjectsRaw()
+{
+	OSU_PROFILER_ZONE("OsuBeatmapDifficulty::loadHitObjectsRaw");
+
+	unload();
 	timingpoints = std::vector<TIMINGPOINT>();
 
 	// open osu file
@@ -389,11 +539,6 @@ bool OsuBeatmapDifficulty::loadRaw(OsuBeatmap *beatmap, std::vector<OsuHitObject
 		return false;
 	}
 
-	// load beatmap skin
-	beatmap->getOsu()->getSkin()->setBeatmapComboColors(combocolors);
-	beatmap->getOsu()->getSkin()->loadBeatmapOverride(m_sFolder);
-
-	// load the actual beatmap
 	int colorCounter = 1;
 	int comboNumber = 1;
 	int curBlock = -1;
@@ -616,118 +761,42 @@ bool OsuBeatmapDifficulty::loadRaw(OsuBeatmap *beatmap, std::vector<OsuHitObject
 	};
 	std::sort(timingpoints.begin(), timingpoints.end(), TimingPointSortComparator());
 
-	// calculate sliderTimes, and build clicks and ticks
-	for (int i=0; i<sliders.size(); i++)
-	{
-		SLIDER *s = &sliders[i];
-		s->sliderTimeWithoutRepeats = getSliderTimeForSlider(s);
-		s->sliderTime = s->sliderTimeWithoutRepeats * s->repeat;
-
-		// start & end clicks
-		s->clicked.push_back( (struct SLIDER_CLICK) {s->time, false} );
-		s->clicked.push_back( (struct SLIDER_CLICK) {s->time + (long)s->sliderTime, false} );
-
-		// repeat clicks
-		if (s->repeat > 1)
-		{
-			long part = (long) (s->sliderTime / (float) s->repeat);
-			for (int c=1; c<s->repeat; c++)
-			{
-				s->clicked.push_back( (struct SLIDER_CLICK) {s->time + (long)(part*c), false} );
-			}
-		}
-
-		// ticks
-		float tickLengthDiv = ((100.0f * sliderMultiplier) / sliderTickRate) / getTimingPointMultiplierForSlider(s);
-		int tickCount = (int) std::ceil(s->pixelLength / tickLengthDiv) - 1;
-		if (tickCount > 0)
-		{
-			float tickTOffset = 1.0f / (tickCount + 1);
-			float t = tickTOffset;
-			for (int i = 0; i < tickCount; i++, t += tickTOffset)
-			{
-				s->ticks.push_back(t);
-			}
-		}
-	}
-
-	// build all hitobjects
-	for (int i=0; i<hitcircles.size(); i++)
-	{
-		OsuBeatmapDifficulty::HITCIRCLE *c = &hitcircles[i];
-
-		if (osu_mod_random.getBool())
-		{
-			c->x = clamp<int>(c->x - (rand() % OsuGameRules::OSU_COORD_WIDTH) / 8, 0, OsuGameRules::OSU_COORD_WIDTH);
-			c->y = clamp<int>(c->y - (rand() & OsuGameRules::OSU_COORD_HEIGHT) / 8, 0, OsuGameRules::OSU_COORD_HEIGHT);
-		}
-
-		hitobjects->push_back(new OsuCircle(c->x, c->y, c->time, c->sampleType, c->number, c->colorCounter, beatmap));
-	}
+	// calculate sliderTimes, ticks, repeats etc.
 	for (int i=0; i<sliders.size(); i++)
 	{
-		OsuBeatmapDifficulty::SLIDER *s = &sliders[i];
-
-		if (osu_mod_random.getBool())
-		{
-			for (int p=0; p<s->points.size(); p++)
-			{
-				s->points[p].x = clamp<int>(s->points[p].x - (rand() % OsuGameRules::OSU_COORD_WIDTH) / 3, 0, OsuGameRules::OSU_COORD_WIDTH);
-				s->points[p].y = clamp<int>(s->points[p].y - (rand() % OsuGameRules::OSU_COORD_HEIGHT) / 3, 0, OsuGameRules::OSU_COORD_HEIGHT);
-			}
-		}
-
-		hitobjects->push_back(new OsuSlider(s->type, s->repeat, s->pixelLength, s->points, s->hitSounds, s->ticks, s->sliderTime, s->sliderTimeWithoutRepeats, s->time, s->sampleType, s->number, s->colorCounter, beatmap));
+		const TIMING_INFO t = getTimingInfoForTime(sliders[i].time);
+		calculateSliderEvents(&sliders[i], t.beatLength, t.beatLengthBase, sliderMultiplier, sliderTickRate);
 	}
-	for (int i=0; i<spinners.size(); i++)
-	{
-		OsuBeatmapDifficulty::SPINNER *s = &spinners[i];
 
-		if (osu_mod_random.getBool())
-		{
-			s->x = clamp<int>(s->x - ((rand() % OsuGameRules::OSU_COORD_WIDTH) / 1.25f) * (rand() % 2 == 0 ? 1.0f : -1.0f), 0, OsuGameRules::OSU_COORD_WIDTH);
-			s->y = clamp<int>(s->y - ((rand() & OsuGameRules::OSU_COORD_HEIGHT) / 1.25f) * (rand() % 2 == 0 ? 1.0f : -1.0f), 0, OsuGameRules::OSU_COORD_HEIGHT);
-		}
-
-		hitobjects->push_back(new OsuSpinner(s->x, s->y, s->time, s->sampleType, s->endTime, beatmap));
-	}
-
-	// sort hitobjects by starttime
-	struct HitObjectSortComparator
-	{
-	    bool operator() (OsuHitObject const *a, OsuHitObject const *b) const
-	    {
-	        return a->getTime() < b->getTime();
-	    }
-	};
-	std::sort(hitobjects->begin(), hitobjects->end(), HitObjectSortComparator());
-
-	// special rule for first hitobject (for 1 approach circle with HD)
-	if (osu_show_approach_circle_on_first_hidden_object.getBool())
-	{
-		if (hitobjects->size() > 0)
-			(*hitobjects)[0]->setForceDrawApproachCircle(true);
-	}
-
-	loaded = true;
 	return true;
 }
 
 void OsuBeatmapDifficulty::deleteBackgroundImagePathLoader()
 {
 	SAFE_DELETE(m_backgroundImagePathLoader);
+
+	// the scan result is only applied here (main thread), and remembered so that the next start doesn't have to scan again
+	if (m_bEventsScanned)
+	{
+		m_bEventsScanned = false;
+		setEvents(m_scannedEvents);
+		if (hasMD5())
+			OsuBeatmapEvents::remember(getMD5Hash().toUtf8(), m_scannedEvents);
+	}
 }
 
-void OsuBeatmapDifficulty::loadBackgroundImage()
+void OsuBeatmapDifficulty::loadBackgroundImage(bool selected)
 {
 	m_bShouldBackgroundImageBeLoaded = true;
+	if (selected)
+		m_bBackgroundImageSelected = true;
 
 	if (m_backgroundImagePathLoader != NULL) // handle loader cleanup
 	{
 		if (m_backgroundImagePathLoader->isReady())
 			deleteBackgroundImagePathLoader();
 	}
-	else if (backgroundImageName.length() < 1) // dynamically load background image path from osu file if it wasn't set by the database
+	else if (!m_bEventsKnown && !setRememberedEvents()) // dynamically load background image path from osu file if it neither came from loadMetadataRaw() nor was remembered
 	{
 		m_backgroundImagePathLoader = new BackgroundImagePathLoader(this);
 		engine->getResourceManager()->requestNextLoadAsync();
@@ -744,80 +813,62 @@ void OsuBeatmapDifficulty::loadBackgroundImage()
 		UString uniqueResourceName = fullBackgroundImageFilePath;
 		uniqueResourceName.append(name);
 		uniqueResourceName.append(UString::format("%i%i", ID, setID));
-		engine->getResourceManager()->requestNextLoadAsync();
-		backgroundImage = engine->getResourceManager()->loadImageAbs(fullBackgroundImageFilePath, uniqueResourceName);
+
+		// if this is still queued from before, it only gets its priority raised
+		const OsuLoadScheduler::PRIORITY priority = (m_bBackgroundImageSelected ? OsuLoadScheduler::PRIORITY_SELECTED_BACKGROUND : OsuLoadScheduler::PRIORITY_VISIBLE_THUMBNAIL);
+		m_iBackgroundImageLoadID = m_osu->getLoadScheduler()->submit(uniqueResourceName.toUtf8(), priority, new BackgroundImageLoadJob(this, fullBackgroundImageFilePath, uniqueResourceName));
 	}
 }
 
 void OsuBeatmapDifficulty::unloadBackgroundImage()
 {
 	m_bShouldBackgroundImageBeLoaded = false;
+	m_bBackgroundImageSelected = false;
+
+	// an image which is still loading belongs to its (cancelled) BackgroundImageLoadJob from now on, which destroys it once the ResourceManager is done with it
+	bool stillLoading = false;
+	if (m_iBackgroundImageLoadID != 0)
+	{
+		stillLoading = m_osu->getLoadScheduler()->isInFlight(m_iBackgroundImageLoadID);
+		m_osu->getLoadScheduler()->cancel(m_iBackgroundImageLoadID);
+		m_iBackgroundImageLoadID = 0;
+	}
 
 	if (Osu::debug->getBool() && backgroundImage != NULL)
 		debugLog("Unloading %s\n", backgroundImage->getFilePath().toUtf8());
 
 	Image *tempPointer = backgroundImage;
 	backgroundImage = NULL;
-	engine->getResourceManager()->destroyResource(tempPointer);
+	if (!stillLoading)
+		engine->getResourceManager()->destroyResource(tempPointer);
 }
 
 void OsuBeatmapDifficulty::loadBackgroundImagePath()
 {
-	if (backgroundImage != NULL || backgroundImageName.length() > 0) return;
-
-	// open osu file
-	File file(m_sFilePath);
-	if (!file.canRead())
-	{
-		if (Osu::debug->getBool())
-			debugLog("OsuBeatmapDifficulty::loadBackgroundImagePath() couldn't read %s\n", m_sFilePath.toUtf8());
-		return;
-	}
-
-	int curBlock = -1;
-	while (file.canRead())
-	{
-		UString uCurLine = file.readLine();
-		const char *curLineChar = uCurLine.toUtf8();
-		std::string curLine(curLineChar);
+	if (m_bEventsKnown) return;
 
-		if (curLine.find("//") == std::string::npos) // ignore comments
-		{
-			if (curLine.find("[Events]") != std::string::npos)
-				curBlock = 0;
-			else if (curLine.find("[Colours]") != std::string::npos)
-				break; // stop early
-
-			switch (curBlock)
-			{
-			case 0: // Events
-				{
-					char stringBuffer[1024];
-					memset(stringBuffer, '\0', 1024);
-					float temp;
-					if (sscanf(curLineChar, " %f , %f , \"%1023[^\"]\"", &temp, &temp, stringBuffer) == 3)
-					{
-						backgroundImageName = UString(stringBuffer);
-					}
-				}
-				break;
-			}
-		}
-	}
+	if (OsuBeatmapEvents::scan(m_sFilePath, &m_scannedEvents))
+		m_bEventsScanned = true;
+	else if (Osu::debug->getBool())
+		debugLog("OsuBeatmapDifficulty::loadBackgroundImagePath() couldn't read %s\n", m_sFilePath.toUtf8());
 }
 
-float OsuBeatmapDifficulty::getSliderTimeForSlider(SLIDER *slider)
+void OsuBeatmapDifficulty::setEvents(const OsuBeatmapEvents::INFO &info)
 {
-	return getTimingInfoForTime(slider->time).beatLength * (slider->pixelLength / sliderMultiplier) / 100.0f;
+	backgroundImageName = UString(info.backgroundImageName.c_str());
+	hasVideo = info.hasVideo;
+	hasStoryboard = info.hasStoryboard;
+	m_bEventsKnown = true;
 }
 
-float OsuBeatmapDifficulty::getTimingPointMultiplierForSlider(SLIDER *slider)
+bool OsuBeatmapDifficulty::setRememberedEvents()
 {
-	const TIMING_INFO t = getTimingInfoForTime(slider->time);
-	float beatLengthBase = t.beatLengthBase;
-	if (beatLengthBase == 0.0f) // sanity check
-		beatLengthBase = 1.0f;
-	return t.beatLength / beatLengthBase;
+	OsuBeatmapEvents::INFO info;
+	if (!hasMD5() || !OsuBeatmapEvents::lookup(getMD5Hash().toUtf8(), &info))
+		return false;
+
+	setEvents(info);
+	return true;
 }
 
 OsuBeatmapDifficulty::TIMING_INFO OsuBeatmapDifficulty::getTimingInfoForTime(unsigned long positionMS)
@@ -877,6 +928,102 @@ OsuBeatmapDifficulty::TIMING_INFO OsuBeatmapDifficulty::getTimingInfoForTime(uns
 	return ti;
 }
 
+void OsuBeatmapDifficulty::calculateSliderEvents(SLIDER *slider, float beatLength, float beatLengthBase, float sliderMultiplier, float sliderTickRate)
+{
+	slider->ticks.clear();
+	slider->events.clear();
+
+	if (beatLengthBase == 0.0f) // sanity check
+		beatLengthBase = 1.0f;
+	if (sliderMultiplier <= 0.0f)
+		sliderMultiplier = 1.0f;
+
+	const int numSpans = std::max(slider->repeat, 1);
+	const double length = slider->pixelLength;
+	const double velocity = (100.0 * sliderMultiplier) / (double)beatLength; // osu!pixels per ms
+	const double spanDuration = (double)beatLength * (length / sliderMultiplier) / 100.0;
+
+	slider->sliderTimeWithoutRepeats = (float)spanDuration;
+	slider->sliderTime = (float)(spanDuration * numSpans);
+
+	// ticks (the same positions for every span, on reversed spans they are just hit in reverse order)
+	// everything is multiplied instead of accumulated, and osu!stable skips ticks which are less than 10 ms away from the end
+	const double scoringDistance = 100.0 * sliderMultiplier * ((double)beatLengthBase / (double)beatLength);
+	const double tickDistance = (sliderTickRate > 0.0f ? scoringDistance / sliderTickRate : 0.0);
+	const double minDistanceFromEnd = velocity * 10.0;
+	std::vector<double> tickProgress; // the floats in slider->ticks are only precise enough for drawing
+	if (tickDistance > 0.0 && length > 0.0)
+	{
+		for (int i=1; i*tickDistance <= length; i++)
+		{
+			const double distance = i*tickDistance;
+			if (distance >= length - minDistanceFromEnd)
+				break;
+
+			tickProgress.push_back(distance / length);
+			slider->ticks.push_back((float)(distance / length));
+		}
+	}
+
+	// all times are relative doubles until here, and only truncated to integer ms once (the epsilon compensates for binary representation errors, e.g. 0.7 * x)
+	const double epsilon = 0.000001;
+	SLIDER_EVENT event;
+
+	event.type = SLIDER_EVENT_HEAD;
+	event.time = slider->time;
+	event.span = 0;
+	event.tickIndex = -1;
+	slider->events.push_back(event);
+
+	for (int s=0; s<numSpans; s++)
+	{
+		const double spanStartTime = s*spanDuration;
+		const bool reversed = (s % 2 != 0);
+
+		event.type = SLIDER_EVENT_TICK;
+		event.span = s;
+		for (int t=0; t<tickProgress.size(); t++)
+		{
+			const int tickIndex = (reversed ? tickProgress.size()-t-1 : t);
+			const double timeProgress = (reversed ? 1.0 - tickProgress[tickIndex] : tickProgress[tickIndex]);
+
+			event.time = slider->time + (long)(spanStartTime + timeProgress*spanDuration + epsilon);
+			event.tickIndex = tickIndex;
+			slider->events.push_back(event);
+		}
+
+		if (s < numSpans-1)
+		{
+			event.type = SLIDER_EVENT_REPEAT;
+			event.time = slider->time + (long)(spanStartTime + spanDuration + epsilon);
+			event.tickIndex = -1;
+			slider->events.push_back(event);
+		}
+	}
+
+	const long duration = (long)slider->sliderTime;
+
+	event.type = SLIDER_EVENT_LEGACY_LAST_TICK;
+	event.time = slider->time + std::max(duration/2, duration - 36);
+	event.span = numSpans-1;
+	event.tickIndex = -1;
+	slider->events.push_back(event);
+
+	event.type = SLIDER_EVENT_TAIL;
+	event.time = slider->time + duration;
+	slider->events.push_back(event);
+
+	// the legacy last tick may come before the last ticks
+	struct SliderEventSortComparator
+	{
+	    bool operator() (SLIDER_EVENT const &a, SLIDER_EVENT const &b) const
+	    {
+	        return a.time < b.time;
+	    }
+	};
+	std::stable_sort(slider->events.begin(), slider->events.end(), SliderEventSortComparator());
+}
+
 bool OsuBeatmapDifficulty::isInBreak(unsigned long positionMS)
 {
 	for (int i=0; i<breaks.size(); i++)
@@ -896,3 +1043,136 @@ unsigned long OsuBeatmapDifficulty::getBreakDuration(unsigned long positionMS)
 	}
 	return 0;
 }
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+void OsuBeatmapDifficulty::test()
+{
+	// reference event times (relative to the slider start), worked out by hand from the osu!stable rules instead of being dumped from calculateSliderEvents():
+	// span duration = beatLength * (pixelLength / sliderMultiplier) / 100
+	// tick distance = 100 * sliderMultiplier * (beatLengthBase / beatLength) / sliderTickRate, ticks sit at multiples of it, ticks less than 10 ms before the span end are dropped
+	// reversed spans hit the same ticks in reverse order, repeats sit at every span end
+	// legacy last tick = max(duration/2, duration - 36) of the truncated duration, every other time is truncated to integer ms exactly once
+	// H = head, T = tick, R = repeat, L = legacy last tick, E = end (tail)
+	struct TESTCASE
+	{
+		const char *name;
+		int repeat;
+		float pixelLength;
+		float beatLength;
+		float beatLengthBase;
+		float sliderMultiplier;
+		float sliderTickRate;
+		const char *expected;
+	};
+	const TESTCASE cases[] =
+	{
+		// span = 500 * 200 / 100 = 1000, tick distance = 140 px (= 500 ms), the tick at 280 px is the end itself
+		{"2 beats, tick rate 1", 1, 280.0f, 500.0f, 500.0f, 1.4f, 1.0f, "H0 T500 L964 E1000"},
+		// tick distance = 35 px = 125 ms
+		{"2 beats, tick rate 4", 1, 280.0f, 500.0f, 500.0f, 1.4f, 4.0f, "H0 T125 T250 T375 T500 T625 T750 T875 L964 E1000"},
+		// span = 357.14 ms, tick distance = 46.67 px = 166.67 ms, the legacy last tick (357 - 36) comes before the second tick
+		{"uneven length, tick rate 3", 1, 100.0f, 500.0f, 500.0f, 1.4f, 3.0f, "H0 T166 L321 T333 E357"},
+		// span = 5000 * 20 / 100 = 1000, tick distance = 140 * (500 / 5000) = 14 px = 500 ms
+		{"very slow sv (0.1x)", 1, 28.0f, 5000.0f, 500.0f, 1.4f, 1.0f, "H0 T500 L964 E1000"},
+		// span = 2000, tick distance = 100 / 0.5 = 200 px = 1000 ms
+		{"tick rate 0.5", 1, 400.0f, 500.0f, 500.0f, 1.0f, 0.5f, "H0 T1000 L1964 E2000"},
+		// span = 357.14 ms, the tick at 70 px is 0.7 of a span (250 ms, must not become 249), repeats at 357.14, 714.29, 1071.43, 1428.57
+		// reversed spans hit it 0.3 spans after the repeat (464.29, 1178.57), duration = 1785.71
+		{"long repeats", 5, 100.0f, 500.0f, 500.0f, 1.4f, 2.0f, "H0 T250 R357 T464 R714 T964 R1071 T1178 R1428 T1678 L1749 E1785"},
+		// span = 35.71 ms, no ticks, duration/2 = 17 is later than duration - 36
+		{"very short", 1, 10.0f, 500.0f, 500.0f, 1.4f, 1.0f, "H0 L17 E35"},
+		// 0.28 px/ms, the tick at 140 px is 2 px (~7 ms) before the end at 142 px, span = 507.14
+		{"tick 7 ms before the end", 1, 142.0f, 500.0f, 500.0f, 1.4f, 1.0f, "H0 L471 E507"},
+		// the end at 143.2 px is ~11 ms after the tick at 140 px, span = 511.43, so the legacy last tick comes first
+		{"tick 11 ms before the end", 1, 143.2f, 500.0f, 500.0f, 1.4f, 1.0f, "H0 L475 T500 E511"},
+	};
+	const char eventNames[] = {'H', 'T', 'R', 'L', 'E'};
+
+	int numFailed = 0;
+	for (int i=0; i<sizeof(cases)/sizeof(cases[0]); i++)
+	{
+		OsuBeatmapDifficulty::SLIDER s;
+		s.repeat = cases[i].repeat;
+		s.pixelLength = cases[i].pixelLength;
+		s.time = 1000;
+		OsuBeatmapDifficulty::calculateSliderEvents(&s, cases[i].beatLength, cases[i].beatLengthBase, cases[i].sliderMultiplier, cases[i].sliderTickRate);
+
+		std::string result;
+		for (int e=0; e<s.events.size(); e++)
+		{
+			if (e > 0)
+				result.append(" ");
+			result.append(1, eventNames[(int)s.events[e].type]);
+			result.append(std::to_string(s.events[e].time - s.time));
+		}
+
+		const bool passed = (result == cases[i].expected);
+		if (!passed)
+			numFailed++;
+
+		debugLog("osu_slider_events_test: %s %s\n", passed ? "PASSED" : "FAILED", cases[i].name);
+		if (!passed)
+			debugLog("osu_slider_events_test:    expected \"%s\", got \"%s\"\n", cases[i].expected, result.c_str());
+	}
+	debugLog("osu_slider_events_test: %i/%i passed\n", (int)(sizeof(cases)/sizeof(cases[0])) - numFailed, (int)(sizeof(cases)/sizeof(cases[0])));
+
+	// per-frame cost of the event handling of active sliders: scanning all events every frame (as before) vs. walking a cursor
+	const int numSliders = 16;
+	OsuBeatmapDifficulty::SLIDER s;
+	s.repeat = 20;
+	s.pixelLength = 400.0f;
+	s.time = 0;
+	OsuBeatmapDifficulty::calculateSliderEvents(&s, 500.0f, 500.0f, 1.4f, 8.0f);
+	const long duration = (long)s.sliderTime;
+
+	Timer t;
+	t.start();
+	int numHandledScan = 0;
+	{
+		std::vector<std::vector<bool>> finished(numSliders, std::vector<bool>(s.events.size(), false));
+		for (long curPos=0; curPos<=duration; curPos++)
+		{
+			for (int i=0; i<numSliders; i++)
+			{
+				for (int e=0; e<s.events.size(); e++)
+				{
+					if (!finished[i][e] && curPos >= s.events[e].time)
+					{
+						finished[i][e] = true;
+						numHandledScan++;
+					}
+				}
+			}
+		}
+	}
+	t.update();
+	const double scanTime = t.getElapsedTime();
+
+	t.start();
+	int numHandledCursor = 0;
+	{
+		std::vector<int> nextEvent(numSliders, 0);
+		for (long curPos=0; curPos<=duration; curPos++)
+		{
+			for (int i=0; i<numSliders; i++)
+			{
+				while (nextEvent[i] < s.events.size() && curPos >= s.events[nextEvent[i]].time)
+				{
+					nextEvent[i]++;
+					numHandledCursor++;
+				}
+			}
+		}
+	}
+	t.update();
+	const double cursorTime = t.getElapsedTime();
+
+	const double numUpdates = (double)(duration+1)*numSliders;
+	debugLog("osu_slider_events_test: %i events per slider, %i sliders, %li frames\n", (int)s.events.size(), numSliders, duration+1);
+	debugLog("osu_slider_events_test: scan = %f ns per slider update (%i events), cursor = %f ns per slider update (%i events)\n", (scanTime / numUpdates)*1000000000.0, numHandledScan, (cursorTime / numUpdates)*1000000000.0, numHandledCursor);
+}
@@ -10,8 +10,9 @@
 
 #include "cbase.h"
 
+#include "OsuBeatmapEvents.h"
+
 class Osu;
-class OsuHitObject;
 class OsuBeatmap;
 
 class BackgroundImagePathLoader;
@@ -24,11 +25,14 @@ public:
 	void unload();
 
 	bool loadMetadataRaw();
-	bool loadRaw(OsuBeatmap *beatmap, std::vector<OsuHitObject*> *hitobjects);
+	bool loadRaw(OsuBeatmap *beatmap); // loads metadata, hitobject data and the beatmap skin (the drawable OsuHitObjects are then built by an OsuHitObjectFactory)
+	bool loadHitObjectsRaw(); // only parses breaks, timingpoints and hitobject data into the structs below, without creating any OsuHitObjects (expects loadMetadataRaw() to have been called)
 
-	void loadBackgroundImage();
+	void loadBackgroundImage(bool selected = false); // through the OsuLoadScheduler, as the selected beatmap's background (ahead of thumbnails) if selected (sticky until unloadBackgroundImage())
 	void unloadBackgroundImage();
-	void loadBackgroundImagePath();
+	void loadBackgroundImagePath(); // bounded scan of the [Events] section (async), for diffs from osu!.db which weren't remembered yet
+	void setEvents(const OsuBeatmapEvents::INFO &info); // background image name, video/storyboard flags
+	bool setRememberedEvents(); // from the OsuBeatmapEvents memo (by md5), returns false if there is nothing remembered
 
 	struct HITCIRCLE
 	{
@@ -40,10 +44,21 @@ public:
 		bool clicked;
 	};
 
-	struct SLIDER_CLICK
+	enum SLIDER_EVENT_TYPE
 	{
-		long time;
-		bool clicked;
+		SLIDER_EVENT_HEAD,
+		SLIDER_EVENT_TICK,
+		SLIDER_EVENT_REPEAT,
+		SLIDER_EVENT_LEGACY_LAST_TICK, // where osu!stable checks the sliderend (36 ms early, or half of the duration for very short sliders), not used for judging yet
+		SLIDER_EVENT_TAIL
+	};
+
+	struct SLIDER_EVENT
+	{
+		long time; // absolute, in ms
+		char type; // SLIDER_EVENT_TYPE
+		short span; // index of the span (0 to repeat-1) this event happens in/at the end of
+		short tickIndex; // only for ticks, index into SLIDER::ticks
 	};
 
 	struct SLIDER
@@ -60,9 +75,8 @@ public:
 
 		float sliderTime;
 		float sliderTimeWithoutRepeats;
-		std::vector<float> ticks;
-		std::vector<SLIDER_CLICK> clicked;
-		std::vector<SLIDER_CLICK> ticked;
+		std::vector<float> ticks; // position along the slider in [0, 1], the same for every span
+		std::vector<SLIDER_EVENT> events; // sorted by time
 	};
 
 	struct SPINNER
@@ -104,7 +118,6 @@ public:
 	UString name; // difficulty name ("Version")
 	UString source;
 	UString tags;
-	UString md5hash;
 	long beatmapId;
 
 	float AR;
@@ -115,6 +128,8 @@ public:
 	float sliderMultiplier;
 
 	UString backgroundImageName;
+	bool hasVideo;
+	bool hasStoryboard;
 
 	unsigned long previewTime;
 	unsigned long lastModificationTime;
@@ -149,17 +164,25 @@ public:
 	};
 
 	TIMING_INFO getTimingInfoForTime(unsigned long positionMS);
+	static void calculateSliderEvents(SLIDER *slider, float beatLength, float beatLengthBase, float sliderMultiplier, float sliderTickRate); // calculates sliderTime, sliderTimeWithoutRepeats, ticks and events
+	static void test(); // hand checked event timelines + per-frame scan vs. cursor benchmark (osu_slider_events_test)
 	inline bool shouldBackgroundImageBeLoaded() const {return m_bShouldBackgroundImageBeLoaded;}
+	inline UString getFilePath() const {return m_sFilePath;}
+	inline UString getFolder() const {return m_sFolder;}
 	bool isInBreak(unsigned long positionMS);
+
+	// md5 of the .osu file, either from osu!.db or calculated by loadMetadataRaw()
+	bool setMD5Hash(UString md5hash); // hex string, returns false (and clears the md5) if it isn't a valid one
+	inline const UString &getMD5Hash() const {return m_sMD5Hash;} // lowercase hex string, empty if unknown
+	inline const unsigned char *getMD5() const {return m_md5;} // 16 bytes, all zero if unknown
+	inline bool hasMD5() const {return m_bMD5Valid;}
 	unsigned long getBreakDuration(unsigned long positionMS);
 
 private:
 	friend class BackgroundImagePathLoader;
 
-	float getSliderTimeForSlider(SLIDER *slider);
-	float getTimingPointMultiplierForSlider(SLIDER *slider); // needed for slider ticks
-
 	void deleteBackgroundImagePathLoader();
+	void updateMD5Hash(); // formats m_sMD5Hash from m_md5
 
 	Osu *m_osu;
 
@@ -168,7 +191,16 @@ private:
 
 	// custom
 	bool m_bShouldBackgroundImageBeLoaded;
+	bool m_bBackgroundImageSelected;
+	unsigned int m_iBackgroundImageLoadID; // OsuLoadScheduler, 0 if none
 	BackgroundImagePathLoader *m_backgroundImagePathLoader;
+	bool m_bEventsKnown; // backgroundImageName/hasVideo/hasStoryboard are valid, even if there is no background image
+	OsuBeatmapEvents::INFO m_scannedEvents; // written by loadBackgroundImagePath() (async), applied and remembered once the loader is deleted
+	bool m_bEventsScanned;
+
+	unsigned char m_md5[16];
+	bool m_bMD5Valid;
+	UString m_sMD5Hash; // formatted whenever the digest is set (possibly on a loader thread, like all other metadata), getMD5Hash() never writes
 };
 
 #endif
@@ -0,0 +1,471 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		[Events] parsing (background image, video, storyboard) + memo
+//
+// $NoKeywords: $osubmevents
+//===============================================================================//
+
+#include "OsuBeatmapEvents.h"
+
+#include "Engine.h"
+#include "Timer.h"
+
+#include "OsuFile.h"
+
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <stdio.h>
+#include <string.h>
+
+static std::unordered_map<std::string, OsuBeatmapEvents::INFO> g_beatmapEventsMemo; // md5 -> info
+static bool g_bBeatmapEventsMemoDirty = false;
+static std::mutex g_beatmapEventsMemoMutex; // osu!.db is loaded async
+
+static inline bool beatmapEventsIsSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static std::string beatmapEventsTrim(const std::string &value)
+{
+	size_t start = 0;
+	size_t end = value.length();
+	while (start < end && beatmapEventsIsSpace(value[start]))
+	{
+		start++;
+	}
+	while (end > start && beatmapEventsIsSpace(value[end-1]))
+	{
+		end--;
+	}
+	return value.substr(start, end - start);
+}
+
+void OsuBeatmapEvents::parseLine(const char *line, size_t length, INFO *info)
+{
+	size_t pos = 0;
+	while (pos < length && beatmapEventsIsSpace(line[pos]))
+	{
+		pos++;
+	}
+	if (pos + 1 < length && line[pos] == '/' && line[pos+1] == '/') // comment
+		return;
+
+	// type, start time, file name (which may be quoted, and then contain commas)
+	std::string fields[3];
+	int numFields = 0;
+	bool quoted = false;
+	for (; pos < length && numFields < 3; pos++)
+	{
+		const char c = line[pos];
+		if (c == '"')
+			quoted = !quoted;
+		else if (c == ',' && !quoted)
+			numFields++;
+		else
+			fields[numFields] += c;
+	}
+	if (numFields < 3)
+		numFields++;
+
+	const std::string type = beatmapEventsTrim(fields[0]);
+	if (type == "0" || type == "Background")
+	{
+		if (numFields < 3 || info->backgroundImageName.length() > 0)
+			return;
+
+		std::string fileName = beatmapEventsTrim(fields[2]);
+		for (size_t i=0; i<fileName.length(); i++)
+		{
+			if (fileName[i] == '\\')
+				fileName[i] = '/';
+		}
+		info->backgroundImageName = fileName;
+	}
+	else if (type == "1" || type == "Video")
+		info->hasVideo = true;
+	else if (type == "4" || type == "5" || type == "Sprite" || type == "Animation")
+		info->hasStoryboard = true;
+}
+
+bool OsuBeatmapEvents::scan(UString filePath, INFO *info)
+{
+	std::ifstream in(filePath.toUtf8(), std::ios::in | std::ios::binary);
+	if (!in.good())
+		return false;
+
+	bool inEvents = false;
+	bool firstLine = true;
+	std::string line;
+	while (std::getline(in, line))
+	{
+		size_t start = 0;
+		if (firstLine && line.length() >= 3 && (unsigned char)line[0] == 0xEF && (unsigned char)line[1] == 0xBB && (unsigned char)line[2] == 0xBF)
+			start = 3;
+		firstLine = false;
+
+		while (start < line.length() && beatmapEventsIsSpace(line[start]))
+		{
+			start++;
+		}
+
+		if (start < line.length() && line[start] == '[')
+		{
+			// the events are only in one place, everything after them is irrelevant
+			if (inEvents || line.compare(start, 12, "[HitObjects]") == 0)
+				break;
+
+			inEvents = (line.compare(start, 8, "[Events]") == 0);
+			continue;
+		}
+
+		if (inEvents)
+			parseLine(line.c_str() + start, line.length() - start, info);
+	}
+
+	return true;
+}
+
+bool OsuBeatmapEvents::lookup(const std::string &md5, INFO *info)
+{
+	std::lock_guard<std::mutex> lk(g_beatmapEventsMemoMutex);
+	std::unordered_map<std::string, INFO>::const_iterator it = g_beatmapEventsMemo.find(md5);
+	if (it == g_beatmapEventsMemo.end())
+		return false;
+
+	*info = it->second;
+	return true;
+}
+
+void OsuBeatmapEvents::remember(const std::string &md5, const INFO &info)
+{
+	if (md5.length() < 1)
+		return;
+
+	std::lock_guard<std::mutex> lk(g_beatmapEventsMemoMutex);
+	g_beatmapEventsMemo[md5] = info;
+	g_bBeatmapEventsMemoDirty = true;
+}
+
+void OsuBeatmapEvents::load(UString filePath)
+{
+	std::ifstream in(filePath.toUtf8(), std::ios::in | std::ios::binary);
+	if (!in.good())
+		return;
+
+	// <flags> <md5> <background image name>
+	int numEntries = 0;
+	std::string line;
+	while (std::getline(in, line))
+	{
+		if (line.length() > 0 && line[line.length()-1] == '\r')
+			line.erase(line.length()-1);
+
+		const size_t md5Start = line.find(' ');
+		if (md5Start == std::string::npos)
+			continue;
+		size_t md5End = line.find(' ', md5Start + 1);
+		if (md5End == std::string::npos)
+			md5End = line.length();
+
+		int flags = 0;
+		if (sscanf(line.c_str(), "%i", &flags) != 1 || md5End - md5Start - 1 != 32)
+			continue;
+
+		INFO info;
+		info.hasVideo = (flags & 0x1) != 0;
+		info.hasStoryboard = (flags & 0x2) != 0;
+		if (md5End < line.length())
+			info.backgroundImageName = line.substr(md5End + 1);
+
+		std::lock_guard<std::mutex> lk(g_beatmapEventsMemoMutex);
+		g_beatmapEventsMemo[line.substr(md5Start + 1, 32)] = info;
+		numEntries++;
+	}
+
+	debugLog("OsuBeatmapEvents: Loaded %i entries.\n", numEntries);
+}
+
+void OsuBeatmapEvents::save(UString filePath)
+{
+	std::lock_guard<std::mutex> lk(g_beatmapEventsMemoMutex);
+	if (!g_bBeatmapEventsMemoDirty) return;
+
+	std::string data;
+	for (std::unordered_map<std::string, INFO>::iterator it = g_beatmapEventsMemo.begin(); it != g_beatmapEventsMemo.end(); ++it)
+	{
+		const int flags = (it->second.hasVideo ? 0x1 : 0) | (it->second.hasStoryboard ? 0x2 : 0);
+		data.append(std::to_string(flags));
+		data.append(" ");
+		data.append(it->first);
+		data.append(" ");
+		data.append(it->second.backgroundImageName);
+		data.append("\n");
+	}
+
+	// an interrupted write must not leave a truncated cache behind
+	if (!OsuFile::writeFileAtomic(filePath, data.c_str(), data.length()))
+	{
+		debugLog("OsuBeatmapEvents: Couldn't write %s\n", filePath.toUtf8());
+		return;
+	}
+
+	g_bBeatmapEventsMemoDirty = false;
+}
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+static OsuBeatmapEvents::INFO beatmapEventsTestParse(const char *lines[], int numLines)
+{
+	OsuBeatmapEvents::INFO info;
+	for (int i=0; i<numLines; i++)
+	{
+		OsuBeatmapEvents::parseLine(lines[i], strlen(lines[i]), &info);
+	}
+	return info;
+}
+
+static bool beatmapEventsTestWrite(const char *filePath, const std::string &data)
+{
+	FILE *file = fopen(filePath, "wb");
+	if (file == NULL)
+		return false;
+
+	const bool ok = (fwrite(data.c_str(), 1, data.length(), file) == data.length());
+	fclose(file);
+	return ok;
+}
+
+// a typical .osu file, with or without a [Colours] section
+static std::string beatmapEventsTestOsuFile(int index, bool withColours)
+{
+	std::string data = "osu file format v14\r\n\r\n[General]\r\nAudioFilename: audio.mp3\r\nPreviewTime: 12345\r\nMode: 0\r\n\r\n[Editor]\r\nDistanceSpacing: 1.2\r\n\r\n[Metadata]\r\nTitle:Test\r\nArtist:Someone\r\nCreator:Mapper\r\nVersion:Insane\r\n\r\n[Difficulty]\r\nHPDrainRate:5\r\nCircleSize:4\r\nOverallDifficulty:8\r\nApproachRate:9\r\n\r\n";
+	data += "[Events]\r\n//Background and Video events\r\n";
+	data += UString::format("0,0,\"background %i.jpg\",0,0\r\n", index).toUtf8();
+	data += "//Break Periods\r\n2,60000,65000\r\n//Storyboard Layer 0 (Background)\r\n\r\n[TimingPoints]\r\n";
+	for (int i=0; i<300; i++)
+	{
+		data += UString::format("%i,333.333333333333,4,2,1,60,%i,0\r\n", 1000 + i*1333, i % 2).toUtf8();
+	}
+	if (withColours)
+		data += "\r\n[Colours]\r\nCombo1 : 255,192,0\r\nCombo2 : 0,202,0\r\n";
+	data += "\r\n[HitObjects]\r\n";
+	for (int i=0; i<1500; i++)
+	{
+		data += UString::format("%i,%i,%i,1,0,0:0:0:0:\r\n", 64 + (i*37) % 384, 48 + (i*53) % 288, 1000 + i*250).toUtf8();
+	}
+	return data;
+}
+
+// what BackgroundImagePathLoader used to do: every line until [Colours] (the whole file if there is none), against the sscanf pattern
+static bool beatmapEventsTestLegacyScan(const char *filePath, std::string *backgroundImageName)
+{
+	std::ifstream in(filePath, std::ios::in | std::ios::binary);
+	if (!in.good())
+		return false;
+
+	int curBlock = -1;
+	std::string curLine;
+	while (std::getline(in, curLine))
+	{
+		if (curLine.find("//") == std::string::npos)
+		{
+			if (curLine.find("[Events]") != std::string::npos)
+				curBlock = 0;
+			else if (curLine.find("[Colours]") != std::string::npos)
+				break;
+
+			if (curBlock == 0)
+			{
+				char stringBuffer[1024];
+				memset(stringBuffer, '\0', 1024);
+				float temp;
+				if (sscanf(curLine.c_str(), " %f , %f , \"%1023[^\"]\"", &temp, &temp, stringBuffer) == 3)
+					*backgroundImageName = stringBuffer;
+			}
+		}
+	}
+	return true;
+}
+
+void OsuBeatmapEvents::test()
+{
+	int numTests = 0;
+	int numFailed = 0;
+
+	// line corpus
+	{
+		const char *simple[] = {"0,0,\"bg.jpg\",0,0"};
+		const char *videoFirst[] = {"//Background and Video events", "Video,-200,\"intro video.avi\"", "0,0,\"bg final, v2.png\",0,0"};
+		const char *numericVideoUnquoted[] = {"1,0,\"intro.mp4\"", "0,0,bg.jpg,0,0"};
+		const char *comments[] = {"// 0,0,\"commented.jpg\",0,0", "   //0,0,\"indented comment.jpg\"", "0,0,\"real.jpg\""};
+		const char *spaces[] = {"  0 , 0 , \"spaced.jpg\" , 0 , 0  "};
+		const char *backslashes[] = {"0,0,\"sb\\bg.jpg\",0,0"};
+		const char *storyboard[] = {"2,1000,2000", "Sprite,Foreground,Centre,\"sb/star.png\",320,240", " F,0,1000,2000,1,0"};
+		const char *firstWins[] = {"0,0,\"first.jpg\"", "Background,0,\"second.jpg\""};
+		const char *empty[] = {"0,0,\"\",0,0", "0,0", "", "0"};
+
+		const INFO simpleInfo = beatmapEventsTestParse(simple, 1);
+		const INFO videoFirstInfo = beatmapEventsTestParse(videoFirst, 3);
+		const INFO numericVideoUnquotedInfo = beatmapEventsTestParse(numericVideoUnquoted, 2);
+		const INFO commentsInfo = beatmapEventsTestParse(comments, 3);
+		const INFO spacesInfo = beatmapEventsTestParse(spaces, 1);
+		const INFO backslashesInfo = beatmapEventsTestParse(backslashes, 1);
+		const INFO storyboardInfo = beatmapEventsTestParse(storyboard, 3);
+		const INFO firstWinsInfo = beatmapEventsTestParse(firstWins, 2);
+		const INFO emptyInfo = beatmapEventsTestParse(empty, 4);
+
+		numTests++;
+		if (simpleInfo.backgroundImageName != "bg.jpg" || simpleInfo.hasVideo || simpleInfo.hasStoryboard
+			|| videoFirstInfo.backgroundImageName != "bg final, v2.png" || !videoFirstInfo.hasVideo
+			|| numericVideoUnquotedInfo.backgroundImageName != "bg.jpg" || !numericVideoUnquotedInfo.hasVideo
+			|| commentsInfo.backgroundImageName != "real.jpg"
+			|| spacesInfo.backgroundImageName != "spaced.jpg"
+			|| backslashesInfo.backgroundImageName != "sb/bg.jpg"
+			|| storyboardInfo.backgroundImageName != "" || !storyboardInfo.hasStoryboard || storyboardInfo.hasVideo
+			|| firstWinsInfo.backgroundImageName != "first.jpg"
+			|| emptyInfo.backgroundImageName != "" || emptyInfo.hasVideo || emptyInfo.hasStoryboard)
+		{
+			numFailed++;
+			debugLog("osu_beatmap_events_test: FAILED lines (\"%s\", \"%s\", \"%s\", \"%s\", \"%s\", \"%s\", \"%s\")\n", simpleInfo.backgroundImageName.c_str(), videoFirstInfo.backgroundImageName.c_str(), numericVideoUnquotedInfo.backgroundImageName.c_str(),
+				commentsInfo.backgroundImageName.c_str(), spacesInfo.backgroundImageName.c_str(), backslashesInfo.backgroundImageName.c_str(), firstWinsInfo.backgroundImageName.c_str());
+		}
+	}
+
+	// bounded scan: bom, \r\n, only the first [Events] section before [HitObjects] counts
+	{
+		const char *filePath = "beatmap_events_test.osu";
+
+		beatmapEventsTestWrite(filePath, "\xEF\xBB\xBF" "osu file format v14\r\n[General]\r\nAudioFilename: a.mp3\r\n[Events]\r\n//Background and Video events\r\nVideo,0,\"v.mp4\"\r\n0,0,\"scan bg.png\",0,0\r\n[TimingPoints]\r\n0,500,4,2,1,60,1,0\r\n[Events]\r\n0,0,\"after.png\"\r\n");
+		INFO info;
+		const bool scanned = scan(filePath, &info);
+
+		beatmapEventsTestWrite(filePath, "[General]\n[HitObjects]\n[Events]\n0,0,\"objects.png\"\n");
+		INFO afterObjectsInfo;
+		scan(filePath, &afterObjectsInfo);
+
+		remove(filePath);
+		INFO missingInfo;
+		const bool missingScanned = scan(filePath, &missingInfo);
+
+		numTests++;
+		if (!scanned || info.backgroundImageName != "scan bg.png" || !info.hasVideo || afterObjectsInfo.backgroundImageName != "" || missingScanned)
+		{
+			numFailed++;
+			debugLog("osu_beatmap_events_test: FAILED scan (\"%s\", \"%s\")\n", info.backgroundImageName.c_str(), afterObjectsInfo.backgroundImageName.c_str());
+		}
+	}
+
+	// memo round trip (also without a background image), malformed lines are ignored
+	{
+		const std::unordered_map<std::string, INFO> backup = g_beatmapEventsMemo;
+		const bool backupDirty = g_bBeatmapEventsMemoDirty;
+		const char *filePath = "beatmap_events_test.cache";
+
+		g_beatmapEventsMemo.clear();
+		INFO withBackground;
+		withBackground.backgroundImageName = "some folder/bg 1.jpg";
+		withBackground.hasVideo = true;
+		INFO withoutBackground;
+		withoutBackground.hasStoryboard = true;
+		remember("0123456789abcdef0123456789abcdef", withBackground);
+		remember("fedcba9876543210fedcba9876543210", withoutBackground);
+		remember("", withBackground); // ignored
+		save(filePath);
+
+		g_beatmapEventsMemo.clear();
+		{
+			std::ofstream out(filePath, std::ios::out | std::ios::binary | std::ios::app);
+			out << "garbage\n1 tooshort bg.jpg\n\n";
+		}
+		load(filePath);
+		remove(filePath);
+
+		INFO a, b, c;
+		const bool foundA = lookup("0123456789abcdef0123456789abcdef", &a);
+		const bool foundB = lookup("fedcba9876543210fedcba9876543210", &b);
+		const bool foundC = lookup("00000000000000000000000000000000", &c);
+		const int numEntries = g_beatmapEventsMemo.size();
+
+		g_beatmapEventsMemo = backup;
+		g_bBeatmapEventsMemoDirty = backupDirty;
+
+		numTests++;
+		if (!foundA || a.backgroundImageName != withBackground.backgroundImageName || !a.hasVideo || a.hasStoryboard || !foundB || b.backgroundImageName != "" || !b.hasStoryboard || b.hasVideo || foundC || numEntries != 2)
+		{
+			numFailed++;
+			debugLog("osu_beatmap_events_test: FAILED memo (%i %i %i, %i entries, \"%s\")\n", (int)foundA, (int)foundB, (int)foundC, numEntries, a.backgroundImageName.c_str());
+		}
+	}
+
+	// benchmark: a song browser page of osu!.db thumbnails, each one needs the background image name before its image can be requested
+	{
+		const int numThumbnails = 40;
+		std::vector<std::string> filePaths;
+		for (int i=0; i<numThumbnails; i++)
+		{
+			filePaths.push_back(UString::format("beatmap_events_test_%i.osu", i).toUtf8());
+			beatmapEventsTestWrite(filePaths[i].c_str(), beatmapEventsTestOsuFile(i, i % 2 == 0));
+		}
+
+		Timer t;
+		int numFound[3] = {0, 0, 0};
+
+		t.start();
+		for (int i=0; i<numThumbnails; i++)
+		{
+			std::string backgroundImageName;
+			if (beatmapEventsTestLegacyScan(filePaths[i].c_str(), &backgroundImageName) && backgroundImageName.length() > 0)
+				numFound[0]++;
+		}
+		t.update();
+		const double legacyTime = t.getElapsedTime();
+
+		t.start();
+		for (int i=0; i<numThumbnails; i++)
+		{
+			INFO info;
+			if (scan(filePaths[i].c_str(), &info) && info.backgroundImageName.length() > 0)
+				numFound[1]++;
+		}
+		t.update();
+		const double scanTime = t.getElapsedTime();
+
+		// remembered (or from loadMetadataRaw()), i.e. no extra parse at all
+		std::unordered_map<std::string, INFO> memo;
+		for (int i=0; i<numThumbnails; i++)
+		{
+			memo[filePaths[i]].backgroundImageName = "remembered.jpg";
+		}
+		t.start();
+		for (int i=0; i<numThumbnails; i++)
+		{
+			std::unordered_map<std::string, INFO>::const_iterator it = memo.find(filePaths[i]);
+			if (it != memo.end() && it->second.backgroundImageName.length() > 0)
+				numFound[2]++;
+		}
+		t.update();
+		const double memoTime = t.getElapsedTime();
+
+		for (int i=0; i<numThumbnails; i++)
+		{
+			remove(filePaths[i].c_str());
+		}
+
+		numTests++;
+		if (numFound[0] != numThumbnails || numFound[1] != numThumbnails || numFound[2] != numThumbnails)
+		{
+			numFailed++;
+			debugLog("osu_beatmap_events_test: FAILED benchmark (%i/%i/%i found)\n", numFound[0], numFound[1], numFound[2]);
+		}
+
+		debugLog("osu_beatmap_events_test: %i thumbnails until the last image can be requested: previous full parse %f ms, bounded scan %f ms, remembered %f ms\n", numThumbnails, legacyTime*1000.0, scanTime*1000.0, memoTime*1000.0);
+	}
+
+	debugLog("osu_beatmap_events_test: %s, %i/%i passed\n", numFailed == 0 ? "PASSED" : "FAILED", numTests - numFailed, numTests);
+}
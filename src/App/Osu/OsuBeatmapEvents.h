@@ -0,0 +1,42 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		[Events] parsing (background image, video, storyboard) + memo
+//
+// $NoKeywords: $osubmevents
+//===============================================================================//
+
+#ifndef OSUBEATMAPEVENTS_H
+#define OSUBEATMAPEVENTS_H
+
+#include "cbase.h"
+
+// raw loaded diffs get this from loadMetadataRaw(), which already walks the [Events] section
+// osu!.db doesn't store the background image, so for those diffs it is either remembered from before (cfg/events.cache, by md5), or found by scan(), which stops as soon as [Events] is over
+class OsuBeatmapEvents
+{
+public:
+	struct INFO
+	{
+		INFO() {hasVideo = false; hasStoryboard = false;}
+
+		std::string backgroundImageName; // relative to the beatmap folder, without quotes, empty if there is none
+		bool hasVideo;
+		bool hasStoryboard; // sprites/animations in the .osu file itself (a separate .osb isn't looked at)
+	};
+
+	// one line of the [Events] section, e.g. 0,0,"bg.jpg",0,0 or Video,-200,"video.avi" (the first background wins)
+	static void parseLine(const char *line, size_t length, INFO *info);
+
+	// reads the .osu file up to the end of its [Events] section (or [HitObjects]), returns false if it can't be read
+	static bool scan(UString filePath, INFO *info);
+
+	// memo (by md5 hex string), thread safe
+	static bool lookup(const std::string &md5, INFO *info);
+	static void remember(const std::string &md5, const INFO &info);
+	static void load(UString filePath = "cfg/events.cache");
+	static void save(UString filePath = "cfg/events.cache");
+
+	static void test(); // quoting, video/background order, comments, bounded scan, memo round trip + thumbnail benchmark (osu_beatmap_events_test)
+};
+
+#endif
@@ -16,6 +16,7 @@
 #include "Osu.h"
 #include "OsuSkin.h"
 #include "OsuGameRules.h"
+#include "OsuSpriteBatch.h"
 
 ConVar osu_circle_color_saturation("osu_circle_color_saturation", 0.75f);
 ConVar osu_circle_rainbow("osu_circle_rainbow", false);
@@ -31,6 +32,11 @@ ConVar osu_slider_draw_endcircle("osu_slider_draw_endcircle", true);
 int OsuCircle::rainbowNumber = 0;
 int OsuCircle::rainbowColorCounter = 0;
 
+static inline Color withAlpha(Color color, float alpha)
+{
+	return COLOR((int)(clamp<float>(alpha, 0.0f, 1.0f)*255.0f), COLOR_GET_Ri(color), COLOR_GET_Gi(color), COLOR_GET_Bi(color));
+}
+
 void OsuCircle::drawCircle(Graphics *g, OsuBeatmap *beatmap, Vector2 rawPos, int number, int colorCounter, float approachScale, float alpha, float numberAlpha, bool drawNumber, bool overrideHDApproachCircle)
 {
 	drawCircle(g, beatmap->getSkin(), beatmap->osuCoords2Pixels(rawPos), beatmap->getHitcircleDiameter(), beatmap->getNumberScale(), beatmap->getHitcircleOverlapScale(), number, colorCounter, approachScale, alpha, numberAlpha, drawNumber, overrideHDApproachCircle);
@@ -44,7 +50,7 @@ void OsuCircle::drawApproachCircle(Graphics *g, OsuBeatmap *beatmap, Vector2 raw
 	Color comboColor = beatmap->getSkin()->getComboColorForCounter(colorCounter);
 	comboColor = COLOR(255, (int)(COLOR_GET_Ri(comboColor)*osu_circle_color_saturation.getFloat()), (int)(COLOR_GET_Gi(comboColor)*osu_circle_color_saturation.getFloat()), (int)(COLOR_GET_Bi(comboColor)*osu_circle_color_saturation.getFloat()));
 
-	drawApproachCircle(g, beatmap->getSkin(), beatmap->osuCoords2Pixels(rawPos), comboColor, beatmap->getHitcircleDiameter(), approachScale, alpha, beatmap->getOsu()->getModHD(), overrideHDApproachCircle);
+	drawApproachCircle(g, beatmap->getSkin(), beatmap->osuCoords2Pixels(rawPos), comboColor, beatmap->getHitcircleDiameter(), approachScale, alpha, beatmap->getMods().has(OsuMods::HD), overrideHDApproachCircle);
 }
 
 void OsuCircle::drawCircle(Graphics *g, OsuSkin *skin, Vector2 pos, float hitcircleDiameter, float numberScale, float overlapScale, int number, int colorCounter, float approachScale, float alpha, float numberAlpha, bool drawNumber, bool overrideHDApproachCircle)
@@ -61,6 +67,8 @@ void OsuCircle::drawCircle(Graphics *g, OsuSkin *skin, Vector2 pos, float hitcir
 	// approach circle
 	///drawApproachCircle(g, skin, pos, comboColor, hitcircleDiameter, approachScale, alpha, modHD, overrideHDApproachCircle); // they are now drawn separately in draw2()
 
+	OsuSpriteBatch::getShared()->begin(g);
+
 	// circle
 	const float circleImageScale = hitcircleDiameter / (128.0f * (skin->isHitCircle2x() ? 2.0f : 1.0f));
 	comboColor = skin->getComboColorForCounter(colorCounter);
@@ -78,12 +86,16 @@ void OsuCircle::drawCircle(Graphics *g, OsuSkin *skin, Vector2 pos, float hitcir
 	// overlay
 	if (skin->getHitCircleOverlayAboveNumber())
 		drawHitCircleOverlay(g, skin->getHitCircleOverlay(), pos, circleOverlayImageScale, alpha);
+
+	OsuSpriteBatch::getShared()->end();
 }
 
 void OsuCircle::drawCircle(Graphics *g, OsuSkin *skin, Vector2 pos, float hitcircleDiameter, Color color, float alpha)
 {
 	// this function is only used by the target practice heatmap
 
+	OsuSpriteBatch::getShared()->begin(g);
+
 	// circle
 	const float circleImageScale = hitcircleDiameter / (128.0f * (skin->isHitCircle2x() ? 2.0f : 1.0f));
 	drawHitCircle(g, skin->getHitCircle(), pos, color, circleImageScale, alpha);
@@ -91,6 +103,8 @@ void OsuCircle::drawCircle(Graphics *g, OsuSkin *skin, Vector2 pos, float hitcir
 	// overlay
 	const float circleOverlayImageScale = hitcircleDiameter / (128.0f * (skin->isHitCircleOverlay2x() ? 2.0f : 1.0f));
 	drawHitCircleOverlay(g, skin->getHitCircleOverlay(), pos, circleOverlayImageScale, alpha);
+
+	OsuSpriteBatch::getShared()->end();
 }
 
 void OsuCircle::drawSliderStartCircle(Graphics *g, OsuBeatmap *beatmap, Vector2 rawPos, int number, int colorCounter, float approachScale, float alpha, float numberAlpha, bool drawNumber, bool overrideHDApproachCircle)
@@ -116,7 +130,9 @@ void OsuCircle::drawSliderStartCircle(Graphics *g, OsuSkin *skin, Vector2 pos, f
 	const Color comboColor = skin->getComboColorForCounter(colorCounter);
 
 	// approach circle
-	///drawApproachCircle(g, skin, pos, comboColor, beatmap->getHitcircleDiameter(), approachScale, alpha, beatmap->getOsu()->getModHD(), overrideHDApproachCircle); // they are now drawn separately in draw2()
+	///drawApproachCircle(g, skin, pos, comboColor, beatmap->getHitcircleDiameter(), approachScale, alpha, beatmap->getMods().has(OsuMods::HD), overrideHDApproachCircle); // they are now drawn separately in draw2()
+
+	OsuSpriteBatch::getShared()->begin(g);
 
 	// circle
 	const float circleImageScale = hitcircleDiameter / (128.0f * (skin->isSliderStartCircle2x() ? 2.0f : 1.0f));
@@ -140,6 +156,8 @@ void OsuCircle::drawSliderStartCircle(Graphics *g, OsuSkin *skin, Vector2 pos, f
 		if (skin->getHitCircleOverlayAboveNumber())
 			drawHitCircleOverlay(g, skin->getSliderStartCircleOverlay(), pos, circleOverlayImageScale, alpha);
 	}
+
+	OsuSpriteBatch::getShared()->end();
 }
 
 void OsuCircle::drawSliderEndCircle(Graphics *g, OsuBeatmap *beatmap, Vector2 rawPos, int number, int colorCounter, float approachScale, float alpha, float numberAlpha, bool drawNumber, bool overrideHDApproachCircle)
@@ -164,6 +182,8 @@ void OsuCircle::drawSliderEndCircle(Graphics *g, OsuSkin *skin, Vector2 pos, flo
 
 	const Color comboColor = skin->getComboColorForCounter(colorCounter);
 
+	OsuSpriteBatch::getShared()->begin(g);
+
 	// circle
 	const float circleImageScale = hitcircleDiameter / (128.0f * (skin->isSliderEndCircle2x() ? 2.0f : 1.0f));
 	drawHitCircle(g, skin->getSliderEndCircle(), pos, comboColor, circleImageScale, alpha);
@@ -174,13 +194,15 @@ void OsuCircle::drawSliderEndCircle(Graphics *g, OsuSkin *skin, Vector2 pos, flo
 		const float circleOverlayImageScale = hitcircleDiameter / (128.0f * (skin->isSliderEndCircleOverlay2x() ? 2.0f : 1.0f));
 		drawHitCircleOverlay(g, skin->getSliderEndCircleOverlay(), pos, circleOverlayImageScale, alpha);
 	}
+
+	OsuSpriteBatch::getShared()->end();
 }
 
 void OsuCircle::drawApproachCircle(Graphics *g, OsuSkin *skin, Vector2 pos, Color comboColor, float hitcircleDiameter, float approachScale, float alpha, bool modHD, bool overrideHDApproachCircle)
 {
 	if ((!modHD || overrideHDApproachCircle) && osu_draw_approach_circles.getBool())
 	{
-		g->setColor(comboColor);
+		Color color = comboColor;
 
 		if (osu_circle_rainbow.getBool())
 		{
@@ -191,37 +213,32 @@ void OsuCircle::drawApproachCircle(Graphics *g, OsuSkin *skin, Vector2 pos, Colo
 			char green1	= std::sin(frequency*time + 2 + rainbowNumber*rainbowColorCounter) * 127 + 128;
 			char blue1	= std::sin(frequency*time + 4 + rainbowNumber*rainbowColorCounter) * 127 + 128;
 
-			g->setColor(COLOR(255, red1, green1, blue1));
+			color = COLOR(255, red1, green1, blue1);
 		}
 
-		g->setAlpha(alpha);
 		if (approachScale > 1.0f)
 		{
 			float approachCircleImageScale = hitcircleDiameter / (128.0f * (skin->isApproachCircle2x() ? 2.0f : 1.0f));
 
-			g->pushTransform();
-				g->scale(approachCircleImageScale*approachScale, approachCircleImageScale*approachScale);
-				g->translate(pos.x, pos.y);
-				g->drawImage(skin->getApproachCircle());
-			g->popTransform();
+			OsuSpriteBatch *batch = OsuSpriteBatch::getShared();
+			batch->begin(g);
+				batch->add(skin->getApproachCircle(), pos, approachCircleImageScale*approachScale, withAlpha(color, alpha));
+			batch->end();
 		}
 	}
 }
 
 void OsuCircle::drawHitCircleOverlay(Graphics *g, Image *hitCircleOverlayImage, Vector2 pos, float circleOverlayImageScale, float alpha)
 {
-	g->setColor(0xffffffff);
-	g->setAlpha(alpha);
-	g->pushTransform();
-		g->scale(circleOverlayImageScale, circleOverlayImageScale);
-		g->translate(pos.x, pos.y);
-		g->drawImage(hitCircleOverlayImage);
-	g->popTransform();
+	OsuSpriteBatch *batch = OsuSpriteBatch::getShared();
+	batch->begin(g);
+		batch->add(hitCircleOverlayImage, pos, circleOverlayImageScale, withAlpha(0xffffffff, alpha));
+	batch->end();
 }
 
 void OsuCircle::drawHitCircle(Graphics *g, Image *hitCircleImage, Vector2 pos, Color comboColor, float circleImageScale, float alpha)
 {
-	g->setColor(comboColor);
+	Color color = comboColor;
 
 	if (osu_circle_rainbow.getBool())
 	{
@@ -232,15 +249,13 @@ void OsuCircle::drawHitCircle(Graphics *g, Image *hitCircleImage, Vector2 pos, C
 		char green1	= std::sin(frequency*time + 2 + rainbowNumber*rainbowNumber*rainbowColorCounter) * 127 + 128;
 		char blue1	= std::sin(frequency*time + 4 + rainbowNumber*rainbowNumber*rainbowColorCounter) * 127 + 128;
 
-		g->setColor(COLOR(255, red1, green1, blue1));
+		color = COLOR(255, red1, green1, blue1);
 	}
 
-	g->setAlpha(alpha);
-	g->pushTransform();
-		g->scale(circleImageScale, circleImageScale);
-		g->translate(pos.x, pos.y);
-		g->drawImage(hitCircleImage);
-	g->popTransform();
+	OsuSpriteBatch *batch = OsuSpriteBatch::getShared();
+	batch->begin(g);
+		batch->add(hitCircleImage, pos, circleImageScale, withAlpha(color, alpha));
+	batch->end();
 }
 
 void OsuCircle::drawHitCircleNumber(Graphics *g, OsuBeatmap *beatmap, Vector2 pos, int number, float numberAlpha)
@@ -253,17 +268,18 @@ void OsuCircle::drawHitCircleNumber(Graphics *g, OsuSkin *skin, float numberScal
 	if (!osu_draw_numbers.getBool())
 		return;
 
-	std::vector<int> digits;
-	while (number >= 10)
+	// count the digits (no vector, this runs for every visible circle every frame)
+	int numDigits = 1;
+	int divisor = 1;
+	while (number / divisor >= 10)
 	{
-		digits.push_back(number % 10);
-		number = number / 10;
+		divisor *= 10;
+		numDigits++;
 	}
-	digits.push_back(number);
 
-	int digitOffsetMultiplier = digits.size()-1;
+	const int digitOffsetMultiplier = numDigits-1;
 
-	g->setColor(0xffffffff);
+	Color color = 0xffffffff;
 	if (osu_circle_number_rainbow.getBool())
 	{
 		float frequency = 0.3f;
@@ -273,53 +289,58 @@ void OsuCircle::drawHitCircleNumber(Graphics *g, OsuSkin *skin, float numberScal
 		char green1	= std::sin(frequency*time + 2 + rainbowNumber*rainbowNumber*rainbowNumber*rainbowColorCounter) * 127 + 128;
 		char blue1	= std::sin(frequency*time + 4 + rainbowNumber*rainbowNumber*rainbowNumber*rainbowColorCounter) * 127 + 128;
 
-		g->setColor(COLOR(255, red1, green1, blue1));
+		color = COLOR(255, red1, green1, blue1);
 	}
-	g->setAlpha(numberAlpha);
+	color = withAlpha(color, numberAlpha);
+
+	// the digits are drawn from the most significant one to the right, each one overlapping the previous one by the skin overlap
+	Vector2 digitPos = pos;
+	digitPos.x += -skin->getDefault0()->getWidth()*digitOffsetMultiplier*numberScale*0.5f + skin->getHitCircleOverlap()*digitOffsetMultiplier*overlapScale*0.5f;
+	const float digitAdvance = skin->getDefault0()->getWidth()*numberScale - skin->getHitCircleOverlap()*overlapScale;
 
-	g->pushTransform();
-	g->scale(numberScale, numberScale);
-	g->translate(pos.x, pos.y);
-	g->translate(-skin->getDefault0()->getWidth()*digitOffsetMultiplier*numberScale*0.5f + skin->getHitCircleOverlap()*digitOffsetMultiplier*overlapScale*0.5f, 0);
-	for (int i=digits.size()-1; i>=0; i--)
+	OsuSpriteBatch *batch = OsuSpriteBatch::getShared();
+	batch->begin(g);
+	for (; divisor > 0; divisor /= 10)
 	{
-		switch (digits[i])
+		Image *digitImage = NULL;
+		switch ((number / divisor) % 10)
 		{
 		case 0:
-			g->drawImage(skin->getDefault0());
+			digitImage = skin->getDefault0();
 			break;
 		case 1:
-			g->drawImage(skin->getDefault1());
+			digitImage = skin->getDefault1();
 			break;
 		case 2:
-			g->drawImage(skin->getDefault2());
+			digitImage = skin->getDefault2();
 			break;
 		case 3:
-			g->drawImage(skin->getDefault3());
+			digitImage = skin->getDefault3();
 			break;
 		case 4:
-			g->drawImage(skin->getDefault4());
+			digitImage = skin->getDefault4();
 			break;
 		case 5:
-			g->drawImage(skin->getDefault5());
+			digitImage = skin->getDefault5();
 			break;
 		case 6:
-			g->drawImage(skin->getDefault6());
+			digitImage = skin->getDefault6();
 			break;
 		case 7:
-			g->drawImage(skin->getDefault7());
+			digitImage = skin->getDefault7();
 			break;
 		case 8:
-			g->drawImage(skin->getDefault8());
+			digitImage = skin->getDefault8();
 			break;
 		case 9:
-			g->drawImage(skin->getDefault9());
+			digitImage = skin->getDefault9();
 			break;
 		}
+		batch->add(digitImage, digitPos, numberScale, color);
 
-		g->translate(skin->getDefault0()->getWidth()*numberScale - skin->getHitCircleOverlap()*overlapScale, 0);
+		digitPos.x += digitAdvance;
 	}
-	g->popTransform();
+	batch->end();
 }
 
 
@@ -344,7 +365,7 @@ void OsuCircle::draw(Graphics *g)
 	OsuHitObject::draw(g);
 
 	// draw hit animation
-	if (m_fHitAnimation > 0.0f && m_fHitAnimation != 1.0f && !m_beatmap->getOsu()->getModHD())
+	if (m_fHitAnimation > 0.0f && m_fHitAnimation != 1.0f && !m_beatmap->getMods().has(OsuMods::HD))
 	{
 		float alpha = 1.0f - m_fHitAnimation;
 		//alpha = -alpha*(alpha-2.0f); // quad out alpha
@@ -354,17 +375,18 @@ void OsuCircle::draw(Graphics *g)
 
 		const bool drawNumber = m_beatmap->getSkin()->getVersion() > 1.0f ? false : true;
 
-		g->pushTransform();
-			g->scale((1.0f+scale*OsuGameRules::osu_circle_fade_out_scale.getFloat()), (1.0f+scale*OsuGameRules::osu_circle_fade_out_scale.getFloat()));
+		OsuSpriteBatch *batch = OsuSpriteBatch::getShared();
+		const float prevScaleMultiplier = batch->getScaleMultiplier();
+		batch->setScaleMultiplier(prevScaleMultiplier*(1.0f+scale*OsuGameRules::osu_circle_fade_out_scale.getFloat()));
 			drawCircle(g, m_beatmap, m_vRawPos, m_iComboNumber, m_iColorCounter, 1.0f, alpha, alpha, drawNumber);
-		g->popTransform();
+		batch->setScaleMultiplier(prevScaleMultiplier);
 	}
 
 	if (m_bFinished || (!m_bVisible && !m_bWaiting)) // special case needed for when we are past this objects time, but still within not-miss range, because we still need to draw the object
 		return;
 
 	// draw circle
-	const bool hd = m_beatmap->getOsu()->getModHD();
+	const bool hd = m_beatmap->getMods().has(OsuMods::HD);
 	Vector2 shakeCorrectedPos = m_vRawPos;
 	if (engine->getTime() < m_fShakeAnimation) // handle note blocking shaking
 	{
@@ -387,7 +409,7 @@ void OsuCircle::draw2(Graphics *g)
 		return;
 
 	// draw approach circle
-	const bool hd = m_beatmap->getOsu()->getModHD();
+	const bool hd = m_beatmap->getMods().has(OsuMods::HD);
 	drawApproachCircle(g, m_beatmap, m_vRawPos, m_iComboNumber, m_iColorCounter, m_bWaiting && !hd ? 1.0f : m_fApproachScale, m_bWaiting && !hd ? 1.0f : m_fAlpha, m_bOverrideHDApproachCircle);
 }
 
@@ -396,7 +418,7 @@ void OsuCircle::update(long curPos)
 	OsuHitObject::update(curPos);
 
 	// hidden modifies the alpha
-	if (m_beatmap->getOsu()->getModHD())
+	if (m_beatmap->getMods().has(OsuMods::HD))
 	{
 		const float fadeInTimeMultiplier = 0.8f;
 
@@ -411,7 +433,7 @@ void OsuCircle::update(long curPos)
 	// if we have not been clicked yet, check if we are in the timeframe of a miss, also handle auto and relax
 	if (!m_bFinished)
 	{
-		if (m_beatmap->getOsu()->getModAuto())
+		if (m_beatmap->getMods().has(OsuMods::AUTO))
 		{
 			if (curPos >= m_iTime)
 				onHit(OsuScore::HIT::HIT_300, 0);
@@ -420,7 +442,7 @@ void OsuCircle::update(long curPos)
 		{
 			const long delta = curPos - m_iTime;
 
-			if (m_beatmap->getOsu()->getModRelax())
+			if (m_beatmap->getMods().has(OsuMods::RELAX))
 			{
 				if (curPos >= m_iTime)
 				{
@@ -446,7 +468,7 @@ void OsuCircle::update(long curPos)
 				m_bWaiting = true;
 
 				// if this is a miss after waiting
-				if (delta > (long)OsuGameRules::getHitWindow50(m_beatmap))
+				if (delta > (long)m_beatmap->getDifficulty().hitWindow50)
 					onHit(OsuScore::HIT::HIT_MISS, delta);
 			}
 			else
@@ -457,7 +479,7 @@ void OsuCircle::update(long curPos)
 
 void OsuCircle::updateStackPosition(float stackOffset)
 {
-	m_vRawPos = m_vOriginalRawPos - Vector2(m_iStack * stackOffset, m_iStack * stackOffset * (m_beatmap->getOsu()->getModHR() ? -1.0f : 1.0f));
+	m_vRawPos = m_vOriginalRawPos - Vector2(m_iStack * stackOffset, m_iStack * stackOffset * (m_beatmap->getMods().has(OsuMods::HR) ? -1.0f : 1.0f));
 }
 
 void OsuCircle::onClickEvent(Vector2 cursorPos, std::vector<OsuBeatmap::CLICK> &clicks)
@@ -496,10 +518,11 @@ void OsuCircle::onHit(OsuScore::HIT result, long delta, float targetDelta, float
 	// sound and hit animation
 	if (result != OsuScore::HIT::HIT_MISS)
 	{
-		m_beatmap->getSkin()->playHitCircleSound(m_iSampleType);
+		if (!m_beatmap->isSimulating())
+			playHitSound(m_iSampleType, OsuGameRules::getHitSoundPan(m_vRawPos.x), m_iTime + delta);
 
 		m_fHitAnimation = 0.001f; // quickfix for 1 frame missing images
-		anim->moveQuadOut(&m_fHitAnimation, 1.0f, OsuGameRules::getFadeOutTime(m_beatmap), true);
+		anim->moveQuadOut(&m_fHitAnimation, 1.0f, m_beatmap->getDifficulty().fadeOutTime, true);
 	}
 
 	// add it, and we are finished
@@ -528,6 +551,15 @@ void OsuCircle::onReset(long curPos)
 	}
 }
 
+void OsuCircle::onRestore(long curPos, bool finished, const PROGRESS *progress)
+{
+	onReset(curPos);
+
+	// circles which were hit early, or are still waiting to be clicked within their hit window
+	m_bFinished = finished;
+	m_fHitAnimation = (finished ? 1.0f : 0.0f);
+}
+
 Vector2 OsuCircle::getAutoCursorPos(long curPos)
 {
 	return m_beatmap->osuCoords2Pixels(m_vRawPos);
@@ -46,6 +46,7 @@ public:
 
 	virtual void onClickEvent(Vector2 cursorPos, std::vector<OsuBeatmap::CLICK> &clicks);
 	virtual void onReset(long curPos);
+	virtual void onRestore(long curPos, bool finished, const PROGRESS *progress);
 
 private:
 	// necessary due to the static draw functions
@@ -0,0 +1,505 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		collection.db reader/writer + in-memory collection model
+//
+// $NoKeywords: $osucdb
+//===============================================================================//
+
+#include "OsuCollectionDatabase.h"
+
+#include "Engine.h"
+#include "ConVar.h"
+#include "Timer.h"
+
+#include "OsuFile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string.h>
+#include <stdio.h>
+
+static const int OSU_COLLECTION_DATABASE_VERSION = 20150203; // what osu!stable writes (or something newer), only used for new files
+
+// bounds checked, unlike OsuFile, since collection.db is written by other programs too
+class OsuCollectionDatabaseReader
+{
+public:
+	OsuCollectionDatabaseReader(const unsigned char *data, size_t size)
+	{
+		m_data = data;
+		m_iSize = size;
+		m_iOffset = 0;
+	}
+
+	bool readInt(int *value)
+	{
+		if (m_iSize - m_iOffset < 4) return false;
+
+		memcpy(value, m_data + m_iOffset, 4);
+		m_iOffset += 4;
+		return true;
+	}
+
+	bool readString(std::string *value)
+	{
+		if (m_iSize - m_iOffset < 1) return false;
+
+		const unsigned char flag = m_data[m_iOffset++];
+		if (flag == 0x00)
+		{
+			value->clear();
+			return true;
+		}
+		if (flag != 0x0b)
+			return false;
+
+		// ULEB128
+		uint64_t length = 0;
+		for (int shift=0; ; shift+=7)
+		{
+			if (shift > 63 || m_iSize - m_iOffset < 1) return false;
+
+			const unsigned char byte = m_data[m_iOffset++];
+			length |= (uint64_t)(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0)
+				break;
+		}
+
+		if (length > m_iSize - m_iOffset) return false;
+
+		value->assign((const char*)(m_data + m_iOffset), (size_t)length);
+		m_iOffset += (size_t)length;
+		return true;
+	}
+
+	inline size_t getNumRemainingBytes() const {return m_iSize - m_iOffset;}
+
+private:
+	const unsigned char *m_data;
+	size_t m_iSize;
+	size_t m_iOffset;
+};
+
+static void writeInt(std::vector<unsigned char> *data, int value)
+{
+	const size_t offset = data->size();
+	data->resize(offset + 4);
+	memcpy(&(*data)[offset], &value, 4);
+}
+
+static void writeString(std::vector<unsigned char> *data, const std::string &value)
+{
+	if (value.length() < 1)
+	{
+		data->push_back(0x00);
+		return;
+	}
+
+	data->push_back(0x0b);
+
+	uint64_t length = value.length();
+	do
+	{
+		unsigned char byte = (unsigned char)(length & 0x7f);
+		length >>= 7;
+		if (length != 0)
+			byte |= 0x80;
+		data->push_back(byte);
+	}
+	while (length != 0);
+
+	data->insert(data->end(), value.begin(), value.end());
+}
+
+OsuCollectionDatabase::OsuCollectionDatabase()
+{
+	m_iVersion = OSU_COLLECTION_DATABASE_VERSION;
+}
+
+bool OsuCollectionDatabase::load(UString filePath)
+{
+	std::vector<unsigned char> data;
+	{
+		std::ifstream in(filePath.toUtf8(), std::ios::in | std::ios::binary | std::ios::ate);
+		if (!in.good())
+			return false;
+
+		const std::streamoff fileSize = in.tellg();
+		if (fileSize > 0)
+		{
+			data.resize((size_t)fileSize);
+			in.seekg(0, std::ios::beg);
+			in.read((char*)&data[0], fileSize);
+			if (!in.good())
+				return false;
+		}
+	}
+
+	if (!parse(data.size() > 0 ? &data[0] : NULL, data.size()))
+	{
+		debugLog("OsuCollectionDatabase: %s is malformed or truncated, ignoring it\n", filePath.toUtf8());
+		return false;
+	}
+
+	return true;
+}
+
+bool OsuCollectionDatabase::save(UString filePath)
+{
+	std::vector<unsigned char> data;
+	serialize(&data);
+
+	if (!OsuFile::writeFileAtomic(filePath, &data[0], data.size()))
+	{
+		debugLog("OsuCollectionDatabase: Couldn't save %s\n", filePath.toUtf8());
+		return false;
+	}
+
+	return true;
+}
+
+bool OsuCollectionDatabase::parse(const unsigned char *data, size_t size)
+{
+	OsuCollectionDatabaseReader reader(data, size);
+
+	int version = 0;
+	int numCollections = 0;
+	if (!reader.readInt(&version) || !reader.readInt(&numCollections))
+		return false;
+
+	// every collection needs at least 5 bytes (empty name + count), which also protects against absurd counts
+	if (numCollections < 0 || (size_t)numCollections > reader.getNumRemainingBytes() / 5)
+		return false;
+
+	std::vector<COLLECTION> collections(numCollections);
+	for (int i=0; i<numCollections; i++)
+	{
+		COLLECTION &c = collections[i];
+
+		int numHashes = 0;
+		if (!reader.readString(&c.name) || !reader.readInt(&numHashes))
+			return false;
+
+		// every hash needs at least 1 byte
+		if (numHashes < 0 || (size_t)numHashes > reader.getNumRemainingBytes())
+			return false;
+
+		c.hashes.resize(numHashes);
+		c.hashSet.reserve(numHashes);
+		for (int h=0; h<numHashes; h++)
+		{
+			if (!reader.readString(&c.hashes[h]))
+				return false;
+
+			c.hashSet.insert(c.hashes[h]);
+		}
+	}
+
+	if (reader.getNumRemainingBytes() > 0)
+		debugLog("OsuCollectionDatabase: Ignoring %i trailing bytes\n", (int)reader.getNumRemainingBytes());
+
+	m_iVersion = version;
+	m_collections.swap(collections);
+	return true;
+}
+
+void OsuCollectionDatabase::serialize(std::vector<unsigned char> *data) const
+{
+	data->clear();
+
+	writeInt(data, m_iVersion);
+	writeInt(data, (int)m_collections.size());
+	for (int i=0; i<m_collections.size(); i++)
+	{
+		writeString(data, m_collections[i].name);
+		writeInt(data, (int)m_collections[i].hashes.size());
+		for (int h=0; h<m_collections[i].hashes.size(); h++)
+		{
+			writeString(data, m_collections[i].hashes[h]);
+		}
+	}
+}
+
+int OsuCollectionDatabase::addCollection(UString name)
+{
+	const int existingIndex = findCollection(name);
+	if (existingIndex > -1)
+		return existingIndex;
+
+	COLLECTION c;
+	c.name = name.toUtf8();
+	m_collections.push_back(c);
+	return m_collections.size() - 1;
+}
+
+void OsuCollectionDatabase::removeCollection(int index)
+{
+	if (index < 0 || index >= m_collections.size()) return;
+
+	m_collections.erase(m_collections.begin() + index);
+}
+
+int OsuCollectionDatabase::findCollection(UString name) const
+{
+	const std::string nameString = name.toUtf8();
+	for (int i=0; i<m_collections.size(); i++)
+	{
+		if (m_collections[i].name == nameString)
+			return i;
+	}
+	return -1;
+}
+
+bool OsuCollectionDatabase::add(int index, UString md5hash)
+{
+	if (index < 0 || index >= m_collections.size()) return false;
+
+	COLLECTION &c = m_collections[index];
+	const std::string hash = md5hash.toUtf8();
+	if (!c.hashSet.insert(hash).second)
+		return false;
+
+	c.hashes.push_back(hash);
+	return true;
+}
+
+bool OsuCollectionDatabase::remove(int index, UString md5hash)
+{
+	if (index < 0 || index >= m_collections.size()) return false;
+
+	COLLECTION &c = m_collections[index];
+	const std::string hash = md5hash.toUtf8();
+	if (c.hashSet.erase(hash) < 1)
+		return false;
+
+	// all of them, if there are duplicates
+	c.hashes.erase(std::remove(c.hashes.begin(), c.hashes.end(), hash), c.hashes.end());
+	return true;
+}
+
+bool OsuCollectionDatabase::contains(int index, const std::string &md5hash) const
+{
+	if (index < 0 || index >= m_collections.size()) return false;
+
+	return m_collections[index].hashSet.find(md5hash) != m_collections[index].hashSet.end();
+}
+
+void OsuCollectionDatabase::test()
+{
+	int numTests = 0;
+	int numFailed = 0;
+
+	// deterministic lcg, so that failures are reproducible
+	unsigned int seed = 1337;
+	struct RNG
+	{
+		static unsigned int next(unsigned int *seed)
+		{
+			*seed = *seed * 1664525u + 1013904223u;
+			return *seed >> 8;
+		}
+	};
+
+	// build a database like osu!stable would write it, byte by byte
+	std::vector<unsigned char> reference;
+	{
+		const char *names[] = {"", "favourites", "\xe6\x9d\xb1\xe6\x96\xb9 (touhou)", "very long name which needs a two byte uleb128 length because it is longer than one hundred and twenty seven characters, which is not that unusual at all..."};
+		const int numHashes[] = {0, 3, 200, 1};
+
+		writeInt(&reference, 20160403);
+		writeInt(&reference, 4);
+		for (int i=0; i<4; i++)
+		{
+			writeString(&reference, names[i]);
+			writeInt(&reference, numHashes[i]);
+			for (int h=0; h<numHashes[i]; h++)
+			{
+				char hash[33];
+				for (int c=0; c<32; c++)
+				{
+					hash[c] = "0123456789abcdef"[RNG::next(&seed) % 16];
+				}
+				hash[32] = '\0';
+				writeString(&reference, (h == 1 && i == 1) ? std::string("") : std::string(h == 2 && i == 1 ? "0123456789abcdef0123456789abcdef" : hash));
+			}
+		}
+	}
+
+	// read -> write -> read
+	{
+		OsuCollectionDatabase db;
+		std::vector<unsigned char> written;
+		const bool parsed = db.parse(&reference[0], reference.size());
+		db.serialize(&written);
+
+		OsuCollectionDatabase reparsed;
+		std::vector<unsigned char> rewritten;
+		const bool reparsedOk = reparsed.parse(&written[0], written.size());
+		reparsed.serialize(&rewritten);
+
+		numTests++;
+		if (!parsed || !reparsedOk || written != reference || rewritten != reference || db.getNumCollections() != 4 || db.getVersion() != 20160403 || !db.contains(1, std::string("0123456789abcdef0123456789abcdef")) || db.contains(0, std::string("0123456789abcdef0123456789abcdef")))
+		{
+			numFailed++;
+			debugLog("osu_collection_db_test: FAILED round trip: parsed = %i/%i, %i/%i/%i bytes, %i collections\n", (int)parsed, (int)reparsedOk, (int)reference.size(), (int)written.size(), (int)rewritten.size(), db.getNumCollections());
+		}
+
+		// and through the disk
+		const char *testFilePath = "collection_test.db";
+		OsuCollectionDatabase loaded;
+		std::vector<unsigned char> saved;
+		const bool savedOk = db.save(testFilePath);
+		const bool loadedOk = loaded.load(testFilePath);
+		loaded.serialize(&saved);
+		std::remove(testFilePath);
+
+		numTests++;
+		if (!savedOk || !loadedOk || saved != reference)
+		{
+			numFailed++;
+			debugLog("osu_collection_db_test: FAILED disk round trip: saved = %i, loaded = %i\n", (int)savedOk, (int)loadedOk);
+		}
+	}
+
+	// editing
+	{
+		OsuCollectionDatabase db;
+		db.parse(&reference[0], reference.size());
+
+		const int index = db.addCollection("favourites");
+		const int newIndex = db.addCollection("new");
+		const bool added = db.add(newIndex, "ffffffffffffffffffffffffffffffff");
+		const bool addedTwice = db.add(newIndex, "ffffffffffffffffffffffffffffffff");
+		const bool removed = db.remove(index, "0123456789abcdef0123456789abcdef");
+
+		std::vector<unsigned char> written;
+		db.serialize(&written);
+		OsuCollectionDatabase reparsed;
+		reparsed.parse(&written[0], written.size());
+
+		numTests++;
+		if (index != 1 || newIndex != 4 || !added || addedTwice || !removed || reparsed.getNumCollections() != 5 || !reparsed.contains(4, UString("ffffffffffffffffffffffffffffffff")) || reparsed.contains(1, UString("0123456789abcdef0123456789abcdef")) || reparsed.getCollection(1).hashes.size() != 2)
+		{
+			numFailed++;
+			debugLog("osu_collection_db_test: FAILED editing\n");
+		}
+	}
+
+	// truncated at every possible position (none of these may be accepted, and none may change the current state)
+	{
+		OsuCollectionDatabase db;
+		db.addCollection("untouched");
+		for (size_t size=0; size<reference.size(); size++)
+		{
+			numTests++;
+			if (db.parse(size > 0 ? &reference[0] : NULL, size) || db.getNumCollections() != 1)
+			{
+				numFailed++;
+				debugLog("osu_collection_db_test: FAILED truncated to %i bytes was accepted\n", (int)size);
+			}
+		}
+	}
+
+	// malformed
+	{
+		struct MALFORMED
+		{
+			const char *description;
+			std::vector<unsigned char> data;
+		};
+		std::vector<MALFORMED> malformed;
+
+		MALFORMED m;
+		m.description = "negative number of collections";
+		m.data.clear(); writeInt(&m.data, 1); writeInt(&m.data, -1);
+		malformed.push_back(m);
+
+		m.description = "huge number of collections";
+		m.data.clear(); writeInt(&m.data, 1); writeInt(&m.data, 0x7fffffff); writeString(&m.data, "a"); writeInt(&m.data, 0);
+		malformed.push_back(m);
+
+		m.description = "negative number of hashes";
+		m.data.clear(); writeInt(&m.data, 1); writeInt(&m.data, 1); writeString(&m.data, "a"); writeInt(&m.data, -5);
+		malformed.push_back(m);
+
+		m.description = "huge number of hashes";
+		m.data.clear(); writeInt(&m.data, 1); writeInt(&m.data, 1); writeString(&m.data, "a"); writeInt(&m.data, 0x7fffffff); writeString(&m.data, "b");
+		malformed.push_back(m);
+
+		m.description = "invalid string flag";
+		m.data.clear(); writeInt(&m.data, 1); writeInt(&m.data, 1); m.data.push_back(0x05); m.data.push_back(0x01); m.data.push_back('a'); writeInt(&m.data, 0);
+		malformed.push_back(m);
+
+		m.description = "string length beyond the end";
+		m.data.clear(); writeInt(&m.data, 1); writeInt(&m.data, 1); m.data.push_back(0x0b); m.data.push_back(0x7f); m.data.push_back('a'); writeInt(&m.data, 0);
+		malformed.push_back(m);
+
+		m.description = "endless uleb128";
+		m.data.clear(); writeInt(&m.data, 1); writeInt(&m.data, 1); m.data.push_back(0x0b);
+		for (int i=0; i<16; i++) {m.data.push_back(0xff);}
+		writeInt(&m.data, 0);
+		malformed.push_back(m);
+
+		for (int i=0; i<malformed.size(); i++)
+		{
+			OsuCollectionDatabase db;
+			numTests++;
+			if (db.parse(&malformed[i].data[0], malformed[i].data.size()))
+			{
+				numFailed++;
+				debugLog("osu_collection_db_test: FAILED %s was accepted\n", malformed[i].description);
+			}
+		}
+	}
+
+	debugLog("osu_collection_db_test: %s, %i/%i passed\n", numFailed == 0 ? "PASSED" : "FAILED", numTests - numFailed, numTests);
+
+	// benchmark: 500 collections with 100k entries in total
+	{
+		OsuCollectionDatabase db;
+		for (int i=0; i<500; i++)
+		{
+			const int index = db.addCollection(UString::format("collection %i", i));
+			for (int h=0; h<200; h++)
+			{
+				char hash[33];
+				for (int c=0; c<32; c++)
+				{
+					hash[c] = "0123456789abcdef"[RNG::next(&seed) % 16];
+				}
+				hash[32] = '\0';
+				db.add(index, hash);
+			}
+		}
+
+		const char *testFilePath = "collection_test.db";
+
+		Timer t;
+		t.start();
+		const bool saved = db.save(testFilePath);
+		t.update();
+		const double saveTime = t.getElapsedTime();
+
+		OsuCollectionDatabase loaded;
+		t.start();
+		const bool loadedOk = loaded.load(testFilePath);
+		t.update();
+		const double loadTime = t.getElapsedTime();
+
+		// what the song browser does for every difficulty of every beatmap in a collection
+		const std::string hash = db.getCollection(250).hashes[100];
+		int numFound = 0;
+		t.start();
+		for (int i=0; i<100000; i++)
+		{
+			if (loaded.contains(i % 500, hash))
+				numFound++;
+		}
+		t.update();
+		const double lookupTime = t.getElapsedTime();
+
+		std::remove(testFilePath);
+
+		debugLog("osu_collection_db_test: 500 collections, 100000 entries: save = %f ms (%i), load = %f ms (%i), contains() = %f ns (%i found)\n", saveTime*1000.0, (int)saved, loadTime*1000.0, (int)loadedOk, (lookupTime / 100000.0)*1000000000.0, numFound);
+	}
+}
@@ -0,0 +1,57 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		collection.db reader/writer + in-memory collection model
+//
+// $NoKeywords: $osucdb
+//===============================================================================//
+
+#ifndef OSUCOLLECTIONDATABASE_H
+#define OSUCOLLECTIONDATABASE_H
+
+#include "cbase.h"
+
+#include <unordered_set>
+
+// same format as osu!stable: version (int), number of collections (int), and for every collection its name (string), number of hashes (int) and the md5 hashes (strings)
+// strings are either 0x00 (empty), or 0x0b followed by the ULEB128 encoded length and the utf8 bytes
+class OsuCollectionDatabase
+{
+public:
+	struct COLLECTION
+	{
+		std::string name; // utf8
+		std::vector<std::string> hashes; // in file order (including any duplicates), so that unmodified collections are written back byte for byte
+		std::unordered_set<std::string> hashSet; // for membership checks
+	};
+
+public:
+	OsuCollectionDatabase();
+
+	bool load(UString filePath); // false if the file is missing, malformed or truncated, nothing is changed in that case
+	bool save(UString filePath); // temp file + rename, so that a crash can never leave a half written collection.db behind
+
+	bool parse(const unsigned char *data, size_t size); // same rules as load()
+	void serialize(std::vector<unsigned char> *data) const;
+
+	int addCollection(UString name); // returns the index of the new (or already existing) collection
+	void removeCollection(int index);
+	int findCollection(UString name) const; // -1 if there is none
+
+	bool add(int index, UString md5hash); // false if it is already in there
+	bool remove(int index, UString md5hash); // false if it wasn't in there
+	bool contains(int index, const std::string &md5hash) const;
+	inline bool contains(int index, UString md5hash) const {return contains(index, std::string(md5hash.toUtf8()));}
+
+	inline int getNumCollections() const {return m_collections.size();}
+	inline const COLLECTION &getCollection(int index) const {return m_collections[index];}
+	inline UString getName(int index) const {return UString(m_collections[index].name.c_str());}
+	inline int getVersion() const {return m_iVersion;}
+
+	static void test(); // round trips, malformed/truncated inputs, save benchmark (osu_collection_db_test)
+
+private:
+	std::vector<COLLECTION> m_collections;
+	int m_iVersion;
+};
+
+#endif
@@ -0,0 +1,291 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		background star rating calculation + persistent cache (md5 + mods)
+//
+// $NoKeywords: $osudiffcache
+//===============================================================================//
+
+#include "OsuDifficultyCache.h"
+
+#include "Engine.h"
+#include "ResourceManager.h"
+#include "ConVar.h"
+#include "File.h"
+
+#include "OsuBeatmapDifficulty.h"
+#include "OsuDifficultyCalculator.h"
+#include "OsuProfiler.h"
+#include "OsuFile.h"
+
+#include <atomic>
+#include <sstream>
+#include <string.h>
+
+ConVar osu_difficulty_calc_enabled("osu_difficulty_calc_enabled", true, "Calculate star ratings in the background for beatmaps which don't have one (e.g. raw loaded beatmaps without osu!.db)");
+ConVar osu_difficulty_calc_workers("osu_difficulty_calc_workers", 2, "Number of background workers for star rating calculation");
+ConVar osu_difficulty_cache_save_interval("osu_difficulty_cache_save_interval", 30.0f, "Minimum time in seconds between saving the star rating cache while workers are still calculating (it is always saved once the queue is empty)");
+
+const char *OSU_DIFFICULTY_CACHE_FILE = "cfg/difficulty.cache";
+
+class OsuDifficultyCacheWorker : public Resource
+{
+public:
+	OsuDifficultyCacheWorker(OsuDifficultyCache *cache) : Resource()
+	{
+		m_cache = cache;
+		m_bDead = false;
+
+		m_bAsyncReady = false;
+		m_bReady = false;
+	};
+
+	void kill() {m_bDead = true;}
+
+protected:
+	virtual void init()
+	{
+		m_bReady = true;
+	}
+	virtual void initAsync()
+	{
+		// keep working until the queue is empty
+		OsuDifficultyCache::JOB job;
+		while (!m_bDead && m_cache->popJob(&job))
+		{
+			OSU_PROFILER_ZONE("OsuDifficultyCacheWorker::job");
+
+			OsuDifficultyCache::RESULT result;
+			result.job = job;
+			result.valid = false;
+
+			OsuBeatmapDifficulty diff(NULL, job.filePath, job.folder);
+			if (diff.loadMetadataRaw() && diff.loadHitObjectsRaw())
+			{
+				const OsuDifficultyCalculator::STARS stars = OsuDifficultyCalculator::calculateStars(&diff, job.mods);
+
+				result.entry.totalStars = (float)stars.totalStars;
+				result.entry.aimStars = (float)stars.aimStars;
+				result.entry.speedStars = (float)stars.speedStars;
+				result.entry.maxCombo = stars.maxCombo;
+				result.valid = true;
+			}
+
+			m_cache->pushResult(result);
+		}
+
+		m_bAsyncReady = true;
+	}
+	virtual void destroy() {;}
+
+private:
+	OsuDifficultyCache *m_cache;
+	std::atomic<bool> m_bDead;
+};
+
+OsuDifficultyCache::OsuDifficultyCache()
+{
+	m_iGeneration = 0;
+	m_iNumPendingRequests = 0;
+	m_bCacheDirty = false;
+	m_fNextSaveTime = engine->getTime() + osu_difficulty_cache_save_interval.getFloat();
+
+	load();
+}
+
+OsuDifficultyCache::~OsuDifficultyCache()
+{
+	cancel();
+	for (int i=0; i<m_workers.size(); i++)
+	{
+		m_workers[i]->kill();
+		engine->getResourceManager()->destroyResource(m_workers[i]);
+	}
+	m_workers.clear();
+
+	save();
+}
+
+void OsuDifficultyCache::update()
+{
+	OSU_PROFILER_ZONE("OsuDifficultyCache::update");
+
+	const bool wasPending = (m_iNumPendingRequests > 0);
+
+	// collect results
+	std::vector<RESULT> results;
+	{
+		std::lock_guard<std::mutex> lk(m_mutex);
+		results.swap(m_results);
+	}
+
+	for (int i=0; i<results.size(); i++)
+	{
+		const RESULT &r = results[i];
+		if (r.job.generation != m_iGeneration) // the diff may already be deleted
+			continue;
+
+		m_iNumPendingRequests--;
+
+		if (!r.valid)
+			continue;
+
+		m_cache[r.job.key] = r.entry;
+		m_bCacheDirty = true;
+
+		if (r.job.mods == 0)
+			r.job.diff->starsNoMod = r.entry.totalStars;
+	}
+
+	// cleanup finished workers
+	for (int i=0; i<m_workers.size(); i++)
+	{
+		if (m_workers[i]->isReady())
+		{
+			engine->getResourceManager()->destroyResource(m_workers[i]);
+			m_workers.erase(m_workers.begin() + i);
+			i--;
+		}
+	}
+
+	// don't lose a whole session of calculations if the game crashes, save once a batch is done (and every now and then while it is still running)
+	if (m_bCacheDirty && ((wasPending && m_iNumPendingRequests < 1) || engine->getTime() > m_fNextSaveTime))
+		save();
+
+	// spawn new workers if necessary
+	bool hasJobs = false;
+	{
+		std::lock_guard<std::mutex> lk(m_mutex);
+		hasJobs = m_jobs.size() > 0;
+	}
+	while (hasJobs && m_workers.size() < std::max(osu_difficulty_calc_workers.getInt(), 1))
+	{
+		OsuDifficultyCacheWorker *worker = new OsuDifficultyCacheWorker(this);
+		engine->getResourceManager()->requestNextLoadAsync();
+		engine->getResourceManager()->loadResource(worker);
+		m_workers.push_back(worker);
+	}
+}
+
+void OsuDifficultyCache::request(OsuBeatmapDifficulty *diff, int mods)
+{
+	if (diff == NULL || !osu_difficulty_calc_enabled.getBool()) return;
+
+	const std::string key = buildKey(diff, mods);
+
+	// cache hit
+	std::unordered_map<std::string, ENTRY>::iterator it = m_cache.find(key);
+	if (it != m_cache.end())
+	{
+		if (mods == 0)
+			diff->starsNoMod = it->second.totalStars;
+		return;
+	}
+
+	JOB job;
+	job.diff = diff;
+	job.filePath = diff->getFilePath();
+	job.folder = diff->getFolder();
+	job.key = key;
+	job.mods = mods;
+	job.generation = m_iGeneration;
+
+	{
+		std::lock_guard<std::mutex> lk(m_mutex);
+		m_jobs.push_back(job);
+	}
+	m_iNumPendingRequests++;
+}
+
+void OsuDifficultyCache::cancel()
+{
+	std::lock_guard<std::mutex> lk(m_mutex);
+	m_jobs.clear();
+	m_results.clear();
+	m_iGeneration++;
+	m_iNumPendingRequests = 0;
+}
+
+bool OsuDifficultyCache::get(OsuBeatmapDifficulty *diff, int mods, ENTRY *entry)
+{
+	std::unordered_map<std::string, ENTRY>::iterator it = m_cache.find(buildKey(diff, mods));
+	if (it == m_cache.end())
+		return false;
+
+	if (entry != NULL)
+		*entry = it->second;
+	return true;
+}
+
+void OsuDifficultyCache::load()
+{
+	File file(OSU_DIFFICULTY_CACHE_FILE);
+	if (!file.canRead())
+		return;
+
+	int numEntries = 0;
+	while (file.canRead())
+	{
+		UString uCurLine = file.readLine();
+		const char *curLineChar = uCurLine.toUtf8();
+
+		ENTRY entry;
+		char keyBuffer[1024];
+		memset(keyBuffer, '\0', 1024);
+		if (sscanf(curLineChar, " %f %f %f %i %1023[^\n]", &entry.totalStars, &entry.aimStars, &entry.speedStars, &entry.maxCombo, keyBuffer) == 5)
+		{
+			m_cache[std::string(keyBuffer)] = entry;
+			numEntries++;
+		}
+	}
+
+	debugLog("OsuDifficultyCache: Loaded %i entries.\n", numEntries);
+}
+
+void OsuDifficultyCache::save()
+{
+	if (!m_bCacheDirty) return;
+
+	m_fNextSaveTime = engine->getTime() + osu_difficulty_cache_save_interval.getFloat();
+
+	std::ostringstream out;
+	for (std::unordered_map<std::string, ENTRY>::iterator it = m_cache.begin(); it != m_cache.end(); ++it)
+	{
+		out << it->second.totalStars << " " << it->second.aimStars << " " << it->second.speedStars << " " << it->second.maxCombo << " " << it->first << "\n";
+	}
+
+	// saved while running now, an interrupted write must not leave a truncated cache behind
+	const std::string data = out.str();
+	if (!OsuFile::writeFileAtomic(OSU_DIFFICULTY_CACHE_FILE, data.c_str(), data.length()))
+	{
+		debugLog("OsuDifficultyCache: Couldn't write %s\n", OSU_DIFFICULTY_CACHE_FILE);
+		return;
+	}
+
+	m_bCacheDirty = false;
+}
+
+std::string OsuDifficultyCache::buildKey(OsuBeatmapDifficulty *diff, int mods)
+{
+	// diffs which failed to load don't have an md5 hash, fall back to the file path for those
+	std::string key = (diff->hasMD5() ? diff->getMD5Hash().toUtf8() : diff->getFilePath().toUtf8());
+	key.append(":");
+	key.append(std::to_string(mods));
+	return key;
+}
+
+bool OsuDifficultyCache::popJob(JOB *job)
+{
+	std::lock_guard<std::mutex> lk(m_mutex);
+	if (m_jobs.size() < 1)
+		return false;
+
+	*job = m_jobs.front();
+	m_jobs.pop_front();
+	return true;
+}
+
+void OsuDifficultyCache::pushResult(const RESULT &result)
+{
+	std::lock_guard<std::mutex> lk(m_mutex);
+	m_results.push_back(result);
+}
@@ -0,0 +1,87 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		background star rating calculation + persistent cache (md5 + mods)
+//
+// $NoKeywords: $osudiffcache
+//===============================================================================//
+
+#ifndef OSUDIFFICULTYCACHE_H
+#define OSUDIFFICULTYCACHE_H
+
+#include "cbase.h"
+
+#include <mutex>
+#include "WinMinGW.Mutex.h" // necessary due to incomplete implementation in mingw-w64
+
+#include <deque>
+#include <unordered_map>
+
+class OsuBeatmapDifficulty;
+class OsuDifficultyCacheWorker;
+
+class OsuDifficultyCache
+{
+public:
+	struct ENTRY
+	{
+		float totalStars;
+		float aimStars;
+		float speedStars;
+		int maxCombo;
+	};
+
+public:
+	OsuDifficultyCache();
+	~OsuDifficultyCache();
+
+	void update(); // applies finished results (starsNoMod), spawns/cleans up workers, saves the cache when a batch is done
+
+	void request(OsuBeatmapDifficulty *diff, int mods = 0); // mods is a bitmask of OsuReplay::Mods
+	void cancel(); // forget all pending requests (e.g. because the diffs are about to be deleted)
+
+	bool get(OsuBeatmapDifficulty *diff, int mods, ENTRY *entry);
+
+	void load();
+	void save();
+
+	inline int getNumPendingRequests() const {return m_iNumPendingRequests;}
+
+private:
+	friend class OsuDifficultyCacheWorker;
+
+	struct JOB
+	{
+		OsuBeatmapDifficulty *diff; // only ever dereferenced on the main thread
+		UString filePath;
+		UString folder;
+		std::string key;
+		int mods;
+		unsigned long generation;
+	};
+
+	struct RESULT
+	{
+		JOB job;
+		ENTRY entry;
+		bool valid;
+	};
+
+	static std::string buildKey(OsuBeatmapDifficulty *diff, int mods);
+
+	bool popJob(JOB *job); // called by workers
+	void pushResult(const RESULT &result); // called by workers
+
+	std::mutex m_mutex;
+	std::deque<JOB> m_jobs;
+	std::vector<RESULT> m_results;
+	unsigned long m_iGeneration;
+	int m_iNumPendingRequests;
+
+	std::vector<OsuDifficultyCacheWorker*> m_workers;
+
+	std::unordered_map<std::string, ENTRY> m_cache; // main thread only
+	bool m_bCacheDirty;
+	float m_fNextSaveTime;
+};
+
+#endif
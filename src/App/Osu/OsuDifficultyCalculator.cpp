@@ -0,0 +1,535 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		star rating + pp calculation (osu!standard, aim/speed strains)
+//
+// $NoKeywords: $osudiffcalc
+//===============================================================================//
+
+#include "OsuDifficultyCalculator.h"
+
+#include "Engine.h"
+#include "ConVar.h"
+#include "Timer.h"
+
+#include "OsuReplay.h"
+#include "OsuGameRules.h"
+#include "OsuBeatmapDifficulty.h"
+
+#include <algorithm>
+#include <string.h>
+
+const double OsuDifficultyCalculator::STAR_SCALING_FACTOR = 0.0675;
+const double OsuDifficultyCalculator::EXTREME_SCALING_FACTOR = 0.5;
+const double OsuDifficultyCalculator::STRAIN_STEP = 400.0; // the length of each strain section
+const double OsuDifficultyCalculator::DECAY_WEIGHT = 0.9; // how much strains decay per interval (if the previous interval's peak strains after applying decay are still higher than the current one's, they will be used as the peak strains)
+
+const double OsuDifficultyCalculator::DECAY_BASE[2] = {0.3, 0.15}; // strains are multiplied by this every second (speed, aim)
+const double OsuDifficultyCalculator::WEIGHT_SCALING[2] = {1400.0, 26.25}; // balances speed and aim
+
+const double OsuDifficultyCalculator::ALMOST_DIAMETER = 90.0; // almost the normalized circle diameter
+const double OsuDifficultyCalculator::STREAM_SPACING = 110.0; // arbitrary thresholds to determine when a stream is spaced enough that it becomes hard to alternate
+const double OsuDifficultyCalculator::SINGLE_SPACING = 125.0;
+
+OsuDifficultyCalculator::STARS OsuDifficultyCalculator::calculateStars(OsuBeatmapDifficulty *diff, int mods)
+{
+	STARS result;
+	result.aimStars = 0.0;
+	result.speedStars = 0.0;
+	result.totalStars = 0.0;
+	result.numCircles = diff->hitcircles.size();
+	result.numSliders = diff->sliders.size();
+	result.numSpinners = diff->spinners.size();
+	result.maxCombo = result.numCircles + result.numSpinners;
+
+	// positions are normalized to a circle radius of 52 osu!pixels, so that the spacing thresholds are independent of CS
+	const double radius = (OsuGameRules::OSU_COORD_WIDTH / 16.0) * (1.0 - 0.7*(getModCS(diff->CS, mods) - 5.0) / 5.0);
+	const float scalingFactor = (float)(52.0 / std::max(radius, 1.0));
+
+	std::vector<DIFFOBJ> objects;
+	objects.reserve(diff->hitcircles.size() + diff->sliders.size() + diff->spinners.size());
+
+	for (int i=0; i<diff->hitcircles.size(); i++)
+	{
+		const OsuBeatmapDifficulty::HITCIRCLE &c = diff->hitcircles[i];
+
+		DIFFOBJ o;
+		o.normStart = Vector2(c.x, c.y)*scalingFactor;
+		o.normEnd = o.normStart;
+		o.time = (double)c.time;
+		o.isSpinner = false;
+		o.strains[SKILL_SPEED] = o.strains[SKILL_AIM] = 1.0;
+		objects.push_back(o);
+	}
+
+	for (int i=0; i<diff->sliders.size(); i++)
+	{
+		const OsuBeatmapDifficulty::SLIDER &s = diff->sliders[i];
+		if (s.points.size() < 1)
+			continue;
+
+		DIFFOBJ o;
+		o.normStart = s.points[0]*scalingFactor;
+		o.normEnd = getSliderEndPosition(s.points, s.pixelLength, s.repeat)*scalingFactor;
+		o.time = (double)s.time;
+		o.isSpinner = false;
+		o.strains[SKILL_SPEED] = o.strains[SKILL_AIM] = 1.0;
+		objects.push_back(o);
+
+		// head + repeats + tail + ticks on every span
+		result.maxCombo += std::max(s.repeat, 1) + 1 + (int)s.ticks.size()*std::max(s.repeat, 1);
+	}
+
+	for (int i=0; i<diff->spinners.size(); i++)
+	{
+		const OsuBeatmapDifficulty::SPINNER &s = diff->spinners[i];
+
+		DIFFOBJ o;
+		o.normStart = Vector2(s.x, s.y)*scalingFactor;
+		o.normEnd = o.normStart;
+		o.time = (double)s.time;
+		o.isSpinner = true;
+		o.strains[SKILL_SPEED] = o.strains[SKILL_AIM] = 1.0;
+		objects.push_back(o);
+	}
+
+	if (objects.size() < 1)
+		return result;
+
+	struct DiffObjSortComparator
+	{
+	    bool operator() (DIFFOBJ const &a, DIFFOBJ const &b) const
+	    {
+	        return a.time < b.time;
+	    }
+	};
+	std::sort(objects.begin(), objects.end(), DiffObjSortComparator());
+
+	const double speedMultiplier = getModSpeedMultiplier(mods);
+	const double aim = calculateSkill(objects, SKILL_AIM, speedMultiplier);
+	const double speed = calculateSkill(objects, SKILL_SPEED, speedMultiplier);
+
+	result.aimStars = std::sqrt(aim) * STAR_SCALING_FACTOR;
+	result.speedStars = std::sqrt(speed) * STAR_SCALING_FACTOR;
+	result.totalStars = result.aimStars + result.speedStars + std::abs(result.speedStars - result.aimStars) * EXTREME_SCALING_FACTOR;
+
+	return result;
+}
+
+double OsuDifficultyCalculator::calculateSkill(std::vector<DIFFOBJ> &objects, SKILL skill, double speedMultiplier)
+{
+	// calculate the strain of every object, decaying the strain of the previous one
+	for (int i=1; i<objects.size(); i++)
+	{
+		DIFFOBJ &cur = objects[i];
+		const DIFFOBJ &prev = objects[i-1];
+
+		const double timeElapsed = (cur.time - prev.time) / speedMultiplier;
+		const double decay = std::pow(DECAY_BASE[skill], timeElapsed / 1000.0);
+
+		double value = 0.0;
+		if (!cur.isSpinner)
+		{
+			const double distance = (cur.normStart - prev.normEnd).length();
+			value = spacingWeight(distance, skill) * WEIGHT_SCALING[skill];
+		}
+		value /= std::max(timeElapsed, 50.0); // prevent division by zero (and ridiculous values for 2B maps)
+
+		cur.strains[skill] = prev.strains[skill]*decay + value;
+	}
+
+	// collect the peak strain of every section
+	const double strainStep = STRAIN_STEP * speedMultiplier;
+	std::vector<double> highestStrains;
+	double intervalEnd = std::ceil(objects[0].time / strainStep) * strainStep;
+	double maxStrain = 0.0;
+	for (int i=0; i<objects.size(); i++)
+	{
+		const DIFFOBJ &cur = objects[i];
+
+		// make sure we are considering all sections up to this object, including empty ones
+		while (cur.time > intervalEnd)
+		{
+			highestStrains.push_back(maxStrain);
+
+			// the first object of the next section starts with the decayed strain of the previous object
+			if (i > 0)
+			{
+				const DIFFOBJ &prev = objects[i-1];
+				const double decay = std::pow(DECAY_BASE[skill], ((intervalEnd - prev.time) / speedMultiplier) / 1000.0);
+				maxStrain = prev.strains[skill] * decay;
+			}
+			else
+				maxStrain = 0.0;
+
+			intervalEnd += strainStep;
+		}
+
+		maxStrain = std::max(maxStrain, cur.strains[skill]);
+	}
+	highestStrains.push_back(maxStrain);
+
+	// weigh the peaks, hardest sections count the most
+	std::sort(highestStrains.begin(), highestStrains.end(), std::greater<double>());
+
+	double difficulty = 0.0;
+	double weight = 1.0;
+	for (int i=0; i<highestStrains.size(); i++)
+	{
+		difficulty += highestStrains[i] * weight;
+		weight *= DECAY_WEIGHT;
+	}
+
+	return difficulty;
+}
+
+double OsuDifficultyCalculator::spacingWeight(double distance, SKILL skill)
+{
+	switch (skill)
+	{
+	case SKILL_SPEED:
+		if (distance > SINGLE_SPACING)
+			return 2.5;
+		else if (distance > STREAM_SPACING)
+			return 1.6 + 0.9 * (distance - STREAM_SPACING) / (SINGLE_SPACING - STREAM_SPACING);
+		else if (distance > ALMOST_DIAMETER)
+			return 1.2 + 0.4 * (distance - ALMOST_DIAMETER) / (STREAM_SPACING - ALMOST_DIAMETER);
+		else if (distance > ALMOST_DIAMETER / 2.0)
+			return 0.95 + 0.25 * (distance - ALMOST_DIAMETER / 2.0) / (ALMOST_DIAMETER / 2.0);
+		return 0.95;
+
+	case SKILL_AIM:
+		return std::pow(distance, 0.99);
+	}
+
+	return 0.0;
+}
+
+Vector2 OsuDifficultyCalculator::getSliderEndPosition(const std::vector<Vector2> &points, float pixelLength, int repeat)
+{
+	// sliders with an even number of spans end where they started
+	if (points.size() < 2 || repeat % 2 == 0)
+		return points[0];
+
+	// walk along the control polygon until pixelLength is used up
+	// this is exact for linear sliders, and a close enough approximation of the end position for curved ones (which would need a full OsuSliderCurve)
+	float remaining = pixelLength;
+	for (int i=1; i<points.size(); i++)
+	{
+		const Vector2 segment = points[i] - points[i-1];
+		const float segmentLength = segment.length();
+		if (segmentLength <= 0.0f)
+			continue;
+
+		if (remaining <= segmentLength)
+			return points[i-1] + segment*(remaining / segmentLength);
+
+		remaining -= segmentLength;
+	}
+
+	return points[points.size()-1];
+}
+
+double OsuDifficultyCalculator::calculatePP(OsuBeatmapDifficulty *diff, const STARS &stars, int mods, PP_INPUT input)
+{
+	const int numObjects = stars.numCircles + stars.numSliders + stars.numSpinners;
+	if (numObjects < 1)
+		return 0.0;
+
+	// fill in defaults
+	const int maxCombo = std::max(stars.maxCombo, 1);
+	const int combo = (input.combo < 0 ? maxCombo : std::min(input.combo, maxCombo));
+	const int numMisses = clamp<int>(input.numMisses, 0, numObjects);
+	const int num100s = std::max(input.num100s, 0);
+	const int num50s = std::max(input.num50s, 0);
+	const int num300s = (input.num300s < 0 ? std::max(numObjects - num100s - num50s - numMisses, 0) : input.num300s);
+	const int totalHits = num300s + num100s + num50s + numMisses;
+
+	const double accuracy = (totalHits > 0 ? clamp<double>((double)(num50s*50 + num100s*100 + num300s*300) / (double)(totalHits*300), 0.0, 1.0) : 0.0);
+
+	const double AR = getModAR(diff->AR, mods);
+	const double OD = getModOD(diff->OD, mods);
+
+	// length bonus, applies to aim and speed
+	double lengthBonus = 0.95 + 0.4 * std::min(1.0, (double)totalHits / 2000.0);
+	if (totalHits > 2000)
+		lengthBonus += std::log10((double)totalHits / 2000.0) * 0.5;
+
+	const double missPenalty = std::pow(0.97, (double)numMisses);
+	const double comboScaling = std::min(std::pow((double)combo, 0.8) / std::pow((double)maxCombo, 0.8), 1.0);
+
+	// aim
+	double aimValue = std::pow(5.0 * std::max(1.0, stars.aimStars / STAR_SCALING_FACTOR) - 4.0, 3.0) / 100000.0;
+	aimValue *= lengthBonus * missPenalty * comboScaling;
+	{
+		double approachRateFactor = 1.0;
+		if (AR > 10.33)
+			approachRateFactor += 0.45 * (AR - 10.33);
+		else if (AR < 8.0)
+		{
+			const double lowARBonus = 0.01 * (8.0 - AR);
+			approachRateFactor += ((mods & OsuReplay::Mods::Hidden) ? 2.0*lowARBonus : lowARBonus);
+		}
+		aimValue *= approachRateFactor;
+	}
+	if (mods & OsuReplay::Mods::Hidden)
+		aimValue *= 1.18;
+	if (mods & OsuReplay::Mods::Flashlight)
+		aimValue *= 1.45 * lengthBonus;
+	aimValue *= 0.5 + accuracy / 2.0;
+	aimValue *= 0.98 + OD*OD / 2500.0;
+
+	// speed
+	double speedValue = std::pow(5.0 * std::max(1.0, stars.speedStars / STAR_SCALING_FACTOR) - 4.0, 3.0) / 100000.0;
+	speedValue *= lengthBonus * missPenalty * comboScaling;
+	speedValue *= 0.5 + accuracy / 2.0;
+	speedValue *= 0.98 + OD*OD / 2500.0;
+
+	// accuracy, only circles count since sliders are trivial to get 300s on
+	double betterAccuracyPercentage = 0.0;
+	if (stars.numCircles > 0)
+		betterAccuracyPercentage = std::max(0.0, (double)((num300s - (totalHits - stars.numCircles))*6 + num100s*2 + num50s) / (double)(stars.numCircles*6));
+	double accValue = std::pow(1.52163, OD) * std::pow(betterAccuracyPercentage, 24.0) * 2.83;
+	accValue *= std::min(1.15, std::pow((double)stars.numCircles / 1000.0, 0.3));
+	if (mods & OsuReplay::Mods::Hidden)
+		accValue *= 1.02;
+	if (mods & OsuReplay::Mods::Flashlight)
+		accValue *= 1.02;
+
+	// total
+	double multiplier = 1.12;
+	if (mods & OsuReplay::Mods::NoFail)
+		multiplier *= 0.90;
+	if (mods & OsuReplay::Mods::SpunOut)
+		multiplier *= 0.95;
+
+	return std::pow(std::pow(aimValue, 1.1) + std::pow(speedValue, 1.1) + std::pow(accValue, 1.1), 1.0 / 1.1) * multiplier;
+}
+
+double OsuDifficultyCalculator::calculatePPForAccuracy(OsuBeatmapDifficulty *diff, const STARS &stars, int mods, float accuracy)
+{
+	const int numObjects = stars.numCircles + stars.numSliders + stars.numSpinners;
+
+	// accuracy = (300*n300 + 100*n100) / (300*n), with n300 + n100 = n
+	const int num100s = clamp<int>((int)std::round((1.0f - clamp<float>(accuracy, 0.0f, 1.0f)) * 1.5f * (float)numObjects), 0, numObjects);
+
+	PP_INPUT input;
+	input.combo = -1;
+	input.num300s = numObjects - num100s;
+	input.num100s = num100s;
+	input.num50s = 0;
+	input.numMisses = 0;
+
+	return calculatePP(diff, stars, mods, input);
+}
+
+float OsuDifficultyCalculator::getModSpeedMultiplier(int mods)
+{
+	if ((mods & OsuReplay::Mods::DoubleTime) || (mods & OsuReplay::Mods::Nightcore))
+		return 1.5f;
+	if (mods & OsuReplay::Mods::HalfTime)
+		return 0.75f;
+	return 1.0f;
+}
+
+float OsuDifficultyCalculator::getModAR(float AR, int mods)
+{
+	if (mods & OsuReplay::Mods::HardRock)
+		AR = std::min(AR*1.4f, 10.0f);
+	else if (mods & OsuReplay::Mods::Easy)
+		AR *= 0.5f;
+
+	// NOTE: not using OsuGameRules::getMinApproachTime() etc. here, since those are affected by experimental mods
+	const float approachTime = OsuGameRules::mapDifficultyRange(AR, 1800.0f, 1200.0f, 450.0f) / getModSpeedMultiplier(mods);
+	return OsuGameRules::mapDifficultyRangeInv(approachTime, 1800.0f, 1200.0f, 450.0f);
+}
+
+float OsuDifficultyCalculator::getModOD(float OD, int mods)
+{
+	if (mods & OsuReplay::Mods::HardRock)
+		OD = std::min(OD*1.4f, 10.0f);
+	else if (mods & OsuReplay::Mods::Easy)
+		OD *= 0.5f;
+
+	const float hitWindow300 = OsuGameRules::mapDifficultyRange(OD, OsuGameRules::getMinHitWindow300(), OsuGameRules::getMidHitWindow300(), OsuGameRules::getMaxHitWindow300()) / getModSpeedMultiplier(mods);
+	return OsuGameRules::mapDifficultyRangeInv(hitWindow300, OsuGameRules::getMinHitWindow300(), OsuGameRules::getMidHitWindow300(), OsuGameRules::getMaxHitWindow300());
+}
+
+float OsuDifficultyCalculator::getModCS(float CS, int mods)
+{
+	if (mods & OsuReplay::Mods::HardRock)
+		CS = std::min(CS*1.3f, 10.0f);
+	else if (mods & OsuReplay::Mods::Easy)
+		CS *= 0.5f;
+
+	return CS;
+}
+
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+void OsuDifficultyCalculator::test()
+{
+	int numTests = 0;
+	int numFailed = 0;
+
+	// synthetic maps: a 180 bpm 1/4 stream, 1/2 jumps across the playfield, a mix of linear sliders, and a few short bursts separated by long breaks
+	// the breaks are mostly empty strain sections, so the last map is kept short enough for their decayed peaks to still count in the weighted sum
+	const int numMaps = 4;
+	const char *mapNames[numMaps] = {"stream", "jumps", "sliders", "gaps"};
+	const int numObjects = 2000;
+	const int numMapObjects[numMaps] = {numObjects, numObjects, numObjects, 40};
+	const int numBenchmarkMaps = 3; // only the full length ones
+
+	std::vector<OsuBeatmapDifficulty*> maps;
+	for (int m=0; m<numMaps; m++)
+	{
+		OsuBeatmapDifficulty *diff = new OsuBeatmapDifficulty(NULL, "", "");
+		diff->CS = 4.0f;
+		diff->AR = 9.0f;
+		diff->OD = 8.0f;
+		diff->HP = 6.0f;
+
+		for (int i=0; i<numMapObjects[m]; i++)
+		{
+			if (m == 0)
+			{
+				OsuBeatmapDifficulty::HITCIRCLE c;
+				c.x = 256 + (int)(std::cos(i*0.3f)*60.0f);
+				c.y = 192 + (int)(std::sin(i*0.3f)*60.0f);
+				c.time = 1000 + (unsigned long)(i*83.333f);
+				c.sampleType = 0;
+				c.number = (i % 16) + 1;
+				c.colorCounter = i / 16;
+				c.clicked = false;
+				diff->hitcircles.push_back(c);
+			}
+			else if (m == 1)
+			{
+				OsuBeatmapDifficulty::HITCIRCLE c;
+				c.x = (i % 2 == 0 ? 64 : 448);
+				c.y = (i % 4 < 2 ? 64 : 320);
+				c.time = 1000 + (unsigned long)(i*166.667f);
+				c.sampleType = 0;
+				c.number = (i % 8) + 1;
+				c.colorCounter = i / 8;
+				c.clicked = false;
+				diff->hitcircles.push_back(c);
+			}
+			else if (m == 2)
+			{
+				OsuBeatmapDifficulty::SLIDER s;
+				s.type = 'L';
+				s.repeat = 1 + (i % 2);
+				s.pixelLength = 140.0f;
+				s.time = 1000 + (long)(i*500.0f);
+				s.sampleType = 0;
+				s.number = (i % 4) + 1;
+				s.colorCounter = i / 4;
+				s.points.push_back(Vector2(100 + (i % 3)*100, 100 + (i % 2)*150));
+				s.points.push_back(Vector2(240 + (i % 3)*100, 100 + (i % 2)*150));
+				s.sliderTimeWithoutRepeats = 333.333f;
+				s.sliderTime = s.sliderTimeWithoutRepeats*s.repeat;
+				s.ticks.push_back(0.5f);
+				diff->sliders.push_back(s);
+			}
+			else
+			{
+				OsuBeatmapDifficulty::HITCIRCLE c;
+				c.x = 128 + (i % 4)*80;
+				c.y = (i % 8 < 4 ? 96 : 288);
+				c.time = 1000 + (unsigned long)((i / 4)*3250 + (i % 4)*83.333f);
+				c.sampleType = 0;
+				c.number = (i % 4) + 1;
+				c.colorCounter = i / 4;
+				c.clicked = false;
+				diff->hitcircles.push_back(c);
+			}
+		}
+
+		maps.push_back(diff);
+	}
+
+	// goldens from a separate (python) implementation of the same formulas (osu!standard ppv2 as of 2016, as implemented by e.g. oppai), not from this code
+	struct GOLDEN
+	{
+		const char *mapName;
+		int mods;
+		double totalStars;
+		double aimStars;
+		double speedStars;
+		int maxCombo;
+		double pp100;
+		double pp95;
+	};
+	const GOLDEN goldens[] =
+	{
+		{"stream", 0, 4.9206, 1.5573, 2.7613, 2000, 228.647, 158.835},
+		{"stream", 16, 4.9846, 1.6852, 2.7613, 2000, 365.461, 200.790},
+		{"stream", 64, 7.3124, 2.3027, 4.1073, 2000, 653.697, 506.866},
+		{"stream", 72, 7.3124, 2.3027, 4.1073, 2000, 668.015, 518.244},
+		{"jumps", 0, 6.9946, 3.8981, 2.2950, 2000, 486.830, 415.790},
+		{"jumps", 16, 7.4747, 4.2182, 2.2950, 2000, 706.854, 545.690},
+		{"jumps", 64, 10.2242, 5.6873, 3.3865, 2000, 1465.995, 1309.784},
+		{"jumps", 72, 10.2242, 5.6873, 3.3865, 2000, 1666.324, 1504.087},
+		{"sliders", 0, 2.2927, 1.2485, 0.8398, 8000, 12.912, 12.589},
+		{"sliders", 16, 2.4464, 1.3510, 0.8398, 8000, 16.037, 15.636},
+		{"sliders", 64, 3.1123, 1.6738, 1.2030, 8000, 34.317, 33.459},
+		{"sliders", 72, 3.1123, 1.6738, 1.2030, 8000, 39.000, 38.025},
+		{"gaps", 0, 3.7886, 1.8978, 1.8838, 40, 80.630, 57.553},
+		{"gaps", 16, 4.3141, 2.0536, 2.1915, 40, 145.095, 91.180},
+		{"gaps", 64, 4.7965, 2.3880, 2.4017, 40, 169.486, 120.810},
+		{"gaps", 72, 4.7965, 2.3880, 2.4017, 40, 179.998, 130.386},
+	};
+	const int numGoldens = sizeof(goldens) / sizeof(goldens[0]);
+
+	for (int g=0; g<numGoldens; g++)
+	{
+		const GOLDEN &golden = goldens[g];
+		int m = 0;
+		while (m < numMaps-1 && strcmp(mapNames[m], golden.mapName) != 0)
+		{
+			m++;
+		}
+
+		const STARS stars = calculateStars(maps[m], golden.mods);
+		const double pp100 = calculatePPForAccuracy(maps[m], stars, golden.mods, 1.0f);
+		const double pp95 = calculatePPForAccuracy(maps[m], stars, golden.mods, 0.95f);
+
+		// the goldens are rounded, and the inputs are floats here
+		const double starsTolerance = 0.0005;
+		const double ppTolerance = 0.001; // relative
+		numTests++;
+		if (std::abs(stars.totalStars - golden.totalStars) > starsTolerance || std::abs(stars.aimStars - golden.aimStars) > starsTolerance || std::abs(stars.speedStars - golden.speedStars) > starsTolerance
+			|| stars.maxCombo != golden.maxCombo || std::abs(pp100 - golden.pp100) > golden.pp100*ppTolerance || std::abs(pp95 - golden.pp95) > golden.pp95*ppTolerance)
+		{
+			numFailed++;
+			debugLog("osu_difficulty_benchmark: FAILED %s (mods = %i): %f stars (aim = %f, speed = %f), maxCombo = %i, pp(100%%) = %f, pp(95%%) = %f, expected %f stars (aim = %f, speed = %f), maxCombo = %i, pp(100%%) = %f, pp(95%%) = %f\n",
+					golden.mapName, golden.mods, stars.totalStars, stars.aimStars, stars.speedStars, stars.maxCombo, pp100, pp95,
+					golden.totalStars, golden.aimStars, golden.speedStars, golden.maxCombo, golden.pp100, golden.pp95);
+		}
+	}
+
+	// throughput
+	Timer t;
+	t.start();
+	int numCalculated = 0;
+	do
+	{
+		calculateStars(maps[numCalculated % numBenchmarkMaps], OsuReplay::Mods::None);
+		numCalculated++;
+		t.update();
+	}
+	while (t.getElapsedTime() < 1.0);
+	debugLog("osu_difficulty_benchmark: %f maps per second (%i objects per map)\n", (double)numCalculated / t.getElapsedTime(), numObjects);
+
+	for (int m=0; m<maps.size(); m++)
+	{
+		delete maps[m];
+	}
+
+	debugLog("osu_difficulty_benchmark: %s, %i/%i passed\n", numFailed == 0 ? "PASSED" : "FAILED", numTests - numFailed, numTests);
+}
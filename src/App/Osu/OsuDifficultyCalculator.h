@@ -0,0 +1,85 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		star rating + pp calculation (osu!standard, aim/speed strains)
+//
+// $NoKeywords: $osudiffcalc
+//===============================================================================//
+
+#ifndef OSUDIFFICULTYCALCULATOR_H
+#define OSUDIFFICULTYCALCULATOR_H
+
+#include "cbase.h"
+
+class OsuBeatmapDifficulty;
+
+class OsuDifficultyCalculator
+{
+public:
+	struct STARS
+	{
+		double aimStars;
+		double speedStars;
+		double totalStars;
+		int numCircles;
+		int numSliders;
+		int numSpinners;
+		int maxCombo;
+	};
+
+	struct PP_INPUT
+	{
+		int combo; // -1 = full combo
+		int num300s; // -1 = calculated from everything else (all remaining objects are 300s)
+		int num100s;
+		int num50s;
+		int numMisses;
+	};
+
+public:
+	// works on the raw hitobject data only (OsuBeatmapDifficulty::loadHitObjectsRaw()), without creating any OsuHitObjects
+	// mods is a bitmask of OsuReplay::Mods, only the difficulty relevant ones (EZ/HR/DT/NC/HT) are taken into account
+	static STARS calculateStars(OsuBeatmapDifficulty *diff, int mods);
+
+	// mods is a bitmask of OsuReplay::Mods
+	static double calculatePP(OsuBeatmapDifficulty *diff, const STARS &stars, int mods, PP_INPUT input);
+	static double calculatePPForAccuracy(OsuBeatmapDifficulty *diff, const STARS &stars, int mods, float accuracy); // accuracy in [0, 1], 100s only, full combo, no misses
+
+	static float getModSpeedMultiplier(int mods);
+	static float getModAR(float AR, int mods); // including speed changes
+	static float getModOD(float OD, int mods); // including speed changes
+	static float getModCS(float CS, int mods);
+
+	static void test(); // stars/pp of synthetic maps against goldens + throughput benchmark (osu_difficulty_benchmark)
+
+private:
+	static const double STAR_SCALING_FACTOR;
+	static const double EXTREME_SCALING_FACTOR;
+	static const double STRAIN_STEP;
+	static const double DECAY_WEIGHT;
+	static const double DECAY_BASE[2];
+	static const double WEIGHT_SCALING[2];
+	static const double ALMOST_DIAMETER;
+	static const double STREAM_SPACING;
+	static const double SINGLE_SPACING;
+
+	enum SKILL
+	{
+		SKILL_SPEED = 0,
+		SKILL_AIM = 1
+	};
+
+	struct DIFFOBJ
+	{
+		Vector2 normStart;
+		Vector2 normEnd;
+		double time;
+		bool isSpinner;
+		double strains[2];
+	};
+
+	static double calculateSkill(std::vector<DIFFOBJ> &objects, SKILL skill, double speedMultiplier);
+	static double spacingWeight(double distance, SKILL skill);
+	static Vector2 getSliderEndPosition(const std::vector<Vector2> &points, float pixelLength, int repeat);
+};
+
+#endif
@@ -0,0 +1,44 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		everything the judgement/timing code needs to know about AR/CS/OD/HP
+//
+// $NoKeywords: $osuds
+//===============================================================================//
+
+#ifndef OSUDIFFICULTYSNAPSHOT_H
+#define OSUDIFFICULTYSNAPSHOT_H
+
+// built by OsuGameRules::getDifficultySnapshot(), owned and kept up to date by OsuBeatmap
+// it is only rebuilt if any of its inputs (mods, overrides, speed, ...) change, time-varying mods (artimewarp, arwobble, minimize) only patch the affected values every frame
+struct OsuDifficultySnapshot
+{
+	// final values (all mods and overrides applied)
+	float AR;
+	float CS;
+	float OD;
+	float HP;
+	float speedMultiplier;
+
+	// AR
+	float approachTime;
+	long fadeInTime; // these are calculated exactly like OsuHitObject did it, i.e. from the truncated approach time
+	long hiddenDecayTime;
+	long hiddenTimeDiff;
+
+	// CS
+	float rawHitcircleDiameter; // in osu!pixels
+	float stackOffset; // in osu!pixels
+
+	// OD
+	float hitWindow300;
+	float hitWindow100;
+	float hitWindow50;
+	float hitWindowMiss;
+	bool hitWindow100Disabled; // osu_mod_ming3012
+	float spinnerSpins; // spins per second
+
+	// speed
+	float fadeOutTime; // in seconds
+};
+
+#endif
@@ -9,6 +9,93 @@
 #include "Engine.h"
 #include "File.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32) || defined(_WIN64) || defined(__WIN32__) || defined(__CYGWIN__) || defined(__CYGWIN32__) || defined(__TOS_WIN__) || defined(__WINDOWS__)
+
+#include <windows.h>
+#include <io.h>
+#define OSU_FSYNC(file) _commit(_fileno(file))
+
+#else
+
+#include <unistd.h>
+#define OSU_FSYNC(file) fsync(fileno(file))
+
+#endif
+
+bool OsuFile::writeFileAtomic(UString filePath, const void *data, size_t size)
+{
+	UString tempFilePath = filePath;
+	tempFilePath.append(".tmp");
+
+	FILE *file = fopen(tempFilePath.toUtf8(), "wb");
+	if (file == NULL)
+	{
+		debugLog("OsuFile: Couldn't open %s for writing\n", tempFilePath.toUtf8());
+		return false;
+	}
+
+	const bool success = ((size < 1 || fwrite(data, 1, size, file) == size) && flushToDisk(file));
+	fclose(file);
+
+	if (!success)
+	{
+		debugLog("OsuFile: Couldn't write %s\n", tempFilePath.toUtf8());
+		std::remove(tempFilePath.toUtf8());
+		return false;
+	}
+
+	return replaceFile(tempFilePath, filePath);
+}
+
+bool OsuFile::flushToDisk(FILE *file)
+{
+	return (fflush(file) == 0 && OSU_FSYNC(file) == 0);
+}
+
+bool OsuFile::replaceFile(UString tempFilePath, UString filePath)
+{
+#if defined(_WIN32) || defined(_WIN64) || defined(__WIN32__) || defined(__CYGWIN__) || defined(__CYGWIN32__) || defined(__TOS_WIN__) || defined(__WINDOWS__)
+	// rename() fails if the target exists, and removing it first would leave nothing behind if we crash in between
+	const bool success = (MoveFileExW(tempFilePath.wc_str(), filePath.wc_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0);
+#else
+	const bool success = (std::rename(tempFilePath.toUtf8(), filePath.toUtf8()) == 0);
+#endif
+
+	if (!success)
+	{
+		debugLog("OsuFile: Couldn't rename %s to %s\n", tempFilePath.toUtf8(), filePath.toUtf8());
+		std::remove(tempFilePath.toUtf8());
+	}
+
+	return success;
+}
+
+UString OsuFile::getTempFilePath(UString fileName)
+{
+	const char *envVars[] = {"TMPDIR", "TEMP", "TMP"};
+	UString folder;
+	for (int i=0; i<3 && folder.length() < 1; i++)
+	{
+		const char *value = getenv(envVars[i]);
+		if (value != NULL)
+			folder = UString(value);
+	}
+
+#if !defined(_WIN32) && !defined(_WIN64) && !defined(__WIN32__) && !defined(__CYGWIN__) && !defined(__CYGWIN32__) && !defined(__TOS_WIN__) && !defined(__WINDOWS__)
+	if (folder.length() < 1)
+		folder = "/tmp";
+#endif
+
+	if (folder.length() > 0 && folder[folder.length()-1] != L'/' && folder[folder.length()-1] != L'\\')
+		folder.append("/");
+
+	folder.append(fileName);
+	return folder;
+}
+
 OsuFile::OsuFile(UString filepath, bool read)
 {
 	m_bReady = false;
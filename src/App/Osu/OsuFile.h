@@ -22,6 +22,15 @@ public:
 		bool notinherited;
 	};
 
+public:
+	// crash safe replacement for our own databases/caches: everything goes into filePath + ".tmp" first, which is flushed to disk and then atomically renamed over filePath
+	// (MoveFileExW(MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) on windows, rename() everywhere else), so there is always either the complete old or the complete new file
+	static bool writeFileAtomic(UString filePath, const void *data, size_t size);
+	static bool flushToDisk(FILE *file); // fflush() + fsync()/_commit()
+	static bool replaceFile(UString tempFilePath, UString filePath); // the atomic rename part of writeFileAtomic(), for callers which stream into the temp file themselves
+
+	static UString getTempFilePath(UString fileName); // in the system's temp folder, for the self tests, so that they don't litter the working directory
+
 public:
 	OsuFile(UString filepath, bool read = true);
 	virtual ~OsuFile();
@@ -0,0 +1,426 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		precomputed followpoint segments, drawn in one batch
+//
+// $NoKeywords: $osufp
+//===============================================================================//
+
+#include "OsuFollowPoints.h"
+
+#include "Engine.h"
+#include "ResourceManager.h"
+#include "VertexArrayObject.h"
+#include "ConVar.h"
+#include "Timer.h"
+
+#include "Osu.h"
+#include "OsuSkin.h"
+#include "OsuBeatmap.h"
+#include "OsuBeatmapDifficulty.h"
+#include "OsuHitObjectFactory.h"
+#include "OsuGameRules.h"
+#include "OsuRecordingGraphics.h"
+
+#include "OsuHitObject.h"
+#include "OsuCircle.h"
+#include "OsuSlider.h"
+#include "OsuSpinner.h"
+
+ConVar osu_followpoints_approachtime("osu_followpoints_approachtime", 800.0f);
+ConVar osu_followpoints_prevfadetime("osu_followpoints_prevfadetime", 200.0f);
+ConVar osu_followpoints_scale_multiplier("osu_followpoints_scale_multiplier", 1.0f);
+
+OsuFollowPoints::OsuFollowPoints(OsuBeatmap *beatmap)
+{
+	m_beatmap = beatmap;
+
+	m_iCursor = 0;
+	m_iLastCurPos = 0;
+}
+
+void OsuFollowPoints::build(const OsuHitObjectFactory *factory)
+{
+	m_segments.clear();
+	m_iCursor = 0;
+
+	// one segment between every two consecutive objects of the same combo, spinners neither start nor end one
+	for (int i=1; i<factory->getNumObjects(); i++)
+	{
+		if (factory->isSpinner(i) || factory->isSpinner(i-1) || factory->getComboNumber(i) == 1)
+			continue;
+
+		SEGMENT segment;
+		segment.startRawPos = factory->getRawTailPos(i-1);
+		segment.endRawPos = factory->getRawStartPos(i);
+		segment.startTime = factory->getTime(i-1) + factory->getDuration(i-1) + 1;
+		segment.endTime = factory->getTime(i);
+		m_segments.push_back(segment);
+	}
+}
+
+void OsuFollowPoints::draw(Graphics *g, long curPos)
+{
+	getDots(curPos, &m_dots);
+	if (m_dots.size() < 1)
+		return;
+
+	Image *followPoint = m_beatmap->getSkin()->getFollowPoint();
+	const float halfWidth = followPoint->getWidth() / 2.0f;
+	const float halfHeight = followPoint->getHeight() / 2.0f;
+
+	// one quad per dot, with the same transformation which drawImage() used to get through rotate() + scale() + translate()
+	VertexArrayObject vao(Graphics::PRIMITIVE::PRIMITIVE_QUADS);
+	for (int i=0; i<m_dots.size(); i++)
+	{
+		const DOT &dot = m_dots[i];
+		const Vector2 axisX = Vector2(std::cos(dot.angle), std::sin(dot.angle)) * dot.scale;
+		const Vector2 axisY = Vector2(-axisX.y, axisX.x);
+		const Color color = COLOR((int)(clamp<float>(dot.alpha, 0.0f, 1.0f)*255.0f), 255, 255, 255);
+
+		vao.addTexcoord(0, 0);
+		vao.addColor(color);
+		vao.addVertex(dot.pos - axisX*halfWidth - axisY*halfHeight);
+
+		vao.addTexcoord(0, 1);
+		vao.addColor(color);
+		vao.addVertex(dot.pos - axisX*halfWidth + axisY*halfHeight);
+
+		vao.addTexcoord(1, 1);
+		vao.addColor(color);
+		vao.addVertex(dot.pos + axisX*halfWidth + axisY*halfHeight);
+
+		vao.addTexcoord(1, 0);
+		vao.addColor(color);
+		vao.addVertex(dot.pos + axisX*halfWidth - axisY*halfHeight);
+	}
+
+	g->setColor(0xffffffff);
+	OsuRecordingGraphics::bindImage(followPoint);
+	g->drawVAO(&vao);
+	OsuRecordingGraphics::unbindImage(followPoint);
+}
+
+void OsuFollowPoints::getDots(long curPos, std::vector<DOT> *dots)
+{
+	dots->clear();
+
+	OsuSkin *skin = m_beatmap->getSkin();
+
+	const long approachTime = std::min((long)m_beatmap->getDifficulty().approachTime, (long)osu_followpoints_approachtime.getFloat());
+	const float prevFadeTime = osu_followpoints_prevfadetime.getFloat();
+
+	// the followpoints are scaled by one eighth of the hitcirclediameter (not the raw diameter, but the scaled diameter)
+	const float followPointImageScale = ((m_beatmap->getHitcircleDiameter()/8.0f) / (16.0f * (skin->isFollowPoint2x() ? 2.0f : 1.0f))) * osu_followpoints_scale_multiplier.getFloat();
+	const int followPointSeparation = Osu::getUIScale(m_beatmap->getOsu(), 32);
+
+	// the cursor only moves forwards while playing, seeking back has to start over
+	if (curPos < m_iLastCurPos)
+		m_iCursor = 0;
+	m_iLastCurPos = curPos;
+
+	// skip everything which has completely faded out (the last dot of a segment fades out at its end time at the latest)
+	while (m_iCursor < m_segments.size() && std::max(m_segments[m_iCursor].startTime, m_segments[m_iCursor].endTime) + (long)prevFadeTime <= curPos)
+	{
+		m_iCursor++;
+	}
+
+	for (int i=m_iCursor; i<m_segments.size(); i++)
+	{
+		const SEGMENT &segment = m_segments[i];
+
+		if (std::max(segment.startTime, segment.endTime) + (long)prevFadeTime > curPos)
+		{
+			const long timeDiff = segment.endTime - segment.startTime;
+
+			// the playfield transformation can change every frame (mirroring, rotation, wobble), so only the raw positions are precomputed
+			const Vector2 startPoint = m_beatmap->osuCoords2Pixels(segment.startRawPos);
+			const Vector2 endPoint = m_beatmap->osuCoords2Pixels(segment.endRawPos);
+
+			const Vector2 diff = endPoint - startPoint;
+			const float dist = std::round(diff.length() * 100.0f) / 100.0f; // rounded to avoid flicker with playfield rotations
+			const float angle = std::atan2(diff.y, diff.x);
+
+			// all points between the two objects
+			for (int j=(int)(followPointSeparation * 1.5f); j<dist-followPointSeparation; j+=followPointSeparation)
+			{
+				const float animRatio = ((float)j / dist);
+
+				const long fadeInTime = (long)(segment.startTime + animRatio * timeDiff) - approachTime;
+				const long fadeOutTime = (long)(segment.startTime + animRatio * timeDiff);
+
+				// trail alpha
+				float alpha = 0.0f;
+				if (curPos >= fadeInTime && curPos < fadeOutTime)
+					alpha = (float)(curPos - fadeInTime) / (float)approachTime; // future trail
+				else if (curPos >= fadeOutTime && curPos < fadeOutTime+(long)prevFadeTime)
+					alpha = 1.0f - (float)(curPos - fadeOutTime) / prevFadeTime; // previous trail
+
+				if (alpha <= 0.0f)
+					continue;
+
+				const Vector2 animPosStart = startPoint + (animRatio - 0.1f) * diff;
+				const Vector2 finalPos = startPoint + animRatio * diff;
+
+				float followAnimPercent = clamp<float>((float)(curPos - fadeInTime)/prevFadeTime, 0.0f, 1.0f);
+				followAnimPercent = -followAnimPercent*(followAnimPercent-2); // quad out
+
+				DOT dot;
+				dot.pos = animPosStart + (finalPos - animPosStart)*followAnimPercent;
+				dot.scale = followPointImageScale * (1.5f - 0.5f*followAnimPercent);
+				dot.angle = angle;
+				dot.alpha = alpha;
+				dots->push_back(dot);
+			}
+		}
+
+		// same horizon as the objects themselves, nothing after this can be visible yet
+		if (segment.endTime >= curPos + approachTime)
+			break;
+	}
+}
+
+
+
+// the previous implementation (walking the drawable hitobjects every frame), only used as a reference by the test below
+static void getFollowPointDotsReference(OsuBeatmap *beatmap, std::vector<OsuHitObject*> &hitobjects, int previousFollowPointObjectIndex, long curPos, std::vector<OsuFollowPoints::DOT> *dots)
+{
+	dots->clear();
+
+	OsuSkin *skin = beatmap->getSkin();
+
+	const long approachTime = std::min((long)beatmap->getDifficulty().approachTime, (long)osu_followpoints_approachtime.getFloat());
+	const float followPointImageScale = ((beatmap->getHitcircleDiameter()/8.0f) / (16.0f * (skin->isFollowPoint2x() ? 2.0f : 1.0f))) * osu_followpoints_scale_multiplier.getFloat();
+
+	int lastObjectIndex = -1;
+	for (int index=previousFollowPointObjectIndex; index<hitobjects.size(); index++)
+	{
+		lastObjectIndex = index-1;
+
+		if (dynamic_cast<OsuSpinner*>(hitobjects[index]) != NULL)
+		{
+			lastObjectIndex = -1;
+			continue;
+		}
+
+		if (lastObjectIndex >= 0 && hitobjects[index]->getComboNumber() != 1)
+		{
+			if (dynamic_cast<OsuSpinner*>(hitobjects[lastObjectIndex]) != NULL)
+			{
+				lastObjectIndex = -1;
+				continue;
+			}
+
+			const long lastObjectEndTime = hitobjects[lastObjectIndex]->getTime() + hitobjects[lastObjectIndex]->getDuration() + 1;
+			const long objectStartTime = hitobjects[index]->getTime();
+			const long timeDiff = objectStartTime - lastObjectEndTime;
+
+			const Vector2 startPoint = beatmap->osuCoords2Pixels(hitobjects[lastObjectIndex]->getRawPosAt(lastObjectEndTime));
+			const Vector2 endPoint = beatmap->osuCoords2Pixels(hitobjects[index]->getRawPosAt(objectStartTime));
+
+			const float xDiff = endPoint.x - startPoint.x;
+			const float yDiff = endPoint.y - startPoint.y;
+			const Vector2 diff = endPoint - startPoint;
+			const float dist = std::round(diff.length() * 100.0f) / 100.0f;
+
+			const int followPointSeparation = Osu::getUIScale(beatmap->getOsu(), 32);
+			for (int j=(int)(followPointSeparation * 1.5f); j<dist-followPointSeparation; j+=followPointSeparation)
+			{
+				const float animRatio = ((float)j / dist);
+
+				const Vector2 animPosStart = startPoint + (animRatio - 0.1f) * diff;
+				const Vector2 finalPos = startPoint + animRatio * diff;
+
+				const long fadeInTime = (long)(lastObjectEndTime + animRatio * timeDiff) - approachTime;
+				const long fadeOutTime = (long)(lastObjectEndTime + animRatio * timeDiff);
+
+				float alpha = 1.0f;
+				float followAnimPercent = clamp<float>((float)(curPos - fadeInTime)/(float)osu_followpoints_prevfadetime.getFloat(), 0.0f, 1.0f);
+				followAnimPercent = -followAnimPercent*(followAnimPercent-2);
+
+				const float scale = 1.5f - 0.5f*followAnimPercent;
+				const Vector2 followPos = animPosStart + (finalPos - animPosStart)*followAnimPercent;
+
+				if (curPos >= fadeInTime && curPos < fadeOutTime)
+				{
+					const float delta = curPos - fadeInTime;
+					alpha = (float)delta / (float)approachTime;
+				}
+				else if (curPos >= fadeOutTime && curPos < fadeOutTime+(long)osu_followpoints_prevfadetime.getFloat())
+				{
+					const long delta = curPos - fadeOutTime;
+					alpha = 1.0f - (float)delta / (float)(osu_followpoints_prevfadetime.getFloat());
+				}
+				else
+					alpha = 0.0f;
+
+				// the old code drew invisible dots too
+				if (alpha <= 0.0f)
+					continue;
+
+				OsuFollowPoints::DOT dot;
+				dot.pos = followPos;
+				dot.scale = followPointImageScale*scale;
+				dot.angle = atan2(yDiff, xDiff);
+				dot.alpha = alpha;
+				dots->push_back(dot);
+			}
+		}
+
+		lastObjectIndex = index;
+
+		if (hitobjects[index]->getTime() >= curPos + approachTime)
+			break;
+	}
+}
+
+void OsuFollowPoints::test(OsuBeatmap *beatmap, int numObjects)
+{
+	beatmap->updateDifficulty();
+
+	const float approachTime = beatmap->getDifficulty().approachTime;
+	const float stackOffset = beatmap->getRawHitcircleDiameter() * 0.05f;
+
+	// synthetic jump map: 1/2 circles jumping across the playfield, new combos every 8 objects, the occasional (stacked) slider and spinner
+	OsuBeatmapDifficulty diff(NULL, "", "");
+	diff.stackLeniency = 0.7f;
+	long time = 1000;
+	for (int i=0; i<numObjects; i++)
+	{
+		if (i % 500 == 499)
+		{
+			OsuBeatmapDifficulty::SPINNER s;
+			s.x = 256;
+			s.y = 192;
+			s.time = time;
+			s.sampleType = 0;
+			s.endTime = time + 2000;
+			diff.spinners.push_back(s);
+
+			time += 3000;
+		}
+		else if (i % 10 == 9)
+		{
+			OsuBeatmapDifficulty::SLIDER s;
+			s.type = OsuSlider::SLIDER_LINEAR;
+			s.repeat = 1 + (i % 2);
+			s.pixelLength = 150.0f;
+			s.time = time;
+			s.sampleType = 0;
+			s.number = (i % 8) + 1;
+			s.colorCounter = i / 8;
+			s.points.push_back(Vector2(64 + (i % 3)*150, 64 + (i % 4)*80));
+			s.points.push_back(Vector2(214 + (i % 3)*150, 64 + (i % 4)*80));
+			OsuBeatmapDifficulty::calculateSliderEvents(&s, 500.0f, 500.0f, 2.5f, 1.0f);
+			for (int r=0; r<s.repeat+1; r++)
+			{
+				s.hitSounds.push_back(0);
+			}
+			diff.sliders.push_back(s);
+
+			time += (long)s.sliderTime + 200;
+		}
+		else
+		{
+			OsuBeatmapDifficulty::HITCIRCLE c;
+			c.x = (i % 2 == 0 ? 32 + (i % 7)*8 : 480 - (i % 5)*8);
+			c.y = (i % 16 < 2 ? 192 : 32 + (i % 11)*30);
+			c.time = time;
+			c.sampleType = 0;
+			c.number = (i % 8) + 1;
+			c.colorCounter = i / 8;
+			c.clicked = false;
+			diff.hitcircles.push_back(c);
+
+			time += 150;
+		}
+	}
+
+	std::vector<OsuHitObject*> objects;
+	std::vector<OsuHitObject*> objectsSortedByEndTime;
+	OsuHitObjectFactory *factory = new OsuHitObjectFactory(beatmap, &diff, &objects, &objectsSortedByEndTime);
+	factory->calculateStacks(approachTime, stackOffset);
+	factory->createAll();
+
+	OsuFollowPoints followPoints(beatmap);
+	followPoints.build(factory);
+
+	// simulate gameplay at 60 fps (and a few seeks back), the previous implementation gets the same start index as OsuBeatmap::update() used to give it
+	const long prevFadeTime = (long)osu_followpoints_prevfadetime.getFloat();
+	std::vector<DOT> dots;
+	std::vector<DOT> referenceDots;
+	int numFrames = 0;
+	int numDots = 0;
+	int numMismatches = 0;
+	int previousFollowPointObjectIndex = 0;
+	for (long curPos=0; curPos<factory->getLastEndTime()+1000; curPos+=16)
+	{
+		if (curPos % 10000 < 16 && curPos > 20000)
+		{
+			followPoints.getDots(curPos - 15000, &dots); // seek back, and forwards again
+			previousFollowPointObjectIndex = 0;
+		}
+
+		for (int i=previousFollowPointObjectIndex; i<objects.size(); i++)
+		{
+			if (objects[i]->getTime() > curPos)
+				break;
+			if (curPos > objects[i]->getTime() + objects[i]->getDuration() + prevFadeTime)
+				previousFollowPointObjectIndex = i;
+		}
+
+		followPoints.getDots(curPos, &dots);
+		getFollowPointDotsReference(beatmap, objects, previousFollowPointObjectIndex, curPos, &referenceDots);
+
+		numFrames++;
+		numDots += referenceDots.size();
+		if (dots.size() != referenceDots.size())
+		{
+			numMismatches++;
+			continue;
+		}
+		for (int i=0; i<dots.size(); i++)
+		{
+			if ((dots[i].pos - referenceDots[i].pos).length() > 0.01f || std::abs(dots[i].scale - referenceDots[i].scale) > 0.0001f || std::abs(dots[i].angle - referenceDots[i].angle) > 0.0001f || std::abs(dots[i].alpha - referenceDots[i].alpha) > 0.0001f)
+			{
+				numMismatches++;
+				break;
+			}
+		}
+	}
+
+	// per-frame cost of the dot generation (the old code additionally did one push/pop transform and one draw call per dot)
+	Timer t;
+	t.start();
+	previousFollowPointObjectIndex = 0;
+	for (long curPos=0; curPos<factory->getLastEndTime()+1000; curPos+=16)
+	{
+		for (int i=previousFollowPointObjectIndex; i<objects.size(); i++)
+		{
+			if (objects[i]->getTime() > curPos)
+				break;
+			if (curPos > objects[i]->getTime() + objects[i]->getDuration() + prevFadeTime)
+				previousFollowPointObjectIndex = i;
+		}
+		getFollowPointDotsReference(beatmap, objects, previousFollowPointObjectIndex, curPos, &referenceDots);
+	}
+	t.update();
+	const double referenceTime = t.getElapsedTime();
+
+	t.start();
+	for (long curPos=0; curPos<factory->getLastEndTime()+1000; curPos+=16)
+	{
+		followPoints.getDots(curPos, &dots);
+	}
+	t.update();
+	const double segmentTime = t.getElapsedTime();
+
+	debugLog("osu_followpoints_test: %i objects, %i segments, %i frames, %i dots\n", numObjects, followPoints.getNumSegments(), numFrames, numDots);
+	debugLog("osu_followpoints_test: %f ms per frame (per-object), %f ms per frame (segments)\n", (referenceTime*1000.0) / numFrames, (segmentTime*1000.0) / numFrames);
+	debugLog("osu_followpoints_test: %s (%i mismatching frames)\n", numMismatches == 0 ? "PASSED" : "FAILED", numMismatches);
+
+	for (int i=0; i<objects.size(); i++)
+	{
+		delete objects[i];
+	}
+	delete factory;
+}
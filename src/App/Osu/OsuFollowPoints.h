@@ -0,0 +1,57 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		precomputed followpoint segments, drawn in one batch
+//
+// $NoKeywords: $osufp
+//===============================================================================//
+
+#ifndef OSUFOLLOWPOINTS_H
+#define OSUFOLLOWPOINTS_H
+
+#include "cbase.h"
+
+class OsuBeatmap;
+class OsuHitObjectFactory;
+
+class OsuFollowPoints
+{
+public:
+	struct DOT
+	{
+		Vector2 pos; // in pixels
+		float scale;
+		float angle; // in radians
+		float alpha;
+	};
+
+public:
+	OsuFollowPoints(OsuBeatmap *beatmap);
+
+	void build(const OsuHitObjectFactory *factory); // when loading, and whenever the stacks change
+
+	void draw(Graphics *g, long curPos);
+	void getDots(long curPos, std::vector<DOT> *dots); // all visible dots at curPos (alpha > 0), in drawing order
+
+	inline int getNumSegments() const {return m_segments.size();}
+
+	static void test(OsuBeatmap *beatmap, int numObjects); // against the previous per-object implementation, + per-frame cost on a jump map (osu_followpoints_test)
+
+private:
+	struct SEGMENT
+	{
+		Vector2 startRawPos; // where the previous object ends
+		Vector2 endRawPos; // where the next object starts
+		long startTime; // end time of the previous object + 1
+		long endTime; // start time of the next object
+	};
+
+	OsuBeatmap *m_beatmap;
+
+	std::vector<SEGMENT> m_segments; // sorted by endTime
+	int m_iCursor; // first segment which may still be visible, only moves forwards unless the time jumps back
+	long m_iLastCurPos;
+
+	std::vector<DOT> m_dots; // reused every frame
+};
+
+#endif
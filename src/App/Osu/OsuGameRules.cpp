@@ -6,6 +6,11 @@
 //===============================================================================//
 
 #include "OsuGameRules.h"
+#include "OsuBeatmapDifficulty.h"
+
+#include "Engine.h"
+#include "ConVar.h"
+#include "Timer.h"
 
 ConVar OsuGameRules::osu_playfield_border_top_percent("osu_playfield_border_top_percent", 0.117f);
 ConVar OsuGameRules::osu_playfield_border_bottom_percent("osu_playfield_border_bottom_percent", 0.0834f);
@@ -27,3 +32,222 @@ ConVar OsuGameRules::osu_slider_followcircle_tick_pulse_scale("osu_slider_follow
 ConVar OsuGameRules::osu_mod_ming3012("osu_mod_ming3012", false);
 ConVar OsuGameRules::osu_mod_millhioref("osu_mod_millhioref", false);
 ConVar OsuGameRules::osu_mod_millhioref_multiplier("osu_mod_millhioref_multiplier", 2.0f);
+
+ConVar OsuGameRules::osu_hitsound_panning("osu_hitsound_panning", 0.8f, "how far hit sounds are panned towards the side of the playfield they are on (carried by the hit sound events, the engine backend doesn't pan yet)");
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+// copies of the per-call formulas from before the snapshot existed (OsuGameRules.h, OsuBeatmap::getAR()/getCS()/getOD() and OsuHitObject::update())
+// the test compares the snapshot against these, and not against the current per-call functions (which partly read the snapshot themselves)
+// the time-varying mods (artimewarp, arwobble, minimize) are not covered, they are disabled during the test
+
+static ConVar *g_legacyAROverride = NULL; // set by the test
+static ConVar *g_legacyCSOverride = NULL;
+static ConVar *g_legacyODOverride = NULL;
+
+static float legacyAR(OsuBeatmap *beatmap)
+{
+	if (beatmap->getSelectedDifficulty() == NULL)
+		return 5.0f;
+
+	float AR = beatmap->getRawAR();
+	if (g_legacyAROverride->getFloat() >= 0.0f)
+		AR = g_legacyAROverride->getFloat();
+
+	return AR;
+}
+
+static float legacyCS(OsuBeatmap *beatmap)
+{
+	if (beatmap->getSelectedDifficulty() == NULL)
+		return 5.0f;
+
+	float CS = clamp<float>(beatmap->getSelectedDifficulty()->CS * beatmap->getOsu()->getCSDifficultyMultiplier(), 0.0f, 10.0f);
+	if (g_legacyCSOverride->getFloat() >= 0.0f)
+		CS = g_legacyCSOverride->getFloat();
+
+	return CS;
+}
+
+static float legacyOD(OsuBeatmap *beatmap)
+{
+	float OD = beatmap->getRawOD();
+	if (g_legacyODOverride->getFloat() >= 0.0f)
+		OD = g_legacyODOverride->getFloat();
+
+	return OD;
+}
+
+static float legacyApproachTime(OsuBeatmap *beatmap)
+{
+	const float millhioref = (OsuGameRules::osu_mod_millhioref.getBool() ? OsuGameRules::osu_mod_millhioref_multiplier.getFloat() : 1.0f);
+	return OsuGameRules::mapDifficultyRange(legacyAR(beatmap), 1800.0f * millhioref, 1200.0f * millhioref, 450.0f * millhioref);
+}
+
+static float legacyHitWindow300(OsuBeatmap *beatmap) {return OsuGameRules::mapDifficultyRange(legacyOD(beatmap), 80.0f, 50.0f, 20.0f);}
+static float legacyHitWindow100(OsuBeatmap *beatmap) {return OsuGameRules::mapDifficultyRange(legacyOD(beatmap), 140.0f, 100.0f, 60.0f);}
+static float legacyHitWindow50(OsuBeatmap *beatmap) {return OsuGameRules::mapDifficultyRange(legacyOD(beatmap), 200.0f, 150.0f, 100.0f);}
+static float legacyHitWindowMiss(OsuBeatmap *beatmap) {return 400.0f;}
+static float legacySpinnerSpins(OsuBeatmap *beatmap) {return OsuGameRules::mapDifficultyRange(legacyOD(beatmap), 3.0f, 5.0f, 7.5f);}
+
+static float legacyRawHitCircleDiameter(OsuBeatmap *beatmap)
+{
+	return ((1.0f - 0.7f*(legacyCS(beatmap) - 5.0f) / 5.0f) / 2.0f) * 128.0f;
+}
+
+static float legacyFadeOutTime(OsuBeatmap *beatmap)
+{
+	return OsuGameRules::osu_hitobject_fade_out_time.getFloat()*(1.0f/std::max(beatmap->getSpeedMultiplier(), OsuGameRules::osu_hitobject_fade_out_time_speed_multiplier_min.getFloat()));
+}
+
+static OsuScore::HIT legacyHitResult(long delta, OsuBeatmap *beatmap)
+{
+	delta = std::abs(delta);
+
+	OsuScore::HIT result = OsuScore::HIT::HIT_NULL;
+
+	if (!OsuGameRules::osu_mod_ming3012.getBool())
+	{
+		if (delta <= (long)legacyHitWindow300(beatmap))
+			result = OsuScore::HIT::HIT_300;
+		else if (delta <= (long)legacyHitWindow100(beatmap))
+			result = OsuScore::HIT::HIT_100;
+		else if (delta <= (long)legacyHitWindow50(beatmap))
+			result = OsuScore::HIT::HIT_50;
+		else if (delta <= (long)legacyHitWindowMiss(beatmap))
+			result = OsuScore::HIT::HIT_MISS;
+	}
+	else
+	{
+		if (delta <= (long)legacyHitWindow300(beatmap))
+			result = OsuScore::HIT::HIT_300;
+		else if (delta <= (long)legacyHitWindow50(beatmap))
+			result = OsuScore::HIT::HIT_50;
+		else if (delta <= (long)legacyHitWindowMiss(beatmap))
+			result = OsuScore::HIT::HIT_MISS;
+	}
+
+	return result;
+}
+
+void OsuGameRules::testDifficultySnapshot(OsuBeatmap *beatmap)
+{
+	ConVar *arOverride = convar->getConVarByName("osu_ar_override");
+	ConVar *csOverride = convar->getConVarByName("osu_cs_override");
+	ConVar *odOverride = convar->getConVarByName("osu_od_override");
+	ConVar *speedOverride = convar->getConVarByName("osu_speed_override");
+	g_legacyAROverride = arOverride;
+	g_legacyCSOverride = csOverride;
+	g_legacyODOverride = odOverride;
+
+	const float oldAR = arOverride->getFloat();
+	const float oldCS = csOverride->getFloat();
+	const float oldOD = odOverride->getFloat();
+	const float oldSpeed = speedOverride->getFloat();
+
+	ConVar *timeVaryingMods[] = {convar->getConVarByName("osu_mod_artimewarp"), convar->getConVarByName("osu_mod_arwobble"), convar->getConVarByName("osu_mod_minimize")};
+	float oldTimeVaryingMods[3];
+	for (int i=0; i<3; i++)
+	{
+		oldTimeVaryingMods[i] = timeVaryingMods[i]->getFloat();
+		timeVaryingMods[i]->setValue(0.0f);
+	}
+
+	int numTests = 0;
+	int numFailed = 0;
+
+	// the snapshot must be bit-identical to what the per-call functions used to return, for every combination
+	const float values[] = {-1.0f, 0.0f, 2.5f, 5.0f, 7.3f, 9.0f, 10.0f, 11.0f};
+	const float speeds[] = {-1.0f, 0.75f, 1.0f, 1.5f};
+	const int numValues = sizeof(values)/sizeof(values[0]);
+	for (int s=0; s<sizeof(speeds)/sizeof(speeds[0]); s++)
+	{
+		speedOverride->setValue(speeds[s]);
+		for (int a=0; a<numValues; a++)
+		{
+			arOverride->setValue(values[a]);
+			for (int c=0; c<numValues; c++)
+			{
+				csOverride->setValue(values[c]);
+				for (int o=0; o<numValues; o++)
+				{
+					odOverride->setValue(values[o]);
+					beatmap->updateDifficulty();
+					const OsuDifficultySnapshot &difficulty = beatmap->getDifficulty();
+
+					const long approachTime = (long)legacyApproachTime(beatmap);
+					const bool passed = difficulty.approachTime == legacyApproachTime(beatmap)
+						&& difficulty.hiddenDecayTime == (long) ((float)approachTime / 3.6f)
+						&& difficulty.hiddenTimeDiff == (long) ((float)approachTime / 3.3f)
+						&& difficulty.fadeInTime == std::min(400, (int) ((float)approachTime / 1.75f))
+						&& difficulty.rawHitcircleDiameter == legacyRawHitCircleDiameter(beatmap)
+						&& difficulty.hitWindow300 == legacyHitWindow300(beatmap)
+						&& difficulty.hitWindow100 == legacyHitWindow100(beatmap)
+						&& difficulty.hitWindow50 == legacyHitWindow50(beatmap)
+						&& difficulty.hitWindowMiss == legacyHitWindowMiss(beatmap)
+						&& difficulty.spinnerSpins == legacySpinnerSpins(beatmap)
+						&& difficulty.fadeOutTime == legacyFadeOutTime(beatmap);
+
+					numTests++;
+					if (!passed)
+					{
+						numFailed++;
+						debugLog("osu_difficulty_snapshot_test: FAILED AR = %f, CS = %f, OD = %f, speed = %f (approach time %f vs %f, hit window 300 %f vs %f)\n", values[a], values[c], values[o], speeds[s], difficulty.approachTime, legacyApproachTime(beatmap), difficulty.hitWindow300, legacyHitWindow300(beatmap));
+					}
+
+					// and the judgement must not change either
+					for (long delta=-450; delta<=450; delta+=3)
+					{
+						numTests++;
+						if (getHitResult(delta, difficulty) != legacyHitResult(delta, beatmap))
+						{
+							numFailed++;
+							debugLog("osu_difficulty_snapshot_test: FAILED hit result for delta = %li\n", delta);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	arOverride->setValue(oldAR);
+	csOverride->setValue(oldCS);
+	odOverride->setValue(oldOD);
+	speedOverride->setValue(oldSpeed);
+	for (int i=0; i<3; i++)
+	{
+		timeVaryingMods[i]->setValue(oldTimeVaryingMods[i]);
+	}
+	beatmap->updateDifficulty();
+
+	debugLog("osu_difficulty_snapshot_test: %s, %i/%i passed\n", numFailed == 0 ? "PASSED" : "FAILED", numTests - numFailed, numTests);
+
+	// per-frame cost: every visible hitobject used to evaluate these (including several ConVar reads each) on every update
+	const int numObjects = 100000;
+	float sum = 0.0f;
+
+	Timer t;
+	t.start();
+	for (int i=0; i<numObjects; i++)
+	{
+		sum += legacyApproachTime(beatmap) + legacyHitWindow50(beatmap) + legacyFadeOutTime(beatmap) + legacyRawHitCircleDiameter(beatmap);
+	}
+	t.update();
+	const double legacyTime = t.getElapsedTime();
+
+	t.start();
+	beatmap->updateDifficulty();
+	for (int i=0; i<numObjects; i++)
+	{
+		const OsuDifficultySnapshot &difficulty = beatmap->getDifficulty();
+		sum += difficulty.approachTime + difficulty.hitWindow50 + difficulty.fadeOutTime + difficulty.rawHitcircleDiameter;
+	}
+	t.update();
+	const double snapshotTime = t.getElapsedTime();
+
+	debugLog("osu_difficulty_snapshot_test: %i objects took %f ms (per-call), %f ms (snapshot), checksum = %f\n", numObjects, legacyTime*1000.0, snapshotTime*1000.0, sum);
+}
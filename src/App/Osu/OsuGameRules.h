@@ -10,6 +10,7 @@
 
 #include "Osu.h"
 #include "OsuBeatmap.h"
+#include "OsuDifficultySnapshot.h"
 
 #include "ConVar.h"
 
@@ -181,36 +182,90 @@ public:
 		return mapDifficultyRange(beatmap->getOD(), 3.0f, 5.0f, 7.5f);
 	}
 
-	static OsuScore::HIT getHitResult(long delta, OsuBeatmap *beatmap)
+	static OsuScore::HIT getHitResult(long delta, const OsuDifficultySnapshot &difficulty)
 	{
 		delta = std::abs(delta);
 
 		OsuScore::HIT result = OsuScore::HIT::HIT_NULL;
 
-		if (!osu_mod_ming3012.getBool())
+		if (!difficulty.hitWindow100Disabled)
 		{
-			if (delta <= (long)getHitWindow300(beatmap))
+			if (delta <= (long)difficulty.hitWindow300)
 				result = OsuScore::HIT::HIT_300;
-			else if (delta <= (long)getHitWindow100(beatmap))
+			else if (delta <= (long)difficulty.hitWindow100)
 				result = OsuScore::HIT::HIT_100;
-			else if (delta <= (long)getHitWindow50(beatmap))
+			else if (delta <= (long)difficulty.hitWindow50)
 				result = OsuScore::HIT::HIT_50;
-			else if (delta <= (long)getHitWindowMiss(beatmap))
+			else if (delta <= (long)difficulty.hitWindowMiss)
 				result = OsuScore::HIT::HIT_MISS;
 		}
 		else
 		{
-			if (delta <= (long)getHitWindow300(beatmap))
+			if (delta <= (long)difficulty.hitWindow300)
 				result = OsuScore::HIT::HIT_300;
-			else if (delta <= (long)getHitWindow50(beatmap))
+			else if (delta <= (long)difficulty.hitWindow50)
 				result = OsuScore::HIT::HIT_50;
-			else if (delta <= (long)getHitWindowMiss(beatmap))
+			else if (delta <= (long)difficulty.hitWindowMiss)
 				result = OsuScore::HIT::HIT_MISS;
 		}
 
 		return result;
 	}
 
+	static OsuScore::HIT getHitResult(long delta, OsuBeatmap *beatmap)
+	{
+		return getHitResult(delta, beatmap->getDifficulty());
+	}
+
+
+
+	//***********************//
+	//	Difficulty Snapshot  //
+	//***********************//
+
+	static OsuDifficultySnapshot getDifficultySnapshot(float AR, float CS, float OD, float HP, float speedMultiplier)
+	{
+		OsuDifficultySnapshot difficulty;
+
+		difficulty.OD = OD;
+		difficulty.HP = HP;
+		difficulty.speedMultiplier = speedMultiplier;
+
+		updateDifficultySnapshotAR(&difficulty, AR);
+		updateDifficultySnapshotCS(&difficulty, CS);
+
+		difficulty.hitWindow300 = mapDifficultyRange(OD, getMinHitWindow300(), getMidHitWindow300(), getMaxHitWindow300());
+		difficulty.hitWindow100 = mapDifficultyRange(OD, getMinHitWindow100(), getMidHitWindow100(), getMaxHitWindow100());
+		difficulty.hitWindow50 = mapDifficultyRange(OD, getMinHitWindow50(), getMidHitWindow50(), getMaxHitWindow50());
+		difficulty.hitWindowMiss = getHitWindowMiss(NULL);
+		difficulty.hitWindow100Disabled = osu_mod_ming3012.getBool();
+		difficulty.spinnerSpins = mapDifficultyRange(OD, 3.0f, 5.0f, 7.5f);
+
+		difficulty.fadeOutTime = osu_hitobject_fade_out_time.getFloat()*(1.0f/std::max(speedMultiplier, osu_hitobject_fade_out_time_speed_multiplier_min.getFloat()));
+
+		return difficulty;
+	}
+
+	static void updateDifficultySnapshotAR(OsuDifficultySnapshot *difficulty, float AR) // cheap enough to be called every frame
+	{
+		difficulty->AR = AR;
+		difficulty->approachTime = mapDifficultyRange(AR, getMinApproachTime(), getMidApproachTime(), getMaxApproachTime());
+
+		const long approachTime = (long)difficulty->approachTime;
+		difficulty->hiddenDecayTime = (long) ((float)approachTime / 3.6f);
+		difficulty->hiddenTimeDiff = (long) ((float)approachTime / 3.3f);
+		difficulty->fadeInTime = std::min(400, (int) ((float)approachTime / 1.75f));
+	}
+
+	static void updateDifficultySnapshotCS(OsuDifficultySnapshot *difficulty, float CS) // cheap enough to be called every frame
+	{
+		difficulty->CS = CS;
+		difficulty->rawHitcircleDiameter = getRawHitCircleDiameter(CS);
+		difficulty->stackOffset = difficulty->rawHitcircleDiameter * 0.05f;
+	}
+
+	static void testDifficultySnapshot(OsuBeatmap *beatmap); // osu_difficulty_snapshot_test
+
 
 
 	//*********************//
@@ -277,6 +332,19 @@ public:
 
 		return Vector2((OSU_COORD_WIDTH/2)*scaleFactor + playfieldOffset.x, (OSU_COORD_HEIGHT/2)*scaleFactor + playfieldOffset.y);
 	}
+
+
+
+	//**************//
+	//	Hit Sounds  //
+	//**************//
+
+	static ConVar osu_hitsound_panning;
+
+	static float getHitSoundPan(float rawX) // -1 (left) to 1 (right), by the osu!pixel x position
+	{
+		return clamp<float>(rawX / (float)OSU_COORD_WIDTH * 2.0f - 1.0f, -1.0f, 1.0f) * osu_hitsound_panning.getFloat();
+	}
 };
 
 #endif
@@ -0,0 +1,375 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		ring of compact gameplay states, for seeking backwards and quick load
+//
+// $NoKeywords: $osugcp
+//===============================================================================//
+
+#include "OsuGameplayCheckpoints.h"
+
+#include "Engine.h"
+#include "Timer.h"
+
+#include "Osu.h"
+#include "OsuBeatmap.h"
+#include "OsuBeatmapDifficulty.h"
+#include "OsuHitObjectFactory.h"
+#include "OsuSimulatedPlayer.h"
+#include "OsuSlider.h"
+#include "OsuSpinner.h"
+
+#include <string.h>
+
+void OsuGameplayCheckpoints::CHECKPOINT::setNumObjects(int numObjects)
+{
+	this->numObjects = numObjects;
+	finished.assign((numObjects + 63) / 64, 0);
+}
+
+size_t OsuGameplayCheckpoints::CHECKPOINT::getMemoryUsage() const
+{
+	return sizeof(CHECKPOINT) + finished.capacity()*sizeof(uint64_t) + progress.capacity()*sizeof(OsuHitObject::PROGRESS);
+}
+
+OsuGameplayCheckpoints::OsuGameplayCheckpoints()
+{
+	m_iStart = 0;
+	m_iNumCheckpoints = 0;
+
+	clear(1);
+}
+
+void OsuGameplayCheckpoints::clear(int capacity)
+{
+	// the slots (and their vectors) are kept around, so that a restarted play doesn't allocate anything until it gets further than the last one
+	m_checkpoints.resize(std::max(capacity, 1));
+	m_iStart = 0;
+	m_iNumCheckpoints = 0;
+}
+
+OsuGameplayCheckpoints::CHECKPOINT *OsuGameplayCheckpoints::push(long musicPos)
+{
+	// keep everything sorted, anything newer than this can't be reached anymore
+	while (m_iNumCheckpoints > 0 && m_checkpoints[getSlot(m_iNumCheckpoints-1)].musicPos > musicPos)
+	{
+		m_iNumCheckpoints--;
+	}
+
+	// overwrite the oldest one if the ring is full
+	if (m_iNumCheckpoints >= m_checkpoints.size())
+	{
+		m_iStart = (m_iStart + 1) % m_checkpoints.size();
+		m_iNumCheckpoints--;
+	}
+
+	CHECKPOINT *checkpoint = &m_checkpoints[getSlot(m_iNumCheckpoints)];
+	m_iNumCheckpoints++;
+
+	checkpoint->musicPos = musicPos;
+	return checkpoint;
+}
+
+const OsuGameplayCheckpoints::CHECKPOINT *OsuGameplayCheckpoints::findBefore(long musicPos) const
+{
+	// binary search for the first checkpoint after musicPos
+	int low = 0;
+	int high = m_iNumCheckpoints;
+	while (low < high)
+	{
+		const int mid = (low + high) / 2;
+		if (m_checkpoints[getSlot(mid)].musicPos <= musicPos)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return (low > 0 ? &m_checkpoints[getSlot(low-1)] : NULL);
+}
+
+void OsuGameplayCheckpoints::truncate(const CHECKPOINT *checkpoint)
+{
+	if (checkpoint == NULL)
+	{
+		m_iNumCheckpoints = 0;
+		return;
+	}
+
+	const int slot = checkpoint - &m_checkpoints[0];
+	const int index = (slot - m_iStart + (int)m_checkpoints.size()) % m_checkpoints.size();
+	if (index < m_iNumCheckpoints)
+		m_iNumCheckpoints = index + 1;
+}
+
+size_t OsuGameplayCheckpoints::getMemoryUsage() const
+{
+	size_t size = 0;
+	for (int i=0; i<m_checkpoints.size(); i++)
+	{
+		size += m_checkpoints[i].getMemoryUsage();
+	}
+	return size;
+}
+
+
+
+static int checkpointTestCompare(const OsuGameplayCheckpoints::CHECKPOINT &a, const OsuGameplayCheckpoints::CHECKPOINT &b)
+{
+	// everything which a restore brings back (objects which were created later are unfinished in both)
+	int numDifferences = 0;
+	for (int i=0; i<std::max(a.numObjects, b.numObjects); i++)
+	{
+		if (a.isFinished(i) != b.isFinished(i))
+			numDifferences++;
+	}
+	for (int i=0; i<std::max(a.progress.size(), b.progress.size()); i++)
+	{
+		if (i >= a.progress.size() || i >= b.progress.size() || memcmp(&a.progress[i], &b.progress[i], sizeof(OsuHitObject::PROGRESS)) != 0)
+			numDifferences++;
+	}
+
+	const OsuScore::SNAPSHOT &x = a.score;
+	const OsuScore::SNAPSHOT &y = b.score;
+	numDifferences += (x.grade != y.grade) + (x.score != y.score) + (x.combo != y.combo) + (x.comboMax != y.comboMax) + (x.accuracy != y.accuracy) + (x.unstableRate != y.unstableRate);
+	numDifferences += (x.numMisses != y.numMisses) + (x.numSliderBreaks != y.numSliderBreaks) + (x.num50s != y.num50s) + (x.num100s != y.num100s) + (x.num100ks != y.num100ks) + (x.num300s != y.num300s) + (x.num300gs != y.num300gs);
+	numDifferences += (x.numHitResults != y.numHitResults) + (x.numHitDeltas != y.numHitDeltas);
+	numDifferences += (a.health != b.health);
+
+	return numDifferences;
+}
+
+void OsuGameplayCheckpoints::test(OsuBeatmap *beatmap)
+{
+	int numTests = 0;
+	int numFailed = 0;
+
+	// the same synthetic map as osu_hitobject_benchmark (10 minutes of it), played headless by OsuSimulatedPlayer at 60 fps (the input only depends on curPos, so every run gets the same input for the same frames)
+	OsuBeatmapDifficulty diff(NULL, "", "");
+	OsuHitObjectFactory::generateBenchmarkDifficulty(&diff, 0, 10*60*1000);
+	const int numObjects = diff.hitcircles.size() + diff.sliders.size() + diff.spinners.size();
+	const float frameTime = 0.016f;
+	const long frameMS = 16;
+	const long firstFrame = -1000;
+
+	// reference: play straight through, keep a copy of every periodic checkpoint and of the final state
+	OsuScore reference(beatmap->getOsu(), true);
+	if (!beatmap->beginSimulation(&diff, &reference))
+	{
+		debugLog("osu_checkpoint_test: Can't simulate right now, stop playing first!\n");
+		return;
+	}
+
+	OsuSimulatedPlayer player(beatmap, &diff);
+	const long lastFrame = player.getLastEndTime() + 1000;
+	for (long curPos=firstFrame; curPos<lastFrame; curPos+=frameMS)
+	{
+		player.update(curPos, frameTime);
+	}
+
+	std::vector<CHECKPOINT> referenceCheckpoints;
+	const OsuGameplayCheckpoints *ring = beatmap->m_checkpoints;
+	for (int i=0; i<ring->getNumCheckpoints(); i++)
+	{
+		referenceCheckpoints.push_back(ring->m_checkpoints[ring->getSlot(i)]);
+	}
+	CHECKPOINT referenceEnd;
+	beatmap->fillCheckpoint(&referenceEnd, beatmap->getCurMusicPos());
+
+	// seek from just after a checkpoint back to the one before it: a spinner in progress, a slider in progress, nothing in progress, and the last one
+	std::vector<int> seeks;
+	for (int type=0; type<3; type++)
+	{
+		for (int i=0; i+1<referenceCheckpoints.size(); i++)
+		{
+			bool hasSpinner = false;
+			bool hasSlider = false;
+			for (int p=0; p<referenceCheckpoints[i].progress.size(); p++)
+			{
+				OsuHitObject *hitobject = beatmap->m_hitobjects[referenceCheckpoints[i].progress[p].index];
+				if (referenceCheckpoints[i].curPos < hitobject->getTime() || referenceCheckpoints[i].curPos >= hitobject->getTime() + hitobject->getDuration())
+					continue;
+
+				hasSpinner |= (dynamic_cast<OsuSpinner*>(hitobject) != NULL);
+				hasSlider |= (dynamic_cast<OsuSlider*>(hitobject) != NULL);
+			}
+
+			if ((type == 0 && hasSpinner) || (type == 1 && hasSlider) || (type == 2 && referenceCheckpoints[i].progress.size() == 0))
+			{
+				seeks.push_back(i);
+				break;
+			}
+		}
+	}
+	if (referenceCheckpoints.size() > 1)
+		seeks.push_back(referenceCheckpoints.size()-2);
+
+	beatmap->endSimulation();
+
+	numTests++;
+	if (seeks.size() < 4)
+	{
+		numFailed++;
+		debugLog("osu_checkpoint_test: FAILED, only %i periodic checkpoints, only %i seeks possible (osu_checkpoint_interval/osu_checkpoint_count?)\n", (int)referenceCheckpoints.size(), (int)seeks.size());
+	}
+
+	// seeking back and replaying the same input must end in exactly the same state as never having seeked at all
+	// the seek target lies between two checkpoints, the beatmap restores the older one and continues from there
+	for (int s=0; s<seeks.size(); s++)
+	{
+		const CHECKPOINT &restored = referenceCheckpoints[seeks[s]];
+		const CHECKPOINT &next = referenceCheckpoints[seeks[s]+1];
+		const long seekFrom = next.musicPos + 1000;
+		const long seekTo = (restored.musicPos + next.musicPos) / 2;
+
+		OsuScore score(beatmap->getOsu(), true);
+		if (!beatmap->beginSimulation(&diff, &score))
+			break;
+
+		bool seeked = false;
+		int numDifferencesAtNext = -1;
+		for (long curPos=firstFrame; curPos<lastFrame; curPos+=frameMS)
+		{
+			player.update(curPos, frameTime);
+
+			if (!seeked && curPos >= seekFrom)
+			{
+				seeked = true;
+				if (!beatmap->restoreCheckpoint(seekTo) || beatmap->getCurMusicPos() != restored.musicPos)
+					break;
+
+				// the held keys are input, not gameplay state, the simulation continues with whatever the player holds at the checkpoint
+				player.getKeys(restored.musicPos, &beatmap->m_bClick1Held, &beatmap->m_bClick2Held);
+				curPos = restored.musicPos;
+			}
+			else if (seeked && curPos == next.musicPos)
+			{
+				CHECKPOINT state;
+				beatmap->fillCheckpoint(&state, curPos);
+				numDifferencesAtNext = checkpointTestCompare(state, next);
+			}
+		}
+
+		CHECKPOINT end;
+		beatmap->fillCheckpoint(&end, beatmap->getCurMusicPos());
+		const int numDifferencesAtEnd = checkpointTestCompare(end, referenceEnd) + score.getNumDifferences(reference);
+
+		beatmap->endSimulation();
+
+		numTests++;
+		if (numDifferencesAtNext != 0 || numDifferencesAtEnd != 0)
+		{
+			numFailed++;
+			debugLog("osu_checkpoint_test: FAILED seeking from %li to %li (restoring the checkpoint at %li with %i objects in progress), %i differences at %li, %i at the end (score %i vs %i)\n", seekFrom, seekTo, restored.musicPos, (int)restored.progress.size(), numDifferencesAtNext, next.musicPos, numDifferencesAtEnd, score.getScore(), reference.getScore());
+		}
+	}
+
+	// ring
+	{
+		OsuGameplayCheckpoints checkpoints;
+		checkpoints.clear(8);
+		for (int i=0; i<20; i++)
+		{
+			checkpoints.push(i*5000)->setNumObjects(i*10);
+		}
+
+		numTests++;
+		const CHECKPOINT *oldest = checkpoints.findBefore(60000);
+		if (checkpoints.getNumCheckpoints() != 8 || oldest == NULL || oldest->musicPos != 60000 || checkpoints.findBefore(59999) != NULL)
+		{
+			numFailed++;
+			debugLog("osu_checkpoint_test: FAILED ring wraparound (%i checkpoints)\n", checkpoints.getNumCheckpoints());
+		}
+
+		numTests++;
+		const CHECKPOINT *found = checkpoints.findBefore(82499);
+		if (found == NULL || found->musicPos != 80000 || checkpoints.getNewest()->musicPos != 95000)
+		{
+			numFailed++;
+			debugLog("osu_checkpoint_test: FAILED findBefore()\n");
+		}
+
+		numTests++;
+		checkpoints.truncate(found);
+		if (checkpoints.getNumCheckpoints() != 5 || checkpoints.getNewest() != found)
+		{
+			numFailed++;
+			debugLog("osu_checkpoint_test: FAILED truncate() (%i checkpoints)\n", checkpoints.getNumCheckpoints());
+		}
+
+		numTests++;
+		checkpoints.push(72000);
+		if (checkpoints.getNumCheckpoints() != 4 || checkpoints.getNewest()->musicPos != 72000 || checkpoints.findBefore(100000)->musicPos != 72000)
+		{
+			numFailed++;
+			debugLog("osu_checkpoint_test: FAILED pushing an older checkpoint (%i checkpoints)\n", checkpoints.getNumCheckpoints());
+		}
+
+		numTests++;
+		CHECKPOINT *checkpoint = checkpoints.push(73000);
+		checkpoint->setNumObjects(130);
+		checkpoint->setFinished(0);
+		checkpoint->setFinished(63);
+		checkpoint->setFinished(64);
+		checkpoint->setFinished(129);
+		int numFinished = 0;
+		for (int i=0; i<140; i++)
+		{
+			if (checkpoint->isFinished(i))
+				numFinished++;
+		}
+		if (numFinished != 4 || !checkpoint->isFinished(63) || !checkpoint->isFinished(64) || checkpoint->isFinished(65))
+		{
+			numFailed++;
+			debugLog("osu_checkpoint_test: FAILED finished bits (%i set)\n", numFinished);
+		}
+	}
+
+	debugLog("osu_checkpoint_test: %s, %i/%i passed\n", numFailed == 0 ? "PASSED" : "FAILED", numTests - numFailed, numTests);
+
+	// memory, capture time and seek latency (OsuBeatmap::restoreCheckpoint()) for the same map, with the current interval and capacity
+	{
+		OsuScore score(beatmap->getOsu(), true);
+		if (!beatmap->beginSimulation(&diff, &score))
+			return;
+
+		for (long curPos=firstFrame; curPos<lastFrame; curPos+=frameMS)
+		{
+			player.update(curPos, frameTime);
+		}
+		const int numCheckpoints = beatmap->m_checkpoints->getNumCheckpoints();
+		const size_t memoryUsage = beatmap->m_checkpoints->getMemoryUsage();
+
+		Timer t;
+		const int numCaptures = 100;
+		CHECKPOINT checkpoint;
+		t.start();
+		for (int i=0; i<numCaptures; i++)
+		{
+			beatmap->fillCheckpoint(&checkpoint, beatmap->getCurMusicPos());
+		}
+		t.update();
+		const double captureTime = t.getElapsedTime();
+
+		// scrubbing backwards through the whole map, every restore lands on a different checkpoint
+		const long seekStep = 2500;
+		int numSeeks = 0;
+		double seekTime = 0.0;
+		double maxSeekTime = 0.0;
+		for (long target=beatmap->getCurMusicPos(); target>=0; target-=seekStep)
+		{
+			t.start();
+			const bool restored = beatmap->restoreCheckpoint(target);
+			t.update();
+
+			if (restored)
+			{
+				numSeeks++;
+				seekTime += t.getElapsedTime();
+				maxSeekTime = std::max(maxSeekTime, t.getElapsedTime());
+			}
+		}
+
+		beatmap->endSimulation();
+
+		debugLog("osu_checkpoint_test: %i objects over %li seconds, %i checkpoints kept, %i KB, %f ms per capture, %f ms per seek (max %f ms, %i seeks)\n", numObjects, lastFrame/1000, numCheckpoints, (int)(memoryUsage / 1024), (captureTime*1000.0) / numCaptures, numSeeks > 0 ? (seekTime*1000.0) / numSeeks : 0.0, maxSeekTime*1000.0, numSeeks);
+	}
+}
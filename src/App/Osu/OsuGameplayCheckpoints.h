@@ -0,0 +1,63 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		ring of compact gameplay states, for seeking backwards and quick load
+//
+// $NoKeywords: $osugcp
+//===============================================================================//
+
+#ifndef OSUGAMEPLAYCHECKPOINTS_H
+#define OSUGAMEPLAYCHECKPOINTS_H
+
+#include "cbase.h"
+#include "OsuScore.h"
+#include "OsuHitObject.h"
+
+class OsuBeatmap;
+
+// OsuBeatmap captures a checkpoint every osu_checkpoint_interval seconds of music time (and on quick save)
+// seeking backwards then restores the newest checkpoint before the target, instead of resetting the score and counting everything before the target as hit
+// the checkpoints are always sorted by time, pushing an older one drops everything newer than it
+class OsuGameplayCheckpoints
+{
+public:
+	struct CHECKPOINT
+	{
+		long musicPos; // the music is set to this when restoring
+		long curPos; // hitobject time (including offsets) at which the state was captured
+		OsuScore::SNAPSHOT score;
+		float health;
+
+		int numObjects; // objects which existed at capture time, everything after these is unfinished
+		std::vector<uint64_t> finished; // one bit per object
+		std::vector<OsuHitObject::PROGRESS> progress; // only for the few objects which were partially judged, sorted by index
+
+		void setNumObjects(int numObjects); // clears all bits (keeps the memory)
+		inline void setFinished(int index) {finished[index >> 6] |= (1ull << (index & 63));}
+		inline bool isFinished(int index) const {return index < numObjects && (finished[index >> 6] & (1ull << (index & 63))) != 0;}
+
+		size_t getMemoryUsage() const;
+	};
+
+public:
+	OsuGameplayCheckpoints();
+
+	void clear(int capacity);
+	CHECKPOINT *push(long musicPos); // returns the slot to fill, once the ring is full the oldest slot is reused (including its memory)
+	const CHECKPOINT *findBefore(long musicPos) const; // the newest checkpoint at or before musicPos, NULL if there is none
+	void truncate(const CHECKPOINT *checkpoint); // drops everything newer than checkpoint (after restoring it, these lie in the future)
+
+	inline int getNumCheckpoints() const {return m_iNumCheckpoints;}
+	inline const CHECKPOINT *getNewest() const {return m_iNumCheckpoints > 0 ? &m_checkpoints[getSlot(m_iNumCheckpoints-1)] : NULL;}
+	size_t getMemoryUsage() const;
+
+	static void test(OsuBeatmap *beatmap); // seek + replay determinism of a simulated play, ring logic, memory and restore latency (osu_checkpoint_test)
+
+private:
+	inline int getSlot(int i) const {return (m_iStart + i) % m_checkpoints.size();}
+
+	std::vector<CHECKPOINT> m_checkpoints;
+	int m_iStart; // slot of the oldest checkpoint
+	int m_iNumCheckpoints;
+};
+
+#endif
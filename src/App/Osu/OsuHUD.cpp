@@ -19,6 +19,7 @@
 #include "OsuBeatmap.h"
 #include "OsuGameRules.h"
 #include "OsuScore.h"
+#include "OsuSpriteBatch.h"
 
 #include "OsuHitObject.h"
 #include "OsuCircle.h"
@@ -59,6 +60,9 @@ ConVar osu_draw_statistics_nps("osu_draw_statistics_nps", false);
 ConVar osu_draw_statistics_nd("osu_draw_statistics_nd", false);
 ConVar osu_draw_statistics_ur("osu_draw_statistics_ur", false);
 
+ConVar osu_profiler_overlay_lines("osu_profiler_overlay_lines", 25, "maximum number of zones shown by osu_profiler_overlay");
+ConVar osu_profiler_overlay_update_interval("osu_profiler_overlay_update_interval", 0.5f);
+
 ConVar osu_combo_anim1_duration("osu_combo_anim1_duration", 0.15f);
 ConVar osu_combo_anim1_size("osu_combo_anim1_size", 0.15f);
 ConVar osu_combo_anim2_duration("osu_combo_anim2_duration", 0.4f);
@@ -81,6 +85,8 @@ OsuHUD::OsuHUD(Osu *osu)
 	m_fFpsUpdate = 0.0f;
 	m_fFpsFontHeight = m_tempFont->getHeight();
 
+	m_fProfilerUpdate = 0.0f;
+
 	m_fAccuracyXOffset = 0.0f;
 	m_fAccuracyYOffset = 0.0f;
 	m_fScoreHeight = 0.0f;
@@ -101,6 +107,8 @@ OsuHUD::~OsuHUD()
 
 void OsuHUD::draw(Graphics *g)
 {
+	OSU_PROFILER_ZONE("OsuHUD::draw");
+
 	OsuBeatmap *beatmap = m_osu->getSelectedBeatmap();
 	if (beatmap == NULL) return; // sanity check
 
@@ -110,7 +118,7 @@ void OsuHUD::draw(Graphics *g)
 			drawSkip(g);
 
 		g->pushTransform();
-			if (m_osu->getModTarget() && osu_draw_target_heatmap.getBool())
+			if (beatmap->getMods().has(OsuMods::TARGET) && osu_draw_target_heatmap.getBool())
 				g->translate(0, beatmap->getHitcircleDiameter());
 			drawStatistics(g, m_osu->getScore()->getNumMisses(), beatmap->getBPM(), OsuGameRules::getApproachRateForSpeedMultiplier(beatmap, beatmap->getSpeedMultiplier()), beatmap->getCS(), OsuGameRules::getOverallDifficultyForSpeedMultiplier(beatmap, beatmap->getSpeedMultiplier()), beatmap->getNPS(), beatmap->getND(), m_osu->getScore()->getUnstableRate());
 		g->popTransform();
@@ -138,7 +146,7 @@ void OsuHUD::draw(Graphics *g)
 		if (osu_draw_hiterrorbar.getBool() && !beatmap->isSpinnerActive())
 			drawHitErrorBar(g, OsuGameRules::getHitWindow300(beatmap), OsuGameRules::getHitWindow100(beatmap), OsuGameRules::getHitWindow50(beatmap));
 
-		if (m_osu->getModTarget() && osu_draw_target_heatmap.getBool())
+		if (beatmap->getMods().has(OsuMods::TARGET) && osu_draw_target_heatmap.getBool())
 			drawTargetHeatmap(g, beatmap->getHitcircleDiameter());
 	}
 
@@ -282,8 +290,16 @@ void OsuHUD::update()
 		m_fCurFps = m_fCurFpsSmooth;
 	}
 
+	// profiler overlay update (the numbers would be unreadable if they changed every frame)
+	if (OsuProfiler::isEnabled() && engine->getTime() > m_fProfilerUpdate)
+	{
+		m_fProfilerUpdate = engine->getTime() + osu_profiler_overlay_update_interval.getFloat();
+		m_profilerStats = OsuProfiler::getStats();
+	}
+
 	// target heatmap cleanup
-	if (m_osu->getModTarget())
+	OsuBeatmap *beatmap = m_osu->getSelectedBeatmap();
+	if (beatmap != NULL && beatmap->getMods().has(OsuMods::TARGET))
 	{
 		if (m_targets.size() > 0 && engine->getTime() > m_targets[0].time)
 			m_targets.erase(m_targets.begin());
@@ -407,6 +423,67 @@ void OsuHUD::drawFps(Graphics *g, McFont *font, float fps)
 	g->popTransform();
 }
 
+void OsuHUD::drawProfiler(Graphics *g)
+{
+	McFont *font = m_tempFont;
+	const int numLines = std::min((int)m_profilerStats.size(), std::max(osu_profiler_overlay_lines.getInt(), 1));
+	const float margin = 5;
+	const float padding = 5;
+	const float columnSpacing = 15;
+	const float lineHeight = m_fFpsFontHeight + 4;
+
+	// table
+	std::vector<UString> columns[5];
+	columns[0].push_back("zone");
+	columns[1].push_back("avg ms");
+	columns[2].push_back("p99 ms");
+	columns[3].push_back("max ms");
+	columns[4].push_back("calls");
+	for (int i=0; i<numLines; i++)
+	{
+		const OsuProfiler::STATS &stats = m_profilerStats[i];
+		columns[0].push_back(stats.name);
+		columns[1].push_back(UString::format("%.3f", stats.avgMS));
+		columns[2].push_back(UString::format("%.3f", stats.p99MS));
+		columns[3].push_back(UString::format("%.3f", stats.maxMS));
+		columns[4].push_back(UString::format("%.1f", stats.avgCalls));
+	}
+
+	float columnWidths[5];
+	float width = 0;
+	for (int c=0; c<5; c++)
+	{
+		columnWidths[c] = 0;
+		for (int i=0; i<columns[c].size(); i++)
+		{
+			columnWidths[c] = std::max(columnWidths[c], font->getStringWidth(columns[c][i]));
+		}
+		width += columnWidths[c] + (c > 0 ? columnSpacing : 0);
+	}
+
+	g->setColor(0xaa000000);
+	g->fillRect(margin, margin, width + 2*padding, (numLines + 1)*lineHeight + 2*padding);
+
+	for (int i=0; i<numLines+1; i++)
+	{
+		// header, whole frame, zones
+		g->setColor(i == 0 ? 0xffbbbbbb : (i == 1 ? 0xffffff00 : 0xffffffff));
+
+		float x = margin + padding;
+		for (int c=0; c<5; c++)
+		{
+			// zone names left aligned, numbers right aligned
+			const float columnX = (c == 0 ? x : x + columnWidths[c] - font->getStringWidth(columns[c][i]));
+			g->pushTransform();
+				g->translate((int)columnX, (int)(margin + padding + (i + 1)*lineHeight - 2));
+				g->drawString(font, columns[c][i]);
+			g->popTransform();
+
+			x += columnWidths[c] + columnSpacing;
+		}
+	}
+}
+
 void OsuHUD::drawPlayfieldBorder(Graphics *g, Vector2 playfieldCenter, Vector2 playfieldSize, float hitcircleDiameter)
 {
 	const int borderSize = osu_hud_playfield_border_size.getInt();
@@ -547,85 +624,43 @@ void OsuHUD::drawVolumeChange(Graphics *g)
 	g->fillRect(0, m_osu->getScreenHeight()*(1.0f - m_fLastVolume), m_osu->getScreenWidth(), m_osu->getScreenHeight()*m_fLastVolume);
 }
 
-void OsuHUD::drawScoreNumber(Graphics *g, int number, float scale, bool drawLeadingZeroes, int offset)
+void OsuHUD::drawScoreNumber(Graphics *g, int number, float scale, bool drawLeadingZeroes, int offset, Color color)
 {
-	// get digits
-	std::vector<int> digits;
-	while (number >= 10)
+	// get digits (from the most significant one, without building a vector every frame)
+	int divisor = 1;
+	while (number / divisor >= 10)
 	{
-		int curDigit = number % 10;
-		number /= 10;
-
-		digits.insert(digits.begin(), curDigit);
-	}
-	digits.insert(digits.begin(), number);
-	if (digits.size() == 1)
-	{
-		if (drawLeadingZeroes)
-			digits.insert(digits.begin(), 0);
+		divisor *= 10;
 	}
+	if (divisor == 1 && drawLeadingZeroes)
+		divisor = 10;
+
+	OsuSkin *skin = m_osu->getSkin();
+	Image *digitImages[10] = {skin->getScore0(), skin->getScore1(), skin->getScore2(), skin->getScore3(), skin->getScore4(), skin->getScore5(), skin->getScore6(), skin->getScore7(), skin->getScore8(), skin->getScore9()};
 
 	// draw them
+	// the quads are in the coordinate system of the caller (which has already scaled by scale), so all screen space distances are divided by it
 	// NOTE: just using the width here is incorrect, but it is the quickest solution instead of painstakingly reverse-engineering how osu does it
-	float lastWidth = m_osu->getSkin()->getScore0()->getWidth();
-	for (int i=0; i<digits.size(); i++)
+	const float lastWidth = skin->getScore0()->getWidth();
+	const float offsetUnscaled = (scale != 0.0f ? offset / scale : 0.0f);
+	float x = 0.0f;
+	int numDigits = 0;
+	OsuSpriteBatch *batch = OsuSpriteBatch::getShared();
+	batch->begin(g);
+	for (; divisor > 0; divisor /= 10)
 	{
-		switch (digits[i])
-		{
-		case 0:
-			g->translate(lastWidth*0.5f*scale, 0);
-			g->drawImage(m_osu->getSkin()->getScore0());
-			g->translate(lastWidth*0.5f*scale, 0);
-			break;
-		case 1:
-			g->translate(lastWidth*0.5f*scale, 0);
-			g->drawImage(m_osu->getSkin()->getScore1());
-			g->translate(lastWidth*0.5f*scale, 0);
-			break;
-		case 2:
-			g->translate(lastWidth*0.5f*scale, 0);
-			g->drawImage(m_osu->getSkin()->getScore2());
-			g->translate(lastWidth*0.5f*scale, 0);
-			break;
-		case 3:
-			g->translate(lastWidth*0.5f*scale, 0);
-			g->drawImage(m_osu->getSkin()->getScore3());
-			g->translate(lastWidth*0.5f*scale, 0);
-			break;
-		case 4:
-			g->translate(lastWidth*0.5f*scale, 0);
-			g->drawImage(m_osu->getSkin()->getScore4());
-			g->translate(lastWidth*0.5f*scale, 0);
-			break;
-		case 5:
-			g->translate(lastWidth*0.5f*scale, 0);
-			g->drawImage(m_osu->getSkin()->getScore5());
-			g->translate(lastWidth*0.5f*scale, 0);
-			break;
-		case 6:
-			g->translate(lastWidth*0.5f*scale, 0);
-			g->drawImage(m_osu->getSkin()->getScore6());
-			g->translate(lastWidth*0.5f*scale, 0);
-			break;
-		case 7:
-			g->translate(lastWidth*0.5f*scale, 0);
-			g->drawImage(m_osu->getSkin()->getScore7());
-			g->translate(lastWidth*0.5f*scale, 0);
-			break;
-		case 8:
-			g->translate(lastWidth*0.5f*scale, 0);
-			g->drawImage(m_osu->getSkin()->getScore8());
-			g->translate(lastWidth*0.5f*scale, 0);
-			break;
-		case 9:
-			g->translate(lastWidth*0.5f*scale, 0);
-			g->drawImage(m_osu->getSkin()->getScore9());
-			g->translate(lastWidth*0.5f*scale, 0);
-			break;
-		}
+		const int digit = (number / divisor) % 10;
+		if (digit >= 0)
+			batch->add(digitImages[digit], Vector2(x + lastWidth*0.5f, 0), 1.0f, color);
 
-		g->translate(offset, 0);
+		x += lastWidth + offsetUnscaled;
+		numDigits++;
 	}
+	batch->flush();
+	batch->end();
+
+	// callers continue drawing after the number (e.g. the 'x' of the combo)
+	g->translate((lastWidth*scale + offset)*numDigits, 0);
 }
 
 void OsuHUD::drawComboSimple(Graphics *g, int combo, float scale)
@@ -654,7 +689,7 @@ void OsuHUD::drawCombo(Graphics *g, int combo)
 		g->pushTransform();
 			g->scale(scale, scale);
 			g->translate(offset, m_osu->getScreenHeight() - m_osu->getSkin()->getScore0()->getHeight()*scale/2.0f);
-			drawScoreNumber(g, combo, scale);
+			drawScoreNumber(g, combo, scale, false, 2, COLOR((int)(clamp<float>(m_fComboAnim2*0.65f, 0.0f, 1.0f)*255.0f), 255, 255, 255));
 
 			// draw 'x' at the end
 			g->translate(m_osu->getSkin()->getScoreX()->getWidth()*0.5f*scale, 0);
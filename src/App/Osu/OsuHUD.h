@@ -9,6 +9,7 @@
 #define OSUHUD_H
 
 #include "OsuScreen.h"
+#include "OsuProfiler.h"
 
 class Osu;
 class McFont;
@@ -27,11 +28,12 @@ public:
 
 	void drawCursor(Graphics *g, Vector2 pos, float alphaMultiplier = 1.0f);
 	void drawFps(Graphics *g) {drawFps(g, m_tempFont, m_fCurFps);}
+	void drawProfiler(Graphics *g);
 	void drawPlayfieldBorder(Graphics *g, Vector2 playfieldCenter, Vector2 playfieldSize, float hitcircleDiameter);
 	void drawLoadingSmall(Graphics *g);
 	void drawBeatmapImportSpinner(Graphics *g);
 	void drawVolumeChange(Graphics *g);
-	void drawScoreNumber(Graphics *g, int number, float scale = 1.0f, bool drawLeadingZeroes = false, int offset = 2);
+	void drawScoreNumber(Graphics *g, int number, float scale = 1.0f, bool drawLeadingZeroes = false, int offset = 2, Color color = 0xffffffff); // scale must be the one applied with g->scale() by the caller, leaves g translated to the end of the number
 	void drawComboSimple(Graphics *g, int combo, float scale = 1.0f); // used by OsuRankingScreen
 	void drawAccuracySimple(Graphics *g, float accuracy, float scale = 1.0f); // used by OsuRankingScreen
 	void drawWarningArrow(Graphics *g, Vector2 pos, bool flipVertically, bool originLeft = true);
@@ -91,6 +93,10 @@ private:
 	float m_fFpsUpdate;
 	float m_fFpsFontHeight;
 
+	// profiler overlay
+	std::vector<OsuProfiler::STATS> m_profilerStats;
+	float m_fProfilerUpdate;
+
 	// hit error bar
 	struct HITERROR
 	{
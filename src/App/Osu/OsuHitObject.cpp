@@ -16,10 +16,13 @@
 #include "OsuSkin.h"
 #include "OsuGameRules.h"
 #include "OsuHUD.h"
+#include "OsuHitSoundScheduler.h"
 
 ConVar osu_hitresult_scale("osu_hitresult_scale", 1.0f);
 ConVar osu_hitresult_duration("osu_hitresult_duration", 1.25f);
 
+ConVar osu_hitsound_scheduler("osu_hitsound_scheduler", true, "play hit sounds through the OsuHitSoundScheduler (voice pool with polyphony limits, own thread) instead of directly");
+
 ConVar osu_mod_target_300_percent("osu_mod_target_300_percent", 0.5f);
 ConVar osu_mod_target_100_percent("osu_mod_target_100_percent", 0.7f);
 ConVar osu_mod_target_50_percent("osu_mod_target_50_percent", 0.95f);
@@ -120,12 +123,13 @@ void OsuHitObject::draw(Graphics *g)
 
 void OsuHitObject::update(long curPos)
 {
-	long approachTime = (long)OsuGameRules::getApproachTime(m_beatmap);
-	m_iHiddenDecayTime = (long) ((float)approachTime / 3.6f);
-	m_iHiddenTimeDiff = (long) ((float)approachTime / 3.3f);
-	m_iFadeInTime = std::min(400, (int) ((float)approachTime / 1.75f));
+	const OsuDifficultySnapshot &difficulty = m_beatmap->getDifficulty();
+	long approachTime = (long)difficulty.approachTime;
+	m_iHiddenDecayTime = difficulty.hiddenDecayTime;
+	m_iHiddenTimeDiff = difficulty.hiddenTimeDiff;
+	m_iFadeInTime = difficulty.fadeInTime;
 
-	m_iObjectTime = approachTime + m_iFadeInTime + (m_beatmap->getOsu()->getModHD() ? m_iHiddenTimeDiff : 0);
+	m_iObjectTime = approachTime + m_iFadeInTime + (m_beatmap->getMods().has(OsuMods::HD) ? m_iHiddenTimeDiff : 0);
 	m_iDelta = m_iTime - curPos;
 
 	if (curPos >= m_iTime - m_iObjectTime && curPos < m_iTime+m_iObjectDuration ) // 1 ms fudge by using >=, shouldn't really be a problem
@@ -148,7 +152,7 @@ void OsuHitObject::update(long curPos)
 
 void OsuHitObject::addHitResult(OsuScore::HIT result, long delta, Vector2 posRaw, float targetDelta, float targetAngle, bool ignoreOnHitErrorBar, bool ignoreCombo)
 {
-	if (m_beatmap->getOsu()->getModTarget() && result != OsuScore::HIT::HIT_MISS && targetDelta >= 0.0f)
+	if (m_beatmap->getMods().has(OsuMods::TARGET) && result != OsuScore::HIT::HIT_MISS && targetDelta >= 0.0f)
 	{
 		if (targetDelta < osu_mod_target_300_percent.getFloat() && (result == OsuScore::HIT::HIT_300 || result == OsuScore::HIT::HIT_100))
 			result = OsuScore::HIT::HIT_300;
@@ -159,7 +163,8 @@ void OsuHitObject::addHitResult(OsuScore::HIT result, long delta, Vector2 posRaw
 		else
 			result = OsuScore::HIT::HIT_MISS;
 
-		m_beatmap->getOsu()->getHUD()->addTarget(targetDelta, targetAngle);
+		if (!m_beatmap->isSimulating())
+			m_beatmap->getOsu()->getHUD()->addTarget(targetDelta, targetAngle);
 	}
 
 	m_beatmap->addHitResult(result, delta, ignoreOnHitErrorBar, false, ignoreCombo);
@@ -171,6 +176,44 @@ void OsuHitObject::addHitResult(OsuScore::HIT result, long delta, Vector2 posRaw
 	m_hitResults.push_back(hitresult);
 }
 
+void OsuHitObject::playHitSound(int sampleType, float pan, long musicTime)
+{
+	OsuSkin *skin = m_beatmap->getSkin();
+	if (!osu_hitsound_scheduler.getBool())
+	{
+		skin->playHitCircleSound(sampleType, pan);
+		return;
+	}
+
+	if (skin->getSampleVolume() <= 0)
+		return;
+
+	std::vector<Sound*> sounds;
+	skin->getHitCircleSounds(sampleType, &sounds);
+
+	OsuHitSoundScheduler *scheduler = m_beatmap->getOsu()->getHitSoundScheduler();
+	for (int i=0; i<sounds.size(); i++)
+	{
+		scheduler->enqueue(sounds[i], skin->getSampleVolume() / 100.0f, pan, musicTime, sounds[i]->getLengthMS());
+	}
+}
+
+void OsuHitObject::playSliderTickSound(float pan, long musicTime)
+{
+	OsuSkin *skin = m_beatmap->getSkin();
+	if (!osu_hitsound_scheduler.getBool())
+	{
+		skin->playSliderTickSound(pan);
+		return;
+	}
+
+	Sound *sound = skin->getSliderTickSound();
+	if (skin->getSampleVolume() <= 0 || sound == NULL)
+		return;
+
+	m_beatmap->getOsu()->getHitSoundScheduler()->enqueue(sound, skin->getSampleVolume() / 100.0f, pan, musicTime, sound->getLengthMS());
+}
+
 void OsuHitObject::onReset(long curPos)
 {
 	m_bMisAim = false;
@@ -178,3 +221,9 @@ void OsuHitObject::onReset(long curPos)
 
 	m_hitResults.clear();
 }
+
+void OsuHitObject::onRestore(long curPos, bool finished, const PROGRESS *progress)
+{
+	onReset(curPos);
+	m_bFinished = finished;
+}
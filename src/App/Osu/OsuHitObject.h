@@ -12,6 +12,35 @@
 
 class OsuHitObject
 {
+public:
+	struct PROGRESS // partial judgement state for gameplay checkpoints, only stored for objects which are in progress at the checkpoint time
+	{
+		int index; // into the hitobjects vector of the beatmap
+
+		// sliders
+		OsuScore::HIT startResult;
+		bool startFinished;
+		int nextEvent;
+		int numSuccessfulEvents;
+		bool heldTillEnd;
+		long lastClickHeld;
+		bool cursorLeft;
+		int hitSoundCounter;
+
+		// spinners
+		float rotations;
+		float ratio;
+		float drawRot;
+		float deltaOverflow;
+		float deltaAngleOverflow;
+		float sumDeltaAngle;
+		float lastMouseAngle;
+		float rpm;
+		bool clickedOnce;
+		int deltaAngleIndex;
+		float storedDeltaAngles[48]; // OsuSpinner keeps at most 48
+	};
+
 public:
 	static void drawHitResult(Graphics *g, OsuBeatmap *beatmap, Vector2 rawPos, OsuScore::HIT result, float animPercent);
 	static void drawHitResult(Graphics *g, OsuSkin *skin, float hitcircleDiameter, float rawHitcircleDiameter, Vector2 rawPos, OsuScore::HIT result, float animPercent);
@@ -51,7 +80,14 @@ public:
 	virtual void onClickEvent(Vector2 cursorPos, std::vector<OsuBeatmap::CLICK> &clicks) {;}
 	virtual void onReset(long curPos);
 
+	virtual bool getProgress(long curPos, PROGRESS *progress) const {return false;} // true if this object is partially judged at curPos (and progress has been filled)
+	virtual void onRestore(long curPos, bool finished, const PROGRESS *progress); // like onReset(), but with the judgement state of a checkpoint instead of assuming everything before curPos was hit (progress may be NULL)
+
 protected:
+	// enqueued into the OsuHitSoundScheduler at the music time at which they should be heard (osu_hitsound_scheduler 0 plays them directly instead)
+	void playHitSound(int sampleType, float pan, long musicTime);
+	void playSliderTickSound(float pan, long musicTime);
+
 	OsuBeatmap *m_beatmap;
 
 	bool m_bVisible;
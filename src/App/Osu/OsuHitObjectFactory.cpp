@@ -0,0 +1,645 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		builds drawable hitobjects from the raw difficulty data, on demand
+//
+// $NoKeywords: $osuhof
+//===============================================================================//
+
+#include "OsuHitObjectFactory.h"
+
+#include "Engine.h"
+#include "ConVar.h"
+#include "Timer.h"
+
+#include "OsuBeatmap.h"
+#include "OsuBeatmapDifficulty.h"
+#include "OsuGameRules.h"
+#include "OsuScore.h"
+#include "OsuSimulatedPlayer.h"
+
+#include "OsuHitObject.h"
+#include "OsuCircle.h"
+#include "OsuSlider.h"
+#include "OsuSpinner.h"
+
+#include <algorithm>
+
+ConVar osu_hitobject_lazy_instantiation("osu_hitobject_lazy_instantiation", true, "Only create hitobjects shortly before they become relevant during gameplay, instead of all of them when starting the beatmap");
+ConVar osu_hitobject_lazy_lookahead("osu_hitobject_lazy_lookahead", 1000, "How many milliseconds (in addition to the approach time) hitobjects are created in advance");
+ConVar osu_show_approach_circle_on_first_hidden_object("osu_show_approach_circle_on_first_hidden_object", true);
+
+const float STACK_LENIENCE = 3.0f;
+
+struct HitObjectEndTimeSortComparator
+{
+    bool operator() (OsuHitObject const *a, OsuHitObject const *b) const
+    {
+        return (a->getTime() + a->getDuration()) < (b->getTime() + b->getDuration());
+    }
+};
+
+// same as the curve percentage in OsuSlider::getOriginalRawPosAt(), but without a slider
+float getSliderCurvePercentAt(const OsuBeatmapDifficulty::SLIDER &slider, long pos)
+{
+	if (pos <= slider.time)
+		return 0.0f;
+	else if (pos >= slider.time + slider.sliderTime)
+		return (slider.repeat % 2 == 0 ? 0.0f : 1.0f);
+	else
+	{
+		const float t = (float)((long)pos - (long)slider.time) / slider.sliderTimeWithoutRepeats;
+		const float floorVal = (float) std::floor(t);
+		return (((int)floorVal % 2 == 0) ? t - floorVal : floorVal + 1 - t);
+	}
+}
+
+OsuHitObjectFactory::OsuHitObjectFactory(OsuBeatmap *beatmap, OsuBeatmapDifficulty *diff, std::vector<OsuHitObject*> *hitobjects, std::vector<OsuHitObject*> *hitobjectsSortedByEndTime)
+{
+	m_beatmap = beatmap;
+	m_diff = diff;
+	m_hitobjects = hitobjects;
+	m_hitobjectsSortedByEndTime = hitobjectsSortedByEndTime;
+
+	m_iNumCreatedObjects = 0;
+	m_fStackOffset = 0.0f;
+
+	// build the index, the start and end positions are required for stacking
+	m_entries.reserve(m_diff->hitcircles.size() + m_diff->sliders.size() + m_diff->spinners.size());
+	for (int i=0; i<m_diff->hitcircles.size(); i++)
+	{
+		const OsuBeatmapDifficulty::HITCIRCLE &c = m_diff->hitcircles[i];
+
+		ENTRY entry;
+		entry.type = TYPE_CIRCLE;
+		entry.index = i;
+		entry.time = (long)c.time;
+		entry.duration = 0;
+		entry.originalStartPos = Vector2(c.x, c.y);
+		entry.originalEndPos = entry.originalStartPos;
+		entry.originalTailPos = entry.originalStartPos;
+		entry.comboNumber = c.number;
+		entry.stack = 0;
+		m_entries.push_back(entry);
+	}
+	for (int i=0; i<m_diff->sliders.size(); i++)
+	{
+		const OsuBeatmapDifficulty::SLIDER &s = m_diff->sliders[i];
+
+		ENTRY entry;
+		entry.type = TYPE_SLIDER;
+		entry.index = i;
+		entry.time = s.time;
+		entry.duration = (long)s.sliderTime;
+		entry.comboNumber = s.number;
+		entry.stack = 0;
+
+		// no curve is built here (that only happens once the OsuSlider is created), the three positions are evaluated directly
+		if (s.points.size() > 0)
+		{
+			const float percents[3] = {getSliderCurvePercentAt(s, entry.time), getSliderCurvePercentAt(s, entry.time + entry.duration), getSliderCurvePercentAt(s, entry.time + entry.duration + 1)};
+			Vector2 positions[3];
+			OsuSliderCurve::calculateOriginalPointsAt(s.type, s.points, s.pixelLength, percents, positions, 3);
+			entry.originalStartPos = positions[0];
+			entry.originalEndPos = positions[1];
+			entry.originalTailPos = positions[2];
+		}
+
+		m_entries.push_back(entry);
+	}
+	for (int i=0; i<m_diff->spinners.size(); i++)
+	{
+		const OsuBeatmapDifficulty::SPINNER &s = m_diff->spinners[i];
+
+		ENTRY entry;
+		entry.type = TYPE_SPINNER;
+		entry.index = i;
+		entry.time = (long)s.time;
+		entry.duration = (long)s.endTime - (long)s.time;
+		entry.originalStartPos = Vector2(s.x, s.y);
+		entry.originalEndPos = entry.originalStartPos;
+		entry.originalTailPos = entry.originalStartPos;
+		entry.comboNumber = -1;
+		entry.stack = 0;
+		m_entries.push_back(entry);
+	}
+
+	// sort by starttime
+	struct EntrySortComparator
+	{
+	    bool operator() (ENTRY const &a, ENTRY const &b) const
+	    {
+	        return a.time < b.time;
+	    }
+	};
+	std::stable_sort(m_entries.begin(), m_entries.end(), EntrySortComparator());
+}
+
+int OsuHitObjectFactory::update(long curPos)
+{
+	if (isComplete())
+		return 0;
+
+	if (!osu_hitobject_lazy_instantiation.getBool())
+		return createAll();
+
+	// everything which can become visible before horizon must exist (approach circles, followpoints, notes per second, note density, etc.)
+	// also, the object after the last created one must exist as soon as its predecessor is over (next object time for auto and skippable sections)
+	const long horizon = curPos + (long)std::max(m_beatmap->getDifficulty().approachTime, OsuGameRules::getMinApproachTime()) + (long)osu_hitobject_lazy_lookahead.getInt();
+
+	int numObjects = m_iNumCreatedObjects;
+	while (numObjects < m_entries.size())
+	{
+		if (numObjects > 0 && m_entries[numObjects].time > horizon && m_entries[numObjects-1].time + m_entries[numObjects-1].duration > horizon)
+			break;
+
+		numObjects++;
+	}
+
+	return createUntil(numObjects);
+}
+
+int OsuHitObjectFactory::createAll()
+{
+	return createUntil(m_entries.size());
+}
+
+int OsuHitObjectFactory::createUntil(int numObjects)
+{
+	const int numCreatedObjectsBefore = m_iNumCreatedObjects;
+
+	for (; m_iNumCreatedObjects<numObjects; m_iNumCreatedObjects++)
+	{
+		const ENTRY &entry = m_entries[m_iNumCreatedObjects];
+		OsuHitObject *hitObject = create(entry);
+
+		// special rule for first hitobject (for 1 approach circle with HD)
+		if (m_iNumCreatedObjects == 0 && osu_show_approach_circle_on_first_hidden_object.getBool())
+			hitObject->setForceDrawApproachCircle(true);
+
+		hitObject->setStack(entry.stack);
+		if (entry.stack != 0)
+			hitObject->updateStackPosition(m_fStackOffset);
+
+		m_hitobjects->push_back(hitObject);
+
+		// the drawing order is different from the playing/input order.
+		// for drawing, if multiple hitobjects occupy the same time (duration) then they get drawn on top of the active hitobject
+		m_hitobjectsSortedByEndTime->insert(std::upper_bound(m_hitobjectsSortedByEndTime->begin(), m_hitobjectsSortedByEndTime->end(), hitObject, HitObjectEndTimeSortComparator()), hitObject);
+	}
+
+	return m_iNumCreatedObjects - numCreatedObjectsBefore;
+}
+
+OsuHitObject *OsuHitObjectFactory::create(const ENTRY &entry)
+{
+	switch (entry.type)
+	{
+	case TYPE_CIRCLE:
+		{
+			const OsuBeatmapDifficulty::HITCIRCLE &c = m_diff->hitcircles[entry.index];
+			return new OsuCircle(c.x, c.y, c.time, c.sampleType, c.number, c.colorCounter, m_beatmap);
+		}
+	case TYPE_SLIDER:
+		{
+			const OsuBeatmapDifficulty::SLIDER &s = m_diff->sliders[entry.index];
+			return new OsuSlider(s.type, s.repeat, s.pixelLength, s.points, s.hitSounds, s.ticks, s.events, s.sliderTime, s.sliderTimeWithoutRepeats, s.time, s.sampleType, s.number, s.colorCounter, m_beatmap);
+		}
+	default:
+		{
+			const OsuBeatmapDifficulty::SPINNER &s = m_diff->spinners[entry.index];
+			return new OsuSpinner(s.x, s.y, s.time, s.sampleType, s.endTime, m_beatmap);
+		}
+	}
+}
+
+void OsuHitObjectFactory::calculateStacks(float approachTime, float stackOffset)
+{
+	m_fStackOffset = stackOffset;
+
+	// reset
+	for (int i=0; i<m_entries.size(); i++)
+	{
+		m_entries[i].stack = 0;
+	}
+
+	// peppy's algorithm
+	// https://gist.github.com/peppy/1167470
+
+	for (int i=m_entries.size()-1; i>=0; i--)
+	{
+		int n = i;
+
+		ENTRY *objectI = &m_entries[i];
+
+		if (objectI->stack != 0 || objectI->type == TYPE_SPINNER)
+			continue;
+
+		if (objectI->type == TYPE_CIRCLE)
+		{
+			while (--n >= 0)
+			{
+				ENTRY *objectN = &m_entries[n];
+
+				if (objectN->type == TYPE_SPINNER)
+					continue;
+
+				if (objectI->time - (approachTime * m_diff->stackLeniency) > (objectN->time + objectN->duration))
+					break;
+
+				const Vector2 objectNEndPosition = objectN->originalEndPos;
+				if (objectN->duration != 0 && (objectNEndPosition - objectI->originalStartPos).length() < STACK_LENIENCE)
+				{
+					int offset = objectI->stack - objectN->stack + 1;
+					for (int j=n+1; j<=i; j++)
+					{
+						if ((objectNEndPosition - m_entries[j].originalStartPos).length() < STACK_LENIENCE)
+							m_entries[j].stack = m_entries[j].stack - offset;
+					}
+
+					break;
+				}
+
+				if ((objectN->originalStartPos - objectI->originalStartPos).length() < STACK_LENIENCE)
+				{
+					objectN->stack = objectI->stack + 1;
+					objectI = objectN;
+				}
+			}
+		}
+		else if (objectI->type == TYPE_SLIDER)
+		{
+			while (--n >= 0)
+			{
+				ENTRY *objectN = &m_entries[n];
+
+				if (objectN->type == TYPE_SPINNER)
+					continue;
+
+				if (objectI->time - (approachTime * m_diff->stackLeniency) > objectN->time)
+					break;
+
+				if (((objectN->duration != 0 ? objectN->originalEndPos : objectN->originalStartPos) - objectI->originalStartPos).length() < STACK_LENIENCE)
+				{
+					objectN->stack = objectI->stack + 1;
+					objectI = objectN;
+				}
+			}
+		}
+	}
+
+	// update the positions of all objects which already exist (objects which are created later get their stack in createUntil())
+	for (int i=0; i<m_iNumCreatedObjects && i<m_hitobjects->size(); i++)
+	{
+		OsuHitObject *hitObject = (*m_hitobjects)[i];
+		const bool wasStacked = hitObject->getStack() != 0;
+
+		hitObject->setStack(m_entries[i].stack);
+		if (m_entries[i].stack != 0 || wasStacked)
+			hitObject->updateStackPosition(m_fStackOffset);
+	}
+}
+
+Vector2 OsuHitObjectFactory::getRawStartPos(int index) const
+{
+	return m_entries[index].originalStartPos - getStackOffset(m_entries[index]);
+}
+
+Vector2 OsuHitObjectFactory::getRawTailPos(int index) const
+{
+	return m_entries[index].originalTailPos - getStackOffset(m_entries[index]);
+}
+
+Vector2 OsuHitObjectFactory::getStackOffset(const ENTRY &entry) const
+{
+	// see OsuCircle::updateStackPosition() and OsuSliderCurve::updateStackPosition()
+	if (entry.stack == 0 || entry.type == TYPE_SPINNER)
+		return Vector2(0, 0);
+
+	const float offset = entry.stack * m_fStackOffset;
+	return Vector2(offset, offset * (m_beatmap->getMods().has(OsuMods::HR) ? -1.0f : 1.0f));
+}
+
+long OsuHitObjectFactory::getFirstTime() const
+{
+	if (m_entries.size() > 0)
+		return m_entries[0].time;
+	else
+		return 0;
+}
+
+long OsuHitObjectFactory::getLastEndTime() const
+{
+	if (m_entries.size() > 0)
+		return m_entries[m_entries.size()-1].time + m_entries[m_entries.size()-1].duration;
+	else
+		return 0;
+}
+
+
+
+// the previous implementation (peppy's algorithm directly on the drawable hitobjects), only used as a reference by the benchmark below
+void calculateStacksReference(std::vector<OsuHitObject*> &hitobjects, float approachTime, float stackLeniency)
+{
+	for (int i=0; i<hitobjects.size(); i++)
+	{
+		hitobjects[i]->setStack(0);
+	}
+
+	for (int i=hitobjects.size()-1; i>=0; i--)
+	{
+		int n = i;
+
+		OsuHitObject *objectI = hitobjects[i];
+
+		if (objectI->getStack() != 0 || dynamic_cast<OsuSpinner*>(objectI) != NULL)
+			continue;
+
+		if (dynamic_cast<OsuCircle*>(objectI) != NULL)
+		{
+			while (--n >= 0)
+			{
+				OsuHitObject *objectN = hitobjects[n];
+
+				if (dynamic_cast<OsuSpinner*>(objectN) != NULL)
+					continue;
+
+				if (objectI->getTime() - (approachTime * stackLeniency) > (objectN->getTime() + objectN->getDuration()))
+					break;
+
+				Vector2 objectNEndPosition = objectN->getOriginalRawPosAt(objectN->getTime() + objectN->getDuration());
+				if (objectN->getDuration() != 0 && (objectNEndPosition - objectI->getOriginalRawPosAt(objectI->getTime())).length() < STACK_LENIENCE)
+				{
+					int offset = objectI->getStack() - objectN->getStack() + 1;
+					for (int j=n+1; j<=i; j++)
+					{
+						if ((objectNEndPosition - hitobjects[j]->getOriginalRawPosAt(hitobjects[j]->getTime())).length() < STACK_LENIENCE)
+							hitobjects[j]->setStack(hitobjects[j]->getStack() - offset);
+					}
+
+					break;
+				}
+
+				if ((objectN->getOriginalRawPosAt(objectN->getTime()) - objectI->getOriginalRawPosAt(objectI->getTime())).length() < STACK_LENIENCE)
+				{
+					objectN->setStack(objectI->getStack() + 1);
+					objectI = objectN;
+				}
+			}
+		}
+		else if (dynamic_cast<OsuSlider*>(objectI) != NULL)
+		{
+			while (--n >= 0)
+			{
+				OsuHitObject *objectN = hitobjects[n];
+
+				if (dynamic_cast<OsuSpinner*>(objectN) != NULL)
+					continue;
+
+				if (objectI->getTime() - (approachTime * stackLeniency) > objectN->getTime())
+					break;
+
+				if (((objectN->getDuration() != 0 ? objectN->getOriginalRawPosAt(objectN->getTime() + objectN->getDuration()) : objectN->getOriginalRawPosAt(objectN->getTime())) - objectI->getOriginalRawPosAt(objectI->getTime())).length() < STACK_LENIENCE)
+				{
+					objectN->setStack(objectI->getStack() + 1);
+					objectI = objectN;
+				}
+			}
+		}
+	}
+}
+
+void OsuHitObjectFactory::generateBenchmarkDifficulty(OsuBeatmapDifficulty *diff, int numObjects, long minLength)
+{
+	diff->stackLeniency = 0.7f;
+	long time = 1000;
+	for (int i=0; i<numObjects || time < minLength; i++)
+	{
+		if (i % 100 == 99)
+		{
+			OsuBeatmapDifficulty::SPINNER s;
+			s.x = 256;
+			s.y = 192;
+			s.time = time;
+			s.sampleType = 0;
+			s.endTime = time + 2000;
+			diff->spinners.push_back(s);
+
+			time += 3000;
+		}
+		else if (i % 4 == 3)
+		{
+			const char types[] = {OsuSlider::SLIDER_LINEAR, OsuSlider::SLIDER_BEZIER, OsuSlider::SLIDER_PASSTHROUGH};
+
+			OsuBeatmapDifficulty::SLIDER s;
+			s.type = types[(i/4) % 3];
+			s.repeat = 1 + (i % 3);
+			s.pixelLength = 200.0f;
+			s.time = time;
+			s.sampleType = 0;
+			s.number = (i % 8) + 1;
+			s.colorCounter = i / 8;
+			s.points.push_back(Vector2(100 + (i % 5)*60, 80 + (i % 3)*100));
+			s.points.push_back(Vector2(200 + (i % 5)*60, 20 + (i % 3)*100));
+			s.points.push_back(Vector2(300 + (i % 5)*60, 80 + (i % 3)*100));
+			OsuBeatmapDifficulty::calculateSliderEvents(&s, 500.0f, 500.0f, 2.5f, 1.0f);
+			for (int r=0; r<s.repeat+1; r++)
+			{
+				s.hitSounds.push_back(0);
+			}
+			diff->sliders.push_back(s);
+
+			time += (long)s.sliderTime + 250;
+		}
+		else
+		{
+			OsuBeatmapDifficulty::HITCIRCLE c;
+			c.x = (i % 16 < 4 ? 256 : 64 + (i % 7)*64);
+			c.y = (i % 16 < 4 ? 192 : 48 + (i % 5)*64);
+			c.time = time;
+			c.sampleType = 0;
+			c.number = (i % 8) + 1;
+			c.colorCounter = i / 8;
+			c.clicked = false;
+			diff->hitcircles.push_back(c);
+
+			time += 125;
+		}
+	}
+}
+
+// plays the whole diff headless with OsuSimulatedPlayer at 60 fps, false if the beatmap can't simulate right now (e.g. while playing)
+bool simulateBenchmarkDifficulty(OsuBeatmap *beatmap, OsuBeatmapDifficulty *diff, OsuScore *score)
+{
+	if (!beatmap->beginSimulation(diff, score))
+		return false;
+
+	OsuSimulatedPlayer player(beatmap, diff);
+	for (long curPos=-1000; curPos<player.getLastEndTime()+1000; curPos+=16)
+	{
+		player.update(curPos, 0.016f);
+	}
+
+	beatmap->endSimulation();
+	return true;
+}
+
+void OsuHitObjectFactory::benchmark(OsuBeatmap *beatmap, int numObjects)
+{
+	const float approachTime = OsuGameRules::getApproachTime(beatmap);
+	const float stackOffset = beatmap->getRawHitcircleDiameter() * 0.05f;
+	const float curvePointsSeparation = 2.5f; // see OsuSliderCurve::CURVE_POINTS_SEPERATION
+
+	OsuBeatmapDifficulty diff(NULL, "", "");
+	generateBenchmarkDifficulty(&diff, numObjects);
+
+	// approximate memory usage of the raw data
+	size_t rawBytes = diff.hitcircles.size()*sizeof(OsuBeatmapDifficulty::HITCIRCLE) + diff.spinners.size()*sizeof(OsuBeatmapDifficulty::SPINNER) + numObjects*sizeof(ENTRY);
+	for (int i=0; i<diff.sliders.size(); i++)
+	{
+		rawBytes += sizeof(OsuBeatmapDifficulty::SLIDER) + diff.sliders[i].points.size()*sizeof(Vector2) + diff.sliders[i].hitSounds.size()*sizeof(int) + diff.sliders[i].ticks.size()*sizeof(float);
+	}
+
+	// raw data + stacks only
+	Timer t;
+	t.start();
+	std::vector<OsuHitObject*> lazyObjects;
+	std::vector<OsuHitObject*> lazyObjectsSortedByEndTime;
+	OsuHitObjectFactory *lazyFactory = new OsuHitObjectFactory(beatmap, &diff, &lazyObjects, &lazyObjectsSortedByEndTime);
+	lazyFactory->calculateStacks(approachTime, stackOffset);
+	lazyFactory->createUntil(1);
+	t.update();
+	const double lazyTime = t.getElapsedTime();
+
+	// everything
+	t.start();
+	std::vector<OsuHitObject*> objects;
+	std::vector<OsuHitObject*> objectsSortedByEndTime;
+	OsuHitObjectFactory *factory = new OsuHitObjectFactory(beatmap, &diff, &objects, &objectsSortedByEndTime);
+	factory->calculateStacks(approachTime, stackOffset);
+	factory->createAll();
+	t.update();
+	const double eagerTime = t.getElapsedTime();
+
+	// approximate memory usage of the drawables (objects + slider curves, the curves store 2 copies of all points + segments)
+	size_t drawableBytes = 0;
+	for (int i=0; i<factory->m_entries.size(); i++)
+	{
+		switch (factory->m_entries[i].type)
+		{
+		case TYPE_CIRCLE:
+			drawableBytes += sizeof(OsuCircle);
+			break;
+		case TYPE_SLIDER:
+			drawableBytes += sizeof(OsuSlider) + sizeof(OsuSliderCurveEqualDistanceMulti) + 4*(size_t)(diff.sliders[factory->m_entries[i].index].pixelLength / curvePointsSeparation + 1)*sizeof(Vector2);
+			break;
+		case TYPE_SPINNER:
+			drawableBytes += sizeof(OsuSpinner);
+			break;
+		}
+	}
+
+	// simulate gameplay (60 fps) with lazy instantiation
+	t.start();
+	int numCreatedAtStart = lazyFactory->getNumCreatedObjects();
+	for (long curPos=-1000; curPos<lazyFactory->getLastEndTime()+1000; curPos+=16)
+	{
+		lazyFactory->update(curPos);
+		if (curPos <= lazyFactory->getFirstTime())
+			numCreatedAtStart = lazyFactory->getNumCreatedObjects();
+	}
+	lazyFactory->createAll();
+	t.update();
+	const double lazyGameplayTime = t.getElapsedTime();
+
+	// verify: lazily created objects must be identical to the eagerly created ones, and the stacks must be identical to the previous implementation
+	calculateStacksReference(objects, approachTime, diff.stackLeniency);
+	int numMismatches = 0;
+	int numStacked = 0;
+	for (int i=0; i<objects.size() && i<lazyObjects.size(); i++)
+	{
+		OsuHitObject *a = objects[i];
+		OsuHitObject *b = lazyObjects[i];
+
+		if (a->getStack() != 0)
+			numStacked++;
+
+		if (a->getTime() != b->getTime() || a->getDuration() != b->getDuration() || a->getComboNumber() != b->getComboNumber() || a->getStack() != b->getStack()
+				|| a->getRawPosAt(a->getTime()) != b->getRawPosAt(b->getTime()) || a->getRawPosAt(a->getTime() + a->getDuration()) != b->getRawPosAt(b->getTime() + b->getDuration())
+				|| lazyObjectsSortedByEndTime[i]->getTime() + lazyObjectsSortedByEndTime[i]->getDuration() != objectsSortedByEndTime[i]->getTime() + objectsSortedByEndTime[i]->getDuration())
+			numMismatches++;
+	}
+	if (objects.size() != lazyObjects.size())
+		numMismatches += std::abs((int)objects.size() - (int)lazyObjects.size());
+
+	// the curve-less slider positions of the index must match the real curves (up to float rounding)
+	// also catmull, and passthrough with all points on a line (which becomes a bezier)
+	std::vector<OsuBeatmapDifficulty::SLIDER> curveSliders = diff.sliders;
+	for (int i=0; i<2 && diff.sliders.size() > 0; i++)
+	{
+		OsuBeatmapDifficulty::SLIDER s = diff.sliders[0];
+		s.type = (i == 0 ? OsuSlider::SLIDER_CATMULL : OsuSlider::SLIDER_PASSTHROUGH);
+		s.points.clear();
+		for (int p=0; p<3 + (i == 0 ? 2 : 0); p++)
+		{
+			s.points.push_back(i == 0 ? Vector2(100 + p*60, 100 + (p % 2)*80) : Vector2(100 + p*50, 100 + p*20));
+		}
+		curveSliders.push_back(s);
+	}
+	int numCurveMismatches = 0;
+	for (int i=0; i<curveSliders.size(); i++)
+	{
+		const OsuBeatmapDifficulty::SLIDER &s = curveSliders[i];
+
+		const float percents[5] = {0.0f, 0.37f, 0.5f, 0.999f, 1.0f};
+		Vector2 positions[5];
+		OsuSliderCurve::calculateOriginalPointsAt(s.type, s.points, s.pixelLength, percents, positions, 5);
+
+		OsuSliderCurve *curve = OsuSliderCurve::createCurve(s.type, s.points, s.pixelLength, beatmap);
+		for (int p=0; p<5; p++)
+		{
+			if ((curve->originalPointAt(percents[p]) - positions[p]).length() > 0.01f)
+				numCurveMismatches++;
+		}
+		delete curve;
+	}
+	numMismatches += numCurveMismatches;
+
+	// the judgements must be identical as well: the same simulated input on the same map, once with eager and once with lazy instantiation
+	// (a shorter map, since every frame updates all created hitobjects)
+	OsuBeatmapDifficulty judgementDiff(NULL, "", "");
+	generateBenchmarkDifficulty(&judgementDiff, std::min(numObjects, 500));
+	OsuScore eagerScore(beatmap->getOsu(), true);
+	OsuScore lazyScore(beatmap->getOsu(), true);
+	const bool wasLazy = osu_hitobject_lazy_instantiation.getBool();
+	osu_hitobject_lazy_instantiation.setValue(0.0f);
+	bool simulated = simulateBenchmarkDifficulty(beatmap, &judgementDiff, &eagerScore);
+	osu_hitobject_lazy_instantiation.setValue(1.0f);
+	simulated = simulated && simulateBenchmarkDifficulty(beatmap, &judgementDiff, &lazyScore);
+	osu_hitobject_lazy_instantiation.setValue(wasLazy ? 1.0f : 0.0f);
+	const int numJudgementMismatches = (simulated ? eagerScore.getNumDifferences(lazyScore) : 0);
+	numMismatches += numJudgementMismatches;
+	if (!simulated)
+		numMismatches++;
+
+	debugLog("osu_hitobject_benchmark: %i objects (%i circles, %i sliders, %i spinners), %i stacked\n", numObjects, (int)diff.hitcircles.size(), (int)diff.sliders.size(), (int)diff.spinners.size(), numStacked);
+	debugLog("osu_hitobject_benchmark: raw data + stacks: %f ms, ~%i KB (%i objects created before the first hitobject)\n", lazyTime*1000.0, (int)(rawBytes / 1024), numCreatedAtStart);
+	debugLog("osu_hitobject_benchmark: raw data + stacks + all drawables: %f ms, ~%i KB\n", eagerTime*1000.0, (int)((rawBytes + drawableBytes) / 1024));
+	debugLog("osu_hitobject_benchmark: lazy instantiation over the whole map: %f ms in total\n", lazyGameplayTime*1000.0);
+	debugLog("osu_hitobject_benchmark: %i curve-less slider positions off by more than 0.01 osu!pixels\n", numCurveMismatches);
+	if (simulated)
+		debugLog("osu_hitobject_benchmark: judgements of %i simulated objects (%i hit results, %i misses, %i slider breaks): %i differences between eager and lazy\n", (int)(judgementDiff.hitcircles.size() + judgementDiff.sliders.size() + judgementDiff.spinners.size()), (int)eagerScore.getHitResults().size(), eagerScore.getNumMisses(), eagerScore.getNumSliderBreaks(), numJudgementMismatches);
+	else
+		debugLog("osu_hitobject_benchmark: can't simulate the judgements while playing!\n");
+	debugLog("osu_hitobject_benchmark: %s (%i mismatches)\n", numMismatches == 0 ? "PASSED" : "FAILED", numMismatches);
+
+	for (int i=0; i<objects.size(); i++)
+	{
+		delete objects[i];
+	}
+	for (int i=0; i<lazyObjects.size(); i++)
+	{
+		delete lazyObjects[i];
+	}
+	delete factory;
+	delete lazyFactory;
+}
@@ -0,0 +1,84 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		builds drawable hitobjects from the raw difficulty data, on demand
+//
+// $NoKeywords: $osuhof
+//===============================================================================//
+
+#ifndef OSUHITOBJECTFACTORY_H
+#define OSUHITOBJECTFACTORY_H
+
+#include "cbase.h"
+
+class OsuBeatmap;
+class OsuBeatmapDifficulty;
+class OsuHitObject;
+
+class OsuHitObjectFactory
+{
+public:
+	// the created objects are appended to hitobjects (sorted by time) and inserted into hitobjectsSortedByEndTime, they are owned by whoever owns these vectors
+	OsuHitObjectFactory(OsuBeatmap *beatmap, OsuBeatmapDifficulty *diff, std::vector<OsuHitObject*> *hitobjects, std::vector<OsuHitObject*> *hitobjectsSortedByEndTime);
+
+	int update(long curPos); // creates all objects which are about to become relevant at curPos (or all of them, if lazy instantiation is disabled), returns the number of newly created objects
+	int createAll();
+
+	void calculateStacks(float approachTime, float stackOffset); // on the raw data, also updates all objects which have already been created
+
+	inline int getNumObjects() const {return m_entries.size();}
+	inline int getNumCreatedObjects() const {return m_iNumCreatedObjects;}
+	inline bool isComplete() const {return m_iNumCreatedObjects >= m_entries.size();}
+
+	long getFirstTime() const;
+	long getLastEndTime() const;
+
+	// raw data of any object, including the ones which have not been created yet (the positions include the stack offset, same as OsuHitObject::getRawPosAt())
+	inline long getTime(int index) const {return m_entries[index].time;}
+	inline long getDuration(int index) const {return m_entries[index].duration;}
+	inline int getComboNumber(int index) const {return m_entries[index].comboNumber;}
+	inline bool isSpinner(int index) const {return m_entries[index].type == TYPE_SPINNER;}
+	Vector2 getRawStartPos(int index) const;
+	Vector2 getRawTailPos(int index) const; // where the object is after it has ended (e.g. slider end, depending on the number of repeats)
+
+	// synthetic map: 1/2 circles with regular stacks, sliders (linear, bezier, passthrough, some of them stacked on their predecessors' ends) and the occasional spinner
+	// at least numObjects, and more until the map is at least minLength ms long
+	static void generateBenchmarkDifficulty(OsuBeatmapDifficulty *diff, int numObjects, long minLength = 0);
+
+	static void benchmark(OsuBeatmap *beatmap, int numObjects);
+
+private:
+	enum TYPE
+	{
+		TYPE_CIRCLE,
+		TYPE_SLIDER,
+		TYPE_SPINNER
+	};
+
+	struct ENTRY
+	{
+		TYPE type;
+		int index; // into the hitcircles/sliders/spinners vector of the difficulty
+		long time;
+		long duration;
+		Vector2 originalStartPos; // unstacked, only valid for circles and sliders
+		Vector2 originalEndPos; // at time + duration (which is truncated for sliders)
+		Vector2 originalTailPos; // after time + duration
+		int comboNumber;
+		int stack;
+	};
+
+	OsuHitObject *create(const ENTRY &entry);
+	Vector2 getStackOffset(const ENTRY &entry) const;
+	int createUntil(int numObjects);
+
+	OsuBeatmap *m_beatmap;
+	OsuBeatmapDifficulty *m_diff;
+	std::vector<OsuHitObject*> *m_hitobjects;
+	std::vector<OsuHitObject*> *m_hitobjectsSortedByEndTime;
+
+	std::vector<ENTRY> m_entries; // sorted by time
+	int m_iNumCreatedObjects;
+	float m_fStackOffset;
+};
+
+#endif
@@ -0,0 +1,601 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		hit sound queue + voice pool
+//
+// $NoKeywords: $osuhitsndsched
+//===============================================================================//
+
+#include "OsuHitSoundScheduler.h"
+
+#include "Engine.h"
+#include "SoundEngine.h"
+#include "ConVar.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <math.h>
+
+ConVar osu_hitsound_voices("osu_hitsound_voices", 32, "size of the hit sound voice pool");
+ConVar osu_hitsound_max_polyphony("osu_hitsound_max_polyphony", 8, "how many voices a single hit sound may occupy at once, the oldest one is stolen beyond that");
+ConVar osu_hitsound_scheduler_interval("osu_hitsound_scheduler_interval", 1.0f, "how often the hit sound thread checks for due events, in ms");
+ConVar osu_hitsound_scheduler_seek_threshold("osu_hitsound_scheduler_seek_threshold", 100.0f, "the music clock jumping back by more than this many ms clears all pending hit sounds");
+
+static bool hitSoundSchedulerEventLess(const OsuHitSoundScheduler::EVENT &a, const OsuHitSoundScheduler::EVENT &b)
+{
+	if (a.musicTime != b.musicTime)
+		return a.musicTime < b.musicTime;
+	return a.sequence < b.sequence;
+}
+
+void OsuHitSoundScheduler::EngineBackend::play(int voice, const EVENT &event, double lateness)
+{
+	if (event.sound != NULL)
+		engine->getSound()->play(event.sound);
+}
+
+void OsuHitSoundScheduler::EngineBackend::stop(int voice, const EVENT &event)
+{
+	// never called, see canStopVoices()
+}
+
+void OsuHitSoundScheduler::NullBackend::play(int voice, const EVENT &event, double lateness)
+{
+	PLAYED p;
+	p.voice = voice;
+	p.event = event;
+	p.lateness = lateness;
+	played.push_back(p);
+}
+
+void OsuHitSoundScheduler::NullBackend::stop(int voice, const EVENT &event)
+{
+	PLAYED p;
+	p.voice = voice;
+	p.event = event;
+	p.lateness = 0.0;
+	stopped.push_back(p);
+}
+
+OsuHitSoundScheduler::OsuHitSoundScheduler(BACKEND *backend, bool threaded, int numVoices, int maxPolyphony)
+{
+	m_backend = backend;
+	m_iMaxPolyphony = std::max(maxPolyphony < 0 ? osu_hitsound_max_polyphony.getInt() : maxPolyphony, 1);
+
+	VOICE voice;
+	voice.active = false;
+	voice.startTime = 0.0;
+	voice.endTime = 0.0;
+	m_voices.resize(std::max(numVoices < 0 ? osu_hitsound_voices.getInt() : numVoices, 1), voice);
+
+	m_iQueueHead = 0;
+	m_iQueueTail = 0;
+	m_iNextSequence = 0;
+	m_iGeneration = 0;
+
+	m_fClockMusicTime = 0.0;
+	m_fClockSpeed = 0.0;
+	m_clockTime = std::chrono::steady_clock::now();
+
+	m_bStopThread = false;
+	m_iNumPlayed = 0;
+	m_iNumStolen = 0;
+	m_iNumDropped = 0;
+
+	if (threaded && m_backend->isThreadSafe())
+		m_thread = std::thread(&OsuHitSoundScheduler::threadLoop, this);
+	else if (threaded)
+		debugLog("OsuHitSoundScheduler: The backend isn't thread safe, process() has to be called by its owner\n");
+}
+
+OsuHitSoundScheduler::~OsuHitSoundScheduler()
+{
+	m_bStopThread = true;
+	if (m_thread.joinable())
+		m_thread.join();
+
+	SAFE_DELETE(m_backend);
+}
+
+bool OsuHitSoundScheduler::enqueue(Sound *sound, float volume, float pan, double musicTime, double lengthMS)
+{
+	const unsigned int tail = m_iQueueTail.load(std::memory_order_relaxed);
+	if (tail - m_iQueueHead.load(std::memory_order_acquire) >= (unsigned int)QUEUE_SIZE)
+	{
+		m_iNumDropped++;
+		return false;
+	}
+
+	EVENT &event = m_queue[tail & (QUEUE_SIZE - 1)];
+	event.sound = sound;
+	event.volume = volume;
+	event.pan = clamp<float>(pan, -1.0f, 1.0f);
+	event.musicTime = musicTime;
+	event.lengthMS = lengthMS;
+	event.sequence = m_iNextSequence++;
+	event.generation = m_iGeneration.load(std::memory_order_acquire);
+
+	m_iQueueTail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+void OsuHitSoundScheduler::setMusicTime(double musicTime, double speed)
+{
+	const double previousMusicTime = getMusicTime();
+	{
+		std::lock_guard<std::mutex> lk(m_clockMutex);
+		m_fClockMusicTime = musicTime;
+		m_fClockSpeed = speed;
+		m_clockTime = std::chrono::steady_clock::now();
+	}
+
+	if (musicTime < previousMusicTime - osu_hitsound_scheduler_seek_threshold.getFloat())
+		clear();
+}
+
+double OsuHitSoundScheduler::getMusicTime()
+{
+	std::lock_guard<std::mutex> lk(m_clockMutex);
+	const double elapsedMS = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_clockTime).count();
+	return m_fClockMusicTime + elapsedMS*m_fClockSpeed;
+}
+
+void OsuHitSoundScheduler::clear()
+{
+	std::lock_guard<std::mutex> lk(m_processMutex);
+
+	m_iGeneration++; // whatever is still in the queue gets dropped by process()
+	m_pending.clear();
+	for (size_t i=0; i<m_voices.size(); i++)
+	{
+		m_voices[i].active = false;
+	}
+}
+
+void OsuHitSoundScheduler::process(double musicTime)
+{
+	std::lock_guard<std::mutex> lk(m_processMutex);
+
+	// drain the queue
+	const unsigned int generation = m_iGeneration.load(std::memory_order_acquire);
+	unsigned int head = m_iQueueHead.load(std::memory_order_relaxed);
+	const unsigned int tail = m_iQueueTail.load(std::memory_order_acquire);
+	for (; head != tail; head++)
+	{
+		const EVENT &event = m_queue[head & (QUEUE_SIZE - 1)];
+		if (event.generation == generation)
+			m_pending.insert(std::upper_bound(m_pending.begin(), m_pending.end(), event, hitSoundSchedulerEventLess), event);
+	}
+	m_iQueueHead.store(head, std::memory_order_release);
+
+	// retire finished voices
+	for (size_t i=0; i<m_voices.size(); i++)
+	{
+		if (m_voices[i].active && m_voices[i].endTime <= musicTime)
+			m_voices[i].active = false;
+	}
+
+	// start everything which is due
+	size_t numDue = 0;
+	while (numDue < m_pending.size() && m_pending[numDue].musicTime <= musicTime)
+	{
+		dispatch(m_pending[numDue], musicTime);
+		numDue++;
+	}
+	if (numDue > 0)
+		m_pending.erase(m_pending.begin(), m_pending.begin() + numDue);
+}
+
+void OsuHitSoundScheduler::dispatch(const EVENT &event, double musicTime)
+{
+	int numSameSound = 0;
+	int oldestSameSound = -1;
+	int oldest = -1;
+	int free = -1;
+	for (int i=0; i<(int)m_voices.size(); i++)
+	{
+		const VOICE &voice = m_voices[i];
+		if (!voice.active)
+		{
+			if (free < 0)
+				free = i;
+			continue;
+		}
+
+		if (oldest < 0 || voice.event.sequence < m_voices[oldest].event.sequence)
+			oldest = i;
+
+		if (voice.event.sound == event.sound)
+		{
+			numSameSound++;
+			if (oldestSameSound < 0 || voice.event.sequence < m_voices[oldestSameSound].event.sequence)
+				oldestSameSound = i;
+		}
+	}
+
+	int voice = free;
+	if (numSameSound >= m_iMaxPolyphony)
+		voice = oldestSameSound;
+	else if (voice < 0)
+		voice = oldest;
+
+	if (m_voices[voice].active)
+	{
+		if (!m_backend->canStopVoices())
+		{
+			m_iNumDropped++;
+			return;
+		}
+
+		m_backend->stop(voice, m_voices[voice].event);
+		m_iNumStolen++;
+	}
+
+	m_voices[voice].active = true;
+	m_voices[voice].event = event;
+	m_voices[voice].startTime = musicTime;
+	m_voices[voice].endTime = musicTime + event.lengthMS;
+
+	m_backend->play(voice, event, musicTime - event.musicTime);
+	m_iNumPlayed++;
+}
+
+void OsuHitSoundScheduler::threadLoop()
+{
+	while (!m_bStopThread.load())
+	{
+		process(getMusicTime());
+
+		const float intervalMS = clamp<float>(osu_hitsound_scheduler_interval.getFloat(), 0.1f, 50.0f);
+		std::this_thread::sleep_for(std::chrono::microseconds((long long)(intervalMS*1000.0f)));
+	}
+}
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+static Sound *hitSoundSchedulerTestSound(int index)
+{
+	return (Sound*)(size_t)(0x1000 + index*0x10); // never dereferenced
+}
+
+// the scheduler owns (and deletes) its backend, this one records into a NullBackend which outlives it
+class HitSoundSchedulerTestBackend : public OsuHitSoundScheduler::BACKEND
+{
+public:
+	HitSoundSchedulerTestBackend(OsuHitSoundScheduler::NullBackend *target) {m_target = target;}
+
+	virtual void play(int voice, const OsuHitSoundScheduler::EVENT &event, double lateness) {m_target->play(voice, event, lateness);}
+	virtual void stop(int voice, const OsuHitSoundScheduler::EVENT &event) {m_target->stop(voice, event);}
+
+private:
+	OsuHitSoundScheduler::NullBackend *m_target;
+};
+
+// like the EngineBackend: can't stop single voices
+class HitSoundSchedulerTestEngineBackend : public HitSoundSchedulerTestBackend
+{
+public:
+	HitSoundSchedulerTestEngineBackend(OsuHitSoundScheduler::NullBackend *target) : HitSoundSchedulerTestBackend(target) {;}
+
+	virtual bool canStopVoices() const {return false;}
+};
+
+// main thread only
+class HitSoundSchedulerTestMainThreadBackend : public HitSoundSchedulerTestEngineBackend
+{
+public:
+	HitSoundSchedulerTestMainThreadBackend(OsuHitSoundScheduler::NullBackend *target) : HitSoundSchedulerTestEngineBackend(target) {;}
+
+	virtual bool isThreadSafe() const {return false;}
+};
+
+struct HITSOUNDSCHEDULER_TEST_LATENCY
+{
+	double mean;
+	double stddev;
+	double max;
+	int count;
+};
+
+static HITSOUNDSCHEDULER_TEST_LATENCY hitSoundSchedulerTestLatency(const std::vector<double> &latencies)
+{
+	HITSOUNDSCHEDULER_TEST_LATENCY result;
+	result.mean = 0.0;
+	result.stddev = 0.0;
+	result.max = 0.0;
+	result.count = (int)latencies.size();
+	if (latencies.size() < 1)
+		return result;
+
+	for (size_t i=0; i<latencies.size(); i++)
+	{
+		result.mean += latencies[i];
+		result.max = std::max(result.max, latencies[i]);
+	}
+	result.mean /= latencies.size();
+	for (size_t i=0; i<latencies.size(); i++)
+	{
+		result.stddev += (latencies[i] - result.mean)*(latencies[i] - result.mean);
+	}
+	result.stddev = sqrt(result.stddev / latencies.size());
+	return result;
+}
+
+// a stream of hit sounds at fractional times, with the frames of an update loop at the given rate
+// direct: played by the first frame at or after the event (what playHitCircleSound() did), scheduled: enqueued one frame ahead, started by the scheduler polling every millisecond
+static void hitSoundSchedulerTestBenchmark(double fps, HITSOUNDSCHEDULER_TEST_LATENCY *direct, HITSOUNDSCHEDULER_TEST_LATENCY *scheduled)
+{
+	const int numEvents = 500;
+	const double frameTime = 1000.0 / fps;
+	const double pollTime = 1.0;
+
+	std::vector<double> eventTimes;
+	for (int i=0; i<numEvents; i++)
+	{
+		eventTimes.push_back(500.0 + i*(60000.0/180.0/4.0) + (i % 7)*0.37); // 1/4 stream at 180 bpm
+	}
+	const double endTime = eventTimes.back() + 100.0;
+
+	std::vector<double> directLatencies;
+	{
+		size_t next = 0;
+		for (double frame=0.123; frame<endTime && next<eventTimes.size(); frame+=frameTime)
+		{
+			while (next < eventTimes.size() && eventTimes[next] <= frame)
+			{
+				directLatencies.push_back(frame - eventTimes[next]);
+				next++;
+			}
+		}
+	}
+	*direct = hitSoundSchedulerTestLatency(directLatencies);
+
+	OsuHitSoundScheduler::NullBackend *backend = new OsuHitSoundScheduler::NullBackend();
+	{
+		OsuHitSoundScheduler scheduler(backend, false, 32, 8);
+		size_t next = 0;
+		double frame = 0.123;
+		double poll = 0.071;
+		while (frame < endTime || poll < endTime)
+		{
+			if (frame <= poll)
+			{
+				while (next < eventTimes.size() && eventTimes[next] < frame + frameTime)
+				{
+					scheduler.enqueue(hitSoundSchedulerTestSound(next % 4), 1.0f, 0.0f, eventTimes[next], 100.0);
+					next++;
+				}
+				frame += frameTime;
+			}
+			else
+			{
+				scheduler.process(poll);
+				poll += pollTime;
+			}
+		}
+
+		std::vector<double> scheduledLatencies;
+		for (size_t i=0; i<backend->played.size(); i++)
+		{
+			scheduledLatencies.push_back(backend->played[i].lateness);
+		}
+		*scheduled = hitSoundSchedulerTestLatency(scheduledLatencies);
+	}
+}
+
+void OsuHitSoundScheduler::test()
+{
+	int numTests = 0;
+	int numFailed = 0;
+
+	// ordering: by music time, then enqueue order, nothing before its time
+	{
+		NullBackend *backend = new NullBackend();
+		OsuHitSoundScheduler scheduler(backend, false, 8, 8);
+		scheduler.enqueue(hitSoundSchedulerTestSound(0), 1.0f, 0.0f, 300.0, 50.0);
+		scheduler.enqueue(hitSoundSchedulerTestSound(1), 1.0f, 0.0f, 100.0, 50.0);
+		scheduler.enqueue(hitSoundSchedulerTestSound(2), 1.0f, 0.0f, 200.0, 50.0);
+		scheduler.enqueue(hitSoundSchedulerTestSound(3), 1.0f, 0.0f, 100.0, 50.0);
+
+		scheduler.process(50.0);
+		const size_t numPlayedEarly = backend->played.size();
+		scheduler.process(150.0);
+		const size_t numPlayedMiddle = backend->played.size();
+		scheduler.process(1000.0);
+
+		numTests++;
+		if (numPlayedEarly != 0 || numPlayedMiddle != 2 || backend->played.size() != 4
+			|| backend->played[0].event.sound != hitSoundSchedulerTestSound(1) || backend->played[1].event.sound != hitSoundSchedulerTestSound(3)
+			|| backend->played[2].event.sound != hitSoundSchedulerTestSound(2) || backend->played[3].event.sound != hitSoundSchedulerTestSound(0)
+			|| backend->played[0].lateness != 50.0 || backend->played[3].lateness != 700.0)
+		{
+			numFailed++;
+			debugLog("osu_hitsound_scheduler_test: FAILED ordering (%i, %i, %i played)\n", (int)numPlayedEarly, (int)numPlayedMiddle, (int)backend->played.size());
+		}
+	}
+
+	// volume and pan pass through (pan clamped)
+	{
+		NullBackend *backend = new NullBackend();
+		OsuHitSoundScheduler scheduler(backend, false, 8, 8);
+		scheduler.enqueue(hitSoundSchedulerTestSound(0), 0.5f, -1.0f, 0.0, 50.0);
+		scheduler.enqueue(hitSoundSchedulerTestSound(0), 0.25f, 0.25f, 1.0, 50.0);
+		scheduler.enqueue(hitSoundSchedulerTestSound(0), 1.0f, 3.0f, 2.0, 50.0);
+		scheduler.process(10.0);
+
+		numTests++;
+		if (backend->played.size() != 3 || backend->played[0].event.pan != -1.0f || backend->played[0].event.volume != 0.5f
+			|| backend->played[1].event.pan != 0.25f || backend->played[1].event.volume != 0.25f || backend->played[2].event.pan != 1.0f)
+		{
+			numFailed++;
+			debugLog("osu_hitsound_scheduler_test: FAILED pan/volume (%i played)\n", (int)backend->played.size());
+		}
+	}
+
+	// polyphony limit per sound, then a full pool: the oldest voice is stolen
+	{
+		NullBackend *backend = new NullBackend();
+		OsuHitSoundScheduler scheduler(backend, false, 4, 2);
+		for (int i=0; i<3; i++)
+		{
+			scheduler.enqueue(hitSoundSchedulerTestSound(0), 1.0f, 0.0f, i, 1000.0);
+		}
+		scheduler.process(2.5);
+		const size_t numStoppedSameSound = backend->stopped.size();
+		const bool stoppedFirst = (numStoppedSameSound == 1 && backend->stopped[0].event.musicTime == 0.0 && backend->played[2].voice == backend->played[0].voice);
+
+		scheduler.enqueue(hitSoundSchedulerTestSound(1), 1.0f, 0.0f, 3.0, 1000.0);
+		scheduler.enqueue(hitSoundSchedulerTestSound(2), 1.0f, 0.0f, 4.0, 1000.0);
+		scheduler.process(4.5);
+		const size_t numStoppedFilled = backend->stopped.size();
+
+		scheduler.enqueue(hitSoundSchedulerTestSound(3), 1.0f, 0.0f, 5.0, 1000.0);
+		scheduler.process(5.5);
+		const bool stoppedOldest = (backend->stopped.size() == 2 && backend->stopped[1].event.musicTime == 1.0);
+
+		// finished voices are free again, no stealing
+		scheduler.enqueue(hitSoundSchedulerTestSound(4), 1.0f, 0.0f, 2000.0, 10.0);
+		scheduler.process(2000.0);
+
+		numTests++;
+		if (!stoppedFirst || numStoppedFilled != 1 || !stoppedOldest || backend->stopped.size() != 2 || backend->played.size() != 7 || scheduler.getNumStolen() != 2)
+		{
+			numFailed++;
+			debugLog("osu_hitsound_scheduler_test: FAILED voices (%i stopped, %i played, %i stolen)\n", (int)backend->stopped.size(), (int)backend->played.size(), scheduler.getNumStolen());
+		}
+	}
+
+	// a backend which isn't thread safe gets no thread, and one which can't stop voices has the limits drop new events instead of stopping old ones
+	{
+		NullBackend *backend = new NullBackend();
+		{
+			OsuHitSoundScheduler scheduler(new HitSoundSchedulerTestMainThreadBackend(backend), true, 3, 2);
+			scheduler.setMusicTime(0.0, 0.0);
+			for (int i=0; i<3; i++)
+			{
+				scheduler.enqueue(hitSoundSchedulerTestSound(0), 1.0f, 0.0f, 0.0, 1000.0);
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			const size_t numPlayedWithoutProcess = backend->played.size();
+
+			scheduler.process(scheduler.getMusicTime());
+			scheduler.enqueue(hitSoundSchedulerTestSound(1), 1.0f, 0.0f, 0.0, 1000.0);
+			scheduler.enqueue(hitSoundSchedulerTestSound(2), 1.0f, 0.0f, 0.0, 1000.0);
+			scheduler.process(scheduler.getMusicTime());
+
+			numTests++;
+			if (scheduler.isThreaded() || numPlayedWithoutProcess != 0 || backend->played.size() != 3 || backend->stopped.size() != 0 || scheduler.getNumStolen() != 0 || scheduler.getNumDropped() != 2)
+			{
+				numFailed++;
+				debugLog("osu_hitsound_scheduler_test: FAILED main thread backend (%i, %i played, %i stopped, %i dropped)\n", (int)numPlayedWithoutProcess, (int)backend->played.size(), (int)backend->stopped.size(), scheduler.getNumDropped());
+			}
+		}
+		delete backend;
+	}
+
+	// what the game runs: the engine-like backend on its own thread, nothing calls process()
+	{
+		NullBackend *backend = new NullBackend();
+		{
+			OsuHitSoundScheduler scheduler(new HitSoundSchedulerTestEngineBackend(backend), true, 3, 2);
+			scheduler.setMusicTime(0.0, 1.0);
+			for (int i=0; i<3; i++)
+			{
+				scheduler.enqueue(hitSoundSchedulerTestSound(0), 1.0f, 0.0f, 5.0, 1000.0);
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+			numTests++;
+			if (!scheduler.isThreaded() || backend->played.size() != 2 || backend->stopped.size() != 0 || scheduler.getNumDropped() != 1)
+			{
+				numFailed++;
+				debugLog("osu_hitsound_scheduler_test: FAILED engine backend (threaded = %i, %i played, %i stopped, %i dropped)\n", (int)scheduler.isThreaded(), (int)backend->played.size(), (int)backend->stopped.size(), scheduler.getNumDropped());
+			}
+		}
+		delete backend;
+	}
+
+	// full queue drops, clear() drops everything pending
+	{
+		NullBackend *backend = new NullBackend();
+		OsuHitSoundScheduler scheduler(backend, false, 8, 8);
+		int numEnqueued = 0;
+		for (int i=0; i<QUEUE_SIZE + 5; i++)
+		{
+			if (scheduler.enqueue(hitSoundSchedulerTestSound(0), 1.0f, 0.0f, 100.0, 1.0))
+				numEnqueued++;
+		}
+		scheduler.process(0.0); // drains, nothing due yet
+		scheduler.clear();
+		scheduler.enqueue(hitSoundSchedulerTestSound(0), 1.0f, 0.0f, 100.0, 1.0);
+		scheduler.clear();
+		scheduler.enqueue(hitSoundSchedulerTestSound(1), 1.0f, 0.0f, 100.0, 1.0);
+		scheduler.process(1000.0);
+
+		numTests++;
+		if (numEnqueued != QUEUE_SIZE || scheduler.getNumDropped() != 5 || backend->played.size() != 1 || backend->played[0].event.sound != hitSoundSchedulerTestSound(1))
+		{
+			numFailed++;
+			debugLog("osu_hitsound_scheduler_test: FAILED queue (%i enqueued, %i dropped, %i played)\n", numEnqueued, scheduler.getNumDropped(), (int)backend->played.size());
+		}
+	}
+
+	// with the thread and the real clock
+	{
+		NullBackend *backend = new NullBackend();
+		const int numEvents = 20;
+		{
+			OsuHitSoundScheduler scheduler(new HitSoundSchedulerTestBackend(backend), true, 8, 8);
+			scheduler.setMusicTime(0.0, 1.0);
+			const double now = scheduler.getMusicTime();
+			for (int i=numEvents-1; i>=0; i--)
+			{
+				scheduler.enqueue(hitSoundSchedulerTestSound(i % 3), 1.0f, 0.0f, now + 10.0 + i*5.0, 20.0);
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(250));
+		}
+
+		bool ordered = true;
+		std::vector<double> latencies;
+		for (size_t i=0; i<backend->played.size(); i++)
+		{
+			latencies.push_back(backend->played[i].lateness);
+			if (i > 0 && backend->played[i].event.musicTime < backend->played[i-1].event.musicTime)
+				ordered = false;
+		}
+		const HITSOUNDSCHEDULER_TEST_LATENCY latency = hitSoundSchedulerTestLatency(latencies);
+
+		numTests++;
+		if ((int)backend->played.size() != numEvents || !ordered)
+		{
+			numFailed++;
+			debugLog("osu_hitsound_scheduler_test: FAILED thread (%i played, ordered = %i)\n", (int)backend->played.size(), (int)ordered);
+		}
+		debugLog("osu_hitsound_scheduler_test: thread: lateness mean %f ms, max %f ms\n", latency.mean, latency.max);
+		delete backend;
+	}
+
+	// latency/jitter benchmark
+	{
+		const double fps[2] = {60.0, 1000.0};
+		HITSOUNDSCHEDULER_TEST_LATENCY direct[2];
+		HITSOUNDSCHEDULER_TEST_LATENCY scheduled[2];
+		for (int i=0; i<2; i++)
+		{
+			hitSoundSchedulerTestBenchmark(fps[i], &direct[i], &scheduled[i]);
+			debugLog("osu_hitsound_scheduler_test: %i fps: direct latency %f ms (jitter %f ms, max %f ms), scheduled latency %f ms (jitter %f ms, max %f ms)\n", (int)fps[i], direct[i].mean, direct[i].stddev, direct[i].max, scheduled[i].mean, scheduled[i].stddev, scheduled[i].max);
+		}
+
+		numTests++;
+		if (scheduled[0].count != direct[0].count || scheduled[1].count != direct[1].count || scheduled[0].max >= 1.0 || scheduled[1].max >= 1.0 || scheduled[0].stddev >= direct[0].stddev)
+		{
+			numFailed++;
+			debugLog("osu_hitsound_scheduler_test: FAILED benchmark\n");
+		}
+	}
+
+	debugLog("osu_hitsound_scheduler_test: %s, %i/%i passed\n", numFailed == 0 ? "PASSED" : "FAILED", numTests - numFailed, numTests);
+}
@@ -0,0 +1,153 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		hit sound queue + voice pool
+//
+// $NoKeywords: $osuhitsndsched
+//===============================================================================//
+
+#ifndef OSUHITSOUNDSCHEDULER_H
+#define OSUHITSOUNDSCHEDULER_H
+
+#include "cbase.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+class Sound;
+
+// hit objects used to start their sounds directly, and a fast stream could pile up as many voices as it liked
+// now they enqueue (sound, volume, pan, music time) into a lock-free single producer/single consumer ring, which is drained by process()
+// an event is started once the (extrapolated) music clock reaches its time, on one voice of a fixed pool: at most osu_hitsound_max_polyphony voices per sound, the oldest one gets stolen beyond that or if the pool is full
+// backends which can't stop a single voice get the event dropped instead of a voice stolen, and only thread safe backends get their own thread (polling every osu_hitsound_scheduler_interval ms)
+class OsuHitSoundScheduler
+{
+public:
+	struct EVENT
+	{
+		EVENT() {sound = NULL; volume = 1.0f; pan = 0.0f; musicTime = 0.0; lengthMS = 0.0; sequence = 0; generation = 0;}
+
+		Sound *sound;			// only compared, never touched by the scheduler itself
+		float volume;			// 0 - 1
+		float pan;				// -1 (left) - 1 (right)
+		double musicTime;		// when it should be heard, in ms
+		double lengthMS;		// how long it occupies its voice
+
+		unsigned long sequence;	// set by enqueue(), equal times are played in enqueue order
+		unsigned int generation;
+	};
+
+	// everything is called from the scheduler thread (or whoever calls process())
+	class BACKEND
+	{
+	public:
+		virtual ~BACKEND() {;}
+
+		virtual void play(int voice, const EVENT &event, double lateness) = 0; // lateness = how far the clock was past the event's music time, in ms
+		virtual void stop(int voice, const EVENT &event) = 0; // the voice is being stolen
+
+		virtual bool isThreadSafe() const {return true;} // may be called from the scheduler thread
+		virtual bool canStopVoices() const {return true;} // stop() only affects the given voice
+	};
+
+	// plays through the engine's sound engine, which has no per-play volume/pan (the skin already applied the sample volume to the sounds)
+	// starting a sample only creates and starts a new channel in BASS (which is thread safe), and the hit sound samples aren't started by anyone else while the scheduler is in use, so this may run on the scheduler thread
+	// stopping a Sound stops all of its instances though, so it can't stop single voices
+	class EngineBackend : public BACKEND
+	{
+	public:
+		virtual void play(int voice, const EVENT &event, double lateness);
+		virtual void stop(int voice, const EVENT &event);
+
+		virtual bool canStopVoices() const {return false;}
+	};
+
+	// records everything, for tests
+	class NullBackend : public BACKEND
+	{
+	public:
+		struct PLAYED
+		{
+			int voice;
+			EVENT event;
+			double lateness;
+		};
+
+		virtual void play(int voice, const EVENT &event, double lateness);
+		virtual void stop(int voice, const EVENT &event);
+
+		std::vector<PLAYED> played;
+		std::vector<PLAYED> stopped; // lateness unused
+	};
+
+	static const int QUEUE_SIZE = 1024; // power of two
+
+public:
+	// takes ownership of the backend, without a thread (or if the backend isn't thread safe) process() has to be called manually, -1 = osu_hitsound_voices/osu_hitsound_max_polyphony
+	OsuHitSoundScheduler(BACKEND *backend, bool threaded, int numVoices = -1, int maxPolyphony = -1);
+	~OsuHitSoundScheduler();
+
+	// main thread (single producer), returns false (and drops the event) if the queue is full
+	bool enqueue(Sound *sound, float volume, float pan, double musicTime, double lengthMS);
+
+	// music clock, set once per frame by the main thread, extrapolated with the speed in between (0 while paused)
+	// jumping back by more than osu_hitsound_scheduler_seek_threshold (seeking, restarting) clears everything still pending
+	void setMusicTime(double musicTime, double speed);
+	double getMusicTime(); // thread safe
+
+	// drops everything which hasn't been started yet and forgets all voices (e.g. because their sounds are about to be deleted), once this returns nothing old is started anymore
+	void clear();
+
+	// consumer side, the thread (or the owner) calls this with getMusicTime()
+	void process(double musicTime);
+
+	inline bool isThreaded() const {return m_thread.joinable();}
+	inline int getNumPlayed() const {return m_iNumPlayed.load();}
+	inline int getNumStolen() const {return m_iNumStolen.load();}
+	inline int getNumDropped() const {return m_iNumDropped.load();} // full queue, or no voice for a backend which can't stop voices
+
+	static void test(); // ordering, pan/volume, polyphony limits + voice stealing/dropping, clearing, threaded playback + latency/jitter benchmark at 60 vs 1000 fps (osu_hitsound_scheduler_test)
+
+private:
+	struct VOICE
+	{
+		bool active;
+		EVENT event;
+		double startTime;
+		double endTime;
+	};
+
+	void threadLoop();
+	void dispatch(const EVENT &event, double musicTime);
+
+	BACKEND *m_backend;
+	int m_iMaxPolyphony;
+	std::vector<VOICE> m_voices;
+
+	// lock-free ring
+	EVENT m_queue[QUEUE_SIZE];
+	std::atomic<unsigned int> m_iQueueHead; // consumer
+	std::atomic<unsigned int> m_iQueueTail; // producer
+	unsigned long m_iNextSequence;
+	std::atomic<unsigned int> m_iGeneration;
+
+	// consumer
+	std::mutex m_processMutex; // only contended by clear()
+	std::vector<EVENT> m_pending; // sorted by music time, then sequence
+
+	// clock
+	std::mutex m_clockMutex;
+	double m_fClockMusicTime;
+	double m_fClockSpeed;
+	std::chrono::steady_clock::time_point m_clockTime;
+
+	std::thread m_thread;
+	std::atomic<bool> m_bStopThread;
+
+	std::atomic<int> m_iNumPlayed;
+	std::atomic<int> m_iNumStolen;
+	std::atomic<int> m_iNumDropped;
+};
+
+#endif
@@ -0,0 +1,475 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		priority queue in front of the async resource loading
+//
+// $NoKeywords: $osuloadsched
+//===============================================================================//
+
+#include "OsuLoadScheduler.h"
+
+#include "Engine.h"
+#include "ConVar.h"
+#include "Timer.h"
+
+#include <algorithm>
+
+ConVar osu_load_scheduler_max_in_flight("osu_load_scheduler_max_in_flight", 4, "how many background images etc. may be loading at the same time, the rest waits in priority order (0 = no limit, everything starts immediately in submission order)");
+
+OsuLoadScheduler::OsuLoadScheduler()
+{
+	m_iNextID = 1;
+	m_iNextSequence = 0;
+	m_iMaxInFlight = -1;
+	m_iNumQueued = 0;
+}
+
+OsuLoadScheduler::~OsuLoadScheduler()
+{
+	// nothing may be loading anymore at this point (the owners of the jobs are gone too)
+	for (std::unordered_map<unsigned int, REQUEST*>::iterator it = m_requests.begin(); it != m_requests.end(); ++it)
+	{
+		if (!it->second->inFlight)
+		{
+			delete it->second->job;
+			delete it->second;
+		}
+	}
+	for (int i=0; i<m_inFlight.size(); i++)
+	{
+		delete m_inFlight[i]->job;
+		delete m_inFlight[i];
+	}
+}
+
+void OsuLoadScheduler::update()
+{
+	// retire finished loads (cancelled ones too, as soon as their job is done with them)
+	for (int i=0; i<m_inFlight.size(); i++)
+	{
+		REQUEST *request = m_inFlight[i];
+		if (!request->job->isFinished())
+			continue;
+
+		if (!request->job->isCancelled())
+			remove(request);
+
+		delete request->job;
+		delete request;
+		m_inFlight.erase(m_inFlight.begin() + i);
+		i--;
+	}
+
+	dispatch();
+}
+
+unsigned int OsuLoadScheduler::submit(const std::string &key, PRIORITY priority, JOB *job)
+{
+	std::unordered_map<std::string, unsigned int>::const_iterator existing = m_keys.find(key);
+	if (existing != m_keys.end())
+	{
+		const unsigned int id = existing->second;
+		delete job;
+
+		if (priority < m_requests[id]->priority)
+			setPriority(id, priority);
+
+		return id;
+	}
+
+	REQUEST *request = new REQUEST();
+	request->id = m_iNextID++;
+	if (m_iNextID == 0)
+		m_iNextID = 1;
+	request->key = key;
+	request->priority = priority;
+	request->inFlight = false;
+	request->job = job;
+
+	m_requests[request->id] = request;
+	m_keys[key] = request->id;
+	m_iNumQueued++;
+	enqueue(request);
+
+	dispatch();
+
+	return request->id;
+}
+
+void OsuLoadScheduler::cancel(unsigned int id)
+{
+	std::unordered_map<unsigned int, REQUEST*>::iterator it = m_requests.find(id);
+	if (it == m_requests.end())
+		return;
+
+	REQUEST *request = it->second;
+	request->job->m_bCancelled.store(true, std::memory_order_release);
+	remove(request);
+
+	// queued ones are simply forgotten (their queue entries are skipped), in flight ones stay until their job is finished
+	if (!request->inFlight)
+	{
+		m_iNumQueued--;
+		delete request->job;
+		delete request;
+	}
+}
+
+void OsuLoadScheduler::setPriority(unsigned int id, PRIORITY priority)
+{
+	std::unordered_map<unsigned int, REQUEST*>::iterator it = m_requests.find(id);
+	if (it == m_requests.end() || it->second->inFlight || it->second->priority == priority)
+		return;
+
+	it->second->priority = priority;
+	enqueue(it->second);
+
+	dispatch();
+}
+
+bool OsuLoadScheduler::isQueued(unsigned int id) const
+{
+	std::unordered_map<unsigned int, REQUEST*>::const_iterator it = m_requests.find(id);
+	return (it != m_requests.end() && !it->second->inFlight);
+}
+
+bool OsuLoadScheduler::isInFlight(unsigned int id) const
+{
+	std::unordered_map<unsigned int, REQUEST*>::const_iterator it = m_requests.find(id);
+	return (it != m_requests.end() && it->second->inFlight);
+}
+
+void OsuLoadScheduler::enqueue(REQUEST *request)
+{
+	request->sequence = m_iNextSequence++;
+
+	QUEUE_ENTRY entry;
+	entry.id = request->id;
+	entry.sequence = request->sequence;
+	m_queues[request->priority].push_back(entry);
+}
+
+void OsuLoadScheduler::dispatch()
+{
+	const int maxInFlight = (m_iMaxInFlight < 0 ? osu_load_scheduler_max_in_flight.getInt() : m_iMaxInFlight);
+
+	for (int p=0; p<PRIORITY_COUNT; p++)
+	{
+		std::deque<QUEUE_ENTRY> &queue = m_queues[p];
+		std::deque<QUEUE_ENTRY> waiting; // for a cancelled load of the same key, these stay at the front of the queue
+		while (queue.size() > 0 && (p == PRIORITY_GAMEPLAY || maxInFlight < 1 || m_inFlight.size() < maxInFlight))
+		{
+			const QUEUE_ENTRY entry = queue.front();
+			queue.pop_front();
+
+			// cancelled, or moved to another queue
+			std::unordered_map<unsigned int, REQUEST*>::iterator it = m_requests.find(entry.id);
+			if (it == m_requests.end() || it->second->inFlight || it->second->sequence != entry.sequence)
+				continue;
+
+			REQUEST *request = it->second;
+			if (isCancelledInFlight(request->key))
+			{
+				waiting.push_back(entry);
+				continue;
+			}
+
+			request->inFlight = true;
+			m_iNumQueued--;
+			m_inFlight.push_back(request);
+			request->job->start();
+		}
+		queue.insert(queue.begin(), waiting.begin(), waiting.end());
+
+		if (p != PRIORITY_GAMEPLAY && maxInFlight > 0 && m_inFlight.size() >= maxInFlight)
+			break;
+	}
+}
+
+void OsuLoadScheduler::remove(REQUEST *request)
+{
+	m_requests.erase(request->id);
+
+	std::unordered_map<std::string, unsigned int>::iterator it = m_keys.find(request->key);
+	if (it != m_keys.end() && it->second == request->id)
+		m_keys.erase(it);
+}
+
+bool OsuLoadScheduler::isCancelledInFlight(const std::string &key) const
+{
+	// only a handful of loads are ever in flight
+	for (int i=0; i<m_inFlight.size(); i++)
+	{
+		if (m_inFlight[i]->job->isCancelled() && m_inFlight[i]->key == key)
+			return true;
+	}
+	return false;
+}
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+// stands in for the ResourceManager: one async loader thread, which works off its queue in order, one load per tick
+class OsuLoadSchedulerTestJob;
+
+struct OsuLoadSchedulerTestLoader
+{
+	std::deque<OsuLoadSchedulerTestJob*> queue;
+	std::vector<std::string> decoded;
+	int numSkipped;
+	int numJobs; // alive
+};
+
+class OsuLoadSchedulerTestJob : public OsuLoadScheduler::JOB
+{
+public:
+	OsuLoadSchedulerTestJob(OsuLoadSchedulerTestLoader *loader, const std::string &name)
+	{
+		m_loader = loader;
+		m_sName = name;
+		m_bDone = false;
+		m_loader->numJobs++;
+	}
+	virtual ~OsuLoadSchedulerTestJob() {m_loader->numJobs--;}
+
+	virtual void start() {m_loader->queue.push_back(this);}
+	virtual bool isFinished() {return m_bDone;}
+
+	void tick()
+	{
+		if (isCancelled()) // checked before decoding
+			m_loader->numSkipped++;
+		else
+			m_loader->decoded.push_back(m_sName);
+		m_bDone = true;
+	}
+
+private:
+	OsuLoadSchedulerTestLoader *m_loader;
+	std::string m_sName;
+	bool m_bDone;
+};
+
+static void loadSchedulerTestReset(OsuLoadSchedulerTestLoader *loader)
+{
+	loader->queue.clear();
+	loader->decoded.clear();
+	loader->numSkipped = 0;
+	loader->numJobs = 0;
+}
+
+// one loader tick + one scheduler update (= one frame), returns the highest number of loads in flight seen
+static int loadSchedulerTestRun(OsuLoadScheduler *scheduler, OsuLoadSchedulerTestLoader *loader, int maxTicks = 1000000)
+{
+	int maxInFlight = scheduler->getNumInFlight();
+	for (int i=0; i<maxTicks && (loader->queue.size() > 0 || scheduler->getNumQueued() > 0 || scheduler->getNumInFlight() > 0); i++)
+	{
+		if (loader->queue.size() > 0)
+		{
+			loader->queue.front()->tick();
+			loader->queue.pop_front();
+		}
+		scheduler->update();
+		maxInFlight = std::max(maxInFlight, scheduler->getNumInFlight());
+	}
+	return maxInFlight;
+}
+
+static int loadSchedulerTestIndexOf(const std::vector<std::string> &decoded, const std::string &name)
+{
+	for (int i=0; i<decoded.size(); i++)
+	{
+		if (decoded[i] == name)
+			return i;
+	}
+	return -1;
+}
+
+void OsuLoadScheduler::test()
+{
+	int numTests = 0;
+	int numFailed = 0;
+
+	OsuLoadSchedulerTestLoader loader;
+
+	// completion order: whatever is already in flight, then by priority, in submission order within a priority
+	{
+		loadSchedulerTestReset(&loader);
+		OsuLoadScheduler scheduler;
+		scheduler.setMaxInFlight(2);
+		for (int i=0; i<10; i++)
+		{
+			scheduler.submit(UString::format("prefetch%i", i).toUtf8(), PRIORITY_PREFETCH, new OsuLoadSchedulerTestJob(&loader, UString::format("prefetch%i", i).toUtf8()));
+		}
+		for (int i=0; i<10; i++)
+		{
+			scheduler.submit(UString::format("thumbnail%i", i).toUtf8(), PRIORITY_VISIBLE_THUMBNAIL, new OsuLoadSchedulerTestJob(&loader, UString::format("thumbnail%i", i).toUtf8()));
+		}
+		scheduler.submit("background", PRIORITY_SELECTED_BACKGROUND, new OsuLoadSchedulerTestJob(&loader, "background"));
+
+		const int maxInFlight = loadSchedulerTestRun(&scheduler, &loader);
+
+		numTests++;
+		if (loader.decoded.size() != 21 || loader.decoded[0] != "prefetch0" || loader.decoded[1] != "prefetch1" || loader.decoded[2] != "background"
+			|| loader.decoded[3] != "thumbnail0" || loader.decoded[12] != "thumbnail9" || loader.decoded[13] != "prefetch2" || loader.decoded[20] != "prefetch9"
+			|| maxInFlight != 2 || loader.numJobs != 0)
+		{
+			numFailed++;
+			debugLog("osu_load_scheduler_test: FAILED order (%i decoded, background at %i, max %i in flight, %i jobs alive)\n", (int)loader.decoded.size(), loadSchedulerTestIndexOf(loader.decoded, "background"), maxInFlight, loader.numJobs);
+		}
+	}
+
+	// gameplay loads ignore the limit, priorities can be changed while queued
+	{
+		loadSchedulerTestReset(&loader);
+		OsuLoadScheduler scheduler;
+		scheduler.setMaxInFlight(1);
+		scheduler.submit("thumbnail0", PRIORITY_VISIBLE_THUMBNAIL, new OsuLoadSchedulerTestJob(&loader, "thumbnail0"));
+		const unsigned int thumbnail1 = scheduler.submit("thumbnail1", PRIORITY_VISIBLE_THUMBNAIL, new OsuLoadSchedulerTestJob(&loader, "thumbnail1"));
+		scheduler.submit("thumbnail2", PRIORITY_VISIBLE_THUMBNAIL, new OsuLoadSchedulerTestJob(&loader, "thumbnail2"));
+		const unsigned int music = scheduler.submit("music", PRIORITY_GAMEPLAY, new OsuLoadSchedulerTestJob(&loader, "music"));
+		const bool musicStarted = scheduler.isInFlight(music) && scheduler.getNumInFlight() == 2;
+		scheduler.setPriority(thumbnail1, PRIORITY_PREFETCH);
+
+		loadSchedulerTestRun(&scheduler, &loader);
+
+		numTests++;
+		if (!musicStarted || loader.decoded.size() != 4 || loader.decoded[1] != "music" || loader.decoded[2] != "thumbnail2" || loader.decoded[3] != "thumbnail1")
+		{
+			numFailed++;
+			debugLog("osu_load_scheduler_test: FAILED gameplay/setPriority (music started = %i, %i decoded)\n", (int)musicStarted, (int)loader.decoded.size());
+		}
+	}
+
+	// dedup by key: one load, the higher priority wins
+	{
+		loadSchedulerTestReset(&loader);
+		OsuLoadScheduler scheduler;
+		scheduler.setMaxInFlight(1);
+		scheduler.submit("busy", PRIORITY_PREFETCH, new OsuLoadSchedulerTestJob(&loader, "busy"));
+		scheduler.submit("other", PRIORITY_VISIBLE_THUMBNAIL, new OsuLoadSchedulerTestJob(&loader, "other"));
+		const unsigned int first = scheduler.submit("a.jpg", PRIORITY_PREFETCH, new OsuLoadSchedulerTestJob(&loader, "a.jpg"));
+		const unsigned int second = scheduler.submit("a.jpg", PRIORITY_SELECTED_BACKGROUND, new OsuLoadSchedulerTestJob(&loader, "a.jpg (duplicate)"));
+		const int numJobsAfterDuplicate = loader.numJobs;
+
+		loadSchedulerTestRun(&scheduler, &loader);
+
+		numTests++;
+		if (first != second || numJobsAfterDuplicate != 3 || loader.decoded.size() != 3 || loader.decoded[1] != "a.jpg" || loader.numJobs != 0)
+		{
+			numFailed++;
+			debugLog("osu_load_scheduler_test: FAILED dedup (%u/%u, %i jobs, %i decoded)\n", first, second, numJobsAfterDuplicate, (int)loader.decoded.size());
+		}
+	}
+
+	// cancellation: queued ones never start, in flight ones are skipped by the loader, the key can be submitted again afterwards
+	{
+		loadSchedulerTestReset(&loader);
+		OsuLoadScheduler scheduler;
+		scheduler.setMaxInFlight(2);
+		const unsigned int a = scheduler.submit("a", PRIORITY_VISIBLE_THUMBNAIL, new OsuLoadSchedulerTestJob(&loader, "a"));
+		scheduler.submit("b", PRIORITY_VISIBLE_THUMBNAIL, new OsuLoadSchedulerTestJob(&loader, "b"));
+		const unsigned int c = scheduler.submit("c", PRIORITY_VISIBLE_THUMBNAIL, new OsuLoadSchedulerTestJob(&loader, "c"));
+		scheduler.submit("d", PRIORITY_VISIBLE_THUMBNAIL, new OsuLoadSchedulerTestJob(&loader, "d"));
+
+		const bool aWasInFlight = scheduler.isInFlight(a);
+		const bool cWasQueued = scheduler.isQueued(c);
+		scheduler.cancel(a);
+		scheduler.cancel(c);
+		scheduler.cancel(c); // twice
+		scheduler.cancel(12345); // unknown
+		const int numQueuedAfterCancel = scheduler.getNumQueued();
+		const unsigned int a2 = scheduler.submit("a", PRIORITY_PREFETCH, new OsuLoadSchedulerTestJob(&loader, "a again"));
+
+		loadSchedulerTestRun(&scheduler, &loader);
+
+		numTests++;
+		if (!aWasInFlight || !cWasQueued || numQueuedAfterCancel != 1 || a2 == a || loader.numSkipped != 1 || loader.decoded.size() != 3
+			|| loadSchedulerTestIndexOf(loader.decoded, "a") != -1 || loadSchedulerTestIndexOf(loader.decoded, "c") != -1 || loader.decoded[2] != "a again" || loader.numJobs != 0)
+		{
+			numFailed++;
+			debugLog("osu_load_scheduler_test: FAILED cancel (%i skipped, %i decoded, %i queued, %i jobs alive)\n", loader.numSkipped, (int)loader.decoded.size(), numQueuedAfterCancel, loader.numJobs);
+		}
+	}
+
+	// a cancelled load which is still in flight holds on to its key, submitting the key again only starts once the loader is done with the cancelled one
+	{
+		loadSchedulerTestReset(&loader);
+		OsuLoadScheduler scheduler;
+		scheduler.setMaxInFlight(0);
+		const unsigned int a = scheduler.submit("a", PRIORITY_SELECTED_BACKGROUND, new OsuLoadSchedulerTestJob(&loader, "a"));
+		scheduler.cancel(a);
+		const unsigned int a2 = scheduler.submit("a", PRIORITY_SELECTED_BACKGROUND, new OsuLoadSchedulerTestJob(&loader, "a again"));
+		scheduler.submit("b", PRIORITY_PREFETCH, new OsuLoadSchedulerTestJob(&loader, "b"));
+		const bool a2Waited = scheduler.isQueued(a2) && scheduler.getNumInFlight() == 2; // the cancelled a and b
+
+		loadSchedulerTestRun(&scheduler, &loader);
+
+		numTests++;
+		if (!a2Waited || loader.numSkipped != 1 || loader.decoded.size() != 2 || loader.decoded[0] != "b" || loader.decoded[1] != "a again" || loader.numJobs != 0)
+		{
+			numFailed++;
+			debugLog("osu_load_scheduler_test: FAILED resubmitting a cancelled key (waited = %i, %i skipped, %i decoded, %i jobs alive)\n", (int)a2Waited, loader.numSkipped, (int)loader.decoded.size(), loader.numJobs);
+		}
+	}
+
+	// unlimited = every load starts immediately, in submission order
+	{
+		loadSchedulerTestReset(&loader);
+		OsuLoadScheduler scheduler;
+		scheduler.setMaxInFlight(0);
+		scheduler.submit("prefetch", PRIORITY_PREFETCH, new OsuLoadSchedulerTestJob(&loader, "prefetch"));
+		scheduler.submit("background", PRIORITY_SELECTED_BACKGROUND, new OsuLoadSchedulerTestJob(&loader, "background"));
+		const int numInFlight = scheduler.getNumInFlight();
+
+		loadSchedulerTestRun(&scheduler, &loader);
+
+		numTests++;
+		if (numInFlight != 2 || loader.decoded.size() != 2 || loader.decoded[0] != "prefetch")
+		{
+			numFailed++;
+			debugLog("osu_load_scheduler_test: FAILED unlimited\n");
+		}
+	}
+
+	// benchmark: the user scrolled past 500 thumbnails, then selected a beatmap
+	{
+		const int numThumbnails = 500;
+		const int limits[2] = {0, 4};
+		int backgroundPositions[2];
+		double times[2];
+		for (int l=0; l<2; l++)
+		{
+			loadSchedulerTestReset(&loader);
+			OsuLoadScheduler scheduler;
+			scheduler.setMaxInFlight(limits[l]);
+
+			Timer t;
+			t.start();
+			for (int i=0; i<numThumbnails; i++)
+			{
+				scheduler.submit(UString::format("thumbnail%i", i).toUtf8(), PRIORITY_VISIBLE_THUMBNAIL, new OsuLoadSchedulerTestJob(&loader, "thumbnail"));
+			}
+			scheduler.submit("background", PRIORITY_SELECTED_BACKGROUND, new OsuLoadSchedulerTestJob(&loader, "background"));
+			loadSchedulerTestRun(&scheduler, &loader);
+			t.update();
+
+			backgroundPositions[l] = loadSchedulerTestIndexOf(loader.decoded, "background");
+			times[l] = t.getElapsedTime();
+		}
+
+		numTests++;
+		if (backgroundPositions[0] != numThumbnails || backgroundPositions[1] != limits[1])
+		{
+			numFailed++;
+			debugLog("osu_load_scheduler_test: FAILED backlog (background decoded after %i/%i loads)\n", backgroundPositions[0], backgroundPositions[1]);
+		}
+
+		debugLog("osu_load_scheduler_test: selected background after %i thumbnails without limit, after %i with %i in flight (at 10 ms per image: %i ms vs %i ms), scheduling overhead %f us per load\n",
+			backgroundPositions[0], backgroundPositions[1], limits[1], (backgroundPositions[0] + 1)*10, (backgroundPositions[1] + 1)*10, times[1]*1000000.0 / (numThumbnails + 1));
+	}
+
+	debugLog("osu_load_scheduler_test: %s, %i/%i passed\n", numFailed == 0 ? "PASSED" : "FAILED", numTests - numFailed, numTests);
+}
@@ -0,0 +1,104 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		priority queue in front of the async resource loading
+//
+// $NoKeywords: $osuloadsched
+//===============================================================================//
+
+#ifndef OSULOADSCHEDULER_H
+#define OSULOADSCHEDULER_H
+
+#include "cbase.h"
+
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+
+// the ResourceManager works off its async queue in submission order, so e.g. scrolling through the song browser would queue hundreds of thumbnails before the background of the beatmap which actually got selected
+// loads submitted here wait in one queue per priority instead, and only a few of them (osu_load_scheduler_max_in_flight) are handed to the ResourceManager at a time, so a more important load only ever waits for those
+// a load which is cancelled while still queued never starts, one which is already in flight sees its cancel flag (loaders check it before decoding), and keeps its slot until its job is finished
+// a new load with the key of such a cancelled one waits until then, since the ResourceManager would just hand out the same (soon destroyed) resource again
+class OsuLoadScheduler
+{
+public:
+	enum PRIORITY
+	{
+		PRIORITY_GAMEPLAY,				// always started immediately, regardless of the in-flight limit
+		PRIORITY_SELECTED_BACKGROUND,
+		PRIORITY_VISIBLE_THUMBNAIL,
+		PRIORITY_PREFETCH,
+		PRIORITY_COUNT
+	};
+
+	// one load, owned by the scheduler once submitted, everything except isCancelled() is only called on the main thread
+	class JOB
+	{
+	public:
+		JOB() {m_bCancelled = false;}
+		virtual ~JOB() {;}
+
+		inline bool isCancelled() const {return m_bCancelled.load(std::memory_order_acquire);}
+
+		virtual void start() = 0; // kicks off the (usually async) load
+		virtual bool isFinished() = 0; // polled while in flight, also after a cancel (should then return true as soon as the loader is done with it, and clean up whatever it loaded)
+
+	private:
+		friend class OsuLoadScheduler;
+		std::atomic<bool> m_bCancelled;
+	};
+
+public:
+	OsuLoadScheduler();
+	~OsuLoadScheduler();
+
+	void update(); // retires finished loads, starts queued ones (highest priority first, in submission order within a priority)
+
+	// returns an id for cancel()/setPriority(), never 0
+	// keys are deduplicated: if a load with the same key is still queued or in flight, job is deleted and the existing id is returned (with the higher of both priorities)
+	unsigned int submit(const std::string &key, PRIORITY priority, JOB *job);
+	void cancel(unsigned int id); // unknown/finished ids are ignored
+	void setPriority(unsigned int id, PRIORITY priority);
+
+	bool isQueued(unsigned int id) const;
+	bool isInFlight(unsigned int id) const;
+	inline int getNumQueued() const {return m_iNumQueued;}
+	inline int getNumInFlight() const {return (int)m_inFlight.size();} // including cancelled ones whose job isn't finished yet
+
+	inline void setMaxInFlight(int maxInFlight) {m_iMaxInFlight = maxInFlight;} // -1 = osu_load_scheduler_max_in_flight
+
+	static void test(); // completion order across priorities, dedup, cancellation, in-flight bound + time to the selected background under a thumbnail backlog (osu_load_scheduler_test)
+
+private:
+	struct REQUEST
+	{
+		unsigned int id;
+		std::string key;
+		PRIORITY priority;
+		unsigned long sequence; // of its current queue entry, older entries (from before a priority change) are skipped
+		bool inFlight;
+		JOB *job;
+	};
+
+	struct QUEUE_ENTRY
+	{
+		unsigned int id;
+		unsigned long sequence;
+	};
+
+	void enqueue(REQUEST *request);
+	void dispatch();
+	void remove(REQUEST *request);
+	bool isCancelledInFlight(const std::string &key) const;
+
+	unsigned int m_iNextID;
+	unsigned long m_iNextSequence;
+	int m_iMaxInFlight;
+	int m_iNumQueued;
+
+	std::unordered_map<unsigned int, REQUEST*> m_requests; // queued and in flight, but not cancelled
+	std::unordered_map<std::string, unsigned int> m_keys;
+	std::deque<QUEUE_ENTRY> m_queues[PRIORITY_COUNT];
+	std::vector<REQUEST*> m_inFlight;
+};
+
+#endif
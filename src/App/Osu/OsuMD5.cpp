@@ -0,0 +1,419 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		streaming md5 (RFC 1321), used for raw loaded beatmaps
+//
+// $NoKeywords: $osumd5
+//===============================================================================//
+
+#include "OsuMD5.h"
+
+#include "Engine.h"
+#include "ConVar.h"
+#include "Timer.h"
+
+#include "OsuBeatmapDifficulty.h"
+#include "OsuFile.h"
+
+#include <string.h>
+#include <fstream>
+
+#define MD5_F(x, y, z) (((x) & (y)) | (~(x) & (z)))
+#define MD5_G(x, y, z) (((x) & (z)) | ((y) & ~(z)))
+#define MD5_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD5_I(x, y, z) ((y) ^ ((x) | ~(z)))
+#define MD5_ROTATE(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define MD5_STEP(f, a, b, c, d, x, s, ac) {(a) += f((b), (c), (d)) + (x) + (uint32_t)(ac); (a) = MD5_ROTATE((a), (s)); (a) += (b);}
+
+OsuMD5::OsuMD5()
+{
+	reset();
+}
+
+void OsuMD5::reset()
+{
+	m_state[0] = 0x67452301;
+	m_state[1] = 0xefcdab89;
+	m_state[2] = 0x98badcfe;
+	m_state[3] = 0x10325476;
+	m_iNumBytes = 0;
+}
+
+void OsuMD5::update(const void *data, size_t size)
+{
+	const unsigned char *input = (const unsigned char*)data;
+
+	size_t bufferIndex = (size_t)(m_iNumBytes & 63);
+	m_iNumBytes += size;
+
+	// fill up a partial block first
+	if (bufferIndex > 0)
+	{
+		const size_t numFill = std::min(size, 64 - bufferIndex);
+		memcpy(&m_buffer[bufferIndex], input, numFill);
+		input += numFill;
+		size -= numFill;
+		bufferIndex += numFill;
+
+		if (bufferIndex < 64)
+			return;
+
+		transform(m_buffer);
+	}
+
+	// then all complete blocks directly from the input
+	while (size >= 64)
+	{
+		transform(input);
+		input += 64;
+		size -= 64;
+	}
+
+	// and keep the rest for later
+	if (size > 0)
+		memcpy(m_buffer, input, size);
+}
+
+void OsuMD5::finalize(unsigned char digest[16])
+{
+	const uint64_t numBits = m_iNumBytes * 8;
+
+	// pad to 56 mod 64 bytes, then append the length in bits (little endian)
+	unsigned char padding[64 + 8];
+	memset(padding, 0, sizeof(padding));
+	padding[0] = 0x80;
+
+	const size_t bufferIndex = (size_t)(m_iNumBytes & 63);
+	const size_t numPadding = (bufferIndex < 56 ? 56 - bufferIndex : 120 - bufferIndex);
+	for (int i=0; i<8; i++)
+	{
+		padding[numPadding + i] = (unsigned char)(numBits >> (i*8));
+	}
+	update(padding, numPadding + 8);
+
+	for (int i=0; i<4; i++)
+	{
+		digest[i*4 + 0] = (unsigned char)(m_state[i]);
+		digest[i*4 + 1] = (unsigned char)(m_state[i] >> 8);
+		digest[i*4 + 2] = (unsigned char)(m_state[i] >> 16);
+		digest[i*4 + 3] = (unsigned char)(m_state[i] >> 24);
+	}
+}
+
+void OsuMD5::transform(const unsigned char block[64])
+{
+	uint32_t x[16];
+	for (int i=0; i<16; i++)
+	{
+		x[i] = (uint32_t)block[i*4] | ((uint32_t)block[i*4 + 1] << 8) | ((uint32_t)block[i*4 + 2] << 16) | ((uint32_t)block[i*4 + 3] << 24);
+	}
+
+	uint32_t a = m_state[0];
+	uint32_t b = m_state[1];
+	uint32_t c = m_state[2];
+	uint32_t d = m_state[3];
+
+	// round 1
+	MD5_STEP(MD5_F, a, b, c, d, x[ 0],  7, 0xd76aa478);
+	MD5_STEP(MD5_F, d, a, b, c, x[ 1], 12, 0xe8c7b756);
+	MD5_STEP(MD5_F, c, d, a, b, x[ 2], 17, 0x242070db);
+	MD5_STEP(MD5_F, b, c, d, a, x[ 3], 22, 0xc1bdceee);
+	MD5_STEP(MD5_F, a, b, c, d, x[ 4],  7, 0xf57c0faf);
+	MD5_STEP(MD5_F, d, a, b, c, x[ 5], 12, 0x4787c62a);
+	MD5_STEP(MD5_F, c, d, a, b, x[ 6], 17, 0xa8304613);
+	MD5_STEP(MD5_F, b, c, d, a, x[ 7], 22, 0xfd469501);
+	MD5_STEP(MD5_F, a, b, c, d, x[ 8],  7, 0x698098d8);
+	MD5_STEP(MD5_F, d, a, b, c, x[ 9], 12, 0x8b44f7af);
+	MD5_STEP(MD5_F, c, d, a, b, x[10], 17, 0xffff5bb1);
+	MD5_STEP(MD5_F, b, c, d, a, x[11], 22, 0x895cd7be);
+	MD5_STEP(MD5_F, a, b, c, d, x[12],  7, 0x6b901122);
+	MD5_STEP(MD5_F, d, a, b, c, x[13], 12, 0xfd987193);
+	MD5_STEP(MD5_F, c, d, a, b, x[14], 17, 0xa679438e);
+	MD5_STEP(MD5_F, b, c, d, a, x[15], 22, 0x49b40821);
+
+	// round 2
+	MD5_STEP(MD5_G, a, b, c, d, x[ 1],  5, 0xf61e2562);
+	MD5_STEP(MD5_G, d, a, b, c, x[ 6],  9, 0xc040b340);
+	MD5_STEP(MD5_G, c, d, a, b, x[11], 14, 0x265e5a51);
+	MD5_STEP(MD5_G, b, c, d, a, x[ 0], 20, 0xe9b6c7aa);
+	MD5_STEP(MD5_G, a, b, c, d, x[ 5],  5, 0xd62f105d);
+	MD5_STEP(MD5_G, d, a, b, c, x[10],  9, 0x02441453);
+	MD5_STEP(MD5_G, c, d, a, b, x[15], 14, 0xd8a1e681);
+	MD5_STEP(MD5_G, b, c, d, a, x[ 4], 20, 0xe7d3fbc8);
+	MD5_STEP(MD5_G, a, b, c, d, x[ 9],  5, 0x21e1cde6);
+	MD5_STEP(MD5_G, d, a, b, c, x[14],  9, 0xc33707d6);
+	MD5_STEP(MD5_G, c, d, a, b, x[ 3], 14, 0xf4d50d87);
+	MD5_STEP(MD5_G, b, c, d, a, x[ 8], 20, 0x455a14ed);
+	MD5_STEP(MD5_G, a, b, c, d, x[13],  5, 0xa9e3e905);
+	MD5_STEP(MD5_G, d, a, b, c, x[ 2],  9, 0xfcefa3f8);
+	MD5_STEP(MD5_G, c, d, a, b, x[ 7], 14, 0x676f02d9);
+	MD5_STEP(MD5_G, b, c, d, a, x[12], 20, 0x8d2a4c8a);
+
+	// round 3
+	MD5_STEP(MD5_H, a, b, c, d, x[ 5],  4, 0xfffa3942);
+	MD5_STEP(MD5_H, d, a, b, c, x[ 8], 11, 0x8771f681);
+	MD5_STEP(MD5_H, c, d, a, b, x[11], 16, 0x6d9d6122);
+	MD5_STEP(MD5_H, b, c, d, a, x[14], 23, 0xfde5380c);
+	MD5_STEP(MD5_H, a, b, c, d, x[ 1],  4, 0xa4beea44);
+	MD5_STEP(MD5_H, d, a, b, c, x[ 4], 11, 0x4bdecfa9);
+	MD5_STEP(MD5_H, c, d, a, b, x[ 7], 16, 0xf6bb4b60);
+	MD5_STEP(MD5_H, b, c, d, a, x[10], 23, 0xbebfbc70);
+	MD5_STEP(MD5_H, a, b, c, d, x[13],  4, 0x289b7ec6);
+	MD5_STEP(MD5_H, d, a, b, c, x[ 0], 11, 0xeaa127fa);
+	MD5_STEP(MD5_H, c, d, a, b, x[ 3], 16, 0xd4ef3085);
+	MD5_STEP(MD5_H, b, c, d, a, x[ 6], 23, 0x04881d05);
+	MD5_STEP(MD5_H, a, b, c, d, x[ 9],  4, 0xd9d4d039);
+	MD5_STEP(MD5_H, d, a, b, c, x[12], 11, 0xe6db99e5);
+	MD5_STEP(MD5_H, c, d, a, b, x[15], 16, 0x1fa27cf8);
+	MD5_STEP(MD5_H, b, c, d, a, x[ 2], 23, 0xc4ac5665);
+
+	// round 4
+	MD5_STEP(MD5_I, a, b, c, d, x[ 0],  6, 0xf4292244);
+	MD5_STEP(MD5_I, d, a, b, c, x[ 7], 10, 0x432aff97);
+	MD5_STEP(MD5_I, c, d, a, b, x[14], 15, 0xab9423a7);
+	MD5_STEP(MD5_I, b, c, d, a, x[ 5], 21, 0xfc93a039);
+	MD5_STEP(MD5_I, a, b, c, d, x[12],  6, 0x655b59c3);
+	MD5_STEP(MD5_I, d, a, b, c, x[ 3], 10, 0x8f0ccc92);
+	MD5_STEP(MD5_I, c, d, a, b, x[10], 15, 0xffeff47d);
+	MD5_STEP(MD5_I, b, c, d, a, x[ 1], 21, 0x85845dd1);
+	MD5_STEP(MD5_I, a, b, c, d, x[ 8],  6, 0x6fa87e4f);
+	MD5_STEP(MD5_I, d, a, b, c, x[15], 10, 0xfe2ce6e0);
+	MD5_STEP(MD5_I, c, d, a, b, x[ 6], 15, 0xa3014314);
+	MD5_STEP(MD5_I, b, c, d, a, x[13], 21, 0x4e0811a1);
+	MD5_STEP(MD5_I, a, b, c, d, x[ 4],  6, 0xf7537e82);
+	MD5_STEP(MD5_I, d, a, b, c, x[11], 10, 0xbd3af235);
+	MD5_STEP(MD5_I, c, d, a, b, x[ 2], 15, 0x2ad7d2bb);
+	MD5_STEP(MD5_I, b, c, d, a, x[ 9], 21, 0xeb86d391);
+
+	m_state[0] += a;
+	m_state[1] += b;
+	m_state[2] += c;
+	m_state[3] += d;
+}
+
+void OsuMD5::hash(const void *data, size_t size, unsigned char digest[16])
+{
+	OsuMD5 md5;
+	md5.update(data, size);
+	md5.finalize(digest);
+}
+
+void OsuMD5::toHexString(const unsigned char digest[16], char hex[33])
+{
+	const char *digits = "0123456789abcdef";
+	for (int i=0; i<16; i++)
+	{
+		hex[i*2] = digits[digest[i] >> 4];
+		hex[i*2 + 1] = digits[digest[i] & 0x0f];
+	}
+	hex[32] = '\0';
+}
+
+bool OsuMD5::fromHexString(const char *hex, unsigned char digest[16])
+{
+	if (hex == NULL)
+		return false;
+
+	for (int i=0; i<32; i++)
+	{
+		const char c = hex[i];
+		int value;
+		if (c >= '0' && c <= '9')
+			value = c - '0';
+		else if (c >= 'a' && c <= 'f')
+			value = c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			value = c - 'A' + 10;
+		else
+			return false; // also catches the null terminator of short strings
+
+		if (i % 2 == 0)
+			digest[i/2] = (unsigned char)(value << 4);
+		else
+			digest[i/2] |= (unsigned char)value;
+	}
+
+	return (hex[32] == '\0');
+}
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+// deterministic .osu file, the expected digests below were calculated with a reference md5 implementation on exactly these bytes
+static std::string generateOsuFile(int numObjects, const char *newline)
+{
+	std::string osuFile = "osu file format v14";
+	osuFile.append(newline); osuFile.append(newline);
+
+	const char *lines[] =
+	{
+		"[General]", "AudioFilename: audio.mp3", "PreviewTime: 1234", "StackLeniency: 0.7", "Mode: 0", "",
+		"[Metadata]", "Title:MD5 Test", "Artist:McOsu", "Creator:PG", NULL, "",
+		"[Difficulty]", "HPDrainRate:5", "CircleSize:4", "OverallDifficulty:8", "ApproachRate:9", "SliderMultiplier:1.4", "SliderTickRate:1", "",
+		"[TimingPoints]", "1000,500,4,1,0,100,1,0", "",
+		"[HitObjects]"
+	};
+	for (int i=0; i<sizeof(lines)/sizeof(lines[0]); i++)
+	{
+		if (lines[i] != NULL)
+			osuFile.append(lines[i]);
+		else
+			osuFile.append(UString::format("Version:Generated %i", numObjects).toUtf8());
+		osuFile.append(newline);
+	}
+
+	for (int i=0; i<numObjects; i++)
+	{
+		osuFile.append(UString::format("%i,%i,%i,1,0,0:0:0:0:", (i*37) % 512, (i*91) % 384, 1000 + i*250).toUtf8());
+		osuFile.append(newline);
+	}
+
+	return osuFile;
+}
+
+void OsuMD5::test()
+{
+	int numTests = 0;
+	int numFailed = 0;
+
+	// RFC 1321, appendix A.5
+	struct TEST_VECTOR
+	{
+		const char *input;
+		const char *md5;
+	};
+	const TEST_VECTOR vectors[] =
+	{
+		{"", "d41d8cd98f00b204e9800998ecf8427e"},
+		{"a", "0cc175b9c0f1b6a831c399e269772661"},
+		{"abc", "900150983cd24fb0d6963f7d28e17f72"},
+		{"message digest", "f96b697d7cb7938d525a2f31aaf161d0"},
+		{"abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b"},
+		{"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", "d174ab98d277d9f5a5611c2c9f419d9f"},
+		{"12345678901234567890123456789012345678901234567890123456789012345678901234567890", "57edf4a22be3c955ac49da2e2107b67a"},
+	};
+	for (int i=0; i<sizeof(vectors)/sizeof(vectors[0]); i++)
+	{
+		const size_t length = strlen(vectors[i].input);
+
+		// in one go, and split at every possible position (block boundaries!)
+		for (size_t split=0; split<=length; split++)
+		{
+			unsigned char digest[16];
+			char hex[33];
+			OsuMD5 md5;
+			md5.update(vectors[i].input, split);
+			md5.update(vectors[i].input + split, length - split);
+			md5.finalize(digest);
+			toHexString(digest, hex);
+
+			numTests++;
+			if (strcmp(hex, vectors[i].md5) != 0)
+			{
+				numFailed++;
+				debugLog("osu_md5_test: FAILED md5(\"%s\") split at %i = %s (expected %s)\n", vectors[i].input, (int)split, hex, vectors[i].md5);
+			}
+		}
+
+		unsigned char digest[16];
+		char hex[33];
+		numTests++;
+		if (!fromHexString(vectors[i].md5, digest) || (toHexString(digest, hex), strcmp(hex, vectors[i].md5) != 0))
+		{
+			numFailed++;
+			debugLog("osu_md5_test: FAILED hex round trip of %s\n", vectors[i].md5);
+		}
+	}
+
+	// generated .osu files, through the actual raw metadata loader
+	struct OSU_FILE_VECTOR
+	{
+		int numObjects;
+		const char *newline;
+		const char *md5;
+	};
+	const OSU_FILE_VECTOR osuFiles[] =
+	{
+		{0, "\r\n", "97561a04850de054fa1d2e65d1911442"},
+		{100, "\r\n", "b3c14e31b86f5e8ec1364810717a68b0"},
+		{5000, "\n", "b14712958f7beb51852e09452f9bc37a"},
+	};
+	const UString testFilePathString = OsuFile::getTempFilePath("osu_md5_test.osu");
+	const char *testFilePath = testFilePathString.toUtf8();
+	double totalLoadTime = 0.0;
+	double totalHashTime = 0.0;
+	for (int i=0; i<sizeof(osuFiles)/sizeof(osuFiles[0]); i++)
+	{
+		const std::string osuFile = generateOsuFile(osuFiles[i].numObjects, osuFiles[i].newline);
+		{
+			std::ofstream out(testFilePath, std::ios::out | std::ios::binary | std::ios::trunc);
+			out.write(osuFile.c_str(), osuFile.length());
+		}
+
+		Timer t;
+		t.start();
+		OsuBeatmapDifficulty diff(NULL, testFilePath, "");
+		const bool loaded = diff.loadMetadataRaw();
+		t.update();
+		totalLoadTime += t.getElapsedTime();
+
+		unsigned char digest[16];
+		t.start();
+		hash(osuFile.c_str(), osuFile.length(), digest);
+		t.update();
+		totalHashTime += t.getElapsedTime();
+
+		numTests++;
+		if (!loaded || !diff.hasMD5() || diff.getMD5Hash() != UString(osuFiles[i].md5) || memcmp(diff.getMD5(), digest, 16) != 0 || diff.CS != 4.0f || diff.AR != 9.0f)
+		{
+			numFailed++;
+			debugLog("osu_md5_test: FAILED generated .osu file #%i: loaded = %i, md5 = %s (expected %s)\n", i, (int)loaded, diff.getMD5Hash().toUtf8(), osuFiles[i].md5);
+		}
+	}
+	std::remove(testFilePath);
+
+	// a file which can't be read has no md5 (not the one of an empty file)
+	{
+		OsuBeatmapDifficulty diff(NULL, testFilePath, "");
+		const bool loaded = diff.loadMetadataRaw();
+
+		numTests++;
+		if (loaded || diff.hasMD5())
+		{
+			numFailed++;
+			debugLog("osu_md5_test: FAILED missing .osu file: loaded = %i, md5 = %s\n", (int)loaded, diff.getMD5Hash().toUtf8());
+		}
+	}
+
+	debugLog("osu_md5_test: %s, %i/%i passed\n", numFailed == 0 ? "PASSED" : "FAILED", numTests - numFailed, numTests);
+	debugLog("osu_md5_test: hashing = %f %% of raw metadata load time (%f ms of %f ms)\n", totalLoadTime > 0.0 ? (totalHashTime / totalLoadTime)*100.0 : 0.0, totalHashTime*1000.0, totalLoadTime*1000.0);
+
+	// throughput, in chunks of the size of a typical line and of a typical file read
+	const size_t numBytes = 64*1024*1024;
+	std::vector<unsigned char> data(numBytes);
+	for (size_t i=0; i<numBytes; i++)
+	{
+		data[i] = (unsigned char)(i*31 + (i >> 8));
+	}
+
+	const size_t chunkSizes[] = {40, 65536};
+	for (int c=0; c<sizeof(chunkSizes)/sizeof(chunkSizes[0]); c++)
+	{
+		unsigned char digest[16];
+
+		Timer t;
+		t.start();
+		OsuMD5 md5;
+		for (size_t offset=0; offset<numBytes; offset+=chunkSizes[c])
+		{
+			md5.update(&data[offset], std::min(chunkSizes[c], numBytes - offset));
+		}
+		md5.finalize(digest);
+		t.update();
+
+		const double throughput = (t.getElapsedTime() > 0.0 ? ((double)numBytes / (1024.0*1024.0)) / t.getElapsedTime() : 0.0);
+		debugLog("osu_md5_test: %i MB in %i byte chunks took %f ms = %f MB/s (first byte of digest = %i)\n", (int)(numBytes / (1024*1024)), (int)chunkSizes[c], t.getElapsedTime()*1000.0, throughput, (int)digest[0]);
+	}
+}
@@ -0,0 +1,38 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		streaming md5 (RFC 1321), used for raw loaded beatmaps
+//
+// $NoKeywords: $osumd5
+//===============================================================================//
+
+#ifndef OSUMD5_H
+#define OSUMD5_H
+
+#include "cbase.h"
+
+// the hasher itself does not allocate anything (its callers may, e.g. loadMetadataRaw() reads the whole file), feed it as many update() calls as necessary and call finalize() once
+class OsuMD5
+{
+public:
+	OsuMD5();
+
+	void reset();
+	void update(const void *data, size_t size);
+	void finalize(unsigned char digest[16]); // the object must be reset() before it can be used again
+
+	// convenience
+	static void hash(const void *data, size_t size, unsigned char digest[16]);
+	static void toHexString(const unsigned char digest[16], char hex[33]); // lowercase, null terminated, same format as osu!.db and collection.db
+	static bool fromHexString(const char *hex, unsigned char digest[16]); // false if hex is not exactly 32 hex digits
+
+	static void test(); // RFC 1321 test vectors, generated .osu files, throughput (osu_md5_test)
+
+private:
+	void transform(const unsigned char block[64]);
+
+	uint32_t m_state[4];
+	uint64_t m_iNumBytes;
+	unsigned char m_buffer[64];
+};
+
+#endif
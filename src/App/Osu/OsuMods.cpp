@@ -0,0 +1,308 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		mod bitmask, osu_mods string parsing/formatting, per-play snapshot
+//
+// $NoKeywords: $osumods
+//===============================================================================//
+
+#include "OsuMods.h"
+
+#include "Engine.h"
+#include "ConVar.h"
+#include "Timer.h"
+
+#include <string.h>
+#include <cctype>
+
+// longer names must come first wherever one name is a prefix of another ("autopilot" vs "auto"), parse() always takes the longest match anyway
+const OsuMods::NAME OsuMods::names[] =
+{
+	{"nf", NF},
+	{"ez", EZ},
+	{"hd", HD},
+	{"hr", HR},
+	{"sd", SD},
+	{"dt", DT},
+	{"relax", RELAX},
+	{"ht", HT},
+	{"nc", NC},
+	{"fl", FL},
+	{"autopilot", AUTOPILOT},
+	{"auto", AUTO},
+	{"spunout", SPUNOUT},
+	{"ss", SS},
+	{"practicetarget", TARGET},
+	{"nm", NM},
+};
+const int OsuMods::numNames = sizeof(OsuMods::names) / sizeof(OsuMods::names[0]);
+
+OsuMods::SNAPSHOT::SNAPSHOT(unsigned int mods)
+{
+	flags = mods;
+
+	difficultyMultiplier = OsuMods::getDifficultyMultiplier(mods);
+	csDifficultyMultiplier = OsuMods::getCSDifficultyMultiplier(mods);
+	scoreMultiplier = OsuMods::getScoreMultiplier(mods);
+	speedMultiplier = OsuMods::getSpeedMultiplier(mods);
+	pitchMultiplier = OsuMods::getPitchMultiplier(mods);
+}
+
+bool OsuMods::parse(UString modString, unsigned int *mods, UString *error)
+{
+	*mods = NONE;
+
+	std::string str = modString.toUtf8();
+	for (int i=0; i<str.length(); i++)
+	{
+		str[i] = std::tolower(str[i]);
+	}
+
+	int pos = 0;
+	while (pos < str.length())
+	{
+		const char c = str[pos];
+		if (c == ' ' || c == ',' || c == '+' || c == '\t')
+		{
+			pos++;
+			continue;
+		}
+
+		// longest match
+		int match = -1;
+		int matchLength = 0;
+		for (int n=0; n<numNames; n++)
+		{
+			const int length = strlen(names[n].name);
+			if (length > matchLength && str.compare(pos, length, names[n].name) == 0)
+			{
+				match = n;
+				matchLength = length;
+			}
+		}
+
+		if (match < 0)
+		{
+			if (error != NULL)
+				*error = UString::format("unknown mod at position %i in \"%s\"", pos, str.c_str());
+			return false;
+		}
+
+		*mods |= names[match].mod;
+		pos += matchLength;
+	}
+
+	return true;
+}
+
+UString OsuMods::format(unsigned int mods)
+{
+	// same order as in the mod selector
+	UString modString = "";
+	for (int n=0; n<numNames; n++)
+	{
+		if (mods & names[n].mod)
+			modString.append(names[n].name);
+	}
+	return modString;
+}
+
+const char *OsuMods::getName(unsigned int mod)
+{
+	for (int n=0; n<numNames; n++)
+	{
+		if (names[n].mod == mod)
+			return names[n].name;
+	}
+	return NULL;
+}
+
+float OsuMods::getDifficultyMultiplier(unsigned int mods)
+{
+	float difficultyMultiplier = 1.0f;
+
+	if (mods & HR)
+		difficultyMultiplier = 1.4f;
+	if (mods & EZ)
+		difficultyMultiplier = 0.5f;
+
+	return difficultyMultiplier;
+}
+
+float OsuMods::getCSDifficultyMultiplier(unsigned int mods)
+{
+	float difficultyMultiplier = 1.0f;
+
+	if (mods & HR)
+		difficultyMultiplier = 1.3f; // different!
+	if (mods & EZ)
+		difficultyMultiplier = 0.5f;
+
+	return difficultyMultiplier;
+}
+
+float OsuMods::getScoreMultiplier(unsigned int mods)
+{
+	float multiplier = 1.0f;
+
+	if (mods & EZ)
+		multiplier *= 0.5f;
+	if (mods & HT)
+		multiplier *= 0.3f;
+	if (mods & HR)
+		multiplier *= 1.06f;
+	if (mods & (DT | NC))
+		multiplier *= 1.12f;
+	if (mods & HD)
+		multiplier *= 1.06f;
+	if (mods & SPUNOUT)
+		multiplier *= 0.9f;
+
+	return multiplier;
+}
+
+float OsuMods::getSpeedMultiplier(unsigned int mods)
+{
+	float speedMultiplier = 1.0f;
+
+	if (mods & (DT | NC | HT))
+	{
+		if (mods & (DT | NC))
+			speedMultiplier = 1.5f;
+		else
+			speedMultiplier = 0.75f;
+	}
+
+	return speedMultiplier;
+}
+
+float OsuMods::getPitchMultiplier(unsigned int mods)
+{
+	float pitchMultiplier = 1.0f;
+
+	if (mods & NC)
+		pitchMultiplier = 1.1166f;
+
+	return pitchMultiplier;
+}
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+void OsuMods::test()
+{
+	int numTests = 0;
+	int numFailed = 0;
+
+	// every single mod and every ordered pair, concatenated exactly like the mod selector does it
+	for (int a=0; a<numNames; a++)
+	{
+		for (int b=-1; b<numNames; b++)
+		{
+			UString modString = names[a].name;
+			if (b > -1)
+				modString.append(names[b].name);
+
+			const unsigned int expected = names[a].mod | (b > -1 ? names[b].mod : NONE);
+
+			unsigned int mods = NONE;
+			unsigned int roundTripMods = NONE;
+			const bool passed = parse(modString, &mods) && mods == expected && parse(format(mods), &roundTripMods) && roundTripMods == expected;
+
+			numTests++;
+			if (!passed)
+			{
+				numFailed++;
+				debugLog("osu_mods_test: FAILED \"%s\" = %u (expected %u), round trip = %u\n", modString.toUtf8(), mods, expected, roundTripMods);
+			}
+		}
+	}
+
+	// every combination of all known bits
+	unsigned int allMods = NONE;
+	for (int n=0; n<numNames; n++)
+	{
+		allMods |= names[n].mod;
+	}
+	for (unsigned long c=0; c<(1ul << numNames); c++)
+	{
+		unsigned int expected = NONE;
+		for (int n=0; n<numNames; n++)
+		{
+			if (c & (1ul << n))
+				expected |= names[n].mod;
+		}
+
+		unsigned int mods = NONE;
+		numTests++;
+		if (!parse(format(expected), &mods) || mods != expected)
+		{
+			numFailed++;
+			debugLog("osu_mods_test: FAILED round trip of %u (\"%s\" = %u)\n", expected, format(expected).toUtf8(), mods);
+		}
+	}
+
+	// things which must be rejected (these used to silently match something)
+	const char *invalid[] = {"autopilo", "hdx", "h", "pilot", "practice", "hd hr?", "dtnc1"};
+	for (int i=0; i<sizeof(invalid)/sizeof(invalid[0]); i++)
+	{
+		unsigned int mods = NONE;
+		numTests++;
+		if (parse(invalid[i], &mods))
+		{
+			numFailed++;
+			debugLog("osu_mods_test: FAILED \"%s\" was accepted as %u\n", invalid[i], mods);
+		}
+	}
+
+	// things which must be accepted
+	const char *valid[] = {"", "HDHR", "hd,hr", "hd + hr", "AutoPilot"};
+	for (int i=0; i<sizeof(valid)/sizeof(valid[0]); i++)
+	{
+		unsigned int mods = NONE;
+		numTests++;
+		if (!parse(valid[i], &mods))
+		{
+			numFailed++;
+			debugLog("osu_mods_test: FAILED \"%s\" was rejected\n", valid[i]);
+		}
+	}
+
+	debugLog("osu_mods_test: %s, %i/%i passed (all known bits = %u)\n", numFailed == 0 ? "PASSED" : "FAILED", numTests - numFailed, numTests, allMods);
+
+	// lookup cost in the gameplay hot path: a typical slider/circle update asks for ~5 flags
+	const int numLookups = 1000000;
+	const UString modString = "hdhrdtautopilot";
+	const std::string modStdString = modString.toUtf8();
+	const char *flagNames[] = {"hd", "hr", "auto", "relax", "nm"};
+	const unsigned int flagMods[] = {HD, HR, AUTO, RELAX, NM};
+
+	Timer t;
+	t.start();
+	int numSetSubstring = 0;
+	for (int i=0; i<numLookups; i++)
+	{
+		if (modStdString.find(flagNames[i % 5]) != std::string::npos)
+			numSetSubstring++;
+	}
+	t.update();
+	const double substringTime = t.getElapsedTime();
+
+	unsigned int mods = NONE;
+	parse(modString, &mods);
+	const SNAPSHOT snapshot(mods);
+
+	t.start();
+	int numSetSnapshot = 0;
+	for (int i=0; i<numLookups; i++)
+	{
+		if (snapshot.has(flagMods[i % 5]))
+			numSetSnapshot++;
+	}
+	t.update();
+	const double snapshotTime = t.getElapsedTime();
+
+	debugLog("osu_mods_test: lookup = %f ns (substring, %i hits), %f ns (snapshot, %i hits)\n", (substringTime / numLookups)*1000000000.0, numSetSubstring, (snapshotTime / numLookups)*1000000000.0, numSetSnapshot);
+}
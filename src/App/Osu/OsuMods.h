@@ -0,0 +1,83 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		mod bitmask, osu_mods string parsing/formatting, per-play snapshot
+//
+// $NoKeywords: $osumods
+//===============================================================================//
+
+#ifndef OSUMODS_H
+#define OSUMODS_H
+
+#include "cbase.h"
+
+#include "OsuReplay.h"
+
+class OsuMods
+{
+public:
+	// the bits are identical to OsuReplay::Mods, so the mask can be passed around as is (e.g. to the difficulty calculator, scores, replays)
+	enum MOD
+	{
+		NONE		= OsuReplay::Mods::None,
+		NF			= OsuReplay::Mods::NoFail,
+		EZ			= OsuReplay::Mods::Easy,
+		HD			= OsuReplay::Mods::Hidden,
+		HR			= OsuReplay::Mods::HardRock,
+		SD			= OsuReplay::Mods::SuddenDeath,
+		DT			= OsuReplay::Mods::DoubleTime,
+		RELAX		= OsuReplay::Mods::Relax,
+		HT			= OsuReplay::Mods::HalfTime,
+		NC			= OsuReplay::Mods::Nightcore, // NOTE: unlike osu!, NC does not imply DT here (that's just the way the mod selector works)
+		FL			= OsuReplay::Mods::Flashlight,
+		AUTO		= OsuReplay::Mods::Autoplay,
+		SPUNOUT		= OsuReplay::Mods::SpunOut,
+		AUTOPILOT	= OsuReplay::Mods::Relax2,
+		SS			= OsuReplay::Mods::Perfect,
+		TARGET		= 8388608,		// osu!'s Target Practice bit
+		NM			= 2147483648u	// nightmare, McOsu only (highest bit, unused by osu!)
+	};
+
+	// immutable copy of everything the mods decide, taken once per play (and whenever the mods change during one)
+	// hitobjects read this through their beatmap instead of asking Osu for every single flag every frame
+	struct SNAPSHOT
+	{
+		SNAPSHOT() : flags(NONE), difficultyMultiplier(1.0f), csDifficultyMultiplier(1.0f), scoreMultiplier(1.0f), speedMultiplier(1.0f), pitchMultiplier(1.0f) {;}
+		explicit SNAPSHOT(unsigned int mods);
+
+		inline bool has(unsigned int mod) const {return (flags & mod) != 0;}
+
+		unsigned int flags;
+
+		float difficultyMultiplier;
+		float csDifficultyMultiplier;
+		float scoreMultiplier;
+		float speedMultiplier; // without override
+		float pitchMultiplier; // without override
+	};
+
+	// strict: the string must consist of nothing but known mod names (e.g. "hdhrautopilot"), separators (spaces, commas, '+') are allowed
+	// on failure, mods still contains everything that could be parsed, and error (if not NULL) describes the first problem
+	static bool parse(UString modString, unsigned int *mods, UString *error = NULL);
+	static UString format(unsigned int mods); // canonical string, parse(format(mods)) == mods for all known bits
+
+	static const char *getName(unsigned int mod); // NULL for unknown/combined bits
+
+	static float getDifficultyMultiplier(unsigned int mods);
+	static float getCSDifficultyMultiplier(unsigned int mods);
+	static float getScoreMultiplier(unsigned int mods);
+	static float getSpeedMultiplier(unsigned int mods);
+	static float getPitchMultiplier(unsigned int mods);
+
+	static void test(); // exhaustive parse/format round trips + lookup benchmark (osu_mods_test)
+
+private:
+	struct NAME
+	{
+		const char *name;
+		unsigned int mod;
+	};
+	static const NAME names[];
+	static const int numNames;
+};
+
+#endif
@@ -88,7 +88,7 @@ public:
 				g->pushTransform();
 				g->scale(scoreScale, scoreScale);
 				g->translate(pos.x - skin->getScore0()->getWidth()*scoreScale, pos.y);
-				m_osu->getHUD()->drawScoreNumber(g, i-1, 1.0f);
+				m_osu->getHUD()->drawScoreNumber(g, i-1, scoreScale);
 				g->popTransform();
 			}
 		}
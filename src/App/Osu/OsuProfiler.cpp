@@ -0,0 +1,761 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		scoped frame profiler (per thread ring buffers, overlay statistics, chrome trace export)
+//
+// $NoKeywords: $osuprof
+//===============================================================================//
+
+#include "OsuProfiler.h"
+
+#include "Engine.h"
+#include "ConVar.h"
+#include "Timer.h"
+
+#include <mutex>
+#include "WinMinGW.Mutex.h" // necessary due to incomplete implementation in mingw-w64
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <unordered_map>
+#include <string.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define OSU_PROFILER_RDTSC
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define OSU_PROFILER_RDTSC
+#endif
+
+ConVar osu_profiler("osu_profiler", false, "record profiler zones (for osu_profiler_overlay and osu_profiler_export)");
+ConVar osu_profiler_overlay("osu_profiler_overlay", false, "draw the average/p99/max time per frame of every profiler zone (records zones even if osu_profiler is off)");
+ConVar osu_profiler_history("osu_profiler_history", 300, "number of frames the overlay statistics are calculated over");
+
+static const int OSU_PROFILER_RING_SIZE = 16384; // zones per thread, must be a power of two
+static const int OSU_PROFILER_MAX_THREADS = 64; // threads beyond this (at the same time) aren't recorded
+
+std::atomic<bool> OsuProfiler::s_bEnabled(false);
+
+struct OsuProfilerThreadBuffer
+{
+	OsuProfilerThreadBuffer(int size) : zones(size), head(0), alive(false)
+	{
+		mask = size - 1;
+		threadId = 0;
+		depth = 0;
+		collected = 0;
+	}
+
+	std::vector<OsuProfiler::ZONE> zones;
+	unsigned long long mask;
+	std::atomic<unsigned long long> head; // number of zones ever written, only the owning thread writes
+	std::atomic<bool> alive; // false once the owning thread has exited, then the buffer gets reused by the next new thread
+	unsigned int threadId;
+	unsigned int depth; // owning thread only
+	unsigned long long collected; // main thread only (under the mutex), head at the last beginFrame()
+};
+
+struct OsuProfilerThread
+{
+	OsuProfilerThread()
+	{
+		buffer = NULL;
+		full = false;
+	}
+
+	~OsuProfilerThread()
+	{
+		if (buffer != NULL)
+			buffer->alive.store(false);
+	}
+
+	OsuProfilerThreadBuffer *buffer;
+	bool full; // no buffer left, don't try again
+};
+
+static thread_local OsuProfilerThread t_osuProfilerThread;
+
+static std::mutex g_osuProfilerMutex;
+static std::vector<OsuProfilerThreadBuffer*> g_osuProfilerBuffers; // never deleted
+static unsigned int g_iOsuProfilerNextThreadId = 1;
+static unsigned int g_iOsuProfilerMainThreadId = 0;
+
+// main thread only
+struct OsuProfilerHistory
+{
+	const char *name;
+	std::vector<float> ms; // ring, one entry per frame
+	std::vector<float> calls;
+	unsigned long long frameNS; // the frame which is being collected
+	int frameCalls;
+};
+static std::vector<OsuProfilerHistory> g_osuProfilerHistories; // [0] is the whole frame
+static std::unordered_map<const char*, int> g_osuProfilerHistoryIndices;
+static std::vector<OsuProfiler::ZONE> g_osuProfilerFrameZones;
+static int g_iOsuProfilerHistorySize = 0;
+static int g_iOsuProfilerHistoryPos = 0;
+static int g_iOsuProfilerNumFrames = 0;
+static unsigned long long g_iOsuProfilerFrameStart = 0;
+
+static const char *OSU_PROFILER_FRAME_NAME = "frame";
+
+// main thread only
+static unsigned long long g_iOsuProfilerCalibrationTicks = 0;
+static unsigned long long g_iOsuProfilerCalibrationNS = 0;
+static double g_fOsuProfilerNSPerTick = 1.0;
+static bool g_bOsuProfilerCalibrated = false;
+
+static inline unsigned long long osuProfilerNow()
+{
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// zones are timestamped in ticks (the tsc where available, which is about twice as cheap to read as the steady clock), and converted to ns when they are collected
+static inline unsigned long long osuProfilerTicks()
+{
+#ifdef OSU_PROFILER_RDTSC
+	return __rdtsc();
+#else
+	return osuProfilerNow();
+#endif
+}
+
+static void osuProfilerCalibrate()
+{
+#ifdef OSU_PROFILER_RDTSC
+	if (!g_bOsuProfilerCalibrated)
+	{
+		// rough initial rate, refined on every later call over the whole time since then
+		g_iOsuProfilerCalibrationTicks = osuProfilerTicks();
+		g_iOsuProfilerCalibrationNS = osuProfilerNow();
+		while (osuProfilerNow() < g_iOsuProfilerCalibrationNS + 2000000)
+		{
+		}
+	}
+
+	const unsigned long long ticks = osuProfilerTicks();
+	const unsigned long long ns = osuProfilerNow();
+	if (ticks > g_iOsuProfilerCalibrationTicks)
+		g_fOsuProfilerNSPerTick = (double)(ns - g_iOsuProfilerCalibrationNS) / (double)(ticks - g_iOsuProfilerCalibrationTicks);
+#endif
+	g_bOsuProfilerCalibrated = true;
+}
+
+static inline unsigned long long osuProfilerTicksToNS(unsigned long long ticks)
+{
+#ifdef OSU_PROFILER_RDTSC
+	return g_iOsuProfilerCalibrationNS + (long long)((double)(long long)(ticks - g_iOsuProfilerCalibrationTicks) * g_fOsuProfilerNSPerTick);
+#else
+	return ticks;
+#endif
+}
+
+static void osuProfilerTicksToNS(std::vector<OsuProfiler::ZONE> *zones)
+{
+	for (int i=0; i<zones->size(); i++)
+	{
+		(*zones)[i].start = osuProfilerTicksToNS((*zones)[i].start);
+		(*zones)[i].end = osuProfilerTicksToNS((*zones)[i].end);
+	}
+}
+
+static OsuProfilerThreadBuffer *osuProfilerGetThreadBuffer()
+{
+	OsuProfilerThread &thread = t_osuProfilerThread;
+	if (thread.buffer != NULL || thread.full)
+		return thread.buffer;
+
+	std::lock_guard<std::mutex> lk(g_osuProfilerMutex);
+
+	OsuProfilerThreadBuffer *buffer = NULL;
+	for (int i=0; i<g_osuProfilerBuffers.size(); i++)
+	{
+		if (!g_osuProfilerBuffers[i]->alive.load())
+		{
+			buffer = g_osuProfilerBuffers[i];
+			break;
+		}
+	}
+	if (buffer == NULL)
+	{
+		if (g_osuProfilerBuffers.size() >= OSU_PROFILER_MAX_THREADS)
+		{
+			thread.full = true;
+			return NULL;
+		}
+
+		buffer = new OsuProfilerThreadBuffer(OSU_PROFILER_RING_SIZE);
+		g_osuProfilerBuffers.push_back(buffer);
+	}
+
+	// zones which a previous thread left in a reused buffer still show up in exports, but not in the statistics
+	buffer->threadId = g_iOsuProfilerNextThreadId++;
+	buffer->depth = 0;
+	buffer->collected = buffer->head.load();
+	buffer->alive.store(true);
+
+	thread.buffer = buffer;
+	return buffer;
+}
+
+static inline void osuProfilerPush(OsuProfilerThreadBuffer *buffer, const OsuProfiler::ZONE &zone)
+{
+	const unsigned long long head = buffer->head.load(std::memory_order_relaxed);
+	buffer->zones[head & buffer->mask] = zone;
+	buffer->head.store(head + 1, std::memory_order_release);
+}
+
+// appends the zones [from, head) which are still intact, returns the new read position (head)
+// the owning thread keeps writing while we copy, so whatever it could have overwritten in the meantime is dropped afterwards (the slot of head is always being written)
+static unsigned long long osuProfilerRead(OsuProfilerThreadBuffer *buffer, unsigned long long from, std::vector<OsuProfiler::ZONE> *zones)
+{
+	const unsigned long long size = buffer->mask + 1;
+	const unsigned long long head = buffer->head.load(std::memory_order_acquire);
+	if (head >= size && from < head + 1 - size)
+		from = head + 1 - size;
+	if (from >= head)
+		return head;
+
+	const size_t start = zones->size();
+	for (unsigned long long i=from; i<head; i++)
+	{
+		zones->push_back(buffer->zones[i & buffer->mask]);
+	}
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	const unsigned long long headAfter = buffer->head.load(std::memory_order_relaxed);
+	const unsigned long long firstIntact = (headAfter >= size ? headAfter + 1 - size : 0);
+	if (firstIntact > from)
+		zones->erase(zones->begin() + start, zones->begin() + start + (size_t)std::min(firstIntact - from, head - from));
+
+	return head;
+}
+
+static void osuProfilerResetHistory(int historySize)
+{
+	g_osuProfilerHistories.clear();
+	g_osuProfilerHistoryIndices.clear();
+	g_iOsuProfilerHistorySize = historySize;
+	g_iOsuProfilerHistoryPos = 0;
+	g_iOsuProfilerNumFrames = 0;
+}
+
+static int osuProfilerGetHistoryIndex(const char *name)
+{
+	std::unordered_map<const char*, int>::const_iterator it = g_osuProfilerHistoryIndices.find(name);
+	if (it != g_osuProfilerHistoryIndices.end())
+		return it->second;
+
+	// frames before the zone was first seen count as 0
+	OsuProfilerHistory history;
+	history.name = name;
+	history.ms.resize(g_iOsuProfilerHistorySize, 0.0f);
+	history.calls.resize(g_iOsuProfilerHistorySize, 0.0f);
+	history.frameNS = 0;
+	history.frameCalls = 0;
+	g_osuProfilerHistories.push_back(history);
+
+	const int index = g_osuProfilerHistories.size() - 1;
+	g_osuProfilerHistoryIndices[name] = index;
+	return index;
+}
+
+static OsuProfiler::STATS osuProfilerCalculateStats(const char *name, const std::vector<float> &ms, const std::vector<float> &calls, int numFrames)
+{
+	OsuProfiler::STATS stats;
+	stats.name = name;
+	stats.avgMS = 0.0;
+	stats.p99MS = 0.0;
+	stats.maxMS = 0.0;
+	stats.avgCalls = 0.0f;
+	if (numFrames < 1)
+		return stats;
+
+	// the ring is only partially filled until numFrames reaches its size, which fills it from the front
+	std::vector<float> sorted(ms.begin(), ms.begin() + numFrames);
+	double totalCalls = 0.0;
+	for (int i=0; i<numFrames; i++)
+	{
+		stats.avgMS += sorted[i];
+		totalCalls += calls[i];
+	}
+	stats.avgMS /= numFrames;
+	stats.avgCalls = (float)(totalCalls / numFrames);
+
+	std::sort(sorted.begin(), sorted.end());
+	stats.p99MS = sorted[std::max((int)std::ceil(numFrames*0.99) - 1, 0)];
+	stats.maxMS = sorted[numFrames-1];
+
+	return stats;
+}
+
+static void osuProfilerWriteEscaped(FILE *file, const char *string)
+{
+	for (const char *c=string; *c!='\0'; c++)
+	{
+		if (*c == '"' || *c == '\\')
+			fprintf(file, "\\%c", *c);
+		else if ((unsigned char)*c < 0x20)
+			fprintf(file, "\\u%04x", (unsigned int)(unsigned char)*c);
+		else
+			fputc(*c, file);
+	}
+}
+
+static bool osuProfilerWriteChromeTrace(UString filePath, std::vector<OsuProfiler::ZONE> zones, unsigned int mainThreadId)
+{
+	FILE *file = fopen(filePath.toUtf8(), "wb");
+	if (file == NULL)
+	{
+		debugLog("OsuProfiler: Couldn't write %s\n", filePath.toUtf8());
+		return false;
+	}
+
+	struct ZoneComparator
+	{
+		bool operator() (const OsuProfiler::ZONE &a, const OsuProfiler::ZONE &b) const
+		{
+			if (a.threadId != b.threadId)
+				return a.threadId < b.threadId;
+			if (a.start != b.start)
+				return a.start < b.start;
+			return a.depth < b.depth;
+		}
+	};
+	std::sort(zones.begin(), zones.end(), ZoneComparator());
+
+	unsigned long long firstStart = 0;
+	for (int i=0; i<zones.size(); i++)
+	{
+		if (i == 0 || zones[i].start < firstStart)
+			firstStart = zones[i].start;
+	}
+
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+	for (int i=0; i<zones.size(); i++)
+	{
+		const OsuProfiler::ZONE &zone = zones[i];
+
+		// name every thread once
+		if (i == 0 || zones[i-1].threadId != zone.threadId)
+		{
+			fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", first ? "" : ",\n", zone.threadId);
+			if (zone.threadId == mainThreadId)
+				fprintf(file, "main");
+			else
+				fprintf(file, "thread %u", zone.threadId);
+			fprintf(file, "\"}}");
+			first = false;
+		}
+
+		fprintf(file, ",\n{\"name\":\"");
+		osuProfilerWriteEscaped(file, zone.name);
+		fprintf(file, "\",\"cat\":\"osu\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", zone.threadId, (zone.start - firstStart) / 1000.0, (zone.end - zone.start) / 1000.0);
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+	const bool ok = (ferror(file) == 0);
+	fclose(file);
+	if (!ok)
+		debugLog("OsuProfiler: Error while writing %s\n", filePath.toUtf8());
+
+	return ok;
+}
+
+
+
+void OsuProfilerZone::begin(const char *name)
+{
+	m_buffer = osuProfilerGetThreadBuffer();
+	if (m_buffer == NULL)
+		return;
+
+	m_sName = name;
+	m_iDepth = m_buffer->depth++;
+	m_iStart = osuProfilerTicks();
+}
+
+void OsuProfilerZone::end()
+{
+	OsuProfiler::ZONE zone;
+	zone.end = osuProfilerTicks();
+	zone.name = m_sName;
+	zone.start = m_iStart;
+	zone.threadId = m_buffer->threadId;
+	zone.depth = m_iDepth;
+
+	m_buffer->depth--;
+	osuProfilerPush(m_buffer, zone);
+}
+
+
+
+void OsuProfiler::beginFrame()
+{
+	const bool enabled = osu_profiler.getBool() || osu_profiler_overlay.getBool();
+	const int historySize = clamp<int>(osu_profiler_history.getInt(), 1, 100000);
+	const unsigned long long now = osuProfilerNow();
+
+	if (enabled != isEnabled() || historySize != g_iOsuProfilerHistorySize)
+	{
+		s_bEnabled.store(enabled);
+		osuProfilerResetHistory(historySize);
+		if (enabled)
+			osuProfilerCalibrate();
+
+		// don't let anything from before show up in the statistics
+		std::lock_guard<std::mutex> lk(g_osuProfilerMutex);
+		for (int i=0; i<g_osuProfilerBuffers.size(); i++)
+		{
+			g_osuProfilerBuffers[i]->collected = g_osuProfilerBuffers[i]->head.load();
+		}
+		g_iOsuProfilerFrameStart = now;
+		return;
+	}
+	if (!enabled)
+		return;
+
+	OsuProfilerThreadBuffer *mainBuffer = osuProfilerGetThreadBuffer();
+	if (mainBuffer != NULL)
+		g_iOsuProfilerMainThreadId = mainBuffer->threadId;
+
+	// collect
+	g_osuProfilerFrameZones.clear();
+	{
+		std::lock_guard<std::mutex> lk(g_osuProfilerMutex);
+		for (int i=0; i<g_osuProfilerBuffers.size(); i++)
+		{
+			OsuProfilerThreadBuffer *buffer = g_osuProfilerBuffers[i];
+			buffer->collected = osuProfilerRead(buffer, buffer->collected, &g_osuProfilerFrameZones);
+		}
+	}
+	osuProfilerCalibrate();
+	osuProfilerTicksToNS(&g_osuProfilerFrameZones);
+
+	// zones which run over several frames (loading) count towards the frame in which they end
+	const int frameIndex = osuProfilerGetHistoryIndex(OSU_PROFILER_FRAME_NAME);
+	g_osuProfilerHistories[frameIndex].frameNS = now - g_iOsuProfilerFrameStart;
+	g_osuProfilerHistories[frameIndex].frameCalls = 1;
+	for (int i=0; i<g_osuProfilerFrameZones.size(); i++)
+	{
+		const ZONE &zone = g_osuProfilerFrameZones[i];
+		OsuProfilerHistory &history = g_osuProfilerHistories[osuProfilerGetHistoryIndex(zone.name)];
+		history.frameNS += zone.end - zone.start;
+		history.frameCalls++;
+	}
+
+	for (int i=0; i<g_osuProfilerHistories.size(); i++)
+	{
+		OsuProfilerHistory &history = g_osuProfilerHistories[i];
+		history.ms[g_iOsuProfilerHistoryPos] = (float)(history.frameNS / 1000000.0);
+		history.calls[g_iOsuProfilerHistoryPos] = (float)history.frameCalls;
+		history.frameNS = 0;
+		history.frameCalls = 0;
+	}
+	g_iOsuProfilerHistoryPos = (g_iOsuProfilerHistoryPos + 1) % g_iOsuProfilerHistorySize;
+	g_iOsuProfilerNumFrames = std::min(g_iOsuProfilerNumFrames + 1, g_iOsuProfilerHistorySize);
+	g_iOsuProfilerFrameStart = now;
+}
+
+std::vector<OsuProfiler::STATS> OsuProfiler::getStats()
+{
+	std::vector<STATS> stats;
+	for (int i=0; i<g_osuProfilerHistories.size(); i++)
+	{
+		const OsuProfilerHistory &history = g_osuProfilerHistories[i];
+		stats.push_back(osuProfilerCalculateStats(history.name, history.ms, history.calls, g_iOsuProfilerNumFrames));
+	}
+
+	struct StatsComparator
+	{
+		bool operator() (const STATS &a, const STATS &b) const
+		{
+			if ((a.name == OSU_PROFILER_FRAME_NAME) != (b.name == OSU_PROFILER_FRAME_NAME))
+				return a.name == OSU_PROFILER_FRAME_NAME;
+			return a.avgMS > b.avgMS;
+		}
+	};
+	std::sort(stats.begin(), stats.end(), StatsComparator());
+
+	return stats;
+}
+
+bool OsuProfiler::exportChromeTrace(UString filePath)
+{
+	std::vector<ZONE> zones;
+	{
+		std::lock_guard<std::mutex> lk(g_osuProfilerMutex);
+		for (int i=0; i<g_osuProfilerBuffers.size(); i++)
+		{
+			osuProfilerRead(g_osuProfilerBuffers[i], 0, &zones);
+		}
+	}
+	osuProfilerCalibrate();
+	osuProfilerTicksToNS(&zones);
+
+	if (!osuProfilerWriteChromeTrace(filePath, zones, g_iOsuProfilerMainThreadId))
+		return false;
+
+	debugLog("OsuProfiler: Exported %i zones to %s\n", (int)zones.size(), filePath.toUtf8());
+	return true;
+}
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+static bool profilerTestContains(const OsuProfiler::ZONE &outer, const OsuProfiler::ZONE &inner)
+{
+	return outer.start <= inner.start && inner.end <= outer.end && inner.depth == outer.depth + 1;
+}
+
+static void profilerTestPush(OsuProfilerThreadBuffer *buffer, int first, int count)
+{
+	for (int i=first; i<first+count; i++)
+	{
+		OsuProfiler::ZONE zone;
+		zone.name = "test";
+		zone.start = i;
+		zone.end = i + 1;
+		zone.threadId = 1;
+		zone.depth = 0;
+		osuProfilerPush(buffer, zone);
+	}
+}
+
+static bool profilerTestSequence(const std::vector<OsuProfiler::ZONE> &zones, int first, int count)
+{
+	if (zones.size() != count)
+		return false;
+	for (int i=0; i<zones.size(); i++)
+	{
+		if (zones[i].start != (unsigned long long)(first + i) || zones[i].end != zones[i].start + 1)
+			return false;
+	}
+	return true;
+}
+
+static volatile int g_iProfilerTestSink = 0;
+
+void OsuProfiler::test()
+{
+	int numTests = 0;
+	int numFailed = 0;
+
+	// everything runs on a private buffer, the real ones (and the statistics) aren't touched
+	const bool wasEnabled = isEnabled();
+	OsuProfilerThread &thread = t_osuProfilerThread;
+	OsuProfilerThreadBuffer *threadBuffer = thread.buffer;
+	const bool threadFull = thread.full;
+
+	OsuProfilerThreadBuffer testBuffer(64);
+	testBuffer.threadId = 1;
+	thread.buffer = &testBuffer;
+	thread.full = false;
+
+	// nesting: zones are written when they end, with their depth, and children lie within their parent
+	{
+		s_bEnabled.store(true);
+		{
+			OSU_PROFILER_ZONE("outer");
+			{
+				OSU_PROFILER_ZONE("inner");
+				{
+					OSU_PROFILER_ZONE("innermost");
+					g_iProfilerTestSink = g_iProfilerTestSink + 1;
+				}
+			}
+			{
+				OSU_PROFILER_ZONE("inner2");
+				g_iProfilerTestSink = g_iProfilerTestSink + 1;
+			}
+		}
+
+		std::vector<ZONE> zones;
+		osuProfilerRead(&testBuffer, 0, &zones);
+
+		numTests++;
+		if (zones.size() != 4
+			|| strcmp(zones[0].name, "innermost") != 0 || strcmp(zones[1].name, "inner") != 0 || strcmp(zones[2].name, "inner2") != 0 || strcmp(zones[3].name, "outer") != 0
+			|| zones[0].depth != 2 || zones[1].depth != 1 || zones[2].depth != 1 || zones[3].depth != 0
+			|| !profilerTestContains(zones[1], zones[0]) || !profilerTestContains(zones[3], zones[1]) || !profilerTestContains(zones[3], zones[2])
+			|| zones[1].end > zones[2].start || testBuffer.depth != 0)
+		{
+			numFailed++;
+			debugLog("osu_profiler_test: FAILED nesting (%i zones, depth %u)\n", (int)zones.size(), testBuffer.depth);
+		}
+	}
+
+	// toggling while a zone is open: a zone is recorded if it was entered while enabled, and the depth stays balanced
+	{
+		const unsigned long long head = testBuffer.head.load();
+
+		s_bEnabled.store(false);
+		{
+			OSU_PROFILER_ZONE("disabled");
+			s_bEnabled.store(true);
+		}
+		{
+			OSU_PROFILER_ZONE("enabled");
+			s_bEnabled.store(false);
+		}
+
+		std::vector<ZONE> zones;
+		osuProfilerRead(&testBuffer, head, &zones);
+
+		numTests++;
+		if (zones.size() != 1 || strcmp(zones[0].name, "enabled") != 0 || zones[0].depth != 0 || testBuffer.depth != 0)
+		{
+			numFailed++;
+			debugLog("osu_profiler_test: FAILED toggling (%i zones, depth %u)\n", (int)zones.size(), testBuffer.depth);
+		}
+	}
+
+	// ring wraparound: only the newest size-1 zones survive (the slot of head counts as being written), reading continues where it left off
+	{
+		OsuProfilerThreadBuffer ring(8);
+		profilerTestPush(&ring, 0, 20);
+
+		std::vector<ZONE> zones;
+		unsigned long long pos = osuProfilerRead(&ring, 0, &zones);
+		const bool lapped = profilerTestSequence(zones, 13, 7);
+
+		zones.clear();
+		pos = osuProfilerRead(&ring, pos, &zones);
+		const bool empty = (zones.size() == 0 && pos == 20);
+
+		profilerTestPush(&ring, 20, 3);
+		zones.clear();
+		pos = osuProfilerRead(&ring, pos, &zones);
+		const bool continued = profilerTestSequence(zones, 20, 3);
+
+		profilerTestPush(&ring, 23, 30);
+		zones.clear();
+		pos = osuProfilerRead(&ring, pos, &zones);
+		const bool lappedAgain = profilerTestSequence(zones, 46, 7) && pos == 53;
+
+		numTests++;
+		if (!lapped || !empty || !continued || !lappedAgain)
+		{
+			numFailed++;
+			debugLog("osu_profiler_test: FAILED wraparound (%i, %i, %i, %i)\n", (int)lapped, (int)empty, (int)continued, (int)lappedAgain);
+		}
+	}
+
+	// statistics
+	{
+		std::vector<float> ms;
+		std::vector<float> calls;
+		for (int i=1; i<=200; i++)
+		{
+			ms.push_back(i <= 100 ? (float)i : 0.0f);
+			calls.push_back(2.0f);
+		}
+		const STATS stats = osuProfilerCalculateStats("test", ms, calls, 100);
+
+		numTests++;
+		if (std::abs(stats.avgMS - 50.5) > 0.001 || stats.p99MS != 99.0 || stats.maxMS != 100.0 || stats.avgCalls != 2.0f)
+		{
+			numFailed++;
+			debugLog("osu_profiler_test: FAILED statistics (avg %f, p99 %f, max %f, calls %f)\n", stats.avgMS, stats.p99MS, stats.maxMS, stats.avgCalls);
+		}
+	}
+
+	// trace export: one complete event per zone, plus the thread name, names escaped
+	{
+		std::vector<ZONE> zones;
+		osuProfilerRead(&testBuffer, 0, &zones);
+		ZONE quoted = zones[0];
+		quoted.name = "say \"hi\"\\";
+		zones.push_back(quoted);
+
+		const char *filePath = "profiler_test_trace.json";
+		const bool written = osuProfilerWriteChromeTrace(filePath, zones, 1);
+
+		std::string json;
+		FILE *file = fopen(filePath, "rb");
+		if (file != NULL)
+		{
+			char buffer[4096];
+			size_t numRead;
+			while ((numRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			{
+				json.append(buffer, numRead);
+			}
+			fclose(file);
+		}
+		remove(filePath);
+
+		int numCompleteEvents = 0;
+		for (size_t pos = json.find("\"ph\":\"X\""); pos != std::string::npos; pos = json.find("\"ph\":\"X\"", pos + 1))
+		{
+			numCompleteEvents++;
+		}
+
+		numTests++;
+		if (!written || numCompleteEvents != zones.size() || json.find("{\"traceEvents\":[") != 0 || json.find("\"args\":{\"name\":\"main\"}") == std::string::npos
+			|| json.find("\"name\":\"say \\\"hi\\\"\\\\\"") == std::string::npos || json.find("\"ts\":0.000") == std::string::npos || json.find("]") == std::string::npos)
+		{
+			numFailed++;
+			debugLog("osu_profiler_test: FAILED export (written = %i, %i/%i events)\n", (int)written, numCompleteEvents, (int)zones.size());
+		}
+	}
+
+	// overhead: a disabled zone must cost less than 2 ns
+	{
+		const int numIterations = 50000000;
+		Timer t;
+
+		s_bEnabled.store(false);
+		t.start();
+		for (int i=0; i<numIterations; i++)
+		{
+			g_iProfilerTestSink = g_iProfilerTestSink + 1;
+		}
+		t.update();
+		const double baselineTime = t.getElapsedTime();
+
+		t.start();
+		for (int i=0; i<numIterations; i++)
+		{
+			OSU_PROFILER_ZONE("benchmark");
+			g_iProfilerTestSink = g_iProfilerTestSink + 1;
+		}
+		t.update();
+		const double disabledTime = t.getElapsedTime();
+
+		const int numEnabledIterations = 1000000;
+		OsuProfilerThreadBuffer benchmarkBuffer(OSU_PROFILER_RING_SIZE);
+		thread.buffer = &benchmarkBuffer;
+		s_bEnabled.store(true);
+		t.start();
+		for (int i=0; i<numEnabledIterations; i++)
+		{
+			OSU_PROFILER_ZONE("benchmark");
+			g_iProfilerTestSink = g_iProfilerTestSink + 1;
+		}
+		t.update();
+		const double enabledTime = t.getElapsedTime();
+
+		const double disabledNS = std::max(disabledTime - baselineTime, 0.0)*1000000000.0 / numIterations;
+		const double enabledNS = enabledTime*1000000000.0 / numEnabledIterations;
+		debugLog("osu_profiler_test: disabled zone %f ns, enabled zone %f ns (baseline loop %f ns/iteration)\n", disabledNS, enabledNS, baselineTime*1000000000.0 / numIterations);
+
+		numTests++;
+		if (disabledNS >= 2.0)
+		{
+			numFailed++;
+			debugLog("osu_profiler_test: FAILED disabled zone overhead (%f ns)\n", disabledNS);
+		}
+	}
+
+	thread.buffer = threadBuffer;
+	thread.full = threadFull;
+	s_bEnabled.store(wasEnabled);
+
+	debugLog("osu_profiler_test: %s, %i/%i passed\n", numFailed == 0 ? "PASSED" : "FAILED", numTests - numFailed, numTests);
+}
@@ -0,0 +1,84 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		scoped frame profiler (per thread ring buffers, overlay statistics, chrome trace export)
+//
+// $NoKeywords: $osuprof
+//===============================================================================//
+
+#ifndef OSUPROFILER_H
+#define OSUPROFILER_H
+
+#include "cbase.h"
+
+#include <atomic>
+
+struct OsuProfilerThreadBuffer;
+
+// zones (OSU_PROFILER_ZONE("OsuBeatmap::update")) are written into a ring buffer of the thread they ran on, recording never allocates or locks
+// once per frame the main thread collects the new zones of all threads into a short history per zone name, which the overlay (osu_profiler_overlay) shows
+// whatever is still in the ring buffers can be exported as chrome trace event json (chrome://tracing, ui.perfetto.dev)
+// while osu_profiler is off, a zone is a single relaxed load and branch, otherwise two tsc reads and a store into the ring buffer
+class OsuProfiler
+{
+public:
+	struct ZONE
+	{
+		const char *name; // must be a static string, its address identifies the zone
+		unsigned long long start; // ns (steady clock) once collected, ticks while still in a ring buffer
+		unsigned long long end;
+		unsigned int threadId;
+		unsigned int depth; // nesting on its thread, 0 = outermost
+	};
+
+	struct STATS
+	{
+		const char *name;
+		double avgMS; // per frame, frames without the zone count as 0
+		double p99MS;
+		double maxMS;
+		float avgCalls; // per frame
+	};
+
+	static inline bool isEnabled() {return s_bEnabled.load(std::memory_order_relaxed);}
+
+	static void beginFrame(); // once per frame on the main thread: applies osu_profiler/osu_profiler_overlay, collects the zones which have finished since the last call
+	static std::vector<STATS> getStats(); // over the last osu_profiler_history frames, the first entry is the whole frame, the rest are sorted by avgMS
+	static bool exportChromeTrace(UString filePath); // everything which is still in the ring buffers (the last few thousand zones of every thread)
+
+	static void test(); // zone nesting, ring wraparound, trace export, disabled/enabled zone overhead (osu_profiler_test)
+
+private:
+	static std::atomic<bool> s_bEnabled;
+};
+
+class OsuProfilerZone
+{
+public:
+	inline OsuProfilerZone(const char *name)
+	{
+		m_buffer = NULL;
+		if (OsuProfiler::isEnabled())
+			begin(name);
+	}
+
+	inline ~OsuProfilerZone()
+	{
+		if (m_buffer != NULL)
+			end();
+	}
+
+private:
+	void begin(const char *name);
+	void end();
+
+	OsuProfilerThreadBuffer *m_buffer; // NULL if not recording (disabled when the zone was entered)
+	const char *m_sName;
+	unsigned long long m_iStart;
+	unsigned int m_iDepth;
+};
+
+#define OSU_PROFILER_CONCAT_(a, b) a##b
+#define OSU_PROFILER_CONCAT(a, b) OSU_PROFILER_CONCAT_(a, b)
+#define OSU_PROFILER_ZONE(name) OsuProfilerZone OSU_PROFILER_CONCAT(osuProfilerZone, __LINE__)(name)
+
+#endif
@@ -0,0 +1,403 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		random beatmap selection (uniform or shuffle bag, weighted)
+//
+// $NoKeywords: $osurandom
+//===============================================================================//
+
+#include "OsuRandomBeatmapSelector.h"
+
+#include "Engine.h"
+#include "Timer.h"
+
+OsuRandomBeatmapSelector::OsuRandomBeatmapSelector(unsigned int seed)
+{
+	m_rng = std::mt19937(seed);
+	m_bShuffleBag = true;
+
+	m_iNumRemaining = 0;
+	m_iNumCandidates = 0;
+}
+
+void OsuRandomBeatmapSelector::setCandidates(const std::vector<int> &weights)
+{
+	m_tickets.clear();
+	m_iNumRemaining = 0;
+	m_iNumCandidates = 0;
+
+	for (int i=0; i<weights.size(); i++)
+	{
+		const int weight = clamp<int>(weights[i], 0, MAX_WEIGHT);
+		for (int t=0; t<weight; t++)
+		{
+			m_tickets.push_back(i);
+		}
+
+		if (weight > 0)
+			m_iNumCandidates++;
+	}
+}
+
+void OsuRandomBeatmapSelector::setShuffleBag(bool shuffleBag)
+{
+	if (shuffleBag != m_bShuffleBag)
+		m_iNumRemaining = 0;
+
+	m_bShuffleBag = shuffleBag;
+}
+
+int OsuRandomBeatmapSelector::pick(int exclude)
+{
+	if (m_tickets.size() < 1)
+		return -1;
+
+	// nothing else to choose from
+	if (m_iNumCandidates < 2)
+		exclude = -1;
+
+	if (!m_bShuffleBag)
+		return m_tickets[drawSlot(m_tickets.size(), exclude)];
+
+	// start the next cycle if the bag is empty, or if only the excluded one is left in it
+	if (m_iNumRemaining < 1)
+		m_iNumRemaining = m_tickets.size();
+
+	int slot = drawSlot(m_iNumRemaining, exclude);
+	if (slot < 0)
+	{
+		m_iNumRemaining = m_tickets.size();
+		slot = drawSlot(m_iNumRemaining, exclude);
+	}
+
+	// partial fisher-yates, the drawn ticket moves behind the bag
+	m_iNumRemaining--;
+	std::swap(m_tickets[slot], m_tickets[m_iNumRemaining]);
+	return m_tickets[m_iNumRemaining];
+}
+
+int OsuRandomBeatmapSelector::randomInt(int max)
+{
+	std::uniform_int_distribution<int> rng(0, max);
+	return rng(m_rng);
+}
+
+int OsuRandomBeatmapSelector::drawSlot(int numSlots, int exclude)
+{
+	// other tickets usually make up most of the slots, so redrawing almost never happens more than once
+	for (int i=0; i<MAX_REDRAWS; i++)
+	{
+		const int slot = randomInt(numSlots-1);
+		if (m_tickets[slot] != exclude)
+			return slot;
+	}
+
+	// the excluded candidate has (almost) all of the tickets, choose among the others directly (still uniformly)
+	int numOtherSlots = 0;
+	for (int i=0; i<numSlots; i++)
+	{
+		if (m_tickets[i] != exclude)
+			numOtherSlots++;
+	}
+	if (numOtherSlots < 1)
+		return -1;
+
+	int otherSlot = randomInt(numOtherSlots-1);
+	for (int i=0; i<numSlots; i++)
+	{
+		if (m_tickets[i] != exclude && otherSlot-- == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+static float randomBeatmapSelectorTestChiSquare(const std::vector<int> &counts, const std::vector<double> &expected)
+{
+	double chiSquare = 0.0;
+	for (int i=0; i<counts.size(); i++)
+	{
+		if (expected[i] > 0.0)
+			chiSquare += (counts[i] - expected[i])*(counts[i] - expected[i]) / expected[i];
+	}
+	return (float)chiSquare;
+}
+
+// what selectRandomBeatmap() used to do on every press: walk all elements of the container and dynamic_cast them
+class RandomBeatmapSelectorTestElement
+{
+public:
+	virtual ~RandomBeatmapSelectorTestElement() {;}
+};
+
+class RandomBeatmapSelectorTestSongButton : public RandomBeatmapSelectorTestElement
+{
+public:
+	int beatmap;
+};
+
+void OsuRandomBeatmapSelector::test()
+{
+	int numTests = 0;
+	int numFailed = 0;
+
+	// the same seed gives the same sequence
+	{
+		std::vector<int> weights(1000, 1);
+		OsuRandomBeatmapSelector a(1234);
+		a.setCandidates(weights);
+		OsuRandomBeatmapSelector b(1234);
+		b.setCandidates(weights);
+		OsuRandomBeatmapSelector c(4321);
+		c.setCandidates(weights);
+
+		bool same = true;
+		bool different = false;
+		for (int i=0; i<5000; i++)
+		{
+			const int pickA = a.pick();
+			same &= (pickA == b.pick());
+			different |= (pickA != c.pick());
+		}
+
+		numTests++;
+		if (!same || !different)
+		{
+			numFailed++;
+			debugLog("osu_random_test: FAILED reproducibility (same = %i, different = %i)\n", (int)same, (int)different);
+		}
+	}
+
+	// shuffle bag: every cycle is a permutation, and the previous pick is never picked again right away (not even across cycles)
+	{
+		const int numCandidates = 100;
+		std::vector<int> weights(numCandidates, 1);
+		OsuRandomBeatmapSelector selector(1);
+		selector.setCandidates(weights);
+
+		bool permutations = true;
+		bool noRepeats = true;
+		int previous = -1;
+		for (int cycle=0; cycle<200; cycle++)
+		{
+			std::vector<int> counts(numCandidates, 0);
+			for (int i=0; i<numCandidates; i++)
+			{
+				const int index = selector.pick(previous);
+				if (index < 0 || index >= numCandidates)
+				{
+					permutations = false;
+					break;
+				}
+
+				noRepeats &= (index != previous);
+				counts[index]++;
+				previous = index;
+			}
+			for (int i=0; i<numCandidates; i++)
+			{
+				permutations &= (counts[i] == 1);
+			}
+		}
+
+		numTests++;
+		if (!permutations || !noRepeats)
+		{
+			numFailed++;
+			debugLog("osu_random_test: FAILED shuffle bag no-repeat (permutations = %i, noRepeats = %i)\n", (int)permutations, (int)noRepeats);
+		}
+	}
+
+	// shuffle bag: every candidate is equally likely at every position of a cycle
+	{
+		const int numCandidates = 10;
+		const int numCycles = 20000;
+		std::vector<int> weights(numCandidates, 1);
+		OsuRandomBeatmapSelector selector(2);
+		selector.setCandidates(weights);
+
+		std::vector<int> firstCounts(numCandidates, 0);
+		std::vector<int> middleCounts(numCandidates, 0);
+		for (int cycle=0; cycle<numCycles; cycle++)
+		{
+			for (int i=0; i<numCandidates; i++)
+			{
+				const int index = selector.pick();
+				if (i == 0)
+					firstCounts[index]++;
+				else if (i == numCandidates/2)
+					middleCounts[index]++;
+			}
+		}
+
+		// 9 degrees of freedom, p = 0.001
+		const std::vector<double> expected(numCandidates, (double)numCycles / (double)numCandidates);
+		const float firstChiSquare = randomBeatmapSelectorTestChiSquare(firstCounts, expected);
+		const float middleChiSquare = randomBeatmapSelectorTestChiSquare(middleCounts, expected);
+
+		numTests++;
+		if (firstChiSquare > 27.88f || middleChiSquare > 27.88f)
+		{
+			numFailed++;
+			debugLog("osu_random_test: FAILED shuffle bag uniformity (chi square %f, %f)\n", firstChiSquare, middleChiSquare);
+		}
+	}
+
+	// shuffle bag: a candidate comes up exactly as often as its weight per cycle
+	{
+		std::vector<int> weights;
+		weights.push_back(1);
+		weights.push_back(2);
+		weights.push_back(4);
+		weights.push_back(0);
+		OsuRandomBeatmapSelector selector(3);
+		selector.setCandidates(weights);
+
+		bool exact = (selector.getNumTickets() == 7 && selector.getNumCandidates() == 3);
+		for (int cycle=0; cycle<100; cycle++)
+		{
+			std::vector<int> counts(weights.size(), 0);
+			for (int i=0; i<7; i++)
+			{
+				counts[selector.pick()]++;
+			}
+			for (int i=0; i<weights.size(); i++)
+			{
+				exact &= (counts[i] == weights[i]);
+			}
+		}
+
+		numTests++;
+		if (!exact)
+		{
+			numFailed++;
+			debugLog("osu_random_test: FAILED shuffle bag weights\n");
+		}
+	}
+
+	// uniform: proportional to the weights, the excluded one never comes up
+	{
+		std::vector<int> weights;
+		weights.push_back(1);
+		weights.push_back(2);
+		weights.push_back(3);
+		weights.push_back(4);
+		weights.push_back(10);
+		OsuRandomBeatmapSelector selector(4);
+		selector.setShuffleBag(false);
+		selector.setCandidates(weights);
+
+		const int numPicks = 100000;
+		std::vector<int> counts(weights.size(), 0);
+		for (int i=0; i<numPicks; i++)
+		{
+			counts[selector.pick(4)]++;
+		}
+
+		// 3 degrees of freedom (the excluded one has an expected count of 0), p = 0.001
+		std::vector<double> expected;
+		for (int i=0; i<weights.size(); i++)
+		{
+			expected.push_back(i == 4 ? 0.0 : numPicks * weights[i] / 10.0);
+		}
+		const float chiSquare = randomBeatmapSelectorTestChiSquare(counts, expected);
+
+		numTests++;
+		if (counts[4] != 0 || chiSquare > 16.27f)
+		{
+			numFailed++;
+			debugLog("osu_random_test: FAILED uniform weights (%i excluded picks, chi square %f)\n", counts[4], chiSquare);
+		}
+	}
+
+	// edge cases: nothing to pick, and a single candidate is picked even if it is excluded
+	{
+		OsuRandomBeatmapSelector selector(5);
+		const int emptyPick = selector.pick();
+
+		std::vector<int> weights(1, 1);
+		selector.setCandidates(weights);
+		const int singlePick1 = selector.pick(0);
+		const int singlePick2 = selector.pick(0);
+
+		numTests++;
+		if (emptyPick != -1 || singlePick1 != 0 || singlePick2 != 0)
+		{
+			numFailed++;
+			debugLog("osu_random_test: FAILED edge cases (%i, %i, %i)\n", emptyPick, singlePick1, singlePick2);
+		}
+	}
+
+	// benchmark, 100k visible beatmaps
+	{
+		const int numCandidates = 100000;
+		const int numPicks = 1000000;
+		std::vector<int> weights(numCandidates, 1);
+		for (int i=0; i<numCandidates; i+=7)
+		{
+			weights[i] = 4;
+		}
+
+		OsuRandomBeatmapSelector selector(6);
+		Timer t;
+		t.start();
+		selector.setCandidates(weights);
+		t.update();
+		const double setCandidatesTime = t.getElapsedTime();
+
+		int checksum = 0;
+		t.start();
+		for (int i=0; i<numPicks; i++)
+		{
+			checksum += selector.pick(i % numCandidates);
+		}
+		t.update();
+		const double bagTime = t.getElapsedTime();
+
+		selector.setShuffleBag(false);
+		t.start();
+		for (int i=0; i<numPicks; i++)
+		{
+			checksum += selector.pick(i % numCandidates);
+		}
+		t.update();
+		const double uniformTime = t.getElapsedTime();
+
+		std::vector<RandomBeatmapSelectorTestElement*> elements;
+		for (int i=0; i<numCandidates; i++)
+		{
+			RandomBeatmapSelectorTestSongButton *songButton = new RandomBeatmapSelectorTestSongButton();
+			songButton->beatmap = i;
+			elements.push_back(songButton);
+		}
+		const int numScans = 100;
+		t.start();
+		for (int s=0; s<numScans; s++)
+		{
+			std::vector<RandomBeatmapSelectorTestElement*> elementsCopy = elements; // getAllBaseUIElements() returns a copy
+			std::vector<RandomBeatmapSelectorTestSongButton*> songButtons;
+			for (int i=0; i<elementsCopy.size(); i++)
+			{
+				RandomBeatmapSelectorTestSongButton *songButton = dynamic_cast<RandomBeatmapSelectorTestSongButton*>(elementsCopy[i]);
+				if (songButton != NULL)
+					songButtons.push_back(songButton);
+			}
+			checksum += songButtons[s]->beatmap;
+		}
+		t.update();
+		const double scanTime = t.getElapsedTime();
+		for (int i=0; i<elements.size(); i++)
+		{
+			delete elements[i];
+		}
+
+		debugLog("osu_random_test: %i candidates: setCandidates() %f ms, shuffle bag %f ns/pick, uniform %f ns/pick, previous element scan %f ms/pick (checksum %i)\n", numCandidates, setCandidatesTime*1000.0, bagTime*1000000000.0 / numPicks, uniformTime*1000000000.0 / numPicks, scanTime*1000.0 / numScans, checksum);
+	}
+
+	debugLog("osu_random_test: %s, %i/%i passed\n", numFailed == 0 ? "PASSED" : "FAILED", numTests - numFailed, numTests);
+}
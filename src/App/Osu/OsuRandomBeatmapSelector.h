@@ -0,0 +1,52 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		random beatmap selection (uniform or shuffle bag, weighted)
+//
+// $NoKeywords: $osurandom
+//===============================================================================//
+
+#ifndef OSURANDOMBEATMAPSELECTOR_H
+#define OSURANDOMBEATMAPSELECTOR_H
+
+#include "cbase.h"
+
+#include <random>
+
+// candidates are just indices (into whatever the caller keeps, e.g. the visible song buttons), every candidate gets as many tickets as its weight
+// picking draws one ticket, either with replacement (uniform) or from a shuffle bag which only refills once all of its tickets have been drawn (no repeats within a cycle)
+// both are O(1) per pick, rebuilding the tickets is O(number of tickets) and only happens if the candidates change
+class OsuRandomBeatmapSelector
+{
+public:
+	static const int MAX_WEIGHT = 16;
+
+	OsuRandomBeatmapSelector(unsigned int seed);
+
+	void setCandidates(const std::vector<int> &weights); // one entry per candidate (0 = never picked, clamped to MAX_WEIGHT), empties the bag
+	void setShuffleBag(bool shuffleBag); // empties the bag if it changes
+
+	// returns the index of a candidate, or -1 if there are none
+	// exclude (e.g. the currently selected one) is never returned, unless it is the only candidate
+	int pick(int exclude = -1);
+
+	inline int getNumCandidates() const {return m_iNumCandidates;} // with a weight > 0
+	inline int getNumTickets() const {return m_tickets.size();}
+	inline int getNumRemainingInBag() const {return m_iNumRemaining;}
+
+	static void test(); // reproducibility, shuffle bag uniformity/no-repeat/weights, 100k candidates benchmark (osu_random_test)
+
+private:
+	static const int MAX_REDRAWS = 8; // before falling back to a scan for a ticket which isn't excluded
+
+	int randomInt(int max); // [0, max]
+	int drawSlot(int numSlots, int exclude); // a slot in [0, numSlots) whose ticket isn't excluded, -1 if there is none
+
+	std::mt19937 m_rng;
+	bool m_bShuffleBag;
+
+	std::vector<int> m_tickets; // candidate indices, the first m_iNumRemaining of them are still in the bag
+	int m_iNumRemaining;
+	int m_iNumCandidates;
+};
+
+#endif
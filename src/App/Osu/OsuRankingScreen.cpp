@@ -61,6 +61,7 @@ OsuRankingScreen::OsuRankingScreen(Osu *osu) : OsuScreenBackable(osu)
 
 	setGrade(OsuScore::GRADE::GRADE_D);
 	m_fUnstableRate = 0.0f;
+	m_iLocalOffset = 0;
 }
 
 OsuRankingScreen::~OsuRankingScreen()
@@ -100,6 +101,22 @@ void OsuRankingScreen::update()
 		m_osu->getTooltipOverlay()->begin();
 		m_osu->getTooltipOverlay()->addLine("Accuracy:");
 		m_osu->getTooltipOverlay()->addLine(UString::format("Unstable Rate: %g", m_fUnstableRate));
+		if (m_timingAnalytics.getNumHits() > 0)
+		{
+			m_osu->getTooltipOverlay()->addLine(UString::format("Error: %.2fms - +%.2fms avg", m_timingAnalytics.getEarlyMean(), m_timingAnalytics.getLateMean()));
+
+			UString sections = "Sections:";
+			for (int i=0; i<OsuTimingAnalytics::NUM_SECTIONS; i++)
+			{
+				const OsuTimingAnalytics::SECTION &section = m_timingAnalytics.getSection(i);
+				sections.append(UString::format("  %.1f/+%.1f", section.getEarlyMean(), section.getLateMean()));
+			}
+			m_osu->getTooltipOverlay()->addLine(sections);
+
+			m_osu->getTooltipOverlay()->addLine(UString::format("Drift: %+.1fms/min%s", m_timingAnalytics.getDrift(), m_timingAnalytics.isDrifting() ? " (drifting)" : ""));
+			if (m_timingAnalytics.getSuggestedOffsetAdjustment() != 0)
+				m_osu->getTooltipOverlay()->addLine(UString::format("Suggested local offset: %ld ms (currently %ld ms)", m_iLocalOffset + m_timingAnalytics.getSuggestedOffsetAdjustment(), m_iLocalOffset));
+		}
 		m_osu->getTooltipOverlay()->end();
 	}
 }
@@ -120,11 +137,13 @@ void OsuRankingScreen::setScore(OsuScore *score)
 	m_rankingPanel->setScore(score);
 	setGrade(score->getGrade());
 	m_fUnstableRate = score->getUnstableRate();
+	m_timingAnalytics = score->getTimingAnalytics();
 }
 
 void OsuRankingScreen::setBeatmapInfo(OsuBeatmap *beatmap, OsuBeatmapDifficulty *diff)
 {
 	m_songInfo->setFromBeatmap(beatmap, diff);
+	m_iLocalOffset = diff->localoffset;
 	m_songInfo->setPlayer(convar->getConVarByName("name")->getString());
 }
 
@@ -50,6 +50,8 @@ private:
 
 	OsuScore::GRADE m_grade;
 	float m_fUnstableRate;
+	OsuTimingAnalytics m_timingAnalytics;
+	long m_iLocalOffset;
 };
 
 #endif
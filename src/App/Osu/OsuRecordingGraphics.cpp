@@ -0,0 +1,547 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		graphics interface which only records commands, for draw call accounting without a gpu
+//
+// $NoKeywords: $osurg
+//===============================================================================//
+
+#include "OsuRecordingGraphics.h"
+
+#include "Engine.h"
+#include "VertexArrayObject.h"
+#include "RenderTarget.h"
+#include "Shader.h"
+#include "ConVar.h"
+#include "Timer.h"
+
+#include "Osu.h"
+#include "OsuHUD.h"
+#include "OsuBeatmap.h"
+#include "OsuBeatmapDifficulty.h"
+#include "OsuHitObjectFactory.h"
+#include "OsuFollowPoints.h"
+#include "OsuHitObject.h"
+#include "OsuSlider.h"
+
+ConVar osu_drawstats_budget_drawcalls("osu_drawstats_budget_drawcalls", 0, "osu_drawstats_benchmark fails if any frame needs more draw calls than this, 0 = no budget");
+ConVar osu_drawstats_budget_slider_drawcalls("osu_drawstats_budget_slider_drawcalls", 0, "osu_drawstats_benchmark fails if the slider-heavy frame needs more draw calls than this, 0 = no budget");
+
+extern ConVar osu_draw_followpoints;
+extern ConVar osu_draw_hitobjects;
+
+OsuRecordingGraphics *OsuRecordingGraphics::s_recording = NULL;
+
+OsuRecordingGraphics::OsuRecordingGraphics(Vector2 resolution) : Graphics()
+{
+	m_vResolution = resolution;
+	m_bRecording = false;
+
+	m_stats = FRAME_STATS();
+
+	m_color = 0xffffffff;
+	m_bClipping = false;
+	m_bBlending = true;
+	m_bDepthBuffer = false;
+	m_bCulling = false;
+	m_bAntialiasing = false;
+	m_bWireframe = false;
+	m_renderTarget = NULL;
+}
+
+OsuRecordingGraphics::~OsuRecordingGraphics()
+{
+	if (s_recording == this)
+		s_recording = NULL;
+}
+
+void OsuRecordingGraphics::beginScene()
+{
+	m_commands.clear();
+	m_stats = FRAME_STATS();
+	m_clipRectStack.clear();
+	m_renderTarget = NULL;
+
+	m_bRecording = true;
+	s_recording = this;
+}
+
+void OsuRecordingGraphics::endScene()
+{
+	m_bRecording = false;
+	if (s_recording == this)
+		s_recording = NULL;
+
+	m_stats.numCommands = m_commands.size();
+}
+
+void OsuRecordingGraphics::clearDepthBuffer()
+{
+	record(CMD_CLEAR_DEPTHBUFFER);
+}
+
+void OsuRecordingGraphics::setColor(Color color)
+{
+	recordState(CMD_SET_COLOR, color, color != m_color);
+	m_color = color;
+}
+
+void OsuRecordingGraphics::setAlpha(float alpha)
+{
+	const Color color = COLOR((int)(clamp<float>(alpha, 0.0f, 1.0f)*255.0f), COLOR_GET_Ri(m_color), COLOR_GET_Gi(m_color), COLOR_GET_Bi(m_color));
+	recordState(CMD_SET_ALPHA, color, color != m_color);
+	m_color = color;
+}
+
+void OsuRecordingGraphics::drawPixels(int x, int y, int width, int height, Graphics::DRAWPIXELS_TYPE type, const void *pixels)
+{
+	recordDraw(CMD_DRAW_PRIMITIVE, 4);
+}
+
+void OsuRecordingGraphics::drawPixel(int x, int y)
+{
+	recordDraw(CMD_DRAW_PRIMITIVE, 1);
+}
+
+void OsuRecordingGraphics::drawLine(int x1, int y1, int x2, int y2)
+{
+	recordDraw(CMD_DRAW_PRIMITIVE, 2);
+}
+
+void OsuRecordingGraphics::drawLine(Vector2 pos1, Vector2 pos2)
+{
+	recordDraw(CMD_DRAW_PRIMITIVE, 2);
+}
+
+void OsuRecordingGraphics::drawRect(int x, int y, int width, int height)
+{
+	// 4 lines
+	for (int i=0; i<4; i++)
+	{
+		recordDraw(CMD_DRAW_PRIMITIVE, 2);
+	}
+}
+
+void OsuRecordingGraphics::drawRect(int x, int y, int width, int height, Color top, Color right, Color bottom, Color left)
+{
+	// 4 lines, with one color each
+	const Color colors[] = {top, right, bottom, left};
+	for (int i=0; i<4; i++)
+	{
+		setColor(colors[i]);
+		recordDraw(CMD_DRAW_PRIMITIVE, 2);
+	}
+}
+
+void OsuRecordingGraphics::fillRect(int x, int y, int width, int height)
+{
+	recordDraw(CMD_DRAW_PRIMITIVE, 4);
+}
+
+void OsuRecordingGraphics::fillRoundedRect(int x, int y, int width, int height, int radius)
+{
+	// center + 4 sides as quads, 4 corners as triangle fans (8 segments each)
+	recordDraw(CMD_DRAW_PRIMITIVE, 5*4 + 4*10);
+}
+
+void OsuRecordingGraphics::fillGradient(int x, int y, int width, int height, Color topLeftColor, Color topRightColor, Color bottomLeftColor, Color bottomRightColor)
+{
+	recordDraw(CMD_DRAW_PRIMITIVE, 4);
+}
+
+void OsuRecordingGraphics::drawQuad(int x, int y, int width, int height)
+{
+	recordDraw(CMD_DRAW_PRIMITIVE, 4);
+}
+
+void OsuRecordingGraphics::drawQuad(Vector2 topLeft, Vector2 topRight, Vector2 bottomRight, Vector2 bottomLeft, Color topLeftColor, Color topRightColor, Color bottomRightColor, Color bottomLeftColor)
+{
+	recordDraw(CMD_DRAW_PRIMITIVE, 4);
+}
+
+void OsuRecordingGraphics::drawImage(Image *image)
+{
+	if (image == NULL)
+		return;
+
+	recordDraw(CMD_DRAW_IMAGE, 4);
+}
+
+void OsuRecordingGraphics::drawString(McFont *font, UString text)
+{
+	if (font == NULL || text.length() < 1)
+		return;
+
+	recordDraw(CMD_DRAW_STRING, text.length()*4); // one quad per glyph, in one call
+}
+
+void OsuRecordingGraphics::drawVAO(VertexArrayObject *vao)
+{
+	if (vao == NULL)
+		return;
+
+	recordDraw(CMD_DRAW_VAO, vao->getVertices().size());
+}
+
+void OsuRecordingGraphics::setClipRect(Rect clipRect)
+{
+	record(CMD_SET_CLIPRECT);
+	m_stats.stateChanges++;
+}
+
+void OsuRecordingGraphics::pushClipRect(Rect clipRect)
+{
+	m_clipRectStack.push_back(clipRect);
+	record(CMD_PUSH_CLIPRECT, m_clipRectStack.size());
+	m_stats.stateChanges++;
+}
+
+void OsuRecordingGraphics::popClipRect()
+{
+	if (m_clipRectStack.size() > 0)
+		m_clipRectStack.pop_back();
+	else
+		debugLog("OsuRecordingGraphics::popClipRect() without pushClipRect()!\n");
+
+	record(CMD_POP_CLIPRECT, m_clipRectStack.size());
+	m_stats.stateChanges++;
+}
+
+void OsuRecordingGraphics::setClipping(bool enabled)
+{
+	recordToggle(CMD_SET_CLIPPING, enabled, &m_bClipping);
+}
+
+void OsuRecordingGraphics::setBlending(bool enabled)
+{
+	recordToggle(CMD_SET_BLENDING, enabled, &m_bBlending);
+}
+
+void OsuRecordingGraphics::setDepthBuffer(bool enabled)
+{
+	recordToggle(CMD_SET_DEPTHBUFFER, enabled, &m_bDepthBuffer);
+}
+
+void OsuRecordingGraphics::setCulling(bool culling)
+{
+	recordToggle(CMD_SET_CULLING, culling, &m_bCulling);
+}
+
+void OsuRecordingGraphics::setAntialiasing(bool aa)
+{
+	recordToggle(CMD_SET_ANTIALIASING, aa, &m_bAntialiasing);
+}
+
+void OsuRecordingGraphics::setWireframe(bool enabled)
+{
+	recordToggle(CMD_SET_WIREFRAME, enabled, &m_bWireframe);
+}
+
+void OsuRecordingGraphics::flush()
+{
+	record(CMD_FLUSH);
+}
+
+std::vector<unsigned char> OsuRecordingGraphics::getScreenshot()
+{
+	// nothing is ever rendered, so this is just black
+	return std::vector<unsigned char>((int)m_vResolution.x * (int)m_vResolution.y * 3, 0);
+}
+
+void OsuRecordingGraphics::onTransformUpdate(Matrix4 &projectionMatrix, Matrix4 &worldMatrix)
+{
+	record(CMD_TRANSFORM);
+	m_stats.transformUpdates++;
+	m_stats.stateChanges++;
+}
+
+void OsuRecordingGraphics::record(COMMAND_TYPE type, unsigned int arg)
+{
+	if (!m_bRecording)
+		return;
+
+	const int transformDepth = m_worldTransformStack.size();
+	m_stats.maxTransformDepth = std::max(m_stats.maxTransformDepth, transformDepth);
+
+	COMMAND command;
+	command.type = type;
+	command.transformDepth = (unsigned char)std::min(transformDepth, 255);
+	command.arg = arg;
+	m_commands.push_back(command);
+}
+
+void OsuRecordingGraphics::recordDraw(COMMAND_TYPE type, unsigned int numVertices)
+{
+	updateTransform(); // like a real backend, this is where pending transforms get applied (and show up as CMD_TRANSFORM)
+
+	record(type, numVertices);
+	m_stats.drawCalls++;
+	m_stats.vertices += numVertices;
+}
+
+void OsuRecordingGraphics::recordState(COMMAND_TYPE type, unsigned int arg, bool changed)
+{
+	record(type, arg);
+	if (changed)
+		m_stats.stateChanges++;
+	else
+		m_stats.redundantStateChanges++;
+}
+
+void OsuRecordingGraphics::recordToggle(COMMAND_TYPE type, bool enabled, bool *state)
+{
+	recordState(type, enabled ? 1 : 0, enabled != *state);
+	*state = enabled;
+}
+
+void OsuRecordingGraphics::onRenderTarget(RenderTarget *rt, bool enabled)
+{
+	if (!m_bRecording)
+		return;
+
+	record(enabled ? CMD_RENDERTARGET_ENABLE : CMD_RENDERTARGET_DISABLE);
+	m_renderTarget = enabled ? rt : NULL;
+	m_stats.renderTargetBinds++;
+	m_stats.stateChanges++;
+}
+
+void OsuRecordingGraphics::onDeviceState(COMMAND_TYPE type)
+{
+	if (!m_bRecording)
+		return;
+
+	record(type);
+	m_stats.stateChanges++;
+}
+
+void OsuRecordingGraphics::enableRenderTarget(RenderTarget *rt)
+{
+	if (s_recording != NULL)
+		s_recording->onRenderTarget(rt, true);
+	else
+		rt->enable();
+}
+
+void OsuRecordingGraphics::disableRenderTarget(RenderTarget *rt)
+{
+	if (s_recording != NULL)
+		s_recording->onRenderTarget(rt, false);
+	else
+		rt->disable();
+}
+
+void OsuRecordingGraphics::drawRenderTarget(Graphics *g, RenderTarget *rt, float x, float y, float width, float height)
+{
+	// RenderTarget::drawRect() binds its texture on the device, the quad itself is one draw
+	if (s_recording != NULL)
+	{
+		s_recording->onDeviceState(CMD_TEXTURE_BIND);
+		s_recording->recordDraw(CMD_RENDERTARGET_DRAW, 4);
+	}
+	else
+		rt->drawRect(g, x, y, width, height);
+}
+
+void OsuRecordingGraphics::enableShader(Shader *shader)
+{
+	if (s_recording != NULL)
+		s_recording->onDeviceState(CMD_SHADER_ENABLE);
+	else
+		shader->enable();
+}
+
+void OsuRecordingGraphics::disableShader(Shader *shader)
+{
+	if (s_recording != NULL)
+		s_recording->onDeviceState(CMD_SHADER_DISABLE);
+	else
+		shader->disable();
+}
+
+void OsuRecordingGraphics::bindImage(Image *image)
+{
+	if (s_recording != NULL)
+		s_recording->onDeviceState(CMD_TEXTURE_BIND);
+	else
+		image->bind();
+}
+
+void OsuRecordingGraphics::unbindImage(Image *image)
+{
+	if (s_recording != NULL)
+		s_recording->onDeviceState(CMD_TEXTURE_UNBIND);
+	else
+		image->unbind();
+}
+
+
+
+//***************//
+//	Benchmark	 //
+//***************//
+
+// synthetic map with one section per kind of load: a circle jump stream, long overlapping sliders, a spinner
+static void drawStatsBenchmarkGenerate(OsuBeatmapDifficulty *diff, long *circleTime, long *sliderTime, long *spinnerTime)
+{
+	long time = 1000;
+
+	*circleTime = time + 2000;
+	for (int i=0; i<200; i++)
+	{
+		OsuBeatmapDifficulty::HITCIRCLE c;
+		c.x = (i % 2 == 0 ? 64 + (i % 7)*16 : 448 - (i % 5)*16);
+		c.y = 48 + (i % 9)*36;
+		c.time = time;
+		c.sampleType = 0;
+		c.number = (i % 8) + 1;
+		c.colorCounter = i / 8;
+		c.clicked = false;
+		diff->hitcircles.push_back(c);
+
+		time += 100;
+	}
+
+	time += 1000;
+	*sliderTime = time + 2000;
+	for (int i=0; i<60; i++)
+	{
+		OsuBeatmapDifficulty::SLIDER s;
+		s.type = OsuSlider::SLIDER_BEZIER;
+		s.repeat = 1 + (i % 3);
+		s.pixelLength = 300.0f;
+		s.time = time;
+		s.sampleType = 0;
+		s.number = (i % 4) + 1;
+		s.colorCounter = i / 4;
+		s.points.push_back(Vector2(48 + (i % 5)*40, 64 + (i % 7)*40));
+		s.points.push_back(Vector2(200 + (i % 3)*30, 16 + (i % 4)*20));
+		s.points.push_back(Vector2(300 + (i % 4)*30, 320 - (i % 5)*20));
+		s.points.push_back(Vector2(464 - (i % 5)*20, 200 + (i % 3)*40));
+		OsuBeatmapDifficulty::calculateSliderEvents(&s, 300.0f, 300.0f, 2.0f, 2.0f);
+		for (int r=0; r<s.repeat+1; r++)
+		{
+			s.hitSounds.push_back(0);
+		}
+		diff->sliders.push_back(s);
+
+		time += 200; // the next one starts long before this one ends
+	}
+
+	time += 4000;
+	*spinnerTime = time + 1500;
+	{
+		OsuBeatmapDifficulty::SPINNER s;
+		s.x = 256;
+		s.y = 192;
+		s.time = time;
+		s.sampleType = 0;
+		s.endTime = time + 3000;
+		diff->spinners.push_back(s);
+	}
+}
+
+void OsuRecordingGraphics::benchmark(OsuBeatmap *beatmap)
+{
+	Osu *osu = beatmap->getOsu();
+
+	OsuBeatmapDifficulty diff(NULL, "", "");
+	diff.stackLeniency = 0.7f;
+	long circleTime = 0;
+	long sliderTime = 0;
+	long spinnerTime = 0;
+	drawStatsBenchmarkGenerate(&diff, &circleTime, &sliderTime, &spinnerTime);
+
+	// updating the objects judges them, the simulation sends that to a headless score instead of the score, hud and sounds of the selected beatmap
+	OsuScore score(osu, true);
+	if (!beatmap->beginSimulation(&diff, &score))
+	{
+		debugLog("osu_drawstats_benchmark: Can't simulate right now, stop playing first!\n");
+		return;
+	}
+	beatmap->updateMetrics();
+
+	std::vector<OsuHitObject*> objects;
+	std::vector<OsuHitObject*> objectsSortedByEndTime;
+	OsuHitObjectFactory *factory = new OsuHitObjectFactory(beatmap, &diff, &objects, &objectsSortedByEndTime);
+	factory->calculateStacks(beatmap->getDifficulty().approachTime, beatmap->getDifficulty().stackOffset);
+	factory->createAll();
+
+	OsuFollowPoints followPoints(beatmap);
+	followPoints.build(factory);
+
+	struct FRAME
+	{
+		const char *name;
+		long time;
+	};
+	const FRAME frames[] =
+	{
+		{"empty", 0},
+		{"circles", circleTime},
+		{"sliders", sliderTime},
+		{"spinner", spinnerTime}
+	};
+
+	OsuRecordingGraphics g(osu->getScreenSize());
+	bool failed = false;
+	for (int f=0; f<sizeof(frames)/sizeof(frames[0]); f++)
+	{
+		const long curPos = frames[f].time;
+
+		// put everything into the state it would have if the map had been played up to curPos
+		for (int i=0; i<objects.size(); i++)
+		{
+			objects[i]->onReset(curPos);
+			objects[i]->update(curPos);
+		}
+
+		// the same order as OsuBeatmap::draw(), followed by the hud
+		Timer t;
+		t.start();
+		g.beginScene();
+		{
+			if (osu_draw_followpoints.getBool())
+				followPoints.draw(&g, curPos);
+
+			if (osu_draw_hitobjects.getBool())
+			{
+				for (int i=objectsSortedByEndTime.size()-1; i>=0; i--)
+				{
+					objectsSortedByEndTime[i]->draw(&g);
+				}
+				for (int i=objectsSortedByEndTime.size()-1; i>=0; i--)
+				{
+					objectsSortedByEndTime[i]->draw2(&g);
+				}
+			}
+
+			osu->getHUD()->drawDummy(&g);
+		}
+		g.endScene();
+		t.update();
+
+		const FRAME_STATS &stats = g.getStats();
+		debugLog("osu_drawstats_benchmark: %s (t = %li): %i draw calls, %lu vertices, %i state changes (+ %i redundant), %i transform updates (max depth %i), %i render target binds, %i commands, %f ms\n", frames[f].name, curPos, stats.drawCalls, stats.vertices, stats.stateChanges, stats.redundantStateChanges, stats.transformUpdates, stats.maxTransformDepth, stats.renderTargetBinds, stats.numCommands, t.getElapsedTime()*1000.0);
+
+		const int budget = osu_drawstats_budget_drawcalls.getInt();
+		if (budget > 0 && stats.drawCalls > budget)
+		{
+			failed = true;
+			debugLog("osu_drawstats_benchmark: %s is over budget (%i > %i draw calls)\n", frames[f].name, stats.drawCalls, budget);
+		}
+		const int sliderBudget = osu_drawstats_budget_slider_drawcalls.getInt();
+		if (frames[f].time == sliderTime && sliderBudget > 0 && stats.drawCalls > sliderBudget)
+		{
+			failed = true;
+			debugLog("osu_drawstats_benchmark: %s is over the slider budget (%i > %i draw calls)\n", frames[f].name, stats.drawCalls, sliderBudget);
+		}
+	}
+	debugLog("osu_drawstats_benchmark: %s\n", failed ? "FAILED" : "PASSED");
+
+	for (int i=0; i<objects.size(); i++)
+	{
+		delete objects[i];
+	}
+	delete factory;
+
+	beatmap->endSimulation();
+}
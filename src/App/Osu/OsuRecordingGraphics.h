@@ -0,0 +1,183 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		graphics interface which only records commands, for draw call accounting without a gpu
+//
+// $NoKeywords: $osurg
+//===============================================================================//
+
+#ifndef OSURECORDINGGRAPHICS_H
+#define OSURECORDINGGRAPHICS_H
+
+#include "cbase.h"
+
+class OsuBeatmap;
+class RenderTarget;
+class Shader;
+
+// every call is appended to a compact command log instead of being sent to a device, and counted into per-frame statistics
+// a frame is everything between beginScene() and endScene(), the log and the statistics stay valid until the next beginScene()
+// the transforms themselves are handled by Graphics, they show up here as transform updates (right before the draw which needs them) and as the stack depth
+// render targets, shaders and texture binds go directly to the device, so the renderers use the static wrappers below for them
+// outside of a recorded frame these just forward to the device, inside of one they are only recorded (so a recorded frame never touches the device)
+class OsuRecordingGraphics : public Graphics
+{
+public:
+	enum COMMAND_TYPE
+	{
+		CMD_SET_COLOR,
+		CMD_SET_ALPHA,
+		CMD_SET_CLIPRECT,
+		CMD_PUSH_CLIPRECT,
+		CMD_POP_CLIPRECT,
+		CMD_SET_CLIPPING,
+		CMD_SET_BLENDING,
+		CMD_SET_DEPTHBUFFER,
+		CMD_SET_CULLING,
+		CMD_SET_ANTIALIASING,
+		CMD_SET_WIREFRAME,
+		CMD_CLEAR_DEPTHBUFFER,
+		CMD_TRANSFORM,
+		CMD_RENDERTARGET_ENABLE,
+		CMD_RENDERTARGET_DISABLE,
+		CMD_RENDERTARGET_DRAW,
+		CMD_SHADER_ENABLE,
+		CMD_SHADER_DISABLE,
+		CMD_TEXTURE_BIND,
+		CMD_TEXTURE_UNBIND,
+		CMD_DRAW_PRIMITIVE,
+		CMD_DRAW_IMAGE,
+		CMD_DRAW_STRING,
+		CMD_DRAW_VAO,
+		CMD_FLUSH
+	};
+
+	struct COMMAND
+	{
+		unsigned char type; // COMMAND_TYPE
+		unsigned char transformDepth;
+		unsigned int arg; // draws: number of vertices, setColor: the color, toggles: 0/1, transform: 0
+	};
+
+	struct FRAME_STATS
+	{
+		int numCommands;
+		int drawCalls;
+		int stateChanges; // color/alpha/clip/settings which actually changed something, transform updates, render target/shader switches and texture binds
+		int redundantStateChanges; // setting what was already set (not included in stateChanges)
+		int transformUpdates;
+		int renderTargetBinds;
+		int maxTransformDepth;
+		unsigned long vertices;
+	};
+
+public:
+	OsuRecordingGraphics(Vector2 resolution);
+	virtual ~OsuRecordingGraphics();
+
+	virtual void beginScene();
+	virtual void endScene();
+
+	// depth buffer
+	virtual void clearDepthBuffer();
+
+	// color
+	virtual void setColor(Color color);
+	virtual void setAlpha(float alpha);
+
+	// 2d primitive drawing
+	virtual void drawPixels(int x, int y, int width, int height, Graphics::DRAWPIXELS_TYPE type, const void *pixels);
+	virtual void drawPixel(int x, int y);
+	virtual void drawLine(int x1, int y1, int x2, int y2);
+	virtual void drawLine(Vector2 pos1, Vector2 pos2);
+	virtual void drawRect(int x, int y, int width, int height);
+	virtual void drawRect(int x, int y, int width, int height, Color top, Color right, Color bottom, Color left);
+	virtual void fillRect(int x, int y, int width, int height);
+	virtual void fillRoundedRect(int x, int y, int width, int height, int radius);
+	virtual void fillGradient(int x, int y, int width, int height, Color topLeftColor, Color topRightColor, Color bottomLeftColor, Color bottomRightColor);
+	virtual void drawQuad(int x, int y, int width, int height);
+	virtual void drawQuad(Vector2 topLeft, Vector2 topRight, Vector2 bottomRight, Vector2 bottomLeft, Color topLeftColor, Color topRightColor, Color bottomRightColor, Color bottomLeftColor);
+
+	// 2d resource drawing
+	virtual void drawImage(Image *image);
+	virtual void drawString(McFont *font, UString text);
+
+	// 3d type drawing
+	virtual void drawVAO(VertexArrayObject *vao);
+
+	// 2d clipping
+	virtual void setClipRect(Rect clipRect);
+	virtual void pushClipRect(Rect clipRect);
+	virtual void popClipRect();
+
+	// renderer settings
+	virtual void setClipping(bool enabled);
+	virtual void setBlending(bool enabled);
+	virtual void setDepthBuffer(bool enabled);
+	virtual void setCulling(bool culling);
+	virtual void setAntialiasing(bool aa);
+	virtual void setWireframe(bool enabled);
+
+	// renderer actions
+	virtual void flush();
+	virtual std::vector<unsigned char> getScreenshot();
+
+	// renderer info
+	virtual Vector2 getResolution() {return m_vResolution;}
+	virtual UString getVendor() {return "McOsu";}
+	virtual UString getModel() {return "OsuRecordingGraphics";}
+	virtual UString getVersion() {return "1";}
+	virtual int getVRAMTotal() {return -1;}
+	virtual int getVRAMRemaining() {return -1;}
+
+	// callbacks
+	virtual void onResolutionChange(Vector2 newResolution) {m_vResolution = newResolution;}
+
+	// log
+	inline const std::vector<COMMAND> &getCommands() const {return m_commands;}
+	inline const FRAME_STATS &getStats() const {return m_stats;}
+	inline bool isRecording() const {return m_bRecording;}
+
+	// device wrappers
+	static inline bool isRecordingFrame() {return s_recording != NULL;}
+	static void enableRenderTarget(RenderTarget *rt);
+	static void disableRenderTarget(RenderTarget *rt);
+	static void drawRenderTarget(Graphics *g, RenderTarget *rt, float x, float y, float width, float height);
+	static void enableShader(Shader *shader);
+	static void disableShader(Shader *shader);
+	static void bindImage(Image *image);
+	static void unbindImage(Image *image);
+
+	static void benchmark(OsuBeatmap *beatmap); // draws a synthetic map (simulated, see OsuBeatmap::beginSimulation()) at fixed timestamps and logs the statistics of every frame (osu_drawstats_benchmark)
+
+protected:
+	virtual void onTransformUpdate(Matrix4 &projectionMatrix, Matrix4 &worldMatrix);
+
+private:
+	static OsuRecordingGraphics *s_recording; // the recorder between beginScene() and endScene(), if any
+
+	void record(COMMAND_TYPE type, unsigned int arg = 0);
+	void recordDraw(COMMAND_TYPE type, unsigned int numVertices);
+	void recordState(COMMAND_TYPE type, unsigned int arg, bool changed);
+	void recordToggle(COMMAND_TYPE type, bool enabled, bool *state);
+	void onRenderTarget(RenderTarget *rt, bool enabled);
+	void onDeviceState(COMMAND_TYPE type);
+
+	Vector2 m_vResolution;
+	bool m_bRecording;
+
+	std::vector<COMMAND> m_commands; // reused every frame
+	FRAME_STATS m_stats;
+
+	// current state, for telling changes apart from redundant calls
+	Color m_color;
+	std::vector<Rect> m_clipRectStack;
+	bool m_bClipping;
+	bool m_bBlending;
+	bool m_bDepthBuffer;
+	bool m_bCulling;
+	bool m_bAntialiasing;
+	bool m_bWireframe;
+	RenderTarget *m_renderTarget;
+};
+
+#endif
@@ -16,9 +16,10 @@
 
 ConVar osu_hiterrorbar_misses("osu_hiterrorbar_misses", true);
 
-OsuScore::OsuScore(Osu *osu)
+OsuScore::OsuScore(Osu *osu, bool headless)
 {
 	m_osu = osu;
+	m_bHeadless = headless;
 	reset();
 }
 
@@ -39,6 +40,84 @@ void OsuScore::reset()
 	m_iNum300gs = 0;
 	m_hitresults = std::vector<HIT>();
 	m_hitdeltas = std::vector<int>();
+	m_hitdeltaTimes = std::vector<long>();
+	m_timingAnalytics.clear();
+}
+
+OsuScore::SNAPSHOT OsuScore::getSnapshot() const
+{
+	SNAPSHOT snapshot;
+	snapshot.grade = m_grade;
+	snapshot.score = m_iScore;
+	snapshot.combo = m_iCombo;
+	snapshot.comboMax = m_iComboMax;
+	snapshot.accuracy = m_fAccuracy;
+	snapshot.unstableRate = m_fUnstableRate;
+	snapshot.numMisses = m_iNumMisses;
+	snapshot.numSliderBreaks = m_iNumSliderBreaks;
+	snapshot.num50s = m_iNum50s;
+	snapshot.num100s = m_iNum100s;
+	snapshot.num100ks = m_iNum100ks;
+	snapshot.num300s = m_iNum300s;
+	snapshot.num300gs = m_iNum300gs;
+	snapshot.numHitResults = m_hitresults.size();
+	snapshot.numHitDeltas = m_hitdeltas.size();
+	return snapshot;
+}
+
+void OsuScore::restore(const SNAPSHOT &snapshot)
+{
+	m_grade = snapshot.grade;
+	m_iScore = snapshot.score;
+	m_iCombo = snapshot.combo;
+	m_iComboMax = snapshot.comboMax;
+	m_fAccuracy = snapshot.accuracy;
+	m_fUnstableRate = snapshot.unstableRate;
+	m_iNumMisses = snapshot.numMisses;
+	m_iNumSliderBreaks = snapshot.numSliderBreaks;
+	m_iNum50s = snapshot.num50s;
+	m_iNum100s = snapshot.num100s;
+	m_iNum100ks = snapshot.num100ks;
+	m_iNum300s = snapshot.num300s;
+	m_iNum300gs = snapshot.num300gs;
+
+	// everything after the snapshot was appended later
+	if (snapshot.numHitResults < m_hitresults.size())
+		m_hitresults.resize(snapshot.numHitResults);
+	if (snapshot.numHitDeltas < m_hitdeltas.size())
+	{
+		m_hitdeltas.resize(snapshot.numHitDeltas);
+		m_hitdeltaTimes.resize(snapshot.numHitDeltas);
+
+		m_timingAnalytics.clear();
+		for (int i=0; i<m_hitdeltas.size(); i++)
+		{
+			m_timingAnalytics.addHit(m_hitdeltas[i], m_hitdeltaTimes[i]);
+		}
+	}
+}
+
+int OsuScore::getNumDifferences(const OsuScore &other) const
+{
+	int numDifferences = 0;
+
+	const SNAPSHOT a = getSnapshot();
+	const SNAPSHOT b = other.getSnapshot();
+	numDifferences += (a.grade != b.grade) + (a.score != b.score) + (a.combo != b.combo) + (a.comboMax != b.comboMax) + (a.accuracy != b.accuracy) + (a.unstableRate != b.unstableRate);
+	numDifferences += (a.numMisses != b.numMisses) + (a.numSliderBreaks != b.numSliderBreaks) + (a.num50s != b.num50s) + (a.num100s != b.num100s) + (a.num100ks != b.num100ks) + (a.num300s != b.num300s) + (a.num300gs != b.num300gs);
+
+	for (size_t i=0; i<std::max(m_hitresults.size(), other.m_hitresults.size()); i++)
+	{
+		if (i >= m_hitresults.size() || i >= other.m_hitresults.size() || m_hitresults[i] != other.m_hitresults[i])
+			numDifferences++;
+	}
+	for (size_t i=0; i<std::max(m_hitdeltas.size(), other.m_hitdeltas.size()); i++)
+	{
+		if (i >= m_hitdeltas.size() || i >= other.m_hitdeltas.size() || m_hitdeltas[i] != other.m_hitdeltas[i])
+			numDifferences++;
+	}
+
+	return numDifferences;
 }
 
 void OsuScore::addHitResult(OsuBeatmap *beatmap, HIT hit, long delta, bool ignoreOnHitErrorBar, bool hitErrorBarOnly, bool ignoreCombo, bool ignoreScore)
@@ -50,19 +129,26 @@ void OsuScore::addHitResult(OsuBeatmap *beatmap, HIT hit, long delta, bool ignor
 	{
 		if (!ignoreOnHitErrorBar)
 		{
+			if (m_hitdeltas.size() < 1) // the hit windows are only known here
+				m_timingAnalytics.reset(OsuGameRules::getHitWindow300(beatmap), OsuGameRules::getHitWindow100(beatmap), OsuGameRules::getHitWindow50(beatmap), beatmap->getStartTimePlayable(), beatmap->getStartTimePlayable() + beatmap->getLengthPlayable());
+
 			m_hitdeltas.push_back((int)delta);
-			m_osu->getHUD()->addHitError(delta);
+			m_hitdeltaTimes.push_back(beatmap->getCurMusicPos());
+			m_timingAnalytics.addHit(delta, beatmap->getCurMusicPos());
+			if (!m_bHeadless)
+				m_osu->getHUD()->addHitError(delta);
 		}
 
 		if (!ignoreCombo)
 		{
 			m_iCombo++;
-			m_osu->getHUD()->animateCombo();
+			if (!m_bHeadless)
+				m_osu->getHUD()->animateCombo();
 		}
 	}
 	else // misses
 	{
-		if (osu_hiterrorbar_misses.getBool() && !ignoreOnHitErrorBar && delta <= (long)OsuGameRules::getHitWindow50(beatmap))
+		if (osu_hiterrorbar_misses.getBool() && !ignoreOnHitErrorBar && delta <= (long)OsuGameRules::getHitWindow50(beatmap) && !m_bHeadless)
 			m_osu->getHUD()->addHitError(delta, true);
 
 		m_iCombo = 0;
@@ -129,26 +215,15 @@ void OsuScore::addHitResult(OsuBeatmap *beatmap, HIT hit, long delta, bool ignor
 	if ((percent300s > 0.8f && m_iNumMisses == 0) || (percent300s > 0.9f))
 		m_grade = OsuScore::GRADE::GRADE_A;
 	if (percent300s > 0.9f && percent50s <= 0.01f && m_iNumMisses == 0)
-		m_grade = m_osu->getModHD() /* || m_osu->getModFlashlight() */ ? OsuScore::GRADE::GRADE_SH : OsuScore::GRADE::GRADE_S;
+		m_grade = beatmap->getMods().has(OsuMods::HD) /* || beatmap->getMods().has(OsuMods::FL) */ ? OsuScore::GRADE::GRADE_SH : OsuScore::GRADE::GRADE_S;
 	if (m_iNumMisses == 0 && m_iNum50s == 0 && m_iNum100s == 0)
-		m_grade = m_osu->getModHD() /* || m_osu->getModFlashlight() */ ? OsuScore::GRADE::GRADE_XH : OsuScore::GRADE::GRADE_X;
+		m_grade = beatmap->getMods().has(OsuMods::HD) /* || beatmap->getMods().has(OsuMods::FL) */ ? OsuScore::GRADE::GRADE_XH : OsuScore::GRADE::GRADE_X;
 
 	// recalculate unstable rate
-	float averageDelta = 0.0f;
 	m_fUnstableRate = 0.0f;
 	if (m_hitdeltas.size() > 0)
 	{
-		for (int i=0; i<m_hitdeltas.size(); i++)
-		{
-			averageDelta += (float)m_hitdeltas[i];
-		}
-		averageDelta /= (float)m_hitdeltas.size();
-		for (int i=0; i<m_hitdeltas.size(); i++)
-		{
-			m_fUnstableRate += ((float)m_hitdeltas[i] - averageDelta)*((float)m_hitdeltas[i] - averageDelta);
-		}
-		m_fUnstableRate /= (float)m_hitdeltas.size();
-		m_fUnstableRate = std::sqrt(m_fUnstableRate)*10;
+		m_fUnstableRate = m_timingAnalytics.getStdDev()*10;
 
 		// compensate for speed
 		m_fUnstableRate /= beatmap->getSpeedMultiplier();
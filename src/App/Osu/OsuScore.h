@@ -10,6 +10,8 @@
 
 #include "cbase.h"
 
+#include "OsuTimingAnalytics.h"
+
 class Osu;
 class OsuBeatmap;
 
@@ -46,11 +48,34 @@ public:
 		GRADE_N
 	};
 
+	struct SNAPSHOT // for gameplay checkpoints, the hit results and deltas are append only, so only their sizes are stored
+	{
+		GRADE grade;
+		int score;
+		int combo;
+		int comboMax;
+		float accuracy;
+		float unstableRate;
+		int numMisses;
+		int numSliderBreaks;
+		int num50s;
+		int num100s;
+		int num100ks;
+		int num300s;
+		int num300gs;
+		size_t numHitResults;
+		size_t numHitDeltas;
+	};
+
 public:
-	OsuScore(Osu *osu);
+	OsuScore(Osu *osu, bool headless = false); // headless scores (e.g. for OsuBeatmap::beginSimulation()) don't animate the HUD
 
 	void reset(); // only OsuBeatmap may call this function!
 
+	SNAPSHOT getSnapshot() const;
+	void restore(const SNAPSHOT &snapshot); // only OsuBeatmap may call this function! (and only with snapshots taken since the last reset())
+	int getNumDifferences(const OsuScore &other) const; // for tests, number of differing counters + hit results + hit deltas
+
 	void addHitResult(OsuBeatmap *beatmap, HIT hit, long delta, bool ignoreOnHitErrorBar, bool hitErrorBarOnly, bool ignoreCombo, bool ignoreScore); // only OsuBeatmap may call this function!
 	void addSliderBreak(); // only OsuBeatmap may call this function!
 	void addPoints(int points);
@@ -69,11 +94,18 @@ public:
 	inline int getNum300s() {return m_iNum300s;}
 	inline int getNum300gs() {return m_iNum300gs;}
 
+	inline const OsuTimingAnalytics &getTimingAnalytics() const {return m_timingAnalytics;}
+	inline const std::vector<HIT> &getHitResults() const {return m_hitresults;}
+	inline const std::vector<int> &getHitDeltas() const {return m_hitdeltas;}
+
 private:
 	Osu *m_osu;
+	bool m_bHeadless;
 
 	std::vector<HIT> m_hitresults;
 	std::vector<int> m_hitdeltas;
+	std::vector<long> m_hitdeltaTimes; // music position of each hit delta, for rebuilding the timing analytics in restore()
+	OsuTimingAnalytics m_timingAnalytics;
 
 	GRADE m_grade;
 
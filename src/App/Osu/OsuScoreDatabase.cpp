@@ -0,0 +1,670 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		local scores (scores.db), append only, indexed by beatmap md5
+//
+// $NoKeywords: $osuscoredb
+//===============================================================================//
+
+#include "OsuScoreDatabase.h"
+
+#include "Engine.h"
+#include "ConVar.h"
+#include "Timer.h"
+
+#include "OsuFile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string.h>
+#include <stdio.h>
+
+ConVar osu_scores_db_compaction_ratio("osu_scores_db_compaction_ratio", 0.25f, "scores.db is rewritten as soon as the number of garbage records (deleted scores + tombstones) exceeds this fraction of the number of live scores");
+ConVar osu_scores_db_compaction_min_garbage("osu_scores_db_compaction_min_garbage", 64, "scores.db is never rewritten for fewer garbage records than this");
+
+static const char OSU_SCORE_DATABASE_MAGIC[4] = {'M', 'O', 'S', 'D'};
+static const uint32_t OSU_SCORE_DATABASE_VERSION = 1;
+static const size_t OSU_SCORE_DATABASE_HEADER_SIZE = 8;
+static const size_t OSU_SCORE_DATABASE_PAYLOAD_SIZE = 72;
+
+// little helpers for the record (de)serialization, the file is in native byte order just like osu!.db
+template <typename T>
+static inline void writeValue(unsigned char *&buffer, T value)
+{
+	memcpy(buffer, &value, sizeof(T));
+	buffer += sizeof(T);
+}
+
+template <typename T>
+static inline T readValue(const unsigned char *&buffer)
+{
+	T value;
+	memcpy(&value, buffer, sizeof(T));
+	buffer += sizeof(T);
+	return value;
+}
+
+static bool isSameScore(const OsuScoreDatabase::SCORE &a, const OsuScoreDatabase::SCORE &b)
+{
+	return memcmp(a.md5, b.md5, 16) == 0 && a.timestamp == b.timestamp && a.score == b.score && a.mods == b.mods;
+}
+
+struct OsuScoreDatabaseSortComparator
+{
+	bool operator() (const OsuScoreDatabase::SCORE &a, const OsuScoreDatabase::SCORE &b) const
+	{
+		// first condition: score (descending)
+		// second condition: if the score is the same, the older one goes first
+		return (a.score > b.score) || (a.score == b.score && a.timestamp < b.timestamp);
+	}
+};
+
+OsuScoreDatabase::MD5_KEY::MD5_KEY(const unsigned char md5[16])
+{
+	memcpy(&a, md5, 8);
+	memcpy(&b, md5 + 8, 8);
+}
+
+OsuScoreDatabase::OsuScoreDatabase(UString filePath)
+{
+	m_sFilePath = filePath;
+	m_iNumScores = 0;
+	m_iNumGarbageRecords = 0;
+	m_bWritable = false; // until load()
+}
+
+OsuScoreDatabase::~OsuScoreDatabase()
+{
+	// nothing to save, every change is already on disk
+}
+
+bool OsuScoreDatabase::load()
+{
+	m_scores.clear();
+	m_iNumScores = 0;
+	m_iNumGarbageRecords = 0;
+	m_bWritable = false;
+
+	std::vector<unsigned char> data;
+	{
+		std::ifstream in(m_sFilePath.toUtf8(), std::ios::in | std::ios::binary | std::ios::ate);
+		if (!in.good())
+		{
+			m_bWritable = true; // nothing there yet, the file is created with the first score
+			return true;
+		}
+
+		const std::streamoff fileSize = in.tellg();
+		if (fileSize > 0)
+		{
+			data.resize((size_t)fileSize);
+			in.seekg(0, std::ios::beg);
+			in.read((char*)&data[0], fileSize);
+			if (!in.good())
+			{
+				debugLog("OsuScoreDatabase: Couldn't read %s\n", m_sFilePath.toUtf8());
+				return false;
+			}
+		}
+	}
+
+	if (data.size() < 1)
+	{
+		m_bWritable = true;
+		return true;
+	}
+
+	// a broken header means that this isn't our file (or it has been destroyed completely), keep it around for manual recovery
+	if (data.size() < OSU_SCORE_DATABASE_HEADER_SIZE || memcmp(&data[0], OSU_SCORE_DATABASE_MAGIC, 4) != 0)
+	{
+		UString backupFilePath = m_sFilePath;
+		backupFilePath.append(".corrupt");
+		debugLog("OsuScoreDatabase: Invalid header in %s, moving it to %s\n", m_sFilePath.toUtf8(), backupFilePath.toUtf8());
+		std::remove(backupFilePath.toUtf8());
+		std::rename(m_sFilePath.toUtf8(), backupFilePath.toUtf8());
+		return false;
+	}
+
+	const unsigned char *header = &data[4];
+	const uint32_t version = readValue<uint32_t>(header);
+	if (version > OSU_SCORE_DATABASE_VERSION)
+	{
+		debugLog("OsuScoreDatabase: %s has version %u, but only version %u is supported\n", m_sFilePath.toUtf8(), version, OSU_SCORE_DATABASE_VERSION);
+		return false;
+	}
+	m_bWritable = true; // from here on the file is ours, everything after the first invalid record gets dropped anyway
+
+	size_t offset = OSU_SCORE_DATABASE_HEADER_SIZE;
+	while (offset < data.size())
+	{
+		RECORD_TYPE type;
+		SCORE score;
+		const size_t recordSize = readRecord(&data[offset], data.size() - offset, &type, &score);
+		if (recordSize == 0)
+			break;
+
+		offset += recordSize;
+
+		if (type == RECORD_SCORE)
+			insert(score);
+		else if (type == RECORD_DELETE)
+			m_iNumGarbageRecords += (remove(score) ? 2 : 1);
+	}
+
+	debugLog("OsuScoreDatabase: Loaded %i scores for %i beatmaps (%i garbage records).\n", m_iNumScores, (int)m_scores.size(), m_iNumGarbageRecords);
+
+	// crash recovery
+	if (offset < data.size())
+	{
+		debugLog("OsuScoreDatabase: Dropping %i bytes of truncated/invalid records at the end of %s\n", (int)(data.size() - offset), m_sFilePath.toUtf8());
+		return compact();
+	}
+
+	compactIfNecessary();
+
+	return true;
+}
+
+bool OsuScoreDatabase::compact()
+{
+	if (!m_bWritable)
+		return false;
+
+	UString tempFilePath = m_sFilePath;
+	tempFilePath.append(".tmp");
+
+	FILE *file = fopen(tempFilePath.toUtf8(), "wb");
+	if (file == NULL)
+	{
+		debugLog("OsuScoreDatabase: Couldn't open %s for writing\n", tempFilePath.toUtf8());
+		return false;
+	}
+
+	// batch records into bigger chunks, there can be millions of them
+	std::vector<unsigned char> buffer;
+	buffer.reserve(65536 + MAX_RECORD_SIZE);
+
+	buffer.resize(OSU_SCORE_DATABASE_HEADER_SIZE);
+	unsigned char *header = &buffer[0];
+	memcpy(header, OSU_SCORE_DATABASE_MAGIC, 4);
+	header += 4;
+	writeValue<uint32_t>(header, OSU_SCORE_DATABASE_VERSION);
+
+	bool success = true;
+	for (std::unordered_map<MD5_KEY, std::vector<SCORE>, MD5_KEY_HASH>::const_iterator it = m_scores.begin(); it != m_scores.end() && success; ++it)
+	{
+		for (int i=0; i<it->second.size(); i++)
+		{
+			const size_t bufferSize = buffer.size();
+			buffer.resize(bufferSize + MAX_RECORD_SIZE);
+			buffer.resize(bufferSize + writeRecord(&buffer[bufferSize], RECORD_SCORE, it->second[i]));
+
+			if (buffer.size() >= 65536)
+			{
+				success = (fwrite(&buffer[0], 1, buffer.size(), file) == buffer.size());
+				buffer.clear();
+				if (!success)
+					break;
+			}
+		}
+	}
+
+	if (success && buffer.size() > 0)
+		success = (fwrite(&buffer[0], 1, buffer.size(), file) == buffer.size());
+	if (success)
+		success = OsuFile::flushToDisk(file);
+
+	fclose(file);
+
+	if (!success)
+	{
+		debugLog("OsuScoreDatabase: Couldn't write %s\n", tempFilePath.toUtf8());
+		std::remove(tempFilePath.toUtf8());
+		return false;
+	}
+
+	if (!OsuFile::replaceFile(tempFilePath, m_sFilePath))
+		return false;
+
+	m_iNumGarbageRecords = 0;
+	return true;
+}
+
+bool OsuScoreDatabase::addScore(const SCORE &score)
+{
+	if (!appendRecord(RECORD_SCORE, score))
+		return false;
+
+	insert(score);
+	return true;
+}
+
+bool OsuScoreDatabase::deleteScore(const SCORE &score)
+{
+	if (!appendRecord(RECORD_DELETE, score))
+		return false;
+
+	m_iNumGarbageRecords += (remove(score) ? 2 : 1);
+	compactIfNecessary();
+	return true;
+}
+
+const std::vector<OsuScoreDatabase::SCORE> &OsuScoreDatabase::getScores(const unsigned char md5[16]) const
+{
+	static const std::vector<SCORE> noScores;
+
+	std::unordered_map<MD5_KEY, std::vector<SCORE>, MD5_KEY_HASH>::const_iterator it = m_scores.find(MD5_KEY(md5));
+	return (it != m_scores.end() ? it->second : noScores);
+}
+
+size_t OsuScoreDatabase::writeRecord(unsigned char *buffer, RECORD_TYPE type, const SCORE &score)
+{
+	unsigned char *start = buffer;
+
+	writeValue<uint16_t>(buffer, (uint16_t)type);
+	writeValue<uint16_t>(buffer, (uint16_t)OSU_SCORE_DATABASE_PAYLOAD_SIZE);
+
+	memcpy(buffer, score.md5, 16);
+	buffer += 16;
+	writeValue<uint32_t>(buffer, score.mods);
+	writeValue<int32_t>(buffer, score.num300s);
+	writeValue<int32_t>(buffer, score.num100s);
+	writeValue<int32_t>(buffer, score.num50s);
+	writeValue<int32_t>(buffer, score.numMisses);
+	writeValue<int32_t>(buffer, score.comboMax);
+	writeValue<uint64_t>(buffer, score.score);
+	writeValue<float>(buffer, score.accuracy);
+	writeValue<float>(buffer, score.unstableRate);
+	writeValue<uint64_t>(buffer, score.timestamp);
+	writeValue<int64_t>(buffer, score.replayOffset);
+
+	writeValue<uint32_t>(buffer, checksum(start, buffer - start));
+
+	return buffer - start;
+}
+
+size_t OsuScoreDatabase::readRecord(const unsigned char *buffer, size_t size, RECORD_TYPE *type, SCORE *score)
+{
+	const unsigned char *start = buffer;
+
+	if (size < 4)
+		return 0;
+
+	const uint16_t recordType = readValue<uint16_t>(buffer);
+	const uint16_t payloadSize = readValue<uint16_t>(buffer);
+	if ((recordType != RECORD_SCORE && recordType != RECORD_DELETE) || payloadSize != OSU_SCORE_DATABASE_PAYLOAD_SIZE || size < 4 + (size_t)payloadSize + 4)
+		return 0;
+
+	memcpy(score->md5, buffer, 16);
+	buffer += 16;
+	score->mods = readValue<uint32_t>(buffer);
+	score->num300s = readValue<int32_t>(buffer);
+	score->num100s = readValue<int32_t>(buffer);
+	score->num50s = readValue<int32_t>(buffer);
+	score->numMisses = readValue<int32_t>(buffer);
+	score->comboMax = readValue<int32_t>(buffer);
+	score->score = readValue<uint64_t>(buffer);
+	score->accuracy = readValue<float>(buffer);
+	score->unstableRate = readValue<float>(buffer);
+	score->timestamp = readValue<uint64_t>(buffer);
+	score->replayOffset = readValue<int64_t>(buffer);
+
+	const uint32_t expectedChecksum = checksum(start, buffer - start);
+	if (readValue<uint32_t>(buffer) != expectedChecksum)
+		return 0;
+
+	*type = (RECORD_TYPE)recordType;
+	return buffer - start;
+}
+
+uint32_t OsuScoreDatabase::checksum(const unsigned char *data, size_t size)
+{
+	// FNV-1a, only has to catch torn writes and garbage, not malice
+	uint32_t hash = 2166136261u;
+	for (size_t i=0; i<size; i++)
+	{
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+bool OsuScoreDatabase::appendRecord(RECORD_TYPE type, const SCORE &score)
+{
+	if (!m_bWritable)
+	{
+		debugLog("OsuScoreDatabase: Not writing to %s, it didn't load\n", m_sFilePath.toUtf8());
+		return false;
+	}
+
+	FILE *file = fopen(m_sFilePath.toUtf8(), "ab");
+	if (file == NULL)
+	{
+		debugLog("OsuScoreDatabase: Couldn't open %s for writing\n", m_sFilePath.toUtf8());
+		return false;
+	}
+
+	// header + record in one write, so that even the very first one can't be torn apart into two
+	unsigned char buffer[OSU_SCORE_DATABASE_HEADER_SIZE + MAX_RECORD_SIZE];
+	unsigned char *record = buffer;
+
+	fseek(file, 0, SEEK_END);
+	if (ftell(file) == 0)
+	{
+		memcpy(record, OSU_SCORE_DATABASE_MAGIC, 4);
+		record += 4;
+		writeValue<uint32_t>(record, OSU_SCORE_DATABASE_VERSION);
+	}
+	record += writeRecord(record, type, score);
+
+	const size_t size = record - buffer;
+	const bool success = (fwrite(buffer, 1, size, file) == size && OsuFile::flushToDisk(file));
+	fclose(file);
+
+	if (!success)
+		debugLog("OsuScoreDatabase: Couldn't write to %s\n", m_sFilePath.toUtf8());
+
+	return success;
+}
+
+void OsuScoreDatabase::insert(const SCORE &score)
+{
+	std::vector<SCORE> &scores = m_scores[MD5_KEY(score.md5)];
+	scores.insert(std::upper_bound(scores.begin(), scores.end(), score, OsuScoreDatabaseSortComparator()), score);
+	m_iNumScores++;
+}
+
+bool OsuScoreDatabase::remove(const SCORE &score)
+{
+	std::unordered_map<MD5_KEY, std::vector<SCORE>, MD5_KEY_HASH>::iterator it = m_scores.find(MD5_KEY(score.md5));
+	if (it == m_scores.end())
+		return false;
+
+	for (int i=0; i<it->second.size(); i++)
+	{
+		if (isSameScore(it->second[i], score))
+		{
+			it->second.erase(it->second.begin() + i);
+			if (it->second.size() < 1)
+				m_scores.erase(it);
+
+			m_iNumScores--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void OsuScoreDatabase::compactIfNecessary()
+{
+	if (m_iNumGarbageRecords >= osu_scores_db_compaction_min_garbage.getInt() && m_iNumGarbageRecords > (int)(m_iNumScores * osu_scores_db_compaction_ratio.getFloat()))
+	{
+		debugLog("OsuScoreDatabase: Compacting (%i scores, %i garbage records) ...\n", m_iNumScores, m_iNumGarbageRecords);
+		compact();
+	}
+}
+
+static OsuScoreDatabase::SCORE generateTestScore(unsigned int *seed, int numBeatmaps)
+{
+	// deterministic lcg, so that failures are reproducible
+	struct RNG
+	{
+		static unsigned int next(unsigned int *seed)
+		{
+			*seed = *seed * 1664525u + 1013904223u;
+			return *seed >> 8;
+		}
+	};
+
+	OsuScoreDatabase::SCORE score;
+	memset(score.md5, 0, 16);
+	const unsigned int beatmap = RNG::next(seed) % numBeatmaps;
+	memcpy(score.md5, &beatmap, sizeof(beatmap));
+	score.mods = RNG::next(seed) & 0xffff;
+	score.num300s = RNG::next(seed) % 2000;
+	score.num100s = RNG::next(seed) % 100;
+	score.num50s = RNG::next(seed) % 20;
+	score.numMisses = RNG::next(seed) % 10;
+	score.comboMax = RNG::next(seed) % 3000;
+	score.score = (unsigned long long)RNG::next(seed) * 7;
+	score.accuracy = (RNG::next(seed) % 10001) / 10000.0f;
+	score.unstableRate = (RNG::next(seed) % 30000) / 100.0f;
+	score.timestamp = 1500000000ull + RNG::next(seed);
+	score.replayOffset = (RNG::next(seed) % 2 == 0 ? -1 : (long long)RNG::next(seed));
+	return score;
+}
+
+void OsuScoreDatabase::test()
+{
+	int numTests = 0;
+	int numFailed = 0;
+
+	const UString testFilePathString = OsuFile::getTempFilePath("scores_test.db");
+	const char *testFilePath = testFilePathString.toUtf8();
+	std::remove(testFilePath);
+
+	const size_t recordSize = 4 + OSU_SCORE_DATABASE_PAYLOAD_SIZE + 4;
+	unsigned int seed = 1337;
+
+	// crash recovery: a torn record of every possible length at the end
+	for (size_t cut=1; cut<recordSize; cut++)
+	{
+		std::remove(testFilePath);
+
+		OsuScoreDatabase db(testFilePath);
+		db.load();
+		for (int i=0; i<3; i++)
+		{
+			db.addScore(generateTestScore(&seed, 2));
+		}
+
+		unsigned char record[MAX_RECORD_SIZE];
+		writeRecord(record, RECORD_SCORE, generateTestScore(&seed, 2));
+		FILE *file = fopen(testFilePath, "ab");
+		fwrite(record, 1, cut, file);
+		fclose(file);
+
+		OsuScoreDatabase recovered(testFilePath);
+		const bool loaded = recovered.load();
+
+		// the torn record must be gone from disk too, otherwise the next append would end up behind it
+		OsuScoreDatabase reloaded(testFilePath);
+		reloaded.load();
+		reloaded.addScore(generateTestScore(&seed, 2));
+		OsuScoreDatabase appended(testFilePath);
+		appended.load();
+
+		numTests++;
+		if (!loaded || recovered.getNumScores() != 3 || appended.getNumScores() != 4)
+		{
+			numFailed++;
+			debugLog("osu_scores_db_test: FAILED crash recovery with %i bytes of a torn record: loaded = %i, %i scores (expected 3), %i after append (expected 4)\n", (int)cut, (int)loaded, recovered.getNumScores(), appended.getNumScores());
+		}
+	}
+
+	// crash recovery: flipped bits in the last record
+	{
+		std::remove(testFilePath);
+
+		OsuScoreDatabase db(testFilePath);
+		db.load();
+		for (int i=0; i<5; i++)
+		{
+			db.addScore(generateTestScore(&seed, 2));
+		}
+
+		std::fstream file(testFilePath, std::ios::in | std::ios::out | std::ios::binary);
+		file.seekg(-10, std::ios::end);
+		const char c = (char)file.get();
+		file.seekp(-10, std::ios::end);
+		file.put((char)(c ^ 0x55));
+		file.close();
+
+		OsuScoreDatabase recovered(testFilePath);
+		recovered.load();
+
+		numTests++;
+		if (recovered.getNumScores() != 4)
+		{
+			numFailed++;
+			debugLog("osu_scores_db_test: FAILED corrupt last record: %i scores (expected 4)\n", recovered.getNumScores());
+		}
+	}
+
+	// compaction must not change anything but the garbage
+	{
+		std::remove(testFilePath);
+
+		OsuScoreDatabase db(testFilePath);
+		db.load();
+		std::vector<SCORE> added;
+		for (int i=0; i<200; i++)
+		{
+			added.push_back(generateTestScore(&seed, 5));
+			db.addScore(added.back());
+		}
+		for (int i=0; i<added.size(); i+=3)
+		{
+			db.deleteScore(added[i]);
+		}
+
+		const int numGarbageBeforeCompaction = db.getNumGarbageRecords();
+
+		OsuScoreDatabase uncompacted(testFilePath);
+		uncompacted.load();
+		db.compact();
+		OsuScoreDatabase compacted(testFilePath);
+		compacted.load();
+
+		std::ifstream in(testFilePath, std::ios::in | std::ios::binary | std::ios::ate);
+		const size_t fileSize = (size_t)in.tellg();
+
+		bool identical = (db.getNumScores() == 200 - 67 && compacted.getNumScores() == db.getNumScores() && uncompacted.getNumScores() == db.getNumScores() && compacted.getNumBeatmaps() == db.getNumBeatmaps());
+		for (unsigned int b=0; b<5 && identical; b++)
+		{
+			unsigned char md5[16];
+			memset(md5, 0, 16);
+			memcpy(md5, &b, sizeof(b));
+
+			const std::vector<SCORE> &expected = db.getScores(md5);
+			const std::vector<SCORE> &actual = compacted.getScores(md5);
+			identical = (expected.size() == actual.size());
+			for (int i=0; i<expected.size() && identical; i++)
+			{
+				identical = (memcmp(&expected[i], &actual[i], sizeof(SCORE)) == 0);
+				if (i > 0 && actual[i-1].score < actual[i].score)
+					identical = false; // must be sorted, best first
+			}
+		}
+
+		numTests++;
+		if (!identical || compacted.getNumGarbageRecords() != 0 || fileSize != OSU_SCORE_DATABASE_HEADER_SIZE + db.getNumScores()*recordSize)
+		{
+			numFailed++;
+			debugLog("osu_scores_db_test: FAILED compaction: %i/%i/%i scores, %i garbage records before compaction, %i after, file size = %i\n", db.getNumScores(), uncompacted.getNumScores(), compacted.getNumScores(), numGarbageBeforeCompaction, compacted.getNumGarbageRecords(), (int)fileSize);
+		}
+	}
+
+	// a file from a newer version is left alone: no appends, no compaction
+	{
+		std::remove(testFilePath);
+
+		unsigned char header[OSU_SCORE_DATABASE_HEADER_SIZE];
+		unsigned char *headerEnd = header;
+		memcpy(headerEnd, OSU_SCORE_DATABASE_MAGIC, 4);
+		headerEnd += 4;
+		writeValue<uint32_t>(headerEnd, OSU_SCORE_DATABASE_VERSION + 1);
+		unsigned char record[MAX_RECORD_SIZE];
+		const size_t newerRecordSize = writeRecord(record, RECORD_SCORE, generateTestScore(&seed, 2));
+		{
+			FILE *file = fopen(testFilePath, "wb");
+			fwrite(header, 1, sizeof(header), file);
+			fwrite(record, 1, newerRecordSize, file);
+			fclose(file);
+		}
+		const size_t expectedFileSize = sizeof(header) + newerRecordSize;
+
+		OsuScoreDatabase db(testFilePath);
+		const bool loaded = db.load();
+		const SCORE score = generateTestScore(&seed, 2);
+		const bool added = db.addScore(score);
+		const bool deleted = db.deleteScore(score);
+		const bool compacted = db.compact();
+
+		std::ifstream in(testFilePath, std::ios::in | std::ios::binary | std::ios::ate);
+		const size_t fileSize = (in.good() ? (size_t)in.tellg() : 0);
+
+		numTests++;
+		if (loaded || db.isWritable() || added || deleted || compacted || fileSize != expectedFileSize)
+		{
+			numFailed++;
+			debugLog("osu_scores_db_test: FAILED unsupported version: loaded = %i, added = %i, deleted = %i, compacted = %i, file size = %i (expected %i)\n", (int)loaded, (int)added, (int)deleted, (int)compacted, (int)fileSize, (int)expectedFileSize);
+		}
+	}
+
+	std::remove(testFilePath);
+	debugLog("osu_scores_db_test: %s, %i/%i passed\n", numFailed == 0 ? "PASSED" : "FAILED", numTests - numFailed, numTests);
+
+	// benchmark: 1M scores spread over 20k beatmaps
+	{
+		const int numScores = 1000000;
+		const int numBeatmaps = 20000;
+
+		OsuScoreDatabase db(testFilePath);
+		db.load();
+
+		Timer t;
+		t.start();
+		for (int i=0; i<numScores; i++)
+		{
+			db.insert(generateTestScore(&seed, numBeatmaps));
+		}
+		t.update();
+		const double insertTime = t.getElapsedTime();
+
+		t.start();
+		db.compact();
+		t.update();
+		const double compactTime = t.getElapsedTime();
+
+		OsuScoreDatabase loaded(testFilePath);
+		t.start();
+		loaded.load();
+		t.update();
+		const double loadTime = t.getElapsedTime();
+
+		// what the song browser does for every visible difficulty button
+		const int numLookups = 1000000;
+		unsigned long long checksum = 0;
+		t.start();
+		for (int i=0; i<numLookups; i++)
+		{
+			unsigned char md5[16];
+			memset(md5, 0, 16);
+			const unsigned int beatmap = i % numBeatmaps;
+			memcpy(md5, &beatmap, sizeof(beatmap));
+
+			const std::vector<SCORE> &scores = loaded.getScores(md5);
+			for (int s=0; s<std::min((int)scores.size(), 10); s++)
+			{
+				checksum += scores[s].score;
+			}
+		}
+		t.update();
+		const double lookupTime = t.getElapsedTime();
+
+		// and a single synced append, like at the end of a play
+		const int numAppends = 20;
+		t.start();
+		for (int i=0; i<numAppends; i++)
+		{
+			loaded.addScore(generateTestScore(&seed, numBeatmaps));
+		}
+		t.update();
+		const double appendTime = t.getElapsedTime();
+
+		debugLog("osu_scores_db_test: %i scores: insert = %f ms, compact/write = %f ms, load = %f ms, top 10 lookup = %f ns, synced append = %f ms (checksum = %llu)\n", loaded.getNumScores(), insertTime*1000.0, compactTime*1000.0, loadTime*1000.0, (lookupTime / numLookups)*1000000000.0, (appendTime / numAppends)*1000.0, checksum);
+	}
+
+	std::remove(testFilePath);
+}
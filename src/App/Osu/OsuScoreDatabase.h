@@ -0,0 +1,97 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		local scores (scores.db), append only, indexed by beatmap md5
+//
+// $NoKeywords: $osuscoredb
+//===============================================================================//
+
+#ifndef OSUSCOREDATABASE_H
+#define OSUSCOREDATABASE_H
+
+#include "cbase.h"
+
+#include <unordered_map>
+
+// file layout: header (magic + version), followed by nothing but records
+// record: type (uint16), payload size (uint16), payload, checksum (uint32, FNV-1a over type + size + payload)
+// every record is written in one go and synced before addScore()/deleteScore() return, a crash can therefore only ever leave a partial record at the very end
+// on load, everything after the first invalid record is dropped and the file is compacted, so that new records are never appended behind garbage
+class OsuScoreDatabase
+{
+public:
+	struct SCORE
+	{
+		unsigned char md5[16]; // of the beatmap difficulty
+		unsigned int mods; // OsuMods::MOD bitmask
+		int num300s;
+		int num100s;
+		int num50s;
+		int numMisses;
+		int comboMax;
+		unsigned long long score;
+		float accuracy; // [0, 1]
+		float unstableRate;
+		unsigned long long timestamp; // unix time, in seconds
+		long long replayOffset; // -1 if there is no replay
+	};
+
+public:
+	OsuScoreDatabase(UString filePath);
+	~OsuScoreDatabase();
+
+	bool load(); // replaces everything in memory, recovers from truncated/corrupt tail records
+	bool compact(); // rewrites the file with only the live scores (temp file + rename)
+
+	// all of these refuse to write unless load() succeeded, so that a file which we couldn't read (or is from a newer version) is never appended to or replaced
+	bool addScore(const SCORE &score);
+	bool deleteScore(const SCORE &score); // appends a tombstone, the score itself is removed on the next compaction
+	inline bool isWritable() const {return m_bWritable;}
+
+	const std::vector<SCORE> &getScores(const unsigned char md5[16]) const; // sorted by score, best first, empty if there are none
+	inline int getNumScores() const {return m_iNumScores;}
+	inline int getNumBeatmaps() const {return m_scores.size();}
+	inline int getNumGarbageRecords() const {return m_iNumGarbageRecords;}
+
+	static void test(); // crash recovery, compaction, newer versions, 1M score benchmark (osu_scores_db_test)
+
+private:
+	enum RECORD_TYPE
+	{
+		RECORD_SCORE = 1,
+		RECORD_DELETE = 2
+	};
+
+	static size_t writeRecord(unsigned char *buffer, RECORD_TYPE type, const SCORE &score); // returns the number of bytes written (buffer must be at least MAX_RECORD_SIZE)
+	static size_t readRecord(const unsigned char *buffer, size_t size, RECORD_TYPE *type, SCORE *score); // returns the size of the record, or 0 if it is truncated/invalid
+	static uint32_t checksum(const unsigned char *data, size_t size);
+
+	bool appendRecord(RECORD_TYPE type, const SCORE &score);
+	void insert(const SCORE &score);
+	bool remove(const SCORE &score);
+	void compactIfNecessary();
+
+	static const size_t MAX_RECORD_SIZE = 128;
+
+	struct MD5_KEY
+	{
+		MD5_KEY(const unsigned char md5[16]);
+		bool operator == (const MD5_KEY &other) const {return (a == other.a && b == other.b);}
+
+		uint64_t a;
+		uint64_t b;
+	};
+
+	struct MD5_KEY_HASH
+	{
+		size_t operator() (const MD5_KEY &key) const {return (size_t)(key.a ^ (key.b * 0x9e3779b97f4a7c15ull));} // md5 is already well distributed
+	};
+
+	UString m_sFilePath;
+
+	std::unordered_map<MD5_KEY, std::vector<SCORE>, MD5_KEY_HASH> m_scores;
+	int m_iNumScores;
+	int m_iNumGarbageRecords; // tombstones and the scores they delete, only removed by compaction
+	bool m_bWritable;
+};
+
+#endif
@@ -0,0 +1,143 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		deterministic (and deliberately imperfect) input for headless beatmap simulations
+//
+// $NoKeywords: $osusimplayer
+//===============================================================================//
+
+#include "OsuSimulatedPlayer.h"
+
+#include "OsuBeatmap.h"
+#include "OsuBeatmapDifficulty.h"
+
+#include "OsuHitObject.h"
+
+#include <algorithm>
+
+OsuSimulatedPlayer::OsuSimulatedPlayer(OsuBeatmap *beatmap, OsuBeatmapDifficulty *diff)
+{
+	m_beatmap = beatmap;
+	m_iLastEndTime = 0;
+	m_iTarget = 0;
+	m_iLastPos = 0;
+
+	// same order as OsuHitObjectFactory
+	for (int i=0; i<diff->hitcircles.size(); i++)
+	{
+		OBJECT object;
+		object.time = (long)diff->hitcircles[i].time;
+		object.duration = 0;
+		object.rawPos = Vector2(diff->hitcircles[i].x, diff->hitcircles[i].y);
+		object.spinner = false;
+		m_objects.push_back(object);
+	}
+	for (int i=0; i<diff->sliders.size(); i++)
+	{
+		OBJECT object;
+		object.time = diff->sliders[i].time;
+		object.duration = (long)diff->sliders[i].sliderTime;
+		object.rawPos = (diff->sliders[i].points.size() > 0 ? diff->sliders[i].points[0] : Vector2(0,0));
+		object.spinner = false;
+		m_objects.push_back(object);
+	}
+	for (int i=0; i<diff->spinners.size(); i++)
+	{
+		OBJECT object;
+		object.time = (long)diff->spinners[i].time;
+		object.duration = (long)diff->spinners[i].endTime - (long)diff->spinners[i].time;
+		object.rawPos = Vector2(diff->spinners[i].x, diff->spinners[i].y);
+		object.spinner = true;
+		m_objects.push_back(object);
+	}
+
+	struct ObjectSortComparator
+	{
+	    bool operator() (OBJECT const &a, OBJECT const &b) const
+	    {
+	        return a.time < b.time;
+	    }
+	};
+	std::stable_sort(m_objects.begin(), m_objects.end(), ObjectSortComparator());
+
+	// every 11th object is never clicked, every 13th one is very late, the rest is spread over +-36 ms
+	// every 17th slider is released halfway through, circles are tapped for 40 ms
+	for (int i=0; i<m_objects.size(); i++)
+	{
+		OBJECT &object = m_objects[i];
+
+		object.key = i % 2;
+		if (i % 11 == 5)
+			object.pressTime = -1;
+		else if (i % 13 == 7)
+			object.pressTime = object.time + 110;
+		else
+			object.pressTime = object.time + ((i*37) % 7 - 3)*12;
+
+		if (object.duration > 0 && !object.spinner && i % 17 == 3)
+			object.releaseTime = object.pressTime + object.duration/2;
+		else
+			object.releaseTime = std::max(object.pressTime + 40, object.time + object.duration + 20);
+
+		m_iLastEndTime = std::max(m_iLastEndTime, object.time + object.duration);
+	}
+}
+
+void OsuSimulatedPlayer::update(long curPos, float frameTime)
+{
+	if (curPos < m_iLastPos)
+		m_iTarget = 0;
+	m_iLastPos = curPos;
+	m_iTarget = findTarget(m_iTarget, curPos);
+
+	// the cursor sits on the target (follows slider balls, circles around spinners)
+	// if the target hasn't been created yet (lazy instantiation), then it can't be judged yet either, so its unstacked position is good enough
+	Vector2 cursorPos;
+	if (m_iTarget < m_objects.size())
+	{
+		const OBJECT &object = m_objects[m_iTarget];
+		const std::vector<OsuHitObject*> &hitobjects = m_beatmap->getHitObjects();
+		if (object.spinner)
+			cursorPos = m_beatmap->osuCoords2Pixels(object.rawPos) + Vector2(std::cos(curPos*0.03f), std::sin(curPos*0.03f))*100.0f;
+		else if (m_iTarget < hitobjects.size())
+			cursorPos = m_beatmap->osuCoords2Pixels(hitobjects[m_iTarget]->getRawPosAt(curPos));
+		else
+			cursorPos = m_beatmap->osuCoords2Pixels(object.rawPos);
+	}
+
+	bool keys[2];
+	getKeys(m_iTarget, curPos, keys);
+
+	m_beatmap->simulate(curPos, frameTime, cursorPos, keys[0], keys[1]);
+}
+
+void OsuSimulatedPlayer::getKeys(long curPos, bool *key1, bool *key2) const
+{
+	bool keys[2];
+	getKeys(findTarget(0, curPos), curPos, keys);
+	*key1 = keys[0];
+	*key2 = keys[1];
+}
+
+int OsuSimulatedPlayer::findTarget(int start, long curPos) const
+{
+	// the end times are not sorted, but the search always stops at the first object which is not over yet, so starting at 0 gives the same result as advancing frame by frame
+	int target = start;
+	while (target < m_objects.size() && m_objects[target].time + m_objects[target].duration + 50 <= curPos)
+	{
+		target++;
+	}
+	return target;
+}
+
+void OsuSimulatedPlayer::getKeys(int target, long curPos, bool *keys) const
+{
+	// objects overlap (sliders, streams), so every key is checked against all objects around the target
+	keys[0] = false;
+	keys[1] = false;
+	for (int i=std::max(target - 4, 0); i<m_objects.size() && m_objects[i].time <= curPos + 200; i++)
+	{
+		const OBJECT &object = m_objects[i];
+		if (object.pressTime >= 0 && curPos >= object.pressTime && curPos < object.releaseTime)
+			keys[object.key] = true;
+	}
+}
@@ -0,0 +1,51 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		deterministic (and deliberately imperfect) input for headless beatmap simulations
+//
+// $NoKeywords: $osusimplayer
+//===============================================================================//
+
+#ifndef OSUSIMULATEDPLAYER_H
+#define OSUSIMULATEDPLAYER_H
+
+#include "cbase.h"
+
+class OsuBeatmap;
+class OsuBeatmapDifficulty;
+
+// plays a diff which is being simulated by OsuBeatmap::beginSimulation(), with early/late hits, missed objects and released sliders
+// the input only depends on the raw objects of the diff and on curPos, so two simulations (or a simulation which jumps backwards) get the exact same input for the same frames
+class OsuSimulatedPlayer
+{
+public:
+	OsuSimulatedPlayer(OsuBeatmap *beatmap, OsuBeatmapDifficulty *diff);
+
+	void update(long curPos, float frameTime); // computes the input for this frame and calls OsuBeatmap::simulate() with it
+	void getKeys(long curPos, bool *key1, bool *key2) const; // the keys which update() holds at curPos
+
+	inline long getLastEndTime() const {return m_iLastEndTime;}
+
+private:
+	int findTarget(int start, long curPos) const;
+	void getKeys(int target, long curPos, bool *keys) const;
+
+	struct OBJECT
+	{
+		long time;
+		long duration;
+		Vector2 rawPos; // unstacked
+		long pressTime; // -1 if never pressed
+		long releaseTime;
+		int key;
+		bool spinner;
+	};
+
+	OsuBeatmap *m_beatmap;
+	std::vector<OBJECT> m_objects; // sorted by time, in the same order as the hitobjects of the beatmap
+	long m_iLastEndTime;
+
+	int m_iTarget; // first object which is not over yet
+	long m_iLastPos;
+};
+
+#endif
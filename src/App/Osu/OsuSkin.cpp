@@ -12,12 +12,10 @@
 #include "ResourceManager.h"
 #include "SoundEngine.h"
 #include "ConVar.h"
-#include "File.h"
-
-#include <string.h>
 
 #include "Osu.h"
 #include "OsuNotificationOverlay.h"
+#include "OsuProfiler.h"
 
 #define OSUSKIN_DEFAULT_SKIN_PATH "default/"
 
@@ -204,13 +202,6 @@ OsuSkin::OsuSkin(Osu *osu, UString filepath)
 	m_checkOff = NULL;
 	m_shutter = NULL;
 
-	m_spinnerApproachCircleColor = 0xffffffff;
-	m_sliderBorderColor = 0xffffffff;
-	m_sliderBallColor = 0xff02aaff;
-
-	m_songSelectActiveText = 0xff000000;
-	m_songSelectInactiveText = 0xffffffff;
-
 	// scaling
 	m_bCursor2x = false;
 	m_bApproachCircle2x = false;
@@ -260,19 +251,7 @@ OsuSkin::OsuSkin(Osu *osu, UString filepath)
 	m_bRankingX2x = false;
 	m_bRankingXH2x = false;
 
-	// skin.ini
-	m_fVersion = 1;
-	m_bCursorCenter = true;
-	m_bCursorRotate = true;
-	m_bCursorExpand = true;
-
-	m_bSliderBallFlip = true;
-	m_bAllowSliderBallTint = false;
-	m_iSliderStyle = 2;
-	m_bHitCircleOverlayAboveNumber = true;
-	m_bSliderTrackOverride = false;
-
-	m_iHitCircleOverlap = 0;
+	// skin.ini (m_config starts out with the defaults)
 
 	// custom
 	m_iSampleSet = 1;
@@ -299,6 +278,8 @@ OsuSkin::~OsuSkin()
 
 void OsuSkin::load()
 {
+	OSU_PROFILER_ZONE("OsuSkin::load");
+
 	// skin ini
 	UString skinIniFilePath = m_sFilePath;
 	UString defaultSkinIniFilePath = UString("./materials/");
@@ -314,12 +295,12 @@ void OsuSkin::load()
 	}
 
 	// default values, if none were loaded
-	if (m_comboColors.size() == 0)
+	if (m_config.comboColors.size() == 0)
 	{
-		m_comboColors.push_back(COLOR(255, 255, 192, 0));
-		m_comboColors.push_back(COLOR(255, 0, 202, 0));
-		m_comboColors.push_back(COLOR(255, 18, 124, 255));
-		m_comboColors.push_back(COLOR(255, 242, 24, 57));
+		m_config.comboColors.push_back(COLOR(255, 255, 192, 0));
+		m_config.comboColors.push_back(COLOR(255, 0, 202, 0));
+		m_config.comboColors.push_back(COLOR(255, 18, 124, 255));
+		m_config.comboColors.push_back(COLOR(255, 242, 24, 57));
 	}
 
 	// images
@@ -607,8 +588,10 @@ void OsuSkin::load()
 		m_defaultButtonRight = defaultButtonRight2;
 
 	// print some debug info
-	debugLog("OsuSkin: Version %f\n", m_fVersion);
-	debugLog("OsuSkin: HitCircleOverlap = %i\n", m_iHitCircleOverlap);
+	debugLog("OsuSkin: Version %f\n", m_config.version);
+	debugLog("OsuSkin: HitCircleOverlap = %i\n", m_config.hitCircleOverlap);
+	if (m_config.numUnknownKeys > 0)
+		debugLog("OsuSkin: Skipped %i unknown/malformed skin.ini entries\n", m_config.numUnknownKeys);
 
 	// delayed error notifications due to resource loading potentially blocking engine time
 	if (!parseSkinIni1Status && parseSkinIni2Status && m_osu_skin_ref->getString() != "default")
@@ -625,102 +608,15 @@ void OsuSkin::loadBeatmapOverride(UString filepath)
 
 bool OsuSkin::parseSkinINI(UString filepath)
 {
-	File file(filepath);
-	if (!file.canRead())
+	bool wasCached = false;
+	if (!OsuSkinIni::load(filepath, &m_config, &wasCached))
 	{
 		debugLog("OsuSkin Error: Couldn't load %s\n", filepath.toUtf8());
 		return false;
 	}
 
-	int curBlock = -1;
-	while (file.canRead())
-	{
-		UString uCurLine = file.readLine();
-		const char *curLineChar = uCurLine.toUtf8();
-		std::string curLine(curLineChar);
-
-		if (curLine.find("//") == std::string::npos) // ignore comments
-		{
-			if (curLine.find("[General]") != std::string::npos)
-				curBlock = 0;
-			else if (curLine.find("[Colours]") != std::string::npos || curLine.find("[Colors]") != std::string::npos)
-				curBlock = 1;
-			else if (curLine.find("[Fonts]") != std::string::npos)
-				curBlock = 2;
-
-			switch (curBlock)
-			{
-			case 0: // General
-				{
-					int val;
-					char stringBuffer[1024];
-
-					memset(stringBuffer, '\0', 1024);
-					if (sscanf(curLineChar, " Version : %1023[^\n]", stringBuffer) == 1)
-					{
-						UString versionString = UString(stringBuffer);
-						if (versionString.find("latest") != -1 || versionString.find("User") != -1)
-							m_fVersion = 2.0f;
-						else
-							m_fVersion = versionString.toFloat();
-					}
-
-					if (sscanf(curLineChar, " CursorRotate : %i \n", &val) == 1)
-						m_bCursorRotate = val > 0 ? true : false;
-					if (sscanf(curLineChar, " CursorCentre : %i \n", &val) == 1)
-						m_bCursorCenter = val > 0 ? true : false;
-					if (sscanf(curLineChar, " CursorExpand : %i \n", &val) == 1)
-						m_bCursorExpand = val > 0 ? true : false;
-					if (sscanf(curLineChar, " SliderBallFlip : %i \n", &val) == 1)
-						m_bSliderBallFlip = val > 0 ? true : false;
-					if (sscanf(curLineChar, " AllowSliderBallTint : %i \n", &val) == 1)
-						m_bAllowSliderBallTint = val > 0 ? true : false;
-					if (sscanf(curLineChar, " HitCircleOverlayAboveNumber : %i \n", &val) == 1)
-						m_bHitCircleOverlayAboveNumber = val > 0 ? true : false;
-					if (sscanf(curLineChar, " HitCircleOverlayAboveNumer : %i \n", &val) == 1)
-						m_bHitCircleOverlayAboveNumber = val > 0 ? true : false;
-					if (sscanf(curLineChar, " SliderStyle : %i \n", &val) == 1)
-					{
-						m_iSliderStyle = val;
-						if (m_iSliderStyle != 1 && m_iSliderStyle != 2)
-							m_iSliderStyle = 2;
-					}
-				}
-				break;
-			case 1: // Colors
-				{
-					int comboNum;
-					int r,g,b;
-					if (sscanf(curLineChar, " Combo %i : %i , %i , %i \n", &comboNum, &r, &g, &b) == 4)
-						m_comboColors.push_back(COLOR(255, r, g, b));
-					if (sscanf(curLineChar, " SpinnerApproachCircle : %i , %i , %i \n", &r, &g, &b) == 3)
-						m_spinnerApproachCircleColor = COLOR(255, r, g, b);
-					if (sscanf(curLineChar, " SliderBorder: %i , %i , %i \n", &r, &g, &b) == 3)
-						m_sliderBorderColor = COLOR(255, r, g, b);
-					if (sscanf(curLineChar, " SliderTrackOverride : %i , %i , %i \n", &r, &g, &b) == 3)
-					{
-						m_sliderTrackOverride = COLOR(255, r, g, b);
-						m_bSliderTrackOverride = true;
-					}
-					if (sscanf(curLineChar, " SliderBall : %i , %i , %i \n", &r, &g, &b) == 3)
-						m_sliderBallColor = COLOR(255, r, g, b);
-					if (sscanf(curLineChar, " SongSelectActiveText : %i , %i , %i \n", &r, &g, &b) == 3)
-						m_songSelectActiveText = COLOR(255, r, g, b);
-					if (sscanf(curLineChar, " SongSelectInactiveText : %i , %i , %i \n", &r, &g, &b) == 3)
-						m_songSelectInactiveText = COLOR(255, r, g, b);
-				}
-				break;
-			case 2: // Fonts
-				{
-					int val;
-
-					if (sscanf(curLineChar, " HitCircleOverlap : %i \n", &val) == 1)
-						m_iHitCircleOverlap = val;
-				}
-				break;
-			}
-		}
-	}
+	if (wasCached)
+		debugLog("OsuSkin: Using cached %s\n", filepath.toUtf8());
 
 	return true;
 }
@@ -766,8 +662,8 @@ Color OsuSkin::getComboColorForCounter(int i)
 	i += osu_skin_color_index_add.getInt();
 	if (m_beatmapComboColors.size() > 0 && !osu_ignore_beatmap_combo_colors.getBool())
 		return m_beatmapComboColors[i % m_beatmapComboColors.size()];
-	else if (m_comboColors.size() > 0)
-		return m_comboColors[i % m_comboColors.size()];
+	else if (m_config.comboColors.size() > 0)
+		return m_config.comboColors[i % m_config.comboColors.size()];
 	else
 		return COLOR(255, 0, 255, 0);
 }
@@ -777,62 +673,71 @@ void OsuSkin::setBeatmapComboColors(std::vector<Color> colors)
 	m_beatmapComboColors = colors;
 }
 
-void OsuSkin::playHitCircleSound(int sampleType)
+void OsuSkin::playHitCircleSound(int sampleType, float pan)
 {
 	if (m_iSampleVolume <= 0)
 		return;
 
-	switch (m_iSampleSet)
+	std::vector<Sound*> sounds;
+	getHitCircleSounds(sampleType, &sounds);
+	for (int i=0; i<sounds.size(); i++)
 	{
-	case 3:
-		engine->getSound()->play(m_drumHitNormal);
-
-		if (sampleType & OSU_BITMASK_HITWHISTLE)
-			engine->getSound()->play(m_drumHitWhistle);
-		if (sampleType & OSU_BITMASK_HITFINISH)
-			engine->getSound()->play(m_drumHitFinish);
-		if (sampleType & OSU_BITMASK_HITCLAP)
-			engine->getSound()->play(m_drumHitClap);
-		break;
-	case 2:
-		engine->getSound()->play(m_softHitNormal);
-
-		if (sampleType & OSU_BITMASK_HITWHISTLE)
-			engine->getSound()->play(m_softHitWhistle);
-		if (sampleType & OSU_BITMASK_HITFINISH)
-			engine->getSound()->play(m_softHitFinish);
-		if (sampleType & OSU_BITMASK_HITCLAP)
-			engine->getSound()->play(m_softHitClap);
-		break;
-	default:
-		engine->getSound()->play(m_normalHitNormal);
-
-		if (sampleType & OSU_BITMASK_HITWHISTLE)
-			engine->getSound()->play(m_normalHitWhistle);
-		if (sampleType & OSU_BITMASK_HITFINISH)
-			engine->getSound()->play(m_normalHitFinish);
-		if (sampleType & OSU_BITMASK_HITCLAP)
-			engine->getSound()->play(m_normalHitClap);
-		break;
+		engine->getSound()->play(sounds[i]);
 	}
 }
 
-void OsuSkin::playSliderTickSound()
+void OsuSkin::playSliderTickSound(float pan)
 {
 	if (m_iSampleVolume <= 0)
 		return;
 
+	Sound *sound = getSliderTickSound();
+	if (sound != NULL)
+		engine->getSound()->play(sound);
+}
+
+void OsuSkin::getHitCircleSounds(int sampleType, std::vector<Sound*> *sounds)
+{
+	Sound *normal = m_normalHitNormal;
+	Sound *whistle = m_normalHitWhistle;
+	Sound *finish = m_normalHitFinish;
+	Sound *clap = m_normalHitClap;
 	switch (m_iSampleSet)
 	{
 	case 3:
-		engine->getSound()->play(m_drumSliderTick);
+		normal = m_drumHitNormal;
+		whistle = m_drumHitWhistle;
+		finish = m_drumHitFinish;
+		clap = m_drumHitClap;
 		break;
 	case 2:
-		engine->getSound()->play(m_softSliderTick);
+		normal = m_softHitNormal;
+		whistle = m_softHitWhistle;
+		finish = m_softHitFinish;
+		clap = m_softHitClap;
 		break;
+	}
+
+	if (normal != NULL)
+		sounds->push_back(normal);
+	if ((sampleType & OSU_BITMASK_HITWHISTLE) && whistle != NULL)
+		sounds->push_back(whistle);
+	if ((sampleType & OSU_BITMASK_HITFINISH) && finish != NULL)
+		sounds->push_back(finish);
+	if ((sampleType & OSU_BITMASK_HITCLAP) && clap != NULL)
+		sounds->push_back(clap);
+}
+
+Sound *OsuSkin::getSliderTickSound()
+{
+	switch (m_iSampleSet)
+	{
+	case 3:
+		return m_drumSliderTick;
+	case 2:
+		return m_softSliderTick;
 	default:
-		engine->getSound()->play(m_normalSliderTick);
-		break;
+		return m_normalSliderTick;
 	}
 }
 
@@ -10,6 +10,8 @@
 
 #include "cbase.h"
 
+#include "OsuSkinIni.h"
+
 class Image;
 class Sound;
 class Resource;
@@ -30,8 +32,12 @@ public:
 	void setSampleSet(int sampleSet);
 	void setSampleVolume(float volume);
 
-	void playHitCircleSound(int sampleType);
-	void playSliderTickSound();
+	void playHitCircleSound(int sampleType, float pan = 0.0f); // pan: -1 (left) to 1 (right), see OsuGameRules::getHitSoundPan()
+	void playSliderTickSound(float pan = 0.0f);
+
+	void getHitCircleSounds(int sampleType, std::vector<Sound*> *sounds); // what playHitCircleSound() plays, for the OsuHitSoundScheduler
+	Sound *getSliderTickSound();
+	inline int getSampleVolume() const {return m_iSampleVolume;} // 0 - 100
 
 	// raw
 	inline Image *getMissingTexture() {return m_missingTexture;}
@@ -223,28 +229,33 @@ public:
 	inline bool isRankingXH2x() {return m_bRankingXH2x;}
 
 	// skin.ini
-	inline float getVersion() {return m_fVersion;}
+	inline float getVersion() {return m_config.version;}
 	Color getComboColorForCounter(int i);
 	void setBeatmapComboColors(std::vector<Color> colors);
-	inline Color getSpinnerApproachCircleColor() {return m_spinnerApproachCircleColor;}
-	inline Color getSliderBorderColor() {return m_sliderBorderColor;}
-	inline Color getSliderTrackOverride() {return m_sliderTrackOverride;}
-	inline Color getSliderBallColor() {return m_sliderBallColor;}
-
-	inline Color getSongSelectActiveText() {return m_songSelectActiveText;}
-	inline Color getSongSelectInactiveText() {return m_songSelectInactiveText;}
-
-	inline bool getCursorCenter() {return m_bCursorCenter;}
-	inline bool getCursorRotate() {return m_bCursorRotate;}
-	inline bool getCursorExpand() {return m_bCursorExpand;}
-
-	inline bool getSliderBallFlip() {return m_bSliderBallFlip;}
-	inline bool getAllowSliderBallTint() {return m_bAllowSliderBallTint;}
-	inline int getSliderStyle() {return m_iSliderStyle;}
-	inline bool getHitCircleOverlayAboveNumber() {return m_bHitCircleOverlayAboveNumber;}
-	inline bool isSliderTrackOverridden() {return m_bSliderTrackOverride;}
-
-	inline int getHitCircleOverlap() {return m_iHitCircleOverlap;}
+	inline Color getSpinnerApproachCircleColor() {return m_config.spinnerApproachCircle;}
+	inline Color getSliderBorderColor() {return m_config.sliderBorder;}
+	inline Color getSliderTrackOverride() {return m_config.sliderTrackOverride;}
+	inline Color getSliderBallColor() {return m_config.sliderBall;}
+
+	inline Color getSongSelectActiveText() {return m_config.songSelectActiveText;}
+	inline Color getSongSelectInactiveText() {return m_config.songSelectInactiveText;}
+
+	inline bool getCursorCenter() {return m_config.cursorCentre;}
+	inline bool getCursorRotate() {return m_config.cursorRotate;}
+	inline bool getCursorExpand() {return m_config.cursorExpand;}
+
+	inline bool getSliderBallFlip() {return m_config.sliderBallFlip;}
+	inline bool getAllowSliderBallTint() {return m_config.allowSliderBallTint;}
+	inline int getSliderStyle() {return m_config.sliderStyle;}
+	inline bool getHitCircleOverlayAboveNumber() {return m_config.hitCircleOverlayAboveNumber;}
+	inline bool isSliderTrackOverridden() {return m_config.hasSliderTrackOverride;}
+
+	inline UString getHitCirclePrefix() {return UString(m_config.hitCirclePrefix.c_str());}
+	inline int getHitCircleOverlap() {return m_config.hitCircleOverlap;}
+	inline UString getScorePrefix() {return UString(m_config.scorePrefix.c_str());}
+	inline int getScoreOverlap() {return m_config.scoreOverlap;}
+	inline UString getComboPrefix() {return UString(m_config.comboPrefix.c_str());}
+	inline int getComboOverlap() {return m_config.comboOverlap;}
 
 private:
 	bool parseSkinINI(UString filepath);
@@ -417,15 +428,7 @@ private:
 	Sound *m_checkOff;
 	Sound *m_shutter;
 
-	std::vector<Color> m_comboColors;
 	std::vector<Color> m_beatmapComboColors;
-	Color m_spinnerApproachCircleColor;
-	Color m_sliderBorderColor;
-	Color m_sliderTrackOverride;
-	Color m_sliderBallColor;
-
-	Color m_songSelectInactiveText;
-	Color m_songSelectActiveText;
 
 
 	// scaling
@@ -478,18 +481,7 @@ private:
 	bool m_bRankingXH2x;
 
 	// skin.ini
-	float m_fVersion;
-	bool m_bCursorCenter;
-	bool m_bCursorRotate;
-	bool m_bCursorExpand;
-
-	bool m_bSliderBallFlip;
-	bool m_bAllowSliderBallTint;
-	int m_iSliderStyle;
-	bool m_bHitCircleOverlayAboveNumber;
-	bool m_bSliderTrackOverride;
-
-	int m_iHitCircleOverlap;
+	OsuSkinIni::CONFIG m_config;
 
 	// custom
 	int m_iSampleSet;
@@ -0,0 +1,777 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		skin.ini tokenizer/parser + per skin parse cache
+//
+// $NoKeywords: $osuskini
+//===============================================================================//
+
+#include "OsuSkinIni.h"
+
+#include "Engine.h"
+#include "ConVar.h"
+#include "File.h"
+#include "Timer.h"
+
+#include <unordered_map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32) || defined(_WIN64) || defined(__WIN32__) || defined(__CYGWIN__) || defined(__CYGWIN32__) || defined(__TOS_WIN__) || defined(__WINDOWS__)
+
+#define OSU_STAT_STRUCT struct _stat64
+#define OSU_STAT(path, buf) _stat64(path, buf)
+#define OSU_STAT_MTIME_NS(buf) ((long long)(buf).st_mtime*1000000000LL)
+
+#else
+
+#define OSU_STAT_STRUCT struct stat
+#define OSU_STAT(path, buf) stat(path, buf)
+
+#ifdef __linux__
+#define OSU_STAT_MTIME_NS(buf) ((long long)(buf).st_mtim.tv_sec*1000000000LL + (long long)(buf).st_mtim.tv_nsec)
+#else
+#define OSU_STAT_MTIME_NS(buf) ((long long)(buf).st_mtime*1000000000LL)
+#endif
+
+#endif
+
+ConVar osu_skin_ini_cache("osu_skin_ini_cache", true, "remember parsed skin.ini files (per path, reparsed if the mtime or size changes), so that switching between skins doesn't parse them again");
+
+static const int OSU_SKININI_MAX_COMBO_COLORS = 8;
+
+struct OsuSkinIniCacheEntry
+{
+	long long mtime;
+	long long size;
+	OsuSkinIni::CONFIG config;
+};
+
+static std::unordered_map<std::string, OsuSkinIniCacheEntry> g_skinIniCache;
+
+OsuSkinIni::CONFIG::CONFIG()
+{
+	version = 1.0f;
+	cursorCentre = true;
+	cursorRotate = true;
+	cursorExpand = true;
+	sliderBallFlip = true;
+	allowSliderBallTint = false;
+	sliderStyle = 2;
+	hitCircleOverlayAboveNumber = true;
+
+	spinnerApproachCircle = 0xffffffff;
+	sliderBorder = 0xffffffff;
+	sliderTrackOverride = 0xffffffff;
+	hasSliderTrackOverride = false;
+	sliderBall = 0xff02aaff;
+	songSelectActiveText = 0xff000000;
+	songSelectInactiveText = 0xffffffff;
+
+	hitCirclePrefix = "default";
+	hitCircleOverlap = 0;
+	scorePrefix = "score";
+	scoreOverlap = 0;
+	comboPrefix = "score";
+	comboOverlap = 0;
+
+	numUnknownKeys = 0;
+}
+
+static inline bool skinIniIsSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\v' || c == '\f';
+}
+
+static bool skinIniEquals(const std::string &a, const char *b)
+{
+	const size_t length = strlen(b);
+	if (a.length() != length)
+		return false;
+
+	for (size_t i=0; i<length; i++)
+	{
+		if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i]))
+			return false;
+	}
+	return true;
+}
+
+static bool skinIniParseInt(const std::string &value, int *result)
+{
+	const char *begin = value.c_str();
+	char *end = NULL;
+	const long val = strtol(begin, &end, 10);
+	if (end == begin)
+		return false;
+
+	*result = (int)val;
+	return true;
+}
+
+// "1"/"0", also "true"/"false"
+static bool skinIniParseBool(const std::string &value, bool *result)
+{
+	int val;
+	if (skinIniParseInt(value, &val))
+		*result = (val > 0);
+	else if (skinIniEquals(value, "true") || skinIniEquals(value, "yes"))
+		*result = true;
+	else if (skinIniEquals(value, "false") || skinIniEquals(value, "no"))
+		*result = false;
+	else
+		return false;
+
+	return true;
+}
+
+// "r,g,b" or "r,g,b,a" (alpha is ignored), whitespace and trailing commas are fine, components are clamped to [0, 255]
+static bool skinIniParseColor(const std::string &value, Color *result)
+{
+	int components[3];
+	int numComponents = 0;
+	const char *c = value.c_str();
+	while (*c != '\0' && numComponents < 3)
+	{
+		while (skinIniIsSpace(*c) || *c == ',')
+		{
+			c++;
+		}
+		if (*c == '\0')
+			break;
+
+		char *end = NULL;
+		const long val = strtol(c, &end, 10);
+		if (end == c)
+			return false;
+
+		components[numComponents++] = clamp<int>((int)val, 0, 255);
+		c = end;
+		while (skinIniIsSpace(*c))
+		{
+			c++;
+		}
+		if (*c != ',' && *c != '\0')
+			return false;
+	}
+
+	if (numComponents < 3)
+		return false;
+
+	*result = COLOR(255, components[0], components[1], components[2]);
+	return true;
+}
+
+static std::string skinIniPath(const std::string &value)
+{
+	std::string path = value;
+	for (size_t i=0; i<path.length(); i++)
+	{
+		if (path[i] == '\\')
+			path[i] = '/';
+	}
+	return path;
+}
+
+void OsuSkinIni::tokenize(const char *data, size_t size, std::vector<TOKEN> *tokens)
+{
+	size_t pos = 0;
+
+	// utf8 bom
+	if (size >= 3 && (unsigned char)data[0] == 0xEF && (unsigned char)data[1] == 0xBB && (unsigned char)data[2] == 0xBF)
+		pos = 3;
+
+	std::string section;
+	int line = 0;
+	while (pos < size)
+	{
+		line++;
+
+		// \r\n, \n or \r
+		size_t lineStart = pos;
+		size_t lineEnd = pos;
+		while (lineEnd < size && data[lineEnd] != '\n' && data[lineEnd] != '\r')
+		{
+			lineEnd++;
+		}
+		pos = lineEnd;
+		if (pos < size && data[pos] == '\r')
+			pos++;
+		if (pos < size && data[pos] == '\n' && (pos == lineEnd || data[pos-1] == '\r'))
+			pos++;
+
+		// comments, either the whole line or after whitespace (so that "http://" survives)
+		for (size_t i=lineStart; i+1<lineEnd; i++)
+		{
+			if (data[i] == '/' && data[i+1] == '/' && (i == lineStart || skinIniIsSpace(data[i-1])))
+			{
+				lineEnd = i;
+				break;
+			}
+		}
+
+		while (lineStart < lineEnd && skinIniIsSpace(data[lineStart]))
+		{
+			lineStart++;
+		}
+		while (lineEnd > lineStart && skinIniIsSpace(data[lineEnd-1]))
+		{
+			lineEnd--;
+		}
+		if (lineStart == lineEnd)
+			continue;
+
+		// [section], a missing ']' is tolerated
+		if (data[lineStart] == '[')
+		{
+			size_t sectionEnd = lineStart + 1;
+			while (sectionEnd < lineEnd && data[sectionEnd] != ']')
+			{
+				sectionEnd++;
+			}
+
+			size_t sectionStart = lineStart + 1;
+			while (sectionStart < sectionEnd && skinIniIsSpace(data[sectionStart]))
+			{
+				sectionStart++;
+			}
+			while (sectionEnd > sectionStart && skinIniIsSpace(data[sectionEnd-1]))
+			{
+				sectionEnd--;
+			}
+			section.assign(data + sectionStart, sectionEnd - sectionStart);
+			continue;
+		}
+
+		// key: value, lines without ':' are skipped
+		const char *colon = (const char*)memchr(data + lineStart, ':', lineEnd - lineStart);
+		if (colon == NULL)
+			continue;
+
+		size_t keyEnd = colon - data;
+		while (keyEnd > lineStart && skinIniIsSpace(data[keyEnd-1]))
+		{
+			keyEnd--;
+		}
+		size_t valueStart = colon - data + 1;
+		while (valueStart < lineEnd && skinIniIsSpace(data[valueStart]))
+		{
+			valueStart++;
+		}
+		if (keyEnd == lineStart)
+			continue;
+
+		TOKEN token;
+		token.line = line;
+		token.section = section;
+		token.key.assign(data + lineStart, keyEnd - lineStart);
+		token.value.assign(data + valueStart, lineEnd - valueStart);
+		tokens->push_back(token);
+	}
+}
+
+static bool skinIniApplyGeneral(const OsuSkinIni::TOKEN &token, OsuSkinIni::CONFIG *config)
+{
+	const std::string &key = token.key;
+	const std::string &value = token.value;
+
+	if (skinIniEquals(key, "Name"))
+		config->name = value;
+	else if (skinIniEquals(key, "Author"))
+		config->author = value;
+	else if (skinIniEquals(key, "Version"))
+	{
+		if (value.find("latest") != std::string::npos || value.find("User") != std::string::npos)
+			config->version = 2.0f;
+		else
+		{
+			char *end = NULL;
+			const float version = (float)strtod(value.c_str(), &end);
+			if (end == value.c_str())
+				return false;
+			config->version = version;
+		}
+	}
+	else if (skinIniEquals(key, "CursorCentre"))
+		return skinIniParseBool(value, &config->cursorCentre);
+	else if (skinIniEquals(key, "CursorRotate"))
+		return skinIniParseBool(value, &config->cursorRotate);
+	else if (skinIniEquals(key, "CursorExpand"))
+		return skinIniParseBool(value, &config->cursorExpand);
+	else if (skinIniEquals(key, "SliderBallFlip"))
+		return skinIniParseBool(value, &config->sliderBallFlip);
+	else if (skinIniEquals(key, "AllowSliderBallTint"))
+		return skinIniParseBool(value, &config->allowSliderBallTint);
+	else if (skinIniEquals(key, "HitCircleOverlayAboveNumber") || skinIniEquals(key, "HitCircleOverlayAboveNumer")) // the typo is what osu! used to write
+		return skinIniParseBool(value, &config->hitCircleOverlayAboveNumber);
+	else if (skinIniEquals(key, "SliderStyle"))
+	{
+		int sliderStyle;
+		if (!skinIniParseInt(value, &sliderStyle))
+			return false;
+		config->sliderStyle = (sliderStyle == 1 || sliderStyle == 2 ? sliderStyle : 2);
+	}
+	else
+		return false;
+
+	return true;
+}
+
+static bool skinIniApplyColours(const OsuSkinIni::TOKEN &token, OsuSkinIni::CONFIG *config, bool *hasComboColors, Color *comboColors)
+{
+	const std::string &key = token.key;
+	const std::string &value = token.value;
+
+	// Combo1 to Combo8
+	if (key.length() > 5 && skinIniEquals(key.substr(0, 5), "Combo"))
+	{
+		int comboNum;
+		if (!skinIniParseInt(key.substr(5), &comboNum) || comboNum < 1 || comboNum > OSU_SKININI_MAX_COMBO_COLORS)
+			return false;
+		if (!skinIniParseColor(value, &comboColors[comboNum-1]))
+			return false;
+		hasComboColors[comboNum-1] = true;
+	}
+	else if (skinIniEquals(key, "SpinnerApproachCircle"))
+		return skinIniParseColor(value, &config->spinnerApproachCircle);
+	else if (skinIniEquals(key, "SliderBorder"))
+		return skinIniParseColor(value, &config->sliderBorder);
+	else if (skinIniEquals(key, "SliderTrackOverride"))
+	{
+		if (!skinIniParseColor(value, &config->sliderTrackOverride))
+			return false;
+		config->hasSliderTrackOverride = true;
+	}
+	else if (skinIniEquals(key, "SliderBall"))
+		return skinIniParseColor(value, &config->sliderBall);
+	else if (skinIniEquals(key, "SongSelectActiveText"))
+		return skinIniParseColor(value, &config->songSelectActiveText);
+	else if (skinIniEquals(key, "SongSelectInactiveText"))
+		return skinIniParseColor(value, &config->songSelectInactiveText);
+	else
+		return false;
+
+	return true;
+}
+
+static bool skinIniApplyFonts(const OsuSkinIni::TOKEN &token, OsuSkinIni::CONFIG *config)
+{
+	const std::string &key = token.key;
+	const std::string &value = token.value;
+
+	if (skinIniEquals(key, "HitCirclePrefix"))
+		config->hitCirclePrefix = skinIniPath(value);
+	else if (skinIniEquals(key, "HitCircleOverlap"))
+		return skinIniParseInt(value, &config->hitCircleOverlap);
+	else if (skinIniEquals(key, "ScorePrefix"))
+		config->scorePrefix = skinIniPath(value);
+	else if (skinIniEquals(key, "ScoreOverlap"))
+		return skinIniParseInt(value, &config->scoreOverlap);
+	else if (skinIniEquals(key, "ComboPrefix"))
+		config->comboPrefix = skinIniPath(value);
+	else if (skinIniEquals(key, "ComboOverlap"))
+		return skinIniParseInt(value, &config->comboOverlap);
+	else
+		return false;
+
+	return true;
+}
+
+void OsuSkinIni::parse(const char *data, size_t size, CONFIG *config)
+{
+	std::vector<TOKEN> tokens;
+	tokenize(data, size, &tokens);
+
+	bool hasComboColors[OSU_SKININI_MAX_COMBO_COLORS];
+	Color comboColors[OSU_SKININI_MAX_COMBO_COLORS];
+	for (int i=0; i<OSU_SKININI_MAX_COMBO_COLORS; i++)
+	{
+		hasComboColors[i] = false;
+	}
+
+	for (int i=0; i<tokens.size(); i++)
+	{
+		const TOKEN &token = tokens[i];
+
+		bool known = false;
+		if (skinIniEquals(token.section, "General"))
+			known = skinIniApplyGeneral(token, config);
+		else if (skinIniEquals(token.section, "Colours") || skinIniEquals(token.section, "Colors"))
+			known = skinIniApplyColours(token, config, hasComboColors, comboColors);
+		else if (skinIniEquals(token.section, "Fonts"))
+			known = skinIniApplyFonts(token, config);
+		else
+			continue; // [Mania] etc.
+
+		if (!known)
+			config->numUnknownKeys++;
+	}
+
+	// gaps (e.g. only Combo1 and Combo3) are skipped
+	std::vector<Color> orderedComboColors;
+	for (int i=0; i<OSU_SKININI_MAX_COMBO_COLORS; i++)
+	{
+		if (hasComboColors[i])
+			orderedComboColors.push_back(comboColors[i]);
+	}
+	if (orderedComboColors.size() > 0)
+		config->comboColors.swap(orderedComboColors);
+}
+
+bool OsuSkinIni::load(UString filePath, CONFIG *config, bool *wasCached)
+{
+	if (wasCached != NULL)
+		*wasCached = false;
+
+	OSU_STAT_STRUCT fileStat;
+	if (OSU_STAT(filePath.toUtf8(), &fileStat) != 0)
+		return false;
+
+	const std::string key = filePath.toUtf8();
+	const long long mtime = OSU_STAT_MTIME_NS(fileStat);
+	const long long size = (long long)fileStat.st_size;
+	if (osu_skin_ini_cache.getBool())
+	{
+		std::unordered_map<std::string, OsuSkinIniCacheEntry>::const_iterator it = g_skinIniCache.find(key);
+		if (it != g_skinIniCache.end() && it->second.mtime == mtime && it->second.size == size)
+		{
+			*config = it->second.config;
+			if (wasCached != NULL)
+				*wasCached = true;
+			return true;
+		}
+	}
+
+	File file(filePath);
+	if (!file.canRead())
+		return false;
+
+	const size_t fileSize = file.getFileSize();
+	const char *fileBuffer = file.readFile();
+
+	CONFIG parsed;
+	if (fileBuffer != NULL)
+		parse(fileBuffer, fileSize, &parsed);
+
+	if (osu_skin_ini_cache.getBool())
+	{
+		OsuSkinIniCacheEntry &entry = g_skinIniCache[key];
+		entry.mtime = mtime;
+		entry.size = size;
+		entry.config = parsed;
+	}
+
+	*config = parsed;
+	return true;
+}
+
+void OsuSkinIni::clearCache()
+{
+	g_skinIniCache.clear();
+}
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+static void skinIniTestParse(const std::string &data, OsuSkinIni::CONFIG *config)
+{
+	*config = OsuSkinIni::CONFIG();
+	OsuSkinIni::parse(data.c_str(), data.length(), config);
+}
+
+static bool skinIniTestWrite(const char *filePath, const std::string &data)
+{
+	FILE *file = fopen(filePath, "wb");
+	if (file == NULL)
+		return false;
+
+	const bool ok = (fwrite(data.c_str(), 1, data.length(), file) == data.length());
+	fclose(file);
+	return ok;
+}
+
+// what OsuSkin::parseSkinINI() used to do: every line against every sscanf pattern of its section
+static int skinIniTestLegacyParse(const std::string &data)
+{
+	int numMatches = 0;
+	int curBlock = -1;
+	size_t lineStart = 0;
+	while (lineStart < data.length())
+	{
+		size_t lineEnd = data.find('\n', lineStart);
+		if (lineEnd == std::string::npos)
+			lineEnd = data.length();
+		const std::string curLine = data.substr(lineStart, lineEnd - lineStart);
+		const char *curLineChar = curLine.c_str();
+		lineStart = lineEnd + 1;
+
+		if (curLine.find("//") != std::string::npos)
+			continue;
+
+		if (curLine.find("[General]") != std::string::npos)
+			curBlock = 0;
+		else if (curLine.find("[Colours]") != std::string::npos || curLine.find("[Colors]") != std::string::npos)
+			curBlock = 1;
+		else if (curLine.find("[Fonts]") != std::string::npos)
+			curBlock = 2;
+
+		int val, comboNum, r, g, b;
+		char stringBuffer[1024];
+		if (curBlock == 0)
+		{
+			const char *patterns[] = {" CursorRotate : %i \n", " CursorCentre : %i \n", " CursorExpand : %i \n", " SliderBallFlip : %i \n", " AllowSliderBallTint : %i \n", " HitCircleOverlayAboveNumber : %i \n", " HitCircleOverlayAboveNumer : %i \n", " SliderStyle : %i \n"};
+			numMatches += (sscanf(curLineChar, " Version : %1023[^\n]", stringBuffer) == 1);
+			for (int p=0; p<8; p++)
+			{
+				numMatches += (sscanf(curLineChar, patterns[p], &val) == 1);
+			}
+		}
+		else if (curBlock == 1)
+		{
+			const char *patterns[] = {" SpinnerApproachCircle : %i , %i , %i \n", " SliderBorder: %i , %i , %i \n", " SliderTrackOverride : %i , %i , %i \n", " SliderBall : %i , %i , %i \n", " SongSelectActiveText : %i , %i , %i \n", " SongSelectInactiveText : %i , %i , %i \n"};
+			numMatches += (sscanf(curLineChar, " Combo %i : %i , %i , %i \n", &comboNum, &r, &g, &b) == 4);
+			for (int p=0; p<6; p++)
+			{
+				numMatches += (sscanf(curLineChar, patterns[p], &r, &g, &b) == 3);
+			}
+		}
+		else if (curBlock == 2)
+			numMatches += (sscanf(curLineChar, " HitCircleOverlap : %i \n", &val) == 1);
+	}
+	return numMatches;
+}
+
+void OsuSkinIni::test()
+{
+	int numTests = 0;
+	int numFailed = 0;
+
+	// a typical skin.ini: bom, \r\n, comments, a section we don't care about
+	const std::string typical = std::string("\xEF\xBB\xBF") +
+		"// This is a comment\r\n"
+		"[General]\r\n"
+		"Name: Test Skin\r\n"
+		"Author: someone // http://example.com\r\n"
+		"Version: 2.5\r\n"
+		"CursorRotate: 0\r\n"
+		"CursorExpand: 1\r\n"
+		"CursorCentre: 0\r\n"
+		"SliderBallFlip: 0\r\n"
+		"AllowSliderBallTint: 1\r\n"
+		"HitCircleOverlayAboveNumber: 0\r\n"
+		"SliderStyle: 1\r\n"
+		"\r\n"
+		"[Colours]\r\n"
+		"Combo1: 255,192,0\r\n"
+		"Combo2: 0,202,0\r\n"
+		"Combo3: 18,124,255\r\n"
+		"Combo4: 242,24,57\r\n"
+		"SliderBorder: 255,255,255\r\n"
+		"SliderTrackOverride: 10,20,30\r\n"
+		"SpinnerApproachCircle: 77,139,217\r\n"
+		"SongSelectActiveText: 1,2,3\r\n"
+		"SongSelectInactiveText: 4,5,6\r\n"
+		"\r\n"
+		"[Fonts]\r\n"
+		"HitCirclePrefix: fonts\\default\r\n"
+		"HitCircleOverlap: 3\r\n"
+		"ScorePrefix: fonts/score\r\n"
+		"ScoreOverlap: -2\r\n"
+		"ComboPrefix: fonts/combo\r\n"
+		"ComboOverlap: 5\r\n"
+		"\r\n"
+		"[Mania]\r\n"
+		"Keys: 4\r\n"
+		"ColumnWidth: 40,40,40,40\r\n";
+	{
+		CONFIG config;
+		skinIniTestParse(typical, &config);
+
+		numTests++;
+		if (config.name != "Test Skin" || config.author != "someone" || config.version != 2.5f
+			|| config.cursorRotate || !config.cursorExpand || config.cursorCentre || config.sliderBallFlip || !config.allowSliderBallTint || config.hitCircleOverlayAboveNumber || config.sliderStyle != 1
+			|| config.comboColors.size() != 4 || config.comboColors[0] != COLOR(255, 255, 192, 0) || config.comboColors[3] != COLOR(255, 242, 24, 57)
+			|| config.sliderBorder != COLOR(255, 255, 255, 255) || !config.hasSliderTrackOverride || config.sliderTrackOverride != COLOR(255, 10, 20, 30) || config.spinnerApproachCircle != COLOR(255, 77, 139, 217)
+			|| config.songSelectActiveText != COLOR(255, 1, 2, 3) || config.songSelectInactiveText != COLOR(255, 4, 5, 6) || config.sliderBall != CONFIG().sliderBall
+			|| config.hitCirclePrefix != "fonts/default" || config.hitCircleOverlap != 3 || config.scorePrefix != "fonts/score" || config.scoreOverlap != -2 || config.comboPrefix != "fonts/combo" || config.comboOverlap != 5
+			|| config.numUnknownKeys != 0)
+		{
+			numFailed++;
+			debugLog("osu_skin_ini_test: FAILED typical (version %f, %i combo colors, prefix %s, %i unknown keys)\n", config.version, (int)config.comboColors.size(), config.hitCirclePrefix.c_str(), config.numUnknownKeys);
+		}
+	}
+
+	// mixed line endings, whitespace everywhere, lowercase, trailing commas, out of order/duplicate combo colors, values containing ':'
+	{
+		const std::string quirky =
+			"  [ general ]  \n"
+			"name:Re:Zero skin\r"
+			"\tversion   :   latest\r\n"
+			"cursorrotate :1\n"
+			"SliderStyle: 3\n"
+			"[Colours\r\n"
+			"Combo3 : 3, 3, 3,\n"
+			"  Combo1:1,1,1 ,  \r"
+			"Combo1: 11,11,11\n"
+			"Combo5: 300,-5,128\n"
+			"SliderBall: 9 ,8 , 7, 255\n"
+			"[Fonts]\r\n"
+			"HitCircleOverlap:\t-2";
+
+		CONFIG config;
+		skinIniTestParse(quirky, &config);
+
+		std::vector<TOKEN> tokens;
+		tokenize(quirky.c_str(), quirky.length(), &tokens);
+
+		numTests++;
+		if (config.name != "Re:Zero skin" || config.version != 2.0f || !config.cursorRotate || config.sliderStyle != 2
+			|| config.comboColors.size() != 3 || config.comboColors[0] != COLOR(255, 11, 11, 11) || config.comboColors[1] != COLOR(255, 3, 3, 3) || config.comboColors[2] != COLOR(255, 255, 0, 128)
+			|| config.sliderBall != COLOR(255, 9, 8, 7) || config.hitCircleOverlap != -2 || config.numUnknownKeys != 0
+			|| tokens.size() != 10 || tokens[0].line != 2 || tokens[2].line != 4 || tokens[4].section != "Colours" || tokens[9].line != 13 || tokens[9].value != "-2")
+		{
+			numFailed++;
+			debugLog("osu_skin_ini_test: FAILED quirky (name \"%s\", version %f, %i combo colors, overlap %i, %i tokens, %i unknown keys)\n", config.name.c_str(), config.version, (int)config.comboColors.size(), config.hitCircleOverlap, (int)tokens.size(), config.numUnknownKeys);
+		}
+	}
+
+	// garbage: malformed values are skipped (and counted), keys outside of their section are ignored, nothing crashes
+	{
+		const std::string garbage =
+			"CursorRotate: 0\n"
+			"[General]\n"
+			"CursorCentre: maybe\n"
+			"SliderStyle:\n"
+			"Version: abc\n"
+			"no colon here\n"
+			": no key\n"
+			"SomethingNew: 1\n"
+			"HitCircleOverlap: 7\n"
+			"[Colours]\n"
+			"Combo1: 1,2\n"
+			"Combo9: 1,2,3\n"
+			"Combo0: 1,2,3\n"
+			"Combo2: a,b,c\n"
+			"SliderBorder: 1;2;3\n"
+			"[]\n"
+			"Combo1: 1,2,3\n";
+
+		CONFIG config;
+		skinIniTestParse(garbage, &config);
+
+		numTests++;
+		if (!config.cursorRotate || !config.cursorCentre || config.sliderStyle != 2 || config.version != 1.0f || config.hitCircleOverlap != 0
+			|| config.comboColors.size() != 0 || config.sliderBorder != CONFIG().sliderBorder || config.numUnknownKeys != 10)
+		{
+			numFailed++;
+			debugLog("osu_skin_ini_test: FAILED garbage (%i combo colors, %i unknown keys)\n", (int)config.comboColors.size(), config.numUnknownKeys);
+		}
+	}
+
+	// empty files, only a bom, colors from an earlier parse are kept if the file has none
+	{
+		CONFIG empty;
+		parse("", 0, &empty);
+		CONFIG bom;
+		parse("\xEF\xBB\xBF", 3, &bom);
+		CONFIG keep;
+		keep.comboColors.push_back(COLOR(255, 1, 2, 3));
+		const std::string noColors = "[General]\nVersion: 1\n";
+		parse(noColors.c_str(), noColors.length(), &keep);
+
+		numTests++;
+		if (empty.version != 1.0f || empty.comboColors.size() != 0 || bom.numUnknownKeys != 0 || keep.comboColors.size() != 1)
+		{
+			numFailed++;
+			debugLog("osu_skin_ini_test: FAILED empty\n");
+		}
+	}
+
+	// cache: same file = cached, changed file = parsed again, unreadable file = false
+	{
+		clearCache();
+		const char *filePath = "skin_ini_test.ini";
+		skinIniTestWrite(filePath, "[General]\nVersion: 2.1\n");
+
+		CONFIG first;
+		bool firstCached = true;
+		const bool firstLoaded = load(filePath, &first, &firstCached);
+
+		CONFIG second;
+		bool secondCached = false;
+		const bool secondLoaded = load(filePath, &second, &secondCached);
+
+		skinIniTestWrite(filePath, "[General]\nVersion: 2.22\n"); // different size, in case the mtime didn't change
+		CONFIG third;
+		bool thirdCached = true;
+		const bool thirdLoaded = load(filePath, &third, &thirdCached);
+
+		remove(filePath);
+		CONFIG missing;
+		missing.version = 123.0f;
+		const bool missingLoaded = load(filePath, &missing);
+
+		numTests++;
+		if (!firstLoaded || firstCached || first.version != 2.1f || !secondLoaded || !secondCached || second.version != 2.1f || !thirdLoaded || thirdCached || third.version != 2.22f || missingLoaded || missing.version != 123.0f)
+		{
+			numFailed++;
+			debugLog("osu_skin_ini_test: FAILED cache (%i %i, %i %i, %i %i, %i)\n", (int)firstLoaded, (int)firstCached, (int)secondLoaded, (int)secondCached, (int)thirdLoaded, (int)thirdCached, (int)missingLoaded);
+		}
+		clearCache();
+	}
+
+	// benchmark
+	{
+		const int numParses = 20000;
+		Timer t;
+
+		int checksum = 0;
+		t.start();
+		for (int i=0; i<numParses; i++)
+		{
+			CONFIG config;
+			parse(typical.c_str(), typical.length(), &config);
+			checksum += config.comboColors.size();
+		}
+		t.update();
+		const double parseTime = t.getElapsedTime();
+
+		// same content without the bom and \r, which the old parser didn't handle
+		std::string legacy = typical.substr(3);
+		for (size_t pos = legacy.find('\r'); pos != std::string::npos; pos = legacy.find('\r', pos))
+		{
+			legacy.erase(pos, 1);
+		}
+		t.start();
+		for (int i=0; i<numParses; i++)
+		{
+			checksum += skinIniTestLegacyParse(legacy);
+		}
+		t.update();
+		const double legacyTime = t.getElapsedTime();
+
+		const char *filePath = "skin_ini_test.ini";
+		skinIniTestWrite(filePath, typical);
+		const int numLoads = 2000;
+		t.start();
+		for (int i=0; i<numLoads; i++)
+		{
+			CONFIG config;
+			load(filePath, &config);
+			checksum += config.comboColors.size();
+		}
+		t.update();
+		const double cachedLoadTime = t.getElapsedTime();
+		remove(filePath);
+		clearCache();
+
+		debugLog("osu_skin_ini_test: parse %f us, previous sscanf parser %f us, cached load %f us (%i bytes, checksum %i)\n", parseTime*1000000.0 / numParses, legacyTime*1000000.0 / numParses, cachedLoadTime*1000000.0 / numLoads, (int)typical.length(), checksum);
+	}
+
+	debugLog("osu_skin_ini_test: %s, %i/%i passed\n", numFailed == 0 ? "PASSED" : "FAILED", numTests - numFailed, numTests);
+}
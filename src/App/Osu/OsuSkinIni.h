@@ -0,0 +1,77 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		skin.ini tokenizer/parser + per skin parse cache
+//
+// $NoKeywords: $osuskini
+//===============================================================================//
+
+#ifndef OSUSKININI_H
+#define OSUSKININI_H
+
+#include "cbase.h"
+
+// skin.ini is split into (section, key, value) tokens first, which is where all of osu!'s real world quirks are dealt with:
+// utf8 bom, \r\n/\n/\r line endings (mixed), "//" comments (whole line, or after whitespace), whitespace around ':', case insensitive sections/keys
+// the tokens are then applied to a CONFIG (which starts out with the defaults), unknown sections/keys and malformed values are skipped
+class OsuSkinIni
+{
+public:
+	struct TOKEN
+	{
+		int line; // 1 based
+		std::string section; // without the brackets, empty before the first section
+		std::string key;
+		std::string value; // everything after the first ':', trimmed
+	};
+
+	struct CONFIG
+	{
+		CONFIG(); // osu! defaults
+
+		// [General]
+		std::string name;
+		std::string author;
+		float version; // 2.0 for "latest"/"User"
+		bool cursorCentre;
+		bool cursorRotate;
+		bool cursorExpand;
+		bool sliderBallFlip;
+		bool allowSliderBallTint;
+		int sliderStyle; // 1 or 2
+		bool hitCircleOverlayAboveNumber;
+
+		// [Colours]
+		std::vector<Color> comboColors; // Combo1 to Combo8, ordered by their number, empty if there are none
+		Color spinnerApproachCircle;
+		Color sliderBorder;
+		Color sliderTrackOverride;
+		bool hasSliderTrackOverride;
+		Color sliderBall;
+		Color songSelectActiveText;
+		Color songSelectInactiveText;
+
+		// [Fonts]
+		std::string hitCirclePrefix; // '/' as the path separator
+		int hitCircleOverlap;
+		std::string scorePrefix;
+		int scoreOverlap;
+		std::string comboPrefix;
+		int comboOverlap;
+
+		// diagnostics
+		int numUnknownKeys; // includes keys with malformed values
+	};
+
+public:
+	static void tokenize(const char *data, size_t size, std::vector<TOKEN> *tokens);
+	static void parse(const char *data, size_t size, CONFIG *config); // applies on top of whatever config already contains (combo colors are replaced as a whole, if there are any)
+
+	// parses the file, unless it is still cached with the same mtime and size (osu_skin_ini_cache)
+	// returns false (and leaves config unchanged) if the file can't be read
+	static bool load(UString filePath, CONFIG *config, bool *wasCached = NULL);
+	static void clearCache();
+
+	static void test(); // corpus of tricky skin.ini variants, cache invalidation, parse benchmark (osu_skin_ini_test)
+};
+
+#endif
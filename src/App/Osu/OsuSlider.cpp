@@ -12,6 +12,7 @@
 #include "AnimationHandler.h"
 #include "ResourceManager.h"
 #include "SoundEngine.h"
+#include "Timer.h"
 
 #include "Shader.h"
 #include "VertexArrayObject.h"
@@ -22,6 +23,7 @@
 #include "OsuSkin.h"
 #include "OsuGameRules.h"
 #include "OsuSliderRenderer.h"
+#include "OsuSpriteBatch.h"
 
 ConVar osu_slider_ball_tint_combo_color("osu_slider_ball_tint_combo_color", true);
 
@@ -43,7 +45,7 @@ ConVar *OsuSlider::m_osu_playfield_rotation_ref = NULL;
 
 float OsuSliderCurve::CURVE_POINTS_SEPERATION = 2.5f; // bigger value = less steps, more blocky sliders
 
-OsuSlider::OsuSlider(char type, int repeat, float pixelLength, std::vector<Vector2> points, std::vector<int> hitSounds, std::vector<float> ticks, float sliderTime, float sliderTimeWithoutRepeats, long time, int sampleType, int comboNumber, int colorCounter, OsuBeatmap *beatmap) : OsuHitObject(time, sampleType, comboNumber, colorCounter, beatmap)
+OsuSlider::OsuSlider(char type, int repeat, float pixelLength, std::vector<Vector2> points, std::vector<int> hitSounds, std::vector<float> ticks, std::vector<OsuBeatmapDifficulty::SLIDER_EVENT> events, float sliderTime, float sliderTimeWithoutRepeats, long time, int sampleType, int comboNumber, int colorCounter, OsuBeatmap *beatmap) : OsuHitObject(time, sampleType, comboNumber, colorCounter, beatmap)
 {
 	if (m_osu_playfield_mirror_horizontal_ref == NULL)
 		m_osu_playfield_mirror_horizontal_ref = convar->getConVarByName("osu_playfield_mirror_horizontal");
@@ -70,52 +72,26 @@ OsuSlider::OsuSlider(char type, int repeat, float pixelLength, std::vector<Vecto
 	}
 
 	// build curve
-	if (m_cType == SLIDER_PASSTHROUGH && m_points.size() == 3)
+	m_curve = OsuSliderCurve::createCurve(m_cType, m_points, m_fPixelLength, beatmap);
+
+	// build repeats + ticks
+	m_events = events;
+	m_iNextEvent = 0;
+	m_iNumJudgedEvents = 0;
+	m_iNumSuccessfulEvents = 0;
+	m_iLastRepeatStartEventIndex = -1;
+	m_iLastRepeatEndEventIndex = -1;
+	for (int i=0; i<m_events.size(); i++)
 	{
-		Vector2 nora = m_points[1] - m_points[0];
-		Vector2 norb = m_points[1] - m_points[2];
+		if (m_events[i].type == OsuBeatmapDifficulty::SLIDER_EVENT_TICK || m_events[i].type == OsuBeatmapDifficulty::SLIDER_EVENT_REPEAT)
+			m_iNumJudgedEvents++;
 
-		float temp = nora.x;
-		nora.x = -nora.y;
-		nora.y = temp;
-		temp = norb.x;
-		norb.x = -norb.y;
-		norb.y = temp;
-
-		if (std::abs(norb.x * nora.y - norb.y * nora.x) < 0.00001f)
-			m_curve = new OsuSliderCurveLinearBezier(this, false, beatmap);  // vectors parallel, use linear bezier instead
-		else
-			m_curve = new OsuSliderCurveCircumscribedCircle(this, beatmap);
-	}
-	else if (m_cType == SLIDER_CATMULL)
-		m_curve = new OsuSliderCurveCatmull(this, beatmap);
-	else
-		m_curve = new OsuSliderCurveLinearBezier(this, m_cType == SLIDER_LINEAR, beatmap);
-
-	// build repeats
-	for (int i=0; i<m_iRepeat-1; i++)
-	{
-		SLIDERCLICK sc;
-		sc.finished = false;
-		sc.successful = false;
-		sc.type = 0;
-		sc.sliderend = (i % 2) == 0; // for hit animation on repeat hit
-		sc.time = m_iTime + (long)(m_fSliderTimeWithoutRepeats * (i+1));
-		m_clicks.push_back(sc);
-	}
-
-	// build ticks
-	for (int i=0; i<m_iRepeat; i++)
-	{
-		for (int t=0; t<m_ticks.size(); t++)
+		if (m_events[i].type == OsuBeatmapDifficulty::SLIDER_EVENT_REPEAT)
 		{
-			SLIDERCLICK sc;
-			sc.time = m_iTime + (long)(m_fSliderTimeWithoutRepeats*i) + (long)(m_ticks[t].percent*m_fSliderTimeWithoutRepeats);
-			sc.finished = false;
-			sc.successful = false;
-			sc.type = 1;
-			sc.tickIndex = (i % 2) == 0 ? t : m_ticks.size()-t-1;
-			m_clicks.push_back(sc);
+			if (m_events[i].span % 2 == 0)
+				m_iLastRepeatEndEventIndex = i;
+			else
+				m_iLastRepeatStartEventIndex = i;
 		}
 	}
 
@@ -164,7 +140,7 @@ void OsuSlider::draw(Graphics *g)
 
 	if (m_bVisible || (m_bStartFinished && !m_bFinished)) // extra possibility to avoid flicker between OsuHitObject::m_bVisible delay and the fadeout animation below this if block
 	{
-		float alpha = !osu_mod_hd_slider_fade.getBool() ? m_fAlpha : (osu_mod_hd_slider_fast_fade.getBool() || m_beatmap->getOsu()->getModNM() ? m_fHiddenAlpha : m_fHiddenSlowFadeAlpha);
+		float alpha = !osu_mod_hd_slider_fade.getBool() ? m_fAlpha : (osu_mod_hd_slider_fast_fade.getBool() || m_beatmap->getMods().has(OsuMods::NM) ? m_fHiddenAlpha : m_fHiddenSlowFadeAlpha);
 		float sliderSnake = osu_snaking_sliders.getBool() ? clamp<float>(alpha*2.0f, m_fAlpha, 1.0f) : 1.0f;
 
 		// shrinking sliders
@@ -181,10 +157,11 @@ void OsuSlider::draw(Graphics *g)
 		{
 			// TODO: this is a really shitty solution, maybe an OsuBeatmapCoordinateTransformer or sth?
 
-			std::vector<Vector2> screenPoints = m_curve->getPoints();
-			for (int p=0; p<screenPoints.size(); p++)
+			const std::vector<Vector2> &curvePoints = m_curve->getPoints();
+			m_screenPoints.resize(curvePoints.size());
+			for (int p=0; p<curvePoints.size(); p++)
 			{
-				screenPoints[p] = m_beatmap->osuCoords2Pixels(screenPoints[p]);
+				m_screenPoints[p] = m_beatmap->osuCoords2Pixels(curvePoints[p]);
 			}
 
 			/*
@@ -198,7 +175,7 @@ void OsuSlider::draw(Graphics *g)
 			}
 			*/
 
-			OsuSliderRenderer::draw(g, m_beatmap->getOsu(), screenPoints, m_beatmap->getHitcircleDiameter(), sliderSnakeStart, sliderSnake, skin->getComboColorForCounter(m_iColorCounter), alpha, getTime());
+			OsuSliderRenderer::draw(g, m_beatmap->getOsu(), m_screenPoints, m_beatmap->getHitcircleDiameter(), sliderSnakeStart, sliderSnake, skin->getComboColorForCounter(m_iColorCounter), alpha, getTime());
 			//OsuSliderRenderer::drawMM(g, m_beatmap->getOsu(), screenSegmentPoints, m_beatmap->getHitcircleDiameter(), sliderSnakeStart, sliderSnake, skin->getComboColorForCounter(m_iColorCounter), alpha, getTime());
 		}
 
@@ -226,16 +203,10 @@ void OsuSlider::draw(Graphics *g)
 			// HACKHACK: very dirty code
 			bool sliderRepeatStartCircleFinished = m_iRepeat < 2;
 			bool sliderRepeatEndCircleFinished = false;
-			for (int i=0; i<m_clicks.size(); i++)
-			{
-				if (m_clicks[i].type == 0)
-				{
-					if (m_clicks[i].sliderend)
-						sliderRepeatEndCircleFinished = m_clicks[i].finished;
-					else
-						sliderRepeatStartCircleFinished = m_clicks[i].finished;
-				}
-			}
+			if (m_iLastRepeatEndEventIndex > -1)
+				sliderRepeatEndCircleFinished = m_iLastRepeatEndEventIndex < m_iNextEvent;
+			if (m_iLastRepeatStartEventIndex > -1)
+				sliderRepeatStartCircleFinished = m_iLastRepeatStartEventIndex < m_iNextEvent;
 
 			// end circle
 			if (((!m_bEndFinished && m_iRepeat % 2 != 0) || !sliderRepeatEndCircleFinished))
@@ -276,7 +247,7 @@ void OsuSlider::draw(Graphics *g)
 					/*Vector2 pos = m_beatmap->osuCoords2Pixels(m_curve->pointAt(sliderSnake));*/ // osu doesn't snake the reverse arrow
 					Vector2 pos = m_beatmap->osuCoords2Pixels(m_curve->pointAt(1.0f));
 					float rotation = m_curve->getEndAngle() - m_osu_playfield_rotation_ref->getFloat() - m_beatmap->getPlayfieldRotation();
-					if (m_beatmap->getOsu()->getModHR() || m_osu_playfield_mirror_horizontal_ref->getBool())
+					if (m_beatmap->getMods().has(OsuMods::HR) || m_osu_playfield_mirror_horizontal_ref->getBool())
 						rotation = 360.0f - rotation;
 					if (m_osu_playfield_mirror_vertical_ref->getBool())
 						rotation = 180.0f - rotation;
@@ -302,7 +273,7 @@ void OsuSlider::draw(Graphics *g)
 				{
 					Vector2 pos = m_beatmap->osuCoords2Pixels(m_curve->pointAt(0.0f));
 					float rotation = m_curve->getStartAngle() - m_osu_playfield_rotation_ref->getFloat() - m_beatmap->getPlayfieldRotation();
-					if (m_beatmap->getOsu()->getModHR() || m_osu_playfield_mirror_horizontal_ref->getBool())
+					if (m_beatmap->getMods().has(OsuMods::HR) || m_osu_playfield_mirror_horizontal_ref->getBool())
 						rotation = 360.0f - rotation;
 					if (m_osu_playfield_mirror_vertical_ref->getBool())
 						rotation = 180.0f - rotation;
@@ -326,15 +297,16 @@ void OsuSlider::draw(Graphics *g)
 	}
 
 	// draw start/end circle hit animation, slider body fade animation, followcircle
-	if (m_fEndSliderBodyFadeAnimation > 0.0f && m_fEndSliderBodyFadeAnimation != 1.0f && !m_beatmap->getOsu()->getModHD() && !osu_slider_shrink.getBool())
+	if (m_fEndSliderBodyFadeAnimation > 0.0f && m_fEndSliderBodyFadeAnimation != 1.0f && !m_beatmap->getMods().has(OsuMods::HD) && !osu_slider_shrink.getBool())
 	{
-		std::vector<Vector2> screenPoints = m_curve->getPoints();
+		const std::vector<Vector2> &curvePoints = m_curve->getPoints();
 		OsuBeatmap *beatmap = m_beatmap;
-		std::transform(screenPoints.begin(), screenPoints.end(), screenPoints.begin(), [beatmap](Vector2 p) -> Vector2 { return beatmap->osuCoords2Pixels(p); });
-		OsuSliderRenderer::draw(g, m_beatmap->getOsu(), screenPoints, m_beatmap->getHitcircleDiameter(), 0, 1, skin->getComboColorForCounter(m_iColorCounter), 1.0f - m_fEndSliderBodyFadeAnimation, getTime());
+		m_screenPoints.resize(curvePoints.size());
+		std::transform(curvePoints.begin(), curvePoints.end(), m_screenPoints.begin(), [beatmap](Vector2 p) -> Vector2 { return beatmap->osuCoords2Pixels(p); });
+		OsuSliderRenderer::draw(g, m_beatmap->getOsu(), m_screenPoints, m_beatmap->getHitcircleDiameter(), 0, 1, skin->getComboColorForCounter(m_iColorCounter), 1.0f - m_fEndSliderBodyFadeAnimation, getTime());
 	}
 
-	if (m_fStartHitAnimation > 0.0f && m_fStartHitAnimation != 1.0f && !m_beatmap->getOsu()->getModHD())
+	if (m_fStartHitAnimation > 0.0f && m_fStartHitAnimation != 1.0f && !m_beatmap->getMods().has(OsuMods::HD))
 	{
 		float alpha = 1.0f - m_fStartHitAnimation;
 		//alpha = -alpha*(alpha-2.0f); // quad out alpha
@@ -344,16 +316,17 @@ void OsuSlider::draw(Graphics *g)
 
 		bool drawNumber = (skin->getVersion() > 1.0f ? false : true) && m_iCurRepeat < 1;
 
-		g->pushTransform();
-			g->scale((1.0f+scale*OsuGameRules::osu_circle_fade_out_scale.getFloat()), (1.0f+scale*OsuGameRules::osu_circle_fade_out_scale.getFloat()));
+		OsuSpriteBatch *batch = OsuSpriteBatch::getShared();
+		const float prevScaleMultiplier = batch->getScaleMultiplier();
+		batch->setScaleMultiplier(prevScaleMultiplier*(1.0f+scale*OsuGameRules::osu_circle_fade_out_scale.getFloat()));
 			if (m_iCurRepeat < 1)
 				OsuCircle::drawSliderStartCircle(g, m_beatmap, m_curve->pointAt(0.0f), m_iComboNumber, m_iColorCounter, 1.0f, alpha, alpha, drawNumber);
 			else
 				OsuCircle::drawSliderEndCircle(g, m_beatmap, m_curve->pointAt(0.0f), m_iComboNumber, m_iColorCounter, 1.0f, alpha, alpha, drawNumber);
-		g->popTransform();
+		batch->setScaleMultiplier(prevScaleMultiplier);
 	}
 
-	if (m_fEndHitAnimation > 0.0f && m_fEndHitAnimation != 1.0f && !m_beatmap->getOsu()->getModHD())
+	if (m_fEndHitAnimation > 0.0f && m_fEndHitAnimation != 1.0f && !m_beatmap->getMods().has(OsuMods::HD))
 	{
 		float alpha = 1.0f - m_fEndHitAnimation;
 		//alpha = -alpha*(alpha-2.0f); // quad out alpha
@@ -361,10 +334,11 @@ void OsuSlider::draw(Graphics *g)
 		float scale = m_fEndHitAnimation;
 		scale = -scale*(scale-2.0f); // quad out scale
 
-		g->pushTransform();
-			g->scale((1.0f+scale*OsuGameRules::osu_circle_fade_out_scale.getFloat()), (1.0f+scale*OsuGameRules::osu_circle_fade_out_scale.getFloat()));
+		OsuSpriteBatch *batch = OsuSpriteBatch::getShared();
+		const float prevScaleMultiplier = batch->getScaleMultiplier();
+		batch->setScaleMultiplier(prevScaleMultiplier*(1.0f+scale*OsuGameRules::osu_circle_fade_out_scale.getFloat()));
 			OsuCircle::drawSliderEndCircle(g, m_beatmap, m_curve->pointAt(1.0f), m_iComboNumber, m_iColorCounter, 1.0f, alpha, 0.0f, false);
-		g->popTransform();
+		batch->setScaleMultiplier(prevScaleMultiplier);
 	}
 
 	OsuHitObject::draw(g);
@@ -391,23 +365,17 @@ void OsuSlider::draw2(Graphics *g)
 	// HACKHACK: so much code duplication aaaaaaah
 	if (m_bVisible || (m_bStartFinished && !m_bFinished)) // extra possibility to avoid flicker between OsuHitObject::m_bVisible delay and the fadeout animation below this if block
 	{
-		float alpha = !osu_mod_hd_slider_fade.getBool() ? m_fAlpha : (osu_mod_hd_slider_fast_fade.getBool() || m_beatmap->getOsu()->getModNM() ? m_fHiddenAlpha : m_fHiddenSlowFadeAlpha);
+		float alpha = !osu_mod_hd_slider_fade.getBool() ? m_fAlpha : (osu_mod_hd_slider_fast_fade.getBool() || m_beatmap->getMods().has(OsuMods::NM) ? m_fHiddenAlpha : m_fHiddenSlowFadeAlpha);
 
 		if (m_points.size() > 1)
 		{
 			// HACKHACK: very dirty code
 			bool sliderRepeatStartCircleFinished = m_iRepeat < 2;
 			bool sliderRepeatEndCircleFinished = false;
-			for (int i=0; i<m_clicks.size(); i++)
-			{
-				if (m_clicks[i].type == 0)
-				{
-					if (m_clicks[i].sliderend)
-						sliderRepeatEndCircleFinished = m_clicks[i].finished;
-					else
-						sliderRepeatStartCircleFinished = m_clicks[i].finished;
-				}
-			}
+			if (m_iLastRepeatEndEventIndex > -1)
+				sliderRepeatEndCircleFinished = m_iLastRepeatEndEventIndex < m_iNextEvent;
+			if (m_iLastRepeatStartEventIndex > -1)
+				sliderRepeatStartCircleFinished = m_iLastRepeatStartEventIndex < m_iNextEvent;
 
 			// start circle
 			if (!m_bStartFinished || !sliderRepeatStartCircleFinished || (!m_bEndFinished && m_iRepeat % 2 == 0))
@@ -419,7 +387,7 @@ void OsuSlider::draw2(Graphics *g)
 
 	// draw followcircle
 	// HACKHACK: this is not entirely correct (due to m_bHeldTillEnd, if held within 300 range but then released, will flash followcircle at the end)
-	if ((m_bVisible && m_bCursorInside && (m_beatmap->isClickHeld() || m_beatmap->getOsu()->getModAuto() || m_beatmap->getOsu()->getModRelax())) || (m_bFinished && m_fFollowCircleAnimationAlpha > 0.0f && m_bHeldTillEnd))
+	if ((m_bVisible && m_bCursorInside && (m_beatmap->isClickHeld() || m_beatmap->getMods().has(OsuMods::AUTO) || m_beatmap->getMods().has(OsuMods::RELAX))) || (m_bFinished && m_fFollowCircleAnimationAlpha > 0.0f && m_bHeldTillEnd))
 	{
 		Vector2 point = m_beatmap->osuCoords2Pixels(m_vCurPointRaw);
 
@@ -432,13 +400,11 @@ void OsuSlider::draw2(Graphics *g)
 		}
 		float tickAnimationScale = 1.0f + tickAnimation*OsuGameRules::osu_slider_followcircle_tick_pulse_scale.getFloat();
 
-		g->setColor(0xffffffff);
-		g->setAlpha(m_fFollowCircleAnimationAlpha);
-		g->pushTransform();
-		g->scale(m_beatmap->getSliderFollowCircleScale()*tickAnimationScale*m_fFollowCircleAnimationScale, m_beatmap->getSliderFollowCircleScale()*tickAnimationScale*m_fFollowCircleAnimationScale);
-		g->translate(point.x, point.y);
-		g->drawImage(skin->getSliderFollowCircle());
-		g->popTransform();
+		const Color followCircleColor = COLOR((int)(clamp<float>(m_fFollowCircleAnimationAlpha, 0.0f, 1.0f)*255.0f), 255, 255, 255);
+		OsuSpriteBatch *batch = OsuSpriteBatch::getShared();
+		batch->begin(g);
+			batch->add(skin->getSliderFollowCircle(), point, m_beatmap->getSliderFollowCircleScale()*tickAnimationScale*m_fFollowCircleAnimationScale, followCircleColor);
+		batch->end();
 	}
 
 	// draw sliderb on top of everything
@@ -456,13 +422,11 @@ void OsuSlider::draw2(Graphics *g)
 
 			float sliderbImageScale = m_beatmap->getHitcircleDiameter() / (128.0f * (skin->isSliderB2x() ? 2.0f : 1.0f));
 
-			g->setColor(skin->getAllowSliderBallTint() ? (osu_slider_ball_tint_combo_color.getBool() ? skin->getComboColorForCounter(m_iColorCounter) : skin->getSliderBallColor()) : 0xffffffff);
-			g->pushTransform();
-			g->scale(sliderbImageScale, sliderbImageScale);
-			g->rotate(ballAngle);
-			g->translate(point.x, point.y);
-			g->drawImage(skin->getSliderb());
-			g->popTransform();
+			const Color sliderbColor = skin->getAllowSliderBallTint() ? (osu_slider_ball_tint_combo_color.getBool() ? skin->getComboColorForCounter(m_iColorCounter) : skin->getSliderBallColor()) : 0xffffffff;
+			OsuSpriteBatch *batch = OsuSpriteBatch::getShared();
+			batch->begin(g);
+				batch->add(skin->getSliderb(), point, Vector2(sliderbImageScale, sliderbImageScale), ballAngle, sliderbColor);
+			batch->end();
 		}
 	}
 }
@@ -506,7 +470,7 @@ void OsuSlider::update(long curPos)
 	// hidden modifies the alpha
 	m_fHiddenAlpha = m_fAlpha;
 	m_fHiddenSlowFadeAlpha = m_fAlpha;
-	if (m_beatmap->getOsu()->getModHD())
+	if (m_beatmap->getMods().has(OsuMods::HD))
 	{
 		if (m_iDelta < m_iHiddenTimeDiff + m_iHiddenDecayTime) // fadeout
 		{
@@ -527,7 +491,7 @@ void OsuSlider::update(long curPos)
 	}
 
 	// when playing hidden, delta may get negative early enough to show the number again before the slider starts, this fixes that
-	if (m_beatmap->getOsu()->getModHD() && m_iDelta <= 0)
+	if (m_beatmap->getMods().has(OsuMods::HD) && m_iDelta <= 0)
 		m_fHiddenAlpha = 0.0f;
 
 	// if this slider is active
@@ -579,7 +543,7 @@ void OsuSlider::update(long curPos)
 	float followRadius = m_beatmap->getSliderFollowCircleDiameter()/2.0f;
 	if (m_bCursorLeft) // need to go within the circle radius to be valid again
 		followRadius = m_beatmap->getHitcircleDiameter()/2.0f;
-	m_bCursorInside = m_beatmap->getOsu()->getModAuto() || (m_beatmap->getCursorPos() - m_vCurPoint).length() < followRadius;
+	m_bCursorInside = m_beatmap->getMods().has(OsuMods::AUTO) || (m_beatmap->getCursorPos() - m_vCurPoint).length() < followRadius;
 	if (m_bCursorInside)
 		m_bCursorLeft = false;
 	else
@@ -588,14 +552,14 @@ void OsuSlider::update(long curPos)
 	// handle slider start
 	if (!m_bStartFinished)
 	{
-		if (m_beatmap->getOsu()->getModAuto())
+		if (m_beatmap->getMods().has(OsuMods::AUTO))
 		{
 			if (curPos >= m_iTime)
 				onHit(OsuScore::HIT::HIT_300, 0, false);
 		}
 		else
 		{
-			if (m_beatmap->getOsu()->getModRelax())
+			if (m_beatmap->getMods().has(OsuMods::RELAX))
 			{
 				if (curPos >= m_iTime && m_bCursorInside)
 				{
@@ -624,7 +588,7 @@ void OsuSlider::update(long curPos)
 			if (delta >= 0)
 			{
 				// if this is a miss after waiting
-				if (delta > (long)OsuGameRules::getHitWindow50(m_beatmap))
+				if (delta > (long)m_beatmap->getDifficulty().hitWindow50)
 				{
 					m_startResult = OsuScore::HIT::HIT_MISS;
 					onHit(m_startResult, delta, false);
@@ -636,28 +600,39 @@ void OsuSlider::update(long curPos)
 	// handle slider end, repeats, ticks
 	if (!m_bEndFinished)
 	{
-		if ((m_beatmap->isClickHeld() || m_beatmap->getOsu()->getModRelax()) && m_bCursorInside)
+		if ((m_beatmap->isClickHeld() || m_beatmap->getMods().has(OsuMods::RELAX)) && m_bCursorInside)
 			m_iLastClickHeld = curPos;
 		else
 			m_bCursorLeft = true; // do not allow empty clicks outside of the circle radius to prevent the m_bCursorInside flag from resetting
 	
-		// handle repeats and ticks
-		for (int i=0; i<m_clicks.size(); i++)
+		// handle repeats and ticks (the events are sorted by time, so there is no need to look at anything before the cursor)
+		while (m_iNextEvent < m_events.size() && curPos >= m_events[m_iNextEvent].time)
 		{
-			if (!m_clicks[i].finished && curPos >= m_clicks[i].time)
-			{
-				m_clicks[i].finished = true;
-				m_clicks[i].successful = (m_beatmap->isClickHeld() && m_bCursorInside) || m_beatmap->getOsu()->getModAuto() || (m_beatmap->getOsu()->getModRelax() && m_bCursorInside);
+			const OsuBeatmapDifficulty::SLIDER_EVENT &event = m_events[m_iNextEvent];
+			m_iNextEvent++;
 
-				if (m_clicks[i].type == 0)
-					onRepeatHit(m_clicks[i].successful, m_clicks[i].sliderend);
-				else
-					onTickHit(m_clicks[i].successful, m_clicks[i].tickIndex);
+			const bool successful = (m_beatmap->isClickHeld() && m_bCursorInside) || m_beatmap->getMods().has(OsuMods::AUTO) || (m_beatmap->getMods().has(OsuMods::RELAX) && m_bCursorInside);
+			switch (event.type)
+			{
+			case OsuBeatmapDifficulty::SLIDER_EVENT_TICK:
+				if (successful)
+					m_iNumSuccessfulEvents++;
+				if (event.span >= m_iRepeat-1 && event.tickIndex > -1 && event.tickIndex < m_ticks.size()) // the last span hits every tick for the last time
+					m_ticks[event.tickIndex].finished = true;
+				onTickHit(successful, event.time);
+				break;
+			case OsuBeatmapDifficulty::SLIDER_EVENT_REPEAT:
+				if (successful)
+					m_iNumSuccessfulEvents++;
+				onRepeatHit(successful, event.span % 2 == 0, event.time);
+				break;
+			default: // the head and the tail are handled separately, the legacy last tick is only informational (the end is still judged at the end)
+				break;
 			}
 		}
 
 		// handle auto, and the last circle
-		if (m_beatmap->getOsu()->getModAuto())
+		if (m_beatmap->getMods().has(OsuMods::AUTO))
 		{
 			if (curPos >= m_iTime + m_iObjectDuration)
 			{
@@ -679,7 +654,7 @@ void OsuSlider::update(long curPos)
 				else
 					m_bHeldTillEnd = true;
 
-				if ((m_beatmap->isClickHeld() || m_beatmap->getOsu()->getModRelax()) && m_bCursorInside)
+				if ((m_beatmap->isClickHeld() || m_beatmap->getMods().has(OsuMods::RELAX)) && m_bCursorInside)
 					m_endResult = OsuScore::HIT::HIT_300;
 
 
@@ -691,20 +666,14 @@ void OsuSlider::update(long curPos)
 
 				// handle total slider result (currently startcircle + repeats + ticks + endcircle)
 				// clicks = (repeats + ticks)
-				float numMaxPossibleHits = 1 + m_clicks.size() + 1;
-				float numActualHits = 0;
+				float numMaxPossibleHits = 1 + m_iNumJudgedEvents + 1;
+				float numActualHits = m_iNumSuccessfulEvents;
 
 				if (m_startResult != OsuScore::HIT::HIT_MISS)
 					numActualHits++;
 				if (m_endResult != OsuScore::HIT::HIT_MISS)
 					numActualHits++;
 
-				for (int i=0; i<m_clicks.size(); i++)
-				{
-					if (m_clicks[i].successful)
-						numActualHits++;
-				}
-
 				float percent = numActualHits / numMaxPossibleHits;
 
 				bool allow300 = osu_slider_scorev2.getBool() ? (m_startResult == OsuScore::HIT::HIT_300) : true;
@@ -846,24 +815,25 @@ void OsuSlider::onHit(OsuScore::HIT result, long delta, bool startOrEnd, float t
 		onSliderBreak();
 	else
 	{
-		m_beatmap->getSkin()->playHitCircleSound(m_iCurRepeatCounterForHitSounds < m_hitSounds.size() ? m_hitSounds[m_iCurRepeatCounterForHitSounds] : m_iSampleType);
+		if (!m_beatmap->isSimulating())
+			playHitSound(m_iCurRepeatCounterForHitSounds < m_hitSounds.size() ? m_hitSounds[m_iCurRepeatCounterForHitSounds] : m_iSampleType, OsuGameRules::getHitSoundPan(m_vCurPointRaw.x), startOrEnd ? m_iTime + m_iObjectDuration : m_iTime + delta);
 
 		if (!startOrEnd)
 		{
 			m_fStartHitAnimation = 0.001f; // quickfix for 1 frame missing images
-			anim->moveQuadOut(&m_fStartHitAnimation, 1.0f, OsuGameRules::getFadeOutTime(m_beatmap), true);
+			anim->moveQuadOut(&m_fStartHitAnimation, 1.0f, m_beatmap->getDifficulty().fadeOutTime, true);
 		}
 		else
 		{
 			if (m_iRepeat % 2 != 0)
 			{
 				m_fEndHitAnimation = 0.001f; // quickfix for 1 frame missing images
-				anim->moveQuadOut(&m_fEndHitAnimation, 1.0f, OsuGameRules::getFadeOutTime(m_beatmap), true);
+				anim->moveQuadOut(&m_fEndHitAnimation, 1.0f, m_beatmap->getDifficulty().fadeOutTime, true);
 			}
 			else
 			{
 				m_fStartHitAnimation = 0.001f; // quickfix for 1 frame missing images
-				anim->moveQuadOut(&m_fStartHitAnimation, 1.0f, OsuGameRules::getFadeOutTime(m_beatmap), true);
+				anim->moveQuadOut(&m_fStartHitAnimation, 1.0f, m_beatmap->getDifficulty().fadeOutTime, true);
 			}
 		}
 
@@ -876,7 +846,7 @@ void OsuSlider::onHit(OsuScore::HIT result, long delta, bool startOrEnd, float t
 	{
 		m_bStartFinished = true;
 
-		if (!m_beatmap->getOsu()->getModTarget())
+		if (!m_beatmap->getMods().has(OsuMods::TARGET))
 			m_beatmap->addHitResult(result, delta, false, true);
 		else
 			addHitResult(result, delta, m_curve->pointAt(0.0f), targetDelta, targetAngle, false);
@@ -889,13 +859,13 @@ void OsuSlider::onHit(OsuScore::HIT result, long delta, bool startOrEnd, float t
 		m_bFinished = true;
 
 		m_fEndSliderBodyFadeAnimation = 0.001f; // quickfix for 1 frame missing images
-		anim->moveQuadOut(&m_fEndSliderBodyFadeAnimation, 1.0f, OsuGameRules::getFadeOutTime(m_beatmap), true);
+		anim->moveQuadOut(&m_fEndSliderBodyFadeAnimation, 1.0f, m_beatmap->getDifficulty().fadeOutTime, true);
 	}
 
 	m_iCurRepeatCounterForHitSounds++;
 }
 
-void OsuSlider::onRepeatHit(bool successful, bool sliderend)
+void OsuSlider::onRepeatHit(bool successful, bool sliderend, long time)
 {
 	if (m_points.size() == 0)
 		return;
@@ -910,18 +880,19 @@ void OsuSlider::onRepeatHit(bool successful, bool sliderend)
 		m_fFollowCircleTickAnimationScale = 0.0f;
 		anim->moveLinear(&m_fFollowCircleTickAnimationScale, 1.0f, OsuGameRules::osu_slider_followcircle_tick_pulse_time.getFloat(), true);
 
-		m_beatmap->getSkin()->playHitCircleSound(m_iCurRepeatCounterForHitSounds < m_hitSounds.size() ? m_hitSounds[m_iCurRepeatCounterForHitSounds] : m_iSampleType);
+		if (!m_beatmap->isSimulating())
+			playHitSound(m_iCurRepeatCounterForHitSounds < m_hitSounds.size() ? m_hitSounds[m_iCurRepeatCounterForHitSounds] : m_iSampleType, OsuGameRules::getHitSoundPan(m_vCurPointRaw.x), time);
 		m_beatmap->addHitResult(OsuScore::HIT::HIT_300, 0, true, true, false, true); // ignore in hiterrorbar, ignore for accuracy, increase combo, but don't count towards score!
 
 		if (sliderend)
 		{
 			m_fEndHitAnimation = 0.001f; // quickfix for 1 frame missing images
-			anim->moveQuadOut(&m_fEndHitAnimation, 1.0f, OsuGameRules::getFadeOutTime(m_beatmap), true);
+			anim->moveQuadOut(&m_fEndHitAnimation, 1.0f, m_beatmap->getDifficulty().fadeOutTime, true);
 		}
 		else
 		{
 			m_fStartHitAnimation = 0.001f; // quickfix for 1 frame missing images
-			anim->moveQuadOut(&m_fStartHitAnimation, 1.0f, OsuGameRules::getFadeOutTime(m_beatmap), true);
+			anim->moveQuadOut(&m_fStartHitAnimation, 1.0f, m_beatmap->getDifficulty().fadeOutTime, true);
 		}
 
 		// add score
@@ -931,23 +902,13 @@ void OsuSlider::onRepeatHit(bool successful, bool sliderend)
 	m_iCurRepeatCounterForHitSounds++;
 }
 
-void OsuSlider::onTickHit(bool successful, int tickIndex)
+void OsuSlider::onTickHit(bool successful, long time)
 {
 	if (m_points.size() == 0)
 		return;
 
 	// tick hit of a slider adds +10 points, if successful
 
-	// tick drawing visibility
-	int numMissingTickClicks = 0;
-	for (int i=0; i<m_clicks.size(); i++)
-	{
-		if (m_clicks[i].type == 1 && m_clicks[i].tickIndex == tickIndex && !m_clicks[i].finished)
-			numMissingTickClicks++;
-	}
-	if (numMissingTickClicks == 0)
-		m_ticks[tickIndex].finished = true;
-
 	// sound and hit animation
 	if (!successful)
 		onSliderBreak();
@@ -955,7 +916,8 @@ void OsuSlider::onTickHit(bool successful, int tickIndex)
 	{
 		m_fFollowCircleTickAnimationScale = 0.0f;
 		anim->moveLinear(&m_fFollowCircleTickAnimationScale, 1.0f, OsuGameRules::osu_slider_followcircle_tick_pulse_time.getFloat(), true);
-		m_beatmap->getSkin()->playSliderTickSound();
+		if (!m_beatmap->isSimulating())
+			playSliderTickSound(OsuGameRules::getHitSoundPan(m_vCurPointRaw.x), time);
 		m_beatmap->addHitResult(OsuScore::HIT::HIT_SLIDER30, 0, true);
 
 		// add score
@@ -968,7 +930,7 @@ void OsuSlider::onSliderBreak()
 	m_beatmap->addSliderBreak();
 
 	// TEMP:
-	if (osu_slider_break_epilepsy.getBool())
+	if (osu_slider_break_epilepsy.getBool() && !m_beatmap->isSimulating())
 	{
 		m_fSliderBreakRapeTime = engine->getTime() + 0.15f;
 		convar->getConVarByName("epilepsy")->setValue(1.0f);
@@ -1021,66 +983,375 @@ void OsuSlider::onReset(long curPos)
 		m_fEndSliderBodyFadeAnimation = 1.0f;
 	}
 
-	for (int i=0; i<m_clicks.size(); i++)
+	// everything before curPos counts as successful
+	m_iNextEvent = 0;
+	m_iNumSuccessfulEvents = 0;
+	for (int i=0; i<m_ticks.size(); i++)
+	{
+		m_ticks[i].finished = false;
+	}
+	while (m_iNextEvent < m_events.size() && curPos > m_events[m_iNextEvent].time)
+	{
+		const OsuBeatmapDifficulty::SLIDER_EVENT &event = m_events[m_iNextEvent];
+		m_iNextEvent++;
+
+		if (event.type == OsuBeatmapDifficulty::SLIDER_EVENT_TICK || event.type == OsuBeatmapDifficulty::SLIDER_EVENT_REPEAT)
+			m_iNumSuccessfulEvents++;
+		if (event.type == OsuBeatmapDifficulty::SLIDER_EVENT_TICK && event.span >= m_iRepeat-1 && event.tickIndex > -1 && event.tickIndex < m_ticks.size())
+			m_ticks[event.tickIndex].finished = true;
+	}
+
+	m_fSliderBreakRapeTime = 0.0f;
+	convar->getConVarByName("epilepsy")->setValue(0.0f);
+}
+
+bool OsuSlider::getProgress(long curPos, PROGRESS *progress) const
+{
+	// untouched sliders are exactly what onReset() rebuilds
+	if (m_bFinished || (!m_bStartFinished && m_iNextEvent == 0 && m_iTime > curPos))
+		return false;
+
+	progress->startResult = m_startResult;
+	progress->startFinished = m_bStartFinished;
+	progress->nextEvent = m_iNextEvent;
+	progress->numSuccessfulEvents = m_iNumSuccessfulEvents;
+	progress->heldTillEnd = m_bHeldTillEnd;
+	progress->lastClickHeld = m_iLastClickHeld;
+	progress->cursorLeft = m_bCursorLeft;
+	progress->hitSoundCounter = m_iCurRepeatCounterForHitSounds;
+	return true;
+}
+
+void OsuSlider::onRestore(long curPos, bool finished, const PROGRESS *progress)
+{
+	onReset(curPos);
+
+	if (finished)
 	{
-		if (curPos > m_clicks[i].time)
+		m_bStartFinished = true;
+		m_fStartHitAnimation = 1.0f;
+		m_bEndFinished = true;
+		m_bFinished = true;
+		m_fEndHitAnimation = 1.0f;
+		m_fEndSliderBodyFadeAnimation = 1.0f;
+	}
+	else if (progress != NULL)
+	{
+		m_startResult = progress->startResult;
+		m_bStartFinished = progress->startFinished;
+		m_fStartHitAnimation = (progress->startFinished ? 1.0f : 0.0f);
+		m_bEndFinished = false;
+		m_bFinished = false;
+		m_fEndHitAnimation = 0.0f;
+		m_fEndSliderBodyFadeAnimation = 0.0f;
+
+		m_iNextEvent = progress->nextEvent;
+		m_iNumSuccessfulEvents = progress->numSuccessfulEvents;
+		m_bHeldTillEnd = progress->heldTillEnd;
+		m_iLastClickHeld = progress->lastClickHeld;
+		m_bCursorLeft = progress->cursorLeft;
+		m_iCurRepeatCounterForHitSounds = progress->hitSoundCounter;
+
+		// rebuild the tick flags from the restored event cursor
+		for (int i=0; i<m_ticks.size(); i++)
 		{
-			m_clicks[i].finished = true;
-			m_clicks[i].successful = true;
+			m_ticks[i].finished = false;
 		}
-		else
+		for (int i=0; i<m_iNextEvent && i<m_events.size(); i++)
 		{
-			m_clicks[i].finished = false;
-			m_clicks[i].successful = false;
+			const OsuBeatmapDifficulty::SLIDER_EVENT &event = m_events[i];
+			if (event.type == OsuBeatmapDifficulty::SLIDER_EVENT_TICK && event.span >= m_iRepeat-1 && event.tickIndex > -1 && event.tickIndex < m_ticks.size())
+				m_ticks[event.tickIndex].finished = true;
 		}
 	}
+}
 
-	for (int i=0; i<m_ticks.size(); i++)
+
+
+//**********//
+//	Curves	//
+//**********//
+
+OsuSliderCurve *OsuSliderCurve::createCurve(char type, std::vector<Vector2> points, float pixelLength, OsuBeatmap *beatmap)
+{
+	if (isCircumscribedCircle(type, points))
+		return new OsuSliderCurveCircumscribedCircle(points, pixelLength, beatmap);
+	else if (type == OsuSlider::SLIDER_CATMULL)
+		return new OsuSliderCurveCatmull(points, pixelLength, beatmap);
+	else
+		return new OsuSliderCurveLinearBezier(points, pixelLength, type == OsuSlider::SLIDER_LINEAR, beatmap); // passthrough sliders with parallel vectors also end up here
+}
+
+bool OsuSliderCurve::isCircumscribedCircle(char type, const std::vector<Vector2> &points)
+{
+	if (type != OsuSlider::SLIDER_PASSTHROUGH || points.size() != 3)
+		return false;
+
+	Vector2 nora = points[1] - points[0];
+	Vector2 norb = points[1] - points[2];
+
+	float temp = nora.x;
+	nora.x = -nora.y;
+	nora.y = temp;
+	temp = norb.x;
+	norb.x = -norb.y;
+	norb.y = temp;
+
+	return (std::abs(norb.x * nora.y - norb.y * nora.x) >= 0.00001f); // vectors parallel, use linear bezier instead
+}
+
+// the equidistant points of OsuSliderCurveEqualDistanceMulti::init(), one at a time and without storing them
+class OsuSliderCurveResampler
+{
+public:
+	OsuSliderCurveResampler(const std::vector<Vector2> &rawPoints, float pixelLength, int numSteps) : m_rawPoints(rawPoints)
 	{
-		int numMissingTickClicks = 0;
-		for (int c=0; c<m_clicks.size(); c++)
+		m_fPixelLength = pixelLength;
+		m_iNumSteps = numSteps;
+		reset();
+	}
+
+	void reset()
+	{
+		m_iStep = 0;
+		m_iRawIndex = 1;
+		m_fPrevRawDistance = 0.0;
+		m_fRawDistance = (m_rawPoints[1] - m_rawPoints[0]).length();
+	}
+
+	inline bool isDone() const {return m_iStep > m_iNumSteps;}
+
+	Vector2 next()
+	{
+		const double distance = ((double)m_iStep * (double)m_fPixelLength) / (double)m_iNumSteps;
+		m_iStep++;
+
+		while (m_iRawIndex < m_rawPoints.size()-1 && m_fRawDistance < distance)
 		{
-			if (m_clicks[c].type == 1 && m_clicks[c].tickIndex == i && !m_clicks[c].finished)
-				numMissingTickClicks++;
+			m_iRawIndex++;
+			m_fPrevRawDistance = m_fRawDistance;
+			m_fRawDistance = m_fRawDistance + (m_rawPoints[m_iRawIndex] - m_rawPoints[m_iRawIndex - 1]).length();
 		}
-		m_ticks[i].finished = numMissingTickClicks == 0;
+
+		const Vector2 &lastPoint = m_rawPoints[m_iRawIndex - 1];
+		const Vector2 &nextPoint = m_rawPoints[m_iRawIndex];
+		const double lineLength = m_fRawDistance - m_fPrevRawDistance;
+		const double t = (lineLength > 0.0 ? (distance - m_fPrevRawDistance) / lineLength : 0.0); // t > 1 extends the last line
+
+		return lastPoint + (nextPoint - lastPoint)*(float)t;
 	}
 
-	m_fSliderBreakRapeTime = 0.0f;
-	convar->getConVarByName("epilepsy")->setValue(0.0f);
-}
+private:
+	const std::vector<Vector2> &m_rawPoints; // at least 2
+	float m_fPixelLength;
+	int m_iNumSteps;
 
+	int m_iStep;
+	int m_iRawIndex;
+	double m_fPrevRawDistance;
+	double m_fRawDistance;
+};
 
+void OsuSliderCurve::calculateOriginalPointsAt(char type, const std::vector<Vector2> &points, float pixelLength, const float *t, Vector2 *result, int count)
+{
+	if (points.size() < 1)
+	{
+		for (int i=0; i<count; i++)
+		{
+			result[i] = Vector2(0,0);
+		}
+		return;
+	}
 
-//**********//
-//	Curves	//
-//**********//
+	// arcs are analytic
+	if (isCircumscribedCircle(type, points))
+	{
+		Vector2 center;
+		float radius = 0.0f;
+		float startAngle = 0.0f;
+		float endAngle = 0.0f;
+		const bool valid = OsuSliderCurveCircumscribedCircle::calculateArc(points, pixelLength, &center, &radius, &startAngle, &endAngle);
+		for (int i=0; i<count; i++)
+		{
+			if (valid)
+			{
+				const float ang = lerp(startAngle, endAngle, t[i]);
+				result[i] = Vector2(std::cos(ang) * radius + center.x, std::sin(ang) * radius + center.y);
+			}
+			else
+				result[i] = points[0];
+		}
+		return;
+	}
 
-OsuSliderCurve::OsuSliderCurve(OsuSlider *parent, OsuBeatmap *beatmap)
+	// everything else is the same polyline which OsuSliderCurveEqualDistanceMulti::init() would resample, linear sliders are just their control points
+	std::vector<Vector2> polyline;
+	if (type == OsuSlider::SLIDER_LINEAR || points.size() < 2)
+		polyline = points;
+	else
+	{
+		std::vector<OsuSliderCurveType*> curves = (type == OsuSlider::SLIDER_CATMULL ? OsuSliderCurveCatmull::createCatmulls(points) : OsuSliderCurveLinearBezier::createBeziers(points, false));
+		for (int c=0; c<curves.size(); c++)
+		{
+			const std::vector<Vector2> &curvePoints = curves[c]->getCurvePoints();
+			for (int p=0; p<curvePoints.size(); p++)
+			{
+				if (p == 0 && polyline.size() > 0 && curvePoints[p] == polyline[polyline.size()-1])
+					continue;
+
+				polyline.push_back(curvePoints[p]);
+			}
+			delete curves[c];
+		}
+	}
+
+	if (polyline.size() < 2)
+	{
+		for (int i=0; i<count; i++)
+		{
+			result[i] = (polyline.size() > 0 ? polyline[0] : points[0]);
+		}
+		return;
+	}
+
+	// the equidistant points and their length table are generated on the fly, once for the total length, and then once per requested point
+	OsuSliderCurveResampler resampler(polyline, pixelLength, std::max((int)(pixelLength / CURVE_POINTS_SEPERATION), 1));
+	double totalLength = 0.0;
+	Vector2 prevPoint = resampler.next();
+	while (!resampler.isDone())
+	{
+		const Vector2 point = resampler.next();
+		totalLength += (point - prevPoint).length();
+		prevPoint = point;
+	}
+
+	for (int i=0; i<count; i++)
+	{
+		// same as pointAt()
+		const float distance = clamp<float>(t[i], 0.0f, 1.0f) * (float)totalLength;
+		resampler.reset();
+		double length = 0.0;
+		prevPoint = resampler.next();
+		result[i] = prevPoint;
+		while (!resampler.isDone())
+		{
+			const Vector2 point = resampler.next();
+			const float prevLength = (float)length;
+			length += (point - prevPoint).length();
+			result[i] = point;
+			if ((float)length > distance)
+			{
+				const float segmentLength = (float)length - prevLength;
+				const float t2 = (segmentLength > 0.0f ? (distance - prevLength) / segmentLength : 0.0f);
+				result[i] = Vector2(lerp(prevPoint.x, point.x, t2), lerp(prevPoint.y, point.y, t2));
+				break;
+			}
+			prevPoint = point;
+		}
+	}
+}
+
+OsuSliderCurve::OsuSliderCurve(std::vector<Vector2> points, float pixelLength, OsuBeatmap *beatmap)
 {
-	m_slider = parent;
 	m_beatmap = beatmap;
 
-	m_points = m_slider->getRawPoints();
+	m_points = points;
+	m_fPixelLength = pixelLength;
 
 	m_fStartAngle = 0.0f;
 	m_fEndAngle = 0.0f;
+
+	m_vStackOffset = Vector2(0, 0);
 }
 
 void OsuSliderCurve::updateStackPosition(float stackMulStackOffset)
 {
-	for (int i=0; i<m_originalCurvePoints.size() && i<m_curvePoints.size(); i++)
+	// the original points are not stored, only the offset which is currently applied to them
+	const Vector2 stackOffset = Vector2(stackMulStackOffset, stackMulStackOffset * (m_beatmap->getMods().has(OsuMods::HR) ? -1.0f : 1.0f));
+	const Vector2 delta = m_vStackOffset - stackOffset;
+	for (int i=0; i<m_curvePoints.size(); i++)
 	{
-		m_curvePoints[i] = m_originalCurvePoints[i] - Vector2(stackMulStackOffset, stackMulStackOffset * (m_beatmap->getOsu()->getModHR() ? -1.0f : 1.0f));
+		m_curvePoints[i] = m_curvePoints[i] + delta;
 	}
+	m_vStackOffset = stackOffset;
+
+	m_curvePointSegments.clear(); // rebuilt by getPointSegments()
+}
 
-	for (int s=0; s<m_originalCurvePointSegments.size() && s<m_curvePointSegments.size(); s++)
+Vector2 OsuSliderCurve::pointAt(float t)
+{
+	if (m_curvePoints.size() < 1) // this might happen
+		return Vector2(0,0);
+	if (m_curvePoints.size() < 2)
+		return m_curvePoints[0];
+
+	// find the first point which is further away than the requested distance, and lerp between it and its predecessor
+	const float distance = clamp<float>(t, 0.0f, 1.0f) * m_curvePointLengths[m_curvePointLengths.size()-1];
+	const int index = std::upper_bound(m_curvePointLengths.begin(), m_curvePointLengths.end(), distance) - m_curvePointLengths.begin();
+	if (index >= m_curvePoints.size())
+		return m_curvePoints[m_curvePoints.size()-1];
+
+	const Vector2 &poi = m_curvePoints[index - 1];
+	const Vector2 &poi2 = m_curvePoints[index];
+	const float segmentLength = m_curvePointLengths[index] - m_curvePointLengths[index - 1];
+	const float t2 = (segmentLength > 0.0f ? (distance - m_curvePointLengths[index - 1]) / segmentLength : 0.0f);
+	return Vector2(lerp(poi.x, poi2.x, t2), lerp(poi.y, poi2.y, t2));
+}
+
+Vector2 OsuSliderCurve::originalPointAt(float t)
+{
+	return pointAt(t) + m_vStackOffset;
+}
+
+const std::vector<std::vector<Vector2>> &OsuSliderCurve::getPointSegments()
+{
+	if (m_curvePointSegments.size() == 0 && m_curvePoints.size() > 0)
 	{
-		for (int p=0; p<m_originalCurvePointSegments[s].size() && p<m_curvePointSegments[s].size(); p++)
+		// consecutive segments share their start/end point
+		// this also enables an optimization, namely that startcaps only have to be drawn [for every segment] if the startpoint != endpoint in the loop
+		if (m_curvePointSegmentStarts.size() < 1)
+			m_curvePointSegments.push_back(m_curvePoints);
+		else
 		{
-			m_curvePointSegments[s][p] = m_originalCurvePointSegments[s][p] - Vector2(stackMulStackOffset, stackMulStackOffset * (m_beatmap->getOsu()->getModHR() ? -1.0f : 1.0f));
+			for (int s=0; s<m_curvePointSegmentStarts.size(); s++)
+			{
+				const int start = m_curvePointSegmentStarts[s];
+				const int end = (s+1 < m_curvePointSegmentStarts.size() ? m_curvePointSegmentStarts[s+1] : m_curvePoints.size()-1);
+				m_curvePointSegments.push_back(std::vector<Vector2>(m_curvePoints.begin() + start, m_curvePoints.begin() + end + 1));
+			}
 		}
 	}
+
+	return m_curvePointSegments;
+}
+
+unsigned long OsuSliderCurve::getMemoryUsage() const
+{
+	unsigned long bytes = sizeof(*this);
+	bytes += m_points.capacity() * sizeof(Vector2);
+	bytes += m_curvePoints.capacity() * sizeof(Vector2);
+	bytes += m_curvePointSegmentStarts.capacity() * sizeof(int);
+	bytes += m_curvePointLengths.capacity() * sizeof(float);
+	for (int s=0; s<m_curvePointSegments.size(); s++)
+	{
+		bytes += m_curvePointSegments[s].capacity() * sizeof(Vector2);
+	}
+	return bytes;
+}
+
+void OsuSliderCurve::buildLengthTable()
+{
+	m_curvePointLengths.clear();
+	m_curvePointLengths.reserve(m_curvePoints.size());
+
+	double length = 0.0; // accumulating in float would drift on long sliders
+	for (int i=0; i<m_curvePoints.size(); i++)
+	{
+		if (i > 0)
+			length += (m_curvePoints[i] - m_curvePoints[i-1]).length();
+
+		m_curvePointLengths.push_back((float)length);
+	}
 }
 
 
@@ -1235,7 +1506,19 @@ Vector2 OsuSliderCurveTypeCentripetalCatmullRom::pointAt(float t)
 
 
 
-OsuSliderCurveLinearBezier::OsuSliderCurveLinearBezier(OsuSlider *parent, bool line, OsuBeatmap *beatmap) : OsuSliderCurveEqualDistanceMulti(parent, beatmap)
+OsuSliderCurveLinearBezier::OsuSliderCurveLinearBezier(std::vector<Vector2> sliderPoints, float pixelLength, bool line, OsuBeatmap *beatmap) : OsuSliderCurveEqualDistanceMulti(sliderPoints, pixelLength, beatmap)
+{
+	std::vector<OsuSliderCurveType*> beziers = createBeziers(m_points, line);
+
+	init(beziers);
+
+	for (int i=0; i<beziers.size(); i++)
+	{
+		delete beziers[i];
+	}
+}
+
+std::vector<OsuSliderCurveType*> OsuSliderCurveLinearBezier::createBeziers(const std::vector<Vector2> &sliderPoints, bool line)
 {
 	std::vector<OsuSliderCurveType*> beziers;
 
@@ -1243,12 +1526,12 @@ OsuSliderCurveLinearBezier::OsuSliderCurveLinearBezier(OsuSlider *parent, bool l
 	// a b c - c d - d e f g
 	// Lines: generate a new curve for each sequential pair
 	// ab  bc  cd  de  ef  fg
-	int controlPoints = m_points.size();
+	int controlPoints = sliderPoints.size();
 	std::vector<Vector2> points;  // temporary list of points to separate different Bezier curves
 	Vector2 lastPoi(-1, -1);
 	for (int i=0; i<controlPoints; i++)
 	{
-		Vector2 tpoi = m_points[i];
+		Vector2 tpoi = sliderPoints[i];
 		if (line)
 		{
 			if (lastPoi != Vector2(-1,-1))
@@ -1279,18 +1562,25 @@ OsuSliderCurveLinearBezier::OsuSliderCurveLinearBezier(OsuSlider *parent, bool l
 		points.clear();
 	}
 
-	init(beziers);
+	return beziers;
+}
 
-	for (int i=0; i<beziers.size(); i++)
+OsuSliderCurveCatmull::OsuSliderCurveCatmull(std::vector<Vector2> sliderPoints, float pixelLength, OsuBeatmap *beatmap) : OsuSliderCurveEqualDistanceMulti(sliderPoints, pixelLength, beatmap)
+{
+	std::vector<OsuSliderCurveType*> catmulls = createCatmulls(m_points);
+
+	init(catmulls);
+
+	for (int i=0; i<catmulls.size(); i++)
 	{
-		delete beziers[i];
+		delete catmulls[i];
 	}
 }
 
-OsuSliderCurveCatmull::OsuSliderCurveCatmull(OsuSlider *parent, OsuBeatmap *beatmap) : OsuSliderCurveEqualDistanceMulti(parent, beatmap)
+std::vector<OsuSliderCurveType*> OsuSliderCurveCatmull::createCatmulls(const std::vector<Vector2> &sliderPoints)
 {
 	std::vector<OsuSliderCurveType*> catmulls;
-	int ncontrolPoints = m_points.size();
+	int ncontrolPoints = sliderPoints.size();
 	std::vector<Vector2> points; // temporary list of points to separate different curves
 
 	// repeat the first and last points as controls points
@@ -1298,12 +1588,12 @@ OsuSliderCurveCatmull::OsuSliderCurveCatmull(OsuSlider *parent, OsuBeatmap *beat
 	// aabb
 	// aabc abcc
 	// aabc abcd bcdd
-	if (m_points[0].x != m_points[1].x || m_points[0].y != m_points[1].y)
-		points.push_back(m_points[0]);
+	if (sliderPoints[0].x != sliderPoints[1].x || sliderPoints[0].y != sliderPoints[1].y)
+		points.push_back(sliderPoints[0]);
 
 	for (int i=0; i<ncontrolPoints; i++)
 	{
-		points.push_back(m_points[i]);
+		points.push_back(sliderPoints[i]);
 		if (points.size() >= 4)
 		{
 			catmulls.push_back(new OsuSliderCurveTypeCentripetalCatmullRom(points));
@@ -1311,26 +1601,49 @@ OsuSliderCurveCatmull::OsuSliderCurveCatmull(OsuSlider *parent, OsuBeatmap *beat
 		}
 	}
 
-	if (m_points[ncontrolPoints - 1].x != m_points[ncontrolPoints - 2].x || m_points[ncontrolPoints - 1].y != m_points[ncontrolPoints - 2].y)
-		points.push_back(m_points[ncontrolPoints - 1]);
+	if (sliderPoints[ncontrolPoints - 1].x != sliderPoints[ncontrolPoints - 2].x || sliderPoints[ncontrolPoints - 1].y != sliderPoints[ncontrolPoints - 2].y)
+		points.push_back(sliderPoints[ncontrolPoints - 1]);
 
 	if (points.size() >= 4)
 		catmulls.push_back(new OsuSliderCurveTypeCentripetalCatmullRom(points));
 
-	init(catmulls);
+	return catmulls;
+}
 
-	for (int i=0; i<catmulls.size(); i++)
+OsuSliderCurveCircumscribedCircle::OsuSliderCurveCircumscribedCircle(std::vector<Vector2> points, float pixelLength, OsuBeatmap *beatmap) : OsuSliderCurve(points, pixelLength, beatmap)
+{
+	m_fRadius = 0.0f;
+	const bool valid = calculateArc(m_points, m_fPixelLength, &m_vOriginalCircleCenter, &m_fRadius, &m_fCalculationStartAngle, &m_fCalculationEndAngle);
+	m_vCircleCenter = m_vOriginalCircleCenter;
+	if (!valid)
+		return;
+
+	// finds the angles to draw for repeats
+	m_fEndAngle   = (float) ((m_fCalculationEndAngle   + (m_fCalculationStartAngle > m_fCalculationEndAngle ? PI/2.0f : -PI/2.0f)) * 180 / PI);
+	m_fStartAngle = (float) ((m_fCalculationStartAngle + (m_fCalculationStartAngle > m_fCalculationEndAngle ? -PI/2.0f : PI/2.0f)) * 180 / PI);
+
+	// calculate points
+	float step = m_fPixelLength / CURVE_POINTS_SEPERATION;
+	int intStep = (int)std::round(step)+1; // must guarantee an int range of 0 to step
+	for (int i=0; i<(int)intStep+1; i++)
 	{
-		delete catmulls[i];
+		float t = clamp<float>(i/step, 0.0f, 1.0f);
+		m_curvePoints.push_back(pointAt(t));
+
+		if (t >= 1.0f)
+			break;
 	}
+
+	// only one segment (no special logic here for SliderCurveCircumscribedCircle, getPointSegments() just uses the entire vector)
+	buildLengthTable();
 }
 
-OsuSliderCurveCircumscribedCircle::OsuSliderCurveCircumscribedCircle(OsuSlider *parent, OsuBeatmap *beatmap) : OsuSliderCurve(parent, beatmap)
+bool OsuSliderCurveCircumscribedCircle::calculateArc(const std::vector<Vector2> &points, float pixelLength, Vector2 *center, float *radius, float *startAngle, float *endAngle)
 {
 	// construct the three points
-	Vector2 start = parent->getRawPoints()[0];
-	Vector2 mid = parent->getRawPoints()[1];
-	Vector2 end = parent->getRawPoints()[2];
+	Vector2 start = points[0];
+	Vector2 mid = points[1];
+	Vector2 end = points[2];
 
 	// find the circle center
 	Vector2 mida = start + (mid-start)*0.5f;
@@ -1344,73 +1657,53 @@ OsuSliderCurveCircumscribedCircle::OsuSliderCurveCircumscribedCircle(OsuSlider *
 	norb.x = -norb.y;
 	norb.y = temp;
 
-	m_vOriginalCircleCenter = intersect(mida, nora, midb, norb);
-	m_vCircleCenter = m_vOriginalCircleCenter;
+	*center = intersect(mida, nora, midb, norb);
 
 	// find the angles relative to the circle center
-	Vector2 startAngPoint = start - m_vCircleCenter;
-	Vector2 midAngPoint   = mid - m_vCircleCenter;
-	Vector2 endAngPoint   = end - m_vCircleCenter;
+	Vector2 startAngPoint = start - *center;
+	Vector2 midAngPoint   = mid - *center;
+	Vector2 endAngPoint   = end - *center;
 
-	m_fCalculationStartAngle = (float) atan2(startAngPoint.y, startAngPoint.x);
+	float calculationStartAngle = (float) atan2(startAngPoint.y, startAngPoint.x);
 	float midAng   = (float) atan2(midAngPoint.y, midAngPoint.x);
-	m_fCalculationEndAngle   = (float) atan2(endAngPoint.y, endAngPoint.x);
+	float calculationEndAngle   = (float) atan2(endAngPoint.y, endAngPoint.x);
 
 	// find the angles that pass through midAng
-	if (!isIn(m_fCalculationStartAngle, midAng, m_fCalculationEndAngle))
-	{
-		if (std::abs(m_fCalculationStartAngle + 2*PI - m_fCalculationEndAngle) < 2*PI && isIn(m_fCalculationStartAngle + (2*PI), midAng, m_fCalculationEndAngle))
-			m_fCalculationStartAngle += 2*PI;
-		else if (std::abs(m_fCalculationStartAngle - (m_fCalculationEndAngle + 2*PI)) < 2*PI && isIn(m_fCalculationStartAngle, midAng, m_fCalculationEndAngle + (2*PI)))
-			m_fCalculationEndAngle += 2*PI;
-		else if (std::abs(m_fCalculationStartAngle - 2*PI - m_fCalculationEndAngle) < 2*PI && isIn(m_fCalculationStartAngle - (2*PI), midAng, m_fCalculationEndAngle))
-			m_fCalculationStartAngle -= 2*PI;
-		else if (std::abs(m_fCalculationStartAngle - (m_fCalculationEndAngle - 2*PI)) < 2*PI && isIn(m_fCalculationStartAngle, midAng, m_fCalculationEndAngle - (2*PI)))
-			m_fCalculationEndAngle -= 2*PI;
+	if (!isIn(calculationStartAngle, midAng, calculationEndAngle))
+	{
+		if (std::abs(calculationStartAngle + 2*PI - calculationEndAngle) < 2*PI && isIn(calculationStartAngle + (2*PI), midAng, calculationEndAngle))
+			calculationStartAngle += 2*PI;
+		else if (std::abs(calculationStartAngle - (calculationEndAngle + 2*PI)) < 2*PI && isIn(calculationStartAngle, midAng, calculationEndAngle + (2*PI)))
+			calculationEndAngle += 2*PI;
+		else if (std::abs(calculationStartAngle - 2*PI - calculationEndAngle) < 2*PI && isIn(calculationStartAngle - (2*PI), midAng, calculationEndAngle))
+			calculationStartAngle -= 2*PI;
+		else if (std::abs(calculationStartAngle - (calculationEndAngle - 2*PI)) < 2*PI && isIn(calculationStartAngle, midAng, calculationEndAngle - (2*PI)))
+			calculationEndAngle -= 2*PI;
 		else
 		{
-			debugLog("OsuSliderCurveCircumscribedCircle() Error: Cannot find angles between midAng (%.3f %.3f %.3f).", m_fCalculationStartAngle, midAng, m_fCalculationEndAngle);
-			return;
+			debugLog("OsuSliderCurveCircumscribedCircle() Error: Cannot find angles between midAng (%.3f %.3f %.3f).", calculationStartAngle, midAng, calculationEndAngle);
+			*startAngle = calculationStartAngle;
+			*endAngle = calculationEndAngle;
+			return false;
 		}
 	}
 
 	// find an angle with an arc length of pixelLength along this circle
-	m_fRadius = startAngPoint.length();
-	float pixelLength = m_slider->getPixelLength();
-	float arcAng = pixelLength / m_fRadius;  // len = theta * r / theta = len / r
+	*radius = startAngPoint.length();
+	float arcAng = pixelLength / *radius;  // len = theta * r / theta = len / r
 
 	// now use it for our new end angle
-	m_fCalculationEndAngle = (m_fCalculationEndAngle > m_fCalculationStartAngle) ? m_fCalculationStartAngle + arcAng : m_fCalculationStartAngle - arcAng;
-
-	// finds the angles to draw for repeats
-	m_fEndAngle   = (float) ((m_fCalculationEndAngle   + (m_fCalculationStartAngle > m_fCalculationEndAngle ? PI/2.0f : -PI/2.0f)) * 180 / PI);
-	m_fStartAngle = (float) ((m_fCalculationStartAngle + (m_fCalculationStartAngle > m_fCalculationEndAngle ? -PI/2.0f : PI/2.0f)) * 180 / PI);
-
-	// calculate points
-	float step = m_slider->getPixelLength() / CURVE_POINTS_SEPERATION;
-	int intStep = (int)std::round(step)+1; // must guarantee an int range of 0 to step
-	for (int i=0; i<(int)intStep+1; i++)
-	{
-		float t = clamp<float>(i/step, 0.0f, 1.0f);
-		m_curvePoints.push_back(pointAt(t));
+	*startAngle = calculationStartAngle;
+	*endAngle = (calculationEndAngle > calculationStartAngle) ? calculationStartAngle + arcAng : calculationStartAngle - arcAng;
 
-		if (t >= 1.0f)
-			break;
-	}
-
-	// add the segment (no special logic here for SliderCurveCircumscribedCircle, just add the entire vector)
-	m_curvePointSegments.push_back(m_curvePoints);
-
-	// backup (for dynamic updateStackPosition() recalculation)
-	m_originalCurvePoints = m_curvePoints;
-	m_originalCurvePointSegments = m_curvePointSegments;
+	return true;
 }
 
 void OsuSliderCurveCircumscribedCircle::updateStackPosition(float stackMulStackOffset)
 {
 	OsuSliderCurve::updateStackPosition(stackMulStackOffset);
 
-	m_vCircleCenter = m_vOriginalCircleCenter - Vector2(stackMulStackOffset, stackMulStackOffset * (m_beatmap->getOsu()->getModHR() ? -1.0f : 1.0f));
+	m_vCircleCenter = m_vOriginalCircleCenter - Vector2(stackMulStackOffset, stackMulStackOffset * (m_beatmap->getMods().has(OsuMods::HR) ? -1.0f : 1.0f));
 }
 
 Vector2 OsuSliderCurveCircumscribedCircle::pointAt(float t)
@@ -1449,12 +1742,12 @@ bool OsuSliderCurveCircumscribedCircle::isIn(float a, float b, float c)
 
 
 
-OsuSliderCurveEqualDistanceMulti::OsuSliderCurveEqualDistanceMulti(OsuSlider *parent, OsuBeatmap *beatmap) : OsuSliderCurve(parent, beatmap)
+OsuSliderCurveEqualDistanceMulti::OsuSliderCurveEqualDistanceMulti(std::vector<Vector2> points, float pixelLength, OsuBeatmap *beatmap) : OsuSliderCurve(points, pixelLength, beatmap)
 {
-	m_iNCurve = (int) (m_slider->getPixelLength() / CURVE_POINTS_SEPERATION);
+	m_iNCurve = (int) (m_fPixelLength / CURVE_POINTS_SEPERATION);
 }
 
-void OsuSliderCurveEqualDistanceMulti::init(std::vector<OsuSliderCurveType*> curvesList)
+void OsuSliderCurveEqualDistanceMulti::init(const std::vector<OsuSliderCurveType*> &curvesList)
 {
 	if (curvesList.size() == 0)
 	{
@@ -1462,183 +1755,88 @@ void OsuSliderCurveEqualDistanceMulti::init(std::vector<OsuSliderCurveType*> cur
 		return;
 	}
 
-	float distanceAt = 0;
-	int curPoint = 0;
-	int curCurveIndex = 0;
-	OsuSliderCurveType *curCurve = curvesList[curCurveIndex];
-	Vector2 lastCurve = curCurve->getCurvePoints()[0];
-	float lastDistanceAt = 0;
-
-	// length of the curve should be equal to the pixel length
-	float pixelLength = m_slider->getPixelLength();
-
-	// for each distance, try to get in between the two points that are between it
-	Vector2 lastCurvePointForNextSegmentStart;
-	std::vector<Vector2> curCurvePoints;
-	for (int i=0; i<m_iNCurve+1; i++)
+	// merge all curves into one polyline, with the cumulative distance at every point
+	std::vector<Vector2> rawPoints;
+	std::vector<double> rawDistances;
+	std::vector<int> rawCurveIndices; // which curve every point belongs to
+	for (int c=0; c<curvesList.size(); c++)
 	{
-		int prefDistance = (int) ((i * pixelLength) / m_iNCurve);
-		while (distanceAt < prefDistance)
+		const std::vector<Vector2> &curvePoints = curvesList[c]->getCurvePoints();
+		for (int p=0; p<curvePoints.size(); p++)
 		{
-			lastDistanceAt = distanceAt;
-			lastCurve = curCurve->getCurvePoints()[curPoint];
-			curPoint++;
-
-			if (curPoint >= curCurve->getCurvesCount())
-			{
-				// jump to next curve
-				curCurveIndex++;
-
-				// when jumping to the next curve, add the current segment to the list of segments
-				if (curCurvePoints.size() > 0)
-				{
-					m_curvePointSegments.push_back(curCurvePoints);
-					curCurvePoints.clear();
-
-					// prepare the next segment by setting/adding the starting point to the exact end point of the previous segment
-					// this also enables an optimization, namely that startcaps only have to be drawn [for every segment] if the startpoint != endpoint in the loop
-					if (m_curvePoints.size() > 0)
-						curCurvePoints.push_back(lastCurvePointForNextSegmentStart);
-				}
-
-				if (curCurveIndex < curvesList.size())
-				{
-					curCurve = curvesList[curCurveIndex];
-					curPoint = 0;
-				}
-				else
-				{
-					curPoint = curCurve->getCurvesCount() - 1;
-					if (lastDistanceAt == distanceAt)
-					{
-						// out of points even though the preferred distance hasn't been reached
-						break;
-					}
-				}
-			}
-			distanceAt += curCurve->getCurveDistances()[curPoint];
-		}
-		Vector2 thisCurve = curCurve->getCurvePoints()[curPoint];
-
-		// TODO: there's some major fuckery going on with the indices here, from the raw opsu curve code translation. fix that sometime
+			if (p == 0 && rawPoints.size() > 0 && curvePoints[p] == rawPoints[rawPoints.size()-1]) // the next curve usually starts where the previous one ended
+				continue;
 
-		// interpolate the point between the two closest distances
-		m_curvePoints.push_back(Vector2(0,0));
-		curCurvePoints.push_back(Vector2(0,0));
-		if (distanceAt - lastDistanceAt > 1)
-		{
-			float t = (prefDistance - lastDistanceAt) / (distanceAt - lastDistanceAt);
-			m_curvePoints[i] = Vector2(lerp<float>(lastCurve.x, thisCurve.x, t), lerp<float>(lastCurve.y, thisCurve.y, t));
+			rawDistances.push_back(rawPoints.size() > 0 ? rawDistances[rawDistances.size()-1] + (curvePoints[p] - rawPoints[rawPoints.size()-1]).length() : 0.0);
+			rawPoints.push_back(curvePoints[p]);
+			rawCurveIndices.push_back(c);
 		}
-		else
-			m_curvePoints[i] = thisCurve;
-
-		// add the point to the current segment (this is not using the lerp'd point! would cause mm mesh artifacts if it did)
-		lastCurvePointForNextSegmentStart = thisCurve;
-		curCurvePoints[curCurvePoints.size()-1] = thisCurve;
 	}
 
-	// if we only had one segment, no jump to any next curve has occurred (and therefore no insertion of the segment into the vector)
-	// manually add the lone segment here
-	if (curCurvePoints.size() > 0)
-		m_curvePointSegments.push_back(curCurvePoints);
-
-	// make sure that the uninterpolated segment points are exactly as long as the pixelLength
-	// this is necessary because we can't use the lerp'd points for the segments
-	float segmentedLength = 0.0f;
-	for (int s=0; s<m_curvePointSegments.size(); s++)
+	if (rawPoints.size() < 1)
 	{
-		for (int p=0; p<m_curvePointSegments[s].size(); p++)
-		{
-			segmentedLength += (p == 0) ? 0 : (m_curvePointSegments[s][p] - m_curvePointSegments[s][p-1]).length();
-		}
+		debugLog("OsuSliderCurveEqualDistanceMulti::init() Error: rawPoints.size() == 0!!!\n");
+		return;
 	}
-	// TODO: this is still incorrect. sliders are sometimes too long or start too late
-	if (segmentedLength > pixelLength)
+
+	// resample into equidistant points, the last one is at exactly pixelLength
+	// if the curves are shorter than the pixel length, then the last line is extended (like osu! does), if they are longer they are cut off
+	const int numSteps = std::max(m_iNCurve, 1);
+	m_curvePoints.reserve(numSteps + 1);
+	int rawIndex = 1;
+	int curCurveIndex = -1;
+	for (int i=0; i<numSteps+1; i++)
 	{
-		float excess = segmentedLength - pixelLength;
-		while (excess > 0)
+		const double distance = ((double)i * (double)m_fPixelLength) / (double)numSteps;
+
+		Vector2 point = rawPoints[0];
+		int curveIndex = rawCurveIndices[0];
+		if (rawPoints.size() > 1)
 		{
-			for (int s=m_curvePointSegments.size()-1; s>=0; s--)
+			while (rawIndex < rawPoints.size()-1 && rawDistances[rawIndex] < distance)
 			{
-				for (int p=m_curvePointSegments[s].size()-1; p>=0; p--)
-				{
-					const float curLength = (p == 0) ? 0 : (m_curvePointSegments[s][p] - m_curvePointSegments[s][p-1]).length();
-					if (curLength >= excess)
-					{
-						Vector2 segmentVector = (m_curvePointSegments[s][p] - m_curvePointSegments[s][p-1]).normalize();
-						m_curvePointSegments[s][p] = m_curvePointSegments[s][p] - segmentVector*excess;
-						excess = 0.0f;
-						break;
-					}
-					else
-					{
-						m_curvePointSegments[s].erase(m_curvePointSegments[s].begin() + p);
-						excess -= curLength;
-					}
-				}
+				rawIndex++;
 			}
+
+			const Vector2 &lastPoint = rawPoints[rawIndex - 1];
+			const Vector2 &nextPoint = rawPoints[rawIndex];
+			const double lineLength = rawDistances[rawIndex] - rawDistances[rawIndex - 1];
+			const double t = (lineLength > 0.0 ? (distance - rawDistances[rawIndex - 1]) / lineLength : 0.0); // t > 1 extends the last line
+
+			point = lastPoint + (nextPoint - lastPoint)*(float)t;
+			curveIndex = rawCurveIndices[rawIndex];
+		}
+
+		// a new segment starts at the previous point, so that consecutive segments are connected
+		if (curveIndex != curCurveIndex)
+		{
+			m_curvePointSegmentStarts.push_back(std::max(i - 1, 0));
+			curCurveIndex = curveIndex;
 		}
+
+		m_curvePoints.push_back(point);
 	}
 
+	buildLengthTable();
+
 	// calculate start and end angles for possible repeats (good enough and cheaper than calculating it live every frame)
 	Vector2 c1 = m_curvePoints[0];
 	int cnt = 1;
 	Vector2 c2 = m_curvePoints[cnt++];
-	while (cnt <= m_iNCurve && (c2-c1).length() < 1)
+	while (cnt <= numSteps && (c2-c1).length() < 1)
 	{
 		c2 = m_curvePoints[cnt++];
 	}
 	m_fStartAngle = (float) (atan2(c2.y - c1.y, c2.x - c1.x) * 180 / PI);
 
-	c1 = m_curvePoints[m_iNCurve];
-	cnt = m_iNCurve - 1;
+	c1 = m_curvePoints[numSteps];
+	cnt = numSteps - 1;
 	c2 = m_curvePoints[cnt--];
 	while (cnt >= 0 && (c2-c1).length() < 1)
 	{
 		c2 = m_curvePoints[cnt--];
 	}
 	m_fEndAngle = (float) (atan2(c2.y - c1.y, c2.x - c1.x) * 180 / PI);
-
-	// backup (for dynamic updateStackPosition() recalculation)
-	m_originalCurvePoints = m_curvePoints;
-	m_originalCurvePointSegments = m_curvePointSegments;
-}
-
-Vector2 OsuSliderCurveEqualDistanceMulti::pointAt(float t)
-{
-	if (m_curvePoints.size() < 1) // this might happen
-		return Vector2(0,0);
-
-	float indexF = t * m_iNCurve;
-	int index = (int) indexF;
-	if (index >= m_iNCurve)
-		return m_curvePoints[m_iNCurve];
-	else
-	{
-		Vector2 poi = m_curvePoints[index];
-		Vector2 poi2 = m_curvePoints[index + 1];
-		float t2 = indexF - index;
-		return Vector2(lerp(poi.x, poi2.x, t2), lerp(poi.y, poi2.y, t2));
-	}
-}
-
-Vector2 OsuSliderCurveEqualDistanceMulti::originalPointAt(float t)
-{
-	if (m_originalCurvePoints.size() < 1) // this might happen
-		return Vector2(0,0);
-
-	float indexF = t * m_iNCurve;
-	int index = (int) indexF;
-	if (index >= m_iNCurve)
-		return m_originalCurvePoints[m_iNCurve];
-	else
-	{
-		Vector2 poi = m_originalCurvePoints[index];
-		Vector2 poi2 = m_originalCurvePoints[index + 1];
-		float t2 = indexF - index;
-		return Vector2(lerp(poi.x, poi2.x, t2), lerp(poi.y, poi2.y, t2));
-	}
 }
 
 
@@ -1754,3 +1952,114 @@ std::vector<Vector2> BezierApproximator::createBezier()
 	output.push_back(m_controlPoints[m_iCount - 1]);
 	return output;
 }
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+void OsuSliderCurve::test()
+{
+	// arc length accuracy against curves with analytically known points
+	struct TESTCASE
+	{
+		const char *name;
+		char type;
+		std::vector<Vector2> points;
+		float pixelLength;
+		float t;
+		Vector2 expected;
+	};
+	const float halfCircle = PI*100.0f;
+	std::vector<TESTCASE> cases;
+	cases.push_back({"line, middle", OsuSlider::SLIDER_LINEAR, {Vector2(0,0), Vector2(100,0)}, 100.0f, 0.5f, Vector2(50,0)});
+	cases.push_back({"line, end", OsuSlider::SLIDER_LINEAR, {Vector2(0,0), Vector2(100,0)}, 100.0f, 1.0f, Vector2(100,0)});
+	cases.push_back({"line, trimmed end", OsuSlider::SLIDER_LINEAR, {Vector2(0,0), Vector2(100,0)}, 80.0f, 1.0f, Vector2(80,0)});
+	cases.push_back({"line, extended end", OsuSlider::SLIDER_LINEAR, {Vector2(0,0), Vector2(100,0)}, 130.0f, 1.0f, Vector2(130,0)});
+	cases.push_back({"odd length line, end", OsuSlider::SLIDER_LINEAR, {Vector2(0,0), Vector2(0,333.3f)}, 333.3f, 1.0f, Vector2(0,333.3f)});
+	cases.push_back({"polyline, corner", OsuSlider::SLIDER_LINEAR, {Vector2(0,0), Vector2(100,0), Vector2(100,100)}, 150.0f, 100.0f/150.0f, Vector2(100,0)});
+	cases.push_back({"polyline, trimmed end", OsuSlider::SLIDER_LINEAR, {Vector2(0,0), Vector2(100,0), Vector2(100,100)}, 150.0f, 1.0f, Vector2(100,50)});
+	cases.push_back({"bezier red points, end", OsuSlider::SLIDER_BEZIER, {Vector2(0,0), Vector2(100,0), Vector2(100,0), Vector2(100,100)}, 175.0f, 1.0f, Vector2(100,75)});
+	cases.push_back({"half circle, middle", OsuSlider::SLIDER_PASSTHROUGH, {Vector2(0,100), Vector2(100,0), Vector2(200,100)}, halfCircle, 0.5f, Vector2(100,0)});
+	cases.push_back({"half circle, end", OsuSlider::SLIDER_PASSTHROUGH, {Vector2(0,100), Vector2(100,0), Vector2(200,100)}, halfCircle, 1.0f, Vector2(200,100)});
+	cases.push_back({"quarter circle, end", OsuSlider::SLIDER_PASSTHROUGH, {Vector2(0,100), Vector2(100,0), Vector2(200,100)}, halfCircle/2.0f, 1.0f, Vector2(100,0)});
+
+	const float tolerance = 0.01f;
+	int numFailed = 0;
+	for (int i=0; i<cases.size(); i++)
+	{
+		OsuSliderCurve *curve = OsuSliderCurve::createCurve(cases[i].type, cases[i].points, cases[i].pixelLength, NULL);
+
+		const Vector2 result = curve->pointAt(cases[i].t);
+		const float lengthError = std::abs(curve->getLength() - cases[i].pixelLength);
+		const bool passed = (result - cases[i].expected).length() < tolerance && (cases[i].type == OsuSlider::SLIDER_PASSTHROUGH || lengthError < tolerance); // circles are approximated by chords, but answered analytically
+		if (!passed)
+			numFailed++;
+
+		debugLog("osu_slider_curve_test: %s %s\n", passed ? "PASSED" : "FAILED", cases[i].name);
+		if (!passed)
+			debugLog("osu_slider_curve_test:    expected (%f, %f), got (%f, %f), length error = %f\n", cases[i].expected.x, cases[i].expected.y, result.x, result.y, lengthError);
+
+		delete curve;
+	}
+	debugLog("osu_slider_curve_test: %i/%i passed\n", (int)cases.size() - numFailed, (int)cases.size());
+
+	// construction time + memory of a typical bezier slider, and the cost of pointAt()
+	std::vector<Vector2> points;
+	points.push_back(Vector2(50,50));
+	points.push_back(Vector2(150,300));
+	points.push_back(Vector2(300,50));
+	points.push_back(Vector2(450,300));
+	points.push_back(Vector2(500,100));
+
+	const int numCurves = 1000;
+	Timer t;
+	t.start();
+	unsigned long memory = 0;
+	int numCurvePoints = 0;
+	for (int i=0; i<numCurves; i++)
+	{
+		OsuSliderCurve *curve = OsuSliderCurve::createCurve(OsuSlider::SLIDER_BEZIER, points, 600.0f, NULL);
+		memory = curve->getMemoryUsage();
+		numCurvePoints = curve->getPoints().size();
+		delete curve;
+	}
+	t.update();
+	debugLog("osu_slider_curve_test: construction = %f ms per curve, %i points, %lu bytes (previously ~%lu bytes, with the original and segment copies)\n", (t.getElapsedTime() / numCurves)*1000.0, numCurvePoints, memory, memory + 3*numCurvePoints*sizeof(Vector2) - numCurvePoints*sizeof(float));
+
+	OsuSliderCurve *curve = OsuSliderCurve::createCurve(OsuSlider::SLIDER_BEZIER, points, 600.0f, NULL);
+	const std::vector<Vector2> &curvePoints = curve->getPoints();
+	const int numQueries = 1000000;
+
+	t.start();
+	Vector2 sum(0, 0);
+	for (int i=0; i<numQueries; i++)
+	{
+		sum = sum + curve->pointAt((float)((i * 7919) % numQueries) / (float)numQueries);
+	}
+	t.update();
+	const double binarySearchTime = t.getElapsedTime();
+
+	// reference: walking the points from the start
+	t.start();
+	Vector2 sum2(0, 0);
+	for (int i=0; i<numQueries; i++)
+	{
+		const float distance = ((float)((i * 7919) % numQueries) / (float)numQueries) * curve->getLength();
+		float curDistance = 0.0f;
+		int p = 1;
+		while (p < curvePoints.size()-1 && curDistance + (curvePoints[p] - curvePoints[p-1]).length() < distance)
+		{
+			curDistance += (curvePoints[p] - curvePoints[p-1]).length();
+			p++;
+		}
+		sum2 = sum2 + curvePoints[p];
+	}
+	t.update();
+	const double walkTime = t.getElapsedTime();
+
+	debugLog("osu_slider_curve_test: pointAt() = %f ns (binary search), %f ns (walk) (%f, %f)\n", (binarySearchTime / numQueries)*1000000000.0, (walkTime / numQueries)*1000000000.0, sum.x + sum2.x, sum.y + sum2.y);
+
+	delete curve;
+}
@@ -9,6 +9,7 @@
 #define OSUSLIDER_H
 
 #include "OsuHitObject.h"
+#include "OsuBeatmapDifficulty.h"
 
 class OsuSliderCurve;
 class OsuSliderCurveEqualDistanceMulti;
@@ -28,7 +29,7 @@ public:
 	};
 
 public:
-	OsuSlider(char type, int repeat, float pixelLength, std::vector<Vector2> points, std::vector<int> hitSounds, std::vector<float> ticks, float sliderTime, float sliderTimeWithoutRepeats, long time, int sampleType, int comboNumber, int colorCounter, OsuBeatmap *beatmap);
+	OsuSlider(char type, int repeat, float pixelLength, std::vector<Vector2> points, std::vector<int> hitSounds, std::vector<float> ticks, std::vector<OsuBeatmapDifficulty::SLIDER_EVENT> events, float sliderTime, float sliderTimeWithoutRepeats, long time, int sampleType, int comboNumber, int colorCounter, OsuBeatmap *beatmap);
 	virtual ~OsuSlider();
 
 	virtual void draw(Graphics *g);
@@ -44,6 +45,9 @@ public:
 	virtual void onClickEvent(Vector2 cursorPos, std::vector<OsuBeatmap::CLICK> &clicks);
 	virtual void onReset(long curPos);
 
+	virtual bool getProgress(long curPos, PROGRESS *progress) const;
+	virtual void onRestore(long curPos, bool finished, const PROGRESS *progress);
+
 	inline int getRepeat() const {return m_iRepeat;}
 	inline std::vector<Vector2> getRawPoints() const {return m_points;}
 	inline float getPixelLength() const {return m_fPixelLength;}
@@ -59,13 +63,14 @@ private:
 	void updateAnimations(long curPos);
 
 	void onHit(OsuScore::HIT result, long delta, bool startOrEnd, float targetDelta = 0.0f, float targetAngle = 0.0f);
-	void onRepeatHit(bool successful, bool sliderend);
-	void onTickHit(bool successful, int tickIndex);
+	void onRepeatHit(bool successful, bool sliderend, long time); // time = of the repeat/tick event, for the hit sound
+	void onTickHit(bool successful, long time);
 	void onSliderBreak();
 
 	float getT(long pos, bool raw);
 
 	OsuSliderCurve *m_curve;
+	std::vector<Vector2> m_screenPoints; // reused every frame
 
 	char m_cType;
 	int m_iRepeat;
@@ -82,16 +87,12 @@ private:
 	};
 	std::vector<SLIDERTICK> m_ticks; // ticks (drawing)
 
-	struct SLIDERCLICK
-	{
-		long time;
-		bool finished;
-		bool successful;
-		bool sliderend;
-		int type;
-		int tickIndex;
-	};
-	std::vector<SLIDERCLICK> m_clicks; // repeats (type 0) + ticks (type 1)
+	std::vector<OsuBeatmapDifficulty::SLIDER_EVENT> m_events; // head, ticks, repeats, tail (sorted by time)
+	int m_iNextEvent; // all events before this one have already been handled
+	int m_iNumJudgedEvents; // ticks + repeats
+	int m_iNumSuccessfulEvents;
+	int m_iLastRepeatStartEventIndex; // for drawing the repeat circles
+	int m_iLastRepeatEndEventIndex;
 
 	float m_fSlidePercent; // 0.0f - 1.0f - 0.0f - 1.0f - etc.
 	float m_fActualSlidePercent; // 0.0f - 1.0f
@@ -135,34 +136,48 @@ private:
 class OsuSliderCurve
 {
 public:
-	OsuSliderCurve(OsuSlider *parent, OsuBeatmap *beatmap);
+	static OsuSliderCurve *createCurve(char type, std::vector<Vector2> points, float pixelLength, OsuBeatmap *beatmap); // type is an OsuSlider::SLIDERTYPE
+	static void calculateOriginalPointsAt(char type, const std::vector<Vector2> &points, float pixelLength, const float *t, Vector2 *result, int count); // same as createCurve()->originalPointAt(t[i]) (up to float rounding), but without building the curve
+	static void test(); // analytically known points, arc length trim/extension + construction/pointAt() benchmark (osu_slider_curve_test)
+
+	OsuSliderCurve(std::vector<Vector2> points, float pixelLength, OsuBeatmap *beatmap);
 	virtual ~OsuSliderCurve() {;}
 
 	virtual void updateStackPosition(float stackMulStackOffset);
 
-	virtual Vector2 pointAt(float t) = 0;
-	virtual Vector2 originalPointAt(float t) = 0;
+	virtual Vector2 pointAt(float t); // binary search in the arc length table, t is the percentage of the total length
+	virtual Vector2 originalPointAt(float t); // without the stack offset
 
 	inline float getStartAngle() const {return m_fStartAngle;}
 	inline float getEndAngle() const {return m_fEndAngle;}
+	inline float getLength() const {return (m_curvePointLengths.size() > 0 ? m_curvePointLengths[m_curvePointLengths.size()-1] : 0.0f);}
+
+	inline const std::vector<Vector2> &getPoints() const {return m_curvePoints;}
+	const std::vector<std::vector<Vector2>> &getPointSegments(); // built on demand (nothing uses them by default)
 
-	inline std::vector<Vector2> getPoints() {return m_curvePoints;}
-	inline std::vector<std::vector<Vector2>> getPointSegments() {return m_curvePointSegments;}
+	unsigned long getMemoryUsage() const; // in bytes, approximately
 
 protected:
 	static float CURVE_POINTS_SEPERATION;
 
+	static bool isCircumscribedCircle(char type, const std::vector<Vector2> &points); // passthrough sliders with 3 points which don't lie on a line
+
+	void buildLengthTable(); // must be called by the subclasses after m_curvePoints has been set
+
 	OsuBeatmap *m_beatmap;
-	OsuSlider *m_slider;
 	std::vector<Vector2> m_points;
+	float m_fPixelLength;
 
 	// these must be explicitely set in one of the subclasses
-	std::vector<std::vector<Vector2>> m_curvePointSegments;
-	std::vector<std::vector<Vector2>> m_originalCurvePointSegments;
-	std::vector<Vector2> m_curvePoints;
-	std::vector<Vector2> m_originalCurvePoints;
+	std::vector<Vector2> m_curvePoints; // equidistant, this is what the slider renderer expects for snaking
+	std::vector<int> m_curvePointSegmentStarts; // indices into m_curvePoints, one for every curve type (segment)
 	float m_fStartAngle;
 	float m_fEndAngle;
+
+private:
+	std::vector<float> m_curvePointLengths; // cumulative arc length at every point of m_curvePoints
+	std::vector<std::vector<Vector2>> m_curvePointSegments; // cache for getPointSegments()
+	Vector2 m_vStackOffset; // currently applied to m_curvePoints
 };
 
 
@@ -182,8 +197,8 @@ public:
 
 	virtual Vector2 pointAt(float t) = 0;
 
-	inline std::vector<Vector2> getCurvePoints() const {return m_points;}
-	inline std::vector<float> getCurveDistances() const {return m_curveDistances;}
+	inline const std::vector<Vector2> &getCurvePoints() const {return m_points;}
+	inline const std::vector<float> &getCurveDistances() const {return m_curveDistances;}
 	inline float getTotalDistance() const {return m_fTotalDistance;}
 	inline int getCurvesCount() const {return m_iNCurve;}
 
@@ -234,13 +249,10 @@ private:
 class OsuSliderCurveEqualDistanceMulti : public OsuSliderCurve
 {
 public:
-	OsuSliderCurveEqualDistanceMulti(OsuSlider *parent, OsuBeatmap *beatmap);
+	OsuSliderCurveEqualDistanceMulti(std::vector<Vector2> points, float pixelLength, OsuBeatmap *beatmap);
 	virtual ~OsuSliderCurveEqualDistanceMulti() {;}
 
-	void init(std::vector<OsuSliderCurveType*> curvesList);
-
-	Vector2 pointAt(float t);
-	Vector2 originalPointAt(float t);
+	void init(const std::vector<OsuSliderCurveType*> &curvesList);
 
 private:
 	int m_iNCurve;
@@ -250,28 +262,34 @@ private:
 class OsuSliderCurveLinearBezier : public OsuSliderCurveEqualDistanceMulti
 {
 public:
-	OsuSliderCurveLinearBezier(OsuSlider *parent, bool line, OsuBeatmap *beatmap);
+	OsuSliderCurveLinearBezier(std::vector<Vector2> points, float pixelLength, bool line, OsuBeatmap *beatmap);
+
+	static std::vector<OsuSliderCurveType*> createBeziers(const std::vector<Vector2> &points, bool line); // the caller must delete them
 };
 
 class OsuSliderCurveCatmull : public OsuSliderCurveEqualDistanceMulti
 {
 public:
-	OsuSliderCurveCatmull(OsuSlider *parent, OsuBeatmap *beatmap);
+	OsuSliderCurveCatmull(std::vector<Vector2> points, float pixelLength, OsuBeatmap *beatmap);
+
+	static std::vector<OsuSliderCurveType*> createCatmulls(const std::vector<Vector2> &points); // the caller must delete them
 };
 
 class OsuSliderCurveCircumscribedCircle : public OsuSliderCurve
 {
 public:
-	OsuSliderCurveCircumscribedCircle(OsuSlider *parent, OsuBeatmap *beatmap);
+	OsuSliderCurveCircumscribedCircle(std::vector<Vector2> points, float pixelLength, OsuBeatmap *beatmap);
 
 	Vector2 pointAt(float t);
 	Vector2 originalPointAt(float t);
 
 	void updateStackPosition(float stackMulStackOffset); // must also override this, due to the custom pointAt() function!
 
+	static bool calculateArc(const std::vector<Vector2> &points, float pixelLength, Vector2 *center, float *radius, float *startAngle, float *endAngle); // false if the points don't describe an arc
+
 private:
-	Vector2 intersect(Vector2 a, Vector2 ta, Vector2 b, Vector2 tb);
-	bool isIn(float a, float b, float c);
+	static Vector2 intersect(Vector2 a, Vector2 ta, Vector2 b, Vector2 tb);
+	static bool isIn(float a, float b, float c);
 
 	Vector2 m_vCircleCenter;
 	Vector2 m_vOriginalCircleCenter;
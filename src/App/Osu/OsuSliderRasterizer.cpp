@@ -0,0 +1,511 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		cpu version of OsuSliderRenderer, for golden images and thumbnails
+//
+// $NoKeywords: $osusliderrast
+//===============================================================================//
+
+#include "OsuSliderRasterizer.h"
+
+#include "Engine.h"
+#include "ResourceManager.h"
+#include "ConVar.h"
+#include "Timer.h"
+
+#include "Osu.h"
+#include "OsuSkin.h"
+#include "OsuBeatmap.h"
+#include "OsuSlider.h"
+
+#include <fstream>
+
+ConVar osu_slider_rasterizer_golden_dir("osu_slider_rasterizer_golden_dir", "goldens/", "Folder in which osu_slider_rasterizer_test compares against golden images (see README.txt in there)");
+ConVar osu_slider_rasterizer_write_points("osu_slider_rasterizer_write_points", false, "If enabled, osu_slider_rasterizer_test writes the input of make_slider_goldens.py (curve points and style of every test case) into the golden folder instead of comparing");
+
+float OsuSliderRasterizer::SIMPLIFY_TOLERANCE = 0.1f; // in pixels, about the error of the 42-gon cones of OsuSliderRenderer
+
+extern ConVar osu_slider_alpha_multiplier;
+extern ConVar osu_slider_body_alpha_multiplier;
+extern ConVar osu_slider_body_color_saturation;
+extern ConVar osu_slider_border_size_multiplier;
+extern ConVar osu_slider_border_tint_combo_color;
+extern ConVar osu_slider_osu_next_style;
+
+OsuSliderRasterizer::STYLE OsuSliderRasterizer::getStyle(Osu *osu, Color color)
+{
+	STYLE style;
+	style.borderColor = osu_slider_border_tint_combo_color.getBool() ? color : osu->getSkin()->getSliderBorderColor();
+	style.bodyColor = osu->getSkin()->isSliderTrackOverridden() ? osu->getSkin()->getSliderTrackOverride() : color;
+	style.osuNextStyle = osu_slider_osu_next_style.getBool();
+	style.bodyAlphaMultiplier = osu_slider_body_alpha_multiplier.getFloat();
+	style.bodyColorSaturation = osu_slider_body_color_saturation.getFloat();
+	style.borderSizeMultiplier = osu_slider_border_size_multiplier.getFloat();
+	style.alphaMultiplier = osu_slider_alpha_multiplier.getFloat();
+	return style;
+}
+
+void OsuSliderRasterizer::draw(std::vector<unsigned char> *rgba, int width, int height, const std::vector<Vector2> &points, float hitcircleDiameter, float from, float to, const STYLE &style, float alpha)
+{
+	rgba->assign(width*height*4, 0);
+	if (style.alphaMultiplier <= 0.0f || alpha <= 0.0f || width < 1 || height < 1)
+		return;
+
+	// the same snaking limits as OsuSliderRenderer::draw()
+	const int drawFromIndex = clamp<int>((int)std::round(points.size() * from), 0, points.size());
+	const int drawUpToIndex = clamp<int>((int)std::round(points.size() * to), 0, points.size());
+	if (drawUpToIndex <= drawFromIndex)
+		return;
+
+	// "depth buffer": the highest cone at every pixel, i.e. 1 - (distance to the curve)/radius, < 0 where nothing was drawn
+	static std::vector<float> depth;
+	depth.assign(width*height, -1.0f);
+
+	// the curve points are only a few pixels apart, stamping every one of them would touch each pixel dozens of times
+	// so the drawn part is simplified first, which moves the distance to the curve by at most SIMPLIFY_TOLERANCE
+	static std::vector<Vector2> simplified;
+	simplified.clear();
+	simplified.push_back(points[drawFromIndex]);
+	int lastKept = drawFromIndex;
+	for (int i=drawFromIndex+1; i<drawUpToIndex; i++)
+	{
+		if (i+1 < drawUpToIndex && canSkip(points, lastKept, i+1))
+			continue;
+
+		simplified.push_back(points[i]);
+		lastKept = i;
+	}
+
+	const float radius = hitcircleDiameter/2.0f;
+	if (simplified.size() == 1)
+		stampSegment(&depth[0], width, height, simplified[0], simplified[0], radius);
+	for (int i=1; i<simplified.size(); i++)
+	{
+		stampSegment(&depth[0], width, height, simplified[i-1], simplified[i], radius);
+	}
+
+	// the fragment shader only depends on the texture coordinate, so it is evaluated once per lut entry instead of once per pixel
+	unsigned char lut[SHADE_LUT_SIZE*4];
+	buildShadeLUT(style, alpha, lut);
+
+	unsigned char *out = &(*rgba)[0];
+	for (int i=0; i<width*height; i++)
+	{
+		if (depth[i] < 0.0f)
+			continue;
+
+		const unsigned char *color = &lut[clamp<int>((int)(depth[i]*(SHADE_LUT_SIZE-1) + 0.5f), 0, SHADE_LUT_SIZE-1)*4];
+		out[i*4 + 0] = color[0];
+		out[i*4 + 1] = color[1];
+		out[i*4 + 2] = color[2];
+		out[i*4 + 3] = color[3];
+	}
+}
+
+void OsuSliderRasterizer::buildShadeLUT(const STYLE &style, float alpha, unsigned char *lut)
+{
+	const float alphaMultiplier = alpha*style.alphaMultiplier; // the framebuffer is drawn with this alpha
+
+	for (int i=0; i<SHADE_LUT_SIZE; i++)
+	{
+		float color[4];
+		shade(style, (float)i / (float)(SHADE_LUT_SIZE-1), color);
+		color[3] *= alphaMultiplier;
+
+		for (int c=0; c<4; c++)
+		{
+			lut[i*4 + c] = (unsigned char)(clamp<float>(color[c], 0.0f, 1.0f)*255.0f + 0.5f);
+		}
+	}
+}
+
+void OsuSliderRasterizer::shade(const STYLE &style, float texcoord, float *out)
+{
+	// port of slider.fsh, keep these two in sync
+	const float defaultTransitionSize = 0.011f;
+	const float defaultBorderSize = 0.11f;
+	const float outerShadowSize = 0.08f;
+
+	const float borderSize = defaultBorderSize*style.borderSizeMultiplier;
+	const float transitionSize = defaultTransitionSize;
+
+	// dynamic color calculations
+	float borderColor[4] = {COLOR_GET_Rf(style.borderColor), COLOR_GET_Gf(style.borderColor), COLOR_GET_Bf(style.borderColor), 1.0f};
+	const float bodyColor[4] = {COLOR_GET_Rf(style.bodyColor), COLOR_GET_Gf(style.bodyColor), COLOR_GET_Bf(style.bodyColor), 0.7f*style.bodyAlphaMultiplier};
+	const float outerShadowColor[4] = {0.0f, 0.0f, 0.0f, 0.25f};
+	float innerBodyColor[4];
+	float outerBodyColor[4];
+	{
+		const float brightnessMultiplier = 0.25f;
+		const float darknessMultiplier = 0.1f;
+		for (int c=0; c<3; c++)
+		{
+			innerBodyColor[c] = std::min(1.0f, bodyColor[c] * (1.0f + 0.5f * brightnessMultiplier) + brightnessMultiplier) * style.bodyColorSaturation;
+			outerBodyColor[c] = std::min(1.0f, bodyColor[c] / (1.0f + darknessMultiplier)) * style.bodyColorSaturation;
+		}
+		innerBodyColor[3] = bodyColor[3];
+		outerBodyColor[3] = bodyColor[3];
+	}
+
+	// osu!next style color modifications
+	if (style.osuNextStyle)
+	{
+		for (int c=0; c<3; c++)
+		{
+			outerBodyColor[c] = bodyColor[c] * style.bodyColorSaturation;
+			innerBodyColor[c] = bodyColor[c] * 0.5f * style.bodyColorSaturation;
+		}
+		outerBodyColor[3] = 1.0f*style.bodyAlphaMultiplier;
+		innerBodyColor[3] = 0.0f;
+	}
+
+	// a bit of a hack, but better than rough edges
+	if (style.borderSizeMultiplier < 0.01f)
+	{
+		for (int c=0; c<4; c++)
+		{
+			borderColor[c] = outerShadowColor[c];
+		}
+	}
+
+	// conditional variant (the same gaps at the exact band edges as the shader, where it stays transparent)
+	const float transparent[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+	const float *from = transparent;
+	const float *to = transparent;
+	float delta = 0.0f;
+	if (texcoord < outerShadowSize - transitionSize) // just shadow
+	{
+		delta = texcoord / (outerShadowSize - transitionSize);
+		from = transparent;
+		to = outerShadowColor;
+	}
+	if (texcoord > outerShadowSize - transitionSize && texcoord < outerShadowSize + transitionSize) // shadow + border
+	{
+		delta = (texcoord - outerShadowSize + transitionSize) / (2.0f*transitionSize);
+		from = outerShadowColor;
+		to = borderColor;
+	}
+	if (texcoord > outerShadowSize + transitionSize && texcoord < outerShadowSize + borderSize - transitionSize) // just border
+	{
+		delta = 0.0f;
+		from = borderColor;
+		to = borderColor;
+	}
+	if (texcoord > outerShadowSize + borderSize - transitionSize && texcoord < outerShadowSize + borderSize + transitionSize) // border + outer body
+	{
+		delta = (texcoord - outerShadowSize - borderSize + transitionSize) / (2.0f*transitionSize);
+		from = borderColor;
+		to = outerBodyColor;
+	}
+	if (texcoord > outerShadowSize + borderSize + transitionSize) // outer body + inner body
+	{
+		const float size = outerShadowSize + borderSize + transitionSize;
+		delta = ((texcoord - size) / (1.0f-size));
+		from = outerBodyColor;
+		to = innerBodyColor;
+	}
+
+	for (int c=0; c<4; c++)
+	{
+		out[c] = from[c] + (to[c] - from[c])*delta;
+	}
+}
+
+bool OsuSliderRasterizer::canSkip(const std::vector<Vector2> &points, int start, int end)
+{
+	// true if every point between start and end is within SIMPLIFY_TOLERANCE of the line from start to end
+	const Vector2 a = points[start];
+	const float abX = points[end].x - a.x;
+	const float abY = points[end].y - a.y;
+	const float abLength = std::sqrt(abX*abX + abY*abY);
+	for (int i=start+1; i<end; i++)
+	{
+		const float apX = points[i].x - a.x;
+		const float apY = points[i].y - a.y;
+		const float projection = (abLength > 0.0f ? (apX*abX + apY*abY) / abLength : 0.0f);
+		const float distance = (abLength > 0.0f ? std::abs(apX*abY - apY*abX) / abLength : std::sqrt(apX*apX + apY*apY));
+		if (distance > SIMPLIFY_TOLERANCE || projection < 0.0f || projection > abLength) // no folding back onto itself either
+			return false;
+	}
+	return true;
+}
+
+void OsuSliderRasterizer::stampSegment(float *depth, int width, int height, Vector2 a, Vector2 b, float radius)
+{
+	if (radius <= 0.0f)
+		return;
+
+	const int minX = std::max(0, (int)std::floor(std::min(a.x, b.x) - radius));
+	const int maxX = std::min(width-1, (int)std::ceil(std::max(a.x, b.x) + radius));
+	const int minY = std::max(0, (int)std::floor(std::min(a.y, b.y) - radius));
+	const int maxY = std::min(height-1, (int)std::ceil(std::max(a.y, b.y) + radius));
+
+	const float abX = b.x - a.x;
+	const float abY = b.y - a.y;
+	const float abLengthSquared = abX*abX + abY*abY;
+	const float invRadius = 1.0f / radius;
+
+	for (int y=minY; y<=maxY; y++)
+	{
+		const float py = y + 0.5f;
+		float *row = &depth[y*width];
+		for (int x=minX; x<=maxX; x++)
+		{
+			const float px = x + 0.5f;
+
+			// distance to the segment (the union of all circle stamps between a and b)
+			float t = 0.0f;
+			if (abLengthSquared > 0.0f)
+				t = clamp<float>(((px - a.x)*abX + (py - a.y)*abY) / abLengthSquared, 0.0f, 1.0f);
+			const float dx = px - (a.x + abX*t);
+			const float dy = py - (a.y + abY*t);
+
+			const float cone = 1.0f - std::sqrt(dx*dx + dy*dy)*invRadius;
+			if (cone >= 0.0f && cone > row[x])
+				row[x] = cone;
+		}
+	}
+}
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+struct SLIDER_RASTERIZER_TEST_CASE
+{
+	const char *name;
+	char type;
+	float pixelLength;
+	Vector2 points[5];
+	int numPoints;
+	float from;
+	float to;
+	bool osuNextStyle;
+	float borderSizeMultiplier;
+};
+
+static bool sliderRasterizerTestReadGolden(UString filePath, std::vector<unsigned char> *rgba)
+{
+	std::ifstream in(filePath.toUtf8(), std::ios::in | std::ios::binary | std::ios::ate);
+	if (!in.good())
+		return false;
+
+	const std::streamsize size = in.tellg();
+	in.seekg(0, std::ios::beg);
+	rgba->resize(size);
+	return size > 0 && in.read((char*)&(*rgba)[0], size).good();
+}
+
+static bool sliderRasterizerTestWritePoints(UString filePath, int width, int height, const std::vector<Vector2> &points, float hitcircleDiameter, float from, float to, const OsuSliderRasterizer::STYLE &style)
+{
+	FILE *file = fopen(filePath.toUtf8(), "w");
+	if (file == NULL)
+		return false;
+
+	fprintf(file, "size %i %i\n", width, height);
+	fprintf(file, "diameter %.9g\n", hitcircleDiameter);
+	fprintf(file, "snake %.9g %.9g\n", from, to);
+	fprintf(file, "style %i %.9g %.9g %.9g %.9g\n", style.osuNextStyle ? 1 : 0, style.bodyAlphaMultiplier, style.bodyColorSaturation, style.borderSizeMultiplier, style.alphaMultiplier);
+	fprintf(file, "border %i %i %i\n", (int)COLOR_GET_Ri(style.borderColor), (int)COLOR_GET_Gi(style.borderColor), (int)COLOR_GET_Bi(style.borderColor));
+	fprintf(file, "body %i %i %i\n", (int)COLOR_GET_Ri(style.bodyColor), (int)COLOR_GET_Gi(style.bodyColor), (int)COLOR_GET_Bi(style.bodyColor));
+	fprintf(file, "points %i\n", (int)points.size());
+	for (int i=0; i<points.size(); i++)
+	{
+		fprintf(file, "%.9g %.9g\n", points[i].x, points[i].y);
+	}
+
+	const bool success = (ferror(file) == 0);
+	fclose(file);
+	return success;
+}
+
+void OsuSliderRasterizer::test(OsuBeatmap *beatmap)
+{
+	const int width = 640;
+	const int height = 480;
+	const Vector2 offset = Vector2(64, 48); // osu!pixels are buffer pixels, centered
+	const float hitcircleDiameter = 72.96f; // CS 4
+
+	const SLIDER_RASTERIZER_TEST_CASE testCases[] =
+	{
+		{"linear",			OsuSlider::SLIDER_LINEAR,		400.0f, {Vector2(56, 192), Vector2(456, 192)}, 2, 0.0f, 1.0f, false, 1.0f},
+		{"linear_corner",	OsuSlider::SLIDER_LINEAR,		500.0f, {Vector2(56, 300), Vector2(256, 80), Vector2(456, 300)}, 3, 0.0f, 1.0f, false, 1.0f},
+		{"bezier",			OsuSlider::SLIDER_BEZIER,		450.0f, {Vector2(56, 300), Vector2(150, 40), Vector2(360, 360), Vector2(456, 80)}, 4, 0.0f, 1.0f, false, 1.0f},
+		{"bezier_loop",		OsuSlider::SLIDER_BEZIER,		600.0f, {Vector2(100, 300), Vector2(450, 50), Vector2(50, 50), Vector2(400, 300)}, 4, 0.0f, 1.0f, false, 1.0f},
+		{"catmull",			OsuSlider::SLIDER_CATMULL,		500.0f, {Vector2(56, 192), Vector2(180, 60), Vector2(330, 320), Vector2(456, 192)}, 4, 0.0f, 1.0f, false, 1.0f},
+		{"perfect",			OsuSlider::SLIDER_PASSTHROUGH,	450.0f, {Vector2(96, 280), Vector2(256, 100), Vector2(416, 280)}, 3, 0.0f, 1.0f, false, 1.0f},
+		{"snaking_in",		OsuSlider::SLIDER_BEZIER,		450.0f, {Vector2(56, 300), Vector2(150, 40), Vector2(360, 360), Vector2(456, 80)}, 4, 0.0f, 0.4f, false, 1.0f},
+		{"snaking_out",		OsuSlider::SLIDER_BEZIER,		450.0f, {Vector2(56, 300), Vector2(150, 40), Vector2(360, 360), Vector2(456, 80)}, 4, 0.6f, 1.0f, false, 1.0f},
+		{"osu_next",		OsuSlider::SLIDER_PASSTHROUGH,	450.0f, {Vector2(96, 280), Vector2(256, 100), Vector2(416, 280)}, 3, 0.0f, 1.0f, true, 1.0f},
+		{"no_border",		OsuSlider::SLIDER_PASSTHROUGH,	450.0f, {Vector2(96, 280), Vector2(256, 100), Vector2(416, 280)}, 3, 0.0f, 1.0f, false, 0.0f},
+		{"thick_border",	OsuSlider::SLIDER_PASSTHROUGH,	450.0f, {Vector2(96, 280), Vector2(256, 100), Vector2(416, 280)}, 3, 0.0f, 1.0f, false, 2.5f}
+	};
+	const int numTestCases = sizeof(testCases)/sizeof(testCases[0]);
+
+	// fixed colors, so that the goldens don't depend on the skin or the convars
+	STYLE baseStyle;
+	baseStyle.borderColor = 0xffffffff;
+	baseStyle.bodyColor = COLOR(255, 255, 128, 0);
+	baseStyle.osuNextStyle = false;
+	baseStyle.bodyAlphaMultiplier = 1.0f;
+	baseStyle.bodyColorSaturation = 1.0f;
+	baseStyle.borderSizeMultiplier = 1.0f;
+	baseStyle.alphaMultiplier = 1.0f;
+
+	// the goldens are not from this rasterizer, but from goldens/make_slider_goldens.py: what OsuSliderRenderer makes the gpu do (42-gon cones at every curve point, slider.fsh per pixel)
+	// the pngs of this rasterizer's output go into screenshots/, for comparing them against the goldens or against ingame screenshots by eye
+	const UString goldenDir = osu_slider_rasterizer_golden_dir.getString();
+	const bool writePoints = osu_slider_rasterizer_write_points.getBool();
+
+	int numPassed = 0;
+	int numWritten = 0;
+	std::vector<std::vector<Vector2>> allScreenPoints;
+	std::vector<unsigned char> rgba;
+	std::vector<unsigned char> golden;
+	std::vector<unsigned char> rgb;
+	for (int t=0; t<numTestCases; t++)
+	{
+		const SLIDER_RASTERIZER_TEST_CASE &testCase = testCases[t];
+
+		std::vector<Vector2> controlPoints(testCase.points, testCase.points + testCase.numPoints);
+		OsuSliderCurve *curve = OsuSliderCurve::createCurve(testCase.type, controlPoints, testCase.pixelLength, beatmap);
+		std::vector<Vector2> screenPoints = curve->getPoints();
+		for (int i=0; i<screenPoints.size(); i++)
+		{
+			screenPoints[i] = screenPoints[i] + offset;
+		}
+		allScreenPoints.push_back(screenPoints);
+		delete curve;
+
+		STYLE style = baseStyle;
+		style.osuNextStyle = testCase.osuNextStyle;
+		style.borderSizeMultiplier = testCase.borderSizeMultiplier;
+		draw(&rgba, width, height, screenPoints, hitcircleDiameter, testCase.from, testCase.to, style);
+
+		// png for looking at it (composited over black, the same as the raw golden would look ingame)
+		rgb.resize(width*height*3);
+		for (int i=0; i<width*height; i++)
+		{
+			for (int c=0; c<3; c++)
+			{
+				rgb[i*3 + c] = (unsigned char)((rgba[i*4 + c] * rgba[i*4 + 3] + 127) / 255);
+			}
+		}
+		Image::saveToImage(&rgb[0], width, height, UString::format("screenshots/slider_%s.png", testCase.name));
+
+		// write the input for new goldens (only if asked to), or compare against the golden
+		if (writePoints)
+		{
+			const UString pointsFilePath = UString::format("%sslider_%s.points", goldenDir.toUtf8(), testCase.name);
+			if (sliderRasterizerTestWritePoints(pointsFilePath, width, height, screenPoints, hitcircleDiameter, testCase.from, testCase.to, style))
+			{
+				numWritten++;
+				debugLog("osu_slider_rasterizer_test: %s: wrote %s\n", testCase.name, pointsFilePath.toUtf8());
+			}
+			else
+				debugLog("osu_slider_rasterizer_test: %s: FAILED to write %s\n", testCase.name, pointsFilePath.toUtf8());
+			continue;
+		}
+
+		const UString goldenFilePath = UString::format("%sslider_%s.rgba", goldenDir.toUtf8(), testCase.name);
+		if (!sliderRasterizerTestReadGolden(goldenFilePath, &golden))
+		{
+			debugLog("osu_slider_rasterizer_test: %s: FAILED, missing golden %s (see README.txt in the golden folder)\n", testCase.name, goldenFilePath.toUtf8());
+			continue;
+		}
+
+		if (golden.size() != rgba.size())
+		{
+			debugLog("osu_slider_rasterizer_test: %s: FAILED, golden has the wrong size (%i vs %i bytes)\n", testCase.name, (int)golden.size(), (int)rgba.size());
+			continue;
+		}
+
+		// this rasterizer uses the exact distance to the curve, the gpu stamps 42-gons at discrete points, so the bands can be shifted by a fraction of a pixel
+		// every pixel must be within the range of the golden's 3x3 neighbourhood (plus a few steps for the steep transitions), and the mean difference must stay small
+		const int neighbourhoodTolerance = 5;
+		const double maxMeanDifference = 1.25; // per channel over the covered pixels, about 0.9 for the current goldens
+		int numDifferentPixels = 0;
+		int maxDifference = 0;
+		long long sumDifference = 0;
+		int numCoveredPixels = 0;
+		for (int y=0; y<height; y++)
+		{
+			for (int x=0; x<width; x++)
+			{
+				const int i = y*width + x;
+				if (rgba[i*4 + 3] == 0 && golden[i*4 + 3] == 0)
+					continue;
+
+				numCoveredPixels++;
+				int difference = 0;
+				for (int c=0; c<4; c++)
+				{
+					sumDifference += std::abs((int)rgba[i*4 + c] - (int)golden[i*4 + c]);
+
+					int neighbourhoodMin = 255;
+					int neighbourhoodMax = 0;
+					for (int ny=std::max(y-1, 0); ny<=std::min(y+1, height-1); ny++)
+					{
+						for (int nx=std::max(x-1, 0); nx<=std::min(x+1, width-1); nx++)
+						{
+							neighbourhoodMin = std::min(neighbourhoodMin, (int)golden[(ny*width + nx)*4 + c]);
+							neighbourhoodMax = std::max(neighbourhoodMax, (int)golden[(ny*width + nx)*4 + c]);
+						}
+					}
+					difference = std::max(difference, std::max(neighbourhoodMin - (int)rgba[i*4 + c], (int)rgba[i*4 + c] - neighbourhoodMax));
+				}
+				if (difference > neighbourhoodTolerance)
+					numDifferentPixels++;
+				maxDifference = std::max(maxDifference, difference);
+			}
+		}
+		const double meanDifference = (numCoveredPixels > 0 ? (double)sumDifference / (numCoveredPixels*4.0) : 0.0);
+
+		if (numDifferentPixels == 0 && meanDifference <= maxMeanDifference)
+			numPassed++;
+		else
+			debugLog("osu_slider_rasterizer_test: %s: FAILED, %i pixels differ (max difference %i to the neighbourhood), mean difference %f\n", testCase.name, numDifferentPixels, maxDifference, meanDifference);
+	}
+
+	// benchmark, at full size and at thumbnail size (e.g. for song browser previews without a gpu)
+	const int numIterations = 20;
+	Timer timer;
+	timer.start();
+	for (int n=0; n<numIterations; n++)
+	{
+		for (int t=0; t<allScreenPoints.size(); t++)
+		{
+			draw(&rgba, width, height, allScreenPoints[t], hitcircleDiameter, 0.0f, 1.0f, baseStyle);
+		}
+	}
+	timer.update();
+	const double fullSizeTime = timer.getElapsedTime();
+
+	const float thumbnailScale = 0.25f;
+	std::vector<std::vector<Vector2>> allThumbnailPoints = allScreenPoints;
+	for (int t=0; t<allThumbnailPoints.size(); t++)
+	{
+		for (int i=0; i<allThumbnailPoints[t].size(); i++)
+		{
+			allThumbnailPoints[t][i] = allThumbnailPoints[t][i] * thumbnailScale;
+		}
+	}
+	timer.start();
+	for (int n=0; n<numIterations; n++)
+	{
+		for (int t=0; t<allThumbnailPoints.size(); t++)
+		{
+			draw(&rgba, (int)(width*thumbnailScale), (int)(height*thumbnailScale), allThumbnailPoints[t], hitcircleDiameter*thumbnailScale, 0.0f, 1.0f, baseStyle);
+		}
+	}
+	timer.update();
+	const double thumbnailTime = timer.getElapsedTime();
+
+	const int numDraws = numIterations*allScreenPoints.size();
+	debugLog("osu_slider_rasterizer_test: %f ms per slider at %ix%i, %f ms per slider at %ix%i\n", (fullSizeTime*1000.0) / numDraws, width, height, (thumbnailTime*1000.0) / numDraws, (int)(width*thumbnailScale), (int)(height*thumbnailScale));
+	if (writePoints)
+		debugLog("osu_slider_rasterizer_test: %i/%i points files written to %s, nothing was compared (run make_slider_goldens.py in there next)\n", numWritten, numTestCases, goldenDir.toUtf8());
+	else
+		debugLog("osu_slider_rasterizer_test: %s, %i/%i passed (goldens in %s)\n", numPassed == numTestCases ? "PASSED" : "FAILED", numPassed, numTestCases, goldenDir.toUtf8());
+}
@@ -0,0 +1,50 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		cpu version of OsuSliderRenderer, for golden images and thumbnails
+//
+// $NoKeywords: $osusliderrast
+//===============================================================================//
+
+#ifndef OSUSLIDERRASTERIZER_H
+#define OSUSLIDERRASTERIZER_H
+
+#include "cbase.h"
+
+class Osu;
+class OsuBeatmap;
+
+// draws the same slider body as OsuSliderRenderer::draw(), but into an rgba buffer:
+// the circle stamps along the curve become the distance to the curve (the cone height is what the depth test keeps), which is then colored by a port of slider.fsh
+class OsuSliderRasterizer
+{
+public:
+	struct STYLE
+	{
+		Color borderColor;
+		Color bodyColor;
+		bool osuNextStyle;
+		float bodyAlphaMultiplier;
+		float bodyColorSaturation;
+		float borderSizeMultiplier;
+		float alphaMultiplier;
+	};
+
+	static STYLE getStyle(Osu *osu, Color color); // the colors and convars OsuSliderRenderer::draw() would use for this combo color (without osu_slider_rainbow)
+
+	// same inputs as OsuSliderRenderer::draw(), the points are in buffer pixels
+	// rgba is resized to width*height*4, transparent where there is no slider, not premultiplied
+	static void draw(std::vector<unsigned char> *rgba, int width, int height, const std::vector<Vector2> &points, float hitcircleDiameter, float from, float to, const STYLE &style, float alpha = 1.0f);
+
+	static void test(OsuBeatmap *beatmap); // golden images (build/goldens/) across curve types, snaking and styles + benchmark (osu_slider_rasterizer_test), missing goldens fail
+
+private:
+	static const int SHADE_LUT_SIZE = 1024;
+	static float SIMPLIFY_TOLERANCE;
+
+	static void buildShadeLUT(const STYLE &style, float alpha, unsigned char *lut); // SHADE_LUT_SIZE rgba entries, indexed by the texture coordinate (0 = edge, 1 = center of the curve)
+	static void shade(const STYLE &style, float texcoord, float *out); // slider.fsh
+	static bool canSkip(const std::vector<Vector2> &points, int start, int end);
+	static void stampSegment(float *depth, int width, int height, Vector2 a, Vector2 b, float radius);
+};
+
+#endif
@@ -16,6 +16,7 @@
 
 #include "Osu.h"
 #include "OsuSkin.h"
+#include "OsuRecordingGraphics.h"
 
 #include "OpenGLHeaders.h"
 
@@ -89,9 +90,9 @@ void OsuSliderRenderer::draw(Graphics *g, Osu *osu, const std::vector<Vector2> &
 				vao.addTexcoord(1, 0);
 				vao.addVertex(x+width, y, -1.0f);
 
-				osu->getSkin()->getHitCircle()->bind();
+				OsuRecordingGraphics::bindImage(osu->getSkin()->getHitCircle());
 				g->drawVAO(&vao);
-				osu->getSkin()->getHitCircle()->unbind();
+				OsuRecordingGraphics::unbindImage(osu->getSkin()->getHitCircle());
 			g->popTransform();
 		}
 		return; // nothing more to draw here
@@ -107,7 +108,7 @@ void OsuSliderRenderer::draw(Graphics *g, Osu *osu, const std::vector<Vector2> &
 	g->setDepthBuffer(true);
 	g->setBlending(false);
 	{
-		osu->getFrameBuffer()->enable();
+		OsuRecordingGraphics::enableRenderTarget(osu->getFrameBuffer());
 
 		Color borderColor = osu_slider_border_tint_combo_color.getBool() ? color : osu->getSkin()->getSliderBorderColor();
 		Color bodyColor = osu->getSkin()->isSliderTrackOverridden() ? osu->getSkin()->getSliderTrackOverride() : color;
@@ -131,17 +132,20 @@ void OsuSliderRenderer::draw(Graphics *g, Osu *osu, const std::vector<Vector2> &
 
 		if (!osu_slider_use_gradient_image.getBool())
 		{
-			BLEND_SHADER->enable();
-			BLEND_SHADER->setUniform1i("style", osu_slider_osu_next_style.getBool() ? 1 : 0);
-			BLEND_SHADER->setUniform1f("bodyAlphaMultiplier", osu_slider_body_alpha_multiplier.getFloat());
-			BLEND_SHADER->setUniform1f("bodyColorSaturation", osu_slider_body_color_saturation.getFloat());
-			BLEND_SHADER->setUniform1f("borderSizeMultiplier", osu_slider_border_size_multiplier.getFloat());
-			BLEND_SHADER->setUniform3f("colBorder", COLOR_GET_Rf(borderColor), COLOR_GET_Gf(borderColor), COLOR_GET_Bf(borderColor));
-			BLEND_SHADER->setUniform3f("colBody", COLOR_GET_Rf(bodyColor), COLOR_GET_Gf(bodyColor), COLOR_GET_Bf(bodyColor));
+			OsuRecordingGraphics::enableShader(BLEND_SHADER);
+			if (!OsuRecordingGraphics::isRecordingFrame()) // the uniforms only exist on the device
+			{
+				BLEND_SHADER->setUniform1i("style", osu_slider_osu_next_style.getBool() ? 1 : 0);
+				BLEND_SHADER->setUniform1f("bodyAlphaMultiplier", osu_slider_body_alpha_multiplier.getFloat());
+				BLEND_SHADER->setUniform1f("bodyColorSaturation", osu_slider_body_color_saturation.getFloat());
+				BLEND_SHADER->setUniform1f("borderSizeMultiplier", osu_slider_border_size_multiplier.getFloat());
+				BLEND_SHADER->setUniform3f("colBorder", COLOR_GET_Rf(borderColor), COLOR_GET_Gf(borderColor), COLOR_GET_Bf(borderColor));
+				BLEND_SHADER->setUniform3f("colBody", COLOR_GET_Rf(bodyColor), COLOR_GET_Gf(bodyColor), COLOR_GET_Bf(bodyColor));
+			}
 		}
 
 		g->setColor(0xffffffff);
-		osu->getSkin()->getSliderGradient()->bind();
+		OsuRecordingGraphics::bindImage(osu->getSkin()->getSliderGradient());
 
 		// draw curve mesh
 		{
@@ -149,9 +153,9 @@ void OsuSliderRenderer::draw(Graphics *g, Osu *osu, const std::vector<Vector2> &
 		}
 
 		if (!osu_slider_use_gradient_image.getBool())
-			BLEND_SHADER->disable();
+			OsuRecordingGraphics::disableShader(BLEND_SHADER);
 
-		osu->getFrameBuffer()->disable();
+		OsuRecordingGraphics::disableRenderTarget(osu->getFrameBuffer());
 	}
 	g->setBlending(true);
 	g->setDepthBuffer(false);
@@ -164,7 +168,7 @@ void OsuSliderRenderer::draw(Graphics *g, Osu *osu, const std::vector<Vector2> &
 	m_fBoundingBoxMaxY += pixelFudge;
 
 	osu->getFrameBuffer()->setColor(COLORf(alpha*osu_slider_alpha_multiplier.getFloat(), 1.0f, 1.0f, 1.0f));
-	osu->getFrameBuffer()->drawRect(g, m_fBoundingBoxMinX, m_fBoundingBoxMinY, m_fBoundingBoxMaxX - m_fBoundingBoxMinX, m_fBoundingBoxMaxY - m_fBoundingBoxMinY);
+	OsuRecordingGraphics::drawRenderTarget(g, osu->getFrameBuffer(), m_fBoundingBoxMinX, m_fBoundingBoxMinY, m_fBoundingBoxMaxX - m_fBoundingBoxMinX, m_fBoundingBoxMaxY - m_fBoundingBoxMinY);
 }
 
 void OsuSliderRenderer::drawMM(Graphics *g, Osu *osu, const std::vector<std::vector<Vector2>> &points, float hitcircleDiameter, float from, float to, Color color, float alpha, long sliderTimeForRainbow)
@@ -195,7 +199,7 @@ void OsuSliderRenderer::drawMM(Graphics *g, Osu *osu, const std::vector<std::vec
 	g->setDepthBuffer(true);
 	g->setBlending(false);
 	{
-		osu->getFrameBuffer()->enable();
+		OsuRecordingGraphics::enableRenderTarget(osu->getFrameBuffer());
 
 		Color borderColor = osu_slider_border_tint_combo_color.getBool() ? color : osu->getSkin()->getSliderBorderColor();
 		Color bodyColor = osu->getSkin()->isSliderTrackOverridden() ? osu->getSkin()->getSliderTrackOverride() : color;
@@ -219,17 +223,20 @@ void OsuSliderRenderer::drawMM(Graphics *g, Osu *osu, const std::vector<std::vec
 
 		if (!osu_slider_use_gradient_image.getBool())
 		{
-			BLEND_SHADER->enable();
-			BLEND_SHADER->setUniform1i("style", osu_slider_osu_next_style.getBool() ? 1 : 0);
-			BLEND_SHADER->setUniform1f("bodyAlphaMultiplier", osu_slider_body_alpha_multiplier.getFloat());
-			BLEND_SHADER->setUniform1f("bodyColorSaturation", osu_slider_body_color_saturation.getFloat());
-			BLEND_SHADER->setUniform1f("borderSizeMultiplier", osu_slider_border_size_multiplier.getFloat());
-			BLEND_SHADER->setUniform3f("colBorder", COLOR_GET_Rf(borderColor), COLOR_GET_Gf(borderColor), COLOR_GET_Bf(borderColor));
-			BLEND_SHADER->setUniform3f("colBody", COLOR_GET_Rf(bodyColor), COLOR_GET_Gf(bodyColor), COLOR_GET_Bf(bodyColor));
+			OsuRecordingGraphics::enableShader(BLEND_SHADER);
+			if (!OsuRecordingGraphics::isRecordingFrame()) // the uniforms only exist on the device
+			{
+				BLEND_SHADER->setUniform1i("style", osu_slider_osu_next_style.getBool() ? 1 : 0);
+				BLEND_SHADER->setUniform1f("bodyAlphaMultiplier", osu_slider_body_alpha_multiplier.getFloat());
+				BLEND_SHADER->setUniform1f("bodyColorSaturation", osu_slider_body_color_saturation.getFloat());
+				BLEND_SHADER->setUniform1f("borderSizeMultiplier", osu_slider_border_size_multiplier.getFloat());
+				BLEND_SHADER->setUniform3f("colBorder", COLOR_GET_Rf(borderColor), COLOR_GET_Gf(borderColor), COLOR_GET_Bf(borderColor));
+				BLEND_SHADER->setUniform3f("colBody", COLOR_GET_Rf(bodyColor), COLOR_GET_Gf(bodyColor), COLOR_GET_Bf(bodyColor));
+			}
 		}
 
 		g->setColor(0xffffffff);
-		osu->getSkin()->getSliderGradient()->bind();
+		OsuRecordingGraphics::bindImage(osu->getSkin()->getSliderGradient());
 
 		// draw curve mesh
 		{
@@ -237,9 +244,9 @@ void OsuSliderRenderer::drawMM(Graphics *g, Osu *osu, const std::vector<std::vec
 		}
 
 		if (!osu_slider_use_gradient_image.getBool())
-			BLEND_SHADER->disable();
+			OsuRecordingGraphics::disableShader(BLEND_SHADER);
 
-		osu->getFrameBuffer()->disable();
+		OsuRecordingGraphics::disableRenderTarget(osu->getFrameBuffer());
 	}
 	g->setBlending(true);
 	g->setDepthBuffer(false);
@@ -252,7 +259,7 @@ void OsuSliderRenderer::drawMM(Graphics *g, Osu *osu, const std::vector<std::vec
 	m_fBoundingBoxMaxY += pixelFudge;
 
 	osu->getFrameBuffer()->setColor(COLORf(alpha*osu_slider_alpha_multiplier.getFloat(), 1.0f, 1.0f, 1.0f));
-	osu->getFrameBuffer()->drawRect(g, m_fBoundingBoxMinX, m_fBoundingBoxMinY, m_fBoundingBoxMaxX - m_fBoundingBoxMinX, m_fBoundingBoxMaxY - m_fBoundingBoxMinY);
+	OsuRecordingGraphics::drawRenderTarget(g, osu->getFrameBuffer(), m_fBoundingBoxMinX, m_fBoundingBoxMinY, m_fBoundingBoxMaxX - m_fBoundingBoxMinX, m_fBoundingBoxMaxY - m_fBoundingBoxMinY);
 }
 
 void OsuSliderRenderer::drawFillSliderBodyPeppy(Graphics *g, const std::vector<Vector2> &points, float radius, int drawFromIndex, int drawUpToIndex)
@@ -452,12 +459,13 @@ void OsuSliderRenderer::checkUpdateVars(float hitcircleDiameter)
 {
 	// static globals
 
-	// build shader and circle
-	if (BLEND_SHADER == NULL)
-	{
-		// build shader
+	// build shader (on the device, so not while recording, see OsuRecordingGraphics)
+	if (BLEND_SHADER == NULL && !OsuRecordingGraphics::isRecordingFrame())
 		BLEND_SHADER = engine->getResourceManager()->loadShader("slider.vsh", "slider.fsh", "slider");
 
+	// build circle
+	if (UNIT_CIRCLE.size() == 0)
+	{
 		// build unit cone
 		{
 			// tip of the cone
@@ -26,10 +26,15 @@
 #include "OsuSkin.h"
 #include "OsuBeatmap.h"
 #include "OsuBeatmapDatabase.h"
+#include "OsuDifficultyCache.h"
+#include "OsuCollectionDatabase.h"
 #include "OsuBeatmapDifficulty.h"
 #include "OsuNotificationOverlay.h"
 #include "OsuModSelector.h"
 #include "OsuKeyBindings.h"
+#include "OsuScoreDatabase.h"
+#include "OsuRandomBeatmapSelector.h"
+#include "OsuProfiler.h"
 
 #include "OsuUIBackButton.h"
 #include "OsuUIContextMenu.h"
@@ -39,6 +44,9 @@
 #include "OsuUISongBrowserSongDifficultyButton.h"
 #include "OsuUISongBrowserCollectionButton.h"
 
+#include <unordered_map>
+#include <unordered_set>
+
 ConVar osu_songbrowser_topbar_left_percent("osu_songbrowser_topbar_left_percent", 0.93f);
 ConVar osu_songbrowser_topbar_left_width_percent("osu_songbrowser_topbar_left_width_percent", 0.265f);
 ConVar osu_songbrowser_topbar_middle_width_percent("osu_songbrowser_topbar_middle_width_percent", 0.15f);
@@ -46,6 +54,12 @@ ConVar osu_songbrowser_topbar_right_height_percent("osu_songbrowser_topbar_right
 ConVar osu_songbrowser_topbar_right_percent("osu_songbrowser_topbar_right_percent", 0.378f);
 ConVar osu_songbrowser_bottombar_percent("osu_songbrowser_bottombar_percent", 0.116f);
 
+ConVar osu_songbrowser_random_shuffle("osu_songbrowser_random_shuffle", true, "random selection (F2) goes through every visible beatmap once before repeating any of them");
+ConVar osu_songbrowser_random_weighting("osu_songbrowser_random_weighting", 0, "which beatmaps random selection (F2) prefers: 0 = none, 1 = within osu_songbrowser_random_stars_min/max, 2 = unplayed, 3 = in a collection");
+ConVar osu_songbrowser_random_weight("osu_songbrowser_random_weight", 4, "how many times more likely the preferred beatmaps of osu_songbrowser_random_weighting are");
+ConVar osu_songbrowser_random_stars_min("osu_songbrowser_random_stars_min", 0.0f);
+ConVar osu_songbrowser_random_stars_max("osu_songbrowser_random_stars_max", 10.0f);
+
 
 
 class OsuUISongBrowserDifficultyCollectionButton : public OsuUISongBrowserCollectionButton
@@ -72,13 +86,76 @@ private:
 
 OsuUISongBrowserCollectionButton *OsuUISongBrowserDifficultyCollectionButton::s_previousButton = NULL;
 
+// the sort orders of the groups (also used to insert the buttons of newly added beatmaps)
+struct SortByDateAddedComparator
+{
+	bool operator() (OsuUISongBrowserButton const *a, OsuUISongBrowserButton const *b) const
+	{
+		unsigned long time1 = 0;
+		unsigned long time2 = 0;
+		std::vector<OsuBeatmapDifficulty*> *aDiffs = a->getBeatmap()->getDifficultiesPointer();
+		for (int i=0; i<aDiffs->size(); i++)
+		{
+			if ((*aDiffs)[i]->lastModificationTime > time1)
+				time1 = (*aDiffs)[i]->lastModificationTime;
+		}
+
+		std::vector<OsuBeatmapDifficulty*> *bDiffs = b->getBeatmap()->getDifficultiesPointer();
+		for (int i=0; i<bDiffs->size(); i++)
+		{
+			if ((*bDiffs)[i]->lastModificationTime > time2)
+				time2 = (*bDiffs)[i]->lastModificationTime;
+		}
+
+		return time1 < time2;
+	}
+};
+
+struct SortByDifficultyComparator
+{
+	bool operator() (OsuUISongBrowserButton const *a, OsuUISongBrowserButton const *b) const
+	{
+		float diff1 = 0.0f;
+		float stars1 = 0.0f;
+		std::vector<OsuBeatmapDifficulty*> *aDiffs = a->getBeatmap()->getDifficultiesPointer();
+		for (int i=0; i<aDiffs->size(); i++)
+		{
+			OsuBeatmapDifficulty *d = (*aDiffs)[i];
+			if (d->starsNoMod > stars1)
+				stars1 = d->starsNoMod;
+
+			float tempDiff1 = (d->AR+1)*(d->CS+1)*(d->HP+1)*(d->OD+1)*(d->maxBPM > 0 ? d->maxBPM : 1);
+			if (tempDiff1 > diff1)
+				diff1 = tempDiff1;
+		}
+
+		float diff2 = 0.0f;
+		float stars2 = 0.0f;
+		std::vector<OsuBeatmapDifficulty*> *bDiffs = b->getBeatmap()->getDifficultiesPointer();
+		for (int i=0; i<bDiffs->size(); i++)
+		{
+			OsuBeatmapDifficulty *d = (*bDiffs)[i];
+			if (d->starsNoMod > stars2)
+				stars2 = d->starsNoMod;
+
+			float tempDiff2 = (d->AR+1)*(d->CS+1)*(d->HP+1)*(d->OD+1)*(d->maxBPM > 0 ? d->maxBPM : 1);
+			if (tempDiff2 > diff1)
+				diff2 = tempDiff2;
+		}
+
+		if (stars1 > 0 && stars2 > 0)
+			return stars1 < stars2;
+		else
+			return diff1 < diff2;
+	}
+};
+
 
 
 OsuSongBrowser2::OsuSongBrowser2(Osu *osu) : OsuScreenBackable(osu)
 {
 	m_osu = osu;
 
-	m_rngalg = std::mt19937(time(0));
 	m_group = GROUP::GROUP_NO_GROUPING;
 
 	// convar refs
@@ -142,11 +219,18 @@ OsuSongBrowser2::OsuSongBrowser2(Osu *osu) : OsuScreenBackable(osu)
 	// beatmap database
 	m_db = new OsuBeatmapDatabase(m_osu);
 	m_bBeatmapRefreshScheduled = true;
+	m_bBeatmapRefreshIsIncremental = false;
 
 	// behaviour
 	m_bHasSelectedAndIsPlaying = false;
 	m_selectedBeatmap = NULL;
 	m_fPulseAnimation = 0.0f;
+	m_randomBeatmapSelector = new OsuRandomBeatmapSelector(time(0));
+	m_bRandomSongButtonsChanged = true;
+	m_iRandomWeighting = 0;
+	m_iRandomWeight = 1;
+	m_fRandomStarsMin = 0.0f;
+	m_fRandomStarsMax = 0.0f;
 
 	// search
 	m_fSearchWaitTime = 0.0f;
@@ -175,11 +259,14 @@ OsuSongBrowser2::~OsuSongBrowser2()
 	SAFE_DELETE(m_topbarRight);
 	SAFE_DELETE(m_bottombar);
 	SAFE_DELETE(m_songBrowser);
+	SAFE_DELETE(m_randomBeatmapSelector);
 	SAFE_DELETE(m_db);
 }
 
 void OsuSongBrowser2::draw(Graphics *g)
 {
+	OSU_PROFILER_ZONE("OsuSongBrowser2::draw");
+
 	if (!m_bVisible)
 		return;
 
@@ -363,6 +450,8 @@ void OsuSongBrowser2::drawSelectedBeatmapBackgroundImage(Graphics *g, Osu *osu)
 
 void OsuSongBrowser2::update()
 {
+	OSU_PROFILER_ZONE("OsuSongBrowser2::update");
+
 	OsuScreenBackable::update();
 	if (!m_bVisible) return;
 
@@ -380,6 +469,9 @@ void OsuSongBrowser2::update()
 		return;
 	}
 
+	// apply finished background star rating calculations
+	m_db->getDifficultyCache()->update();
+
 	m_songBrowser->update();
 	m_songBrowser->getContainer()->update_pos(); // necessary due to constant animations
 	m_topbarLeft->update();
@@ -751,9 +843,19 @@ void OsuSongBrowser2::onDifficultySelected(OsuBeatmap *beatmap, OsuBeatmapDiffic
 
 void OsuSongBrowser2::refreshBeatmaps()
 {
+	OSU_PROFILER_ZONE("OsuSongBrowser2::refreshBeatmaps");
+
 	if (!m_bVisible || m_bHasSelectedAndIsPlaying)
 		return;
 
+	// if possible, only the changed folders are loaded, and all other buttons are kept
+	m_bBeatmapRefreshIsIncremental = m_db->refresh();
+	if (m_bBeatmapRefreshIsIncremental)
+	{
+		m_bBeatmapRefreshScheduled = true;
+		return;
+	}
+
 	// reset
 	m_selectedBeatmap = NULL;
 
@@ -777,6 +879,8 @@ void OsuSongBrowser2::refreshBeatmaps()
 	m_visibleSongButtons.clear();
 	m_beatmaps.clear();
 	m_previousRandomBeatmaps.clear();
+	m_randomSongButtons.clear();
+	m_bRandomSongButtonsChanged = true;
 
 	// start loading
 	m_bBeatmapRefreshScheduled = true;
@@ -810,6 +914,8 @@ void OsuSongBrowser2::scrollToSelectedSongButton()
 
 void OsuSongBrowser2::rebuildSongButtons(bool unloadAllThumbnails)
 {
+	OSU_PROFILER_ZONE("OsuSongBrowser2::rebuildSongButtons");
+
 	m_songBrowser->getContainer()->empty();
 
 	if (unloadAllThumbnails)
@@ -820,6 +926,9 @@ void OsuSongBrowser2::rebuildSongButtons(bool unloadAllThumbnails)
 		}
 	}
 
+	// random selection picks from the song buttons (not diffs or collections), the selected one included even though it is hidden
+	std::vector<OsuUISongBrowserSongButton*> randomSongButtons;
+
 	for (int i=0; i<m_visibleSongButtons.size(); i++)
 	{
 		OsuUISongBrowserButton *button = m_visibleSongButtons[i];
@@ -828,6 +937,8 @@ void OsuSongBrowser2::rebuildSongButtons(bool unloadAllThumbnails)
 		// "parent"
 		if (!(button->isSelected() && button->isHiddenIfSelected()))
 			m_songBrowser->getContainer()->addBaseUIElement(m_visibleSongButtons[i]);
+		if (button->getBeatmap() != NULL)
+			randomSongButtons.push_back((OsuUISongBrowserSongButton*)button);
 
 		// children
 		std::vector<OsuUISongBrowserButton*> recursiveChildren = m_visibleSongButtons[i]->getChildren();
@@ -840,10 +951,19 @@ void OsuSongBrowser2::rebuildSongButtons(bool unloadAllThumbnails)
 
 				if (!(button->isSelected() && button->isHiddenIfSelected()))
 					m_songBrowser->getContainer()->addBaseUIElement(recursiveChildren[c]);
+				if (button->getBeatmap() != NULL)
+					randomSongButtons.push_back((OsuUISongBrowserSongButton*)button);
 			}
 		}
 	}
 
+	// selecting a song button rebuilds everything too, which must not restart the shuffle bag
+	if (randomSongButtons != m_randomSongButtons)
+	{
+		m_randomSongButtons.swap(randomSongButtons);
+		m_bRandomSongButtonsChanged = true;
+	}
+
 	updateSongButtonLayout();
 }
 
@@ -924,6 +1044,8 @@ void OsuSongBrowser2::setVisible(bool visible)
 		if (m_beatmaps.size() == 0)
 			refreshBeatmaps();
 	}
+	else
+		m_db->getDifficultyCache()->save();
 }
 
 bool OsuSongBrowser2::searchMatcher(OsuBeatmap *beatmap, UString searchString)
@@ -1301,6 +1423,13 @@ CBaseUIButton *OsuSongBrowser2::addTopBarRightSortButton(UString text)
 
 void OsuSongBrowser2::onDatabaseLoadingFinished()
 {
+	if (m_bBeatmapRefreshIsIncremental)
+	{
+		m_bBeatmapRefreshIsIncremental = false;
+		applyDatabaseChanges();
+		return;
+	}
+
 	m_beatmaps = std::vector<OsuBeatmap*>(m_db->getBeatmaps()); // having a copy of the vector in here is actually completely unnecessary
 
 	debugLog("OsuSongBrowser2::onDatabaseLoadingFinished() : %i beatmaps.\n", m_beatmaps.size());
@@ -1316,59 +1445,7 @@ void OsuSongBrowser2::onDatabaseLoadingFinished()
 		m_visibleSongButtons.push_back(songButton);
 	}
 
-	std::vector<OsuBeatmapDatabase::Collection> collections = m_db->getCollections();
-	for (int i=0; i<collections.size(); i++)
-	{
-		std::vector<OsuUISongBrowserButton*> children;
-		for (int b=0; b<collections[i].beatmaps.size(); b++)
-		{
-			OsuBeatmap *beatmap = collections[i].beatmaps[b].first;
-			std::vector<OsuBeatmapDifficulty*> colDiffs = collections[i].beatmaps[b].second;
-			for (int sb=0; sb<m_songButtons.size(); sb++)
-			{
-				if (m_songButtons[sb]->getBeatmap() == beatmap)
-				{
-					std::vector<OsuUISongBrowserButton*> diffChildren = m_songButtons[sb]->getChildrenAbs();
-					std::vector<OsuUISongBrowserButton*> matchingDiffs;
-
-					for (int d=0; d<diffChildren.size(); d++)
-					{
-						OsuUISongBrowserSongButton *songButtonPointer = dynamic_cast<OsuUISongBrowserSongButton*>(diffChildren[d]);
-						for (int cd=0; cd<colDiffs.size(); cd++)
-						{
-							if (songButtonPointer != NULL && songButtonPointer->getDiff() == colDiffs[cd])
-								matchingDiffs.push_back(songButtonPointer);
-						}
-					}
-
-					// HACKHACK: fuck
-					if (matchingDiffs.size() != beatmap->getDifficultiesPointer()->size())
-					{
-						for (int md=0; md<matchingDiffs.size(); md++)
-						{
-							matchingDiffs[md]->setCollectionDiffHack(true);
-						}
-					}
-
-					// TODO: only add matched diffs, instead of the whole beatmap
-					/*
-					if (matchingDiffs.size() > 1)
-						children.push_back(m_songButtons[sb]);
-					else if (matchingDiffs.size() == 1)
-						children.push_back(matchingDiffs[0]);
-					*/
-
-					children.push_back(m_songButtons[sb]);
-
-					break;
-				}
-			}
-		}
-		OsuUISongBrowserCollectionButton *collectionButton = new OsuUISongBrowserCollectionButton(m_osu, this, m_songBrowser, 250, 250 + m_beatmaps.size()*50, 200, 50, "", collections[i].name, children);
-
-		m_collectionButtons.push_back(collectionButton);
-		///m_visibleSongButtons.push_back(collectionButton);
-	}
+	rebuildCollectionButtons();
 
 	// TODO:
 	for (int i=0; i<12; i++)
@@ -1393,6 +1470,183 @@ void OsuSongBrowser2::onDatabaseLoadingFinished()
 	rebuildSongButtons();
 }
 
+void OsuSongBrowser2::applyDatabaseChanges()
+{
+	OSU_PROFILER_ZONE("OsuSongBrowser2::applyDatabaseChanges");
+
+	const std::vector<OsuBeatmap*> &addedBeatmaps = m_db->getAddedBeatmaps();
+	const std::vector<OsuBeatmap*> &removedBeatmaps = m_db->getRemovedBeatmaps();
+
+	debugLog("OsuSongBrowser2::applyDatabaseChanges() : %i added, %i removed beatmaps.\n", (int)addedBeatmaps.size(), (int)removedBeatmaps.size());
+
+	if (addedBeatmaps.size() < 1 && removedBeatmaps.size() < 1)
+		return;
+
+	// the container may hold buttons of removed beatmaps
+	m_songBrowser->getContainer()->empty();
+
+	// nothing may point to a removed beatmap anymore, the database deletes them at the end
+	if (removedBeatmaps.size() > 0)
+	{
+		const std::unordered_set<OsuBeatmap*> removed(removedBeatmaps.begin(), removedBeatmaps.end());
+
+		if (m_selectedBeatmap != NULL && removed.find(m_selectedBeatmap) != removed.end())
+		{
+			m_selectedBeatmap->deselect();
+			m_selectedBeatmap = NULL;
+		}
+
+		std::vector<OsuBeatmap*> beatmaps;
+		for (int i=0; i<m_beatmaps.size(); i++)
+		{
+			if (removed.find(m_beatmaps[i]) == removed.end())
+				beatmaps.push_back(m_beatmaps[i]);
+		}
+		m_beatmaps.swap(beatmaps);
+
+		std::vector<OsuBeatmap*> previousRandomBeatmaps;
+		for (int i=0; i<m_previousRandomBeatmaps.size(); i++)
+		{
+			if (removed.find(m_previousRandomBeatmaps[i]) == removed.end())
+				previousRandomBeatmaps.push_back(m_previousRandomBeatmaps[i]);
+		}
+		m_previousRandomBeatmaps.swap(previousRandomBeatmaps);
+
+		std::vector<OsuUISongBrowserButton*> visibleSongButtons;
+		for (int i=0; i<m_visibleSongButtons.size(); i++)
+		{
+			if (m_visibleSongButtons[i]->getBeatmap() == NULL || removed.find(m_visibleSongButtons[i]->getBeatmap()) == removed.end())
+				visibleSongButtons.push_back(m_visibleSongButtons[i]);
+		}
+		m_visibleSongButtons.swap(visibleSongButtons);
+
+		std::vector<OsuUISongBrowserSongButton*> songButtons;
+		for (int i=0; i<m_songButtons.size(); i++)
+		{
+			if (removed.find(m_songButtons[i]->getBeatmap()) == removed.end())
+				songButtons.push_back(m_songButtons[i]);
+			else
+				delete m_songButtons[i];
+		}
+		m_songButtons.swap(songButtons);
+
+		// new buttons may reuse the addresses of the deleted ones
+		m_randomSongButtons.clear();
+		m_bRandomSongButtonsChanged = true;
+	}
+
+	// new beatmaps are only visible if they would have been there anyway (search results, or one of the beatmap groups)
+	for (int i=0; i<addedBeatmaps.size(); i++)
+	{
+		OsuUISongBrowserSongButton *songButton = new OsuUISongBrowserSongButton(m_osu, this, m_songBrowser, 250, 250 + m_beatmaps.size()*50, 200, 50, "", addedBeatmaps[i]);
+
+		m_beatmaps.push_back(addedBeatmaps[i]);
+		m_songButtons.push_back(songButton);
+
+		if (m_bInSearch ? searchMatcher(addedBeatmaps[i], m_sSearchString) : m_group != GROUP::GROUP_COLLECTIONS)
+			m_visibleSongButtons.push_back(songButton);
+	}
+	if (!m_bInSearch && addedBeatmaps.size() > 0)
+	{
+		if (m_group == GROUP::GROUP_DATE_ADDED)
+			std::stable_sort(m_visibleSongButtons.begin(), m_visibleSongButtons.end(), SortByDateAddedComparator());
+		else if (m_group == GROUP::GROUP_DIFFICULTY)
+			std::stable_sort(m_visibleSongButtons.begin(), m_visibleSongButtons.end(), SortByDifficultyComparator());
+	}
+
+	// the collections have been rebuilt by the database
+	rebuildCollectionButtons();
+	rebuildSongButtons();
+
+	m_db->deleteRemovedBeatmaps();
+}
+
+void OsuSongBrowser2::rebuildCollectionButtons()
+{
+	// the old buttons may currently be visible
+	const bool isGroupedByCollections = (m_group == GROUP::GROUP_COLLECTIONS);
+	if (isGroupedByCollections)
+	{
+		m_songBrowser->getContainer()->empty();
+		m_visibleSongButtons.clear();
+	}
+
+	if (m_collectionButtons.size() > 0)
+		m_collectionButtons[0]->setPreviousButton(NULL);
+	for (int i=0; i<m_collectionButtons.size(); i++)
+	{
+		delete m_collectionButtons[i];
+	}
+	m_collectionButtons.clear();
+
+	std::unordered_map<OsuBeatmap*, OsuUISongBrowserSongButton*> songButtonsByBeatmap;
+	for (int sb=0; sb<m_songButtons.size(); sb++)
+	{
+		songButtonsByBeatmap[m_songButtons[sb]->getBeatmap()] = m_songButtons[sb];
+
+		// the flags are set again below, a diff may have been removed from its last collection since the previous rebuild
+		std::vector<OsuUISongBrowserButton*> diffChildren = m_songButtons[sb]->getChildrenAbs();
+		for (int d=0; d<diffChildren.size(); d++)
+		{
+			diffChildren[d]->setCollectionDiffHack(false);
+		}
+	}
+
+	OsuCollectionDatabase *collectionDatabase = m_db->getCollectionDatabase();
+	std::vector<OsuBeatmapDatabase::Collection> collections = m_db->getCollections();
+	for (int i=0; i<collections.size(); i++)
+	{
+		std::vector<OsuUISongBrowserButton*> children;
+		for (int b=0; b<collections[i].beatmaps.size(); b++)
+		{
+			OsuBeatmap *beatmap = collections[i].beatmaps[b].first;
+			std::unordered_map<OsuBeatmap*, OsuUISongBrowserSongButton*>::iterator it = songButtonsByBeatmap.find(beatmap);
+			if (it == songButtonsByBeatmap.end())
+				continue;
+
+			OsuUISongBrowserSongButton *songButton = it->second;
+
+			std::vector<OsuUISongBrowserButton*> diffChildren = songButton->getChildrenAbs();
+			std::vector<OsuUISongBrowserButton*> matchingDiffs;
+			for (int d=0; d<diffChildren.size(); d++)
+			{
+				OsuUISongBrowserSongButton *songButtonPointer = dynamic_cast<OsuUISongBrowserSongButton*>(diffChildren[d]);
+				if (songButtonPointer != NULL && songButtonPointer->getDiff() != NULL && songButtonPointer->getDiff()->hasMD5() && collectionDatabase->contains(collections[i].index, songButtonPointer->getDiff()->getMD5Hash()))
+					matchingDiffs.push_back(songButtonPointer);
+			}
+
+			// HACKHACK: fuck
+			if (matchingDiffs.size() != beatmap->getDifficultiesPointer()->size())
+			{
+				for (int md=0; md<matchingDiffs.size(); md++)
+				{
+					matchingDiffs[md]->setCollectionDiffHack(true);
+				}
+			}
+
+			// TODO: only add matched diffs, instead of the whole beatmap
+			/*
+			if (matchingDiffs.size() > 1)
+				children.push_back(songButton);
+			else if (matchingDiffs.size() == 1)
+				children.push_back(matchingDiffs[0]);
+			*/
+
+			children.push_back(songButton);
+		}
+		OsuUISongBrowserCollectionButton *collectionButton = new OsuUISongBrowserCollectionButton(m_osu, this, m_songBrowser, 250, 250 + m_beatmaps.size()*50, 200, 50, "", collections[i].name, children);
+
+		m_collectionButtons.push_back(collectionButton);
+		///m_visibleSongButtons.push_back(collectionButton);
+	}
+
+	if (isGroupedByCollections)
+	{
+		m_visibleSongButtons = std::vector<OsuUISongBrowserButton*>(m_collectionButtons.begin(), m_collectionButtons.end());
+		rebuildSongButtons();
+	}
+}
+
 void OsuSongBrowser2::onSortClicked(CBaseUIButton *button)
 {
 	m_contextMenu->setPos(button->getPos());
@@ -1432,30 +1686,7 @@ void OsuSongBrowser2::onGroupDateAdded(CBaseUIButton *b)
 	m_visibleSongButtons = std::vector<OsuUISongBrowserButton*>(m_songButtons.begin(), m_songButtons.end());
 
 	// sort by date added
-	struct SortComparator
-	{
-		bool operator() (OsuUISongBrowserButton const *a, OsuUISongBrowserButton const *b) const
-		{
-			unsigned long time1 = 0;
-			unsigned long time2 = 0;
-			std::vector<OsuBeatmapDifficulty*> *aDiffs = a->getBeatmap()->getDifficultiesPointer();
-			for (int i=0; i<aDiffs->size(); i++)
-			{
-				if ((*aDiffs)[i]->lastModificationTime > time1)
-					time1 = (*aDiffs)[i]->lastModificationTime;
-			}
-
-			std::vector<OsuBeatmapDifficulty*> *bDiffs = b->getBeatmap()->getDifficultiesPointer();
-			for (int i=0; i<bDiffs->size(); i++)
-			{
-				if ((*bDiffs)[i]->lastModificationTime > time2)
-					time2 = (*bDiffs)[i]->lastModificationTime;
-			}
-
-			return time1 < time2;
-		}
-	};
-	std::sort(m_visibleSongButtons.begin(), m_visibleSongButtons.end(), SortComparator());
+	std::sort(m_visibleSongButtons.begin(), m_visibleSongButtons.end(), SortByDateAddedComparator());
 
 	rebuildSongButtons();
 
@@ -1469,45 +1700,7 @@ void OsuSongBrowser2::onGroupDifficulty(CBaseUIButton *b)
 	m_visibleSongButtons = std::vector<OsuUISongBrowserButton*>(m_songButtons.begin(), m_songButtons.end());
 
 	// sort by difficulty
-	struct SortComparator
-	{
-		bool operator() (OsuUISongBrowserButton const *a, OsuUISongBrowserButton const *b) const
-		{
-			float diff1 = 0.0f;
-			float stars1 = 0.0f;
-			std::vector<OsuBeatmapDifficulty*> *aDiffs = a->getBeatmap()->getDifficultiesPointer();
-			for (int i=0; i<aDiffs->size(); i++)
-			{
-				OsuBeatmapDifficulty *d = (*aDiffs)[i];
-				if (d->starsNoMod > stars1)
-					stars1 = d->starsNoMod;
-
-				float tempDiff1 = (d->AR+1)*(d->CS+1)*(d->HP+1)*(d->OD+1)*(d->maxBPM > 0 ? d->maxBPM : 1);
-				if (tempDiff1 > diff1)
-					diff1 = tempDiff1;
-			}
-
-			float diff2 = 0.0f;
-			float stars2 = 0.0f;
-			std::vector<OsuBeatmapDifficulty*> *bDiffs = b->getBeatmap()->getDifficultiesPointer();
-			for (int i=0; i<bDiffs->size(); i++)
-			{
-				OsuBeatmapDifficulty *d = (*bDiffs)[i];
-				if (d->starsNoMod > stars2)
-					stars2 = d->starsNoMod;
-
-				float tempDiff2 = (d->AR+1)*(d->CS+1)*(d->HP+1)*(d->OD+1)*(d->maxBPM > 0 ? d->maxBPM : 1);
-				if (tempDiff2 > diff1)
-					diff2 = tempDiff2;
-			}
-
-			if (stars1 > 0 && stars2 > 0)
-				return stars1 < stars2;
-			else
-				return diff1 < diff2;
-		}
-	};
-	std::sort(m_visibleSongButtons.begin(), m_visibleSongButtons.end(), SortComparator());
+	std::sort(m_visibleSongButtons.begin(), m_visibleSongButtons.end(), SortByDifficultyComparator());
 
 	rebuildSongButtons();
 
@@ -1590,27 +1783,86 @@ void OsuSongBrowser2::selectSongButton(OsuUISongBrowserButton *songButton)
 
 void OsuSongBrowser2::selectRandomBeatmap()
 {
-	// filter songButtons
-	std::vector<CBaseUIElement*> elements = m_songBrowser->getContainer()->getAllBaseUIElements();
-	std::vector<OsuUISongBrowserSongButton*> songButtons;
-	for (int i=0; i<elements.size(); i++)
+	updateRandomBeatmapSelector();
+
+	// never the current one again
+	int currentIndex = -1;
+	if (m_selectedBeatmap != NULL)
 	{
-		OsuUISongBrowserSongButton *songButton = dynamic_cast<OsuUISongBrowserSongButton*>(elements[i]);
-		if (songButton != NULL && songButton->getBeatmap() != NULL)	// only allow songButtons
-			songButtons.push_back(songButton);
+		std::unordered_map<OsuBeatmap*, int>::const_iterator it = m_randomSongButtonIndices.find(m_selectedBeatmap);
+		if (it != m_randomSongButtonIndices.end())
+			currentIndex = it->second;
 	}
 
-	if (songButtons.size() < 1)
+	const int randomIndex = m_randomBeatmapSelector->pick(currentIndex);
+	if (randomIndex < 0)
 		return;
 
 	// remember previous
 	if (m_previousRandomBeatmaps.size() == 0 && m_selectedBeatmap != NULL)
 		m_previousRandomBeatmaps.push_back(m_selectedBeatmap);
 
-	std::uniform_int_distribution<int> rng(0, songButtons.size()-1);
-	int randomIndex = rng(m_rngalg);
-	OsuUISongBrowserSongButton *songButton = dynamic_cast<OsuUISongBrowserSongButton*>(songButtons[randomIndex]);
-	selectSongButton(songButton);
+	selectSongButton(m_randomSongButtons[randomIndex]);
+}
+
+void OsuSongBrowser2::updateRandomBeatmapSelector()
+{
+	m_randomBeatmapSelector->setShuffleBag(osu_songbrowser_random_shuffle.getBool());
+
+	const int weighting = osu_songbrowser_random_weighting.getInt();
+	const int weight = osu_songbrowser_random_weight.getInt();
+	const float starsMin = osu_songbrowser_random_stars_min.getFloat();
+	const float starsMax = osu_songbrowser_random_stars_max.getFloat();
+	if (!m_bRandomSongButtonsChanged && weighting == m_iRandomWeighting && weight == m_iRandomWeight && starsMin == m_fRandomStarsMin && starsMax == m_fRandomStarsMax)
+		return;
+
+	m_bRandomSongButtonsChanged = false;
+	m_iRandomWeighting = weighting;
+	m_iRandomWeight = weight;
+	m_fRandomStarsMin = starsMin;
+	m_fRandomStarsMax = starsMax;
+
+	std::unordered_set<OsuBeatmap*> collectionBeatmaps;
+	if (weighting == 3)
+	{
+		std::vector<OsuBeatmapDatabase::Collection> collections = m_db->getCollections();
+		for (int c=0; c<collections.size(); c++)
+		{
+			for (int b=0; b<collections[c].beatmaps.size(); b++)
+			{
+				collectionBeatmaps.insert(collections[c].beatmaps[b].first);
+			}
+		}
+	}
+
+	m_randomSongButtonIndices.clear();
+	std::vector<int> weights(m_randomSongButtons.size(), 1);
+	for (int i=0; i<m_randomSongButtons.size(); i++)
+	{
+		OsuBeatmap *beatmap = m_randomSongButtons[i]->getBeatmap();
+		m_randomSongButtonIndices[beatmap] = i;
+
+		bool preferred = false;
+		if (weighting == 1 || weighting == 2)
+		{
+			std::vector<OsuBeatmapDifficulty*> *diffs = beatmap->getDifficultiesPointer();
+			preferred = (weighting == 2);
+			for (int d=0; d<diffs->size(); d++)
+			{
+				OsuBeatmapDifficulty *diff = (*diffs)[d];
+				if (weighting == 1 && diff->starsNoMod >= starsMin && diff->starsNoMod <= starsMax)
+					preferred = true;
+				else if (weighting == 2 && diff->hasMD5() && m_db->getScoreDatabase()->getScores(diff->getMD5()).size() > 0)
+					preferred = false;
+			}
+		}
+		else if (weighting == 3)
+			preferred = (collectionBeatmaps.find(beatmap) != collectionBeatmaps.end());
+
+		if (preferred)
+			weights[i] = std::max(weight, 1);
+	}
+	m_randomBeatmapSelector->setCandidates(weights);
 }
 
 void OsuSongBrowser2::selectPreviousRandomBeatmap()
@@ -1621,28 +1873,17 @@ void OsuSongBrowser2::selectPreviousRandomBeatmap()
 		if (m_previousRandomBeatmaps.size() > 1 && m_previousRandomBeatmaps[m_previousRandomBeatmaps.size()-1] == m_selectedBeatmap)
 			m_previousRandomBeatmaps.pop_back(); // deletes the current beatmap which may also be at the top (so we don't switch to ourself)
 
-		// filter songButtons
-		std::vector<CBaseUIElement*> elements = m_songBrowser->getContainer()->getAllBaseUIElements();
-		std::vector<OsuUISongBrowserSongButton*> songButtons;
-		for (int i=0; i<elements.size(); i++)
-		{
-			OsuUISongBrowserSongButton *songButton = dynamic_cast<OsuUISongBrowserSongButton*>(elements[i]);
-			if (songButton != NULL && songButton->getBeatmap() != NULL)	// only allow songButtons
-				songButtons.push_back(songButton);
-		}
+		updateRandomBeatmapSelector();
 
 		// select it, if we can find it (and remove it from memory)
 		bool foundIt = false;
 		OsuBeatmap *previousRandomBeatmap = m_previousRandomBeatmaps.back();
-		for (int i=0; i<songButtons.size(); i++)
+		std::unordered_map<OsuBeatmap*, int>::const_iterator it = m_randomSongButtonIndices.find(previousRandomBeatmap);
+		if (it != m_randomSongButtonIndices.end())
 		{
-			if (songButtons[i]->getBeatmap() != NULL && songButtons[i]->getBeatmap() == previousRandomBeatmap)
-			{
-				m_previousRandomBeatmaps.pop_back();
-				selectSongButton(songButtons[i]);
-				foundIt = true;
-				break;
-			}
+			m_previousRandomBeatmaps.pop_back();
+			selectSongButton(m_randomSongButtons[it->second]);
+			foundIt = true;
 		}
 
 		// if we didn't find it then restore the current random beatmap, which got pop_back()'d above (shit logic)
@@ -11,10 +11,13 @@
 #include "OsuScreenBackable.h"
 #include "MouseListener.h"
 
+#include <unordered_map>
+
 class Osu;
 class OsuBeatmap;
 class OsuBeatmapDatabase;
 class OsuBeatmapDifficulty;
+class OsuRandomBeatmapSelector;
 
 class OsuUIContextMenu;
 class OsuUISelectionButton;
@@ -68,6 +71,7 @@ public:
 	void scrollToSongButton(OsuUISongBrowserButton *songButton, bool alignOnTop = false);
 	void scrollToSelectedSongButton();
 	void rebuildSongButtons(bool unloadAllThumbnails = true);
+	void rebuildCollectionButtons(); // e.g. after a collection has been edited
 	void updateSongButtonLayout();
 
 	OsuUISongBrowserButton* findCurrentlySelectedSongButton() const;
@@ -76,6 +80,7 @@ public:
 
 	inline bool hasSelectedAndIsPlaying() {return m_bHasSelectedAndIsPlaying;}
 	inline OsuBeatmap *getSelectedBeatmap() const {return m_selectedBeatmap;}
+	inline OsuBeatmapDatabase *getDatabase() const {return m_db;}
 
 private:
 	static bool searchMatcher(OsuBeatmap *beatmap, UString searchString);
@@ -99,6 +104,7 @@ private:
 	CBaseUIButton *addTopBarRightSortButton(UString text);
 
 	void onDatabaseLoadingFinished();
+	void applyDatabaseChanges(); // of an incremental refresh, only the buttons of added/removed beatmaps are created/deleted
 
 	void onSortClicked(CBaseUIButton *button);
 	void onSortChange(UString text);
@@ -115,13 +121,13 @@ private:
 
 	void selectSongButton(OsuUISongBrowserButton *songButton);
 	void selectRandomBeatmap();
+	void updateRandomBeatmapSelector(); // if the candidates or the settings have changed
 	void selectPreviousRandomBeatmap();
 	void playSelectedDifficulty();
 
 	ConVar *m_fps_max_ref;
 
 	Osu *m_osu;
-	std::mt19937 m_rngalg;
 	GROUP m_group;
 
 	// top bar
@@ -154,6 +160,7 @@ private:
 	std::vector<OsuUISongBrowserCollectionButton*> m_collectionButtons;
 	std::vector<OsuUISongBrowserDifficultyCollectionButton*> m_difficultyCollectionButtons;
 	bool m_bBeatmapRefreshScheduled;
+	bool m_bBeatmapRefreshIsIncremental;
 	UString m_sLastOsuFolder;
 
 	// keys
@@ -171,6 +178,16 @@ private:
 	float m_fPulseAnimation;
 	std::vector<OsuBeatmap*> m_previousRandomBeatmaps;
 
+	// random selection, the candidates are the song buttons in the container (updated by rebuildSongButtons())
+	OsuRandomBeatmapSelector *m_randomBeatmapSelector;
+	std::vector<OsuUISongBrowserSongButton*> m_randomSongButtons;
+	std::unordered_map<OsuBeatmap*, int> m_randomSongButtonIndices;
+	bool m_bRandomSongButtonsChanged;
+	int m_iRandomWeighting;
+	int m_iRandomWeight;
+	float m_fRandomStarsMin;
+	float m_fRandomStarsMax;
+
 	// search
 	UString m_sSearchString;
 	float m_fSearchWaitTime;
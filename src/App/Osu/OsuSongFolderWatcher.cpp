@@ -0,0 +1,689 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		detects added/removed/modified beatmap folders in the Songs folder
+//
+// $NoKeywords: $osusfw
+//===============================================================================//
+
+#include "OsuSongFolderWatcher.h"
+
+#include "Engine.h"
+#include "ConVar.h"
+#include "Timer.h"
+
+#include "Osu.h"
+#include "OsuBeatmapDifficulty.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32) || defined(_WIN64) || defined(__WIN32__) || defined(__CYGWIN__) || defined(__CYGWIN32__) || defined(__TOS_WIN__) || defined(__WINDOWS__)
+
+#include <direct.h>
+#define OSU_STAT_STRUCT struct _stat64
+#define OSU_STAT(path, buf) _stat64(path, buf)
+#define OSU_STAT_ISDIR(mode) (((mode) & _S_IFDIR) != 0)
+#define OSU_STAT_MTIME_NS(buf) ((long long)(buf).st_mtime*1000000000LL)
+#define OSU_MKDIR(path) _mkdir(path)
+#define OSU_RMDIR(path) _rmdir(path)
+
+#else
+
+#include <unistd.h>
+#define OSU_STAT_STRUCT struct stat
+#define OSU_STAT(path, buf) stat(path, buf)
+#define OSU_STAT_ISDIR(mode) S_ISDIR(mode)
+#define OSU_MKDIR(path) mkdir(path, 0755)
+#define OSU_RMDIR(path) rmdir(path)
+
+#ifdef __linux__
+
+#include <sys/inotify.h>
+#include <errno.h>
+#define OSU_SONGFOLDERWATCHER_INOTIFY
+#define OSU_STAT_MTIME_NS(buf) ((long long)(buf).st_mtim.tv_sec*1000000000LL + (long long)(buf).st_mtim.tv_nsec)
+
+#else
+
+#define OSU_STAT_MTIME_NS(buf) ((long long)(buf).st_mtime*1000000000LL)
+
+#endif
+
+#endif
+
+ConVar osu_songfolder_watcher("osu_songfolder_watcher", true, "use inotify (linux) to find changed beatmap folders when refreshing, instead of scanning all of them");
+
+static std::vector<UString> songFolderWatcherSorted(std::vector<std::string> &names)
+{
+	std::sort(names.begin(), names.end());
+
+	std::vector<UString> result;
+	for (int i=0; i<names.size(); i++)
+	{
+		result.push_back(UString(names[i].c_str()));
+	}
+	return result;
+}
+
+OsuSongFolderWatcher::OsuSongFolderWatcher()
+{
+	m_bUseInotify = false;
+	m_bHasSnapshot = false;
+
+	m_iInotifyFD = -1;
+	m_bWatchingEverything = false;
+}
+
+OsuSongFolderWatcher::~OsuSongFolderWatcher()
+{
+	closeInotify();
+}
+
+void OsuSongFolderWatcher::setFolder(UString songFolder, bool useInotify)
+{
+	closeInotify();
+
+	m_sSongFolder = songFolder;
+	if (m_sSongFolder.length() > 0 && m_sSongFolder[m_sSongFolder.length()-1] != L'/' && m_sSongFolder[m_sSongFolder.length()-1] != L'\\')
+		m_sSongFolder.append("/");
+
+	m_bUseInotify = useInotify && osu_songfolder_watcher.getBool();
+	m_bHasSnapshot = false;
+	m_folders.clear();
+}
+
+std::vector<UString> OsuSongFolderWatcher::snapshot()
+{
+	m_bHasSnapshot = true;
+	return scanAll();
+}
+
+OsuSongFolderWatcher::CHANGES OsuSongFolderWatcher::getChanges()
+{
+	CHANGES changes;
+
+	if (isWatching())
+		readEvents();
+
+	if (m_bHasSnapshot && isWatching())
+	{
+		// only the folders inotify has told us about
+		std::vector<std::string> dirtyFolders(m_dirtyFolders.begin(), m_dirtyFolders.end());
+		m_dirtyFolders.clear();
+		std::sort(dirtyFolders.begin(), dirtyFolders.end());
+
+		for (int i=0; i<dirtyFolders.size(); i++)
+		{
+			compareFolder(dirtyFolders[i], &changes);
+		}
+	}
+	else
+	{
+		// everything, against the previous snapshot
+		std::unordered_map<std::string, FOLDER> previousFolders;
+		previousFolders.swap(m_folders);
+		scanAll();
+
+		std::vector<std::string> added;
+		std::vector<std::string> removed;
+		std::vector<std::string> modified;
+		for (std::unordered_map<std::string, FOLDER>::const_iterator it = m_folders.begin(); it != m_folders.end(); ++it)
+		{
+			std::unordered_map<std::string, FOLDER>::const_iterator previousIt = previousFolders.find(it->first);
+			if (previousIt == previousFolders.end())
+				added.push_back(it->first);
+			else if (previousIt->second.numOsuFiles != it->second.numOsuFiles || previousIt->second.size != it->second.size || previousIt->second.mtime != it->second.mtime)
+				modified.push_back(it->first);
+		}
+		for (std::unordered_map<std::string, FOLDER>::const_iterator it = previousFolders.begin(); it != previousFolders.end(); ++it)
+		{
+			if (m_folders.find(it->first) == m_folders.end())
+				removed.push_back(it->first);
+		}
+
+		changes.added = songFolderWatcherSorted(added);
+		changes.removed = songFolderWatcherSorted(removed);
+		changes.modified = songFolderWatcherSorted(modified);
+	}
+
+	m_bHasSnapshot = true;
+	return changes;
+}
+
+void OsuSongFolderWatcher::forget(UString folderName)
+{
+	m_folders.erase(std::string(folderName.toUtf8()));
+}
+
+bool OsuSongFolderWatcher::scanFolder(UString folderPath, FOLDER *folder)
+{
+	folder->numOsuFiles = 0;
+	folder->size = 0;
+	folder->mtime = 0;
+
+	// stat() doesn't like trailing slashes on windows
+	UString statPath = folderPath;
+	while (statPath.length() > 1 && (statPath[statPath.length()-1] == L'/' || statPath[statPath.length()-1] == L'\\'))
+	{
+		statPath = statPath.substr(0, statPath.length()-1);
+	}
+
+	OSU_STAT_STRUCT folderStat;
+	if (OSU_STAT(statPath.toUtf8(), &folderStat) != 0 || !OSU_STAT_ISDIR(folderStat.st_mode))
+		return false;
+
+	if (folderPath.length() > 0 && folderPath[folderPath.length()-1] != L'/' && folderPath[folderPath.length()-1] != L'\\')
+		folderPath.append("/");
+
+	// only the .osu files matter, everything else is just referenced by them
+	std::vector<UString> files = env->getFilesInFolder(folderPath);
+	for (int i=0; i<files.size(); i++)
+	{
+		const UString ext = env->getFileExtensionFromFilePath(files[i]);
+		if (!(ext == "osu"))
+			continue;
+
+		UString filePath = folderPath;
+		filePath.append(files[i]);
+
+		OSU_STAT_STRUCT fileStat;
+		if (OSU_STAT(filePath.toUtf8(), &fileStat) != 0)
+			continue;
+
+		folder->numOsuFiles++;
+		folder->size += (unsigned long long)fileStat.st_size;
+		folder->mtime = std::max(folder->mtime, (long long)OSU_STAT_MTIME_NS(fileStat));
+	}
+
+	return true;
+}
+
+std::vector<UString> OsuSongFolderWatcher::scanAll()
+{
+	// watch the songs folder before scanning, and every folder before scanning it, so that nothing which happens in between is lost
+	closeInotify();
+	if (m_bUseInotify)
+		openInotify();
+
+	m_folders.clear();
+	std::vector<UString> scannedFolderNames;
+	std::vector<UString> folderNames = env->getFoldersInFolder(m_sSongFolder);
+	for (int i=0; i<folderNames.size(); i++)
+	{
+		if (folderNames[i] == "." || folderNames[i] == "..")
+			continue;
+
+		const std::string name = std::string(folderNames[i].toUtf8());
+		addWatch(name);
+
+		UString folderPath = m_sSongFolder;
+		folderPath.append(folderNames[i]);
+		folderPath.append("/");
+
+		FOLDER folder;
+		if (scanFolder(folderPath, &folder))
+		{
+			m_folders[name] = folder;
+			scannedFolderNames.push_back(folderNames[i]);
+		}
+	}
+
+	return scannedFolderNames;
+}
+
+void OsuSongFolderWatcher::compareFolder(const std::string &name, CHANGES *changes)
+{
+	UString folderPath = m_sSongFolder;
+	folderPath.append(UString(name.c_str()));
+	folderPath.append("/");
+
+	FOLDER folder;
+	const bool exists = scanFolder(folderPath, &folder);
+
+	std::unordered_map<std::string, FOLDER>::iterator it = m_folders.find(name);
+	if (it == m_folders.end())
+	{
+		if (exists)
+		{
+			m_folders[name] = folder;
+			changes->added.push_back(UString(name.c_str()));
+		}
+	}
+	else if (!exists)
+	{
+		m_folders.erase(it);
+		changes->removed.push_back(UString(name.c_str()));
+	}
+	else if (it->second.numOsuFiles != folder.numOsuFiles || it->second.size != folder.size || it->second.mtime != folder.mtime)
+	{
+		it->second = folder;
+		changes->modified.push_back(UString(name.c_str()));
+	}
+}
+
+void OsuSongFolderWatcher::openInotify()
+{
+#ifdef OSU_SONGFOLDERWATCHER_INOTIFY
+	m_iInotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_iInotifyFD < 0)
+	{
+		debugLog("OsuSongFolderWatcher: inotify_init1() failed (%i), scanning instead.\n", errno);
+		return;
+	}
+
+	const int wd = inotify_add_watch(m_iInotifyFD, m_sSongFolder.toUtf8(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+	if (wd < 0)
+	{
+		debugLog("OsuSongFolderWatcher: Couldn't watch %s (%i), scanning instead.\n", m_sSongFolder.toUtf8(), errno);
+		closeInotify();
+		return;
+	}
+
+	m_watches[wd] = "";
+	m_bWatchingEverything = true;
+#endif
+}
+
+void OsuSongFolderWatcher::closeInotify()
+{
+#ifdef OSU_SONGFOLDERWATCHER_INOTIFY
+	if (m_iInotifyFD >= 0)
+		close(m_iInotifyFD);
+#endif
+
+	m_iInotifyFD = -1;
+	m_bWatchingEverything = false;
+	m_watches.clear();
+	m_watchesByName.clear();
+	m_dirtyFolders.clear();
+}
+
+void OsuSongFolderWatcher::addWatch(const std::string &name)
+{
+#ifdef OSU_SONGFOLDERWATCHER_INOTIFY
+	if (m_iInotifyFD < 0)
+		return;
+
+	UString folderPath = m_sSongFolder;
+	folderPath.append(UString(name.c_str()));
+
+	const int wd = inotify_add_watch(m_iInotifyFD, folderPath.toUtf8(), IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_ONLYDIR);
+	if (wd < 0)
+	{
+		// usually fs.inotify.max_user_watches, a half watched folder is useless
+		if (errno != ENOENT && errno != ENOTDIR)
+		{
+			debugLog("OsuSongFolderWatcher: Couldn't watch %s (%i), scanning instead.\n", folderPath.toUtf8(), errno);
+			closeInotify();
+		}
+		return;
+	}
+
+	m_watches[wd] = name;
+	m_watchesByName[name] = wd;
+#endif
+}
+
+void OsuSongFolderWatcher::removeWatch(const std::string &name)
+{
+#ifdef OSU_SONGFOLDERWATCHER_INOTIFY
+	std::unordered_map<std::string, int>::iterator it = m_watchesByName.find(name);
+	if (it == m_watchesByName.end())
+		return;
+
+	// a moved folder keeps its watch, which would then report changes under the old name
+	inotify_rm_watch(m_iInotifyFD, it->second);
+	m_watches.erase(it->second);
+	m_watchesByName.erase(it);
+#endif
+}
+
+void OsuSongFolderWatcher::readEvents()
+{
+#ifdef OSU_SONGFOLDERWATCHER_INOTIFY
+	alignas(struct inotify_event) char buffer[16384];
+	while (m_iInotifyFD >= 0)
+	{
+		const ssize_t length = read(m_iInotifyFD, buffer, sizeof(buffer));
+		if (length <= 0)
+			break; // EAGAIN, nothing left
+
+		const struct inotify_event *event = NULL;
+		for (const char *ptr = buffer; ptr < buffer + length; ptr += sizeof(struct inotify_event) + event->len)
+		{
+			event = (const struct inotify_event*)ptr;
+
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				debugLog("OsuSongFolderWatcher: Event queue overflow, scanning instead.\n");
+				m_bWatchingEverything = false;
+				continue;
+			}
+
+			std::unordered_map<int, std::string>::iterator it = m_watches.find(event->wd);
+			if (it == m_watches.end())
+				continue;
+
+			if (it->second.length() == 0)
+			{
+				// the songs folder itself
+				if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+				{
+					m_bWatchingEverything = false;
+					continue;
+				}
+
+				if (event->len < 1 || !(event->mask & IN_ISDIR))
+					continue; // files directly in the songs folder aren't beatmaps
+
+				const std::string name(event->name);
+				m_dirtyFolders.insert(name);
+
+				if (event->mask & (IN_CREATE | IN_MOVED_TO))
+					addWatch(name);
+				else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+					removeWatch(name);
+			}
+			else
+			{
+				if (event->mask & IN_IGNORED)
+				{
+					// the folder is gone (the songs folder watch reports that), or the watch was removed
+					std::unordered_map<std::string, int>::iterator nameIt = m_watchesByName.find(it->second);
+					if (nameIt != m_watchesByName.end() && nameIt->second == event->wd)
+						m_watchesByName.erase(nameIt);
+					m_watches.erase(it);
+					continue;
+				}
+
+				m_dirtyFolders.insert(it->second);
+			}
+		}
+	}
+#endif
+}
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+static void songFolderTestWriteFile(UString filePath, const char *content, bool append)
+{
+	FILE *file = fopen(filePath.toUtf8(), append ? "ab" : "wb");
+	if (file == NULL)
+	{
+		debugLog("osu_songfolder_test: Couldn't write %s\n", filePath.toUtf8());
+		return;
+	}
+	fputs(content, file);
+	fclose(file);
+}
+
+static void songFolderTestDelete(UString folderPath)
+{
+	std::vector<UString> files = env->getFilesInFolder(folderPath);
+	for (int i=0; i<files.size(); i++)
+	{
+		UString filePath = folderPath;
+		filePath.append(files[i]);
+		std::remove(filePath.toUtf8());
+	}
+
+	std::vector<UString> folders = env->getFoldersInFolder(folderPath);
+	for (int i=0; i<folders.size(); i++)
+	{
+		if (folders[i] == "." || folders[i] == "..")
+			continue;
+
+		UString subFolderPath = folderPath;
+		subFolderPath.append(folders[i]);
+		subFolderPath.append("/");
+		songFolderTestDelete(subFolderPath);
+	}
+
+	OSU_RMDIR(folderPath.toUtf8());
+}
+
+static bool songFolderTestEquals(const std::vector<UString> &names, const std::vector<std::string> &expected)
+{
+	if (names.size() != expected.size())
+		return false;
+
+	for (int i=0; i<names.size(); i++)
+	{
+		if (std::string(names[i].toUtf8()) != expected[i])
+			return false;
+	}
+	return true;
+}
+
+static const char *songFolderTestOsuFile = "osu file format v14\n\n[General]\nAudioFilename: audio.mp3\nPreviewTime: 0\nMode: 0\n\n[Metadata]\nTitle:Test\nArtist:Test\nCreator:Test\nVersion:Normal\n\n[Difficulty]\nHPDrainRate:5\nCircleSize:4\nOverallDifficulty:8\nApproachRate:9\nSliderMultiplier:1.4\n\n[TimingPoints]\n0,500,4,2,0,100,1,0\n\n[HitObjects]\n256,192,1000,1,0,0:0:0:0:\n";
+
+void OsuSongFolderWatcher::test(Osu *osu, int numBenchmarkFolders)
+{
+	int numTests = 0;
+	int numFailed = 0;
+
+	const UString testFolder = "songfolder_test/";
+	const UString songFolder = "songfolder_test/Songs/";
+	songFolderTestDelete(testFolder); // leftovers of a previous run
+	OSU_MKDIR(testFolder.toUtf8());
+	OSU_MKDIR(songFolder.toUtf8());
+
+	// scripted mutations, once by scanning and once by inotify (if available)
+	{
+		for (int i=1; i<=5; i++)
+		{
+			UString folderPath = songFolder;
+			folderPath.append(UString::format("%i", i));
+			OSU_MKDIR(folderPath.toUtf8());
+			folderPath.append("/");
+
+			UString osuFilePath = folderPath;
+			osuFilePath.append("Test - Test (Test) [Normal].osu");
+			songFolderTestWriteFile(osuFilePath, songFolderTestOsuFile, false);
+		}
+
+		OsuSongFolderWatcher scanWatcher;
+		scanWatcher.setFolder(songFolder, false);
+		OsuSongFolderWatcher inotifyWatcher;
+		inotifyWatcher.setFolder(songFolder, true);
+
+		numTests++;
+		if (scanWatcher.snapshot().size() != 5 || inotifyWatcher.snapshot().size() != 5)
+		{
+			numFailed++;
+			debugLog("osu_songfolder_test: FAILED snapshot\n");
+		}
+
+		const bool haveInotify = inotifyWatcher.isWatching();
+		if (!haveInotify)
+			debugLog("osu_songfolder_test: inotify is unavailable, only testing scanning\n");
+
+		struct STEP
+		{
+			const char *name;
+			std::vector<std::string> added;
+			std::vector<std::string> removed;
+			std::vector<std::string> modified;
+		};
+
+		for (int s=0; s<7; s++)
+		{
+			STEP step;
+			if (s == 0)
+			{
+				step.name = "add folder";
+				UString folderPath = songFolder;
+				folderPath.append("6 new");
+				OSU_MKDIR(folderPath.toUtf8());
+				folderPath.append("/Test - Test (Test) [Normal].osu");
+				songFolderTestWriteFile(folderPath, songFolderTestOsuFile, false);
+				step.added.push_back("6 new");
+			}
+			else if (s == 1)
+			{
+				step.name = "remove folder";
+				UString folderPath = songFolder;
+				folderPath.append("2/");
+				songFolderTestDelete(folderPath);
+				step.removed.push_back("2");
+			}
+			else if (s == 2)
+			{
+				step.name = "modify .osu file";
+				UString filePath = songFolder;
+				filePath.append("3/Test - Test (Test) [Normal].osu");
+				songFolderTestWriteFile(filePath, "512,192,1500,1,0,0:0:0:0:\n", true);
+				step.modified.push_back("3");
+			}
+			else if (s == 3)
+			{
+				step.name = "add .osu file";
+				UString filePath = songFolder;
+				filePath.append("4/Test - Test (Test) [Hard].osu");
+				songFolderTestWriteFile(filePath, songFolderTestOsuFile, false);
+				step.modified.push_back("4");
+			}
+			else if (s == 4)
+			{
+				step.name = "add other file";
+				UString filePath = songFolder;
+				filePath.append("1/bg.jpg");
+				songFolderTestWriteFile(filePath, "not really a jpg", false);
+			}
+			else if (s == 5)
+			{
+				step.name = "rename folder";
+				UString oldPath = songFolder;
+				oldPath.append("5");
+				UString newPath = songFolder;
+				newPath.append("5 renamed");
+				std::rename(oldPath.toUtf8(), newPath.toUtf8());
+				step.added.push_back("5 renamed");
+				step.removed.push_back("5");
+			}
+			else
+				step.name = "nothing";
+
+			for (int w=0; w<2; w++)
+			{
+				OsuSongFolderWatcher &watcher = (w == 0 ? scanWatcher : inotifyWatcher);
+				if (w == 1 && !haveInotify)
+					continue;
+
+				const CHANGES changes = watcher.getChanges();
+
+				numTests++;
+				if (!songFolderTestEquals(changes.added, step.added) || !songFolderTestEquals(changes.removed, step.removed) || !songFolderTestEquals(changes.modified, step.modified))
+				{
+					numFailed++;
+					debugLog("osu_songfolder_test: FAILED %s (%s): %i added, %i removed, %i modified\n", step.name, w == 0 ? "scan" : "inotify", (int)changes.added.size(), (int)changes.removed.size(), (int)changes.modified.size());
+				}
+			}
+
+			// the renamed folder is still watched, under its new name
+			if (s == 5 && haveInotify)
+			{
+				numTests++;
+				if (!inotifyWatcher.isWatching() || inotifyWatcher.m_watchesByName.find("5 renamed") == inotifyWatcher.m_watchesByName.end() || inotifyWatcher.m_watchesByName.find("5") != inotifyWatcher.m_watchesByName.end())
+				{
+					numFailed++;
+					debugLog("osu_songfolder_test: FAILED watches after rename\n");
+				}
+			}
+		}
+
+		numTests++;
+		if (scanWatcher.getNumFolders() != 5 || (haveInotify && inotifyWatcher.getNumFolders() != 5))
+		{
+			numFailed++;
+			debugLog("osu_songfolder_test: FAILED final snapshot (%i, %i folders)\n", scanWatcher.getNumFolders(), inotifyWatcher.getNumFolders());
+		}
+	}
+	songFolderTestDelete(songFolder);
+	OSU_MKDIR(songFolder.toUtf8());
+
+	// benchmark, one folder added to a big library: finding it (scanning, inotify) + parsing it, against parsing everything again (the old refresh)
+	if (numBenchmarkFolders > 0)
+	{
+		for (int i=0; i<numBenchmarkFolders; i++)
+		{
+			UString folderPath = songFolder;
+			folderPath.append(UString::format("%i", i));
+			OSU_MKDIR(folderPath.toUtf8());
+			folderPath.append("/Test - Test (Test) [Normal].osu");
+			songFolderTestWriteFile(folderPath, songFolderTestOsuFile, false);
+		}
+
+		OsuSongFolderWatcher scanWatcher;
+		scanWatcher.setFolder(songFolder, false);
+		scanWatcher.snapshot();
+		OsuSongFolderWatcher inotifyWatcher;
+		inotifyWatcher.setFolder(songFolder, true);
+		inotifyWatcher.snapshot();
+
+		UString newFolderPath = songFolder;
+		newFolderPath.append("new");
+		OSU_MKDIR(newFolderPath.toUtf8());
+		newFolderPath.append("/");
+		UString newFilePath = newFolderPath;
+		newFilePath.append("Test - Test (Test) [Normal].osu");
+		songFolderTestWriteFile(newFilePath, songFolderTestOsuFile, false);
+
+		Timer t;
+		t.start();
+		CHANGES scanChanges = scanWatcher.getChanges();
+		t.update();
+		const double scanTime = t.getElapsedTime();
+
+		t.start();
+		CHANGES inotifyChanges = inotifyWatcher.getChanges();
+		t.update();
+		const double inotifyTime = t.getElapsedTime();
+
+		numTests++;
+		if (scanChanges.added.size() != 1 || (inotifyWatcher.isWatching() && inotifyChanges.added.size() != 1))
+		{
+			numFailed++;
+			debugLog("osu_songfolder_test: FAILED benchmark changes (%i scan, %i inotify)\n", (int)scanChanges.added.size(), (int)inotifyChanges.added.size());
+		}
+
+		t.start();
+		{
+			OsuBeatmapDifficulty diff(osu, newFilePath, newFolderPath);
+			diff.loadMetadataRaw();
+		}
+		t.update();
+		const double parseOneTime = t.getElapsedTime();
+
+		t.start();
+		std::vector<UString> folderNames = env->getFoldersInFolder(songFolder);
+		for (int i=0; i<folderNames.size(); i++)
+		{
+			if (folderNames[i] == "." || folderNames[i] == "..")
+				continue;
+
+			UString folderPath = songFolder;
+			folderPath.append(folderNames[i]);
+			folderPath.append("/");
+			UString filePath = folderPath;
+			filePath.append("Test - Test (Test) [Normal].osu");
+
+			OsuBeatmapDifficulty diff(osu, filePath, folderPath);
+			diff.loadMetadataRaw();
+		}
+		t.update();
+		const double parseAllTime = t.getElapsedTime();
+
+		debugLog("osu_songfolder_test: 1 added folder in a library of %i: scan %f ms, inotify %f ms (%s), parsing it %f ms, parsing everything (full refresh) %f ms\n", numBenchmarkFolders, scanTime*1000.0, inotifyTime*1000.0, inotifyWatcher.isWatching() ? "active" : "unavailable", parseOneTime*1000.0, parseAllTime*1000.0);
+	}
+
+	songFolderTestDelete(testFolder);
+
+	debugLog("osu_songfolder_test: %s, %i/%i passed\n", numFailed == 0 ? "PASSED" : "FAILED", numTests - numFailed, numTests);
+}
@@ -0,0 +1,80 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		detects added/removed/modified beatmap folders in the Songs folder
+//
+// $NoKeywords: $osusfw
+//===============================================================================//
+
+#ifndef OSUSONGFOLDERWATCHER_H
+#define OSUSONGFOLDERWATCHER_H
+
+#include "cbase.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
+class Osu;
+
+// the snapshot remembers the .osu files (number, total size, newest mtime) of every beatmap folder, changes are found by comparing against the current state
+// on linux, inotify additionally tells us which folders have been touched since the last snapshot, so that only those have to be looked at again
+// if inotify is unavailable, runs out of watches or loses events, the next getChanges() falls back to scanning every folder (and starts watching again)
+class OsuSongFolderWatcher
+{
+public:
+	struct FOLDER
+	{
+		int numOsuFiles;
+		unsigned long long size; // of all .osu files
+		long long mtime; // of the newest .osu file, in nanoseconds (only second precision on some platforms)
+	};
+
+	struct CHANGES
+	{
+		// folder names (relative to the songs folder), sorted
+		std::vector<UString> added;
+		std::vector<UString> removed;
+		std::vector<UString> modified;
+	};
+
+public:
+	OsuSongFolderWatcher();
+	~OsuSongFolderWatcher();
+
+	void setFolder(UString songFolder, bool useInotify = true); // forgets the snapshot
+	std::vector<UString> snapshot(); // full scan, everything which is there now is the baseline, returns the folder names in the order of the environment
+	CHANGES getChanges(); // since the last snapshot()/getChanges(), updates the snapshot
+	void forget(UString folderName); // e.g. if loading it has been cancelled, so that the next getChanges() reports it as added again
+
+	inline UString getFolder() const {return m_sSongFolder;}
+	inline bool hasSnapshot() const {return m_bHasSnapshot;}
+	inline int getNumFolders() const {return m_folders.size();}
+	inline bool isWatching() const {return m_iInotifyFD >= 0 && m_bWatchingEverything;}
+
+	static bool scanFolder(UString folderPath, FOLDER *folder); // false if it isn't a folder (anymore)
+
+	static void test(Osu *osu, int numBenchmarkFolders); // scripted mutations of a temporary songs folder + single added folder latency (osu_songfolder_test)
+
+private:
+	std::vector<UString> scanAll(); // into m_folders, (re)starts watching, returns the folder names in the order of the environment
+	void compareFolder(const std::string &name, CHANGES *changes); // against the snapshot, and updates it
+
+	void openInotify();
+	void closeInotify();
+	void addWatch(const std::string &name);
+	void removeWatch(const std::string &name);
+	void readEvents();
+
+	UString m_sSongFolder;
+	bool m_bUseInotify;
+	bool m_bHasSnapshot;
+	std::unordered_map<std::string, FOLDER> m_folders;
+
+	// inotify
+	int m_iInotifyFD; // -1 if not watching
+	bool m_bWatchingEverything; // false if a folder couldn't be watched, or if events were lost
+	std::unordered_map<int, std::string> m_watches; // watch descriptor -> folder name ("" for the songs folder itself)
+	std::unordered_map<std::string, int> m_watchesByName;
+	std::unordered_set<std::string> m_dirtyFolders; // touched since the last getChanges()
+};
+
+#endif
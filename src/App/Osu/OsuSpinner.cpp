@@ -98,7 +98,7 @@ void OsuSpinner::draw(Graphics *g)
 		}
 
 		// draw approach circle
-		if (!m_beatmap->getOsu()->getModHD() && m_fPercent > 0.0f)
+		if (!m_beatmap->getMods().has(OsuMods::HD) && m_fPercent > 0.0f)
 		{
 			float spinnerApproachCircleImageScale = globalBaseSize / ((globalBaseSkinSize/2) * (skin->isSpinnerApproachCircle2x() ? 2.0f : 1.0f));
 
@@ -172,7 +172,7 @@ void OsuSpinner::draw(Graphics *g)
 		}
 
 		// draw approach circle
-		if (!m_beatmap->getOsu()->getModHD() && m_fPercent > 0.0f)
+		if (!m_beatmap->getMods().has(OsuMods::HD) && m_fPercent > 0.0f)
 		{
 			const float spinnerApproachCircleImageScale = globalBaseSize / ((globalBaseSkinSize/2) * (skin->isSpinnerApproachCircle2x() ? 2.0f : 1.0f));
 
@@ -247,9 +247,9 @@ void OsuSpinner::update(long curPos)
 		}
 
 		// HACKHACK: added 0.75 multiplier until i fix the rotation logic frametime bullshit code from opsu
-		m_fRotationsNeeded = (int)(((float)m_iObjectDuration / 1000.0f * OsuGameRules::getSpinnerSpins(m_beatmap))*0.75f) * (std::min(1.0f / m_beatmap->getOsu()->getSpeedMultiplier(), 1.0f));
+		m_fRotationsNeeded = (int)(((float)m_iObjectDuration / 1000.0f * m_beatmap->getDifficulty().spinnerSpins)*0.75f) * (std::min(1.0f / m_beatmap->getOsu()->getSpeedMultiplier(), 1.0f));
 
-		float fixedRate = /*(1.0f / convar->getConVarByName("fps_max")->getFloat())*/engine->getFrameTime();
+		float fixedRate = /*(1.0f / convar->getConVarByName("fps_max")->getFloat())*/m_beatmap->getFrameTime();
 
 		const float DELTA_UPDATE_TIME = (fixedRate * 1000.0f);
 		const float AUTO_MULTIPLIER = (1.0f / 20.0f);
@@ -261,11 +261,11 @@ void OsuSpinner::update(long curPos)
 
 		// handle auto, mouse spinning movement
 		float angleDiff = 0;
-		if (m_beatmap->getOsu()->getModAuto() || m_beatmap->getOsu()->getModAutopilot() || m_beatmap->getOsu()->getModSpunout())
-			angleDiff = engine->getFrameTime() * 1000.0f * AUTO_MULTIPLIER * m_beatmap->getOsu()->getSpeedMultiplier();
+		if (m_beatmap->getMods().has(OsuMods::AUTO) || m_beatmap->getMods().has(OsuMods::AUTOPILOT) || m_beatmap->getMods().has(OsuMods::SPUNOUT))
+			angleDiff = m_beatmap->getFrameTime() * 1000.0f * AUTO_MULTIPLIER * m_beatmap->getOsu()->getSpeedMultiplier();
 		else // user spin
 		{
-			Vector2 mouseDelta = engine->getMouse()->getPos() - m_beatmap->osuCoords2Pixels(Vector2(m_vRawPos.x, m_vRawPos.y));
+			Vector2 mouseDelta = (m_beatmap->isSimulating() ? m_beatmap->getCursorPos() : engine->getMouse()->getPos()) - m_beatmap->osuCoords2Pixels(Vector2(m_vRawPos.x, m_vRawPos.y));
 			float currentMouseAngle = (float) atan2(mouseDelta.y, mouseDelta.x);
 			angleDiff = (currentMouseAngle - m_fLastMouseAngle);
 			if (std::abs(angleDiff) > 0.001f)
@@ -284,9 +284,9 @@ void OsuSpinner::update(long curPos)
 		// HACKHACK: rewrite this
 		if (delta <= 0)
 		{
-			bool isSpinning = m_beatmap->isClickHeld() || m_beatmap->getOsu()->getModAuto() || m_beatmap->getOsu()->getModRelax() || m_beatmap->getOsu()->getModSpunout();
+			bool isSpinning = m_beatmap->isClickHeld() || m_beatmap->getMods().has(OsuMods::AUTO) || m_beatmap->getMods().has(OsuMods::RELAX) || m_beatmap->getMods().has(OsuMods::SPUNOUT);
 
-			m_fDeltaOverflow += engine->getFrameTime() * 1000.0f;
+			m_fDeltaOverflow += m_beatmap->getFrameTime() * 1000.0f;
 
 			if (angleDiff < -PI)
 				angleDiff += 2*PI;
@@ -380,6 +380,53 @@ void OsuSpinner::onReset(long curPos)
 		m_bFinished = false;
 }
 
+bool OsuSpinner::getProgress(long curPos, PROGRESS *progress) const
+{
+	// unfinished spinners are always stored, even before they start they track the cursor angle
+	if (m_bFinished)
+		return false;
+
+	progress->rotations = m_fRotations;
+	progress->ratio = m_fRatio;
+	progress->drawRot = m_fDrawRot;
+	progress->deltaOverflow = m_fDeltaOverflow;
+	progress->deltaAngleOverflow = m_fDeltaAngleOverflow;
+	progress->sumDeltaAngle = m_fSumDeltaAngle;
+	progress->lastMouseAngle = m_fLastMouseAngle;
+	progress->rpm = m_fRPM;
+	progress->clickedOnce = m_bClickedOnce;
+	progress->deltaAngleIndex = m_iDeltaAngleIndex;
+	for (int i=0; i<m_iMaxStoredDeltaAngles && i<sizeof(progress->storedDeltaAngles)/sizeof(progress->storedDeltaAngles[0]); i++)
+	{
+		progress->storedDeltaAngles[i] = m_storedDeltaAngles[i];
+	}
+	return true;
+}
+
+void OsuSpinner::onRestore(long curPos, bool finished, const PROGRESS *progress)
+{
+	onReset(curPos);
+	m_bFinished = finished;
+
+	if (progress != NULL)
+	{
+		m_fRotations = progress->rotations;
+		m_fRatio = progress->ratio;
+		m_fDrawRot = progress->drawRot;
+		m_fDeltaOverflow = progress->deltaOverflow;
+		m_fDeltaAngleOverflow = progress->deltaAngleOverflow;
+		m_fSumDeltaAngle = progress->sumDeltaAngle;
+		m_fLastMouseAngle = progress->lastMouseAngle;
+		m_fRPM = progress->rpm;
+		m_bClickedOnce = progress->clickedOnce;
+		m_iDeltaAngleIndex = progress->deltaAngleIndex;
+		for (int i=0; i<m_iMaxStoredDeltaAngles && i<sizeof(progress->storedDeltaAngles)/sizeof(progress->storedDeltaAngles[0]); i++)
+		{
+			m_storedDeltaAngles[i] = progress->storedDeltaAngles[i];
+		}
+	}
+}
+
 void OsuSpinner::onHit()
 {
 	///debugLog("ratio = %f\n", m_fRatio);
@@ -397,8 +444,8 @@ void OsuSpinner::onHit()
 		result = OsuScore::HIT::HIT_MISS;
 
 	// sound
-	if (result != OsuScore::HIT::HIT_MISS)
-		m_beatmap->getSkin()->playHitCircleSound(m_iSampleType);
+	if (result != OsuScore::HIT::HIT_MISS && !m_beatmap->isSimulating())
+		playHitSound(m_iSampleType, 0.0f, m_iTime + m_iObjectDuration);
 
 	// add it, and we are finished
 	addHitResult(result, 0, m_vRawPos, -1.0f);
@@ -422,16 +469,20 @@ void OsuSpinner::rotate(float rad)
 		{
 			// extra rotations
 			m_beatmap->addScorePoints(1000);
-			engine->getSound()->play(m_beatmap->getSkin()->getSpinnerBonus());
+			if (!m_beatmap->isSimulating())
+				engine->getSound()->play(m_beatmap->getSkin()->getSpinnerBonus());
 		}
 		m_beatmap->addScorePoints(100);
 	}
 
 	// spinner sound
-	if (!m_beatmap->getSkin()->getSpinnerSpinSound()->isPlaying())
-		engine->getSound()->play(m_beatmap->getSkin()->getSpinnerSpinSound());
-	float frequency = 20000.0f + (int)(clamp<float>(m_fRatio, 0.0f, 1.0f)*40000.0f);
-	m_beatmap->getSkin()->getSpinnerSpinSound()->setFrequency(frequency);
+	if (!m_beatmap->isSimulating())
+	{
+		if (!m_beatmap->getSkin()->getSpinnerSpinSound()->isPlaying())
+			engine->getSound()->play(m_beatmap->getSkin()->getSpinnerSpinSound());
+		float frequency = 20000.0f + (int)(clamp<float>(m_fRatio, 0.0f, 1.0f)*40000.0f);
+		m_beatmap->getSkin()->getSpinnerSpinSound()->setFrequency(frequency);
+	}
 
 	m_fRotations = newRotations;
 }
@@ -449,7 +500,7 @@ Vector2 OsuSpinner::getAutoCursorPos(long curPos)
 
 	Vector2 actualPos = m_beatmap->osuCoords2Pixels(m_vRawPos);
 	const float AUTO_MULTIPLIER = (1.0f / 20.0f);
-	float multiplier = (m_beatmap->getOsu()->getModAuto() || m_beatmap->getOsu()->getModAutopilot()) ? AUTO_MULTIPLIER : 1.0f;
+	float multiplier = (m_beatmap->getMods().has(OsuMods::AUTO) || m_beatmap->getMods().has(OsuMods::AUTOPILOT)) ? AUTO_MULTIPLIER : 1.0f;
 	float angle = (delta * multiplier) - PI/2.0f;
 	float r = m_beatmap->getPlayfieldSize().y / 10.0f;
 	return Vector2((float) (actualPos.x + r * std::cos(angle)), (float) (actualPos.y + r * std::sin(angle)));
@@ -28,6 +28,9 @@ public:
 	virtual void onClickEvent(Vector2 cursorPos, std::vector<OsuBeatmap::CLICK> &clicks);
 	virtual void onReset(long curPos);
 
+	virtual bool getProgress(long curPos, PROGRESS *progress) const;
+	virtual void onRestore(long curPos, bool finished, const PROGRESS *progress);
+
 private:
 	void onHit();
 	void rotate(float rad);
@@ -0,0 +1,284 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		collects textured quads and draws them with as few draw calls as possible
+//
+// $NoKeywords: $osusb
+//===============================================================================//
+
+#include "OsuSpriteBatch.h"
+
+#include "Engine.h"
+#include "ResourceManager.h"
+#include "VertexArrayObject.h"
+#include "Timer.h"
+
+#include "Osu.h"
+#include "OsuSkin.h"
+#include "OsuRecordingGraphics.h"
+
+OsuSpriteBatch *OsuSpriteBatch::s_shared = NULL;
+
+OsuSpriteBatch *OsuSpriteBatch::getShared()
+{
+	if (s_shared == NULL)
+		s_shared = new OsuSpriteBatch();
+
+	return s_shared;
+}
+
+OsuSpriteBatch::OsuSpriteBatch()
+{
+	m_g = NULL;
+	m_iDepth = 0;
+	m_fScaleMultiplier = 1.0f;
+
+	m_texture = NULL;
+	m_vao = new VertexArrayObject(Graphics::PRIMITIVE::PRIMITIVE_QUADS);
+
+	m_iNumFlushes = 0;
+	m_iNumQuads = 0;
+}
+
+OsuSpriteBatch::~OsuSpriteBatch()
+{
+	SAFE_DELETE(m_vao);
+}
+
+void OsuSpriteBatch::begin(Graphics *g)
+{
+	if (m_iDepth > 0 && g != m_g)
+	{
+		// a different target in the middle of a layer, finish everything for the previous one first
+		debugLog("OsuSpriteBatch::begin() with a different Graphics while a layer is active!\n");
+		flush();
+	}
+
+	m_g = g;
+	m_iDepth++;
+}
+
+void OsuSpriteBatch::end()
+{
+	if (m_iDepth < 1)
+	{
+		debugLog("OsuSpriteBatch::end() without begin()!\n");
+		return;
+	}
+
+	m_iDepth--;
+	if (m_iDepth == 0)
+	{
+		flush();
+		m_g = NULL;
+	}
+}
+
+void OsuSpriteBatch::flush()
+{
+	if (m_vertices.size() < 4)
+		return;
+
+	m_iNumFlushes++;
+
+	if (m_g != NULL && m_texture != NULL)
+	{
+		m_vao->clear();
+		for (int i=0; i<m_vertices.size(); i++)
+		{
+			const VERTEX &vertex = m_vertices[i];
+			m_vao->addTexcoord(vertex.u, vertex.v);
+			m_vao->addColor(vertex.color);
+			m_vao->addVertex(vertex.x, vertex.y);
+		}
+
+		OsuRecordingGraphics::bindImage(m_texture);
+		m_g->drawVAO(m_vao);
+		OsuRecordingGraphics::unbindImage(m_texture);
+	}
+
+	m_vertices.clear();
+}
+
+void OsuSpriteBatch::add(Image *image, Vector2 pos, Vector2 scale, float rotation, Color color, Vector2 uvTopLeft, Vector2 uvBottomRight)
+{
+	if (image == NULL)
+		return;
+
+	if (image != m_texture)
+	{
+		flush();
+		m_texture = image;
+	}
+
+	// the same as drawImage() (centered) after g->scale(), g->rotate(), g->translate()
+	const float halfWidth = image->getWidth()*0.5f*scale.x*m_fScaleMultiplier;
+	const float halfHeight = image->getHeight()*0.5f*scale.y*m_fScaleMultiplier;
+	const float corners[4][2] =
+	{
+		{-halfWidth, -halfHeight},
+		{-halfWidth, halfHeight},
+		{halfWidth, halfHeight},
+		{halfWidth, -halfHeight}
+	};
+	const float texcoords[4][2] =
+	{
+		{uvTopLeft.x, uvTopLeft.y},
+		{uvTopLeft.x, uvBottomRight.y},
+		{uvBottomRight.x, uvBottomRight.y},
+		{uvBottomRight.x, uvTopLeft.y}
+	};
+
+	float sinRotation = 0.0f;
+	float cosRotation = 1.0f;
+	if (rotation != 0.0f)
+	{
+		sinRotation = std::sin(deg2rad(rotation));
+		cosRotation = std::cos(deg2rad(rotation));
+	}
+
+	for (int i=0; i<4; i++)
+	{
+		VERTEX vertex;
+		vertex.x = pos.x + corners[i][0]*cosRotation - corners[i][1]*sinRotation;
+		vertex.y = pos.y + corners[i][0]*sinRotation + corners[i][1]*cosRotation;
+		vertex.u = texcoords[i][0];
+		vertex.v = texcoords[i][1];
+		vertex.color = color;
+		m_vertices.push_back(vertex);
+	}
+	m_iNumQuads++;
+
+	// nothing collects quads outside of a layer
+	if (m_iDepth < 1)
+		flush();
+}
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+static bool spriteBatchTestVertex(const OsuSpriteBatch::VERTEX &vertex, float x, float y, float u, float v, Color color)
+{
+	return std::abs(vertex.x - x) < 0.001f && std::abs(vertex.y - y) < 0.001f && std::abs(vertex.u - u) < 0.0001f && std::abs(vertex.v - v) < 0.0001f && vertex.color == color;
+}
+
+void OsuSpriteBatch::test(Osu *osu)
+{
+	int numTests = 0;
+	int numFailed = 0;
+
+	Image *image1 = osu->getSkin()->getHitCircle();
+	Image *image2 = osu->getSkin()->getApproachCircle();
+	const float w = image1->getWidth();
+	const float h = image1->getHeight();
+
+	// vertex positions, texture coordinates and colors
+	{
+		OsuSpriteBatch batch;
+		batch.begin(NULL);
+
+		batch.add(image1, Vector2(100, 50), 2.0f, 0xff112233);
+		numTests++;
+		if (batch.getNumPendingQuads() != 1
+			|| !spriteBatchTestVertex(batch.getVertices()[0], 100 - w, 50 - h, 0, 0, 0xff112233)
+			|| !spriteBatchTestVertex(batch.getVertices()[1], 100 - w, 50 + h, 0, 1, 0xff112233)
+			|| !spriteBatchTestVertex(batch.getVertices()[2], 100 + w, 50 + h, 1, 1, 0xff112233)
+			|| !spriteBatchTestVertex(batch.getVertices()[3], 100 + w, 50 - h, 1, 0, 0xff112233))
+		{
+			numFailed++;
+			debugLog("osu_spritebatch_test: FAILED scaled quad\n");
+		}
+
+		// rotating by 90 degrees moves the top left corner to the top right (y is down)
+		batch.add(image1, Vector2(0, 0), Vector2(1, 1), 90.0f, 0x80ffffff, Vector2(0.25f, 0.5f), Vector2(0.75f, 1.0f));
+		numTests++;
+		if (batch.getNumPendingQuads() != 2
+			|| !spriteBatchTestVertex(batch.getVertices()[4], h*0.5f, -w*0.5f, 0.25f, 0.5f, 0x80ffffff)
+			|| !spriteBatchTestVertex(batch.getVertices()[6], -h*0.5f, w*0.5f, 0.75f, 1.0f, 0x80ffffff))
+		{
+			numFailed++;
+			debugLog("osu_spritebatch_test: FAILED rotated quad with uvs\n");
+		}
+
+		// the scale multiplier only scales the size, not the position
+		batch.setScaleMultiplier(2.0f);
+		batch.add(image1, Vector2(10, 10), 1.0f, 0xffffffff);
+		batch.setScaleMultiplier(1.0f);
+		numTests++;
+		if (!spriteBatchTestVertex(batch.getVertices()[8], 10 - w, 10 - h, 0, 0, 0xffffffff))
+		{
+			numFailed++;
+			debugLog("osu_spritebatch_test: FAILED scale multiplier\n");
+		}
+
+		batch.end();
+		numTests++;
+		if (batch.getNumPendingQuads() != 0 || batch.getNumFlushes() != 1)
+		{
+			numFailed++;
+			debugLog("osu_spritebatch_test: FAILED end of layer (%i pending, %lu flushes)\n", batch.getNumPendingQuads(), batch.getNumFlushes());
+		}
+	}
+
+	// flushing: only on texture changes and at the end of the outermost layer, drawing order is kept
+	{
+		OsuSpriteBatch batch;
+		batch.begin(NULL);
+		for (int i=0; i<10; i++)
+		{
+			batch.add(image1, Vector2(i, i), 1.0f, 0xffffffff);
+		}
+		batch.begin(NULL); // nested, e.g. an OsuCircle helper inside the draw2() layer
+		batch.add(image1, Vector2(0, 0), 1.0f, 0xffffffff);
+		batch.end();
+
+		numTests++;
+		if (batch.getNumFlushes() != 0 || batch.getNumPendingQuads() != 11)
+		{
+			numFailed++;
+			debugLog("osu_spritebatch_test: FAILED nested layer (%lu flushes, %i pending)\n", batch.getNumFlushes(), batch.getNumPendingQuads());
+		}
+
+		batch.add(image2, Vector2(0, 0), 1.0f, 0xffffffff);
+		batch.add(image2, Vector2(0, 0), 1.0f, 0xffffffff);
+		batch.add(image1, Vector2(0, 0), 1.0f, 0xffffffff);
+		batch.end();
+
+		numTests++;
+		if (image1 != image2 ? batch.getNumFlushes() != 3 : batch.getNumFlushes() != 1)
+		{
+			numFailed++;
+			debugLog("osu_spritebatch_test: FAILED texture changes (%lu flushes)\n", batch.getNumFlushes());
+		}
+
+		// outside of any layer every quad is drawn immediately
+		batch.add(image1, Vector2(0, 0), 1.0f, 0xffffffff);
+		numTests++;
+		if (batch.getNumPendingQuads() != 0)
+		{
+			numFailed++;
+			debugLog("osu_spritebatch_test: FAILED quad outside of a layer\n");
+		}
+	}
+
+	// benchmark, the cpu side of a dense stream (hitcircle, overlay, 2 digits, approach circle per object)
+	{
+		OsuSpriteBatch batch;
+		const int numQuads = 200000;
+		Timer t;
+		t.start();
+		batch.begin(NULL);
+		for (int i=0; i<numQuads; i++)
+		{
+			batch.add(i % 5 == 4 ? image2 : image1, Vector2(i % 512, i % 384), 0.5f, 0xffffffff);
+		}
+		batch.end();
+		t.update();
+
+		debugLog("osu_spritebatch_test: %i quads in %f ms (%f quads per ms), %lu flushes\n", numQuads, t.getElapsedTime()*1000.0, numQuads / std::max(t.getElapsedTime()*1000.0, 0.000001), batch.getNumFlushes());
+	}
+
+	debugLog("osu_spritebatch_test: %s, %i/%i passed\n", numFailed == 0 ? "PASSED" : "FAILED", numTests - numFailed, numTests);
+}
@@ -0,0 +1,72 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		collects textured quads and draws them with as few draw calls as possible
+//
+// $NoKeywords: $osusb
+//===============================================================================//
+
+#ifndef OSUSPRITEBATCH_H
+#define OSUSPRITEBATCH_H
+
+#include "cbase.h"
+
+class VertexArrayObject;
+
+class Osu;
+
+// quads are drawn in the order they are added, consecutive quads with the same texture end up in the same draw call
+// a batch is flushed when the texture changes, at the end of the outermost layer, or explicitly (before drawing anything else with g in between)
+// the quads are positioned like g->scale(), g->rotate(), g->translate(), g->drawImage() would, but on the cpu: the transform of g must not change while quads are pending
+// layers nest, so that the OsuCircle helpers can be used on their own (one layer each) as well as inside a bigger layer (e.g. all approach circles of a frame)
+class OsuSpriteBatch
+{
+public:
+	struct VERTEX
+	{
+		float x, y;
+		float u, v;
+		Color color;
+	};
+
+public:
+	static OsuSpriteBatch *getShared(); // used by OsuCircle, OsuSlider, OsuBeatmap and OsuHUD
+
+	OsuSpriteBatch();
+	~OsuSpriteBatch();
+
+	void begin(Graphics *g); // g may be NULL, in which case flushing just drops the quads (for testing)
+	void end();
+	void flush();
+
+	// image is drawn centered at pos, scaled by scale (times the scale multiplier) and rotated by rotation (in degrees), uv is the top left and bottom right texture coordinate
+	void add(Image *image, Vector2 pos, Vector2 scale, float rotation, Color color, Vector2 uvTopLeft = Vector2(0, 0), Vector2 uvBottomRight = Vector2(1, 1));
+	inline void add(Image *image, Vector2 pos, float scale, Color color) {add(image, pos, Vector2(scale, scale), 0.0f, color);}
+
+	// instead of g->scale() around a layer, since the quads are already in screen space (e.g. for hit animations)
+	inline void setScaleMultiplier(float scaleMultiplier) {m_fScaleMultiplier = scaleMultiplier;}
+	inline float getScaleMultiplier() const {return m_fScaleMultiplier;}
+
+	inline bool isActive() const {return m_iDepth > 0;}
+	inline const std::vector<VERTEX> &getVertices() const {return m_vertices;} // pending, 4 per quad (top left, bottom left, bottom right, top right)
+	inline int getNumPendingQuads() const {return m_vertices.size() / 4;}
+	inline unsigned long getNumFlushes() const {return m_iNumFlushes;}
+	inline unsigned long getNumQuads() const {return m_iNumQuads;}
+
+	static void test(Osu *osu); // vertex output, flush behaviour + quads per millisecond (osu_spritebatch_test)
+
+private:
+	static OsuSpriteBatch *s_shared;
+
+	Graphics *m_g;
+	int m_iDepth;
+	float m_fScaleMultiplier;
+
+	Image *m_texture; // of the pending quads
+	std::vector<VERTEX> m_vertices;
+	VertexArrayObject *m_vao; // reused for every flush
+
+	unsigned long m_iNumFlushes;
+	unsigned long m_iNumQuads;
+};
+
+#endif
@@ -0,0 +1,841 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		packs many small images (skin elements) into few big ones
+//
+// $NoKeywords: $osuatlas
+//===============================================================================//
+
+#include "OsuTextureAtlas.h"
+
+#include "Engine.h"
+#include "Timer.h"
+
+#include "OsuFile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32) || defined(_WIN64) || defined(__WIN32__) || defined(__CYGWIN__) || defined(__CYGWIN32__) || defined(__TOS_WIN__) || defined(__WINDOWS__)
+
+#define OSU_STAT_STRUCT struct _stat64
+#define OSU_STAT(path, buf) _stat64(path, buf)
+#define OSU_STAT_MTIME_NS(buf) ((long long)(buf).st_mtime*1000000000LL)
+
+#else
+
+#define OSU_STAT_STRUCT struct stat
+#define OSU_STAT(path, buf) stat(path, buf)
+
+#ifdef __linux__
+#define OSU_STAT_MTIME_NS(buf) ((long long)(buf).st_mtim.tv_sec*1000000000LL + (long long)(buf).st_mtim.tv_nsec)
+#else
+#define OSU_STAT_MTIME_NS(buf) ((long long)(buf).st_mtime*1000000000LL)
+#endif
+
+#endif
+
+static const char OSU_TEXTURE_ATLAS_MAGIC[8] = {'O', 'S', 'U', 'A', 'T', 'L', 'A', 'S'};
+static const int OSU_TEXTURE_ATLAS_VERSION = 1;
+
+static int textureAtlasNextPowerOfTwo(int value)
+{
+	int result = 1;
+	while (result < value)
+	{
+		result *= 2;
+	}
+	return result;
+}
+
+static void textureAtlasHash(unsigned long long *hash, const void *data, size_t size)
+{
+	// FNV-1a
+	const unsigned char *bytes = (const unsigned char*)data;
+	for (size_t i=0; i<size; i++)
+	{
+		*hash ^= bytes[i];
+		*hash *= 1099511628211ULL;
+	}
+}
+
+static void textureAtlasWriteInt(std::vector<unsigned char> *data, int value)
+{
+	const size_t offset = data->size();
+	data->resize(offset + 4);
+	memcpy(&(*data)[offset], &value, 4);
+}
+
+static bool textureAtlasReadInt(const std::vector<unsigned char> &data, size_t *offset, int *value)
+{
+	if (data.size() - *offset < 4)
+		return false;
+
+	memcpy(value, &data[*offset], 4);
+	*offset += 4;
+	return true;
+}
+
+OsuTextureAtlas::OsuTextureAtlas(int maxPageSize, int padding, int extrude)
+{
+	m_iMaxPageSize = std::max(maxPageSize, 1);
+	m_iPadding = std::max(padding, 0);
+	m_iExtrude = clamp<int>(extrude, 0, m_iPadding); // extruded pixels live in the padding
+	m_iNumUnpackedSprites = 0;
+}
+
+void OsuTextureAtlas::clear()
+{
+	m_entries.clear();
+	m_pages.clear();
+	m_iNumUnpackedSprites = 0;
+}
+
+struct OsuTextureAtlasSpriteComparator
+{
+	const std::vector<OsuTextureAtlas::SPRITE> *sprites;
+
+	bool operator() (int a, int b) const
+	{
+		const OsuTextureAtlas::SPRITE &spriteA = (*sprites)[a];
+		const OsuTextureAtlas::SPRITE &spriteB = (*sprites)[b];
+
+		// largest first, the name makes the order independent of the input order
+		if (spriteA.height != spriteB.height)
+			return spriteA.height > spriteB.height;
+		if (spriteA.width != spriteB.width)
+			return spriteA.width > spriteB.width;
+		return spriteA.name < spriteB.name;
+	}
+};
+
+struct OsuTextureAtlasEntryComparator
+{
+	bool operator() (const OsuTextureAtlas::ENTRY &a, const OsuTextureAtlas::ENTRY &b) const {return a.name < b.name;}
+	bool operator() (const OsuTextureAtlas::ENTRY &a, const std::string &b) const {return a.name < b;}
+};
+
+bool OsuTextureAtlas::build(const std::vector<SPRITE> &sprites, bool copyPixels)
+{
+	clear();
+
+	std::vector<int> order;
+	order.reserve(sprites.size());
+	for (int i=0; i<sprites.size(); i++)
+	{
+		order.push_back(i);
+	}
+	OsuTextureAtlasSpriteComparator comparator;
+	comparator.sprites = &sprites;
+	std::sort(order.begin(), order.end(), comparator);
+
+	std::vector<BIN> bins;
+	std::vector<int> entrySprites; // entry index -> sprite index
+	m_entries.reserve(sprites.size());
+	entrySprites.reserve(sprites.size());
+	for (int i=0; i<order.size(); i++)
+	{
+		const SPRITE &sprite = sprites[order[i]];
+		const int paddedWidth = sprite.width + 2*m_iPadding;
+		const int paddedHeight = sprite.height + 2*m_iPadding;
+		if (sprite.width < 1 || sprite.height < 1 || paddedWidth > m_iMaxPageSize || paddedHeight > m_iMaxPageSize)
+		{
+			m_iNumUnpackedSprites++;
+			continue;
+		}
+
+		// first page it fits on, at the best position on that page
+		RECT rect;
+		int page = -1;
+		for (int b=0; b<bins.size(); b++)
+		{
+			int bestShortSide, bestLongSide;
+			if (findPosition(bins[b], paddedWidth, paddedHeight, &rect, &bestShortSide, &bestLongSide))
+			{
+				page = b;
+				break;
+			}
+		}
+		if (page < 0)
+		{
+			BIN bin;
+			RECT pageRect;
+			pageRect.x = 0;
+			pageRect.y = 0;
+			pageRect.width = m_iMaxPageSize;
+			pageRect.height = m_iMaxPageSize;
+			bin.freeRects.push_back(pageRect);
+			bin.usedWidth = 0;
+			bin.usedHeight = 0;
+			bins.push_back(bin);
+
+			page = bins.size() - 1;
+			int bestShortSide, bestLongSide;
+			findPosition(bins[page], paddedWidth, paddedHeight, &rect, &bestShortSide, &bestLongSide);
+		}
+		placeRect(&bins[page], rect);
+
+		ENTRY entry;
+		entry.name = sprite.name;
+		entry.page = page;
+		entry.x = rect.x + m_iPadding;
+		entry.y = rect.y + m_iPadding;
+		entry.width = sprite.width;
+		entry.height = sprite.height;
+		entry.scale = sprite.scale;
+		m_entries.push_back(entry);
+		entrySprites.push_back(order[i]);
+	}
+
+	m_pages.resize(bins.size());
+	for (int i=0; i<bins.size(); i++)
+	{
+		m_pages[i].width = std::min(textureAtlasNextPowerOfTwo(bins[i].usedWidth), m_iMaxPageSize);
+		m_pages[i].height = std::min(textureAtlasNextPowerOfTwo(bins[i].usedHeight), m_iMaxPageSize);
+		if (copyPixels)
+			m_pages[i].rgba.resize((size_t)m_pages[i].width * m_pages[i].height * 4, 0);
+	}
+
+	if (copyPixels)
+	{
+		for (int i=0; i<m_entries.size(); i++)
+		{
+			copySprite(sprites[entrySprites[i]], m_entries[i]);
+		}
+	}
+
+	for (int i=0; i<m_entries.size(); i++)
+	{
+		ENTRY &entry = m_entries[i];
+		const PAGE &page = m_pages[entry.page];
+		entry.u0 = (float)entry.x / (float)page.width;
+		entry.v0 = (float)entry.y / (float)page.height;
+		entry.u1 = (float)(entry.x + entry.width) / (float)page.width;
+		entry.v1 = (float)(entry.y + entry.height) / (float)page.height;
+	}
+	std::sort(m_entries.begin(), m_entries.end(), OsuTextureAtlasEntryComparator());
+
+	return m_iNumUnpackedSprites == 0;
+}
+
+bool OsuTextureAtlas::findPosition(const BIN &bin, int width, int height, RECT *result, int *bestShortSide, int *bestLongSide)
+{
+	bool found = false;
+	for (int i=0; i<bin.freeRects.size(); i++)
+	{
+		const RECT &freeRect = bin.freeRects[i];
+		if (freeRect.width < width || freeRect.height < height)
+			continue;
+
+		const int leftoverHorizontal = freeRect.width - width;
+		const int leftoverVertical = freeRect.height - height;
+		const int shortSide = std::min(leftoverHorizontal, leftoverVertical);
+		const int longSide = std::max(leftoverHorizontal, leftoverVertical);
+		if (!found || shortSide < *bestShortSide || (shortSide == *bestShortSide && longSide < *bestLongSide))
+		{
+			result->x = freeRect.x;
+			result->y = freeRect.y;
+			result->width = width;
+			result->height = height;
+			*bestShortSide = shortSide;
+			*bestLongSide = longSide;
+			found = true;
+		}
+	}
+	return found;
+}
+
+void OsuTextureAtlas::placeRect(BIN *bin, const RECT &rect)
+{
+	std::vector<RECT> &freeRects = bin->freeRects;
+
+	// split every free rect which overlaps the new one into the (up to 4) maximal rects around it
+	int numRectsToProcess = freeRects.size();
+	for (int i=0; i<numRectsToProcess; )
+	{
+		const RECT freeRect = freeRects[i];
+		if (rect.x >= freeRect.x + freeRect.width || rect.x + rect.width <= freeRect.x || rect.y >= freeRect.y + freeRect.height || rect.y + rect.height <= freeRect.y)
+		{
+			i++;
+			continue;
+		}
+
+		if (rect.y > freeRect.y)
+		{
+			RECT top = freeRect;
+			top.height = rect.y - freeRect.y;
+			freeRects.push_back(top);
+		}
+		if (rect.y + rect.height < freeRect.y + freeRect.height)
+		{
+			RECT bottom = freeRect;
+			bottom.y = rect.y + rect.height;
+			bottom.height = freeRect.y + freeRect.height - bottom.y;
+			freeRects.push_back(bottom);
+		}
+		if (rect.x > freeRect.x)
+		{
+			RECT left = freeRect;
+			left.width = rect.x - freeRect.x;
+			freeRects.push_back(left);
+		}
+		if (rect.x + rect.width < freeRect.x + freeRect.width)
+		{
+			RECT right = freeRect;
+			right.x = rect.x + rect.width;
+			right.width = freeRect.x + freeRect.width - right.x;
+			freeRects.push_back(right);
+		}
+
+		freeRects.erase(freeRects.begin() + i);
+		numRectsToProcess--;
+	}
+
+	// and drop the ones which are contained in another one
+	for (int i=0; i<freeRects.size(); i++)
+	{
+		for (int j=i+1; j<freeRects.size(); j++)
+		{
+			const RECT &a = freeRects[i];
+			const RECT &b = freeRects[j];
+			if (a.x >= b.x && a.y >= b.y && a.x + a.width <= b.x + b.width && a.y + a.height <= b.y + b.height)
+			{
+				freeRects.erase(freeRects.begin() + i);
+				i--;
+				break;
+			}
+			if (b.x >= a.x && b.y >= a.y && b.x + b.width <= a.x + a.width && b.y + b.height <= a.y + a.height)
+			{
+				freeRects.erase(freeRects.begin() + j);
+				j--;
+			}
+		}
+	}
+
+	bin->usedWidth = std::max(bin->usedWidth, rect.x + rect.width);
+	bin->usedHeight = std::max(bin->usedHeight, rect.y + rect.height);
+}
+
+void OsuTextureAtlas::copySprite(const SPRITE &sprite, const ENTRY &entry)
+{
+	if (sprite.rgba.size() != (size_t)sprite.width * sprite.height * 4)
+		return;
+
+	PAGE &page = m_pages[entry.page];
+
+	// the sprite plus m_iExtrude pixels around it, which repeat the nearest edge pixel
+	for (int y=-m_iExtrude; y<sprite.height + m_iExtrude; y++)
+	{
+		const int sourceY = clamp<int>(y, 0, sprite.height - 1);
+		unsigned char *destRow = &page.rgba[((size_t)(entry.y + y) * page.width + entry.x) * 4];
+		const unsigned char *sourceRow = &sprite.rgba[(size_t)sourceY * sprite.width * 4];
+
+		memcpy(destRow, sourceRow, (size_t)sprite.width * 4);
+		for (int x=1; x<=m_iExtrude; x++)
+		{
+			memcpy(destRow - x*4, sourceRow, 4);
+			memcpy(destRow + (sprite.width - 1 + x)*4, sourceRow + (sprite.width - 1)*4, 4);
+		}
+	}
+}
+
+const OsuTextureAtlas::ENTRY *OsuTextureAtlas::getEntry(const std::string &name) const
+{
+	std::vector<ENTRY>::const_iterator it = std::lower_bound(m_entries.begin(), m_entries.end(), name, OsuTextureAtlasEntryComparator());
+	if (it == m_entries.end() || it->name != name)
+		return NULL;
+
+	return &(*it);
+}
+
+float OsuTextureAtlas::getOccupancy() const
+{
+	double spritePixels = 0.0;
+	for (int i=0; i<m_entries.size(); i++)
+	{
+		spritePixels += (double)m_entries[i].width * m_entries[i].height;
+	}
+
+	double pagePixels = 0.0;
+	for (int i=0; i<m_pages.size(); i++)
+	{
+		pagePixels += (double)m_pages[i].width * m_pages[i].height;
+	}
+
+	return pagePixels > 0.0 ? (float)(spritePixels / pagePixels) : 0.0f;
+}
+
+unsigned long long OsuTextureAtlas::computeCacheKey(UString skinPath, const std::vector<UString> &filePaths) const
+{
+	unsigned long long hash = 14695981039346656037ULL;
+
+	const int settings[4] = {OSU_TEXTURE_ATLAS_VERSION, m_iMaxPageSize, m_iPadding, m_iExtrude};
+	textureAtlasHash(&hash, settings, sizeof(settings));
+	textureAtlasHash(&hash, skinPath.toUtf8(), strlen(skinPath.toUtf8()) + 1);
+
+	// sorted, so that the order in which the caller collected them doesn't matter
+	std::vector<std::string> sortedFilePaths;
+	for (int i=0; i<filePaths.size(); i++)
+	{
+		sortedFilePaths.push_back(filePaths[i].toUtf8());
+	}
+	std::sort(sortedFilePaths.begin(), sortedFilePaths.end());
+
+	for (int i=0; i<sortedFilePaths.size(); i++)
+	{
+		long long stamp[2] = {-1, -1}; // missing files count too, in case they appear later
+		OSU_STAT_STRUCT fileStat;
+		if (OSU_STAT(sortedFilePaths[i].c_str(), &fileStat) == 0)
+		{
+			stamp[0] = OSU_STAT_MTIME_NS(fileStat);
+			stamp[1] = (long long)fileStat.st_size;
+		}
+
+		textureAtlasHash(&hash, sortedFilePaths[i].c_str(), sortedFilePaths[i].length() + 1);
+		textureAtlasHash(&hash, stamp, sizeof(stamp));
+	}
+
+	return hash;
+}
+
+bool OsuTextureAtlas::save(UString filePath, unsigned long long key) const
+{
+	std::vector<unsigned char> data;
+	data.insert(data.end(), OSU_TEXTURE_ATLAS_MAGIC, OSU_TEXTURE_ATLAS_MAGIC + 8);
+	textureAtlasWriteInt(&data, OSU_TEXTURE_ATLAS_VERSION);
+	textureAtlasWriteInt(&data, (int)(key & 0xffffffffULL));
+	textureAtlasWriteInt(&data, (int)(key >> 32));
+	textureAtlasWriteInt(&data, m_iNumUnpackedSprites);
+
+	textureAtlasWriteInt(&data, m_entries.size());
+	for (int i=0; i<m_entries.size(); i++)
+	{
+		const ENTRY &entry = m_entries[i];
+		textureAtlasWriteInt(&data, entry.name.length());
+		data.insert(data.end(), entry.name.begin(), entry.name.end());
+		textureAtlasWriteInt(&data, entry.page);
+		textureAtlasWriteInt(&data, entry.x);
+		textureAtlasWriteInt(&data, entry.y);
+		textureAtlasWriteInt(&data, entry.width);
+		textureAtlasWriteInt(&data, entry.height);
+		textureAtlasWriteInt(&data, entry.scale);
+	}
+
+	textureAtlasWriteInt(&data, m_pages.size());
+	for (int i=0; i<m_pages.size(); i++)
+	{
+		const PAGE &page = m_pages[i];
+		textureAtlasWriteInt(&data, page.width);
+		textureAtlasWriteInt(&data, page.height);
+		textureAtlasWriteInt(&data, page.rgba.size() > 0 ? 1 : 0);
+		data.insert(data.end(), page.rgba.begin(), page.rgba.end());
+	}
+
+	if (!OsuFile::writeFileAtomic(filePath, &data[0], data.size()))
+	{
+		debugLog("OsuTextureAtlas: Couldn't write %s\n", filePath.toUtf8());
+		return false;
+	}
+
+	return true;
+}
+
+bool OsuTextureAtlas::load(UString filePath, unsigned long long key)
+{
+	std::vector<unsigned char> data;
+	{
+		std::ifstream in(filePath.toUtf8(), std::ios::in | std::ios::binary | std::ios::ate);
+		if (!in.good())
+			return false;
+
+		const std::streamsize fileSize = in.tellg();
+		if (fileSize < 8)
+			return false;
+
+		data.resize((size_t)fileSize);
+		in.seekg(0, std::ios::beg);
+		if (!in.read((char*)&data[0], fileSize).good())
+			return false;
+	}
+
+	if (memcmp(&data[0], OSU_TEXTURE_ATLAS_MAGIC, 8) != 0)
+		return false;
+
+	size_t offset = 8;
+	int version, keyLow, keyHigh, numUnpackedSprites, numEntries;
+	if (!textureAtlasReadInt(data, &offset, &version) || version != OSU_TEXTURE_ATLAS_VERSION)
+		return false;
+	if (!textureAtlasReadInt(data, &offset, &keyLow) || !textureAtlasReadInt(data, &offset, &keyHigh))
+		return false;
+	if ((((unsigned long long)(unsigned int)keyHigh << 32) | (unsigned long long)(unsigned int)keyLow) != key)
+		return false; // stale
+	if (!textureAtlasReadInt(data, &offset, &numUnpackedSprites) || !textureAtlasReadInt(data, &offset, &numEntries) || numEntries < 0)
+		return false;
+
+	std::vector<ENTRY> entries;
+	for (int i=0; i<numEntries; i++)
+	{
+		ENTRY entry;
+		int nameLength;
+		if (!textureAtlasReadInt(data, &offset, &nameLength) || nameLength < 0 || (size_t)nameLength > data.size() - offset)
+			return false;
+
+		entry.name.assign((const char*)&data[offset], nameLength);
+		offset += nameLength;
+
+		if (!textureAtlasReadInt(data, &offset, &entry.page) || !textureAtlasReadInt(data, &offset, &entry.x) || !textureAtlasReadInt(data, &offset, &entry.y)
+			|| !textureAtlasReadInt(data, &offset, &entry.width) || !textureAtlasReadInt(data, &offset, &entry.height) || !textureAtlasReadInt(data, &offset, &entry.scale))
+			return false;
+
+		entries.push_back(entry);
+	}
+
+	int numPages;
+	if (!textureAtlasReadInt(data, &offset, &numPages) || numPages < 0)
+		return false;
+
+	std::vector<PAGE> pages(numPages);
+	for (int i=0; i<numPages; i++)
+	{
+		PAGE &page = pages[i];
+		int hasPixels;
+		if (!textureAtlasReadInt(data, &offset, &page.width) || !textureAtlasReadInt(data, &offset, &page.height) || !textureAtlasReadInt(data, &offset, &hasPixels))
+			return false;
+		if (page.width < 1 || page.height < 1 || page.width > m_iMaxPageSize || page.height > m_iMaxPageSize)
+			return false;
+
+		if (hasPixels != 0)
+		{
+			const size_t size = (size_t)page.width * page.height * 4;
+			if (size > data.size() - offset)
+				return false;
+
+			page.rgba.assign(data.begin() + offset, data.begin() + offset + size);
+			offset += size;
+		}
+	}
+
+	for (int i=0; i<entries.size(); i++)
+	{
+		ENTRY &entry = entries[i];
+		if (entry.page < 0 || entry.page >= numPages || entry.x < 0 || entry.y < 0 || entry.x + entry.width > pages[entry.page].width || entry.y + entry.height > pages[entry.page].height)
+			return false;
+
+		entry.u0 = (float)entry.x / (float)pages[entry.page].width;
+		entry.v0 = (float)entry.y / (float)pages[entry.page].height;
+		entry.u1 = (float)(entry.x + entry.width) / (float)pages[entry.page].width;
+		entry.v1 = (float)(entry.y + entry.height) / (float)pages[entry.page].height;
+	}
+
+	m_entries.swap(entries);
+	m_pages.swap(pages);
+	m_iNumUnpackedSprites = numUnpackedSprites;
+	return true;
+}
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+static unsigned int textureAtlasTestRandom(unsigned int *state)
+{
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+// roughly what a skin looks like: lots of small elements (digits, mod icons, hit results), fewer big ones (hitcircles, slider balls, ranking panel parts), some @2x
+static std::vector<OsuTextureAtlas::SPRITE> textureAtlasTestSprites(int numSprites, bool withPixels)
+{
+	std::vector<OsuTextureAtlas::SPRITE> sprites;
+	unsigned int state = 1234567;
+	for (int i=0; i<numSprites; i++)
+	{
+		OsuTextureAtlas::SPRITE sprite;
+		sprite.name = UString::format("sprite%i", i).toUtf8();
+		sprite.scale = (textureAtlasTestRandom(&state) % 3 == 0 ? 2 : 1);
+
+		const unsigned int kind = textureAtlasTestRandom(&state) % 10;
+		const int maxSize = (kind < 6 ? 64 : (kind < 9 ? 160 : 320)) * sprite.scale;
+		sprite.width = 8 + textureAtlasTestRandom(&state) % maxSize;
+		sprite.height = 8 + textureAtlasTestRandom(&state) % maxSize;
+
+		if (withPixels)
+		{
+			sprite.rgba.resize((size_t)sprite.width * sprite.height * 4);
+			for (int p=0; p<sprite.width*sprite.height; p++)
+			{
+				sprite.rgba[p*4 + 0] = (unsigned char)i;
+				sprite.rgba[p*4 + 1] = (unsigned char)(p % sprite.width);
+				sprite.rgba[p*4 + 2] = (unsigned char)(p / sprite.width);
+				sprite.rgba[p*4 + 3] = 255;
+			}
+		}
+		sprites.push_back(sprite);
+	}
+	return sprites;
+}
+
+// every sprite is inside its page with its padding, and no two padded sprites on the same page overlap
+static bool textureAtlasTestInvariants(const OsuTextureAtlas &atlas, int padding)
+{
+	const std::vector<OsuTextureAtlas::ENTRY> &entries = atlas.getEntries();
+	const std::vector<OsuTextureAtlas::PAGE> &pages = atlas.getPages();
+	for (int i=0; i<entries.size(); i++)
+	{
+		const OsuTextureAtlas::ENTRY &a = entries[i];
+		if (a.page < 0 || a.page >= pages.size())
+			return false;
+		if (a.x - padding < 0 || a.y - padding < 0 || a.x + a.width + padding > pages[a.page].width || a.y + a.height + padding > pages[a.page].height)
+			return false;
+		if (a.u0 != (float)a.x / pages[a.page].width || a.v1 != (float)(a.y + a.height) / pages[a.page].height)
+			return false;
+
+		for (int j=i+1; j<entries.size(); j++)
+		{
+			const OsuTextureAtlas::ENTRY &b = entries[j];
+			if (a.page != b.page)
+				continue;
+
+			if (a.x - padding < b.x + b.width + padding && b.x - padding < a.x + a.width + padding && a.y - padding < b.y + b.height + padding && b.y - padding < a.y + a.height + padding)
+				return false;
+		}
+	}
+	return true;
+}
+
+static bool textureAtlasTestEqual(const OsuTextureAtlas &a, const OsuTextureAtlas &b)
+{
+	if (a.getEntries().size() != b.getEntries().size() || a.getPages().size() != b.getPages().size() || a.getNumUnpackedSprites() != b.getNumUnpackedSprites())
+		return false;
+
+	for (int i=0; i<a.getEntries().size(); i++)
+	{
+		const OsuTextureAtlas::ENTRY &entryA = a.getEntries()[i];
+		const OsuTextureAtlas::ENTRY &entryB = b.getEntries()[i];
+		if (entryA.name != entryB.name || entryA.page != entryB.page || entryA.x != entryB.x || entryA.y != entryB.y || entryA.width != entryB.width || entryA.height != entryB.height
+			|| entryA.scale != entryB.scale || entryA.u0 != entryB.u0 || entryA.v0 != entryB.v0 || entryA.u1 != entryB.u1 || entryA.v1 != entryB.v1)
+			return false;
+	}
+	for (int i=0; i<a.getPages().size(); i++)
+	{
+		if (a.getPages()[i].width != b.getPages()[i].width || a.getPages()[i].height != b.getPages()[i].height || a.getPages()[i].rgba != b.getPages()[i].rgba)
+			return false;
+	}
+	return true;
+}
+
+void OsuTextureAtlas::test()
+{
+	int numTests = 0;
+	int numFailed = 0;
+
+	const int pageSize = 1024;
+	const int padding = 2;
+
+	// invariants + every sprite can be found again
+	const std::vector<SPRITE> sprites = textureAtlasTestSprites(300, true);
+	OsuTextureAtlas atlas(pageSize, padding, 1);
+	const bool allPacked = atlas.build(sprites);
+	{
+		bool allFound = true;
+		bool pixelsMatch = true;
+		for (int i=0; i<sprites.size(); i++)
+		{
+			const ENTRY *entry = atlas.getEntry(sprites[i].name);
+			if (entry == NULL || entry->width != sprites[i].width || entry->height != sprites[i].height || entry->scale != sprites[i].scale)
+			{
+				allFound = false;
+				continue;
+			}
+
+			// a few sample pixels
+			const PAGE &page = atlas.getPages()[entry->page];
+			const int sampleX[3] = {0, sprites[i].width / 2, sprites[i].width - 1};
+			const int sampleY[3] = {0, sprites[i].height / 3, sprites[i].height - 1};
+			for (int s=0; s<3; s++)
+			{
+				const unsigned char *source = &sprites[i].rgba[((size_t)sampleY[s] * sprites[i].width + sampleX[s]) * 4];
+				const unsigned char *dest = &page.rgba[((size_t)(entry->y + sampleY[s]) * page.width + entry->x + sampleX[s]) * 4];
+				if (memcmp(source, dest, 4) != 0)
+					pixelsMatch = false;
+			}
+		}
+
+		numTests++;
+		if (!allPacked || !allFound || !pixelsMatch || !textureAtlasTestInvariants(atlas, padding) || atlas.getEntry("nonexistent") != NULL)
+		{
+			numFailed++;
+			debugLog("osu_texture_atlas_test: FAILED invariants (packed = %i, found = %i, pixels = %i)\n", (int)allPacked, (int)allFound, (int)pixelsMatch);
+		}
+	}
+
+	// same result for the same set of sprites, in any order
+	{
+		std::vector<SPRITE> reversed(sprites.rbegin(), sprites.rend());
+		OsuTextureAtlas atlas2(pageSize, padding, 1);
+		atlas2.build(reversed);
+
+		numTests++;
+		if (!textureAtlasTestEqual(atlas, atlas2))
+		{
+			numFailed++;
+			debugLog("osu_texture_atlas_test: FAILED determinism\n");
+		}
+	}
+
+	// extrusion: the padding repeats the edge, the pixel after that stays transparent
+	{
+		std::vector<SPRITE> small;
+		SPRITE sprite;
+		sprite.name = "block";
+		sprite.width = 3;
+		sprite.height = 2;
+		sprite.scale = 1;
+		for (int p=0; p<6; p++)
+		{
+			const unsigned char pixel[4] = {(unsigned char)(10*p), 0, 0, 255};
+			sprite.rgba.insert(sprite.rgba.end(), pixel, pixel + 4);
+		}
+		small.push_back(sprite);
+
+		OsuTextureAtlas atlas2(64, 2, 1);
+		atlas2.build(small);
+		const ENTRY *entry = atlas2.getEntry("block");
+		bool ok = (entry != NULL && atlas2.getPages().size() == 1 && atlas2.getPages()[0].width == 8 && atlas2.getPages()[0].height == 8);
+		if (ok)
+		{
+			const PAGE &page = atlas2.getPages()[0];
+			#define PIXEL(x, y) page.rgba[((size_t)(y) * page.width + (x)) * 4]
+			#define ALPHA(x, y) page.rgba[((size_t)(y) * page.width + (x)) * 4 + 3]
+			ok = (PIXEL(entry->x - 1, entry->y) == 0 && PIXEL(entry->x + 3, entry->y) == 20 && PIXEL(entry->x + 2, entry->y + 2) == 50 && PIXEL(entry->x - 1, entry->y - 1) == 0 && ALPHA(entry->x - 1, entry->y - 1) == 255
+				&& ALPHA(entry->x - 2, entry->y) == 0 && ALPHA(entry->x + 4, entry->y) == 0 && ALPHA(entry->x, entry->y + 3) == 0);
+			#undef PIXEL
+			#undef ALPHA
+		}
+
+		numTests++;
+		if (!ok)
+		{
+			numFailed++;
+			debugLog("osu_texture_atlas_test: FAILED extrusion\n");
+		}
+	}
+
+	// sprites which don't fit on a page are left out, multiple pages if needed
+	{
+		std::vector<SPRITE> big;
+		SPRITE sprite;
+		sprite.scale = 1;
+		sprite.width = 100;
+		sprite.height = 100;
+		for (int i=0; i<5; i++)
+		{
+			sprite.name = UString::format("big%i", i).toUtf8();
+			big.push_back(sprite);
+		}
+		sprite.name = "huge";
+		sprite.width = 300;
+		big.push_back(sprite);
+
+		OsuTextureAtlas atlas2(256, 2, 1);
+		const bool allPacked2 = atlas2.build(big, false);
+
+		numTests++;
+		if (allPacked2 || atlas2.getNumUnpackedSprites() != 1 || atlas2.getEntry("huge") != NULL || atlas2.getPages().size() != 2 || !textureAtlasTestInvariants(atlas2, 2))
+		{
+			numFailed++;
+			debugLog("osu_texture_atlas_test: FAILED oversized (%i unpacked, %i pages)\n", atlas2.getNumUnpackedSprites(), (int)atlas2.getPages().size());
+		}
+	}
+
+	// cache: round trip, stale key, truncated file
+	{
+		const UString filePathString = OsuFile::getTempFilePath("texture_atlas_test.cache");
+		const UString sourceFilePathString = OsuFile::getTempFilePath("texture_atlas_test.png");
+		const char *filePath = filePathString.toUtf8();
+		const char *sourceFilePath = sourceFilePathString.toUtf8();
+		FILE *sourceFile = fopen(sourceFilePath, "wb");
+		if (sourceFile != NULL)
+		{
+			fputs("1", sourceFile);
+			fclose(sourceFile);
+		}
+
+		std::vector<UString> sourceFilePaths;
+		sourceFilePaths.push_back(sourceFilePath);
+		const unsigned long long key = atlas.computeCacheKey("skins/test/", sourceFilePaths);
+		const bool saved = atlas.save(filePath, key);
+
+		OsuTextureAtlas loaded(pageSize, padding, 1);
+		const bool loadedOk = loaded.load(filePath, key) && textureAtlasTestEqual(atlas, loaded);
+
+		sourceFile = fopen(sourceFilePath, "wb");
+		if (sourceFile != NULL)
+		{
+			fputs("12", sourceFile);
+			fclose(sourceFile);
+		}
+		const unsigned long long changedKey = atlas.computeCacheKey("skins/test/", sourceFilePaths);
+		OsuTextureAtlas stale(pageSize, padding, 1);
+		const bool staleRejected = (changedKey != key && !stale.load(filePath, changedKey));
+
+		bool truncatedRejected = false;
+		{
+			std::ifstream in(filePath, std::ios::in | std::ios::binary);
+			std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+			in.close();
+			FILE *file = fopen(filePath, "wb");
+			if (file != NULL && data.size() > 1000)
+			{
+				fwrite(&data[0], 1, 1000, file);
+				fclose(file);
+
+				OsuTextureAtlas truncated(pageSize, padding, 1);
+				truncatedRejected = !truncated.load(filePath, key);
+			}
+		}
+		remove(filePath);
+		remove(sourceFilePath);
+
+		numTests++;
+		if (!saved || !loadedOk || !staleRejected || !truncatedRejected)
+		{
+			numFailed++;
+			debugLog("osu_texture_atlas_test: FAILED cache (saved = %i, loaded = %i, stale = %i, truncated = %i)\n", (int)saved, (int)loadedOk, (int)staleRejected, (int)truncatedRejected);
+		}
+	}
+
+	// benchmark
+	{
+		const int numRuns = 20;
+		const std::vector<SPRITE> layoutSprites = textureAtlasTestSprites(300, false);
+		OsuTextureAtlas benchmarkAtlas(2048, 2, 1);
+		Timer t;
+
+		t.start();
+		for (int i=0; i<numRuns; i++)
+		{
+			benchmarkAtlas.build(layoutSprites, false);
+		}
+		t.update();
+		const double layoutTime = t.getElapsedTime() / numRuns;
+
+		t.start();
+		for (int i=0; i<numRuns; i++)
+		{
+			benchmarkAtlas.build(sprites);
+		}
+		t.update();
+		const double buildTime = t.getElapsedTime() / numRuns;
+
+		debugLog("osu_texture_atlas_test: 300 sprites, layout %f ms, with pixels %f ms, %i page(s), %.1f%% occupancy\n", layoutTime*1000.0, buildTime*1000.0, (int)benchmarkAtlas.getPages().size(), benchmarkAtlas.getOccupancy()*100.0f);
+	}
+
+	debugLog("osu_texture_atlas_test: %s, %i/%i passed\n", numFailed == 0 ? "PASSED" : "FAILED", numTests - numFailed, numTests);
+}
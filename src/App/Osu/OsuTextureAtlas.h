@@ -0,0 +1,98 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		packs many small images (skin elements) into few big ones
+//
+// $NoKeywords: $osuatlas
+//===============================================================================//
+
+#ifndef OSUTEXTUREATLAS_H
+#define OSUTEXTUREATLAS_H
+
+#include "cbase.h"
+
+// cpu side only: sprites are decoded rgba buffers, the result are page rgba buffers plus where every sprite ended up on them (pixels and uvs)
+// packing is MaxRects (best short side fit), sprites are placed largest first, a new page is started whenever a sprite doesn't fit on any of the previous ones
+// every sprite gets padding on all sides, of which the inner extrude pixels repeat its edge (so that bilinear filtering at the border doesn't bleed in the neighbours)
+// the output only depends on the set of sprites (not their order), so a packed atlas can be cached on disk and reused as long as the source files don't change
+class OsuTextureAtlas
+{
+public:
+	struct SPRITE
+	{
+		std::string name; // must be unique
+		int width;
+		int height;
+		int scale; // 2 for @2x images, 1 otherwise
+		std::vector<unsigned char> rgba; // width*height*4, may be empty (then the area stays transparent, e.g. for layout only)
+	};
+
+	struct ENTRY
+	{
+		std::string name;
+		int page;
+		int x; // of the sprite itself (without padding), in pixels
+		int y;
+		int width;
+		int height;
+		int scale;
+		float u0, v0; // top left
+		float u1, v1; // bottom right
+	};
+
+	struct PAGE
+	{
+		int width; // the used area, rounded up to a power of two
+		int height;
+		std::vector<unsigned char> rgba;
+	};
+
+public:
+	OsuTextureAtlas(int maxPageSize = 2048, int padding = 2, int extrude = 1);
+
+	// replaces any previous content, returns false if some sprites are too big for a page (those are not in the atlas, see getNumUnpackedSprites())
+	bool build(const std::vector<SPRITE> &sprites, bool copyPixels = true);
+	void clear();
+
+	const ENTRY *getEntry(const std::string &name) const; // NULL if not packed
+	inline const std::vector<ENTRY> &getEntries() const {return m_entries;}
+	inline const std::vector<PAGE> &getPages() const {return m_pages;}
+	inline int getNumUnpackedSprites() const {return m_iNumUnpackedSprites;}
+	float getOccupancy() const; // sprite pixels / page pixels
+
+	// disk cache, the key identifies the sources (see computeCacheKey()), load() fails if it doesn't match
+	bool save(UString filePath, unsigned long long key) const;
+	bool load(UString filePath, unsigned long long key);
+	unsigned long long computeCacheKey(UString skinPath, const std::vector<UString> &filePaths) const; // over the paths, their mtimes and sizes, and the packing settings
+
+	static void test(); // no overlap/containment invariants, determinism, extrusion, cache round trip + packing benchmark (osu_texture_atlas_test)
+
+private:
+	struct RECT
+	{
+		int x;
+		int y;
+		int width;
+		int height;
+	};
+
+	struct BIN
+	{
+		std::vector<RECT> freeRects;
+		int usedWidth;
+		int usedHeight;
+	};
+
+	static bool findPosition(const BIN &bin, int width, int height, RECT *result, int *bestShortSide, int *bestLongSide);
+	static void placeRect(BIN *bin, const RECT &rect);
+	void copySprite(const SPRITE &sprite, const ENTRY &entry);
+
+	int m_iMaxPageSize;
+	int m_iPadding;
+	int m_iExtrude;
+
+	std::vector<ENTRY> m_entries; // sorted by name, for getEntry()
+	std::vector<PAGE> m_pages;
+	int m_iNumUnpackedSprites;
+};
+
+#endif
@@ -0,0 +1,395 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		hit error histogram, early/late means, drift, offset suggestion
+//
+// $NoKeywords: $osutiming
+//===============================================================================//
+
+#include "OsuTimingAnalytics.h"
+
+#include "Engine.h"
+#include "ConVar.h"
+#include "Timer.h"
+
+#include <math.h>
+
+ConVar osu_timing_analytics_drift_threshold("osu_timing_analytics_drift_threshold", 5.0f, "hit errors changing by at least this many ms per minute over a play count as drifting");
+ConVar osu_timing_analytics_min_hits("osu_timing_analytics_min_hits", 30, "minimum number of hits before drift is reported or a local offset is suggested");
+
+static const double OSU_TIMING_ANALYTICS_MIN_DRIFT_MINUTES = 0.5; // a regression over a few seconds is just noise
+
+OsuTimingAnalytics::OsuTimingAnalytics()
+{
+	reset(0.0f, 0.0f, 0.0f, 0, 0);
+}
+
+void OsuTimingAnalytics::reset(float hitWindow300, float hitWindow100, float hitWindow50, long startTime, long endTime)
+{
+	m_fHitWindow300 = hitWindow300;
+	m_fHitWindow100 = hitWindow100;
+	m_iHitWindow50 = std::max((int)ceil(hitWindow50), 0);
+	m_iStartTime = startTime;
+	m_iEndTime = endTime;
+
+	clear();
+}
+
+void OsuTimingAnalytics::clear()
+{
+	m_histogram.assign(2*m_iHitWindow50 + 1, 0);
+	m_iHistogramMax = 0;
+
+	m_iNumHits = 0;
+	m_fSum = 0.0;
+	m_fSumSquares = 0.0;
+	m_iNumEarly = 0;
+	m_iNumLate = 0;
+	m_fEarlySum = 0.0;
+	m_fLateSum = 0.0;
+	for (int i=0; i<NUM_SECTIONS; i++)
+	{
+		m_sections[i].numEarly = 0;
+		m_sections[i].numLate = 0;
+		m_sections[i].earlySum = 0.0;
+		m_sections[i].lateSum = 0.0;
+	}
+
+	m_iFirstHitTime = 0;
+	m_fLastX = 0.0;
+	m_fSumX = 0.0;
+	m_fSumXX = 0.0;
+	m_fSumXY = 0.0;
+}
+
+void OsuTimingAnalytics::addHit(long delta, long time)
+{
+	// histogram
+	const int bin = clamp<int>((int)delta + m_iHitWindow50, 0, (int)m_histogram.size() - 1);
+	m_histogram[bin]++;
+	if (m_histogram[bin] > m_iHistogramMax)
+		m_iHistogramMax = m_histogram[bin];
+
+	// means
+	if (m_iNumHits == 0)
+		m_iFirstHitTime = time;
+	m_iNumHits++;
+	m_fSum += delta;
+	m_fSumSquares += (double)delta*delta;
+
+	int section = 0;
+	if (m_iEndTime > m_iStartTime)
+		section = clamp<int>((int)((double)(time - m_iStartTime)*NUM_SECTIONS / (double)(m_iEndTime - m_iStartTime)), 0, NUM_SECTIONS - 1);
+
+	if (delta < 0)
+	{
+		m_iNumEarly++;
+		m_fEarlySum += delta;
+		m_sections[section].numEarly++;
+		m_sections[section].earlySum += delta;
+	}
+	else if (delta > 0)
+	{
+		m_iNumLate++;
+		m_fLateSum += delta;
+		m_sections[section].numLate++;
+		m_sections[section].lateSum += delta;
+	}
+
+	// regression
+	const double x = (double)(time - m_iFirstHitTime) / 60000.0;
+	m_fLastX = std::max(m_fLastX, x);
+	m_fSumX += x;
+	m_fSumXX += x*x;
+	m_fSumXY += x*delta;
+}
+
+float OsuTimingAnalytics::getMean() const
+{
+	return m_iNumHits > 0 ? (float)(m_fSum / m_iNumHits) : 0.0f;
+}
+
+float OsuTimingAnalytics::getStdDev() const
+{
+	if (m_iNumHits < 1)
+		return 0.0f;
+
+	const double mean = m_fSum / m_iNumHits;
+	return (float)sqrt(std::max(m_fSumSquares / m_iNumHits - mean*mean, 0.0));
+}
+
+float OsuTimingAnalytics::getDrift() const
+{
+	const double denominator = m_iNumHits*m_fSumXX - m_fSumX*m_fSumX;
+	if (m_iNumHits < 2 || denominator <= 1e-12)
+		return 0.0f;
+
+	return (float)((m_iNumHits*m_fSumXY - m_fSumX*m_fSum) / denominator);
+}
+
+bool OsuTimingAnalytics::isDrifting() const
+{
+	if (m_iNumHits < osu_timing_analytics_min_hits.getInt() || m_fLastX < OSU_TIMING_ANALYTICS_MIN_DRIFT_MINUTES)
+		return false;
+
+	return std::abs(getDrift()) >= osu_timing_analytics_drift_threshold.getFloat();
+}
+
+int OsuTimingAnalytics::getMedian() const
+{
+	if (m_iNumHits < 1)
+		return 0;
+
+	const int half = (m_iNumHits + 1) / 2;
+	int numHits = 0;
+	for (int i=0; i<(int)m_histogram.size(); i++)
+	{
+		numHits += m_histogram[i];
+		if (numHits >= half)
+			return i - m_iHitWindow50;
+	}
+	return 0;
+}
+
+int OsuTimingAnalytics::getSuggestedOffsetAdjustment() const
+{
+	if (m_iNumHits < osu_timing_analytics_min_hits.getInt())
+		return 0;
+
+	// hitting late (positive deltas) means the music is heard later than it is played, so the local offset has to go up by as much
+	return getMedian();
+}
+
+
+
+//***********//
+//	Testing	 //
+//***********//
+
+static int timingAnalyticsTestNoise(int i, int amplitude) // deterministic, roughly symmetric around 0
+{
+	const unsigned int hash = (unsigned int)i*2654435761u;
+	return (int)((hash >> 16) % (unsigned int)(2*amplitude + 1)) - amplitude;
+}
+
+static bool timingAnalyticsTestNear(float a, float b, float epsilon)
+{
+	return std::abs(a - b) <= epsilon;
+}
+
+void OsuTimingAnalytics::test()
+{
+	int numTests = 0;
+	int numFailed = 0;
+
+	// histogram: 1 ms bins, clamped into the outermost ones
+	{
+		OsuTimingAnalytics analytics;
+		analytics.reset(25.0f, 60.0f, 99.5f, 0, 10000);
+		const long deltas[] = {-100, -100, -50, 0, 0, 0, 30, 100, 250, -300};
+		for (int i=0; i<10; i++)
+		{
+			analytics.addHit(deltas[i], i*100);
+		}
+
+		const std::vector<int> &histogram = analytics.getHistogram();
+		numTests++;
+		if (histogram.size() != 201 || histogram[0] != 3 || histogram[50] != 1 || histogram[100] != 3 || histogram[130] != 1 || histogram[200] != 2
+			|| analytics.getHistogramMax() != 3 || analytics.getNumHits() != 10 || analytics.getMedian() != 0)
+		{
+			numFailed++;
+			debugLog("osu_timing_analytics_test: FAILED histogram (%i bins, %i/%i/%i, max = %i, median = %i)\n", (int)histogram.size(), histogram.size() > 0 ? histogram[0] : -1, histogram.size() > 100 ? histogram[100] : -1, histogram.size() > 200 ? histogram[200] : -1, analytics.getHistogramMax(), analytics.getMedian());
+		}
+	}
+
+	// mean, standard deviation, early/late means (exactly on time is neither)
+	{
+		OsuTimingAnalytics analytics;
+		analytics.reset(25.0f, 60.0f, 100.0f, 0, 10000);
+		const long deltas[] = {-10, -20, 10, 30, 0};
+		for (int i=0; i<5; i++)
+		{
+			analytics.addHit(deltas[i], i*100);
+		}
+
+		numTests++;
+		if (!timingAnalyticsTestNear(analytics.getMean(), 2.0f, 0.0001f) || !timingAnalyticsTestNear(analytics.getStdDev(), sqrt(296.0f), 0.001f)
+			|| !timingAnalyticsTestNear(analytics.getEarlyMean(), -15.0f, 0.0001f) || !timingAnalyticsTestNear(analytics.getLateMean(), 20.0f, 0.0001f))
+		{
+			numFailed++;
+			debugLog("osu_timing_analytics_test: FAILED means (%f, %f, %f, %f)\n", analytics.getMean(), analytics.getStdDev(), analytics.getEarlyMean(), analytics.getLateMean());
+		}
+	}
+
+	// sections, hits outside of the playable range count towards the first/last one
+	{
+		OsuTimingAnalytics analytics;
+		analytics.reset(25.0f, 60.0f, 100.0f, 1000, 41000);
+		analytics.addHit(-4, 0);
+		analytics.addHit(-4, 50000);
+		for (int s=0; s<NUM_SECTIONS; s++)
+		{
+			for (int i=0; i<10; i++)
+			{
+				analytics.addHit(i % 2 == 0 ? -4*(s + 1) : 2*(s + 1), 1000 + s*10000 + 500 + i*900);
+			}
+		}
+
+		bool ok = true;
+		for (int s=0; s<NUM_SECTIONS; s++)
+		{
+			const SECTION &section = analytics.getSection(s);
+			const int numExtraEarly = (s == 0 || s == NUM_SECTIONS - 1 ? 1 : 0);
+			const float expectedEarlyMean = (float)(-4*(s + 1)*5 - 4*numExtraEarly) / (5 + numExtraEarly);
+			if (section.numEarly != 5 + numExtraEarly || section.numLate != 5 || !timingAnalyticsTestNear(section.getEarlyMean(), expectedEarlyMean, 0.0001f) || !timingAnalyticsTestNear(section.getLateMean(), 2.0f*(s + 1), 0.0001f))
+			{
+				ok = false;
+				debugLog("osu_timing_analytics_test: section %i: %i early (%f), %i late (%f)\n", s, section.numEarly, section.getEarlyMean(), section.numLate, section.getLateMean());
+			}
+		}
+
+		numTests++;
+		if (!ok)
+		{
+			numFailed++;
+			debugLog("osu_timing_analytics_test: FAILED sections\n");
+		}
+	}
+
+	// drift: 6 ms/min under +-8 ms of noise over 4 minutes, none, and too few hits to tell
+	{
+		OsuTimingAnalytics drifting;
+		OsuTimingAnalytics steady;
+		OsuTimingAnalytics shortPlay;
+		drifting.reset(25.0f, 60.0f, 100.0f, 0, 240000);
+		steady.reset(25.0f, 60.0f, 100.0f, 0, 240000);
+		shortPlay.reset(25.0f, 60.0f, 100.0f, 0, 240000);
+		for (int i=0; i<400; i++)
+		{
+			const long time = 5000 + i*600;
+			drifting.addHit(3 + (long)(6.0*time/60000.0) + timingAnalyticsTestNoise(i, 8), time);
+			steady.addHit(timingAnalyticsTestNoise(i, 8), time);
+			if (i < 10)
+				shortPlay.addHit(i*5, time);
+		}
+
+		numTests++;
+		if (!timingAnalyticsTestNear(drifting.getDrift(), 6.0f, 0.5f) || !drifting.isDrifting() || !timingAnalyticsTestNear(steady.getDrift(), 0.0f, 0.5f) || steady.isDrifting() || shortPlay.isDrifting())
+		{
+			numFailed++;
+			debugLog("osu_timing_analytics_test: FAILED drift (%f, %f, %f ms/min)\n", drifting.getDrift(), steady.getDrift(), shortPlay.getDrift());
+		}
+	}
+
+	// offset suggestion from the median, only with enough hits
+	{
+		OsuTimingAnalytics late;
+		OsuTimingAnalytics few;
+		late.reset(25.0f, 60.0f, 100.0f, 0, 60000);
+		few.reset(25.0f, 60.0f, 100.0f, 0, 60000);
+		for (int i=0; i<101; i++)
+		{
+			late.addHit(12 + timingAnalyticsTestNoise(i, 3) + (i % 10 == 0 ? 80 : 0), i*500); // a few outliers don't move the median much
+			if (i < 5)
+				few.addHit(12, i*500);
+		}
+
+		numTests++;
+		if (std::abs(late.getSuggestedOffsetAdjustment() - 12) > 1 || few.getSuggestedOffsetAdjustment() != 0)
+		{
+			numFailed++;
+			debugLog("osu_timing_analytics_test: FAILED offset suggestion (%i, %i, mean = %f)\n", late.getSuggestedOffsetAdjustment(), few.getSuggestedOffsetAdjustment(), late.getMean());
+		}
+	}
+
+	// rebuilding after clear() (what OsuScore::restore() does) is the same as a fresh play
+	{
+		OsuTimingAnalytics rebuilt;
+		OsuTimingAnalytics fresh;
+		rebuilt.reset(25.0f, 60.0f, 100.0f, 0, 120000);
+		fresh.reset(25.0f, 60.0f, 100.0f, 0, 120000);
+		for (int i=0; i<200; i++)
+		{
+			rebuilt.addHit(timingAnalyticsTestNoise(i, 60), i*500);
+		}
+		rebuilt.clear();
+		for (int i=0; i<120; i++)
+		{
+			rebuilt.addHit(timingAnalyticsTestNoise(i, 60), i*500);
+			fresh.addHit(timingAnalyticsTestNoise(i, 60), i*500);
+		}
+
+		numTests++;
+		if (rebuilt.getHistogram() != fresh.getHistogram() || rebuilt.getHistogramMax() != fresh.getHistogramMax() || rebuilt.getMean() != fresh.getMean() || rebuilt.getDrift() != fresh.getDrift() || rebuilt.getNumHits() != 120)
+		{
+			numFailed++;
+			debugLog("osu_timing_analytics_test: FAILED rebuild\n");
+		}
+	}
+
+	// benchmark: 100k hits, against recalculating the unstable rate over all deltas on every hit (as OsuScore did)
+	{
+		const int numHits = 100000;
+		const int numOldHits = 10000; // quadratic, the full 100k would take seconds
+		std::vector<long> deltas;
+		for (int i=0; i<numHits; i++)
+		{
+			deltas.push_back(timingAnalyticsTestNoise(i, 40) + timingAnalyticsTestNoise(i*7 + 3, 40));
+		}
+
+		Timer t;
+		OsuTimingAnalytics analytics;
+		analytics.reset(25.0f, 60.0f, 100.0f, 0, numHits*100);
+		t.start();
+		float unstableRate = 0.0f;
+		for (int i=0; i<numHits; i++)
+		{
+			analytics.addHit(deltas[i], i*100);
+			unstableRate = analytics.getStdDev()*10.0f;
+		}
+		t.update();
+		const double incrementalTime = t.getElapsedTime();
+
+		t.start();
+		std::vector<int> hitdeltas;
+		float oldUnstableRate = 0.0f;
+		for (int i=0; i<numOldHits; i++)
+		{
+			hitdeltas.push_back((int)deltas[i]);
+
+			float averageDelta = 0.0f;
+			oldUnstableRate = 0.0f;
+			for (int d=0; d<hitdeltas.size(); d++)
+			{
+				averageDelta += (float)hitdeltas[d];
+			}
+			averageDelta /= (float)hitdeltas.size();
+			for (int d=0; d<hitdeltas.size(); d++)
+			{
+				oldUnstableRate += ((float)hitdeltas[d] - averageDelta)*((float)hitdeltas[d] - averageDelta);
+			}
+			oldUnstableRate /= (float)hitdeltas.size();
+			oldUnstableRate = std::sqrt(oldUnstableRate)*10;
+		}
+		t.update();
+		const double oldTime = t.getElapsedTime();
+
+		OsuTimingAnalytics firstHits;
+		firstHits.reset(25.0f, 60.0f, 100.0f, 0, numHits*100);
+		for (int i=0; i<numOldHits; i++)
+		{
+			firstHits.addHit(deltas[i], i*100);
+		}
+
+		numTests++;
+		if (analytics.getNumHits() != numHits || !timingAnalyticsTestNear(firstHits.getStdDev()*10.0f, oldUnstableRate, 0.01f))
+		{
+			numFailed++;
+			debugLog("osu_timing_analytics_test: FAILED benchmark (UR %f vs %f)\n", firstHits.getStdDev()*10.0f, oldUnstableRate);
+		}
+
+		debugLog("osu_timing_analytics_test: %i hits: %f ms total, %f ns/hit (UR %f, drift %f ms/min, median %i); old UR recalculation, first %i hits: %f ms total, %f ns/hit\n", numHits, incrementalTime*1000.0, incrementalTime*1e9 / numHits, unstableRate, analytics.getDrift(), analytics.getMedian(),
+			numOldHits, oldTime*1000.0, oldTime*1e9 / numOldHits);
+	}
+
+	debugLog("osu_timing_analytics_test: %s, %i/%i passed\n", numFailed == 0 ? "PASSED" : "FAILED", numTests - numFailed, numTests);
+}
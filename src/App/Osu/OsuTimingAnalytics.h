@@ -0,0 +1,89 @@
+//================ Copyright (c) 2016, PG, All rights reserved. =================//
+//
+// Purpose:		hit error histogram, early/late means, drift, offset suggestion
+//
+// $NoKeywords: $osutiming
+//===============================================================================//
+
+#ifndef OSUTIMINGANALYTICS_H
+#define OSUTIMINGANALYTICS_H
+
+#include "cbase.h"
+
+// fed by OsuScore with every hit delta (+ = late), everything is updated in O(1) per hit
+// the histogram has 1 ms bins over +-hitWindow50 (deltas outside of it land in the outermost bins)
+// drift is the slope of a linear regression of delta over time, in ms per minute (e.g. a gradually desyncing audio device, or getting tired)
+class OsuTimingAnalytics
+{
+public:
+	static const int NUM_SECTIONS = 4; // equally long parts of the playable length
+
+	struct SECTION
+	{
+		int numEarly;
+		int numLate;
+		double earlySum;
+		double lateSum;
+
+		inline float getEarlyMean() const {return numEarly > 0 ? (float)(earlySum / numEarly) : 0.0f;}
+		inline float getLateMean() const {return numLate > 0 ? (float)(lateSum / numLate) : 0.0f;}
+	};
+
+public:
+	OsuTimingAnalytics();
+
+	void reset(float hitWindow300, float hitWindow100, float hitWindow50, long startTime, long endTime); // sets the hit windows and playable range (in ms), then clear()
+	void clear(); // drops all hits, keeps the hit windows and range
+
+	void addHit(long delta, long time);
+
+	inline int getNumHits() const {return m_iNumHits;}
+	inline float getHitWindow300() const {return m_fHitWindow300;}
+	inline float getHitWindow100() const {return m_fHitWindow100;}
+	inline int getHitWindow50() const {return m_iHitWindow50;}
+
+	inline const std::vector<int> &getHistogram() const {return m_histogram;} // bin i is a delta of (i - getHitWindow50()) ms
+	inline int getHistogramMax() const {return m_iHistogramMax;}
+
+	float getMean() const;
+	float getStdDev() const; // unstable rate = 10x this
+	inline float getEarlyMean() const {return m_iNumEarly > 0 ? (float)(m_fEarlySum / m_iNumEarly) : 0.0f;}
+	inline float getLateMean() const {return m_iNumLate > 0 ? (float)(m_fLateSum / m_iNumLate) : 0.0f;}
+	inline const SECTION &getSection(int i) const {return m_sections[i];}
+
+	float getDrift() const; // ms per minute, 0 with less than two hits (or no time between them)
+	bool isDrifting() const; // at least osu_timing_analytics_drift_threshold, over enough hits and time for it to mean something
+
+	int getMedian() const; // walks the histogram
+	int getSuggestedOffsetAdjustment() const; // ms to add to the local offset so that the median hit is on time, 0 if there aren't enough hits
+
+	static void test(); // histogram, means, sections, drift, offset suggestion and rebuilding from synthetic delta streams + 100k hit benchmark (osu_timing_analytics_test)
+
+private:
+	float m_fHitWindow300;
+	float m_fHitWindow100;
+	int m_iHitWindow50;
+	long m_iStartTime;
+	long m_iEndTime;
+
+	std::vector<int> m_histogram;
+	int m_iHistogramMax;
+
+	int m_iNumHits;
+	double m_fSum;
+	double m_fSumSquares;
+	int m_iNumEarly;
+	int m_iNumLate;
+	double m_fEarlySum;
+	double m_fLateSum;
+	SECTION m_sections[NUM_SECTIONS];
+
+	// regression of delta over (time - first hit time) in minutes
+	long m_iFirstHitTime;
+	double m_fLastX;
+	double m_fSumX;
+	double m_fSumXX;
+	double m_fSumXY;
+};
+
+#endif
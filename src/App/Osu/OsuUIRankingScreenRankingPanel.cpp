@@ -1,6 +1,6 @@
 //================ Copyright (c) 2016, PG, All rights reserved. =================//
 //
-// Purpose:		score + results panel (300, 100, 50, miss, combo, accuracy, score)
+// Purpose:		score + results panel (300, 100, 50, miss, combo, accuracy, score, hit error histogram)
 //
 // $NoKeywords: $osursp
 //===============================================================================//
@@ -124,6 +124,8 @@ void OsuUIRankingScreenRankingPanel::draw(Graphics *g)
 		g->translate(m_vPos.x + m_osu->getSkin()->getRankingAccuracy()->getWidth()*scale*0.5f + m_osu->getUIScale(m_osu, 183.0f), m_vPos.y + m_osu->getUIScale(m_osu, 257.0f));
 		g->drawImage(m_osu->getSkin()->getRankingAccuracy());
 	g->popTransform();
+
+	drawTimingHistogram(g);
 }
 
 void OsuUIRankingScreenRankingPanel::drawHitImage(Graphics *g, Image *img, float scale, Vector2 pos)
@@ -144,6 +146,70 @@ void OsuUIRankingScreenRankingPanel::drawNumHits(Graphics *g, int numHits, float
 	g->popTransform();
 }
 
+void OsuUIRankingScreenRankingPanel::drawTimingHistogram(Graphics *g)
+{
+	const std::vector<int> &histogram = m_timingAnalytics.getHistogram();
+	if (m_timingAnalytics.getNumHits() < 1 || histogram.size() < 2) return;
+
+	// same colors as the hit error bar
+	const int brightnessSub = 50;
+	const Color color300 = COLOR(255, 0, 255-brightnessSub, 255-brightnessSub);
+	const Color color100 = COLOR(255, 0, 255-brightnessSub, 0);
+	const Color color50 = COLOR(255, 255-brightnessSub, 165-brightnessSub, 0);
+
+	// below the panel
+	const Vector2 pos = m_vPos + Vector2(m_osu->getUIScale(m_osu, 15.0f), m_osu->getUIScale(m_osu, 322.0f));
+	const Vector2 size = Vector2(m_osu->getUIScale(m_osu, 360.0f), m_osu->getUIScale(m_osu, 40.0f));
+	const int hitWindow50 = m_timingAnalytics.getHitWindow50();
+
+	// the 1 ms bins are merged into columns at least 2 pixels wide
+	const int numColumns = clamp<int>((int)(size.x / 2.0f), 1, (int)histogram.size());
+	const float binsPerColumn = histogram.size() / (float)numColumns;
+	std::vector<int> columns(numColumns, 0);
+	for (int i=0; i<histogram.size(); i++)
+	{
+		columns[std::min((int)(i / binsPerColumn), numColumns - 1)] += histogram[i];
+	}
+	int maxColumn = 1;
+	for (int c=0; c<numColumns; c++)
+	{
+		maxColumn = std::max(maxColumn, columns[c]);
+	}
+
+	g->setColor(0x55000000);
+	g->fillRect(pos.x, pos.y, size.x, size.y);
+
+	const float columnWidth = size.x / numColumns;
+	for (int c=0; c<numColumns; c++)
+	{
+		if (columns[c] < 1) continue;
+
+		const float delta = std::abs((c + 0.5f)*binsPerColumn - 0.5f - hitWindow50);
+		g->setColor(delta <= m_timingAnalytics.getHitWindow300() ? color300 : (delta <= m_timingAnalytics.getHitWindow100() ? color100 : color50));
+
+		const float height = size.y * (columns[c] / (float)maxColumn);
+		g->fillRect(pos.x + c*columnWidth, pos.y + size.y - height, std::max(columnWidth - 1.0f, 1.0f), height);
+	}
+
+	// on time, and the mean
+	g->setColor(0xffffffff);
+	g->fillRect(pos.x + size.x/2.0f - 1, pos.y, 2, size.y);
+	g->setColor(0xffffff00);
+	g->fillRect(pos.x + size.x*((m_timingAnalytics.getMean() + hitWindow50 + 0.5f) / histogram.size()) - 1, pos.y, 2, size.y);
+
+	// early/late summary (the details are in the ranking screen tooltip)
+	McFont *font = m_osu->getSubTitleFont();
+	UString summary = UString::format("%.1fms early, +%.1fms late", m_timingAnalytics.getEarlyMean(), m_timingAnalytics.getLateMean());
+	if (m_timingAnalytics.isDrifting())
+		summary.append(UString::format(", drifting %+.1fms/min", m_timingAnalytics.getDrift()));
+
+	g->setColor(0xffffffff);
+	g->pushTransform();
+		g->translate((int)pos.x, (int)(pos.y + size.y + font->getHeight() + m_osu->getUIScale(m_osu, 4.0f)));
+		g->drawString(font, summary);
+	g->popTransform();
+}
+
 void OsuUIRankingScreenRankingPanel::setScore(OsuScore *score)
 {
 	m_iScore = score->getScore();
@@ -155,4 +221,5 @@ void OsuUIRankingScreenRankingPanel::setScore(OsuScore *score)
 	m_iNumMisses = score->getNumMisses();
 	m_iCombo = score->getComboMax();
 	m_fAccuracy = score->getAccuracy();
+	m_timingAnalytics = score->getTimingAnalytics();
 }
@@ -1,6 +1,6 @@
 //================ Copyright (c) 2016, PG, All rights reserved. =================//
 //
-// Purpose:		score + results panel (300, 100, 50, miss, combo, accuracy, score)
+// Purpose:		score + results panel (300, 100, 50, miss, combo, accuracy, score, hit error histogram)
 //
 // $NoKeywords: $osursp
 //===============================================================================//
@@ -10,6 +10,8 @@
 
 #include "CBaseUIImage.h"
 
+#include "OsuTimingAnalytics.h"
+
 class Osu;
 class OsuScore;
 
@@ -26,6 +28,7 @@ public:
 private:
 	void drawHitImage(Graphics *g, Image *img, float scale, Vector2 pos);
 	void drawNumHits(Graphics *g, int numHits, float scale, Vector2 pos);
+	void drawTimingHistogram(Graphics *g);
 
 	Osu *m_osu;
 
@@ -38,6 +41,7 @@ private:
 	int m_iNumMisses;
 	int m_iCombo;
 	float m_fAccuracy;
+	OsuTimingAnalytics m_timingAnalytics;
 };
 
 #endif
@@ -30,8 +30,6 @@ OsuUISongBrowserSongButton::OsuUISongBrowserSongButton(Osu *osu, OsuSongBrowser2
 	m_diff = NULL;
 	m_parent = NULL;
 
-	previousButton = NULL; // reset
-
 	// settings
 	setHideIfSelected(true);
 
@@ -98,6 +96,10 @@ OsuUISongBrowserSongButton::OsuUISongBrowserSongButton(Osu *osu, OsuSongBrowser2
 
 OsuUISongBrowserSongButton::~OsuUISongBrowserSongButton()
 {
+	// buttons are also deleted individually (incremental refresh), not only all at once
+	if (previousButton == this)
+		previousButton = NULL;
+
 	for (int i=0; i<m_children.size(); i++)
 	{
 		delete m_children[i];
@@ -16,6 +16,8 @@
 #include "OsuBeatmap.h"
 #include "OsuBeatmapDifficulty.h"
 #include "OsuSongBrowser2.h"
+#include "OsuBeatmapDatabase.h"
+#include "OsuScoreDatabase.h"
 
 OsuUISongBrowserSongDifficultyButton *OsuUISongBrowserSongDifficultyButton::previousButton = NULL;
 
@@ -24,8 +26,6 @@ OsuUISongBrowserSongDifficultyButton::OsuUISongBrowserSongDifficultyButton(Osu *
 	m_beatmap = beatmap;
 	m_diff = diff;
 
-	previousButton = NULL; // reset
-
 	/*
 	m_sTitle = "Title";
 	m_sArtist = "Artist";
@@ -48,6 +48,13 @@ OsuUISongBrowserSongDifficultyButton::OsuUISongBrowserSongDifficultyButton(Osu *
 	updateLayout();
 }
 
+OsuUISongBrowserSongDifficultyButton::~OsuUISongBrowserSongDifficultyButton()
+{
+	// an incremental refresh deletes single beatmaps, not everything at once
+	if (previousButton == this)
+		previousButton = NULL;
+}
+
 void OsuUISongBrowserSongDifficultyButton::draw(Graphics *g)
 {
 	OsuUISongBrowserButton::draw(g);
@@ -100,6 +107,19 @@ void OsuUISongBrowserSongDifficultyButton::draw(Graphics *g)
 	}
 }
 
+UString OsuUISongBrowserSongDifficultyButton::buildDiffString()
+{
+	// local best accuracy, if there is one (the scores are already sorted, so this is just a lookup)
+	if (m_diff->hasMD5())
+	{
+		const std::vector<OsuScoreDatabase::SCORE> &scores = m_songBrowser->getDatabase()->getScoreDatabase()->getScores(m_diff->getMD5());
+		if (scores.size() > 0)
+			return UString::format("%s  (%.2f%%)", m_sDiff.toUtf8(), scores[0].accuracy*100.0f);
+	}
+
+	return m_sDiff;
+}
+
 void OsuUISongBrowserSongDifficultyButton::onSelected(bool wasSelected)
 {
 	if (!wasSelected)
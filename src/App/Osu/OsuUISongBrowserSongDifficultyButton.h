@@ -14,7 +14,7 @@ class OsuUISongBrowserSongDifficultyButton : public OsuUISongBrowserSongButton
 {
 public:
 	OsuUISongBrowserSongDifficultyButton(Osu *osu, OsuSongBrowser2 *songBrowser, CBaseUIScrollView *view, float xPos, float yPos, float xSize, float ySize, UString name, OsuBeatmap *beatmap, OsuBeatmapDifficulty *diff);
-	virtual ~OsuUISongBrowserSongDifficultyButton() {;}
+	virtual ~OsuUISongBrowserSongDifficultyButton();
 
 	virtual void draw(Graphics *g);
 
@@ -24,10 +24,7 @@ private:
 	virtual void onSelected(bool wasSelected);
 	virtual void onDeselected();
 
-	UString buildDiffString()
-	{
-		return m_sDiff;
-	}
+	UString buildDiffString();
 
 	OsuBeatmap *m_beatmap;
 